@@ -0,0 +1,259 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystembench.cpp
+// ============
+// microbenchmarks for the job system - scheduling overhead per job and
+// parallel for scaling from one worker up to one worker per core
+//
+//  build: g++ -O2 -std=c++14 -pthread -I../Source JobSystemBench.cpp ../Source/JobSystem.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// each measurement is repeated and the fastest run is kept
+	const int REPEAT_COUNT = 5;
+	// number of jobs used for the overhead measurements
+	const int OVERHEAD_JOB_COUNT = 100000;
+	// number of elements processed by the scaling kernel
+	const int SCALING_ELEMENT_COUNT = 1 << 21;
+	// number of links in the dependency chain measurement
+	const int CHAIN_LENGTH = 2000;
+
+	// result sink that keeps the kernels from being optimized away
+	volatile float g_Sink = 0.0f;
+
+	/***********************************************************
+	 *  ElapsedNs()
+	 *
+	 *  nanoseconds between two clock readings
+	 ***********************************************************/
+	double ElapsedNs(Clock::time_point start, Clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::nano>(end - start).count());
+	}
+
+	/***********************************************************
+	 *  EmptyJob()
+	 *
+	 *  job with no work, so only the scheduling cost is timed
+	 ***********************************************************/
+	void EmptyJob(void*, int, int)
+	{
+	}
+
+	/***********************************************************
+	 *  KernelJob()
+	 *
+	 *  compute-bound job of about a few hundred nanoseconds per
+	 *  element, used for the scaling measurement
+	 ***********************************************************/
+	void Kernel(float* pValues, int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			float value = (float)i;
+			for (int k = 0; k < 16; k++)
+			{
+				value = std::sqrt(value * 1.0001f + 1.0f);
+			}
+			pValues[i] = value;
+		}
+	}
+
+	/***********************************************************
+	 *  BenchSubmitOverhead()
+	 *
+	 *  time to submit and complete empty jobs one by one
+	 ***********************************************************/
+	double BenchSubmitOverhead(JobSystem& jobSystem)
+	{
+		double bestNs = 1.0e30;
+		for (int run = 0; run < REPEAT_COUNT; run++)
+		{
+			JobSystem::JobCounter counter;
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < OVERHEAD_JOB_COUNT; i++)
+			{
+				jobSystem.Submit(&EmptyJob, NULL, 0, 1, &counter);
+				// keep the queued jobs below the deque capacity
+				if ((i % (JobSystem::JOB_QUEUE_SIZE / 2)) == 0)
+				{
+					jobSystem.Wait(&counter);
+				}
+			}
+			jobSystem.Wait(&counter);
+			double elapsed = ElapsedNs(start, Clock::now());
+			if (elapsed < bestNs)
+			{
+				bestNs = elapsed;
+			}
+		}
+
+		return(bestNs / OVERHEAD_JOB_COUNT);
+	}
+
+	/***********************************************************
+	 *  BenchParallelForOverhead()
+	 *
+	 *  time per range of a parallel for over an empty body
+	 ***********************************************************/
+	double BenchParallelForOverhead(JobSystem& jobSystem, int grainSize)
+	{
+		double bestNs = 1.0e30;
+		for (int run = 0; run < REPEAT_COUNT; run++)
+		{
+			Clock::time_point start = Clock::now();
+			jobSystem.ParallelFor(OVERHEAD_JOB_COUNT, grainSize, [](int, int) {});
+			double elapsed = ElapsedNs(start, Clock::now());
+			if (elapsed < bestNs)
+			{
+				bestNs = elapsed;
+			}
+		}
+
+		return(bestNs / (OVERHEAD_JOB_COUNT / grainSize));
+	}
+
+	/***********************************************************
+	 *  BenchDependencyChain()
+	 *
+	 *  time per link of a chain of jobs where each job waits on
+	 *  the counter of the one before it
+	 ***********************************************************/
+	double BenchDependencyChain(JobSystem& jobSystem)
+	{
+		std::vector<JobSystem::JobCounter> counters(CHAIN_LENGTH);
+		double bestNs = 1.0e30;
+
+		for (int run = 0; run < REPEAT_COUNT; run++)
+		{
+			Clock::time_point start = Clock::now();
+			for (int i = 0; i < CHAIN_LENGTH; i++)
+			{
+				const JobSystem::JobCounter* pDependency = NULL;
+				if (i > 0)
+				{
+					pDependency = &counters[i - 1];
+				}
+				jobSystem.Submit(&EmptyJob, NULL, 0, 1, &counters[i], pDependency);
+			}
+			jobSystem.Wait(&counters[CHAIN_LENGTH - 1]);
+			double elapsed = ElapsedNs(start, Clock::now());
+			if (elapsed < bestNs)
+			{
+				bestNs = elapsed;
+			}
+		}
+
+		return(bestNs / CHAIN_LENGTH);
+	}
+
+	/***********************************************************
+	 *  BenchScaling()
+	 *
+	 *  time to run the compute kernel over all the elements
+	 ***********************************************************/
+	double BenchScaling(JobSystem& jobSystem, std::vector<float>& values)
+	{
+		float* pValues = values.data();
+		double bestNs = 1.0e30;
+
+		for (int run = 0; run < REPEAT_COUNT; run++)
+		{
+			Clock::time_point start = Clock::now();
+			jobSystem.ParallelFor(SCALING_ELEMENT_COUNT, 1024, [pValues](int begin, int end)
+			{
+				Kernel(pValues, begin, end);
+			});
+			double elapsed = ElapsedNs(start, Clock::now());
+			if (elapsed < bestNs)
+			{
+				bestNs = elapsed;
+			}
+		}
+		g_Sink = values[SCALING_ELEMENT_COUNT / 2];
+
+		return(bestNs);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Runs the overhead measurements with one worker and with
+ *  all workers, then the scaling table.  An optional argument
+ *  caps the largest worker count.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	int maxWorkers = (int)std::thread::hardware_concurrency();
+	if (argc > 1)
+	{
+		maxWorkers = atoi(argv[1]);
+	}
+	if (maxWorkers < 1)
+	{
+		maxWorkers = 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "Scheduling overhead" << std::endl;
+	std::cout << "workers  submit ns/job  for(grain 1) ns/range  for(grain 64) ns/range  chain ns/link" << std::endl;
+
+	int overheadWorkers[2] = { 1, maxWorkers };
+	for (int i = 0; i < ((maxWorkers > 1) ? 2 : 1); i++)
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(overheadWorkers[i]);
+		std::cout << std::setw(7) << overheadWorkers[i]
+			<< std::setw(15) << BenchSubmitOverhead(jobSystem)
+			<< std::setw(23) << BenchParallelForOverhead(jobSystem, 1)
+			<< std::setw(24) << BenchParallelForOverhead(jobSystem, 64)
+			<< std::setw(15) << BenchDependencyChain(jobSystem)
+			<< std::endl;
+	}
+
+	std::cout << std::endl << "Parallel for scaling (" << SCALING_ELEMENT_COUNT << " elements)" << std::endl;
+	std::cout << "workers      ms  speedup  efficiency  steals" << std::endl;
+
+	std::vector<float> values(SCALING_ELEMENT_COUNT);
+	double singleWorkerNs = 0.0;
+	for (int workers = 1; workers <= maxWorkers; workers = (workers < maxWorkers && workers * 2 > maxWorkers) ? maxWorkers : workers * 2)
+	{
+		JobSystem jobSystem;
+		jobSystem.Initialize(workers);
+		jobSystem.ResetStats();
+
+		double elapsedNs = BenchScaling(jobSystem, values);
+		if (workers == 1)
+		{
+			singleWorkerNs = elapsedNs;
+		}
+		double speedup = singleWorkerNs / elapsedNs;
+
+		std::cout << std::setw(7) << workers
+			<< std::setw(8) << elapsedNs / 1.0e6
+			<< std::setw(9) << speedup
+			<< std::setw(11) << 100.0 * speedup / workers << "%"
+			<< std::setw(8) << jobSystem.GetStats().jobsStolen / REPEAT_COUNT
+			<< std::endl;
+
+		if (workers == maxWorkers)
+		{
+			break;
+		}
+	}
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,331 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimportbench.cpp
+// ============
+// benchmarks for the mesh importer - number parsing, and OBJ and GLB import
+// throughput in MB/s from one worker up to one worker per core
+//
+//  build: g++ -O2 -std=c++14 -pthread -I../Source MeshImportBench.cpp ../Source/MeshImporter.cpp
+//         ../Source/JsonReader.cpp ../Source/MappedFile.cpp ../Source/JobSystem.cpp
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// each measurement is repeated and the fastest run is kept
+	const int REPEAT_COUNT = 5;
+	// the test mesh is a grid of this many quads on a side
+	const int GRID_SIZE = 700;
+	// number of values in the number parsing measurement
+	const int NUMBER_COUNT = 1 << 20;
+
+	// result sink that keeps the parsing from being optimized away
+	volatile float g_Sink = 0.0f;
+
+	/***********************************************************
+	 *  ElapsedMs()
+	 *
+	 *  milliseconds between two clock readings
+	 ***********************************************************/
+	double ElapsedMs(Clock::time_point start, Clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	/***********************************************************
+	 *  GridPosition()
+	 *
+	 *  position of a grid point on a gently rolling surface, so
+	 *  the numbers have the spread of real mesh data
+	 ***********************************************************/
+	void GridPosition(int x, int y, float* pPosition)
+	{
+		pPosition[0] = (x * 0.01f) - 3.5f;
+		pPosition[1] = 0.25f * sinf(x * 0.05f) * cosf(y * 0.07f);
+		pPosition[2] = (y * 0.01f) - 3.5f;
+	}
+
+	/***********************************************************
+	 *  WriteOBJ()
+	 *
+	 *  write the grid as an OBJ file of positions, texture
+	 *  coordinates, normals and quads, as exporters write them
+	 ***********************************************************/
+	size_t WriteOBJ(const char* filename)
+	{
+		FILE* pFile = fopen(filename, "wb");
+		if (NULL == pFile)
+		{
+			return(0);
+		}
+
+		fprintf(pFile, "# %dx%d grid\no grid\n", GRID_SIZE, GRID_SIZE);
+		for (int y = 0; y <= GRID_SIZE; y++)
+		{
+			for (int x = 0; x <= GRID_SIZE; x++)
+			{
+				float position[3];
+				GridPosition(x, y, position);
+				fprintf(pFile, "v %.6f %.6f %.6f\n", position[0], position[1], position[2]);
+			}
+		}
+		for (int y = 0; y <= GRID_SIZE; y++)
+		{
+			for (int x = 0; x <= GRID_SIZE; x++)
+			{
+				fprintf(pFile, "vt %.6f %.6f\n", x / (float)GRID_SIZE, y / (float)GRID_SIZE);
+			}
+		}
+		fprintf(pFile, "vn 0.0000 1.0000 0.0000\n");
+		for (int y = 0; y < GRID_SIZE; y++)
+		{
+			for (int x = 0; x < GRID_SIZE; x++)
+			{
+				int corner = (y * (GRID_SIZE + 1)) + x + 1;
+				int above = corner + GRID_SIZE + 1;
+				fprintf(pFile, "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n",
+					corner, corner, above, above, above + 1, above + 1, corner + 1, corner + 1);
+			}
+		}
+
+		size_t size = (size_t)ftell(pFile);
+		fclose(pFile);
+		return(size);
+	}
+
+	/***********************************************************
+	 *  WriteGLB()
+	 *
+	 *  write the same grid as a GLB file with interleaved
+	 *  positions and texture coordinates and 32-bit indexes
+	 ***********************************************************/
+	size_t WriteGLB(const char* filename)
+	{
+		int vertexCount = (GRID_SIZE + 1) * (GRID_SIZE + 1);
+		std::vector<float> vertices;
+		std::vector<uint32_t> indices;
+		for (int y = 0; y <= GRID_SIZE; y++)
+		{
+			for (int x = 0; x <= GRID_SIZE; x++)
+			{
+				float position[3];
+				GridPosition(x, y, position);
+				vertices.insert(vertices.end(), position, position + 3);
+				vertices.push_back(x / (float)GRID_SIZE);
+				vertices.push_back(y / (float)GRID_SIZE);
+			}
+		}
+		for (int y = 0; y < GRID_SIZE; y++)
+		{
+			for (int x = 0; x < GRID_SIZE; x++)
+			{
+				uint32_t corner = (uint32_t)((y * (GRID_SIZE + 1)) + x);
+				uint32_t above = corner + GRID_SIZE + 1;
+				uint32_t quad[6] = { corner, above, above + 1, corner, above + 1, corner + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+
+		size_t vertexBytes = vertices.size() * sizeof(float);
+		size_t indexBytes = indices.size() * sizeof(uint32_t);
+		char json[1024];
+		snprintf(json, sizeof(json),
+			"{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+			"\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"TEXCOORD_0\":1},\"indices\":2}]}],"
+			"\"accessors\":["
+			"{\"bufferView\":0,\"componentType\":5126,\"count\":%d,\"type\":\"VEC3\"},"
+			"{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,\"count\":%d,\"type\":\"VEC2\"},"
+			"{\"bufferView\":1,\"componentType\":5125,\"count\":%d,\"type\":\"SCALAR\"}],"
+			"\"bufferViews\":[{\"buffer\":0,\"byteLength\":%zu,\"byteStride\":20},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu}],"
+			"\"buffers\":[{\"byteLength\":%zu}]}",
+			vertexCount, vertexCount, (int)indices.size(),
+			vertexBytes, vertexBytes, indexBytes, vertexBytes + indexBytes);
+
+		// chunks are padded to four bytes, the JSON with spaces
+		std::string jsonChunk(json);
+		while ((jsonChunk.size() % 4) != 0)
+		{
+			jsonChunk.push_back(' ');
+		}
+		uint32_t jsonHeader[2] = { (uint32_t)jsonChunk.size(), 0x4E4F534A };
+		uint32_t binHeader[2] = { (uint32_t)(vertexBytes + indexBytes), 0x004E4942 };
+		uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + jsonChunk.size() + 8 + vertexBytes + indexBytes) };
+
+		FILE* pFile = fopen(filename, "wb");
+		if (NULL == pFile)
+		{
+			return(0);
+		}
+		fwrite(header, sizeof(header), 1, pFile);
+		fwrite(jsonHeader, sizeof(jsonHeader), 1, pFile);
+		fwrite(jsonChunk.data(), jsonChunk.size(), 1, pFile);
+		fwrite(binHeader, sizeof(binHeader), 1, pFile);
+		fwrite(&vertices[0], vertexBytes, 1, pFile);
+		fwrite(&indices[0], indexBytes, 1, pFile);
+		fclose(pFile);
+
+		return((size_t)header[2]);
+	}
+
+	/***********************************************************
+	 *  BenchNumbers()
+	 *
+	 *  nanoseconds per number for the importer's parser and for
+	 *  strtod on the same text
+	 ***********************************************************/
+	void BenchNumbers(double& parseNs, double& strtodNs)
+	{
+		std::string text;
+		char number[32];
+		srand(1);
+		for (int i = 0; i < NUMBER_COUNT; i++)
+		{
+			snprintf(number, sizeof(number), "%.6f ", ((rand() / (float)RAND_MAX) - 0.5f) * 200.0f);
+			text.append(number);
+		}
+		const char* pEnd = text.data() + text.size();
+
+		parseNs = 1e30;
+		strtodNs = 1e30;
+		for (int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			float sum = 0.0f;
+			Clock::time_point start = Clock::now();
+			for (const char* pText = text.data(); pText < pEnd; pText++)
+			{
+				float value = 0.0f;
+				MeshImporter::ParseFloat(pText, pEnd, value);
+				sum += value;
+			}
+			Clock::time_point middle = Clock::now();
+			for (const char* pText = text.data(); pText < pEnd; pText++)
+			{
+				char* pNext = NULL;
+				sum += (float)strtod(pText, &pNext);
+				pText = pNext;
+			}
+			Clock::time_point end = Clock::now();
+			g_Sink = sum;
+
+			parseNs = std::min(parseNs, (ElapsedMs(start, middle) * 1e6) / NUMBER_COUNT);
+			strtodNs = std::min(strtodNs, (ElapsedMs(middle, end) * 1e6) / NUMBER_COUNT);
+		}
+	}
+
+	/***********************************************************
+	 *  BenchImport()
+	 *
+	 *  fastest import of a file, with its parse and merge split
+	 ***********************************************************/
+	bool BenchImport(const char* filename, JobSystem* pJobSystem, MeshImporter::IMPORT_STATS& best)
+	{
+		memset(&best, 0, sizeof(best));
+		best.parseMs = 1e30;
+		for (int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			SHAPE_GEOMETRY geometry;
+			MeshImporter::IMPORT_STATS stats;
+			memset(&stats, 0, sizeof(stats));
+			if (MeshImporter::ImportMesh(filename, geometry, pJobSystem, &stats) == false)
+			{
+				return(false);
+			}
+			if ((stats.parseMs + stats.mergeMs) < (best.parseMs + best.mergeMs))
+			{
+				best = stats;
+			}
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  main()
+ *
+ *  generate the test files, then import them with a growing
+ *  number of workers.  The first argument sets the largest
+ *  number of workers, the second the directory for the files.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	int maxWorkers = (int)std::thread::hardware_concurrency();
+	if (argc > 1)
+	{
+		maxWorkers = atoi(argv[1]);
+	}
+	if (maxWorkers < 1)
+	{
+		maxWorkers = 1;
+	}
+	std::string directory = (argc > 2) ? std::string(argv[2]) + "/" : std::string();
+	std::string objFilename = directory + "meshimportbench.obj";
+	std::string glbFilename = directory + "meshimportbench.glb";
+
+	std::cout << std::fixed << std::setprecision(1);
+	double parseNs = 0.0;
+	double strtodNs = 0.0;
+	BenchNumbers(parseNs, strtodNs);
+	std::cout << "Number parsing (" << NUMBER_COUNT << " values)" << std::endl;
+	std::cout << "ParseFloat " << parseNs << " ns/value, strtod " << strtodNs << " ns/value" << std::endl << std::endl;
+
+	const char* filenames[2] = { objFilename.c_str(), glbFilename.c_str() };
+	size_t sizes[2] = { WriteOBJ(filenames[0]), WriteGLB(filenames[1]) };
+	if ((sizes[0] == 0) || (sizes[1] == 0))
+	{
+		std::cout << "ERROR: Could not write the test files" << std::endl;
+		return(1);
+	}
+
+	for (int file = 0; file < 2; file++)
+	{
+		std::cout << "Import " << filenames[file] << " (" << (sizes[file] / (1024.0 * 1024.0)) << " MB)" << std::endl;
+		std::cout << "workers  parse ms  merge ms     MB/s  speedup  vertices  triangles" << std::endl;
+
+		double singleWorkerMs = 0.0;
+		for (int workers = 1; workers <= maxWorkers; workers = (workers < maxWorkers && workers * 2 > maxWorkers) ? maxWorkers : workers * 2)
+		{
+			JobSystem jobSystem;
+			jobSystem.Initialize(workers);
+
+			MeshImporter::IMPORT_STATS stats;
+			if (BenchImport(filenames[file], &jobSystem, stats) == false)
+			{
+				return(1);
+			}
+			double totalMs = stats.parseMs + stats.mergeMs;
+			if (workers == 1)
+			{
+				singleWorkerMs = totalMs;
+			}
+
+			std::cout << std::setw(7) << workers
+				<< std::setw(10) << stats.parseMs
+				<< std::setw(10) << stats.mergeMs
+				<< std::setw(9) << ((stats.fileBytes / (1024.0 * 1024.0)) / (totalMs / 1000.0))
+				<< std::setw(8) << (singleWorkerMs / totalMs) << "x"
+				<< std::setw(10) << stats.vertexCount
+				<< std::setw(11) << stats.triangleCount
+				<< std::endl;
+		}
+		std::cout << std::endl;
+	}
+
+	remove(filenames[0]);
+	remove(filenames[1]);
+	return(0);
+}
@@ -0,0 +1,632 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendererbench.cpp
+// ============
+// microbenchmarks for the CPU hot paths of the renderer - transform
+// composition, texture and material lookup by tag, view and projection
+// building and light uniform packing - in ns/op and allocations per op,
+// compared against a saved baseline
+//
+//  build: g++ -O2 -std=c++14 -pthread -I../Source RendererBench.cpp ../Source/RenderQueue.cpp
+//         ../Source/FrameArena.cpp ../Source/JobSystem.cpp ../Source/SceneView.cpp
+//         ../Source/LightUniforms.cpp ../Source/JsonReader.cpp ../Source/AllocationCounter.cpp
+//  or:    cmake -S . -B build && cmake --build build --target RendererBench
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+#include "SceneLookup.h"
+#include "SceneView.h"
+#include "LightUniforms.h"
+#include "JsonReader.h"
+#include "AllocationCounter.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// each measurement is repeated and the fastest run is kept
+	const int REPEAT_COUNT = 7;
+	// seed of every random input, so runs can be compared
+	const unsigned int RANDOM_SEED = 12345;
+	// number of objects composed per run
+	const int OBJECT_COUNT = 1 << 16;
+	// longest parent chain of the world transform objects
+	const int MAX_PARENT_DEPTH = 4;
+	// lookups per run, and the share of tags that are not found
+	const int LOOKUP_COUNT = 1 << 16;
+	const float LOOKUP_MISS_RATE = 0.1f;
+	// records searched, as loaded by the scene manager
+	const int TEXTURE_COUNT = 16;
+	const int MATERIAL_COUNT = 32;
+	// views built and light states packed per run
+	const int VIEW_COUNT = 1 << 16;
+	const int PACK_COUNT = 1 << 12;
+	// slowdown in percent reported as a regression by default
+	const double DEFAULT_THRESHOLD = 10.0;
+
+	// result sink that keeps the kernels from being optimized away
+	volatile float g_Sink = 0.0f;
+
+	// records searched by tag, laid out like the scene manager's
+	struct TEXTURE_RECORD
+	{
+		std::string tag;
+		uint32_t ID;
+		int layer;
+	};
+
+	struct MATERIAL_RECORD
+	{
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		std::string tag;
+	};
+
+	struct BENCH_RESULT
+	{
+		std::string name;
+		double nsPerOp;
+		double allocsPerOp;
+	};
+
+	/***********************************************************
+	 *  ElapsedNs()
+	 *
+	 *  nanoseconds between two clock readings
+	 ***********************************************************/
+	double ElapsedNs(Clock::time_point start, Clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::nano>(end - start).count());
+	}
+
+	/***********************************************************
+	 *  RandomFloat()
+	 *
+	 *  uniform random value in a range
+	 ***********************************************************/
+	float RandomFloat(std::mt19937& random, float low, float high)
+	{
+		std::uniform_real_distribution<float> distribution(low, high);
+		return(distribution(random));
+	}
+
+	/***********************************************************
+	 *  RandomVec3()
+	 *
+	 *  vector with uniform random components in a range
+	 ***********************************************************/
+	glm::vec3 RandomVec3(std::mt19937& random, float low, float high)
+	{
+		return(glm::vec3(
+			RandomFloat(random, low, high),
+			RandomFloat(random, low, high),
+			RandomFloat(random, low, high)));
+	}
+
+	/***********************************************************
+	 *  Measure()
+	 *
+	 *  run a benchmark body a number of times, keep the fastest
+	 *  run and count the allocations of all of them.  The body
+	 *  runs once first so containers reach their size.
+	 ***********************************************************/
+	template<typename BODY>
+	BENCH_RESULT Measure(const char* name, int opsPerRun, BODY body)
+	{
+		body();
+
+		double bestNs = 1.0e30;
+		uint64_t allocations = 0;
+		for (int run = 0; run < REPEAT_COUNT; run++)
+		{
+			uint64_t allocationsBefore = AllocationCounter::GetAllocationCount();
+			Clock::time_point start = Clock::now();
+			body();
+			double elapsed = ElapsedNs(start, Clock::now());
+			allocations += AllocationCounter::GetAllocationCount() - allocationsBefore;
+			if (elapsed < bestNs)
+			{
+				bestNs = elapsed;
+			}
+		}
+
+		BENCH_RESULT result;
+		result.name = name;
+		result.nsPerOp = bestNs / opsPerRun;
+		result.allocsPerOp = (double)allocations / ((double)REPEAT_COUNT * opsPerRun);
+		return(result);
+	}
+
+	/***********************************************************
+	 *  CreateObjects()
+	 *
+	 *  random scene objects, each with a chance of a parent
+	 *  among the objects before it, up to the chain depth
+	 ***********************************************************/
+	void CreateObjects(std::mt19937& random, std::vector<SCENE_OBJECT>& objects)
+	{
+		objects.resize(OBJECT_COUNT);
+		std::vector<int> depths(OBJECT_COUNT, 0);
+		for (int i = 0; i < OBJECT_COUNT; i++)
+		{
+			SCENE_OBJECT& object = objects[i];
+			object = SCENE_OBJECT();
+			object.scaleXYZ = RandomVec3(random, 0.1f, 4.0f);
+			object.rotationDegrees = RandomVec3(random, -180.0f, 180.0f);
+			object.positionXYZ = RandomVec3(random, -50.0f, 50.0f);
+			object.uvScale = glm::vec2(1.0f, 1.0f);
+			object.parentIndex = -1;
+			object.batchGroup = -1;
+
+			// a nearby parent, as the children of a scene file
+			// follow the object they are attached to
+			if ((i > 0) && (RandomFloat(random, 0.0f, 1.0f) < 0.5f))
+			{
+				int parent = i - 1 - (int)(random() % (uint32_t)((i < 8) ? i : 8));
+				if (depths[parent] < MAX_PARENT_DEPTH)
+				{
+					object.parentIndex = parent;
+					depths[i] = depths[parent] + 1;
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  CreateLookupTags()
+	 *
+	 *  tags to look up, picked from the record tags with a share
+	 *  of tags that are not found
+	 ***********************************************************/
+	void CreateLookupTags(
+		std::mt19937& random,
+		const char* prefix,
+		int recordCount,
+		std::vector<std::string>& tags)
+	{
+		tags.resize(LOOKUP_COUNT);
+		for (int i = 0; i < LOOKUP_COUNT; i++)
+		{
+			char tag[32];
+			if (RandomFloat(random, 0.0f, 1.0f) < LOOKUP_MISS_RATE)
+			{
+				snprintf(tag, sizeof(tag), "missing_%s", prefix);
+			}
+			else
+			{
+				snprintf(tag, sizeof(tag), "%s_%02d", prefix, (int)(random() % (uint32_t)recordCount));
+			}
+			tags[i] = tag;
+		}
+	}
+
+	/***********************************************************
+	 *  FindTextureSlot()
+	 *
+	 *  the texture lookup as the scene manager calls it, with
+	 *  the tag passed by value
+	 ***********************************************************/
+	int FindTextureSlot(const std::vector<TEXTURE_RECORD>& textures, std::string tag)
+	{
+		return(FindTagIndex(textures.data(), (int)textures.size(), tag));
+	}
+
+	/***********************************************************
+	 *  FindMaterial()
+	 *
+	 *  the material lookup as the scene manager calls it, with
+	 *  the tag passed by value and the material copied out
+	 ***********************************************************/
+	bool FindMaterial(
+		const std::vector<MATERIAL_RECORD>& materials,
+		std::string tag,
+		MATERIAL_RECORD& material)
+	{
+		int index = FindTagIndex(materials.data(), (int)materials.size(), tag);
+		if (index < 0)
+		{
+			return(false);
+		}
+
+		material = materials[index];
+		return(true);
+	}
+
+	/***********************************************************
+	 *  CreateLightState()
+	 *
+	 *  light state with every light active, like the scene's
+	 ***********************************************************/
+	void CreateLightState(std::mt19937& random, LIGHT_STATE& lights)
+	{
+		lights.bUseLighting = true;
+		lights.directionalLight.direction = RandomVec3(random, -1.0f, 1.0f);
+		lights.directionalLight.ambient = RandomVec3(random, 0.0f, 0.2f);
+		lights.directionalLight.diffuse = RandomVec3(random, 0.0f, 1.0f);
+		lights.directionalLight.specular = RandomVec3(random, 0.0f, 1.0f);
+		lights.directionalLight.bActive = true;
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			POINT_LIGHT& light = lights.pointLights[i];
+			light.position = RandomVec3(random, -20.0f, 20.0f);
+			light.ambient = RandomVec3(random, 0.0f, 0.2f);
+			light.diffuse = RandomVec3(random, 0.0f, 1.0f);
+			light.specular = RandomVec3(random, 0.0f, 1.0f);
+			light.constant = 1.0f;
+			light.linear = 0.09f;
+			light.quadratic = 0.032f;
+			light.bActive = true;
+		}
+		lights.spotLight.position = RandomVec3(random, -20.0f, 20.0f);
+		lights.spotLight.direction = RandomVec3(random, -1.0f, 1.0f);
+		lights.spotLight.ambient = RandomVec3(random, 0.0f, 0.2f);
+		lights.spotLight.diffuse = RandomVec3(random, 0.0f, 1.0f);
+		lights.spotLight.specular = RandomVec3(random, 0.0f, 1.0f);
+		lights.spotLight.constant = 1.0f;
+		lights.spotLight.linear = 0.09f;
+		lights.spotLight.quadratic = 0.032f;
+		lights.spotLight.cutOff = 0.97f;
+		lights.spotLight.outerCutOff = 0.95f;
+		lights.spotLight.bActive = true;
+	}
+
+	/***********************************************************
+	 *  CreateCameras()
+	 *
+	 *  random cameras of one projection mode
+	 ***********************************************************/
+	void CreateCameras(
+		std::mt19937& random,
+		bool bOrthographic,
+		std::vector<SceneView::CAMERA_VIEW>& cameras)
+	{
+		cameras.resize(VIEW_COUNT);
+		for (int i = 0; i < VIEW_COUNT; i++)
+		{
+			SceneView::CAMERA_VIEW& camera = cameras[i];
+			camera.position = RandomVec3(random, -20.0f, 20.0f);
+			camera.previousPosition = camera.position + RandomVec3(random, -0.1f, 0.1f);
+			camera.front = glm::normalize(RandomVec3(random, -1.0f, 1.0f) + glm::vec3(0.0f, 0.0f, -2.0f));
+			camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+			camera.zoom = RandomFloat(random, 30.0f, 80.0f);
+			camera.bOrthographic = bOrthographic;
+			camera.aspectRatio = RandomFloat(random, 1.0f, 2.0f);
+		}
+	}
+
+	/***********************************************************
+	 *  RunBenchmarks()
+	 *
+	 *  run every benchmark, each with its own inputs from the
+	 *  fixed seed
+	 ***********************************************************/
+	void RunBenchmarks(std::vector<BENCH_RESULT>& results)
+	{
+		std::mt19937 random(RANDOM_SEED);
+
+		std::vector<SCENE_OBJECT> objects;
+		CreateObjects(random, objects);
+		const SCENE_OBJECT* pObjects = objects.data();
+
+		results.push_back(Measure("compose_transform", OBJECT_COUNT, [pObjects]()
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < OBJECT_COUNT; i++)
+			{
+				glm::mat4 model = RenderQueue::ComposeTransform(
+					pObjects[i].scaleXYZ,
+					pObjects[i].rotationDegrees,
+					pObjects[i].positionXYZ);
+				sum += model[3][0];
+			}
+			g_Sink = sum;
+		}));
+
+		results.push_back(Measure("compose_world_transform", OBJECT_COUNT, [pObjects]()
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < OBJECT_COUNT; i++)
+			{
+				glm::mat4 model = RenderQueue::ComposeWorldTransform(pObjects, i);
+				sum += model[3][0];
+			}
+			g_Sink = sum;
+		}));
+
+		std::vector<TEXTURE_RECORD> textures(TEXTURE_COUNT);
+		for (int i = 0; i < TEXTURE_COUNT; i++)
+		{
+			char tag[32];
+			snprintf(tag, sizeof(tag), "texture_%02d", i);
+			textures[i].tag = tag;
+			textures[i].ID = 1;
+			textures[i].layer = i;
+		}
+		std::vector<std::string> textureTags;
+		CreateLookupTags(random, "texture", TEXTURE_COUNT, textureTags);
+
+		results.push_back(Measure("find_texture_slot", LOOKUP_COUNT, [&textures, &textureTags]()
+		{
+			int sum = 0;
+			for (int i = 0; i < LOOKUP_COUNT; i++)
+			{
+				sum += FindTextureSlot(textures, textureTags[i]);
+			}
+			g_Sink = (float)sum;
+		}));
+
+		std::vector<MATERIAL_RECORD> materials(MATERIAL_COUNT);
+		for (int i = 0; i < MATERIAL_COUNT; i++)
+		{
+			char tag[32];
+			snprintf(tag, sizeof(tag), "material_%02d", i);
+			materials[i].diffuseColor = RandomVec3(random, 0.0f, 1.0f);
+			materials[i].specularColor = RandomVec3(random, 0.0f, 1.0f);
+			materials[i].shininess = RandomFloat(random, 1.0f, 64.0f);
+			materials[i].tag = tag;
+		}
+		std::vector<std::string> materialTags;
+		CreateLookupTags(random, "material", MATERIAL_COUNT, materialTags);
+
+		results.push_back(Measure("find_material", LOOKUP_COUNT, [&materials, &materialTags]()
+		{
+			MATERIAL_RECORD material;
+			float sum = 0.0f;
+			for (int i = 0; i < LOOKUP_COUNT; i++)
+			{
+				if (FindMaterial(materials, materialTags[i], material))
+				{
+					sum += material.shininess;
+				}
+			}
+			g_Sink = sum;
+		}));
+
+		for (int mode = 0; mode < 2; mode++)
+		{
+			std::vector<SceneView::CAMERA_VIEW> cameras;
+			CreateCameras(random, (mode == 1), cameras);
+			const SceneView::CAMERA_VIEW* pCameras = cameras.data();
+
+			results.push_back(Measure((mode == 1) ? "scene_view_orthographic" : "scene_view_perspective", VIEW_COUNT, [pCameras]()
+			{
+				glm::mat4 view;
+				glm::mat4 projection;
+				glm::vec3 viewPosition;
+				float sum = 0.0f;
+				for (int i = 0; i < VIEW_COUNT; i++)
+				{
+					SceneView::Compute(pCameras[i], 0.5f, view, projection, viewPosition);
+					sum += view[3][2] + projection[0][0];
+				}
+				g_Sink = sum;
+			}));
+		}
+
+		LIGHT_STATE lights;
+		CreateLightState(random, lights);
+		std::vector<LightUniforms::LIGHT_UNIFORM> uniforms;
+
+		results.push_back(Measure("light_uniforms_pack", PACK_COUNT, [&lights, &uniforms]()
+		{
+			float sum = 0.0f;
+			for (int i = 0; i < PACK_COUNT; i++)
+			{
+				LightUniforms::Pack(lights, uniforms);
+				sum += uniforms.back().value.x;
+			}
+			g_Sink = sum;
+		}));
+	}
+
+	/***********************************************************
+	 *  SaveBaseline()
+	 *
+	 *  write the results to a baseline file
+	 ***********************************************************/
+	bool SaveBaseline(const char* filename, const std::vector<BENCH_RESULT>& results)
+	{
+		std::ofstream file(filename);
+		if (!file)
+		{
+			std::cout << "ERROR: could not write baseline " << filename << std::endl;
+			return(false);
+		}
+
+		file << std::setprecision(6) << "{" << std::endl << "\t\"benchmarks\": [" << std::endl;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			file << "\t\t{ \"name\": \"" << results[i].name
+				<< "\", \"ns_per_op\": " << results[i].nsPerOp
+				<< ", \"allocs_per_op\": " << results[i].allocsPerOp << " }"
+				<< ((i + 1 < results.size()) ? "," : "") << std::endl;
+		}
+		file << "\t]" << std::endl << "}" << std::endl;
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  LoadBaseline()
+	 *
+	 *  read the results of a baseline file
+	 ***********************************************************/
+	bool LoadBaseline(const char* filename, std::vector<BENCH_RESULT>& baseline)
+	{
+		std::ifstream file(filename);
+		if (!file)
+		{
+			std::cout << "ERROR: could not open baseline " << filename << std::endl;
+			return(false);
+		}
+		std::stringstream contents;
+		contents << file.rdbuf();
+		std::string text = contents.str();
+
+		JsonReader reader;
+		if (!reader.Parse(text.c_str(), text.size()))
+		{
+			std::cout << "ERROR: baseline " << filename << " is not valid JSON at offset "
+				<< reader.GetErrorOffset() << std::endl;
+			return(false);
+		}
+
+		int benchmarks = reader.FindMember(reader.GetRoot(), "benchmarks");
+		if (reader.GetType(benchmarks) != JsonReader::JSON_ARRAY)
+		{
+			std::cout << "ERROR: baseline " << filename << " has no benchmarks array" << std::endl;
+			return(false);
+		}
+
+		for (int i = 0; i < reader.GetCount(benchmarks); i++)
+		{
+			int entry = reader.GetElement(benchmarks, i);
+			BENCH_RESULT result;
+			result.name = reader.GetString(reader.FindMember(entry, "name"));
+			result.nsPerOp = reader.GetNumber(reader.FindMember(entry, "ns_per_op"), 0.0);
+			result.allocsPerOp = reader.GetNumber(reader.FindMember(entry, "allocs_per_op"), 0.0);
+			baseline.push_back(result);
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  FindResult()
+	 *
+	 *  result of a benchmark by name, NULL when it is missing
+	 ***********************************************************/
+	const BENCH_RESULT* FindResult(const std::vector<BENCH_RESULT>& results, const std::string& name)
+	{
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			if (results[i].name == name)
+			{
+				return(&results[i]);
+			}
+		}
+
+		return(NULL);
+	}
+}
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  Runs the benchmarks and prints their table.  Options:
+ *
+ *      --baseline=FILE       compare with a saved baseline
+ *      --save-baseline=FILE  save the results as a baseline
+ *      --threshold=PCT       slowdown reported as a regression
+ *
+ *  Exits with a failure when a benchmark is slower than the
+ *  baseline by more than the threshold, or allocates more.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	const char* baselineFile = NULL;
+	const char* saveFile = NULL;
+	double threshold = DEFAULT_THRESHOLD;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--baseline=", 11) == 0)
+		{
+			baselineFile = argv[i] + 11;
+		}
+		else if (strncmp(argv[i], "--save-baseline=", 16) == 0)
+		{
+			saveFile = argv[i] + 16;
+		}
+		else if (strncmp(argv[i], "--threshold=", 12) == 0)
+		{
+			threshold = atof(argv[i] + 12);
+		}
+		else
+		{
+			std::cout << "ERROR: unknown option " << argv[i] << std::endl;
+			std::cout << "usage: RendererBench [--baseline=FILE] [--save-baseline=FILE] [--threshold=PCT]" << std::endl;
+			return(EXIT_FAILURE);
+		}
+	}
+
+	std::vector<BENCH_RESULT> baseline;
+	if ((baselineFile != NULL) && !LoadBaseline(baselineFile, baseline))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	std::vector<BENCH_RESULT> results;
+	RunBenchmarks(results);
+
+	int regressions = 0;
+	std::cout << std::fixed;
+	std::cout << "benchmark                    ns/op  allocs/op";
+	if (baselineFile != NULL)
+	{
+		std::cout << "  base ns/op   change";
+	}
+	std::cout << std::endl;
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BENCH_RESULT& result = results[i];
+		std::cout << std::left << std::setw(24) << result.name << std::right
+			<< std::setprecision(1) << std::setw(11) << result.nsPerOp
+			<< std::setprecision(2) << std::setw(11) << result.allocsPerOp;
+
+		if (baselineFile != NULL)
+		{
+			const BENCH_RESULT* pBase = FindResult(baseline, result.name);
+			if ((pBase == NULL) || (pBase->nsPerOp <= 0.0))
+			{
+				std::cout << "         new";
+			}
+			else
+			{
+				double change = 100.0 * (result.nsPerOp - pBase->nsPerOp) / pBase->nsPerOp;
+				std::cout << std::setprecision(1) << std::setw(12) << pBase->nsPerOp
+					<< std::setw(8) << std::showpos << change << std::noshowpos << "%";
+				if (change > threshold)
+				{
+					std::cout << "  REGRESSION";
+					regressions++;
+				}
+				else if (result.allocsPerOp > pBase->allocsPerOp + 0.005)
+				{
+					std::cout << "  MORE ALLOCATIONS";
+					regressions++;
+				}
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	if ((saveFile != NULL) && !SaveBaseline(saveFile, results))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	if (regressions > 0)
+	{
+		std::cout << "ERROR: " << regressions << " benchmark(s) regressed beyond "
+			<< std::setprecision(1) << threshold << "%" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	return(EXIT_SUCCESS);
+}
@@ -0,0 +1,257 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.cpp
+// ============
+// count the calls of the global operator new, per frame, so that a run can
+// check that its steady-state frames do not allocate from the heap
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// counted by the replaced operator new on every thread, so
+	// they are constant initialized before any allocation
+	std::atomic<uint64_t> g_AllocationCount(0);
+	std::atomic<uint64_t> g_AllocationBytes(0);
+
+	// state of the frame loop, only touched by the thread that
+	// runs it
+	uint64_t g_FrameStartCount = 0;
+	uint64_t g_SteadyStateFrame = 0;
+	// frames still to be left out of the steady-state check
+	int g_SkippedFrames = 0;
+	// frames and their allocations since the last report
+	uint64_t g_ReportFrames = 0;
+	uint64_t g_ReportAllocations = 0;
+	uint64_t g_ReportMaxAllocations = 0;
+	uint64_t g_ReportAllocatingFrames = 0;
+	// steady-state frames, those that allocated and the first of them
+	uint64_t g_SteadyStateFrames = 0;
+	uint64_t g_SteadyStateFailures = 0;
+	uint64_t g_FirstFailureFrame = 0;
+	uint64_t g_FirstFailureAllocations = 0;
+
+	void* CountedAllocate(std::size_t size)
+	{
+		g_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		g_AllocationBytes.fetch_add(size, std::memory_order_relaxed);
+		return(malloc((size > 0) ? size : 1));
+	}
+}
+
+/***********************************************************
+ *  operator new()
+ *
+ *  The replaced global allocation functions.  Each one counts
+ *  the call and allocates with malloc, and the deallocation
+ *  functions hand the memory back to free.
+ ***********************************************************/
+void* operator new(std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (NULL == pMemory)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	free(pMemory);
+}
+
+/***********************************************************
+ *  GetAllocationCount()
+ *
+ *  This method is used for getting the number of operator
+ *  new calls since the application started.
+ ***********************************************************/
+uint64_t AllocationCounter::GetAllocationCount()
+{
+	return(g_AllocationCount.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  GetAllocationBytes()
+ *
+ *  This method is used for getting the bytes requested from
+ *  operator new since the application started.
+ ***********************************************************/
+uint64_t AllocationCounter::GetAllocationBytes()
+{
+	return(g_AllocationBytes.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  SetSteadyStateFrame()
+ *
+ *  This method is used for setting the first frame that is
+ *  expected to run without allocating.  The frames before it
+ *  warm up the caches, pools and buffers of the draw path.
+ ***********************************************************/
+void AllocationCounter::SetSteadyStateFrame(uint64_t frameIndex)
+{
+	g_SteadyStateFrame = frameIndex;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for closing the count of a frame.  The
+ *  allocations since the last frame ended are the frame's,
+ *  and are added to the totals of the report, and to the
+ *  failures when the frame is past the steady-state frame.
+ ***********************************************************/
+void AllocationCounter::EndFrame(uint64_t frameIndex)
+{
+	uint64_t count = g_AllocationCount.load(std::memory_order_relaxed);
+	uint64_t allocations = count - g_FrameStartCount;
+	g_FrameStartCount = count;
+
+	g_ReportFrames++;
+	g_ReportAllocations += allocations;
+	g_ReportMaxAllocations = std::max(g_ReportMaxAllocations, allocations);
+	if (allocations > 0)
+	{
+		g_ReportAllocatingFrames++;
+	}
+
+	if (g_SkippedFrames > 0)
+	{
+		g_SkippedFrames--;
+		return;
+	}
+	if ((g_SteadyStateFrame == 0) || (frameIndex < g_SteadyStateFrame))
+	{
+		return;
+	}
+
+	g_SteadyStateFrames++;
+	if (allocations > 0)
+	{
+		if (g_SteadyStateFailures == 0)
+		{
+			g_FirstFailureFrame = frameIndex;
+			g_FirstFailureAllocations = allocations;
+		}
+		g_SteadyStateFailures++;
+	}
+}
+
+/***********************************************************
+ *  SkipFrames()
+ *
+ *  This method is used for leaving the frame being run and
+ *  the ones after it out of the steady-state check.  Their
+ *  allocations are still counted in the report.  Printing a
+ *  report formats text, which is allowed to allocate.
+ ***********************************************************/
+void AllocationCounter::SkipFrames(int frameCount)
+{
+	g_SkippedFrames = std::max(g_SkippedFrames, frameCount);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the allocations of the
+ *  frames since the last report, and restarting the totals.
+ ***********************************************************/
+void AllocationCounter::PrintStats()
+{
+	if (g_ReportFrames == 0)
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(1)
+		<< "ALLOCATIONS: " << ((double)g_ReportAllocations / g_ReportFrames) << " per frame"
+		<< ", max " << g_ReportMaxAllocations
+		<< ", " << g_ReportAllocatingFrames << " of " << g_ReportFrames << " frames allocated"
+		<< std::defaultfloat << std::endl;
+
+	g_ReportFrames = 0;
+	g_ReportAllocations = 0;
+	g_ReportMaxAllocations = 0;
+	g_ReportAllocatingFrames = 0;
+}
+
+/***********************************************************
+ *  CheckSteadyState()
+ *
+ *  This method is used for reporting whether the frames from
+ *  the steady-state frame on ran without allocating.
+ ***********************************************************/
+bool AllocationCounter::CheckSteadyState()
+{
+	if (g_SteadyStateFailures > 0)
+	{
+		std::cout << "ERROR: " << g_SteadyStateFailures << " steady-state frames allocated from the heap, the first "
+			<< "was frame " << g_FirstFailureFrame << " with " << g_FirstFailureAllocations << " allocations" << std::endl;
+		return(false);
+	}
+
+	if (g_SteadyStateFrames > 0)
+	{
+		std::cout << "INFO: " << g_SteadyStateFrames << " steady-state frames ran without heap allocations" << std::endl;
+	}
+	else if (g_SteadyStateFrame > 0)
+	{
+		std::cout << "INFO: The run ended before steady-state frame " << g_SteadyStateFrame << std::endl;
+	}
+	return(true);
+}
@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounter.h
+// ============
+// count the calls of the global operator new, per frame, so that a run can
+// check that its steady-state frames do not allocate from the heap
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+/***********************************************************
+ *  AllocationCounter
+ *
+ *  This class counts every call of the global operator new,
+ *  which this module replaces with a version that adds to an
+ *  atomic counter before it allocates.  The main loop closes
+ *  the count of each frame, so the statistics report shows
+ *  the allocations per frame.  Once a steady-state frame is
+ *  set, every later frame that allocated is noted, so a run
+ *  can fail when its frames are not free of allocations.
+ *  The counts are global: they take in the allocations of
+ *  every thread made while the frame ran.
+ ***********************************************************/
+class AllocationCounter
+{
+public:
+	// operator new calls and bytes requested since the start
+	static uint64_t GetAllocationCount();
+	static uint64_t GetAllocationBytes();
+
+	// frames from this one on are expected not to allocate, 0 to
+	// not check the frames
+	static void SetSteadyStateFrame(uint64_t frameIndex);
+	// close the count of a frame, on the thread running the loop
+	static void EndFrame(uint64_t frameIndex);
+	// leave the next frames out of the steady-state check, for
+	// frames that print reports
+	static void SkipFrames(int frameCount);
+
+	// print the allocations per frame since the last report
+	static void PrintStats();
+	// report the steady-state frames that allocated, returns false
+	// when there were any
+	static bool CheckSteadyState();
+};
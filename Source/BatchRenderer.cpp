@@ -0,0 +1,599 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.cpp
+// ============
+// render the scene from a list of camera poses into image files - offscreen
+// framebuffer, asynchronous readback through a ring of pixel buffers and
+// image encoding on the job system
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BatchRenderer.h"
+#include "ImageWriter.h"
+#include "MemoryTracker.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// pixel buffers in the readback ring, unless the pose file
+	// sets another count
+	const int g_DefaultReadbackCount = 3;
+	const int g_MaxReadbackCount = 16;
+	const int g_MaxImageSize = 16384;
+	// encode buffers per worker, beyond those of the ring
+	const int g_EncodeBuffersPerWorker = 2;
+	// how long a fence wait blocks before it is tried again
+	const GLuint64 g_FenceTimeout = 1000000000;
+	// clip planes of the projections, as the view manager uses
+	const float g_PerspectiveNear = 0.1f;
+	const float g_PerspectiveFar = 100.0f;
+	const float g_OrthographicNear = -10.0f;
+	const float g_OrthographicFar = 20.0f;
+
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+}
+
+/***********************************************************
+ *  BatchRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BatchRenderer::BatchRenderer(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_width = 0;
+	m_height = 0;
+	m_readbackCount = g_DefaultReadbackCount;
+	m_framebufferID = 0;
+	m_colorTextureID = 0;
+	m_depthBufferID = 0;
+	m_nextEncodeBuffer = 0;
+	m_currentImage = -1;
+	m_stats = BATCH_STATS();
+	m_imagesWritten = 0;
+	m_encodeMicroseconds = 0;
+	m_bytesWritten = 0;
+}
+
+/***********************************************************
+ *  ~BatchRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BatchRenderer::~BatchRenderer()
+{
+	Destroy();
+	m_pJobSystem = NULL;
+}
+
+/***********************************************************
+ *  LoadPoses()
+ *
+ *  This method is used for reading a pose file.  Every line
+ *  holds a keyword and its values, and # starts a comment:
+ *
+ *      size WIDTH HEIGHT
+ *      readback_buffers COUNT
+ *      pose PX PY PZ  FX FY FZ  UX UY UZ  ZOOM perspective|orthographic
+ ***********************************************************/
+bool BatchRenderer::LoadPoses(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not open pose file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_poses.clear();
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		std::istringstream tokens(line);
+		std::string keyword;
+		if (!(tokens >> keyword))
+		{
+			continue;
+		}
+
+		std::string error;
+		if (keyword == "size")
+		{
+			if (!(tokens >> m_width >> m_height) ||
+				(m_width < 1) || (m_height < 1) ||
+				(m_width > g_MaxImageSize) || (m_height > g_MaxImageSize))
+			{
+				error = "expected size WIDTH HEIGHT";
+			}
+		}
+		else if (keyword == "readback_buffers")
+		{
+			if (!(tokens >> m_readbackCount) ||
+				(m_readbackCount < 1) || (m_readbackCount > g_MaxReadbackCount))
+			{
+				error = "expected a pixel buffer count from 1 to 16";
+			}
+		}
+		else if (keyword == "pose")
+		{
+			CAMERA_POSE pose;
+			std::string projection;
+			if (!(tokens >> pose.position.x >> pose.position.y >> pose.position.z
+				>> pose.front.x >> pose.front.y >> pose.front.z
+				>> pose.up.x >> pose.up.y >> pose.up.z
+				>> pose.zoom >> projection))
+			{
+				error = "expected pose POSITION FRONT UP ZOOM PROJECTION";
+			}
+			else if ((projection != "perspective") && (projection != "orthographic"))
+			{
+				error = "expected a perspective or orthographic projection";
+			}
+			else if ((glm::length(pose.front) == 0.0f) || (glm::length(pose.up) == 0.0f) || (pose.zoom <= 0.0f))
+			{
+				error = "expected a front and up direction and a zoom above zero";
+			}
+			else
+			{
+				pose.bOrthographic = (projection == "orthographic");
+				m_poses.push_back(pose);
+			}
+		}
+		else
+		{
+			error = "unknown keyword " + keyword;
+		}
+
+		if (error.empty() == false)
+		{
+			std::cout << "ERROR: " << filename << "(" << lineNumber << "): " << error << std::endl;
+			return(false);
+		}
+	}
+
+	if ((m_width == 0) || (m_poses.empty() == true))
+	{
+		std::cout << "ERROR: " << filename << ": expected an image size and at least one pose" << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Loaded " << m_poses.size() << " camera poses for "
+		<< m_width << "x" << m_height << " images" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the offscreen target the
+ *  poses are drawn into, the pixel buffers and timer queries
+ *  of the readback ring, and the buffers the images are
+ *  encoded from.
+ ***********************************************************/
+bool BatchRenderer::Initialize(const char* outputPrefix)
+{
+	Destroy();
+	m_outputPrefix = outputPrefix;
+
+	glGenTextures(1, &m_colorTextureID);
+	glBindTexture(GL_TEXTURE_2D, m_colorTextureID);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_width, m_height);
+	MemoryTracker::TrackTexture(m_colorTextureID, MemoryTracker::MEMORY_GPU_RENDER_TARGETS,
+		"batch color", GL_RGBA8, m_width, m_height, 1, 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBufferID);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBufferID);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_width, m_height);
+	MemoryTracker::TrackRenderbuffer(m_depthBufferID, MemoryTracker::MEMORY_GPU_RENDER_TARGETS,
+		"batch depth", GL_DEPTH_COMPONENT24, m_width, m_height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_framebufferID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTextureID, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBufferID);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: The batch render target is incomplete" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	size_t imageBytes = (size_t)m_width * m_height * 4;
+	m_readbacks.resize(m_readbackCount);
+	for (int i = 0; i < m_readbackCount; i++)
+	{
+		READBACK_SLOT& slot = m_readbacks[i];
+		glGenBuffers(1, &slot.bufferID);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+		glBufferData(GL_PIXEL_PACK_BUFFER, imageBytes, NULL, GL_STREAM_READ);
+		MemoryTracker::TrackBuffer(slot.bufferID, MemoryTracker::MEMORY_GPU_BUFFERS, "batch readback", imageBytes);
+		glGenQueries(1, &slot.queryID);
+		slot.fence = 0;
+		slot.imageIndex = -1;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	// enough buffers that every worker can encode while the ring
+	// fills the next ones
+	int workerCount = (NULL != m_pJobSystem) ? m_pJobSystem->GetWorkerCount() : 1;
+	int encodeCount = m_readbackCount + (workerCount * g_EncodeBuffersPerWorker);
+	for (int i = 0; i < encodeCount; i++)
+	{
+		ENCODE_BUFFER* pBuffer = new ENCODE_BUFFER();
+		pBuffer->pRenderer = this;
+		pBuffer->pixels.resize(imageBytes);
+		pBuffer->imageIndex = -1;
+		m_encodeBuffers.push_back(pBuffer);
+	}
+	m_nextEncodeBuffer = 0;
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_RENDERING,
+		"batch encode buffers", (size_t)encodeCount * imageBytes);
+
+	m_stats = BATCH_STATS();
+	m_imagesWritten = 0;
+	m_encodeMicroseconds = 0;
+	m_bytesWritten = 0;
+	m_startTime = std::chrono::steady_clock::now();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting for the encode jobs and
+ *  freeing the OpenGL objects.
+ ***********************************************************/
+void BatchRenderer::Destroy()
+{
+	for (size_t i = 0; i < m_encodeBuffers.size(); i++)
+	{
+		if (NULL != m_pJobSystem)
+		{
+			m_pJobSystem->Wait(&m_encodeBuffers[i]->counter);
+		}
+		delete m_encodeBuffers[i];
+	}
+	m_encodeBuffers.clear();
+	MemoryTracker::ReleaseHeap(this);
+
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		if (0 != m_readbacks[i].fence)
+		{
+			glDeleteSync(m_readbacks[i].fence);
+		}
+		glDeleteBuffers(1, &m_readbacks[i].bufferID);
+		MemoryTracker::ReleaseBuffer(m_readbacks[i].bufferID);
+		glDeleteQueries(1, &m_readbacks[i].queryID);
+	}
+	m_readbacks.clear();
+
+	if (0 != m_framebufferID)
+	{
+		glDeleteFramebuffers(1, &m_framebufferID);
+		m_framebufferID = 0;
+	}
+	if (0 != m_depthBufferID)
+	{
+		glDeleteRenderbuffers(1, &m_depthBufferID);
+		MemoryTracker::ReleaseRenderbuffer(m_depthBufferID);
+		m_depthBufferID = 0;
+	}
+	if (0 != m_colorTextureID)
+	{
+		glDeleteTextures(1, &m_colorTextureID);
+		MemoryTracker::ReleaseTexture(m_colorTextureID);
+		m_colorTextureID = 0;
+	}
+}
+
+/***********************************************************
+ *  GetPoseCount()
+ *
+ *  This method is used for getting the number of poses.
+ ***********************************************************/
+int BatchRenderer::GetPoseCount() const
+{
+	return((int)m_poses.size());
+}
+
+/***********************************************************
+ *  GetWidth()
+ *
+ *  This method is used for getting the width of the images.
+ ***********************************************************/
+int BatchRenderer::GetWidth() const
+{
+	return(m_width);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height of the images.
+ ***********************************************************/
+int BatchRenderer::GetHeight() const
+{
+	return(m_height);
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method is used for setting the camera of a snapshot
+ *  to a pose, the way the view manager sets it from the
+ *  camera, before the snapshot is recorded.
+ ***********************************************************/
+void BatchRenderer::SetCamera(int poseIndex, FRAME_SNAPSHOT& snapshot) const
+{
+	const CAMERA_POSE& pose = m_poses[poseIndex];
+	float aspectRatio = (float)m_width / (float)m_height;
+	if (pose.bOrthographic == true)
+	{
+		snapshot.projection = glm::ortho(
+			-pose.zoom * aspectRatio, pose.zoom * aspectRatio,
+			-pose.zoom, pose.zoom,
+			g_OrthographicNear, g_OrthographicFar);
+	}
+	else
+	{
+		snapshot.projection = glm::perspective(
+			glm::radians(pose.zoom),
+			aspectRatio,
+			g_PerspectiveNear,
+			g_PerspectiveFar);
+	}
+	snapshot.view = glm::lookAt(pose.position, pose.position + pose.front, pose.up);
+	snapshot.viewPosition = pose.position;
+	snapshot.framebufferWidth = m_width;
+	snapshot.framebufferHeight = m_height;
+}
+
+/***********************************************************
+ *  BeginImage()
+ *
+ *  This method is used for starting the image of a pose,
+ *  once it is recorded.  The pixel buffer the image will be
+ *  read into is retired first, if it still holds an earlier
+ *  image, then the offscreen target is bound and the GPU
+ *  time of the image measured.
+ ***********************************************************/
+void BatchRenderer::BeginImage(int poseIndex)
+{
+	m_currentImage = poseIndex;
+	READBACK_SLOT& slot = m_readbacks[poseIndex % m_readbackCount];
+	if (slot.imageIndex >= 0)
+	{
+		RetireReadback(slot);
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, slot.queryID);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+	glViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  EndImage()
+ *
+ *  This method is used for queueing the readback of the drawn
+ *  image into its pixel buffer.  With a pixel buffer bound,
+ *  glReadPixels only queues the copy, and the fence tells
+ *  when the GPU has finished it.
+ ***********************************************************/
+void BatchRenderer::EndImage()
+{
+	READBACK_SLOT& slot = m_readbacks[m_currentImage % m_readbackCount];
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glEndQuery(GL_TIME_ELAPSED);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.imageIndex = m_currentImage;
+	m_stats.imagesRendered++;
+	m_currentImage = -1;
+
+	// make sure the queued commands reach the GPU, so it works
+	// on them while the next pose is recorded
+	glFlush();
+}
+
+/***********************************************************
+ *  RetireReadback()
+ *
+ *  This method is used for copying the pixels of a finished
+ *  readback out of its pixel buffer and handing them to an
+ *  encode job.  By the time the ring comes back round to a
+ *  buffer the copy has usually finished, and any wait here
+ *  is counted as a readback stall.
+ ***********************************************************/
+void BatchRenderer::RetireReadback(READBACK_SLOT& slot)
+{
+	std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+	GLenum result = GL_TIMEOUT_EXPIRED;
+	while (result == GL_TIMEOUT_EXPIRED)
+	{
+		result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+	}
+	m_stats.readbackStallMs += ElapsedMs(waitStart, std::chrono::steady_clock::now());
+	glDeleteSync(slot.fence);
+	slot.fence = 0;
+
+	GLuint64 elapsedNs = 0;
+	glGetQueryObjectui64v(slot.queryID, GL_QUERY_RESULT, &elapsedNs);
+	m_stats.gpuBusyMs += elapsedNs / 1000000.0;
+
+	// take the next encode buffer, once its last job has finished
+	ENCODE_BUFFER* pBuffer = m_encodeBuffers[m_nextEncodeBuffer];
+	m_nextEncodeBuffer = (m_nextEncodeBuffer + 1) % (int)m_encodeBuffers.size();
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->Wait(&pBuffer->counter);
+	}
+
+	size_t imageBytes = pBuffer->pixels.size();
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+	const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, imageBytes, GL_MAP_READ_BIT);
+	if (NULL != pMapped)
+	{
+		memcpy(&pBuffer->pixels[0], pMapped, imageBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	pBuffer->imageIndex = slot.imageIndex;
+	slot.imageIndex = -1;
+	if (NULL == pMapped)
+	{
+		std::cout << "ERROR: Could not map the pixels of image " << pBuffer->imageIndex << std::endl;
+		return;
+	}
+
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->Submit(&EncodeJob, pBuffer, 0, 1, &pBuffer->counter);
+	}
+	else
+	{
+		EncodeJob(pBuffer, 0, 1);
+	}
+}
+
+/***********************************************************
+ *  EncodeJob()
+ *
+ *  This method is used for encoding the pixels of an encode
+ *  buffer and writing them to the image file of their pose.
+ ***********************************************************/
+void BatchRenderer::EncodeJob(void* pData, int, int)
+{
+	ENCODE_BUFFER* pBuffer = (ENCODE_BUFFER*)pData;
+	BatchRenderer* pRenderer = pBuffer->pRenderer;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	ImageWriter::EncodeTga(
+		&pBuffer->pixels[0],
+		pRenderer->m_width,
+		pRenderer->m_height,
+		(size_t)pRenderer->m_width * 4,
+		true,
+		true,
+		pBuffer->encoded);
+	if (ImageWriter::WriteFile(pRenderer->GetImageFilename(pBuffer->imageIndex).c_str(), pBuffer->encoded) == true)
+	{
+		pRenderer->m_imagesWritten++;
+		pRenderer->m_bytesWritten += pBuffer->encoded.size();
+	}
+
+	pRenderer->m_encodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - startTime).count();
+}
+
+/***********************************************************
+ *  GetImageFilename()
+ *
+ *  This method is used for getting the file name of the
+ *  image of a pose, the output prefix and the pose index.
+ ***********************************************************/
+std::string BatchRenderer::GetImageFilename(int imageIndex) const
+{
+	char number[16];
+	snprintf(number, sizeof(number), "%05d", imageIndex);
+	return(m_outputPrefix + number + ".tga");
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for retiring the readbacks still in
+ *  flight, in the order they were queued, and for waiting
+ *  until every image is written.
+ ***********************************************************/
+void BatchRenderer::Finish()
+{
+	int firstImage = m_stats.imagesRendered - m_readbackCount;
+	for (int i = std::max(firstImage, 0); i < m_stats.imagesRendered; i++)
+	{
+		READBACK_SLOT& slot = m_readbacks[i % m_readbackCount];
+		if (slot.imageIndex >= 0)
+		{
+			RetireReadback(slot);
+		}
+	}
+
+	for (size_t i = 0; i < m_encodeBuffers.size(); i++)
+	{
+		if (NULL != m_pJobSystem)
+		{
+			m_pJobSystem->Wait(&m_encodeBuffers[i]->counter);
+		}
+	}
+
+	m_stats.totalSeconds = ElapsedMs(m_startTime, std::chrono::steady_clock::now()) / 1000.0;
+	m_stats.imagesWritten = m_imagesWritten.load();
+	m_stats.imagesPerSecond = (m_stats.totalSeconds > 0.0) ? (m_stats.imagesWritten / m_stats.totalSeconds) : 0.0;
+	m_stats.gpuIdleMs = std::max((m_stats.totalSeconds * 1000.0) - m_stats.gpuBusyMs, 0.0);
+	m_stats.encodeMs = m_encodeMicroseconds.load() / 1000.0;
+	m_stats.bytesWritten = m_bytesWritten.load();
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the statistics of the
+ *  batch, complete once Finish() has returned.
+ ***********************************************************/
+const BatchRenderer::BATCH_STATS& BatchRenderer::GetStats() const
+{
+	return(m_stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the statistics of the
+ *  batch.
+ ***********************************************************/
+void BatchRenderer::PrintStats() const
+{
+	double totalMs = m_stats.totalSeconds * 1000.0;
+	std::cout << "BATCH: " << m_stats.imagesWritten << " of " << m_stats.imagesRendered << " images"
+		<< " (" << m_width << "x" << m_height << ") in " << m_stats.totalSeconds << " s"
+		<< ", " << m_stats.imagesPerSecond << " images/s"
+		<< ", GPU busy " << m_stats.gpuBusyMs << " ms"
+		<< ", GPU idle " << m_stats.gpuIdleMs << " ms"
+		<< " (" << ((totalMs > 0.0) ? (100.0 * m_stats.gpuIdleMs / totalMs) : 0.0) << "%)"
+		<< ", readback stalls " << m_stats.readbackStallMs << " ms"
+		<< ", encoding " << m_stats.encodeMs << " ms on the workers"
+		<< ", " << (m_stats.bytesWritten / 1024) << " KB written"
+		<< std::endl;
+}
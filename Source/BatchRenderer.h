@@ -0,0 +1,163 @@
+///////////////////////////////////////////////////////////////////////////////
+// batchrenderer.h
+// ============
+// render the scene from a list of camera poses into image files - offscreen
+// framebuffer, asynchronous readback through a ring of pixel buffers and
+// image encoding on the job system
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameSnapshot.h"
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  BatchRenderer
+ *
+ *  This class renders one image per camera pose without
+ *  going through the window.  A pose file lists the image
+ *  size and the poses, each with its position, front and up
+ *  vectors, zoom and projection mode.
+ *
+ *  Every pose is drawn into an offscreen framebuffer and
+ *  read back with glReadPixels into the next pixel buffer of
+ *  a ring, which returns at once.  A pixel buffer is only
+ *  mapped when the ring comes back round to it, by which time
+ *  the GPU has finished the copy, so the CPU does not wait
+ *  for the GPU while it has other poses to draw.  The mapped
+ *  pixels are copied out and encoded and written by a job,
+ *  so encoding overlaps the drawing of the next poses.
+ *
+ *  A pose is drawn as:
+ *
+ *      SetCamera(pose, snapshot)
+ *      ...record the snapshot...
+ *      BeginImage(pose)
+ *      ...draw the snapshot...
+ *      EndImage()
+ *
+ *  and Finish() waits for the last images to be written.
+ ***********************************************************/
+class BatchRenderer
+{
+public:
+	// constructor
+	BatchRenderer(JobSystem* pJobSystem = NULL);
+	// destructor
+	~BatchRenderer();
+
+	struct CAMERA_POSE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		// vertical field of view in degrees for perspective poses,
+		// half the height of the view volume for orthographic ones
+		float zoom;
+		bool bOrthographic;
+	};
+
+	struct BATCH_STATS
+	{
+		int imagesRendered;
+		int imagesWritten;
+		double totalSeconds;
+		double imagesPerSecond;
+		// time the GPU spent drawing and reading back the images,
+		// and the rest of the batch, when it waited for the CPU
+		double gpuBusyMs;
+		double gpuIdleMs;
+		// time the CPU waited for a readback to finish
+		double readbackStallMs;
+		// time spent encoding and writing on the workers
+		double encodeMs;
+		size_t bytesWritten;
+	};
+
+private:
+	// a pixel buffer of the readback ring
+	struct READBACK_SLOT
+	{
+		GLuint bufferID;
+		GLuint queryID;
+		GLsync fence;
+		// pose index whose pixels the buffer receives, -1 for none
+		int imageIndex;
+	};
+
+	// pixels copied out of a pixel buffer, encoded by a job
+	struct ENCODE_BUFFER
+	{
+		BatchRenderer* pRenderer;
+		std::vector<unsigned char> pixels;
+		std::vector<unsigned char> encoded;
+		int imageIndex;
+		JobSystem::JobCounter counter;
+	};
+
+	JobSystem* m_pJobSystem;
+	std::vector<CAMERA_POSE> m_poses;
+	int m_width;
+	int m_height;
+	int m_readbackCount;
+	std::string m_outputPrefix;
+
+	// offscreen target
+	GLuint m_framebufferID;
+	GLuint m_colorTextureID;
+	GLuint m_depthBufferID;
+
+	std::vector<READBACK_SLOT> m_readbacks;
+	std::vector<ENCODE_BUFFER*> m_encodeBuffers;
+	int m_nextEncodeBuffer;
+	int m_currentImage;
+
+	// statistics, the encode figures are added to by the jobs
+	BATCH_STATS m_stats;
+	std::chrono::steady_clock::time_point m_startTime;
+	std::atomic<int> m_imagesWritten;
+	std::atomic<int64_t> m_encodeMicroseconds;
+	std::atomic<size_t> m_bytesWritten;
+
+	// map a pixel buffer whose readback has been queued, and hand
+	// its pixels to an encode job
+	void RetireReadback(READBACK_SLOT& slot);
+	// job that encodes and writes one image
+	static void EncodeJob(void* pData, int begin, int end);
+	// file name of an image
+	std::string GetImageFilename(int imageIndex) const;
+
+public:
+	// read the image size and the camera poses of a pose file
+	bool LoadPoses(const char* filename);
+	// create the offscreen target and the readback ring, images
+	// are written to the prefix followed by the pose index
+	bool Initialize(const char* outputPrefix);
+	// free the OpenGL objects
+	void Destroy();
+
+	int GetPoseCount() const;
+	int GetWidth() const;
+	int GetHeight() const;
+
+	// set the camera of a snapshot to a pose, before it is recorded
+	void SetCamera(int poseIndex, FRAME_SNAPSHOT& snapshot) const;
+	// bind the offscreen target, before the snapshot is drawn
+	void BeginImage(int poseIndex);
+	// queue the readback of the drawn image
+	void EndImage();
+	// read back and write the images still in flight
+	void Finish();
+
+	const BATCH_STATS& GetStats() const;
+	void PrintStats() const;
+};
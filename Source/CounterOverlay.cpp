@@ -0,0 +1,169 @@
+///////////////////////////////////////////////////////////////////////////////
+// counteroverlay.cpp
+// ============
+// draw the rolling history of the render counters over the corner of the
+// display window, one graph per counter with its latest count
+///////////////////////////////////////////////////////////////////////////////
+
+#include "CounterOverlay.h"
+#include "MemoryTracker.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// texture unit used by the overlay, next to the unit of the
+	// upscale pass and clear of the scene textures
+	const int OVERLAY_TEXTURE_UNIT = 14;
+	// size of the panel in pixels - two pixels per frame of the
+	// history, room for nine digits, and a row per counter
+	const int GRAPH_WIDTH = RenderCounters::HISTORY_LENGTH * 2;
+	const int DIGITS_WIDTH = 80;
+	const int ROW_HEIGHT = 32;
+	// distance of the panel from the window's corner
+	const int PANEL_MARGIN = 8;
+}
+
+/***********************************************************
+ *  CounterOverlay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+CounterOverlay::CounterOverlay()
+{
+	// initialize the member variables
+	m_pOverlayShader = NULL;
+	m_historyTexture = 0;
+	m_panelVAO = 0;
+	m_bInitialized = false;
+}
+
+/***********************************************************
+ *  ~CounterOverlay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+CounterOverlay::~CounterOverlay()
+{
+	if (0 != m_historyTexture)
+	{
+		glDeleteTextures(1, &m_historyTexture);
+		MemoryTracker::ReleaseTexture(m_historyTexture);
+		m_historyTexture = 0;
+	}
+	if (0 != m_panelVAO)
+	{
+		glDeleteVertexArrays(1, &m_panelVAO);
+		m_panelVAO = 0;
+	}
+	if (NULL != m_pOverlayShader)
+	{
+		delete m_pOverlayShader;
+		m_pOverlayShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used to load the overlay shader and create
+ *  the texture the history is uploaded into.  The history is
+ *  read with texelFetch, so the texture has a single level
+ *  and is never filtered.
+ ***********************************************************/
+bool CounterOverlay::Initialize()
+{
+	glGenTextures(1, &m_historyTexture);
+	glActiveTexture(GL_TEXTURE0 + OVERLAY_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_historyTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32F, RenderCounters::HISTORY_LENGTH, RenderCounters::COUNTER_COUNT);
+	MemoryTracker::TrackTexture(m_historyTexture, MemoryTracker::MEMORY_GPU_TEXTURES, "counter overlay history",
+		GL_R32F, RenderCounters::HISTORY_LENGTH, RenderCounters::COUNTER_COUNT, 1, 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glActiveTexture(GL_TEXTURE0);
+
+	glGenVertexArrays(1, &m_panelVAO);
+
+	m_pOverlayShader = new ShaderManager();
+	m_pOverlayShader->LoadShaders(
+		"shaders/overlayVertexShader.glsl",
+		"shaders/overlayFragmentShader.glsl");
+	m_pOverlayShader->use();
+	m_pOverlayShader->setSampler2DValue("historyTexture", OVERLAY_TEXTURE_UNIT);
+	m_pOverlayShader->setVec2Value("panelSize",
+		glm::vec2((float)(GRAPH_WIDTH + DIGITS_WIDTH), (float)(ROW_HEIGHT * RenderCounters::COUNTER_COUNT)));
+	m_pOverlayShader->setFloatValue("graphWidth", (float)GRAPH_WIDTH);
+
+	m_scaledHistory.assign(RenderCounters::HISTORY_LENGTH * RenderCounters::COUNTER_COUNT, 0.0f);
+	for (int i = 0; i < RenderCounters::COUNTER_COUNT; i++)
+	{
+		m_latestNames.push_back("latestValues[" + std::to_string(i) + "]");
+	}
+
+	m_bInitialized = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used to draw the panel into the top left
+ *  corner of the window.  The frames of the history are laid
+ *  out with the newest at the right, each scaled to the
+ *  largest count of its counter so the shape of every graph
+ *  shows however large the counts are.  The main shader has
+ *  to be put back in use by the caller.
+ ***********************************************************/
+void CounterOverlay::Draw(const RenderCounters& counters, int framebufferWidth, int framebufferHeight)
+{
+	int panelWidth = GRAPH_WIDTH + DIGITS_WIDTH;
+	int panelHeight = ROW_HEIGHT * RenderCounters::COUNTER_COUNT;
+	if ((m_bInitialized == false) ||
+		(framebufferWidth < panelWidth + PANEL_MARGIN) ||
+		(framebufferHeight < panelHeight + PANEL_MARGIN))
+	{
+		return;
+	}
+
+	int historyCount = counters.GetHistoryCount();
+	int firstColumn = RenderCounters::HISTORY_LENGTH - historyCount;
+	m_pOverlayShader->use();
+	for (int counter = 0; counter < RenderCounters::COUNTER_COUNT; counter++)
+	{
+		uint64_t maxValue = counters.GetHistoryMax((RenderCounters::Counter)counter);
+		float scale = (maxValue > 0) ? 1.0f / (float)maxValue : 0.0f;
+		float* pRow = &m_scaledHistory[counter * RenderCounters::HISTORY_LENGTH];
+		for (int i = 0; i < historyCount; i++)
+		{
+			pRow[firstColumn + i] = (float)counters.GetHistoryFrame(i).values[counter] * scale;
+		}
+
+		float latest = (historyCount > 0) ? (float)counters.GetHistoryFrame(historyCount - 1).values[counter] : 0.0f;
+		m_pOverlayShader->setFloatValue(m_latestNames[counter], latest);
+	}
+	m_pOverlayShader->setIntValue("historyCount", historyCount);
+
+	glActiveTexture(GL_TEXTURE0 + OVERLAY_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_historyTexture);
+	glTexSubImage2D(
+		GL_TEXTURE_2D, 0,
+		0, 0,
+		RenderCounters::HISTORY_LENGTH, RenderCounters::COUNTER_COUNT,
+		GL_RED, GL_FLOAT,
+		&m_scaledHistory[0]);
+	glActiveTexture(GL_TEXTURE0);
+
+	// the panel is blended over the finished frame
+	glDisable(GL_DEPTH_TEST);
+	glViewport(PANEL_MARGIN, framebufferHeight - panelHeight - PANEL_MARGIN, panelWidth, panelHeight);
+
+	glBindVertexArray(m_panelVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
+	glEnable(GL_DEPTH_TEST);
+}
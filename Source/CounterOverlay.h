@@ -0,0 +1,53 @@
+///////////////////////////////////////////////////////////////////////////////
+// counteroverlay.h
+// ============
+// draw the rolling history of the render counters over the corner of the
+// display window, one graph per counter with its latest count
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderCounters.h"
+#include "ShaderManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  CounterOverlay
+ *
+ *  This class draws the history of the render counters into
+ *  the top left corner of the window.  Every counter has a
+ *  row with a bar per frame, scaled to the largest count in
+ *  the history, and the count of the newest frame in digits.
+ *  The history is uploaded into a small float texture and the
+ *  whole panel is one draw of a single triangle, so showing
+ *  the overlay costs the frame little.
+ ***********************************************************/
+class CounterOverlay
+{
+public:
+	// constructor
+	CounterOverlay();
+	// destructor
+	~CounterOverlay();
+
+private:
+	// shader program of the panel
+	ShaderManager* m_pOverlayShader;
+	// a row per counter, a texel per frame of the history
+	GLuint m_historyTexture;
+	// empty vertex array used to draw the panel triangle
+	GLuint m_panelVAO;
+	// history scaled to 0..1, uploaded each time it is drawn
+	std::vector<float> m_scaledHistory;
+	// uniform names of the latest counts, built once
+	std::vector<std::string> m_latestNames;
+	bool m_bInitialized;
+
+public:
+	// load the shader and create the history texture
+	bool Initialize();
+	// draw the panel over the window's framebuffer
+	void Draw(const RenderCounters& counters, int framebufferWidth, int framebufferHeight);
+};
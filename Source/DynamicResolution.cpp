@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.cpp
+// ============
+// render the 3D scene into an offscreen target whose resolution follows the
+// measured GPU frame time, then upscale it into the display window
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DynamicResolution.h"
+#include "MemoryTracker.h"
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+
+// declaration of the global variables and defines
+namespace
+{
+	// texture unit used by the upscale pass, kept clear of the
+	// units that the scene textures are bound to
+	const int UPSCALE_TEXTURE_UNIT = 15;
+	// weight of a new GPU time sample in the smoothed value
+	const float GPU_TIME_SMOOTHING = 0.1f;
+	// the GPU time may drop this far below the target before
+	// the controller raises the scale again
+	const float RAISE_THRESHOLD = 0.85f;
+	// largest relative scale change per controller step - the
+	// scale is lowered quickly and raised slowly to avoid
+	// oscillating around the target
+	const float MAX_LOWER_STEP = 0.10f;
+	const float MAX_RAISE_STEP = 0.05f;
+	// frames to wait after a change, so the timer queries that
+	// measure the new scale are back before the next decision
+	const int CHANGE_COOLDOWN_FRAMES = 8;
+}
+
+/***********************************************************
+ *  DynamicResolution()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DynamicResolution::DynamicResolution()
+{
+	// initialize the member variables
+	m_pUpscaleShader = NULL;
+	m_frameBuffer = 0;
+	m_colorTexture = 0;
+	m_depthBuffer = 0;
+	m_fullscreenVAO = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_timerQueries[i] = 0;
+		m_queryPending[i] = false;
+	}
+	m_queryIndex = 0;
+	m_bFrameTimed = false;
+	m_windowWidth = 0;
+	m_windowHeight = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	m_renderWidth = 0;
+	m_renderHeight = 0;
+	m_minScale = 0.5f;
+	m_maxScale = 1.0f;
+	m_scale = 1.0f;
+	m_targetFrameMs = 16.0f;
+	m_gpuFrameMs = 0.0f;
+	m_framesSinceChange = 0;
+	m_controllerState = CONTROLLER_HOLDING;
+	m_upscaleFilter = UPSCALE_BILINEAR;
+	m_bInitialized = false;
+}
+
+/***********************************************************
+ *  ~DynamicResolution()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DynamicResolution::~DynamicResolution()
+{
+	if (m_bInitialized)
+	{
+		DestroyRenderTarget();
+		glDeleteQueries(QUERY_COUNT, m_timerQueries);
+		glDeleteVertexArrays(1, &m_fullscreenVAO);
+	}
+	if (NULL != m_pUpscaleShader)
+	{
+		delete m_pUpscaleShader;
+		m_pUpscaleShader = NULL;
+	}
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used to create the offscreen target, the
+ *  timer queries and the upscale shader.  The scale bounds
+ *  apply to each axis of the window size.
+ ***********************************************************/
+bool DynamicResolution::Initialize(
+	int windowWidth,
+	int windowHeight,
+	float minScale,
+	float maxScale,
+	float targetFrameMs,
+	UpscaleFilter upscaleFilter)
+{
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+	m_minScale = glm::clamp(minScale, 0.1f, 1.0f);
+	m_maxScale = glm::clamp(maxScale, m_minScale, 2.0f);
+	m_scale = m_maxScale;
+	m_targetFrameMs = targetFrameMs;
+	m_upscaleFilter = upscaleFilter;
+
+	if (CreateRenderTarget() == false)
+	{
+		return(false);
+	}
+
+	glGenQueries(QUERY_COUNT, m_timerQueries);
+	glGenVertexArrays(1, &m_fullscreenVAO);
+
+	// load the shader code for the upscale pass
+	m_pUpscaleShader = new ShaderManager();
+	m_pUpscaleShader->LoadShaders(
+		"shaders/upscaleVertexShader.glsl",
+		"shaders/upscaleFragmentShader.glsl");
+	m_pUpscaleShader->use();
+	m_pUpscaleShader->setSampler2DValue("sourceTexture", UPSCALE_TEXTURE_UNIT);
+	m_pUpscaleShader->setBoolValue("bSharpen", m_upscaleFilter == UPSCALE_SHARPEN);
+
+	m_bInitialized = true;
+
+	std::cout << "INFO: Dynamic resolution enabled, scale " << m_minScale
+		<< " to " << m_maxScale << ", target " << m_targetFrameMs << " ms" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateRenderTarget()
+ *
+ *  This method is used to create the offscreen framebuffer.
+ *  It is sized for the largest scale so that only the
+ *  viewport needs to change when the scale changes.
+ ***********************************************************/
+bool DynamicResolution::CreateRenderTarget()
+{
+	m_targetWidth = (int)std::ceil(m_windowWidth * m_maxScale);
+	m_targetHeight = (int)std::ceil(m_windowHeight * m_maxScale);
+
+	glGenTextures(1, &m_colorTexture);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_targetWidth, m_targetHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	MemoryTracker::TrackTexture(m_colorTexture, MemoryTracker::MEMORY_GPU_RENDER_TARGETS,
+		"dynamic resolution color", GL_RGBA8, m_targetWidth, m_targetHeight, 1, 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_targetWidth, m_targetHeight);
+	MemoryTracker::TrackRenderbuffer(m_depthBuffer, MemoryTracker::MEMORY_GPU_RENDER_TARGETS,
+		"dynamic resolution depth", GL_DEPTH24_STENCIL8, m_targetWidth, m_targetHeight);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &m_frameBuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_colorTexture, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Failed to create the dynamic resolution framebuffer, status:" << status << std::endl;
+		DestroyRenderTarget();
+		return(false);
+	}
+
+	// bind the color texture to the unit reserved for the upscale pass
+	glActiveTexture(GL_TEXTURE0 + UPSCALE_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, m_colorTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyRenderTarget()
+ *
+ *  This method is used to free the offscreen framebuffer
+ *  and its attachments.
+ ***********************************************************/
+void DynamicResolution::DestroyRenderTarget()
+{
+	if (0 != m_frameBuffer)
+	{
+		glDeleteFramebuffers(1, &m_frameBuffer);
+		m_frameBuffer = 0;
+	}
+	if (0 != m_colorTexture)
+	{
+		glDeleteTextures(1, &m_colorTexture);
+		MemoryTracker::ReleaseTexture(m_colorTexture);
+		m_colorTexture = 0;
+	}
+	if (0 != m_depthBuffer)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		MemoryTracker::ReleaseRenderbuffer(m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used to recreate the offscreen target
+ *  after the display window has changed size.
+ ***********************************************************/
+void DynamicResolution::Resize(int windowWidth, int windowHeight)
+{
+	if ((windowWidth == m_windowWidth) && (windowHeight == m_windowHeight))
+	{
+		return;
+	}
+	// a minimized window reports a zero size
+	if ((windowWidth <= 0) || (windowHeight <= 0))
+	{
+		return;
+	}
+
+	m_windowWidth = windowWidth;
+	m_windowHeight = windowHeight;
+	DestroyRenderTarget();
+	CreateRenderTarget();
+}
+
+/***********************************************************
+ *  ReadTimerQueries()
+ *
+ *  This method is used to collect the results of finished
+ *  timer queries without waiting on the ones still running.
+ ***********************************************************/
+void DynamicResolution::ReadTimerQueries()
+{
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		// walk the ring from the oldest query, in the slot the next
+		// frame is timed in, to the newest
+		int index = (m_queryIndex + i) % QUERY_COUNT;
+		if (m_queryPending[index] == false)
+		{
+			continue;
+		}
+
+		GLint available = 0;
+		glGetQueryObjectiv(m_timerQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			// later queries cannot have finished before this one
+			break;
+		}
+
+		GLuint64 elapsedNs = 0;
+		glGetQueryObjectui64v(m_timerQueries[index], GL_QUERY_RESULT, &elapsedNs);
+		m_queryPending[index] = false;
+
+		float elapsedMs = (float)(elapsedNs / 1.0e6);
+		if (m_gpuFrameMs <= 0.0f)
+		{
+			m_gpuFrameMs = elapsedMs;
+		}
+		else
+		{
+			m_gpuFrameMs += (elapsedMs - m_gpuFrameMs) * GPU_TIME_SMOOTHING;
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used to move the render scale toward the
+ *  value that fits the target frame time.  The fragment cost
+ *  follows the rendered area, so the axis scale changes with
+ *  the square root of the time ratio.
+ ***********************************************************/
+void DynamicResolution::UpdateScale()
+{
+	m_framesSinceChange++;
+	if ((m_gpuFrameMs <= 0.0f) || (m_framesSinceChange < CHANGE_COOLDOWN_FRAMES))
+	{
+		return;
+	}
+
+	float idealScale = m_scale * std::sqrt(m_targetFrameMs / m_gpuFrameMs);
+	float newScale = m_scale;
+
+	if (m_gpuFrameMs > m_targetFrameMs)
+	{
+		newScale = glm::max(idealScale, m_scale * (1.0f - MAX_LOWER_STEP));
+		m_controllerState = CONTROLLER_LOWERING;
+	}
+	else if (m_gpuFrameMs < m_targetFrameMs * RAISE_THRESHOLD)
+	{
+		newScale = glm::min(idealScale, m_scale * (1.0f + MAX_RAISE_STEP));
+		m_controllerState = CONTROLLER_RAISING;
+	}
+	else
+	{
+		m_controllerState = CONTROLLER_HOLDING;
+	}
+
+	newScale = glm::clamp(newScale, m_minScale, m_maxScale);
+	if (newScale == m_scale)
+	{
+		m_controllerState = CONTROLLER_HOLDING;
+		return;
+	}
+
+	m_scale = newScale;
+	m_framesSinceChange = 0;
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method is used to bind the offscreen target at the
+ *  current scale and start the GPU timer for the frame.
+ ***********************************************************/
+void DynamicResolution::BeginScene()
+{
+	ReadTimerQueries();
+	UpdateScale();
+
+	m_renderWidth = glm::max(1, (int)(m_windowWidth * m_scale));
+	m_renderHeight = glm::max(1, (int)(m_windowHeight * m_scale));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_frameBuffer);
+	glViewport(0, 0, m_renderWidth, m_renderHeight);
+
+	// only time the frame when the query slot has been read back
+	m_bFrameTimed = (m_queryPending[m_queryIndex] == false);
+	if (m_bFrameTimed)
+	{
+		glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_queryIndex]);
+		m_queryPending[m_queryIndex] = true;
+	}
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  This method is used to stop the frame timer and draw the
+ *  rendered area of the offscreen target into the window.
+ ***********************************************************/
+void DynamicResolution::EndScene()
+{
+	if (m_bFrameTimed)
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+		m_queryIndex = (m_queryIndex + 1) % QUERY_COUNT;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, m_windowWidth, m_windowHeight);
+
+	// the upscale pass overwrites every pixel of the window
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+
+	m_pUpscaleShader->use();
+	m_pUpscaleShader->setVec2Value("sourceScale",
+		glm::vec2((float)m_renderWidth / m_targetWidth, (float)m_renderHeight / m_targetHeight));
+	m_pUpscaleShader->setVec2Value("texelSize",
+		glm::vec2(1.0f / m_targetWidth, 1.0f / m_targetHeight));
+	m_pUpscaleShader->setFloatValue("sharpness", 0.5f * (1.0f - m_scale / m_maxScale) + 0.25f);
+
+	glBindVertexArray(m_fullscreenVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	glEnable(GL_BLEND);
+	glEnable(GL_DEPTH_TEST);
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used to get the current render scale.
+ ***********************************************************/
+float DynamicResolution::GetScale() const
+{
+	return(m_scale);
+}
+
+/***********************************************************
+ *  GetGpuFrameMs()
+ *
+ *  This method is used to get the smoothed GPU time of the
+ *  scene pass.
+ ***********************************************************/
+float DynamicResolution::GetGpuFrameMs() const
+{
+	return(m_gpuFrameMs);
+}
+
+/***********************************************************
+ *  GetControllerState()
+ *
+ *  This method is used to get the last decision made by the
+ *  scale controller.
+ ***********************************************************/
+DynamicResolution::ControllerState DynamicResolution::GetControllerState() const
+{
+	return(m_controllerState);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used to print the current scale and the
+ *  controller state to the console.
+ ***********************************************************/
+void DynamicResolution::PrintStats() const
+{
+	const char* stateName = "holding";
+	if (m_controllerState == CONTROLLER_RAISING)
+	{
+		stateName = "raising";
+	}
+	else if (m_controllerState == CONTROLLER_LOWERING)
+	{
+		stateName = "lowering";
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "RESOLUTION: scale " << m_scale
+		<< " (" << m_renderWidth << "x" << m_renderHeight << ")"
+		<< ", gpu " << m_gpuFrameMs << " ms"
+		<< ", target " << m_targetFrameMs << " ms"
+		<< ", controller " << stateName
+		<< std::defaultfloat << std::endl;
+}
@@ -0,0 +1,118 @@
+///////////////////////////////////////////////////////////////////////////////
+// dynamicresolution.h
+// ============
+// render the 3D scene into an offscreen target whose resolution follows the
+// measured GPU frame time, then upscale it into the display window
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+/***********************************************************
+ *  DynamicResolution
+ *
+ *  This class owns the offscreen framebuffer the scene is
+ *  drawn into.  GPU timer queries measure each frame, and a
+ *  controller resizes the rendered area to hold the target
+ *  frame time.  The framebuffer is allocated once at the
+ *  largest scale and only the viewport changes, so a scale
+ *  change never reallocates GPU memory mid-run.
+ ***********************************************************/
+class DynamicResolution
+{
+public:
+	// constructor
+	DynamicResolution();
+	// destructor
+	~DynamicResolution();
+
+	enum UpscaleFilter {
+		UPSCALE_BILINEAR,
+		UPSCALE_SHARPEN
+	};// filters for the upscale pass
+
+	enum ControllerState {
+		CONTROLLER_HOLDING,
+		CONTROLLER_RAISING,
+		CONTROLLER_LOWERING
+	};// last decision made by the scale controller
+
+private:
+	// number of timer queries in flight, so results are read
+	// a few frames late without stalling on the GPU
+	static const int QUERY_COUNT = 4;
+
+	// shader program for the upscale pass
+	ShaderManager* m_pUpscaleShader;
+	// offscreen framebuffer and its attachments
+	GLuint m_frameBuffer;
+	GLuint m_colorTexture;
+	GLuint m_depthBuffer;
+	// empty vertex array used to draw the fullscreen triangle
+	GLuint m_fullscreenVAO;
+	// ring of GPU timer queries
+	GLuint m_timerQueries[QUERY_COUNT];
+	bool m_queryPending[QUERY_COUNT];
+	int m_queryIndex;
+	// true when the current frame has a timer query running
+	bool m_bFrameTimed;
+
+	// size of the display window and the allocated target
+	int m_windowWidth;
+	int m_windowHeight;
+	int m_targetWidth;
+	int m_targetHeight;
+	// size of the area rendered this frame
+	int m_renderWidth;
+	int m_renderHeight;
+
+	// controller configuration and state
+	float m_minScale;
+	float m_maxScale;
+	float m_scale;
+	float m_targetFrameMs;
+	float m_gpuFrameMs;
+	int m_framesSinceChange;
+	ControllerState m_controllerState;
+	UpscaleFilter m_upscaleFilter;
+	bool m_bInitialized;
+
+	// (re)create the framebuffer for the window size
+	bool CreateRenderTarget();
+	// free the framebuffer and its attachments
+	void DestroyRenderTarget();
+	// collect finished timer queries into the GPU frame time
+	void ReadTimerQueries();
+	// adjust the render scale from the GPU frame time
+	void UpdateScale();
+
+public:
+	// create the offscreen target and the upscale shader
+	bool Initialize(
+		int windowWidth,
+		int windowHeight,
+		float minScale,
+		float maxScale,
+		float targetFrameMs,
+		UpscaleFilter upscaleFilter);
+	// resize the offscreen target when the window size changes
+	void Resize(int windowWidth, int windowHeight);
+
+	// bind the offscreen target and start timing the frame
+	void BeginScene();
+	// stop timing and upscale the rendered area to the window
+	void EndScene();
+
+	// current render scale along each axis
+	float GetScale() const;
+	// smoothed GPU time of the scene pass, in milliseconds
+	float GetGpuFrameMs() const;
+	// last decision made by the scale controller
+	ControllerState GetControllerState() const;
+	// print the current scale and controller state
+	void PrintStats() const;
+};
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// bump allocator for the data of a frame, reset when the frame begins and
+// kept for the frames still in flight
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+// declaration of global variables
+namespace
+{
+	// blocks are grown in steps of this many bytes
+	const size_t g_BlockGranularity = 4096;
+
+	// first address at or after the passed in one with the alignment
+	uintptr_t AlignAddress(uintptr_t address, size_t alignment)
+	{
+		return((address + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t blockBytes, int framesInFlight)
+{
+	m_blockCount = std::max(1, std::min(framesInFlight, (int)MAX_FRAMES_IN_FLIGHT));
+	m_currentBlock = 0;
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		FRAME_BLOCK& block = m_blocks[i];
+		block.pMemory = NULL;
+		block.capacity = 0;
+		block.used = 0;
+		block.peak = 0;
+		if ((i < m_blockCount) && (blockBytes > 0))
+		{
+			block.pMemory = new unsigned char[blockBytes];
+			block.capacity = blockBytes;
+		}
+	}
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		ReleaseOverflow(m_blocks[i]);
+		delete[] m_blocks[i].pMemory;
+		m_blocks[i].pMemory = NULL;
+	}
+}
+
+/***********************************************************
+ *  ReleaseOverflow()
+ *
+ *  This method is used for freeing the heap allocations a
+ *  block took for the requests it had no room for.
+ ***********************************************************/
+void FrameArena::ReleaseOverflow(FRAME_BLOCK& block)
+{
+	for (size_t i = 0; i < block.overflow.size(); i++)
+	{
+		delete[] block.overflow[i];
+	}
+	block.overflow.clear();
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting a frame in the block of
+ *  the oldest frame in flight, whose memory is no longer in
+ *  use.  When that frame overflowed, the block is replaced
+ *  with one large enough for all it asked for, so the frames
+ *  that follow fit.
+ ***********************************************************/
+void FrameArena::BeginFrame()
+{
+	m_currentBlock = (m_currentBlock + 1) % m_blockCount;
+
+	FRAME_BLOCK& block = m_blocks[m_currentBlock];
+	ReleaseOverflow(block);
+	if (block.peak > block.capacity)
+	{
+		size_t capacity = ((block.peak + g_BlockGranularity - 1) / g_BlockGranularity) * g_BlockGranularity;
+		delete[] block.pMemory;
+		block.pMemory = new unsigned char[capacity];
+		block.capacity = capacity;
+	}
+	block.used = 0;
+	block.peak = 0;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for taking memory for the current
+ *  frame.  It comes from the frame's block while it has room
+ *  and from the heap after that, and stays valid until the
+ *  block is reset by a later BeginFrame().  The alignment has
+ *  to be a power of two.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t bytes, size_t alignment)
+{
+	FRAME_BLOCK& block = m_blocks[m_currentBlock];
+	block.peak += bytes + alignment - 1;
+
+	if (NULL != block.pMemory)
+	{
+		uintptr_t start = (uintptr_t)block.pMemory;
+		uintptr_t address = AlignAddress(start + block.used, alignment);
+		if (address + bytes <= start + block.capacity)
+		{
+			block.used = (size_t)(address + bytes - start);
+			return((void*)address);
+		}
+	}
+
+	unsigned char* pOverflow = new unsigned char[bytes + alignment - 1];
+	block.overflow.push_back(pOverflow);
+	return((void*)AlignAddress((uintptr_t)pOverflow, alignment));
+}
+
+/***********************************************************
+ *  GetUsedBytes()
+ *
+ *  This method is used for getting the bytes the current
+ *  frame has taken from its block.
+ ***********************************************************/
+size_t FrameArena::GetUsedBytes() const
+{
+	return(m_blocks[m_currentBlock].used);
+}
+
+/***********************************************************
+ *  GetCapacity()
+ *
+ *  This method is used for getting the bytes reserved by the
+ *  blocks of all the frames in flight.
+ ***********************************************************/
+size_t FrameArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for (int i = 0; i < m_blockCount; i++)
+	{
+		capacity += m_blocks[i].capacity;
+	}
+	return(capacity);
+}
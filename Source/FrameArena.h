@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// bump allocator for the data of a frame, reset when the frame begins and
+// kept for the frames still in flight
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class hands out the memory of short-lived per-frame
+ *  data from a block that is reset when the frame begins, so
+ *  the data costs a pointer bump instead of a heap allocation.
+ *  There is a block per frame in flight and BeginFrame()
+ *  moves on to the oldest of them, so memory handed out
+ *  during a frame stays valid while the next frames record.
+ *  A frame that outgrows its block takes the rest from the
+ *  heap, and the block is grown to the frame's peak the next
+ *  time it is reset, so only the first frames allocate.
+ *  Nothing is destructed when a block is reset, so only
+ *  trivially destructible types can be placed in it.  An
+ *  arena belongs to the thread that records into it.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// most frames that can be in flight at once
+	static const int MAX_FRAMES_IN_FLIGHT = 3;
+
+	// constructor
+	FrameArena(size_t blockBytes, int framesInFlight);
+	// destructor
+	~FrameArena();
+
+private:
+	// memory of one frame in flight
+	struct FRAME_BLOCK
+	{
+		unsigned char* pMemory;
+		size_t capacity;
+		size_t used;
+		// bytes the frame asked for, including those that overflowed
+		size_t peak;
+		// heap allocations of the requests the block had no room for
+		std::vector<unsigned char*> overflow;
+	};
+
+	FRAME_BLOCK m_blocks[MAX_FRAMES_IN_FLIGHT];
+	int m_blockCount;
+	int m_currentBlock;
+
+	// free the heap allocations a block overflowed into
+	static void ReleaseOverflow(FRAME_BLOCK& block);
+
+public:
+	// move on to the block of the oldest frame and reset it
+	void BeginFrame();
+
+	// memory of the current frame, valid until its block is reset
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	template <typename T>
+	T* AllocateArray(size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value,
+			"frame arena memory is reset without calling destructors");
+		return(static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))));
+	}
+
+	// bytes used by the current frame and reserved by all the blocks
+	size_t GetUsedBytes() const;
+	size_t GetCapacity() const;
+};
@@ -0,0 +1,472 @@
+///////////////////////////////////////////////////////////////////////////////
+// framescheduler.cpp
+// ============
+// schedule the main loop - fixed-step updates, swap interval, frame limiter
+// and frame pacing statistics
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameScheduler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// number of frames kept for the pacing statistics
+	const int FRAME_HISTORY_SIZE = 240;
+	// longest frame time that is fed into the update accumulator,
+	// which keeps a long stall from triggering a burst of updates
+	const double MAX_FRAME_DELTA = 0.25;
+	// default time spent spinning before a limiter deadline - the
+	// OS sleep granularity is around 1 ms when the timer is raised
+	const double DEFAULT_SPIN_THRESHOLD = 0.002;
+	// a frame counts as missed when it runs over its budget by this factor
+	const double MISSED_FRAME_FACTOR = 1.5;
+}
+
+/***********************************************************
+ *  FrameScheduler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameScheduler::FrameScheduler()
+{
+	// initialize the member variables
+	m_pWindow = NULL;
+	m_syncMode = SYNC_VSYNC;
+	m_fixedTimestep = 1.0 / 120.0;
+	m_targetFramePeriod = 0.0;
+	m_spinThreshold = DEFAULT_SPIN_THRESHOLD;
+	m_accumulator = 0.0;
+	m_updatesThisFrame = 0;
+	m_simulatedStepsPerFrame = 0;
+	m_frameHistory.assign(FRAME_HISTORY_SIZE, 0.0);
+	m_sortedHistory.reserve(FRAME_HISTORY_SIZE);
+	m_historyIndex = 0;
+	m_historyCount = 0;
+	m_frameCount = 0;
+	m_reportInterval = 0.0;
+	m_lastFrameStart = Clock::now();
+	m_frameStart = m_lastFrameStart;
+	m_lastReport = m_lastFrameStart;
+	m_nextDeadline = m_lastFrameStart;
+	m_bDeadlineSet = false;
+	m_bTimerRaised = false;
+}
+
+/***********************************************************
+ *  ~FrameScheduler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameScheduler::~FrameScheduler()
+{
+#ifdef _WIN32
+	// restore the default system timer resolution
+	if (m_bTimerRaised == true)
+	{
+		timeEndPeriod(1);
+		m_bTimerRaised = false;
+	}
+#endif
+	m_pWindow = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used to configure the scheduler for the
+ *  passed in window.  A target frame rate of zero leaves the
+ *  frame rate uncapped (or capped by the swap interval).
+ ***********************************************************/
+void FrameScheduler::Initialize(
+	GLFWwindow* window,
+	SyncMode syncMode,
+	double targetFrameRate,
+	double updateRate)
+{
+	m_pWindow = window;
+	m_syncMode = syncMode;
+
+	if (updateRate > 0.0)
+	{
+		m_fixedTimestep = 1.0 / updateRate;
+	}
+	if (targetFrameRate > 0.0)
+	{
+		m_targetFramePeriod = 1.0 / targetFrameRate;
+	}
+	else
+	{
+		m_targetFramePeriod = 0.0;
+	}
+
+#ifdef _WIN32
+	// raise the system timer resolution so that the limiter
+	// sleeps are accurate to about a millisecond, once however
+	// often the scheduler is initialized
+	if (m_bTimerRaised == false)
+	{
+		timeBeginPeriod(1);
+		m_bTimerRaised = true;
+	}
+#endif
+
+	ApplySwapInterval();
+
+	m_accumulator = 0.0;
+	m_lastFrameStart = Clock::now();
+	m_frameStart = m_lastFrameStart;
+	m_lastReport = m_lastFrameStart;
+	m_bDeadlineSet = false;
+}
+
+/***********************************************************
+ *  ApplySwapInterval()
+ *
+ *  This method is used to set the swap interval for the
+ *  requested sync mode.  Adaptive sync falls back to regular
+ *  vsync when the tear control extension is missing.
+ ***********************************************************/
+void FrameScheduler::ApplySwapInterval()
+{
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+
+	if (m_syncMode == SYNC_OFF)
+	{
+		glfwSwapInterval(0);
+	}
+	else if (m_syncMode == SYNC_ADAPTIVE)
+	{
+		// a negative interval lets late frames swap immediately
+		// instead of waiting for the next vertical blank
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") ||
+			glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			glfwSwapInterval(-1);
+		}
+		else
+		{
+			std::cout << "INFO: Adaptive sync is not supported, using vsync" << std::endl;
+			m_syncMode = SYNC_VSYNC;
+			glfwSwapInterval(1);
+		}
+	}
+	else
+	{
+		glfwSwapInterval(1);
+	}
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used to start a new frame.  The time since
+ *  the previous frame is added to the update accumulator.
+ ***********************************************************/
+void FrameScheduler::BeginFrame()
+{
+	m_frameStart = Clock::now();
+
+	double frameDelta = std::chrono::duration<double>(m_frameStart - m_lastFrameStart).count();
+	if (frameDelta > MAX_FRAME_DELTA)
+	{
+		frameDelta = MAX_FRAME_DELTA;
+	}
+
+	m_accumulator += frameDelta;
+	m_updatesThisFrame = 0;
+}
+
+/***********************************************************
+ *  StepUpdate()
+ *
+ *  This method is used to consume one fixed step from the
+ *  accumulator.  It returns true while another update is due.
+ ***********************************************************/
+bool FrameScheduler::StepUpdate()
+{
+	if (m_simulatedStepsPerFrame > 0)
+	{
+		if (m_updatesThisFrame < m_simulatedStepsPerFrame)
+		{
+			m_updatesThisFrame++;
+			return(true);
+		}
+		return(false);
+	}
+
+	if (m_accumulator >= m_fixedTimestep)
+	{
+		m_accumulator -= m_fixedTimestep;
+		m_updatesThisFrame++;
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetFixedTimestep()
+ *
+ *  This method is used to get the fixed update step length.
+ ***********************************************************/
+float FrameScheduler::GetFixedTimestep() const
+{
+	return((float)m_fixedTimestep);
+}
+
+/***********************************************************
+ *  GetInterpolationAlpha()
+ *
+ *  This method is used to get the fraction of a fixed step
+ *  that has elapsed past the last update, for blending the
+ *  previous and current update states when rendering.
+ ***********************************************************/
+float FrameScheduler::GetInterpolationAlpha() const
+{
+	// simulated frames end on an update step
+	if (m_simulatedStepsPerFrame > 0)
+	{
+		return(1.0f);
+	}
+
+	return((float)(m_accumulator / m_fixedTimestep));
+}
+
+/***********************************************************
+ *  WaitUntil()
+ *
+ *  This method is used to block until the passed in deadline.
+ *  Most of the wait is slept away, and the last stretch is
+ *  spun so that the wake-up does not overshoot the deadline.
+ ***********************************************************/
+void FrameScheduler::WaitUntil(Clock::time_point deadline)
+{
+	Clock::time_point now = Clock::now();
+	double remaining = std::chrono::duration<double>(deadline - now).count();
+
+	// sleep for the part of the wait that the OS can time reliably
+	if (remaining > m_spinThreshold)
+	{
+		std::this_thread::sleep_for(
+			std::chrono::duration<double>(remaining - m_spinThreshold));
+	}
+
+	// spin-wait through the tail of the wait
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  WaitForFrameDeadline()
+ *
+ *  This method is used to hold the frame until its deadline.
+ *  The deadlines are a fixed grid one frame period apart, so
+ *  a frame that finishes early does not pull the next one
+ *  forward.  A frame that runs past its deadline is let
+ *  through and the grid starts again from it, rather than
+ *  the following frames rushing to catch up.  It must be
+ *  called before the buffers are swapped so the presents are
+ *  evenly spaced.
+ ***********************************************************/
+void FrameScheduler::WaitForFrameDeadline()
+{
+	if (m_targetFramePeriod <= 0.0)
+	{
+		return;
+	}
+
+	Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(m_targetFramePeriod));
+	if (m_bDeadlineSet == false)
+	{
+		m_nextDeadline = m_frameStart + period;
+		m_bDeadlineSet = true;
+	}
+	else
+	{
+		m_nextDeadline += period;
+	}
+
+	Clock::time_point now = Clock::now();
+	if (m_nextDeadline > now)
+	{
+		WaitUntil(m_nextDeadline);
+	}
+	else
+	{
+		m_nextDeadline = now;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used to record the interval between this
+ *  frame and the previous one in the pacing history.
+ ***********************************************************/
+void FrameScheduler::EndFrame()
+{
+	double frameMs = std::chrono::duration<double, std::milli>(m_frameStart - m_lastFrameStart).count();
+	m_lastFrameStart = m_frameStart;
+
+	// the first frame has no previous frame to measure against
+	if (m_frameCount > 0)
+	{
+		m_frameHistory[m_historyIndex] = frameMs;
+		m_historyIndex = (m_historyIndex + 1) % FRAME_HISTORY_SIZE;
+		if (m_historyCount < FRAME_HISTORY_SIZE)
+		{
+			m_historyCount++;
+		}
+	}
+	m_frameCount++;
+}
+
+/***********************************************************
+ *  GetFrameStats()
+ *
+ *  This method is used to compute the pacing statistics for
+ *  the frames in the rolling history.
+ ***********************************************************/
+FrameScheduler::FRAME_STATS FrameScheduler::GetFrameStats() const
+{
+	FRAME_STATS stats;
+	stats.frameCount = m_frameCount;
+	stats.averageFrameMs = 0.0;
+	stats.minFrameMs = 0.0;
+	stats.maxFrameMs = 0.0;
+	stats.jitterMs = 0.0;
+	stats.percentile99Ms = 0.0;
+	stats.missedFrames = 0;
+	stats.updatesPerFrame = m_updatesThisFrame;
+
+	if (m_historyCount == 0)
+	{
+		return(stats);
+	}
+
+	std::vector<double>& sorted = m_sortedHistory;
+	sorted.assign(m_frameHistory.begin(), m_frameHistory.begin() + m_historyCount);
+	std::sort(sorted.begin(), sorted.end());
+
+	double total = 0.0;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		total += sorted[i];
+	}
+	stats.averageFrameMs = total / m_historyCount;
+	stats.minFrameMs = sorted.front();
+	stats.maxFrameMs = sorted.back();
+	stats.percentile99Ms = sorted[(m_historyCount - 1) * 99 / 100];
+
+	// the jitter is the standard deviation of the frame intervals
+	double variance = 0.0;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		double difference = sorted[i] - stats.averageFrameMs;
+		variance += difference * difference;
+	}
+	stats.jitterMs = std::sqrt(variance / m_historyCount);
+
+	// frames are measured against the limiter budget when one is set,
+	// otherwise against the average frame time
+	double budgetMs = stats.averageFrameMs;
+	if (m_targetFramePeriod > 0.0)
+	{
+		budgetMs = m_targetFramePeriod * 1000.0;
+	}
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		if (sorted[i] > budgetMs * MISSED_FRAME_FACTOR)
+		{
+			stats.missedFrames++;
+		}
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  SetSimulatedSteps()
+ *
+ *  This method is used to run the same number of fixed
+ *  updates every frame, so a replay advances by the same
+ *  simulated time per frame however long frames take.  The
+ *  frames are still timed by the clock for the statistics.
+ ***********************************************************/
+void FrameScheduler::SetSimulatedSteps(int stepsPerFrame)
+{
+	m_simulatedStepsPerFrame = (stepsPerFrame > 0) ? stepsPerFrame : 0;
+	m_accumulator = 0.0;
+}
+
+/***********************************************************
+ *  SetReportInterval()
+ *
+ *  This method is used to set how often, in seconds, the
+ *  pacing statistics are printed.  Zero disables reporting.
+ ***********************************************************/
+void FrameScheduler::SetReportInterval(double seconds)
+{
+	m_reportInterval = seconds;
+}
+
+/***********************************************************
+ *  IsReportDue()
+ *
+ *  This method is used to check whether the report interval
+ *  has elapsed since the last pacing report.
+ ***********************************************************/
+bool FrameScheduler::IsReportDue() const
+{
+	if (m_reportInterval <= 0.0)
+	{
+		return(false);
+	}
+
+	double elapsed = std::chrono::duration<double>(m_frameStart - m_lastReport).count();
+	return(elapsed >= m_reportInterval);
+}
+
+/***********************************************************
+ *  PrintFrameStats()
+ *
+ *  This method is used to print the pacing statistics to
+ *  the console and restart the report interval.
+ ***********************************************************/
+void FrameScheduler::PrintFrameStats()
+{
+	FRAME_STATS stats = GetFrameStats();
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "FRAME: avg " << stats.averageFrameMs << " ms"
+		<< " (" << (stats.averageFrameMs > 0.0 ? 1000.0 / stats.averageFrameMs : 0.0) << " fps)"
+		<< ", min " << stats.minFrameMs
+		<< ", max " << stats.maxFrameMs
+		<< ", p99 " << stats.percentile99Ms
+		<< ", jitter " << stats.jitterMs
+		<< ", missed " << stats.missedFrames << "/" << m_historyCount
+		<< ", updates " << stats.updatesPerFrame
+		<< std::defaultfloat << std::endl;
+
+	m_lastReport = m_frameStart;
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// framescheduler.h
+// ============
+// schedule the main loop - fixed-step updates, swap interval, frame limiter
+// and frame pacing statistics
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <chrono>
+#include <vector>
+
+/***********************************************************
+ *  FrameScheduler
+ *
+ *  This class drives the timing of the main loop.  The scene
+ *  is updated in fixed time steps while rendering runs at
+ *  the display (or capped) rate, with an interpolation factor
+ *  handed to the renderer for smooth motion between steps.
+ ***********************************************************/
+class FrameScheduler
+{
+public:
+	// constructor
+	FrameScheduler();
+	// destructor
+	~FrameScheduler();
+
+	enum SyncMode {
+		SYNC_OFF,
+		SYNC_VSYNC,
+		SYNC_ADAPTIVE
+	};// swap interval modes
+
+	struct FRAME_STATS
+	{
+		unsigned long frameCount;
+		double averageFrameMs;
+		double minFrameMs;
+		double maxFrameMs;
+		double jitterMs;
+		double percentile99Ms;
+		int missedFrames;
+		int updatesPerFrame;
+	};
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	// active OpenGL display window
+	GLFWwindow* m_pWindow;
+	// requested swap interval mode
+	SyncMode m_syncMode;
+	// length of one fixed update step, in seconds
+	double m_fixedTimestep;
+	// target frame period for the limiter, zero when uncapped
+	double m_targetFramePeriod;
+	// time left before the deadline that is spent spinning
+	double m_spinThreshold;
+	// unsimulated time carried between frames
+	double m_accumulator;
+	// number of fixed updates run in the current frame
+	int m_updatesThisFrame;
+	// fixed updates run by every frame on simulated time, zero
+	// when the updates follow the clock
+	int m_simulatedStepsPerFrame;
+	// time stamps used for the frame measurements
+	Clock::time_point m_lastFrameStart;
+	Clock::time_point m_frameStart;
+	Clock::time_point m_lastReport;
+	// present time the limiter holds the next frame for, on a
+	// fixed grid of frame periods
+	Clock::time_point m_nextDeadline;
+	bool m_bDeadlineSet;
+	// whether the system timer resolution was raised and has to
+	// be restored
+	bool m_bTimerRaised;
+	// rolling history of frame intervals, in milliseconds
+	std::vector<double> m_frameHistory;
+	// copy of the history the statistics sort, kept so a report
+	// does not allocate
+	mutable std::vector<double> m_sortedHistory;
+	int m_historyIndex;
+	int m_historyCount;
+	unsigned long m_frameCount;
+	// interval between pacing reports, zero to disable
+	double m_reportInterval;
+
+	// apply the swap interval for the requested mode
+	void ApplySwapInterval();
+	// sleep, then spin, until the passed in deadline
+	void WaitUntil(Clock::time_point deadline);
+
+public:
+	// configure the scheduler for the passed in window
+	void Initialize(
+		GLFWwindow* window,
+		SyncMode syncMode,
+		double targetFrameRate,
+		double updateRate);
+
+	// start a new frame and accumulate the elapsed time
+	void BeginFrame();
+	// returns true while another fixed update step is due
+	bool StepUpdate();
+	// fixed update step length, in seconds
+	float GetFixedTimestep() const;
+	// blend factor between the last two update states
+	float GetInterpolationAlpha() const;
+	// hold the frame until the limiter deadline has passed
+	void WaitForFrameDeadline();
+	// record the finished frame in the pacing statistics
+	void EndFrame();
+
+	// compute the statistics for the frames in the history
+	FRAME_STATS GetFrameStats() const;
+	// run a fixed number of updates every frame, whatever the
+	// elapsed time, zero to follow the clock again
+	void SetSimulatedSteps(int stepsPerFrame);
+	// set how often the pacing statistics are printed
+	void SetReportInterval(double seconds);
+	// returns true when a pacing report is due this frame
+	bool IsReportDue() const;
+	// print the pacing statistics to the console
+	void PrintFrameStats();
+};
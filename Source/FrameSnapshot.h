@@ -0,0 +1,137 @@
+///////////////////////////////////////////////////////////////////////////////
+// framesnapshot.h
+// ============
+// state of one frame handed from the update thread to the render thread -
+// camera, draw list and lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "SceneView.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// number of point lights kept in the light state, and read by the
+// shaders as TOTAL_POINT_LIGHTS
+const int MAX_POINT_LIGHTS = 6;
+
+struct DIRECTIONAL_LIGHT
+{
+	glm::vec3 direction;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	bool bActive;
+};
+
+struct POINT_LIGHT
+{
+	glm::vec3 position;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	bool bActive;
+};
+
+struct SPOT_LIGHT
+{
+	glm::vec3 position;
+	glm::vec3 direction;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+	float cutOff;
+	float outerCutOff;
+	bool bActive;
+};
+
+/***********************************************************
+ *  LIGHT_STATE
+ *
+ *  The light sources of the 3D scene, in the form they are
+ *  passed into the shader.
+ ***********************************************************/
+struct LIGHT_STATE
+{
+	bool bUseLighting;
+	DIRECTIONAL_LIGHT directionalLight;
+	POINT_LIGHT pointLights[MAX_POINT_LIGHTS];
+	SPOT_LIGHT spotLight;
+};
+
+// a static batch of a streamed world cell
+struct CELL_BATCH
+{
+	// slot of the world streamer the cell is loaded in
+	int cellSlot;
+	int batch;
+};
+
+/***********************************************************
+ *  FRAME_SNAPSHOT
+ *
+ *  Everything the render thread needs to draw one frame.  The
+ *  update thread fills a snapshot and publishes it through a
+ *  triple buffer, so the render thread never reads state that
+ *  the update thread is still changing.
+ ***********************************************************/
+struct FRAME_SNAPSHOT
+{
+	uint64_t frameIndex;
+	// camera
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	// camera the view was built from, for latching it again
+	// just before the frame is drawn
+	SceneView::CAMERA_LATCH cameraLatch;
+	// views drawn side by side in one pass, the first one matching
+	// the camera above - a single view is drawn from the camera alone
+	int viewCount;
+	SceneView::FRAME_VIEW views[SceneView::MAX_VIEWS];
+	// size of the window framebuffer
+	int framebufferWidth;
+	int framebufferHeight;
+	// sorted draw list
+	std::vector<RENDER_COMMAND> commands;
+	// static batches that passed the frustum test
+	std::vector<int> staticBatches;
+	// static batches of the streamed world cells that are visible
+	std::vector<CELL_BATCH> cellBatches;
+	// lights, only uploaded when the version changes
+	LIGHT_STATE lights;
+	uint32_t lightVersion;
+	// objects left out by the culling of the recording
+	uint32_t objectsCulled;
+	// print the render thread statistics with this frame
+	bool bPrintStats;
+	// draw the counter overlay over this frame
+	bool bShowCounters;
+
+	FRAME_SNAPSHOT()
+	{
+		frameIndex = 0;
+		view = glm::mat4(1.0f);
+		projection = glm::mat4(1.0f);
+		viewPosition = glm::vec3(0.0f);
+		cameraLatch.inputSerial = 0;
+		cameraLatch.bLateLatch = false;
+		viewCount = 1;
+		framebufferWidth = 0;
+		framebufferHeight = 0;
+		lightVersion = 0;
+		objectsCulled = 0;
+		bPrintStats = false;
+		bShowCounters = false;
+	}
+};
@@ -0,0 +1,686 @@
+///////////////////////////////////////////////////////////////////////////////
+// framestreamer.cpp
+// ============
+// stream the rendered frames as raw RGB or YUV420 video to stdout or a named
+// pipe at a fixed frame rate - asynchronous readback and a writer thread
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameStreamer.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#endif
+
+// the YUV conversion uses SSE2, which every x64 processor has
+#if defined(_M_X64) || defined(__SSE2__)
+#define STREAM_SIMD 1
+#include <emmintrin.h>
+#endif
+
+// declaration of global variables
+namespace
+{
+	// pixel buffers in the readback ring
+	const int g_ReadbackCount = 3;
+	// frames that can wait for the consumer, beyond the one written
+	const int g_FrameBufferCount = 4;
+	// how long the last readbacks are waited for when the stream closes
+	const GLuint64 g_FenceTimeout = 1000000000;
+
+	int64_t ElapsedMicroseconds(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+	}
+
+	/***********************************************************
+	 *  ConvertLumaRow()
+	 *
+	 *  Convert a row of RGBA8 pixels into BT.601 luma, eight
+	 *  pixels at a time with SSE2 and the rest one at a time.
+	 *  Both paths round the same way, so they give the same
+	 *  bytes.
+	 ***********************************************************/
+	void ConvertLumaRow(const unsigned char* pRow, int width, bool bSimd, unsigned char* pOutput)
+	{
+		int x = 0;
+#if defined(STREAM_SIMD)
+		if (bSimd == true)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i coefficients = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+			const __m128i rounding = _mm_set1_epi32(128);
+			const __m128i offset = _mm_set1_epi32(16);
+			for (; x + 8 <= width; x += 8)
+			{
+				__m128i luma[2];
+				for (int half = 0; half < 2; half++)
+				{
+					__m128i pixels = _mm_loadu_si128((const __m128i*)(pRow + ((x + (half * 4)) * 4)));
+					// R*66 + G*129 and B*25 of each pixel, then their sum
+					__m128 low = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coefficients));
+					__m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coefficients));
+					__m128i sum = _mm_add_epi32(
+						_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))),
+						_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+					luma[half] = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum, rounding), 8), offset);
+				}
+				__m128i words = _mm_packs_epi32(luma[0], luma[1]);
+				_mm_storel_epi64((__m128i*)(pOutput + x), _mm_packus_epi16(words, words));
+			}
+		}
+#endif
+		for (; x < width; x++)
+		{
+			const unsigned char* pPixel = pRow + (x * 4);
+			pOutput[x] = (unsigned char)((((66 * pPixel[0]) + (129 * pPixel[1]) + (25 * pPixel[2]) + 128) >> 8) + 16);
+		}
+	}
+
+	/***********************************************************
+	 *  ConvertChromaRows()
+	 *
+	 *  Convert two rows of RGBA8 pixels into BT.601 chroma at
+	 *  half the size, averaging each 2x2 block of pixels first,
+	 *  four blocks at a time with SSE2 and the rest one at a
+	 *  time.
+	 ***********************************************************/
+	void ConvertChromaRows(
+		const unsigned char* pTopRow,
+		const unsigned char* pBottomRow,
+		int blockCount,
+		bool bSimd,
+		unsigned char* pU,
+		unsigned char* pV)
+	{
+		int block = 0;
+#if defined(STREAM_SIMD)
+		if (bSimd == true)
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i uCoefficients = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+			const __m128i vCoefficients = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+			const __m128i averageRounding = _mm_set1_epi16(2);
+			const __m128i rounding = _mm_set1_epi32(128);
+			const __m128i offset = _mm_set1_epi32(128);
+			for (; block + 4 <= blockCount; block += 4)
+			{
+				// average the four pixels of each block, two blocks a register
+				__m128i averages[2];
+				for (int half = 0; half < 2; half++)
+				{
+					int byteOffset = (block + (half * 2)) * 8;
+					__m128i top = _mm_loadu_si128((const __m128i*)(pTopRow + byteOffset));
+					__m128i bottom = _mm_loadu_si128((const __m128i*)(pBottomRow + byteOffset));
+					__m128i columns01 = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+					__m128i columns23 = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+					__m128i sums = _mm_add_epi16(
+						_mm_unpacklo_epi64(columns01, columns23),
+						_mm_unpackhi_epi64(columns01, columns23));
+					averages[half] = _mm_srli_epi16(_mm_add_epi16(sums, averageRounding), 2);
+				}
+
+				unsigned char* pOutputs[2] = { pU + block, pV + block };
+				const __m128i* pCoefficients[2] = { &uCoefficients, &vCoefficients };
+				for (int plane = 0; plane < 2; plane++)
+				{
+					__m128 low = _mm_castsi128_ps(_mm_madd_epi16(averages[0], *pCoefficients[plane]));
+					__m128 high = _mm_castsi128_ps(_mm_madd_epi16(averages[1], *pCoefficients[plane]));
+					__m128i sum = _mm_add_epi32(
+						_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))),
+						_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+					__m128i chroma = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum, rounding), 8), offset);
+					__m128i words = _mm_packs_epi32(chroma, chroma);
+					int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+					memcpy(pOutputs[plane], &bytes, 4);
+				}
+			}
+		}
+#endif
+		for (; block < blockCount; block++)
+		{
+			const unsigned char* pTop = pTopRow + (block * 8);
+			const unsigned char* pBottom = pBottomRow + (block * 8);
+			int r = (pTop[0] + pTop[4] + pBottom[0] + pBottom[4] + 2) >> 2;
+			int g = (pTop[1] + pTop[5] + pBottom[1] + pBottom[5] + 2) >> 2;
+			int b = (pTop[2] + pTop[6] + pBottom[2] + pBottom[6] + 2) >> 2;
+			pU[block] = (unsigned char)((((-38 * r) - (74 * g) + (112 * b) + 128) >> 8) + 128);
+			pV[block] = (unsigned char)((((112 * r) - (94 * g) - (18 * b) + 128) >> 8) + 128);
+		}
+	}
+}
+
+/***********************************************************
+ *  FrameStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameStreamer::FrameStreamer()
+{
+	m_format = STREAM_RGB24;
+	m_bSimd = true;
+	m_width = 0;
+	m_height = 0;
+	m_streamWidth = 0;
+	m_streamHeight = 0;
+	m_frameSize = 0;
+	m_framePeriod = std::chrono::steady_clock::duration::zero();
+	m_bStarted = false;
+	m_oldestReadback = 0;
+	m_nextReadback = 0;
+	m_firstQueued = 0;
+	m_queuedCount = 0;
+	m_bWriterRunning = false;
+	m_framesWritten = 0;
+	m_framesRepeated = 0;
+	m_closedDrops = 0;
+	m_bytesWritten = 0;
+	m_convertMicroseconds = 0;
+	m_writeMicroseconds = 0;
+	m_bConsumerClosed = false;
+	m_stats = {};
+}
+
+/***********************************************************
+ *  ~FrameStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameStreamer::~FrameStreamer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the readback ring and the
+ *  frame buffers, and for starting the writer thread.  The
+ *  writer thread opens the output, as opening a named pipe
+ *  waits until the consumer opens its end.
+ ***********************************************************/
+bool FrameStreamer::Initialize(
+	const char* outputName,
+	STREAM_FORMAT format,
+	int width,
+	int height,
+	float framesPerSecond,
+	bool bSimd)
+{
+	m_outputName = outputName;
+	m_format = format;
+	m_bSimd = bSimd;
+#if !defined(STREAM_SIMD)
+	m_bSimd = false;
+#endif
+	m_width = width;
+	m_height = height;
+	m_streamWidth = width;
+	m_streamHeight = height;
+	if (STREAM_YUV420 == format)
+	{
+		m_streamWidth &= ~1;
+		m_streamHeight &= ~1;
+	}
+	if ((m_streamWidth <= 0) || (m_streamHeight <= 0) || (framesPerSecond <= 0.0f))
+	{
+		std::cout << "ERROR: Could not stream " << width << "x" << height
+			<< " frames at " << framesPerSecond << " fps" << std::endl;
+		return(false);
+	}
+
+	size_t pixelCount = (size_t)m_streamWidth * m_streamHeight;
+	m_frameSize = (STREAM_YUV420 == format) ? (pixelCount + (pixelCount / 2)) : (pixelCount * 3);
+	m_framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(1.0 / framesPerSecond));
+
+	size_t readbackSize = (size_t)width * height * 4;
+	m_readbacks.resize(g_ReadbackCount);
+	for (int i = 0; i < g_ReadbackCount; i++)
+	{
+		READBACK_SLOT& slot = m_readbacks[i];
+		glGenBuffers(1, &slot.bufferID);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+		glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, NULL, GL_STREAM_READ);
+		MemoryTracker::TrackBuffer(slot.bufferID, MemoryTracker::MEMORY_GPU_BUFFERS, "stream readback", readbackSize);
+		slot.fence = 0;
+		slot.repeatCount = 0;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	for (int i = 0; i < g_FrameBufferCount; i++)
+	{
+		FRAME_BUFFER* pBuffer = new FRAME_BUFFER();
+		pBuffer->pixels.resize(readbackSize);
+		pBuffer->repeatCount = 0;
+		m_frameBuffers.push_back(pBuffer);
+		m_freeBuffers.push_back(pBuffer);
+	}
+	m_queuedBuffers.assign(g_FrameBufferCount, NULL);
+	m_firstQueued = 0;
+	m_queuedCount = 0;
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_RENDERING,
+		"stream frame buffers", (size_t)g_FrameBufferCount * readbackSize);
+
+#ifndef _WIN32
+	// a consumer that exits must fail the write, not end the application
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	m_bWriterRunning = true;
+	m_writerThread = std::thread(&FrameStreamer::WriterMain, this);
+
+	const char* pixelFormat = (STREAM_YUV420 == format) ? "yuv420p" : "rgb24";
+	std::cout << "INFO: Streaming " << m_streamWidth << "x" << m_streamHeight << " " << pixelFormat
+		<< " frames at " << framesPerSecond << " fps to " << m_outputName
+		<< ", read them with: ffmpeg -f rawvideo -pixel_format " << pixelFormat
+		<< " -video_size " << m_streamWidth << "x" << m_streamHeight
+		<< " -framerate " << framesPerSecond << " -i " << m_outputName << " ..." << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for reading back the frame drawn into
+ *  the window, when a stream frame is due.  Readbacks whose
+ *  fences have passed are handed to the writer first.  The
+ *  frame is dropped when the next pixel buffer of the ring is
+ *  still in flight, or when the window has been resized.
+ ***********************************************************/
+void FrameStreamer::Capture(int framebufferWidth, int framebufferHeight)
+{
+	if (m_readbacks.empty() == true)
+	{
+		return;
+	}
+
+	RetireReadbacks();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (m_bStarted == false)
+	{
+		m_nextFrameTime = now;
+		m_bStarted = true;
+	}
+	if (now < m_nextFrameTime)
+	{
+		return;
+	}
+
+	// every stream frame that fell due since the last one is
+	// taken from this frame
+	int dueCount = 1 + (int)((now - m_nextFrameTime) / m_framePeriod);
+	m_nextFrameTime += m_framePeriod * dueCount;
+
+	if (m_bConsumerClosed.load() == true)
+	{
+		m_closedDrops += dueCount;
+		return;
+	}
+	if ((framebufferWidth != m_width) || (framebufferHeight != m_height))
+	{
+		m_stats.sizeDrops += dueCount;
+		return;
+	}
+
+	READBACK_SLOT& slot = m_readbacks[m_nextReadback];
+	if (slot.repeatCount > 0)
+	{
+		m_stats.readbackDrops += dueCount;
+		return;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glReadBuffer(GL_BACK);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.repeatCount = dueCount;
+
+	m_nextReadback = (m_nextReadback + 1) % (int)m_readbacks.size();
+}
+
+/***********************************************************
+ *  RetireReadbacks()
+ *
+ *  This method is used for mapping the readbacks whose fences
+ *  have passed, in the order they were queued, and for handing
+ *  their pixels to the writer thread.  A fence that has not
+ *  passed is not waited for, it is tried again next frame.
+ ***********************************************************/
+void FrameStreamer::RetireReadbacks()
+{
+	while (m_readbacks[m_oldestReadback].repeatCount > 0)
+	{
+		READBACK_SLOT& slot = m_readbacks[m_oldestReadback];
+		GLenum waitResult = glClientWaitSync(slot.fence, 0, 0);
+		if ((GL_ALREADY_SIGNALED != waitResult) && (GL_CONDITION_SATISFIED != waitResult))
+		{
+			break;
+		}
+		glDeleteSync(slot.fence);
+		slot.fence = 0;
+
+		FRAME_BUFFER* pBuffer = NULL;
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			if (m_freeBuffers.empty() == false)
+			{
+				pBuffer = m_freeBuffers.back();
+				m_freeBuffers.pop_back();
+			}
+		}
+
+		if (NULL == pBuffer)
+		{
+			m_stats.consumerDrops += slot.repeatCount;
+		}
+		else
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.bufferID);
+			const void* pMapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, pBuffer->pixels.size(), GL_MAP_READ_BIT);
+			if (NULL != pMapped)
+			{
+				memcpy(&pBuffer->pixels[0], pMapped, pBuffer->pixels.size());
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			pBuffer->repeatCount = slot.repeatCount;
+			{
+				std::lock_guard<std::mutex> lock(m_queueMutex);
+				if (NULL != pMapped)
+				{
+					m_queuedBuffers[(m_firstQueued + m_queuedCount) % m_queuedBuffers.size()] = pBuffer;
+					m_queuedCount++;
+				}
+				else
+				{
+					m_freeBuffers.push_back(pBuffer);
+					m_stats.readbackDrops += slot.repeatCount;
+				}
+			}
+			m_queueCondition.notify_one();
+		}
+
+		slot.repeatCount = 0;
+		m_oldestReadback = (m_oldestReadback + 1) % (int)m_readbacks.size();
+	}
+}
+
+/***********************************************************
+ *  WriterMain()
+ *
+ *  This method is the main function of the writer thread.  It
+ *  opens the output, then converts every queued frame and
+ *  writes it as many times as stream frames fell due for it.
+ *  Once a write fails, the consumer is taken to be gone and
+ *  the frames that follow are dropped.
+ ***********************************************************/
+void FrameStreamer::WriterMain()
+{
+	FILE* pFile = NULL;
+	if (m_outputName == "-")
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		pFile = stdout;
+	}
+	else
+	{
+		pFile = fopen(m_outputName.c_str(), "wb");
+	}
+	if (NULL == pFile)
+	{
+		std::cerr << "ERROR: Could not open the frame stream " << m_outputName << std::endl;
+		m_bConsumerClosed = true;
+	}
+
+	std::vector<unsigned char> output(m_frameSize);
+	size_t stride = (size_t)m_width * 4;
+	while (true)
+	{
+		FRAME_BUFFER* pBuffer = NULL;
+		{
+			std::unique_lock<std::mutex> lock(m_queueMutex);
+			m_queueCondition.wait(lock, [this]
+			{
+				return((m_queuedCount > 0) || (m_bWriterRunning == false));
+			});
+			if (m_queuedCount == 0)
+			{
+				break;
+			}
+			pBuffer = m_queuedBuffers[m_firstQueued];
+			m_firstQueued = (m_firstQueued + 1) % m_queuedBuffers.size();
+			m_queuedCount--;
+		}
+
+		if (m_bConsumerClosed.load() == true)
+		{
+			m_closedDrops += pBuffer->repeatCount;
+		}
+		else
+		{
+			// an odd bottom row of the window is left out of YUV420 images
+			std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+			const unsigned char* pBottomRow = &pBuffer->pixels[0] + ((size_t)(m_height - m_streamHeight) * stride);
+			if (STREAM_YUV420 == m_format)
+			{
+				ConvertToYuv420(pBottomRow, m_streamWidth, m_streamHeight, stride, m_bSimd, &output[0]);
+			}
+			else
+			{
+				ConvertToRgb(pBottomRow, m_streamWidth, m_streamHeight, stride, &output[0]);
+			}
+			std::chrono::steady_clock::time_point convertedTime = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < pBuffer->repeatCount; i++)
+			{
+				if ((fwrite(&output[0], 1, output.size(), pFile) != output.size()) ||
+					(fflush(pFile) != 0))
+				{
+					std::cerr << "ERROR: The frame stream " << m_outputName << " was closed" << std::endl;
+					m_bConsumerClosed = true;
+					m_closedDrops += pBuffer->repeatCount - i;
+					break;
+				}
+				m_framesWritten++;
+				m_bytesWritten += output.size();
+				if (i > 0)
+				{
+					m_framesRepeated++;
+				}
+			}
+
+			m_convertMicroseconds += ElapsedMicroseconds(startTime, convertedTime);
+			m_writeMicroseconds += ElapsedMicroseconds(convertedTime, std::chrono::steady_clock::now());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_queueMutex);
+			m_freeBuffers.push_back(pBuffer);
+		}
+	}
+
+	if ((NULL != pFile) && (stdout != pFile))
+	{
+		fclose(pFile);
+	}
+}
+
+/***********************************************************
+ *  ConvertToRgb()
+ *
+ *  This method is used for converting bottom up RGBA8 pixels
+ *  into top down rgb24.
+ ***********************************************************/
+void FrameStreamer::ConvertToRgb(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	size_t stride,
+	unsigned char* pOutput)
+{
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* pRow = pPixels + ((size_t)(height - 1 - y) * stride);
+		unsigned char* pOutputRow = pOutput + ((size_t)y * width * 3);
+		for (int x = 0; x < width; x++)
+		{
+			pOutputRow[(x * 3) + 0] = pRow[(x * 4) + 0];
+			pOutputRow[(x * 3) + 1] = pRow[(x * 4) + 1];
+			pOutputRow[(x * 3) + 2] = pRow[(x * 4) + 2];
+		}
+	}
+}
+
+/***********************************************************
+ *  ConvertToYuv420()
+ *
+ *  This method is used for converting bottom up RGBA8 pixels
+ *  of an even size into top down yuv420p: the luma plane,
+ *  then the U and V planes at half the width and height.
+ ***********************************************************/
+void FrameStreamer::ConvertToYuv420(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	size_t stride,
+	bool bSimd,
+	unsigned char* pOutput)
+{
+	size_t pixelCount = (size_t)width * height;
+	int chromaWidth = width / 2;
+	unsigned char* pU = pOutput + pixelCount;
+	unsigned char* pV = pU + (pixelCount / 4);
+
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* pRow = pPixels + ((size_t)(height - 1 - y) * stride);
+		ConvertLumaRow(pRow, width, bSimd, pOutput + ((size_t)y * width));
+	}
+
+	for (int y = 0; y < height / 2; y++)
+	{
+		const unsigned char* pTopRow = pPixels + ((size_t)(height - 1 - (y * 2)) * stride);
+		ConvertChromaRows(
+			pTopRow,
+			pTopRow - stride,
+			chromaWidth,
+			bSimd,
+			pU + ((size_t)y * chromaWidth),
+			pV + ((size_t)y * chromaWidth));
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting for the readbacks still in
+ *  flight, for writing the frames still queued and for freeing
+ *  the OpenGL objects.  The writer thread is joined, so this
+ *  waits for the consumer to take the queued frames.
+ ***********************************************************/
+void FrameStreamer::Destroy()
+{
+	if (m_readbacks.empty() == true)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		if (0 != m_readbacks[i].fence)
+		{
+			glClientWaitSync(m_readbacks[i].fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeout);
+		}
+	}
+	RetireReadbacks();
+
+	{
+		std::lock_guard<std::mutex> lock(m_queueMutex);
+		m_bWriterRunning = false;
+	}
+	m_queueCondition.notify_one();
+	if (m_writerThread.joinable() == true)
+	{
+		m_writerThread.join();
+	}
+
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		if (0 != m_readbacks[i].fence)
+		{
+			glDeleteSync(m_readbacks[i].fence);
+		}
+		glDeleteBuffers(1, &m_readbacks[i].bufferID);
+		MemoryTracker::ReleaseBuffer(m_readbacks[i].bufferID);
+	}
+	m_readbacks.clear();
+
+	for (size_t i = 0; i < m_frameBuffers.size(); i++)
+	{
+		delete m_frameBuffers[i];
+	}
+	m_frameBuffers.clear();
+	m_freeBuffers.clear();
+	m_queuedBuffers.clear();
+	m_firstQueued = 0;
+	m_queuedCount = 0;
+	MemoryTracker::ReleaseHeap(this);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the stream statistics,
+ *  with the figures of the writer thread so far.
+ ***********************************************************/
+const FrameStreamer::STREAM_STATS& FrameStreamer::GetStats()
+{
+	m_stats.framesWritten = m_framesWritten.load();
+	m_stats.framesRepeated = m_framesRepeated.load();
+	m_stats.closedDrops = m_closedDrops.load();
+	m_stats.bytesWritten = m_bytesWritten.load();
+	m_stats.convertMs = m_convertMicroseconds.load() / 1000.0;
+	m_stats.writeMs = m_writeMicroseconds.load() / 1000.0;
+
+	return(m_stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the stream statistics to
+ *  the console.
+ ***********************************************************/
+void FrameStreamer::PrintStats()
+{
+	const STREAM_STATS& stats = GetStats();
+	uint64_t convertedFrames = stats.framesWritten - stats.framesRepeated;
+	std::cout << "STREAM: " << stats.framesWritten << " frames written"
+		<< " (" << stats.framesRepeated << " repeated)"
+		<< ", dropped " << stats.readbackDrops << " readback busy"
+		<< ", " << stats.consumerDrops << " consumer busy"
+		<< ", " << stats.sizeDrops << " resized"
+		<< ", " << stats.closedDrops << " closed"
+		<< ", converting " << ((convertedFrames > 0) ? (stats.convertMs / convertedFrames) : 0.0) << " ms/frame"
+		<< (m_bSimd ? " (SSE2)" : " (scalar)")
+		<< ", writing " << stats.writeMs << " ms"
+		<< ", " << (stats.bytesWritten / (1024 * 1024)) << " MB"
+		<< std::endl;
+}
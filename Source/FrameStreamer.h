@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// framestreamer.h
+// ============
+// stream the rendered frames as raw RGB or YUV420 video to stdout or a named
+// pipe at a fixed frame rate - asynchronous readback and a writer thread
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameStreamer
+ *
+ *  This class writes the frames drawn into the window as raw
+ *  video, for an encoder such as ffmpeg to read from stdout
+ *  or from a named pipe.  Frames are taken at a fixed frame
+ *  rate: a frame drawn when no stream frame is due is not
+ *  read back, and a frame drawn after several stream frames
+ *  fell due is written that many times, so the stream keeps
+ *  its rate when the window draws slower than it.
+ *
+ *  The drawing thread never waits for the stream.  A frame is
+ *  read back with glReadPixels into the next pixel buffer of
+ *  a ring, which returns at once, and the pixel buffer is
+ *  only mapped once its fence has passed.  The mapped pixels
+ *  are copied into a free frame buffer and handed to a writer
+ *  thread, which converts and writes them.  When the readback
+ *  ring or every frame buffer is still busy, the frame is
+ *  dropped and counted instead.
+ *
+ *  The output is rgb24, or yuv420p in BT.601 limited range,
+ *  top row first.  YUV420 images have even sizes, so an odd
+ *  last row or column of the window is left out.
+ ***********************************************************/
+class FrameStreamer
+{
+public:
+	// constructor
+	FrameStreamer();
+	// destructor
+	~FrameStreamer();
+
+	enum STREAM_FORMAT
+	{
+		STREAM_RGB24 = 0,
+		STREAM_YUV420 = 1
+	};
+
+	struct STREAM_STATS
+	{
+		// frames of the stream and the frames written more than once
+		// to keep the rate
+		uint64_t framesWritten;
+		uint64_t framesRepeated;
+		// frames dropped while the readback ring was busy, while every
+		// frame buffer waited for the consumer, while the window size
+		// differed from the stream's, and after the consumer closed
+		uint64_t readbackDrops;
+		uint64_t consumerDrops;
+		uint64_t sizeDrops;
+		uint64_t closedDrops;
+		uint64_t bytesWritten;
+		// time spent converting, and waiting for the consumer to take
+		// the data, on the writer thread
+		double convertMs;
+		double writeMs;
+	};
+
+	// convert bottom up RGBA8 pixels, as OpenGL reads them back, into
+	// top down rgb24 or yuv420p, with SSE2 where it is available
+	static void ConvertToRgb(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		size_t stride,
+		unsigned char* pOutput);
+	static void ConvertToYuv420(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		size_t stride,
+		bool bSimd,
+		unsigned char* pOutput);
+
+private:
+	// a pixel buffer of the readback ring
+	struct READBACK_SLOT
+	{
+		GLuint bufferID;
+		GLsync fence;
+		// times the frame is written into the stream, 0 for a
+		// slot without a readback in flight
+		int repeatCount;
+	};
+
+	// pixels handed to the writer thread
+	struct FRAME_BUFFER
+	{
+		std::vector<unsigned char> pixels;
+		int repeatCount;
+	};
+
+	std::string m_outputName;
+	STREAM_FORMAT m_format;
+	bool m_bSimd;
+	// size of the window, and of the stream images
+	int m_width;
+	int m_height;
+	int m_streamWidth;
+	int m_streamHeight;
+	size_t m_frameSize;
+
+	// fixed rate clock of the stream
+	std::chrono::steady_clock::duration m_framePeriod;
+	std::chrono::steady_clock::time_point m_nextFrameTime;
+	bool m_bStarted;
+
+	std::vector<READBACK_SLOT> m_readbacks;
+	// oldest readback in flight, and the slot of the next one
+	int m_oldestReadback;
+	int m_nextReadback;
+
+	// frame buffers, free or waiting for the writer
+	std::vector<FRAME_BUFFER*> m_frameBuffers;
+	std::vector<FRAME_BUFFER*> m_freeBuffers;
+	// ring of the buffers waiting for the writer, with room for every
+	// buffer so queueing a frame never allocates
+	std::vector<FRAME_BUFFER*> m_queuedBuffers;
+	size_t m_firstQueued;
+	size_t m_queuedCount;
+	std::mutex m_queueMutex;
+	std::condition_variable m_queueCondition;
+	bool m_bWriterRunning;
+	std::thread m_writerThread;
+
+	// statistics, the writer figures are added to by the writer thread
+	std::atomic<uint64_t> m_framesWritten;
+	std::atomic<uint64_t> m_framesRepeated;
+	std::atomic<uint64_t> m_closedDrops;
+	std::atomic<uint64_t> m_bytesWritten;
+	std::atomic<int64_t> m_convertMicroseconds;
+	std::atomic<int64_t> m_writeMicroseconds;
+	std::atomic<bool> m_bConsumerClosed;
+	STREAM_STATS m_stats;
+
+	// map the readbacks whose fences have passed
+	void RetireReadbacks();
+	// open the output, then convert and write the queued frames
+	void WriterMain();
+
+public:
+	// create the readback ring and start the writer thread, the
+	// output is a file name, a named pipe or "-" for stdout
+	bool Initialize(
+		const char* outputName,
+		STREAM_FORMAT format,
+		int width,
+		int height,
+		float framesPerSecond,
+		bool bSimd);
+	// read back the frame drawn into the window, if a stream frame
+	// is due, before the window is swapped
+	void Capture(int framebufferWidth, int framebufferHeight);
+	// write the frames still queued and close the output
+	void Destroy();
+
+	const STREAM_STATS& GetStats();
+	void PrintStats();
+};
@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.cpp
+// ============
+// encode rendered RGBA frames into TGA images and write them to disk
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	const size_t g_TgaHeaderSize = 18;
+	// longest run or literal packet of a run-length encoded TGA
+	const int g_MaxPacketPixels = 128;
+}
+
+/***********************************************************
+ *  EncodeTga()
+ *
+ *  This method is used for encoding RGBA8 pixels into a
+ *  24-bit TGA image with its origin at the top left.  Run
+ *  length encoding packs runs of the same color, which keeps
+ *  the flat backgrounds of rendered images small.
+ ***********************************************************/
+void ImageWriter::EncodeTga(
+	const unsigned char* pPixels,
+	int width,
+	int height,
+	size_t stride,
+	bool bBottomUp,
+	bool bRunLength,
+	std::vector<unsigned char>& output)
+{
+	output.clear();
+	output.reserve(g_TgaHeaderSize + ((size_t)width * height * 3));
+	output.resize(g_TgaHeaderSize, 0);
+
+	// uncompressed or run-length encoded true color, 24 bits,
+	// origin at the top left
+	output[2] = bRunLength ? 10 : 2;
+	output[12] = (unsigned char)(width & 0xff);
+	output[13] = (unsigned char)((width >> 8) & 0xff);
+	output[14] = (unsigned char)(height & 0xff);
+	output[15] = (unsigned char)((height >> 8) & 0xff);
+	output[16] = 24;
+	output[17] = 0x20;
+
+	for (int y = 0; y < height; y++)
+	{
+		int sourceRow = bBottomUp ? (height - 1 - y) : y;
+		const unsigned char* pRow = pPixels + ((size_t)sourceRow * stride);
+
+		if (bRunLength == false)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const unsigned char* pPixel = pRow + (x * 4);
+				output.push_back(pPixel[2]);
+				output.push_back(pPixel[1]);
+				output.push_back(pPixel[0]);
+			}
+			continue;
+		}
+
+		// packets do not cross rows, as the format recommends
+		int x = 0;
+		while (x < width)
+		{
+			const unsigned char* pPixel = pRow + (x * 4);
+			int run = 1;
+			while ((x + run < width) && (run < g_MaxPacketPixels) &&
+				(pPixel[(run * 4) + 0] == pPixel[0]) &&
+				(pPixel[(run * 4) + 1] == pPixel[1]) &&
+				(pPixel[(run * 4) + 2] == pPixel[2]))
+			{
+				run++;
+			}
+
+			if (run > 1)
+			{
+				output.push_back((unsigned char)(0x80 | (run - 1)));
+				output.push_back(pPixel[2]);
+				output.push_back(pPixel[1]);
+				output.push_back(pPixel[0]);
+				x += run;
+				continue;
+			}
+
+			// a literal packet lasts until the next run of two
+			int literal = 1;
+			while ((x + literal < width) && (literal < g_MaxPacketPixels))
+			{
+				const unsigned char* pNext = pRow + ((x + literal) * 4);
+				if ((x + literal + 1 < width) &&
+					(pNext[0] == pNext[4]) && (pNext[1] == pNext[5]) && (pNext[2] == pNext[6]))
+				{
+					break;
+				}
+				literal++;
+			}
+
+			output.push_back((unsigned char)(literal - 1));
+			for (int i = 0; i < literal; i++)
+			{
+				const unsigned char* pLiteral = pPixel + (i * 4);
+				output.push_back(pLiteral[2]);
+				output.push_back(pLiteral[1]);
+				output.push_back(pLiteral[0]);
+			}
+			x += literal;
+		}
+	}
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method is used for writing an encoded image to a
+ *  file.
+ ***********************************************************/
+bool ImageWriter::WriteFile(const char* filename, const std::vector<unsigned char>& data)
+{
+	FILE* pFile = fopen(filename, "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: Could not write image:" << filename << std::endl;
+		return(false);
+	}
+
+	bool bWritten = (data.empty() == true) || (fwrite(&data[0], 1, data.size(), pFile) == data.size());
+	bWritten = (fclose(pFile) == 0) && bWritten;
+	if (bWritten == false)
+	{
+		std::cout << "ERROR: Could not write image:" << filename << std::endl;
+	}
+
+	return(bWritten);
+}
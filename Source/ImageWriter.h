@@ -0,0 +1,37 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// encode rendered RGBA frames into TGA images and write them to disk
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  ImageWriter
+ *
+ *  This class encodes RGBA8 pixels into 24-bit TGA images,
+ *  uncompressed or run-length encoded.  Encoding only reads
+ *  the passed in pixels and writes the passed in output, so
+ *  several images can be encoded at once on the workers of
+ *  the job system.
+ ***********************************************************/
+class ImageWriter
+{
+public:
+	// encode RGBA8 pixels into a TGA image, rows are stride bytes
+	// apart, and the first row is the bottom of the image when
+	// bBottomUp is set, as OpenGL reads them back
+	static void EncodeTga(
+		const unsigned char* pPixels,
+		int width,
+		int height,
+		size_t stride,
+		bool bBottomUp,
+		bool bRunLength,
+		std::vector<unsigned char>& output);
+	// write an encoded image to a file
+	static bool WriteFile(const char* filename, const std::vector<unsigned char>& data);
+};
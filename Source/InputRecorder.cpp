@@ -0,0 +1,410 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.cpp
+// ============
+// record the camera input of every fixed update step into a compact binary
+// log, and replay it so that runs follow the same camera path
+///////////////////////////////////////////////////////////////////////////////
+
+#include "InputRecorder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	void StoreVector(const glm::vec3& vector, float* pValues)
+	{
+		pValues[0] = vector.x;
+		pValues[1] = vector.y;
+		pValues[2] = vector.z;
+	}
+
+	glm::vec3 LoadVector(const float* pValues)
+	{
+		return(glm::vec3(pValues[0], pValues[1], pValues[2]));
+	}
+}
+
+/***********************************************************
+ *  InputRecorder()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+InputRecorder::InputRecorder()
+{
+	m_mode = MODE_OFF;
+	m_header = {};
+	m_step = 0;
+	m_nextEvent = 0;
+	m_nextCamera = 0;
+	m_keys = 0;
+	m_checkpointsChecked = 0;
+	m_maxPositionError = 0.0f;
+	m_maxFrontError = 0.0f;
+}
+
+/***********************************************************
+ *  ~InputRecorder()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+InputRecorder::~InputRecorder()
+{
+	m_events.clear();
+	m_cameras.clear();
+}
+
+/***********************************************************
+ *  BeginRecording()
+ *
+ *  This method is used for starting to record the input of
+ *  the update steps.  Nothing is written until Finish(), so
+ *  recording does not touch the disk while frames are timed.
+ ***********************************************************/
+bool InputRecorder::BeginRecording(const char* filename, float fixedTimestep)
+{
+	if (fixedTimestep <= 0.0f)
+	{
+		std::cout << "ERROR: Could not record input with a step of " << fixedTimestep << " s" << std::endl;
+		return(false);
+	}
+
+	m_mode = MODE_RECORD;
+	m_filename = filename;
+	m_header = {};
+	m_header.magic = INPUT_LOG_MAGIC;
+	m_header.version = INPUT_LOG_VERSION;
+	m_header.headerSize = sizeof(INPUT_LOG_HEADER);
+	m_header.fixedTimestep = fixedTimestep;
+	m_events.clear();
+	m_cameras.clear();
+	m_step = 0;
+	m_keys = 0;
+
+	std::cout << "INFO: Recording input to " << m_filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  LoadReplay()
+ *
+ *  This method is used for reading an input log to replay.
+ *  The table counts are checked against the size of the file
+ *  before they are read, and the tables against the header
+ *  before anything of the log is used.
+ ***********************************************************/
+bool InputRecorder::LoadReplay(const char* filename)
+{
+	FILE* pFile = fopen(filename, "rb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: Could not open input log:" << filename << std::endl;
+		return(false);
+	}
+
+	INPUT_LOG_HEADER header = {};
+	bool bValid = (fread(&header, sizeof(header), 1, pFile) == 1) &&
+		(INPUT_LOG_MAGIC == header.magic) &&
+		(INPUT_LOG_VERSION == header.version) &&
+		(sizeof(INPUT_LOG_HEADER) == header.headerSize) &&
+		(header.fixedTimestep > 0.0f);
+	if (bValid == true)
+	{
+		// the tables have to fit in the rest of the file before
+		// their counts are trusted with an allocation
+		long tablesStart = ftell(pFile);
+		bValid = (tablesStart >= 0) && (fseek(pFile, 0, SEEK_END) == 0);
+		long fileSize = (bValid == true) ? ftell(pFile) : -1;
+		uint64_t tableBytes =
+			((uint64_t)header.eventCount * sizeof(INPUT_LOG_EVENT)) +
+			((uint64_t)header.checkpointCount * sizeof(INPUT_LOG_CAMERA));
+		bValid = (fileSize >= tablesStart) &&
+			(tableBytes <= (uint64_t)(fileSize - tablesStart)) &&
+			(fseek(pFile, tablesStart, SEEK_SET) == 0);
+	}
+	if (bValid == true)
+	{
+		m_events.resize(header.eventCount);
+		m_cameras.resize(header.checkpointCount);
+		bValid =
+			((header.eventCount == 0) || (fread(&m_events[0], sizeof(INPUT_LOG_EVENT), header.eventCount, pFile) == header.eventCount)) &&
+			((header.checkpointCount == 0) || (fread(&m_cameras[0], sizeof(INPUT_LOG_CAMERA), header.checkpointCount, pFile) == header.checkpointCount));
+	}
+	fclose(pFile);
+
+	// the events must be in step order, and name every checkpoint
+	uint32_t cameraEvents = 0;
+	for (size_t i = 0; (bValid == true) && (i < m_events.size()); i++)
+	{
+		bValid = (m_events[i].step <= header.stepCount) &&
+			((i == 0) || (m_events[i - 1].step <= m_events[i].step));
+		if (INPUT_EVENT_CAMERA == m_events[i].type)
+		{
+			cameraEvents++;
+		}
+	}
+	if ((bValid == false) || (cameraEvents != header.checkpointCount))
+	{
+		std::cout << "ERROR: Invalid input log:" << filename << std::endl;
+		m_events.clear();
+		m_cameras.clear();
+		return(false);
+	}
+
+	m_mode = MODE_REPLAY;
+	m_filename = filename;
+	m_header = header;
+	m_step = 0;
+	m_nextEvent = 0;
+	m_nextCamera = 0;
+	m_keys = 0;
+	m_checkpointsChecked = 0;
+	m_maxPositionError = 0.0f;
+	m_maxFrontError = 0.0f;
+
+	std::cout << "INFO: Replaying " << m_header.stepCount << " input steps of "
+		<< (m_header.fixedTimestep * 1000.0f) << " ms from " << m_filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  IsRecording()
+ *
+ *  This method is used for checking whether the input is
+ *  being recorded.
+ ***********************************************************/
+bool InputRecorder::IsRecording() const
+{
+	return(MODE_RECORD == m_mode);
+}
+
+/***********************************************************
+ *  IsReplaying()
+ *
+ *  This method is used for checking whether the input comes
+ *  from a replayed log.
+ ***********************************************************/
+bool InputRecorder::IsReplaying() const
+{
+	return(MODE_REPLAY == m_mode);
+}
+
+/***********************************************************
+ *  GetFixedTimestep()
+ *
+ *  This method is used for getting the update step length of
+ *  the log, in seconds.
+ ***********************************************************/
+float InputRecorder::GetFixedTimestep() const
+{
+	return(m_header.fixedTimestep);
+}
+
+/***********************************************************
+ *  GetStepCount()
+ *
+ *  This method is used for getting the number of update
+ *  steps of the replayed log.
+ ***********************************************************/
+uint32_t InputRecorder::GetStepCount() const
+{
+	return(m_header.stepCount);
+}
+
+/***********************************************************
+ *  AddCheckpoint()
+ *
+ *  This method is used for logging the camera state at the
+ *  start of the current step.
+ ***********************************************************/
+void InputRecorder::AddCheckpoint(const CAMERA_STATE& camera)
+{
+	INPUT_LOG_EVENT event = {};
+	event.step = m_step;
+	event.type = INPUT_EVENT_CAMERA;
+	m_events.push_back(event);
+
+	INPUT_LOG_CAMERA checkpoint = {};
+	StoreVector(camera.position, checkpoint.position);
+	StoreVector(camera.front, checkpoint.front);
+	StoreVector(camera.up, checkpoint.up);
+	StoreVector(camera.right, checkpoint.right);
+	checkpoint.yaw = camera.yaw;
+	checkpoint.pitch = camera.pitch;
+	checkpoint.zoom = camera.zoom;
+	checkpoint.projectionMode = (uint32_t)camera.projectionMode;
+	m_cameras.push_back(checkpoint);
+}
+
+/***********************************************************
+ *  ApplyCheckpoint()
+ *
+ *  This method is used for moving the replayed camera onto a
+ *  logged camera state, after measuring how far off it was.
+ ***********************************************************/
+void InputRecorder::ApplyCheckpoint(const INPUT_LOG_CAMERA& checkpoint, CAMERA_STATE& camera)
+{
+	glm::vec3 position = LoadVector(checkpoint.position);
+	glm::vec3 front = LoadVector(checkpoint.front);
+	m_maxPositionError = std::max(m_maxPositionError, glm::length(camera.position - position));
+	m_maxFrontError = std::max(m_maxFrontError, glm::length(camera.front - front));
+	m_checkpointsChecked++;
+
+	camera.position = position;
+	camera.front = front;
+	camera.up = LoadVector(checkpoint.up);
+	camera.right = LoadVector(checkpoint.right);
+	camera.yaw = checkpoint.yaw;
+	camera.pitch = checkpoint.pitch;
+	camera.zoom = checkpoint.zoom;
+	camera.projectionMode = (int)checkpoint.projectionMode;
+}
+
+/***********************************************************
+ *  RecordStep()
+ *
+ *  This method is used for logging the input of the next
+ *  update step.  Only changed keys and mouse movement add
+ *  events, and a checkpoint is added every CHECKPOINT_STEPS
+ *  steps.
+ ***********************************************************/
+void InputRecorder::RecordStep(const CAMERA_STATE& camera, const INPUT_STATE& input)
+{
+	if (MODE_RECORD != m_mode)
+	{
+		return;
+	}
+
+	if ((m_step % CHECKPOINT_STEPS) == 0)
+	{
+		AddCheckpoint(camera);
+	}
+
+	INPUT_LOG_EVENT event = {};
+	event.step = m_step;
+	if (input.keys != m_keys)
+	{
+		event.type = INPUT_EVENT_KEYS;
+		event.keys = input.keys;
+		m_events.push_back(event);
+		m_keys = input.keys;
+	}
+	if ((input.mouseOffset.x != 0.0f) || (input.mouseOffset.y != 0.0f))
+	{
+		event.type = INPUT_EVENT_MOUSE;
+		event.keys = 0;
+		event.mouseOffset[0] = input.mouseOffset.x;
+		event.mouseOffset[1] = input.mouseOffset.y;
+		m_events.push_back(event);
+	}
+
+	m_step++;
+}
+
+/***********************************************************
+ *  ReplayStep()
+ *
+ *  This method is used for getting the input of the next
+ *  update step from the log.  A checkpoint logged for the
+ *  step moves the camera onto it first.  After the last step
+ *  the final checkpoint is applied and false is returned.
+ ***********************************************************/
+bool InputRecorder::ReplayStep(CAMERA_STATE& camera, INPUT_STATE& input)
+{
+	input.keys = 0;
+	input.mouseOffset = glm::vec2(0.0f);
+	if (MODE_REPLAY != m_mode)
+	{
+		return(false);
+	}
+
+	while ((m_nextEvent < m_events.size()) && (m_events[m_nextEvent].step == m_step))
+	{
+		const INPUT_LOG_EVENT& event = m_events[m_nextEvent];
+		if (INPUT_EVENT_KEYS == event.type)
+		{
+			m_keys = event.keys;
+		}
+		else if (INPUT_EVENT_MOUSE == event.type)
+		{
+			input.mouseOffset += glm::vec2(event.mouseOffset[0], event.mouseOffset[1]);
+		}
+		else if (INPUT_EVENT_CAMERA == event.type)
+		{
+			ApplyCheckpoint(m_cameras[m_nextCamera], camera);
+			m_nextCamera++;
+		}
+		m_nextEvent++;
+	}
+
+	if (m_step >= m_header.stepCount)
+	{
+		return(false);
+	}
+
+	input.keys = m_keys;
+	m_step++;
+	return(true);
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method is used for writing a recorded log, ending
+ *  with the camera state after the last step.
+ ***********************************************************/
+bool InputRecorder::Finish(const CAMERA_STATE& camera)
+{
+	if (MODE_RECORD != m_mode)
+	{
+		return(true);
+	}
+	m_mode = MODE_OFF;
+
+	AddCheckpoint(camera);
+	m_header.stepCount = m_step;
+	m_header.eventCount = (uint32_t)m_events.size();
+	m_header.checkpointCount = (uint32_t)m_cameras.size();
+
+	FILE* pFile = fopen(m_filename.c_str(), "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: Could not write input log:" << m_filename << std::endl;
+		return(false);
+	}
+	bool bWritten = (fwrite(&m_header, sizeof(m_header), 1, pFile) == 1) &&
+		(fwrite(&m_events[0], sizeof(INPUT_LOG_EVENT), m_events.size(), pFile) == m_events.size()) &&
+		(fwrite(&m_cameras[0], sizeof(INPUT_LOG_CAMERA), m_cameras.size(), pFile) == m_cameras.size());
+	bWritten = (fclose(pFile) == 0) && bWritten;
+	if (bWritten == false)
+	{
+		std::cout << "ERROR: Could not write input log:" << m_filename << std::endl;
+		return(false);
+	}
+
+	std::cout << "INFO: Wrote " << m_header.stepCount << " input steps, "
+		<< m_header.eventCount << " events, to " << m_filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing how closely a replay
+ *  followed the logged camera path.
+ ***********************************************************/
+void InputRecorder::PrintStats() const
+{
+	if (MODE_REPLAY != m_mode)
+	{
+		return;
+	}
+
+	std::cout << "REPLAY: " << m_step << " of " << m_header.stepCount << " steps"
+		<< ", " << m_checkpointsChecked << " of " << m_header.checkpointCount << " checkpoints"
+		<< ", max position error " << m_maxPositionError
+		<< ", max direction error " << m_maxFrontError
+		<< std::endl;
+}
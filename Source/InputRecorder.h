@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// inputrecorder.h
+// ============
+// record the camera input of every fixed update step into a compact binary
+// log, and replay it so that runs follow the same camera path
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// "INPL" read as a little-endian 32-bit value
+const uint32_t INPUT_LOG_MAGIC = 0x4C504E49;
+const uint32_t INPUT_LOG_VERSION = 1;
+
+// the header is followed by the event table, then the camera table
+struct INPUT_LOG_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	// length of one update step, in seconds
+	float fixedTimestep;
+	uint32_t stepCount;
+	uint32_t eventCount;
+	uint32_t checkpointCount;
+	uint32_t reserved;
+};
+
+enum INPUT_LOG_EVENT_TYPE
+{
+	// the held keys changed
+	INPUT_EVENT_KEYS = 1,
+	// the mouse moved since the last step
+	INPUT_EVENT_MOUSE = 2,
+	// camera checkpoint, the next record of the camera table
+	INPUT_EVENT_CAMERA = 3
+};
+
+// an event, stamped with the update step it applies to
+struct INPUT_LOG_EVENT
+{
+	uint32_t step;
+	uint16_t type;
+	uint16_t keys;
+	float mouseOffset[2];
+};
+
+struct INPUT_LOG_CAMERA
+{
+	float position[3];
+	float front[3];
+	float up[3];
+	float right[3];
+	float yaw;
+	float pitch;
+	float zoom;
+	uint32_t projectionMode;
+};
+
+/***********************************************************
+ *  InputRecorder
+ *
+ *  This class records the camera input of every fixed update
+ *  step, and replays it.  The input of a step is the set of
+ *  held camera keys and the mouse movement since the last
+ *  step.  The log only holds the steps where they change, as
+ *  events stamped with the step index, so the time of an
+ *  event is its step times the fixed timestep.
+ *
+ *  The camera state is logged at the start of the first step
+ *  and every CHECKPOINT_STEPS steps after it, and once more
+ *  at the end.  A replay measures how far its camera is from
+ *  each logged state and then moves the camera onto it, so a
+ *  build whose floating point math differs slightly still
+ *  follows the recorded path.
+ *
+ *  A replay is driven by the frame scheduler's simulated time,
+ *  so it runs the same steps in the same frames whatever the
+ *  frame rate.
+ ***********************************************************/
+class InputRecorder
+{
+public:
+	// constructor
+	InputRecorder();
+	// destructor
+	~InputRecorder();
+
+	// update steps between camera checkpoints
+	static const uint32_t CHECKPOINT_STEPS = 60;
+
+	// camera keys held during a step
+	enum INPUT_KEYS
+	{
+		INPUT_KEY_FORWARD = 0x01,
+		INPUT_KEY_BACKWARD = 0x02,
+		INPUT_KEY_LEFT = 0x04,
+		INPUT_KEY_RIGHT = 0x08,
+		INPUT_KEY_UP = 0x10,
+		INPUT_KEY_DOWN = 0x20,
+		INPUT_KEY_PERSPECTIVE = 0x40,
+		INPUT_KEY_ORTHOGRAPHIC = 0x80
+	};
+
+	struct INPUT_STATE
+	{
+		uint16_t keys;
+		glm::vec2 mouseOffset;
+	};
+
+	struct CAMERA_STATE
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		glm::vec3 right;
+		float yaw;
+		float pitch;
+		float zoom;
+		int projectionMode;
+	};
+
+private:
+	enum RECORDER_MODE
+	{
+		MODE_OFF,
+		MODE_RECORD,
+		MODE_REPLAY
+	};
+
+	RECORDER_MODE m_mode;
+	std::string m_filename;
+	INPUT_LOG_HEADER m_header;
+	// the events are kept in memory and written when recording ends
+	std::vector<INPUT_LOG_EVENT> m_events;
+	std::vector<INPUT_LOG_CAMERA> m_cameras;
+	// step being recorded or replayed, and the next event to replay
+	uint32_t m_step;
+	size_t m_nextEvent;
+	size_t m_nextCamera;
+	// keys held at the last step
+	uint16_t m_keys;
+
+	// distance of the replayed camera from the checkpoints
+	uint32_t m_checkpointsChecked;
+	float m_maxPositionError;
+	float m_maxFrontError;
+
+	// add a camera checkpoint for the current step
+	void AddCheckpoint(const CAMERA_STATE& camera);
+	// move the camera onto a checkpoint, measuring how far off it was
+	void ApplyCheckpoint(const INPUT_LOG_CAMERA& checkpoint, CAMERA_STATE& camera);
+
+public:
+	// start recording, the log is written to the file by Finish()
+	bool BeginRecording(const char* filename, float fixedTimestep);
+	// read a log to replay
+	bool LoadReplay(const char* filename);
+
+	bool IsRecording() const;
+	bool IsReplaying() const;
+	// fixed timestep and number of steps of the replayed log
+	float GetFixedTimestep() const;
+	uint32_t GetStepCount() const;
+
+	// log the input of the next step, with the camera before it
+	void RecordStep(const CAMERA_STATE& camera, const INPUT_STATE& input);
+	// get the input of the next step, and move the camera onto a
+	// checkpoint logged for it, returns false after the last step
+	bool ReplayStep(CAMERA_STATE& camera, INPUT_STATE& input);
+	// write a recorded log, with the final camera state
+	bool Finish(const CAMERA_STATE& camera);
+
+	void PrintStats() const;
+};
@@ -0,0 +1,599 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// schedule small units of work across all cores - work-stealing deques,
+// completion counters and a parallel for
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+#include <iostream>
+#include <chrono>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the job system and worker index of the calling thread
+	thread_local JobSystem* t_pJobSystem = nullptr;
+	thread_local int t_workerIndex = -1;
+
+	// failed steal attempts before an idle worker goes to sleep
+	const int IDLE_SPIN_COUNT = 256;
+	// longest sleep of an idle worker, a safety net for a wake-up
+	// that races with the worker going to sleep
+	const int IDLE_SLEEP_MS = 2;
+
+	/***********************************************************
+	 *  NextRandom()
+	 *
+	 *  xorshift generator used to pick the victims for stealing
+	 ***********************************************************/
+	uint32_t NextRandom(uint32_t& state)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return(state);
+	}
+}
+
+/***********************************************************
+ *  WorkStealingQueue()
+ *
+ *  The constructor for the deque
+ ***********************************************************/
+JobSystem::WorkStealingQueue::WorkStealingQueue()
+{
+	m_top.store(0);
+	m_bottom.store(0);
+}
+
+/***********************************************************
+ *  Push()
+ *
+ *  This method is used by the owning worker to add a job at
+ *  the bottom of the deque.  It returns false when full.
+ ***********************************************************/
+bool JobSystem::WorkStealingQueue::Push(const JOB& job)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top >= JOB_QUEUE_SIZE)
+	{
+		return(false);
+	}
+
+	m_jobs[bottom & (JOB_QUEUE_SIZE - 1)] = job;
+	// the job must be visible before the new bottom is
+	m_bottom.store(bottom + 1, std::memory_order_release);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Pop()
+ *
+ *  This method is used by the owning worker to take the most
+ *  recently pushed job.  When a single job is left, the owner
+ *  races the thieves for it on the top index.
+ ***********************************************************/
+bool JobSystem::WorkStealingQueue::Pop(JOB& job)
+{
+	int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// the deque was empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return(false);
+	}
+
+	job = m_jobs[bottom & (JOB_QUEUE_SIZE - 1)];
+	if (top == bottom)
+	{
+		// last job - only one of the owner and a thief may take it
+		bool bWon = m_top.compare_exchange_strong(top, top + 1,
+			std::memory_order_seq_cst, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return(bWon);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Steal()
+ *
+ *  This method is used by any thread to take the oldest job
+ *  from the deque.  The job is copied out before the top is
+ *  claimed, and the copy is only kept if the claim succeeds,
+ *  since the owner may reuse the slot once it is released.
+ ***********************************************************/
+bool JobSystem::WorkStealingQueue::Steal(JOB& job)
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t bottom = m_bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return(false);
+	}
+
+	job = m_jobs[top & (JOB_QUEUE_SIZE - 1)];
+	return(m_top.compare_exchange_strong(top, top + 1,
+		std::memory_order_seq_cst, std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem()
+{
+	m_queuedJobs.store(0);
+	m_sleepingWorkers.store(0);
+	m_bRunning.store(false);
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used to create the workers and start their
+ *  threads.  The calling thread becomes worker 0.
+ ***********************************************************/
+bool JobSystem::Initialize(int workerCount)
+{
+	if (m_bRunning.load())
+	{
+		return(false);
+	}
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency();
+		if (workerCount <= 0)
+		{
+			workerCount = 1;
+		}
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		WORKER* pWorker = new WORKER();
+		pWorker->randomState = 0x9E3779B9u * (uint32_t)(i + 1);
+		pWorker->stats.jobsExecuted = 0;
+		pWorker->stats.jobsStolen = 0;
+		pWorker->stats.jobsDeferred = 0;
+		m_workers.push_back(pWorker);
+	}
+
+	t_pJobSystem = this;
+	t_workerIndex = 0;
+
+	m_bRunning.store(true);
+	for (int i = 1; i < workerCount; i++)
+	{
+		m_threads.push_back(std::thread(&JobSystem::WorkerMain, this, i));
+	}
+
+	std::cout << "INFO: Job system started with " << workerCount << " workers" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Shutdown()
+ *
+ *  This method is used to stop and join the worker threads.
+ *  Any jobs still queued are dropped.
+ ***********************************************************/
+void JobSystem::Shutdown()
+{
+	if (m_bRunning.load() == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_bRunning.store(false);
+	}
+	m_sleepCondition.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+	m_threads.clear();
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		delete m_workers[i];
+	}
+	m_workers.clear();
+
+	if (t_pJobSystem == this)
+	{
+		t_pJobSystem = nullptr;
+		t_workerIndex = -1;
+	}
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method is the main function of the worker threads.
+ *  Workers run jobs while there are any, spin briefly when
+ *  they run dry and then sleep until new jobs are pushed.
+ ***********************************************************/
+void JobSystem::WorkerMain(int workerIndex)
+{
+	t_pJobSystem = this;
+	t_workerIndex = workerIndex;
+	WORKER* pWorker = m_workers[workerIndex];
+
+	JOB job;
+	int idleCount = 0;
+	while (m_bRunning.load(std::memory_order_relaxed))
+	{
+		if (FindJob(pWorker, job))
+		{
+			RunJob(pWorker, job);
+			idleCount = 0;
+			continue;
+		}
+
+		if (++idleCount < IDLE_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// nothing to run - sleep until a job is pushed
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleepingWorkers.fetch_add(1);
+		if ((m_queuedJobs.load() <= 0) && m_bRunning.load())
+		{
+			m_sleepCondition.wait_for(lock, std::chrono::milliseconds(IDLE_SLEEP_MS));
+		}
+		m_sleepingWorkers.fetch_sub(1);
+		idleCount = 0;
+	}
+}
+
+/***********************************************************
+ *  GetCurrentWorker()
+ *
+ *  This method is used to get the state of the calling
+ *  worker, or nothing when called from another thread.
+ ***********************************************************/
+JobSystem::WORKER* JobSystem::GetCurrentWorker()
+{
+	if ((t_pJobSystem != this) || (t_workerIndex < 0))
+	{
+		return(NULL);
+	}
+
+	return(m_workers[t_workerIndex]);
+}
+
+/***********************************************************
+ *  FindJob()
+ *
+ *  This method is used to take a job from the calling
+ *  worker's deque, or to steal one from a random worker when
+ *  its own deque is empty.
+ ***********************************************************/
+bool JobSystem::FindJob(WORKER* pWorker, JOB& job)
+{
+	if (pWorker->queue.Pop(job))
+	{
+		m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+		return(true);
+	}
+
+	int workerCount = (int)m_workers.size();
+	if (workerCount < 2)
+	{
+		return(false);
+	}
+
+	// try each other worker once, starting at a random victim
+	int start = (int)(NextRandom(pWorker->randomState) % (uint32_t)workerCount);
+	for (int i = 0; i < workerCount; i++)
+	{
+		WORKER* pVictim = m_workers[(start + i) % workerCount];
+		if (pVictim == pWorker)
+		{
+			continue;
+		}
+
+		if (pVictim->queue.Steal(job))
+		{
+			m_queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+			pWorker->stats.jobsStolen++;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  PushJob()
+ *
+ *  This method is used to push a job on the calling worker's
+ *  deque.  A full deque runs the job inline instead.
+ ***********************************************************/
+void JobSystem::PushJob(WORKER* pWorker, const JOB& job)
+{
+	if (pWorker->queue.Push(job) == false)
+	{
+		RunJob(pWorker, job);
+		return;
+	}
+
+	m_queuedJobs.fetch_add(1, std::memory_order_relaxed);
+	if (m_sleepingWorkers.load(std::memory_order_relaxed) > 0)
+	{
+		m_sleepCondition.notify_one();
+	}
+}
+
+/***********************************************************
+ *  RunJob()
+ *
+ *  This method is used to run a job and signal its counter.
+ *  A job whose dependency has not completed yet makes the
+ *  worker help with the pending jobs until it has.
+ ***********************************************************/
+void JobSystem::RunJob(WORKER* pWorker, const JOB& job)
+{
+	if ((NULL != job.pDependency) &&
+		(job.pDependency->value.load(std::memory_order_acquire) > 0))
+	{
+		pWorker->stats.jobsDeferred++;
+		Wait(job.pDependency);
+	}
+
+	job.function(job.pData, job.begin, job.end);
+	pWorker->stats.jobsExecuted++;
+
+	if (NULL != job.pCounter)
+	{
+		job.pCounter->value.fetch_sub(1, std::memory_order_release);
+	}
+}
+
+/***********************************************************
+ *  RunPendingJob()
+ *
+ *  This method is used to run one pending job on the calling
+ *  worker.  It returns false when no job could be found.
+ ***********************************************************/
+bool JobSystem::RunPendingJob()
+{
+	WORKER* pWorker = GetCurrentWorker();
+	if (NULL == pWorker)
+	{
+		return(false);
+	}
+
+	JOB job;
+	if (FindJob(pWorker, job) == false)
+	{
+		return(false);
+	}
+
+	RunJob(pWorker, job);
+	return(true);
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used to queue a job on the calling worker.
+ *  The counter is raised now and lowered when the job has
+ *  run.  A job with a dependency does not start before the
+ *  dependency counter has reached zero.
+ ***********************************************************/
+void JobSystem::Submit(
+	JobFunction function,
+	void* pData,
+	int begin,
+	int end,
+	JobCounter* pCounter,
+	const JobCounter* pDependency)
+{
+	if (NULL != pCounter)
+	{
+		pCounter->value.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	WORKER* pWorker = GetCurrentWorker();
+	if (NULL == pWorker)
+	{
+		// not a worker thread - run the job immediately
+		if (NULL != pDependency)
+		{
+			while (pDependency->value.load(std::memory_order_acquire) > 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+		function(pData, begin, end);
+		if (NULL != pCounter)
+		{
+			pCounter->value.fetch_sub(1, std::memory_order_release);
+		}
+		return;
+	}
+
+	JOB job;
+	job.function = function;
+	job.pData = pData;
+	job.begin = begin;
+	job.end = end;
+	job.pCounter = pCounter;
+	job.pDependency = pDependency;
+
+	PushJob(pWorker, job);
+}
+
+/***********************************************************
+ *  Wait()
+ *
+ *  This method is used to block until the counter reaches
+ *  zero.  The calling worker runs pending jobs meanwhile, so
+ *  waiting from inside a job cannot deadlock the pool.
+ ***********************************************************/
+void JobSystem::Wait(const JobCounter* pCounter)
+{
+	while (pCounter->value.load(std::memory_order_acquire) > 0)
+	{
+		if (RunPendingJob() == false)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  ParallelForJob()
+ *
+ *  This job splits its range in half and submits the upper
+ *  half until the range fits the grain size, then runs the
+ *  body.  Splitting on the workers keeps the submitting
+ *  thread from queueing every range itself, and lets idle
+ *  workers steal large ranges first.
+ ***********************************************************/
+void JobSystem::ParallelForJob(void* pData, int begin, int end)
+{
+	PARALLEL_FOR_DATA* pForData = static_cast<PARALLEL_FOR_DATA*>(pData);
+
+	while (end - begin > pForData->grainSize)
+	{
+		int middle = begin + (end - begin) / 2;
+		pForData->pJobSystem->Submit(&JobSystem::ParallelForJob, pData, middle, end, pForData->pCounter);
+		end = middle;
+	}
+
+	pForData->body(pForData->pBodyData, begin, end);
+}
+
+/***********************************************************
+ *  ParallelForRange()
+ *
+ *  This method is used to run a job function over the range
+ *  [0, count) split into grain sized jobs, and to wait until
+ *  all of them have completed.
+ ***********************************************************/
+void JobSystem::ParallelForRange(JobFunction body, void* pBodyData, int count, int grainSize)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+	if (grainSize < 1)
+	{
+		grainSize = 1;
+	}
+
+	// small ranges and calls from outside the pool run inline
+	if ((count <= grainSize) || (NULL == GetCurrentWorker()))
+	{
+		body(pBodyData, 0, count);
+		return;
+	}
+
+	JobCounter counter;
+	PARALLEL_FOR_DATA forData;
+	forData.pJobSystem = this;
+	forData.body = body;
+	forData.pBodyData = pBodyData;
+	forData.grainSize = grainSize;
+	forData.pCounter = &counter;
+
+	Submit(&JobSystem::ParallelForJob, &forData, 0, count, &counter);
+	Wait(&counter);
+}
+
+/***********************************************************
+ *  GetWorkerCount()
+ *
+ *  This method is used to get the number of workers.
+ ***********************************************************/
+int JobSystem::GetWorkerCount() const
+{
+	return((int)m_workers.size());
+}
+
+/***********************************************************
+ *  GetCurrentWorkerIndex()
+ *
+ *  This method is used to get the index of the calling
+ *  worker, for indexing per-worker data.
+ ***********************************************************/
+int JobSystem::GetCurrentWorkerIndex() const
+{
+	if (t_pJobSystem != this)
+	{
+		return(-1);
+	}
+
+	return(t_workerIndex);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used to get the job counts summed over
+ *  all the workers.
+ ***********************************************************/
+JobSystem::JOB_STATS JobSystem::GetStats() const
+{
+	JOB_STATS stats;
+	stats.jobsExecuted = 0;
+	stats.jobsStolen = 0;
+	stats.jobsDeferred = 0;
+
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		stats.jobsExecuted += m_workers[i]->stats.jobsExecuted;
+		stats.jobsStolen += m_workers[i]->stats.jobsStolen;
+		stats.jobsDeferred += m_workers[i]->stats.jobsDeferred;
+	}
+
+	return(stats);
+}
+
+/***********************************************************
+ *  ResetStats()
+ *
+ *  This method is used to clear the job counts.  It should
+ *  only be called while no jobs are running.
+ ***********************************************************/
+void JobSystem::ResetStats()
+{
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i]->stats.jobsExecuted = 0;
+		m_workers[i]->stats.jobsStolen = 0;
+		m_workers[i]->stats.jobsDeferred = 0;
+	}
+}
@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// schedule small units of work across all cores - work-stealing deques,
+// completion counters and a parallel for
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class runs jobs on a pool of worker threads.  Every
+ *  worker owns a lock-free deque: it pushes and pops jobs at
+ *  one end while idle workers steal from the other end.  The
+ *  thread that initializes the system becomes worker 0 and
+ *  runs jobs while it waits on a counter.
+ *
+ *  Jobs may be submitted from worker 0 or from inside other
+ *  jobs.  Jobs are stored by value in the deques, so queueing
+ *  a job never allocates.  A worker with JOB_QUEUE_SIZE jobs
+ *  already queued runs further submissions inline.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor
+	JobSystem();
+	// destructor
+	~JobSystem();
+
+	// function run by a job over the index range [begin, end)
+	typedef void (*JobFunction)(void* pData, int begin, int end);
+
+	// number of jobs that are still to finish - a job signals its
+	// counter when it completes, and other jobs can be made to
+	// wait for a counter to reach zero before they start
+	struct JobCounter
+	{
+		std::atomic<int> value;
+		JobCounter() : value(0) {}
+	};
+
+	struct JOB_STATS
+	{
+		uint64_t jobsExecuted;
+		uint64_t jobsStolen;
+		uint64_t jobsDeferred;
+	};
+
+	static const int JOB_QUEUE_SIZE = 4096;
+
+private:
+	struct JOB
+	{
+		JobFunction function;
+		void* pData;
+		int begin;
+		int end;
+		JobCounter* pCounter;
+		const JobCounter* pDependency;
+	};
+
+	// fixed-size Chase-Lev deque of jobs
+	class WorkStealingQueue
+	{
+	public:
+		WorkStealingQueue();
+		// owner only - add a job at the bottom
+		bool Push(const JOB& job);
+		// owner only - take the newest job from the bottom
+		bool Pop(JOB& job);
+		// any thread - take the oldest job from the top
+		bool Steal(JOB& job);
+
+	private:
+		std::atomic<int64_t> m_top;
+		std::atomic<int64_t> m_bottom;
+		JOB m_jobs[JOB_QUEUE_SIZE];
+	};
+
+	// per-worker state, padded so that workers do not share cache lines
+	struct WORKER
+	{
+		char leadingPadding[64];
+		WorkStealingQueue queue;
+		uint32_t randomState;
+		JOB_STATS stats;
+		char trailingPadding[64];
+	};
+
+	// data shared by the jobs of one parallel for
+	struct PARALLEL_FOR_DATA
+	{
+		JobSystem* pJobSystem;
+		JobFunction body;
+		void* pBodyData;
+		int grainSize;
+		JobCounter* pCounter;
+	};
+
+	std::vector<WORKER*> m_workers;
+	std::vector<std::thread> m_threads;
+	// jobs pushed but not yet taken, used to put idle workers to sleep
+	std::atomic<int> m_queuedJobs;
+	std::atomic<int> m_sleepingWorkers;
+	std::atomic<bool> m_bRunning;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_sleepCondition;
+
+	// main function of the worker threads
+	void WorkerMain(int workerIndex);
+	// take a job from the calling worker's deque, or steal one
+	bool FindJob(WORKER* pWorker, JOB& job);
+	// run one job once its dependency, if any, has completed
+	void RunJob(WORKER* pWorker, const JOB& job);
+	// try to run one pending job, returns false when none was found
+	bool RunPendingJob();
+	// get the state of the calling worker thread
+	WORKER* GetCurrentWorker();
+	// push a job on the calling worker's deque and wake a sleeper
+	void PushJob(WORKER* pWorker, const JOB& job);
+
+	// job that splits a parallel for range until it reaches the grain size
+	static void ParallelForJob(void* pData, int begin, int end);
+	// adapts a callable object to the job function signature
+	template<typename FUNCTION>
+	static void CallableJob(void* pData, int begin, int end)
+	{
+		(*static_cast<const FUNCTION*>(pData))(begin, end);
+	}
+	// run a job function over a range, split into grain sized jobs
+	void ParallelForRange(JobFunction body, void* pBodyData, int count, int grainSize);
+
+public:
+	// start the worker threads, zero uses one worker per core
+	bool Initialize(int workerCount);
+	// stop and join the worker threads
+	void Shutdown();
+
+	// queue a job that signals the counter when it completes
+	void Submit(
+		JobFunction function,
+		void* pData,
+		int begin,
+		int end,
+		JobCounter* pCounter,
+		const JobCounter* pDependency = NULL);
+	// run jobs on the calling thread until the counter reaches zero
+	void Wait(const JobCounter* pCounter);
+
+	// call function(begin, end) over [0, count) in grain sized
+	// ranges spread across the workers, and wait for completion
+	template<typename FUNCTION>
+	void ParallelFor(int count, int grainSize, const FUNCTION& function)
+	{
+		ParallelForRange(&CallableJob<FUNCTION>, (void*)&function, count, grainSize);
+	}
+
+	// number of workers, including the initializing thread
+	int GetWorkerCount() const;
+	// index of the calling worker, or -1 for other threads
+	int GetCurrentWorkerIndex() const;
+	// job counts summed over all workers
+	JOB_STATS GetStats() const;
+	// clear the job counts of all workers
+	void ResetStats();
+};
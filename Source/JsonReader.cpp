@@ -0,0 +1,430 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonreader.cpp
+// ============
+// read a JSON document into a flat table of values that refer back into the
+// source text, enough for glTF files
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JsonReader.h"
+
+#include <cstdlib>
+#include <cstring>
+
+/***********************************************************
+ *  JsonReader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JsonReader::JsonReader()
+{
+	m_pStart = NULL;
+	m_pText = NULL;
+	m_pEnd = NULL;
+	m_pError = NULL;
+}
+
+/***********************************************************
+ *  SkipWhitespace()
+ *
+ *  This method is used for moving past spaces and newlines.
+ ***********************************************************/
+void JsonReader::SkipWhitespace()
+{
+	while ((m_pText < m_pEnd) &&
+		((*m_pText == ' ') || (*m_pText == '\t') || (*m_pText == '\n') || (*m_pText == '\r')))
+	{
+		m_pText++;
+	}
+}
+
+/***********************************************************
+ *  ParseString()
+ *
+ *  This method is used for finding the extent of a quoted
+ *  string.  Escapes are skipped over but kept as they are.
+ ***********************************************************/
+bool JsonReader::ParseString(const char*& pText, uint32_t& length)
+{
+	if ((m_pText >= m_pEnd) || (*m_pText != '"'))
+	{
+		return(false);
+	}
+
+	m_pText++;
+	pText = m_pText;
+	while ((m_pText < m_pEnd) && (*m_pText != '"'))
+	{
+		if ((*m_pText == '\\') && (m_pText + 1 < m_pEnd))
+		{
+			m_pText++;
+		}
+		m_pText++;
+	}
+	if (m_pText >= m_pEnd)
+	{
+		return(false);
+	}
+
+	length = (uint32_t)(m_pText - pText);
+	m_pText++;
+	return(true);
+}
+
+/***********************************************************
+ *  ParseValue()
+ *
+ *  This method is used for parsing one value and, for arrays
+ *  and objects, everything inside it.  The children are
+ *  gathered first and then appended to the child table
+ *  together, after any grandchildren.
+ ***********************************************************/
+int JsonReader::ParseValue(int depth)
+{
+	SkipWhitespace();
+	if ((m_pText >= m_pEnd) || (depth > MAX_DEPTH))
+	{
+		return(-1);
+	}
+
+	JSON_VALUE value;
+	memset(&value, 0, sizeof(value));
+	char first = *m_pText;
+
+	if ((first == '[') || (first == '{'))
+	{
+		bool bObject = (first == '{');
+		char last = bObject ? '}' : ']';
+		value.type = bObject ? JSON_OBJECT : JSON_ARRAY;
+		m_pText++;
+
+		std::vector<int> children;
+		SkipWhitespace();
+		if ((m_pText < m_pEnd) && (*m_pText == last))
+		{
+			m_pText++;
+		}
+		else
+		{
+			while (true)
+			{
+				const char* pKey = NULL;
+				uint32_t keyLength = 0;
+				if (bObject)
+				{
+					SkipWhitespace();
+					if (ParseString(pKey, keyLength) == false)
+					{
+						return(-1);
+					}
+					SkipWhitespace();
+					if ((m_pText >= m_pEnd) || (*m_pText != ':'))
+					{
+						return(-1);
+					}
+					m_pText++;
+				}
+
+				int child = ParseValue(depth + 1);
+				if (child < 0)
+				{
+					return(-1);
+				}
+				m_values[child].pKey = pKey;
+				m_values[child].keyLength = keyLength;
+				children.push_back(child);
+
+				SkipWhitespace();
+				if (m_pText >= m_pEnd)
+				{
+					return(-1);
+				}
+				if (*m_pText == ',')
+				{
+					m_pText++;
+				}
+				else if (*m_pText == last)
+				{
+					m_pText++;
+					break;
+				}
+				else
+				{
+					return(-1);
+				}
+			}
+		}
+
+		value.firstChild = (uint32_t)m_children.size();
+		value.childCount = (uint32_t)children.size();
+		m_children.insert(m_children.end(), children.begin(), children.end());
+	}
+	else if (first == '"')
+	{
+		value.type = JSON_STRING;
+		if (ParseString(value.pText, value.length) == false)
+		{
+			return(-1);
+		}
+	}
+	else if ((m_pEnd - m_pText >= 4) && (strncmp(m_pText, "true", 4) == 0))
+	{
+		value.type = JSON_TRUE;
+		m_pText += 4;
+	}
+	else if ((m_pEnd - m_pText >= 5) && (strncmp(m_pText, "false", 5) == 0))
+	{
+		value.type = JSON_FALSE;
+		m_pText += 5;
+	}
+	else if ((m_pEnd - m_pText >= 4) && (strncmp(m_pText, "null", 4) == 0))
+	{
+		value.type = JSON_NULL;
+		m_pText += 4;
+	}
+	else
+	{
+		// strtod needs a terminated string, and numbers are short
+		char number[64];
+		size_t length = 0;
+		while ((m_pText + length < m_pEnd) && (length + 1 < sizeof(number)) &&
+			(strchr("+-.eE0123456789", m_pText[length]) != NULL))
+		{
+			number[length] = m_pText[length];
+			length++;
+		}
+		number[length] = '\0';
+
+		char* pNumberEnd = NULL;
+		value.type = JSON_NUMBER;
+		value.number = strtod(number, &pNumberEnd);
+		if ((length == 0) || (pNumberEnd != number + length))
+		{
+			return(-1);
+		}
+		m_pText += length;
+	}
+
+	m_values.push_back(value);
+	return((int)m_values.size() - 1);
+}
+
+/***********************************************************
+ *  Parse()
+ *
+ *  This method is used for parsing a whole document.  The
+ *  root is the last value, since children are stored first.
+ ***********************************************************/
+bool JsonReader::Parse(const char* pText, size_t length)
+{
+	m_values.clear();
+	m_children.clear();
+	m_pStart = pText;
+	m_pText = pText;
+	m_pEnd = pText + length;
+	m_pError = NULL;
+
+	int root = ParseValue(0);
+	SkipWhitespace();
+	if ((root < 0) || (m_pText != m_pEnd))
+	{
+		m_pError = m_pText;
+		m_values.clear();
+		m_children.clear();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetErrorOffset()
+ *
+ *  This method is used for getting the offset in the text
+ *  where the last failed parse stopped.
+ ***********************************************************/
+size_t JsonReader::GetErrorOffset() const
+{
+	if (NULL == m_pError)
+	{
+		return(0);
+	}
+
+	return((size_t)(m_pError - m_pStart));
+}
+
+/***********************************************************
+ *  GetRoot()
+ *
+ *  This method is used for getting the top level value.
+ ***********************************************************/
+int JsonReader::GetRoot() const
+{
+	return((int)m_values.size() - 1);
+}
+
+/***********************************************************
+ *  GetType()
+ *
+ *  This method is used for getting the type of a value, a
+ *  missing value reads as null.
+ ***********************************************************/
+JsonReader::JSON_TYPE JsonReader::GetType(int value) const
+{
+	if ((value < 0) || (value >= (int)m_values.size()))
+	{
+		return(JSON_NULL);
+	}
+
+	return(m_values[value].type);
+}
+
+/***********************************************************
+ *  GetCount()
+ *
+ *  This method is used for getting the number of children of
+ *  an array or object.
+ ***********************************************************/
+int JsonReader::GetCount(int value) const
+{
+	JSON_TYPE type = GetType(value);
+	if ((type != JSON_ARRAY) && (type != JSON_OBJECT))
+	{
+		return(0);
+	}
+
+	return((int)m_values[value].childCount);
+}
+
+/***********************************************************
+ *  GetElement()
+ *
+ *  This method is used for getting a child by its position.
+ ***********************************************************/
+int JsonReader::GetElement(int value, int index) const
+{
+	if ((index < 0) || (index >= GetCount(value)))
+	{
+		return(-1);
+	}
+
+	return(m_children[m_values[value].firstChild + index]);
+}
+
+/***********************************************************
+ *  FindMember()
+ *
+ *  This method is used for getting the member of an object
+ *  with the passed in name.
+ ***********************************************************/
+int JsonReader::FindMember(int value, const char* key) const
+{
+	if (GetType(value) != JSON_OBJECT)
+	{
+		return(-1);
+	}
+
+	size_t keyLength = strlen(key);
+	for (int i = 0; i < GetCount(value); i++)
+	{
+		int child = GetElement(value, i);
+		if ((m_values[child].keyLength == keyLength) &&
+			(memcmp(m_values[child].pKey, key, keyLength) == 0))
+		{
+			return(child);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  GetNumber()
+ *
+ *  This method is used for getting the value of a number, or
+ *  the default when it is missing or not a number.
+ ***********************************************************/
+double JsonReader::GetNumber(int value, double defaultValue) const
+{
+	if (GetType(value) != JSON_NUMBER)
+	{
+		return(defaultValue);
+	}
+
+	return(m_values[value].number);
+}
+
+/***********************************************************
+ *  GetInt()
+ *
+ *  This method is used for getting a number as an integer.
+ ***********************************************************/
+int JsonReader::GetInt(int value, int defaultValue) const
+{
+	return((int)GetNumber(value, (double)defaultValue));
+}
+
+/***********************************************************
+ *  StringEquals()
+ *
+ *  This method is used for comparing a string value, as it is
+ *  written, with the passed in text.
+ ***********************************************************/
+bool JsonReader::StringEquals(int value, const char* text) const
+{
+	if (GetType(value) != JSON_STRING)
+	{
+		return(false);
+	}
+
+	size_t length = strlen(text);
+	return((m_values[value].length == length) && (memcmp(m_values[value].pText, text, length) == 0));
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for copying a string value with the
+ *  simple escapes resolved.  Unicode escapes are kept only
+ *  for the ASCII range, which covers glTF file names.
+ ***********************************************************/
+std::string JsonReader::GetString(int value) const
+{
+	std::string result;
+	if (GetType(value) != JSON_STRING)
+	{
+		return(result);
+	}
+
+	const char* pText = m_values[value].pText;
+	const char* pEnd = pText + m_values[value].length;
+	while (pText < pEnd)
+	{
+		char c = *pText++;
+		if ((c == '\\') && (pText < pEnd))
+		{
+			c = *pText++;
+			switch (c)
+			{
+			case 'n': c = '\n'; break;
+			case 't': c = '\t'; break;
+			case 'r': c = '\r'; break;
+			case 'b': c = '\b'; break;
+			case 'f': c = '\f'; break;
+			case 'u':
+				if (pEnd - pText >= 4)
+				{
+					char hex[5] = { pText[0], pText[1], pText[2], pText[3], '\0' };
+					long code = strtol(hex, NULL, 16);
+					c = (code < 0x80) ? (char)code : '?';
+					pText += 4;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+		result.push_back(c);
+	}
+
+	return(result);
+}
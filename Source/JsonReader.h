@@ -0,0 +1,94 @@
+///////////////////////////////////////////////////////////////////////////////
+// jsonreader.h
+// ============
+// read a JSON document into a flat table of values that refer back into the
+// source text, enough for glTF files
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  JsonReader
+ *
+ *  This class parses a JSON document into one array of
+ *  values.  Strings and keys are not copied; they point into
+ *  the source text, which must outlive the reader.  The
+ *  children of every array and object are stored together,
+ *  so an array element is found by index in constant time.
+ *  Values are referred to by their index, -1 for none, and
+ *  every getter accepts -1, so lookups can be chained.
+ ***********************************************************/
+class JsonReader
+{
+public:
+	enum JSON_TYPE
+	{
+		JSON_NULL,
+		JSON_FALSE,
+		JSON_TRUE,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+
+	// constructor
+	JsonReader();
+
+private:
+	struct JSON_VALUE
+	{
+		JSON_TYPE type;
+		// string contents without the quotes, still escaped
+		const char* pText;
+		uint32_t length;
+		double number;
+		// children of arrays and objects, in m_children
+		uint32_t firstChild;
+		uint32_t childCount;
+		// member name, for the children of objects
+		const char* pKey;
+		uint32_t keyLength;
+	};
+
+	// deepest nesting accepted, to bound the recursion
+	static const int MAX_DEPTH = 64;
+
+	std::vector<JSON_VALUE> m_values;
+	std::vector<int> m_children;
+	const char* m_pStart;
+	const char* m_pText;
+	const char* m_pEnd;
+	const char* m_pError;
+
+	void SkipWhitespace();
+	bool ParseString(const char*& pText, uint32_t& length);
+	int ParseValue(int depth);
+
+public:
+	// parse a document, replacing the one parsed before
+	bool Parse(const char* pText, size_t length);
+	// where parsing stopped, for error messages
+	size_t GetErrorOffset() const;
+
+	// the top level value
+	int GetRoot() const;
+	JSON_TYPE GetType(int value) const;
+	// number of elements of an array or members of an object
+	int GetCount(int value) const;
+	// element of an array, or member of an object by position
+	int GetElement(int value, int index) const;
+	// member of an object by name
+	int FindMember(int value, const char* key) const;
+
+	double GetNumber(int value, double defaultValue) const;
+	int GetInt(int value, int defaultValue) const;
+	bool StringEquals(int value, const char* text) const;
+	// copy of a string with its escapes resolved
+	std::string GetString(int value) const;
+};
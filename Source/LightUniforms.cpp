@@ -0,0 +1,191 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightuniforms.cpp
+// ============
+// pack the light state of the scene into the named uniforms of the shader
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightUniforms.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// declaration of global variables
+namespace
+{
+	const char* g_UseLightingName = "bUseLighting";
+	// light dimmer than this does not change an 8-bit pixel
+	const float g_LightCutoff = 1.0f / 256.0f;
+
+	// members of a point light, in the order they are packed
+	enum PointLightMember
+	{
+		POINT_POSITION,
+		POINT_AMBIENT,
+		POINT_DIFFUSE,
+		POINT_SPECULAR,
+		POINT_CONSTANT,
+		POINT_LINEAR,
+		POINT_QUADRATIC,
+		POINT_RANGE_SQUARED,
+		POINT_ACTIVE,
+		POINT_MEMBER_COUNT
+	};
+	const char* g_PointLightMembers[POINT_MEMBER_COUNT] = {
+		"position", "ambient", "diffuse", "specular", "constant", "linear", "quadratic", "rangeSquared", "bActive"
+	};
+
+	// full names of the point light uniforms, built once so that
+	// packing the lights does not build strings
+	std::vector<std::string> BuildPointLightNames()
+	{
+		std::vector<std::string> names;
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			std::string prefix = "pointLights[" + std::to_string(i) + "].";
+			for (int member = 0; member < POINT_MEMBER_COUNT; member++)
+			{
+				names.push_back(prefix + g_PointLightMembers[member]);
+			}
+		}
+		return(names);
+	}
+
+	const char* GetPointLightName(int light, PointLightMember member)
+	{
+		static const std::vector<std::string> names = BuildPointLightNames();
+		return(names[light * POINT_MEMBER_COUNT + member].c_str());
+	}
+
+	// write a uniform over the next entry of the list, so the names
+	// keep their storage from one packing to the next
+	void AddUniform(
+		std::vector<LightUniforms::LIGHT_UNIFORM>& uniforms,
+		size_t& count,
+		const char* name,
+		LightUniforms::UNIFORM_TYPE type,
+		const glm::vec3& value)
+	{
+		if (count == uniforms.size())
+		{
+			uniforms.push_back(LightUniforms::LIGHT_UNIFORM());
+		}
+		LightUniforms::LIGHT_UNIFORM& uniform = uniforms[count++];
+		uniform.name = name;
+		uniform.type = type;
+		uniform.value = value;
+	}
+
+	void AddBool(std::vector<LightUniforms::LIGHT_UNIFORM>& uniforms, size_t& count, const char* name, bool bValue)
+	{
+		AddUniform(uniforms, count, name, LightUniforms::UNIFORM_BOOL, glm::vec3(bValue ? 1.0f : 0.0f));
+	}
+
+	void AddFloat(std::vector<LightUniforms::LIGHT_UNIFORM>& uniforms, size_t& count, const char* name, float value)
+	{
+		AddUniform(uniforms, count, name, LightUniforms::UNIFORM_FLOAT, glm::vec3(value));
+	}
+
+	void AddVec3(std::vector<LightUniforms::LIGHT_UNIFORM>& uniforms, size_t& count, const char* name, const glm::vec3& value)
+	{
+		AddUniform(uniforms, count, name, LightUniforms::UNIFORM_VEC3, value);
+	}
+}
+
+/***********************************************************
+ *  Pack()
+ *
+ *  This method is used for packing a light state into the
+ *  uniforms of the shader, in the order they were set before:
+ *  the lighting switch, the directional light, the point
+ *  lights and the spot light.  The entries of the list are
+ *  written over in place, so packing into a list that was
+ *  packed before does not allocate.
+ ***********************************************************/
+void LightUniforms::Pack(const LIGHT_STATE& lights, std::vector<LIGHT_UNIFORM>& uniforms)
+{
+	size_t count = 0;
+
+	AddBool(uniforms, count, g_UseLightingName, lights.bUseLighting);
+
+	AddVec3(uniforms, count, "directionalLight.direction", lights.directionalLight.direction);
+	AddVec3(uniforms, count, "directionalLight.ambient", lights.directionalLight.ambient);
+	AddVec3(uniforms, count, "directionalLight.diffuse", lights.directionalLight.diffuse);
+	AddVec3(uniforms, count, "directionalLight.specular", lights.directionalLight.specular);
+	AddBool(uniforms, count, "directionalLight.bActive", lights.directionalLight.bActive);
+
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		const POINT_LIGHT& light = lights.pointLights[i];
+
+		AddVec3(uniforms, count, GetPointLightName(i, POINT_POSITION), light.position);
+		AddVec3(uniforms, count, GetPointLightName(i, POINT_AMBIENT), light.ambient);
+		AddVec3(uniforms, count, GetPointLightName(i, POINT_DIFFUSE), light.diffuse);
+		AddVec3(uniforms, count, GetPointLightName(i, POINT_SPECULAR), light.specular);
+		AddFloat(uniforms, count, GetPointLightName(i, POINT_CONSTANT), light.constant);
+		AddFloat(uniforms, count, GetPointLightName(i, POINT_LINEAR), light.linear);
+		AddFloat(uniforms, count, GetPointLightName(i, POINT_QUADRATIC), light.quadratic);
+		AddFloat(uniforms, count, GetPointLightName(i, POINT_RANGE_SQUARED), GetPointLightRangeSquared(light));
+		AddBool(uniforms, count, GetPointLightName(i, POINT_ACTIVE), light.bActive);
+	}
+
+	AddVec3(uniforms, count, "spotLight.position", lights.spotLight.position);
+	AddVec3(uniforms, count, "spotLight.direction", lights.spotLight.direction);
+	AddVec3(uniforms, count, "spotLight.ambient", lights.spotLight.ambient);
+	AddVec3(uniforms, count, "spotLight.diffuse", lights.spotLight.diffuse);
+	AddVec3(uniforms, count, "spotLight.specular", lights.spotLight.specular);
+	AddFloat(uniforms, count, "spotLight.constant", lights.spotLight.constant);
+	AddFloat(uniforms, count, "spotLight.linear", lights.spotLight.linear);
+	AddFloat(uniforms, count, "spotLight.quadratic", lights.spotLight.quadratic);
+	AddFloat(uniforms, count, "spotLight.cutOff", lights.spotLight.cutOff);
+	AddFloat(uniforms, count, "spotLight.outerCutOff", lights.spotLight.outerCutOff);
+	AddBool(uniforms, count, "spotLight.bActive", lights.spotLight.bActive);
+
+	uniforms.resize(count);
+}
+
+/***********************************************************
+ *  GetPointLightRange()
+ *
+ *  This method is used for getting the distance at which the
+ *  attenuation has dimmed the brightest term of a point light
+ *  below the cutoff.  Lights without attenuation terms keep
+ *  their full brightness, so they reach everywhere.
+ ***********************************************************/
+float LightUniforms::GetPointLightRange(const POINT_LIGHT& light)
+{
+	if ((light.linear <= 0.0f) && (light.quadratic <= 0.0f))
+	{
+		return(-1.0f);
+	}
+
+	glm::vec3 brightest = glm::max(light.ambient, glm::max(light.diffuse, light.specular));
+	float limit = std::max(brightest.x, std::max(brightest.y, brightest.z)) / g_LightCutoff;
+	if (limit <= light.constant)
+	{
+		return(0.0f);
+	}
+	if (light.quadratic > 0.0f)
+	{
+		float discriminant = (light.linear * light.linear) + (4.0f * light.quadratic * (limit - light.constant));
+		return((std::sqrt(discriminant) - light.linear) / (2.0f * light.quadratic));
+	}
+	return((limit - light.constant) / light.linear);
+}
+
+/***********************************************************
+ *  GetPointLightRangeSquared()
+ *
+ *  This method is used for getting the square of a point
+ *  light's range, which the shaders compare the squared
+ *  distance of a fragment against before they light it.
+ ***********************************************************/
+float LightUniforms::GetPointLightRangeSquared(const POINT_LIGHT& light)
+{
+	float range = GetPointLightRange(light);
+	if (range < 0.0f)
+	{
+		return(std::numeric_limits<float>::max());
+	}
+	return(range * range);
+}
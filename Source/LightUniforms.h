@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightuniforms.h
+// ============
+// pack the light state of the scene into the named uniforms of the shader
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameSnapshot.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  LightUniforms
+ *
+ *  This class packs a light state into the list of uniforms
+ *  the shader reads it from, each with its name, type and
+ *  value.  Packing does not use OpenGL, so the scene manager
+ *  only walks the list to set the uniforms, and the packing
+ *  can be measured on its own.
+ ***********************************************************/
+class LightUniforms
+{
+public:
+	enum UNIFORM_TYPE
+	{
+		UNIFORM_BOOL,
+		UNIFORM_FLOAT,
+		UNIFORM_VEC3
+	};
+
+	struct LIGHT_UNIFORM
+	{
+		std::string name;
+		UNIFORM_TYPE type;
+		// bools and floats are held in x
+		glm::vec3 value;
+	};
+
+	// pack a light state into uniforms, replacing the list's contents
+	static void Pack(const LIGHT_STATE& lights, std::vector<LIGHT_UNIFORM>& uniforms);
+	// distance beyond which a point light is too dim to change a
+	// pixel, negative when it reaches everywhere
+	static float GetPointLightRange(const POINT_LIGHT& light);
+	// square of the range the shaders compare against, the largest
+	// float when the light reaches everywhere
+	static float GetPointLightRangeSquared(const POINT_LIGHT& light);
+};
@@ -0,0 +1,1057 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.cpp
+// ============
+// bake the diffuse light of the scene's lights into lightmap atlases for the
+// static geometry, so only the specular light is computed per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightmapBaker.h"
+#include "JobSystem.h"
+#include "TriangleBvh.h"
+#include "ImageWriter.h"
+#include "LightUniforms.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+	// texels around every chart, so filtering never reads its neighbours
+	const int g_ChartPadding = 1;
+	// smallest page, and the most pages a lightmap may take up
+	const int g_MinPageSize = 16;
+	const int g_MaxLightmapPages = 32;
+	// brightest light an RGBM texel holds
+	const float g_RgbmRange = 8.0f;
+	// two triangles form one chart when their normals are this close
+	const float g_FlatPairCosine = 0.9999f;
+	// shadow rays start this far off the surface
+	const float g_RayOffset = 1.0e-3f;
+	// charts baked by one job
+	const int g_ChartsPerJob = 16;
+
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// run a job over [0, count), on the job system when there is one
+	template <typename FUNCTION>
+	void RunJobs(JobSystem* pJobSystem, int count, int grainSize, const FUNCTION& function)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, grainSize, function);
+		}
+		else
+		{
+			function(0, count);
+		}
+	}
+
+	// the lights of a bake, with the distance each point light
+	// reaches; the point lights that reach everywhere are listed
+	// on their own, the others are found through a grid of cells
+	// as large as the longest reach
+	struct BAKE_LIGHTS
+	{
+		const LIGHT_STATE* pLights;
+		std::vector<POINT_LIGHT> pointLights;
+		std::vector<float> ranges;
+		std::vector<int> unlimitedLights;
+		std::unordered_map<uint64_t, std::vector<int> > cells;
+		float cellSize;
+		const TriangleBvh* pBvh;
+	};
+
+	// brightness left of a light at a distance, lights without
+	// attenuation terms keep their full brightness like the shader
+	float Attenuation(float constant, float linear, float quadratic, float distance)
+	{
+		float divisor = constant + (linear * distance) + (quadratic * distance * distance);
+		return((divisor > 0.0f) ? (1.0f / divisor) : 1.0f);
+	}
+
+	// key of a grid cell, 21 bits per axis
+	uint64_t CellKey(int x, int y, int z)
+	{
+		return(((uint64_t)(x & 0x1FFFFF) << 42) | ((uint64_t)(y & 0x1FFFFF) << 21) | (uint64_t)(z & 0x1FFFFF));
+	}
+
+	// list the point lights that reach a box
+	void FindPointLights(
+		const BAKE_LIGHTS& lights,
+		const glm::vec3& boundsMin,
+		const glm::vec3& boundsMax,
+		std::vector<int>& found)
+	{
+		found = lights.unlimitedLights;
+		if (lights.cells.empty() == true)
+		{
+			return;
+		}
+
+		glm::vec3 low = glm::floor((boundsMin - glm::vec3(lights.cellSize)) / lights.cellSize);
+		glm::vec3 high = glm::floor((boundsMax + glm::vec3(lights.cellSize)) / lights.cellSize);
+		for (int x = (int)low.x; x <= (int)high.x; x++)
+		{
+			for (int y = (int)low.y; y <= (int)high.y; y++)
+			{
+				for (int z = (int)low.z; z <= (int)high.z; z++)
+				{
+					std::unordered_map<uint64_t, std::vector<int> >::const_iterator cell = lights.cells.find(CellKey(x, y, z));
+					if (cell == lights.cells.end())
+					{
+						continue;
+					}
+					for (size_t i = 0; i < cell->second.size(); i++)
+					{
+						int light = cell->second[i];
+						const glm::vec3& position = lights.pointLights[light].position;
+						glm::vec3 nearest = glm::clamp(position, boundsMin, boundsMax);
+						glm::vec3 offset = position - nearest;
+						if (glm::dot(offset, offset) <= lights.ranges[light] * lights.ranges[light])
+						{
+							found.push_back(light);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// check whether nothing blocks the way from a surface point to
+	// a light; the ray starts off the surface on the side it leaves
+	bool IsLightVisible(
+		const BAKE_LIGHTS& lights,
+		const glm::vec3& position,
+		const glm::vec3& faceNormal,
+		const glm::vec3& direction,
+		float distance,
+		uint64_t& rayCount)
+	{
+		if (NULL == lights.pBvh)
+		{
+			return(true);
+		}
+
+		rayCount++;
+		float side = (glm::dot(faceNormal, direction) >= 0.0f) ? 1.0f : -1.0f;
+		glm::vec3 origin = position + (faceNormal * (g_RayOffset * side));
+		return(lights.pBvh->IsOccluded(origin, direction, distance - g_RayOffset) == false);
+	}
+
+	// light falling on a surface point, the ambient light plus the
+	// diffuse light times the diffuse color, as the shader adds them
+	glm::vec3 LightTexel(
+		const BAKE_LIGHTS& lights,
+		const std::vector<int>& pointLights,
+		const glm::vec3& position,
+		const glm::vec3& normal,
+		const glm::vec3& faceNormal,
+		const glm::vec3& diffuseColor,
+		uint64_t& rayCount)
+	{
+		glm::vec3 ambient = glm::vec3(0.0f);
+		glm::vec3 diffuse = glm::vec3(0.0f);
+
+		const DIRECTIONAL_LIGHT& directional = lights.pLights->directionalLight;
+		if (directional.bActive == true)
+		{
+			glm::vec3 direction = glm::normalize(-directional.direction);
+			float lambert = glm::dot(normal, direction);
+			ambient += directional.ambient;
+			if ((lambert > 0.0f) && (IsLightVisible(lights, position, faceNormal, direction, 1.0e30f, rayCount) == true))
+			{
+				diffuse += directional.diffuse * lambert;
+			}
+		}
+
+		for (size_t i = 0; i < pointLights.size(); i++)
+		{
+			const POINT_LIGHT& light = lights.pointLights[pointLights[i]];
+			glm::vec3 toLight = light.position - position;
+			float distance = glm::length(toLight);
+			if (distance <= 0.0f)
+			{
+				continue;
+			}
+			glm::vec3 direction = toLight / distance;
+			float attenuation = Attenuation(light.constant, light.linear, light.quadratic, distance);
+			float lambert = glm::dot(normal, direction);
+			ambient += light.ambient * attenuation;
+			if ((lambert > 0.0f) && (IsLightVisible(lights, position, faceNormal, direction, distance, rayCount) == true))
+			{
+				diffuse += light.diffuse * (lambert * attenuation);
+			}
+		}
+
+		const SPOT_LIGHT& spot = lights.pLights->spotLight;
+		if (spot.bActive == true)
+		{
+			glm::vec3 toLight = spot.position - position;
+			float distance = glm::length(toLight);
+			if (distance > 0.0f)
+			{
+				glm::vec3 direction = toLight / distance;
+				float attenuation = Attenuation(spot.constant, spot.linear, spot.quadratic, distance);
+				float theta = glm::dot(direction, glm::normalize(-spot.direction));
+				float epsilon = spot.cutOff - spot.outerCutOff;
+				float intensity = (epsilon != 0.0f) ? glm::clamp((theta - spot.outerCutOff) / epsilon, 0.0f, 1.0f) : ((theta >= spot.cutOff) ? 1.0f : 0.0f);
+				float lambert = glm::dot(normal, direction);
+				ambient += spot.ambient * (attenuation * intensity);
+				if ((lambert > 0.0f) && (intensity > 0.0f) &&
+					(IsLightVisible(lights, position, faceNormal, direction, distance, rayCount) == true))
+				{
+					diffuse += spot.diffuse * (lambert * attenuation * intensity);
+				}
+			}
+		}
+
+		return(ambient + (diffuse * diffuseColor));
+	}
+
+	// barycentric coordinates of the point of a triangle nearest to
+	// a point in its plane, returns the squared distance to it
+	float NearestBarycentric(
+		const glm::vec2& point,
+		const glm::vec2& a,
+		const glm::vec2& b,
+		const glm::vec2& c,
+		glm::vec3& barycentric)
+	{
+		glm::vec2 edge0 = b - a;
+		glm::vec2 edge1 = c - a;
+		glm::vec2 offset = point - a;
+		float d00 = glm::dot(edge0, edge0);
+		float d01 = glm::dot(edge0, edge1);
+		float d11 = glm::dot(edge1, edge1);
+		float denominator = (d00 * d11) - (d01 * d01);
+		if ((denominator > 0.0f) && (denominator > 1.0e-10f * d00 * d11))
+		{
+			float v = ((d11 * glm::dot(offset, edge0)) - (d01 * glm::dot(offset, edge1))) / denominator;
+			float w = ((d00 * glm::dot(offset, edge1)) - (d01 * glm::dot(offset, edge0))) / denominator;
+			if ((v >= 0.0f) && (w >= 0.0f) && (v + w <= 1.0f))
+			{
+				barycentric = glm::vec3(1.0f - v - w, v, w);
+				return(0.0f);
+			}
+		}
+
+		// outside, or too thin to have an inside: the nearest point
+		// is on one of the edges
+		const glm::vec2 corners[3] = { a, b, c };
+		float nearest = 1.0e30f;
+		for (int i = 0; i < 3; i++)
+		{
+			const glm::vec2& start = corners[i];
+			glm::vec2 edge = corners[(i + 1) % 3] - start;
+			float length = glm::dot(edge, edge);
+			float t = (length > 0.0f) ? glm::clamp(glm::dot(point - start, edge) / length, 0.0f, 1.0f) : 0.0f;
+			glm::vec2 difference = point - (start + (edge * t));
+			float distance = glm::dot(difference, difference);
+			if (distance < nearest)
+			{
+				nearest = distance;
+				barycentric = glm::vec3(0.0f);
+				barycentric[i] = 1.0f - t;
+				barycentric[(i + 1) % 3] = t;
+			}
+		}
+		return(nearest);
+	}
+
+	// pack a light into an RGBM texel
+	void EncodeRgbm(const glm::vec3& color, uint8_t* pTexel)
+	{
+		glm::vec3 scaled = glm::max(color, glm::vec3(0.0f)) / g_RgbmRange;
+		float multiplier = std::min(1.0f, std::max(scaled.x, std::max(scaled.y, scaled.z)));
+		multiplier = std::ceil(multiplier * 255.0f) / 255.0f;
+		if (multiplier <= 0.0f)
+		{
+			pTexel[0] = pTexel[1] = pTexel[2] = pTexel[3] = 0;
+			return;
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			pTexel[i] = (uint8_t)std::min(255.0f, std::floor(((scaled[i] / multiplier) * 255.0f) + 0.5f));
+		}
+		pTexel[3] = (uint8_t)(multiplier * 255.0f + 0.5f);
+	}
+}
+
+/***********************************************************
+ *  LightmapBaker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightmapBaker::LightmapBaker(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_layoutHash = 0;
+	m_pageCount = 0;
+	m_stats = BAKE_STATS();
+}
+
+/***********************************************************
+ *  BuildCharts()
+ *
+ *  This method is used for splitting the merged triangles
+ *  into charts, packing them into pages and unwelding the
+ *  geometry, so every chart has vertices of its own with
+ *  their own lightmap coordinates.  The triangles keep their
+ *  order, so the index ranges of the batches stay valid.
+ ***********************************************************/
+bool LightmapBaker::BuildCharts(
+	const std::vector<BAKE_VERTEX>& vertices,
+	const std::vector<uint32_t>& indices,
+	const BAKE_SETTINGS& settings)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	m_settings = settings;
+	m_settings.pageSize = std::max(m_settings.pageSize, g_MinPageSize);
+	m_vertices = vertices;
+	m_indices.assign(indices.begin(), indices.begin() + (indices.size() - (indices.size() % 3)));
+	m_charts.clear();
+	m_vertexSources.clear();
+	m_coordinates.clear();
+	m_chartIndices.clear();
+	m_layoutHash = 0;
+	m_pageCount = 0;
+	m_pages.clear();
+	m_stats = BAKE_STATS();
+
+	if ((m_indices.empty() == true) || (m_settings.texelsPerUnit <= 0.0f))
+	{
+		std::cout << "ERROR: There is no static geometry to lightmap" << std::endl;
+		return(false);
+	}
+
+	CreateCharts();
+	if (PackCharts() == false)
+	{
+		m_charts.clear();
+		return(false);
+	}
+	UnweldCharts();
+
+	m_stats.triangleCount = (int)(m_indices.size() / 3);
+	m_stats.chartCount = (int)m_charts.size();
+	m_stats.pageCount = m_pageCount;
+	m_stats.chartMs = ElapsedMs(start, std::chrono::steady_clock::now());
+
+	return(true);
+}
+
+/***********************************************************
+ *  CreateCharts()
+ *
+ *  This method is used for grouping the triangles into charts
+ *  and laying each chart flat.  The triangles of one surface
+ *  are next to each other, so the edges they share are found
+ *  a surface at a time.  A triangle is paired with the one
+ *  across its longest edge when that is the longest edge of
+ *  both and they lie flat, which puts the two halves of a
+ *  quad back together.  The chart's U axis runs from the
+ *  corner opposite that edge, along a side of the quad, so
+ *  rectangles are packed without waste.
+ ***********************************************************/
+void LightmapBaker::CreateCharts()
+{
+	uint32_t triangleCount = (uint32_t)(m_indices.size() / 3);
+
+	std::vector<glm::vec3> faceNormals(triangleCount);
+	std::vector<int> longestEdges(triangleCount);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		const glm::vec3& a = m_vertices[m_indices[t * 3]].position;
+		const glm::vec3& b = m_vertices[m_indices[t * 3 + 1]].position;
+		const glm::vec3& c = m_vertices[m_indices[t * 3 + 2]].position;
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		float length = glm::length(normal);
+		faceNormals[t] = (length > 0.0f) ? (normal / length) : glm::vec3(0.0f);
+
+		float lengths[3] = { glm::length(b - a), glm::length(c - b), glm::length(a - c) };
+		longestEdges[t] = 0;
+		for (int e = 1; e < 3; e++)
+		{
+			if (lengths[e] > lengths[longestEdges[t]])
+			{
+				longestEdges[t] = e;
+			}
+		}
+	}
+
+	// the triangle across every edge, edge e runs from corner e
+	std::vector<int> neighbors(triangleCount * 3, -1);
+	std::vector<std::pair<uint64_t, uint32_t> > edges;
+	uint32_t first = 0;
+	while (first < triangleCount)
+	{
+		uint32_t surface = m_vertices[m_indices[first * 3]].surface;
+		uint32_t end = first + 1;
+		while ((end < triangleCount) && (m_vertices[m_indices[end * 3]].surface == surface))
+		{
+			end++;
+		}
+
+		edges.clear();
+		for (uint32_t t = first; t < end; t++)
+		{
+			for (uint32_t e = 0; e < 3; e++)
+			{
+				uint64_t a = m_indices[t * 3 + e];
+				uint64_t b = m_indices[t * 3 + ((e + 1) % 3)];
+				edges.push_back(std::make_pair((std::min(a, b) << 32) | std::max(a, b), (t * 3) + e));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		// only edges shared by exactly two triangles join them
+		size_t i = 0;
+		while (i < edges.size())
+		{
+			size_t j = i + 1;
+			while ((j < edges.size()) && (edges[j].first == edges[i].first))
+			{
+				j++;
+			}
+			if (j - i == 2)
+			{
+				neighbors[edges[i].second] = (int)(edges[i + 1].second / 3);
+				neighbors[edges[i + 1].second] = (int)(edges[i].second / 3);
+			}
+			i = j;
+		}
+
+		first = end;
+	}
+
+	std::vector<char> charted(triangleCount, 0);
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		if (charted[t] != 0)
+		{
+			continue;
+		}
+
+		LIGHTMAP_CHART chart;
+		chart.triangles[0] = t;
+		chart.triangleCount = 1;
+		charted[t] = 1;
+
+		int edge = longestEdges[t];
+		int neighbor = neighbors[t * 3 + edge];
+		if ((neighbor >= 0) && (charted[neighbor] == 0) &&
+			(neighbors[neighbor * 3 + longestEdges[neighbor]] == (int)t) &&
+			(glm::dot(faceNormals[t], faceNormals[neighbor]) >= g_FlatPairCosine))
+		{
+			chart.triangles[1] = (uint32_t)neighbor;
+			chart.triangleCount = 2;
+			charted[neighbor] = 1;
+		}
+
+		const glm::vec3& corner = m_vertices[m_indices[t * 3 + ((edge + 2) % 3)]].position;
+		const glm::vec3& edgeStart = m_vertices[m_indices[t * 3 + edge]].position;
+		chart.origin = corner;
+		chart.axisU = edgeStart - corner;
+		if ((glm::dot(faceNormals[t], faceNormals[t]) > 0.0f) && (glm::dot(chart.axisU, chart.axisU) > 0.0f))
+		{
+			chart.axisU = glm::normalize(chart.axisU);
+			chart.axisV = glm::cross(faceNormals[t], chart.axisU);
+		}
+		else
+		{
+			// a triangle without area still gets texels
+			chart.axisU = glm::vec3(1.0f, 0.0f, 0.0f);
+			chart.axisV = glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+
+		glm::vec2 planeMin = glm::vec2(1.0e30f);
+		glm::vec2 planeMax = glm::vec2(-1.0e30f);
+		chart.boundsMin = glm::vec3(1.0e30f);
+		chart.boundsMax = glm::vec3(-1.0e30f);
+		for (int i = 0; i < chart.triangleCount; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				const glm::vec3& position = m_vertices[m_indices[chart.triangles[i] * 3 + k]].position;
+				glm::vec2 projected = glm::vec2(
+					glm::dot(position - chart.origin, chart.axisU),
+					glm::dot(position - chart.origin, chart.axisV));
+				planeMin = glm::min(planeMin, projected);
+				planeMax = glm::max(planeMax, projected);
+				chart.boundsMin = glm::min(chart.boundsMin, position);
+				chart.boundsMax = glm::max(chart.boundsMax, position);
+			}
+		}
+		chart.planeMin = planeMin;
+		chart.planeSize = planeMax - planeMin;
+
+		// a chart larger than a page is given fewer texels
+		int largest = m_settings.pageSize - (2 * g_ChartPadding);
+		chart.density = m_settings.texelsPerUnit;
+		float longest = std::max(chart.planeSize.x, chart.planeSize.y);
+		if (longest * chart.density > (float)largest)
+		{
+			chart.density = (float)largest / longest;
+		}
+		chart.width = std::min(largest, std::max(1, (int)std::ceil(chart.planeSize.x * chart.density))) + (2 * g_ChartPadding);
+		chart.height = std::min(largest, std::max(1, (int)std::ceil(chart.planeSize.y * chart.density))) + (2 * g_ChartPadding);
+		chart.page = 0;
+		chart.x = 0;
+		chart.y = 0;
+
+		m_charts.push_back(chart);
+	}
+}
+
+/***********************************************************
+ *  PackCharts()
+ *
+ *  This method is used for placing the charts in the pages.
+ *  The charts are sorted from the tallest down and placed
+ *  left to right on shelves, a new shelf starting above the
+ *  last when a row is full and a new page when the page is.
+ ***********************************************************/
+bool LightmapBaker::PackCharts()
+{
+	std::vector<uint32_t> order(m_charts.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		order[i] = (uint32_t)i;
+	}
+	std::sort(order.begin(), order.end(),
+		[this](uint32_t left, uint32_t right)
+		{
+			const LIGHTMAP_CHART& a = m_charts[left];
+			const LIGHTMAP_CHART& b = m_charts[right];
+			if (a.height != b.height)
+			{
+				return(a.height > b.height);
+			}
+			if (a.width != b.width)
+			{
+				return(a.width > b.width);
+			}
+			return(left < right);
+		});
+
+	int pageSize = m_settings.pageSize;
+	int page = 0;
+	int x = 0;
+	int y = 0;
+	int shelfHeight = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		LIGHTMAP_CHART& chart = m_charts[order[i]];
+		if (x + chart.width > pageSize)
+		{
+			x = 0;
+			y += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (y + chart.height > pageSize)
+		{
+			page++;
+			x = 0;
+			y = 0;
+			shelfHeight = 0;
+		}
+
+		chart.page = page;
+		chart.x = x;
+		chart.y = y;
+		x += chart.width;
+		shelfHeight = std::max(shelfHeight, chart.height);
+	}
+
+	m_pageCount = page + 1;
+	if (m_pageCount > g_MaxLightmapPages)
+	{
+		std::cout << "ERROR: The lightmap needs " << m_pageCount << " pages of " << pageSize << "x" << pageSize
+			<< ", more than the " << g_MaxLightmapPages << " it may use; lower the texel density" << std::endl;
+		m_pageCount = 0;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  UnweldCharts()
+ *
+ *  This method is used for giving every chart copies of its
+ *  vertices, with the texel coordinates of their place in
+ *  the chart's rectangle, divided by the page size, and the
+ *  page as the third coordinate.  The coordinates are hashed
+ *  along with the indexes, so a lightmap file can tell that
+ *  it was baked for the same layout.
+ ***********************************************************/
+void LightmapBaker::UnweldCharts()
+{
+	m_chartIndices.resize(m_indices.size());
+	float pageSize = (float)m_settings.pageSize;
+
+	for (size_t c = 0; c < m_charts.size(); c++)
+	{
+		const LIGHTMAP_CHART& chart = m_charts[c];
+		uint32_t sources[6];
+		uint32_t copies[6];
+		int copyCount = 0;
+
+		for (int i = 0; i < chart.triangleCount; i++)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint32_t corner = chart.triangles[i] * 3 + k;
+				uint32_t source = m_indices[corner];
+				int found = 0;
+				while ((found < copyCount) && (sources[found] != source))
+				{
+					found++;
+				}
+				if (found == copyCount)
+				{
+					const glm::vec3& position = m_vertices[source].position;
+					glm::vec2 projected = glm::vec2(
+						glm::dot(position - chart.origin, chart.axisU),
+						glm::dot(position - chart.origin, chart.axisV));
+					glm::vec2 texel = glm::vec2((float)(chart.x + g_ChartPadding), (float)(chart.y + g_ChartPadding)) +
+						((projected - chart.planeMin) * chart.density);
+
+					sources[copyCount] = source;
+					copies[copyCount] = (uint32_t)m_vertexSources.size();
+					copyCount++;
+					m_vertexSources.push_back(source);
+					m_coordinates.push_back(glm::vec3(texel / pageSize, (float)chart.page));
+				}
+				m_chartIndices[corner] = copies[found];
+			}
+		}
+	}
+
+	// FNV-1a over the coordinates and the indexes
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t* pBytes = m_coordinates.empty() ? NULL : (const uint8_t*)&m_coordinates[0];
+	for (size_t i = 0; i < m_coordinates.size() * sizeof(glm::vec3); i++)
+	{
+		hash = (hash ^ pBytes[i]) * 1099511628211ull;
+	}
+	for (size_t i = 0; i < m_chartIndices.size(); i++)
+	{
+		hash = (hash ^ m_chartIndices[i]) * 1099511628211ull;
+	}
+	m_layoutHash = hash;
+}
+
+/***********************************************************
+ *  Bake()
+ *
+ *  This method is used for lighting every texel of the
+ *  charts.  A texel takes the surface point nearest its
+ *  center, its normal turned into world space by the normal
+ *  matrix of its surface, and adds up the lights the way the
+ *  shader does for the diffuse and ambient terms.  With more
+ *  point lights than the shader takes, all of them are baked;
+ *  those that fade with distance are only added to the charts
+ *  they reach.  The charts are shared out among the workers,
+ *  and each writes only the rectangle of its own charts.
+ ***********************************************************/
+bool LightmapBaker::Bake(
+	const std::vector<BAKE_SURFACE>& surfaces,
+	const LIGHT_STATE& lights,
+	const std::vector<POINT_LIGHT>& scenePointLights)
+{
+	if (m_charts.empty() == true)
+	{
+		return(false);
+	}
+	for (size_t i = 0; i < m_vertices.size(); i++)
+	{
+		if (m_vertices[i].surface >= surfaces.size())
+		{
+			std::cout << "ERROR: Lightmap vertex " << i << " has no surface to bake" << std::endl;
+			return(false);
+		}
+	}
+
+	BAKE_LIGHTS bakeLights;
+	bakeLights.pLights = &lights;
+	bakeLights.cellSize = 0.0f;
+	bakeLights.pBvh = NULL;
+	if (scenePointLights.empty() == false)
+	{
+		bakeLights.pointLights = scenePointLights;
+	}
+	else
+	{
+		for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+		{
+			if (lights.pointLights[i].bActive == true)
+			{
+				bakeLights.pointLights.push_back(lights.pointLights[i]);
+			}
+		}
+	}
+
+	bakeLights.ranges.resize(bakeLights.pointLights.size());
+	for (size_t i = 0; i < bakeLights.pointLights.size(); i++)
+	{
+		bakeLights.ranges[i] = LightUniforms::GetPointLightRange(bakeLights.pointLights[i]);
+		bakeLights.cellSize = std::max(bakeLights.cellSize, bakeLights.ranges[i]);
+		if (bakeLights.ranges[i] < 0.0f)
+		{
+			bakeLights.unlimitedLights.push_back((int)i);
+		}
+	}
+	for (size_t i = 0; i < bakeLights.pointLights.size(); i++)
+	{
+		if (bakeLights.ranges[i] > 0.0f)
+		{
+			glm::vec3 cell = glm::floor(bakeLights.pointLights[i].position / bakeLights.cellSize);
+			bakeLights.cells[CellKey((int)cell.x, (int)cell.y, (int)cell.z)].push_back((int)i);
+		}
+	}
+	m_stats.lightCount = (int)bakeLights.pointLights.size() +
+		((lights.directionalLight.bActive == true) ? 1 : 0) +
+		((lights.spotLight.bActive == true) ? 1 : 0);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	TriangleBvh bvh;
+	if (m_settings.bOcclusion == true)
+	{
+		std::vector<glm::vec3> positions(m_vertices.size());
+		for (size_t i = 0; i < m_vertices.size(); i++)
+		{
+			positions[i] = m_vertices[i].position;
+		}
+		bvh.Build(positions, m_indices);
+		bakeLights.pBvh = &bvh;
+	}
+	std::chrono::steady_clock::time_point bvhEnd = std::chrono::steady_clock::now();
+	m_stats.bvhMs = ElapsedMs(start, bvhEnd);
+
+	int pageSize = m_settings.pageSize;
+	m_pages.assign((size_t)m_pageCount * pageSize * pageSize * 4, 0);
+	std::atomic<uint64_t> texelCount(0);
+	std::atomic<uint64_t> rayCount(0);
+
+	RunJobs(m_pJobSystem, (int)m_charts.size(), g_ChartsPerJob,
+		[this, &surfaces, &bakeLights, &texelCount, &rayCount, pageSize](int begin, int end)
+		{
+			std::vector<int> pointLights;
+			uint64_t texels = 0;
+			uint64_t rays = 0;
+
+			for (int c = begin; c < end; c++)
+			{
+				const LIGHTMAP_CHART& chart = m_charts[c];
+				FindPointLights(bakeLights, chart.boundsMin, chart.boundsMax, pointLights);
+
+				// the chart's triangles, flattened onto its plane
+				glm::vec2 corners[2][3];
+				for (int i = 0; i < chart.triangleCount; i++)
+				{
+					for (int k = 0; k < 3; k++)
+					{
+						glm::vec3 offset = m_vertices[m_indices[chart.triangles[i] * 3 + k]].position - chart.origin;
+						corners[i][k] = glm::vec2(glm::dot(offset, chart.axisU), glm::dot(offset, chart.axisV));
+					}
+				}
+				const BAKE_SURFACE& surface = surfaces[m_vertices[m_indices[chart.triangles[0] * 3]].surface];
+				glm::vec3 faceNormal = glm::cross(chart.axisU, chart.axisV);
+
+				for (int y = 0; y < chart.height; y++)
+				{
+					for (int x = 0; x < chart.width; x++)
+					{
+						glm::vec2 point = chart.planeMin + (glm::vec2(
+							(float)(x - g_ChartPadding) + 0.5f,
+							(float)(y - g_ChartPadding) + 0.5f) / chart.density);
+
+						int triangle = 0;
+						glm::vec3 barycentric;
+						float nearest = NearestBarycentric(point, corners[0][0], corners[0][1], corners[0][2], barycentric);
+						if ((nearest > 0.0f) && (chart.triangleCount == 2))
+						{
+							glm::vec3 other;
+							if (NearestBarycentric(point, corners[1][0], corners[1][1], corners[1][2], other) < nearest)
+							{
+								triangle = 1;
+								barycentric = other;
+							}
+						}
+
+						glm::vec3 position = glm::vec3(0.0f);
+						glm::vec3 normal = glm::vec3(0.0f);
+						for (int k = 0; k < 3; k++)
+						{
+							const BAKE_VERTEX& vertex = m_vertices[m_indices[chart.triangles[triangle] * 3 + k]];
+							position += vertex.position * barycentric[k];
+							normal += vertex.normal * barycentric[k];
+						}
+						normal = surface.normalMatrix * normal;
+						float length = glm::length(normal);
+						normal = (length > 0.0f) ? (normal / length) : faceNormal;
+
+						glm::vec3 color = LightTexel(bakeLights, pointLights, position, normal, faceNormal, surface.diffuseColor, rays);
+						size_t texel = ((size_t)chart.page * pageSize * pageSize) +
+							((size_t)(chart.y + y) * pageSize) + (size_t)(chart.x + x);
+						EncodeRgbm(color, &m_pages[texel * 4]);
+					}
+				}
+				texels += (uint64_t)chart.width * chart.height;
+			}
+
+			texelCount += texels;
+			rayCount += rays;
+		});
+
+	m_stats.texelCount = texelCount;
+	m_stats.shadowRayCount = rayCount;
+	m_stats.bakeMs = ElapsedMs(bvhEnd, std::chrono::steady_clock::now());
+
+	return(true);
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method is used for writing the baked texels to a
+ *  lightmap file.
+ ***********************************************************/
+bool LightmapBaker::WriteFile(const char* filename) const
+{
+	if (m_pages.empty() == true)
+	{
+		return(false);
+	}
+
+	LIGHTMAP_FILE_HEADER header = {};
+	header.magic = LIGHTMAP_FILE_MAGIC;
+	header.version = LIGHTMAP_FILE_VERSION;
+	header.headerSize = sizeof(LIGHTMAP_FILE_HEADER);
+	header.pageSize = (uint32_t)m_settings.pageSize;
+	header.pageCount = (uint32_t)m_pageCount;
+	header.vertexCount = (uint32_t)m_vertexSources.size();
+	header.indexCount = (uint32_t)m_chartIndices.size();
+	header.bOcclusion = m_settings.bOcclusion ? 1 : 0;
+	header.texelsPerUnit = m_settings.texelsPerUnit;
+	header.layoutHash = m_layoutHash;
+
+	FILE* pFile = fopen(filename, "wb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: Could not create lightmap:" << filename << std::endl;
+		return(false);
+	}
+	bool bWritten = (fwrite(&header, sizeof(header), 1, pFile) == 1) &&
+		(fwrite(&m_pages[0], 1, m_pages.size(), pFile) == m_pages.size());
+	bWritten = (fclose(pFile) == 0) && bWritten;
+	if (bWritten == false)
+	{
+		std::cout << "ERROR: Could not write lightmap:" << filename << std::endl;
+	}
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading the texels of a lightmap
+ *  file baked for the charts built last.  The file is turned
+ *  down when its layout is not the same as the charts', as
+ *  its texels would land on the wrong surfaces.
+ ***********************************************************/
+bool LightmapBaker::ReadFile(const char* filename)
+{
+	if (m_charts.empty() == true)
+	{
+		return(false);
+	}
+
+	FILE* pFile = fopen(filename, "rb");
+	if (NULL == pFile)
+	{
+		std::cout << "ERROR: Could not open lightmap:" << filename << std::endl;
+		return(false);
+	}
+
+	LIGHTMAP_FILE_HEADER header = {};
+	bool bValid = (fread(&header, sizeof(header), 1, pFile) == 1) &&
+		(LIGHTMAP_FILE_MAGIC == header.magic) &&
+		(LIGHTMAP_FILE_VERSION == header.version) &&
+		(sizeof(LIGHTMAP_FILE_HEADER) == header.headerSize);
+	bool bMatches = (bValid == true) &&
+		(header.pageSize == (uint32_t)m_settings.pageSize) &&
+		(header.pageCount == (uint32_t)m_pageCount) &&
+		(header.vertexCount == (uint32_t)m_vertexSources.size()) &&
+		(header.indexCount == (uint32_t)m_chartIndices.size()) &&
+		(header.layoutHash == m_layoutHash);
+	if (bMatches == true)
+	{
+		m_pages.resize((size_t)m_pageCount * m_settings.pageSize * m_settings.pageSize * 4);
+		bValid = (fread(&m_pages[0], 1, m_pages.size(), pFile) == m_pages.size());
+	}
+	fclose(pFile);
+
+	if (bValid == false)
+	{
+		std::cout << "ERROR: Invalid lightmap:" << filename << std::endl;
+		m_pages.clear();
+		return(false);
+	}
+	if (bMatches == false)
+	{
+		std::cout << "ERROR: Lightmap " << filename << " was baked for other static geometry or texel density, bake it again" << std::endl;
+		m_pages.clear();
+		return(false);
+	}
+
+	m_settings.bOcclusion = (header.bOcclusion != 0);
+	return(true);
+}
+
+/***********************************************************
+ *  WritePreviews()
+ *
+ *  This method is used for writing every page as a TGA image,
+ *  with the light decoded and clipped at one, named after the
+ *  prefix with the page number.
+ ***********************************************************/
+bool LightmapBaker::WritePreviews(const std::string& prefix) const
+{
+	int pageSize = m_settings.pageSize;
+	size_t pageBytes = (size_t)pageSize * pageSize * 4;
+	std::vector<unsigned char> pixels(pageBytes);
+	std::vector<unsigned char> image;
+	bool bWritten = true;
+
+	for (int page = 0; (page < m_pageCount) && (m_pages.empty() == false); page++)
+	{
+		const uint8_t* pTexels = &m_pages[page * pageBytes];
+		for (size_t i = 0; i < pageBytes; i += 4)
+		{
+			float multiplier = (pTexels[i + 3] / 255.0f) * g_RgbmRange;
+			for (int k = 0; k < 3; k++)
+			{
+				pixels[i + k] = (unsigned char)std::min(255.0f, pTexels[i + k] * multiplier);
+			}
+			pixels[i + 3] = 255;
+		}
+
+		// the first row is the bottom of the page, as OpenGL reads it
+		ImageWriter::EncodeTga(&pixels[0], pageSize, pageSize, (size_t)pageSize * 4, true, true, image);
+		std::string filename = prefix + ".page" + std::to_string(page) + ".tga";
+		bWritten = ImageWriter::WriteFile(filename.c_str(), image) && bWritten;
+	}
+
+	return(bWritten);
+}
+
+/***********************************************************
+ *  GetVertexSources()
+ *
+ *  This method is used for getting the merged vertex every
+ *  chart vertex is a copy of.
+ ***********************************************************/
+const std::vector<uint32_t>& LightmapBaker::GetVertexSources() const
+{
+	return(m_vertexSources);
+}
+
+/***********************************************************
+ *  GetCoordinates()
+ *
+ *  This method is used for getting the lightmap coordinate
+ *  and page of every chart vertex.
+ ***********************************************************/
+const std::vector<glm::vec3>& LightmapBaker::GetCoordinates() const
+{
+	return(m_coordinates);
+}
+
+/***********************************************************
+ *  GetIndices()
+ *
+ *  This method is used for getting the triangles over the
+ *  chart vertices, in the order of the merged triangles.
+ ***********************************************************/
+const std::vector<uint32_t>& LightmapBaker::GetIndices() const
+{
+	return(m_chartIndices);
+}
+
+/***********************************************************
+ *  GetPages()
+ *
+ *  This method is used for getting the RGBM texels of every
+ *  page, baked or read from a file.
+ ***********************************************************/
+const std::vector<uint8_t>& LightmapBaker::GetPages() const
+{
+	return(m_pages);
+}
+
+/***********************************************************
+ *  GetPageCount()
+ *
+ *  This method is used for getting the number of pages.
+ ***********************************************************/
+int LightmapBaker::GetPageCount() const
+{
+	return(m_pageCount);
+}
+
+/***********************************************************
+ *  GetPageSize()
+ *
+ *  This method is used for getting the width and height of
+ *  a page.
+ ***********************************************************/
+int LightmapBaker::GetPageSize() const
+{
+	return(m_settings.pageSize);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the counts and timings of
+ *  the last charts and bake.
+ ***********************************************************/
+const LightmapBaker::BAKE_STATS& LightmapBaker::GetStats() const
+{
+	return(m_stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the counts and timings
+ *  of the last charts and bake.
+ ***********************************************************/
+void LightmapBaker::PrintStats() const
+{
+	std::cout << "LIGHTMAP: " << m_stats.triangleCount << " triangles in "
+		<< m_stats.chartCount << " charts on " << m_stats.pageCount << " pages of "
+		<< m_settings.pageSize << "x" << m_settings.pageSize
+		<< ", " << m_stats.lightCount << " lights"
+		<< ", " << m_stats.texelCount << " texels"
+		<< ", " << m_stats.shadowRayCount << " shadow rays"
+		<< ", charts " << m_stats.chartMs << " ms"
+		<< ", bvh " << m_stats.bvhMs << " ms"
+		<< ", bake " << m_stats.bakeMs << " ms"
+		<< std::endl;
+}
@@ -0,0 +1,203 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmapbaker.h
+// ============
+// bake the diffuse light of the scene's lights into lightmap atlases for the
+// static geometry, so only the specular light is computed per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameSnapshot.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+// "LMAP" read as a little-endian 32-bit value
+const uint32_t LIGHTMAP_FILE_MAGIC = 0x50414D4C;
+const uint32_t LIGHTMAP_FILE_VERSION = 1;
+
+// the header is followed by the RGBM texels of every page
+struct LIGHTMAP_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t pageSize;
+	uint32_t pageCount;
+	// unwelded geometry the charts were laid out for
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// set when the texels were baked with shadow rays
+	uint32_t bOcclusion;
+	float texelsPerUnit;
+	uint32_t reserved;
+	// hash of the lightmap coordinates, so a lightmap is only used
+	// with the geometry it was baked for
+	uint64_t layoutHash;
+};
+
+/***********************************************************
+ *  LightmapBaker
+ *
+ *  This class gives the merged static geometry a second set
+ *  of texture coordinates and bakes the light falling on it.
+ *  The triangles are split into charts, single triangles or
+ *  flat pairs of them, that are laid flat at a fixed number
+ *  of texels per world unit and packed into square atlas
+ *  pages with a texel of padding around each.  Every texel
+ *  is lit from the surface point nearest its center, so the
+ *  padding repeats the edge of its chart for filtering.
+ *
+ *  A texel holds the ambient light plus the diffuse light
+ *  times the diffuse color of its object's material, which
+ *  the shader multiplies with the texture color; it is kept
+ *  as RGBM so the light can be brighter than one.  Shadow
+ *  rays are traced through a BVH over the static triangles
+ *  when occlusion is turned on.  The charts are baked on the
+ *  workers of the job system.
+ *
+ *  The layout of the charts only depends on the geometry and
+ *  the settings, so a lightmap file only holds the texels;
+ *  the charts are built again when it is loaded, and a hash
+ *  of their coordinates checks that it still fits.
+ ***********************************************************/
+class LightmapBaker
+{
+public:
+	// constructor
+	LightmapBaker(JobSystem* pJobSystem = NULL);
+
+	struct BAKE_SETTINGS
+	{
+		// lightmap texels per world unit
+		float texelsPerUnit;
+		// width and height of an atlas page, in texels
+		int pageSize;
+		// trace shadow rays through the static geometry
+		bool bOcclusion;
+
+		BAKE_SETTINGS()
+		{
+			texelsPerUnit = 32.0f;
+			pageSize = 1024;
+			bOcclusion = false;
+		}
+	};
+
+	// a vertex of the merged static geometry, with its position
+	// in world space and its normal in the space of its object
+	struct BAKE_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		// the surface, the static draw index, the vertex belongs to
+		uint32_t surface;
+	};
+
+	// how a surface turns its normals into world space, and the
+	// diffuse color of its material
+	struct BAKE_SURFACE
+	{
+		glm::mat3 normalMatrix;
+		glm::vec3 diffuseColor;
+	};
+
+	struct BAKE_STATS
+	{
+		int triangleCount;
+		int chartCount;
+		int pageCount;
+		int lightCount;
+		uint64_t texelCount;
+		uint64_t shadowRayCount;
+		double chartMs;
+		double bvhMs;
+		double bakeMs;
+	};
+
+private:
+	// a triangle, or two that share an edge and lie flat, laid
+	// out in a rectangle of one page
+	struct LIGHTMAP_CHART
+	{
+		uint32_t triangles[2];
+		int triangleCount;
+		// plane the triangles are projected onto
+		glm::vec3 origin;
+		glm::vec3 axisU;
+		glm::vec3 axisV;
+		// smallest projected coordinate and the projected size
+		glm::vec2 planeMin;
+		glm::vec2 planeSize;
+		// texels per world unit, lower for charts larger than a page
+		float density;
+		// rectangle in its page, padding included
+		int page;
+		int x;
+		int y;
+		int width;
+		int height;
+		// world space bounds, for finding the lights that reach it
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+	JobSystem* m_pJobSystem;
+	BAKE_SETTINGS m_settings;
+	// merged geometry the charts were built from
+	std::vector<BAKE_VERTEX> m_vertices;
+	std::vector<uint32_t> m_indices;
+	std::vector<LIGHTMAP_CHART> m_charts;
+	// unwelded geometry: the merged vertex every chart vertex is a
+	// copy of, its lightmap coordinate and page, and the triangles
+	std::vector<uint32_t> m_vertexSources;
+	std::vector<glm::vec3> m_coordinates;
+	std::vector<uint32_t> m_chartIndices;
+	uint64_t m_layoutHash;
+	// RGBM texels of every page, one page after another
+	int m_pageCount;
+	std::vector<uint8_t> m_pages;
+	BAKE_STATS m_stats;
+
+	// group the triangles into charts and lay each one flat
+	void CreateCharts();
+	// pack the charts into pages, returns false when too many are needed
+	bool PackCharts();
+	// copy the chart vertices and give them their coordinates
+	void UnweldCharts();
+
+public:
+	// split the merged triangles into charts and pack them into pages
+	bool BuildCharts(
+		const std::vector<BAKE_VERTEX>& vertices,
+		const std::vector<uint32_t>& indices,
+		const BAKE_SETTINGS& settings);
+	// light every texel of the charts
+	bool Bake(
+		const std::vector<BAKE_SURFACE>& surfaces,
+		const LIGHT_STATE& lights,
+		const std::vector<POINT_LIGHT>& scenePointLights);
+
+	// write the baked texels, and read them back for the same charts
+	bool WriteFile(const char* filename) const;
+	bool ReadFile(const char* filename);
+	// write every page as a TGA image to look at
+	bool WritePreviews(const std::string& prefix) const;
+
+	// the unwelded geometry the lightmap coordinates belong to
+	const std::vector<uint32_t>& GetVertexSources() const;
+	const std::vector<glm::vec3>& GetCoordinates() const;
+	const std::vector<uint32_t>& GetIndices() const;
+	// RGBM texels of every page
+	const std::vector<uint8_t>& GetPages() const;
+	int GetPageCount() const;
+	int GetPageSize() const;
+
+	const BAKE_STATS& GetStats() const;
+	void PrintStats() const;
+};
@@ -9,6 +9,14 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <cstdio>           // sscanf
+#include <atomic>           // render thread handshake
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <string>
+#include <algorithm>        // farm thread counts
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -20,6 +28,21 @@
 
 #include "SceneManager.h"
 #include "ViewManager.h"
+#include "FrameScheduler.h"
+#include "DynamicResolution.h"
+#include "BatchRenderer.h"
+#include "RenderFarm.h"
+#include "FrameStreamer.h"
+#include "InputRecorder.h"
+#include "JobSystem.h"
+#include "FrameSnapshot.h"
+#include "TripleBuffer.h"
+#include "SceneConverter.h"
+#include "SceneGenerator.h"
+#include "LightmapBaker.h"
+#include "MemoryTracker.h"
+#include "AllocationCounter.h"
+#include "CounterOverlay.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
 
@@ -38,12 +61,120 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// frame scheduler object for the update and render timing of the main loop
+	FrameScheduler* g_FrameScheduler = nullptr;
+	// dynamic resolution object for rendering the scene at a scaled size
+	DynamicResolution* g_DynamicResolution = nullptr;
+	// frame streamer object for writing the frames as raw video
+	FrameStreamer* g_FrameStreamer = nullptr;
+	// counter overlay object for drawing the render counters over the frame
+	CounterOverlay* g_CounterOverlay = nullptr;
+	// input recorder object for recording or replaying the camera input
+	InputRecorder* g_InputRecorder = nullptr;
+	// job system object for spreading work across the cores
+	JobSystem* g_JobSystem = nullptr;
+
+	// options that can be set from the command line
+	struct APP_OPTIONS
+	{
+		FrameScheduler::SyncMode syncMode = FrameScheduler::SYNC_VSYNC;
+		double frameRateCap = 0.0;
+		double updateRate = 120.0;
+		double statsInterval = 0.0;
+		bool bDynamicResolution = false;
+		float minResolutionScale = 0.5f;
+		float maxResolutionScale = 1.0f;
+		float targetFrameMs = 16.0f;
+		DynamicResolution::UpscaleFilter upscaleFilter = DynamicResolution::UPSCALE_BILINEAR;
+		int workerCount = 0;
+		bool bRenderThread = false;
+		// turn the view by the newest mouse input right before the
+		// frame is drawn
+		bool bLateLatch = false;
+		// views drawn side by side in one pass, 1 for the camera alone
+		int viewCount = 1;
+		bool bCompactVertices = false;
+		// binary scene file to load instead of the built-in scene
+		std::string sceneFilename;
+		// world file whose cells are streamed around the camera
+		std::string worldFilename;
+		// text scene to convert into a binary scene file, then exit
+		std::string convertTextFilename;
+		std::string convertBinaryFilename;
+		// street scene generated with this many objects before the
+		// scene is loaded, and the seed of its random placement
+		int generateObjectCount = 0;
+		std::string generateFilename;
+		uint32_t generateSeed = 1;
+		// lightmap the static objects are lit from, baked into the
+		// file first when bBakeLightmap is set
+		std::string lightmapFilename;
+		bool bBakeLightmap = false;
+		LightmapBaker::BAKE_SETTINGS lightmapSettings;
+		// draw the frames on the CPU instead of with OpenGL
+		bool bSoftwareRenderer = false;
+		// image the last software frame is written to at exit
+		std::string softwareImageFilename;
+		// frames drawn before the application closes, 0 for no limit
+		uint64_t frameLimit = 0;
+		// pose file rendered into images in a hidden window, and
+		// the prefix of the image files
+		std::string batchPoseFilename;
+		std::string batchOutputPrefix = "batch_";
+		// threads that render the batch on the CPU, 0 to render it
+		// with OpenGL, and whether to run it with 1, 2, 4... threads
+		int farmThreadCount = 0;
+		bool bFarmScaling = false;
+		// raw video stream of the window's frames, "-" for stdout
+		std::string streamOutput;
+		FrameStreamer::STREAM_FORMAT streamFormat = FrameStreamer::STREAM_RGB24;
+		float streamFrameRate = 30.0f;
+		bool bStreamSimd = true;
+		// input log the camera input is recorded into or replayed
+		// from, and the update steps a replayed frame runs
+		std::string recordInputFilename;
+		std::string replayInputFilename;
+		int replayStepsPerFrame = 1;
+		// draw into a hidden window
+		bool bOffscreen = false;
+		// JSON file the tracked memory is written to at exit, and
+		// whether memory still tracked at shutdown is reported
+		std::string memoryReportFilename;
+		bool bLeakReport = false;
+		// CSV file the render counters of every frame are written to
+		std::string countersFilename;
+		// fail the run when a frame after the warm-up frames
+		// allocates from the heap
+		bool bAssertNoAlloc = false;
+		int allocationWarmupFrames = 120;
+	};
+	APP_OPTIONS g_Options;
+
+	// frame snapshots handed from the update thread to the render thread
+	TripleBuffer<FRAME_SNAPSHOT>* g_FrameSnapshots = nullptr;
+	// wakes the render thread when a snapshot is published
+	std::mutex g_RenderMutex;
+	std::condition_variable g_RenderCondition;
+	std::atomic<bool> g_bRenderThreadRunning(false);
+	// index of the last snapshot the render thread has acquired
+	std::atomic<uint64_t> g_AcquiredFrameIndex(0);
+	// render thread statistics are printed with the next snapshot
+	bool g_bRenderStatsPending = false;
 }
 
 // Function declarations - all functions that are called manually
 // need to be pre-declared at the beginning of the source code.
+bool ParseCommandLine(int argc, char* argv[]);
 bool InitializeGLFW();
 bool InitializeGLEW();
+void BuildFrameSnapshot(FRAME_SNAPSHOT& snapshot, uint64_t frameIndex);
+void RenderFrame(const FRAME_SNAPSHOT& snapshot);
+void ReportFrameStats();
+void RunSingleThreaded();
+void RunRenderThreaded();
+void RenderThreadMain();
+bool RunBatch();
+bool RunFarm();
 
 
 /***********************************************************
@@ -54,12 +185,51 @@ bool InitializeGLEW();
  ***********************************************************/
 int main(int argc, char* argv[])
 {
+	// if the command line options are invalid, then terminate the application
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// the frames take stdout when they are streamed to it, so the
+	// console messages go to stderr
+	if (g_Options.streamOutput == "-")
+	{
+		std::cout.rdbuf(std::cerr.rdbuf());
+	}
+
+	// converting a scene needs no window, so it is done before GLFW starts
+	if (g_Options.convertTextFilename.empty() == false)
+	{
+		bool bConverted = SceneConverter::ConvertTextScene(
+			g_Options.convertTextFilename.c_str(),
+			g_Options.convertBinaryFilename.c_str());
+		return(bConverted ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	// the generated scene is written before the window opens, so
+	// its load time is measured like that of any scene file
+	if (g_Options.generateFilename.empty() == false)
+	{
+		if (SceneGenerator::GenerateStreetScene(
+			g_Options.generateFilename.c_str(),
+			g_Options.generateObjectCount,
+			g_Options.generateSeed) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// start the job system, with the main thread as its first worker
+	g_JobSystem = new JobSystem();
+	g_JobSystem->Initialize(g_Options.workerCount);
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
@@ -69,6 +239,43 @@ int main(int argc, char* argv[])
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
 
+	// a replay runs the update steps of its log at the log's step
+	// length, a fixed number each frame, for as many frames as
+	// the log needs
+	if ((g_Options.recordInputFilename.empty() == false) ||
+		(g_Options.replayInputFilename.empty() == false))
+	{
+		g_InputRecorder = new InputRecorder();
+		bool bStarted = false;
+		if (g_Options.replayInputFilename.empty() == false)
+		{
+			bStarted = g_InputRecorder->LoadReplay(g_Options.replayInputFilename.c_str());
+			if (bStarted == true)
+			{
+				g_Options.updateRate = 1.0 / g_InputRecorder->GetFixedTimestep();
+				uint64_t replayFrames = ((uint64_t)g_InputRecorder->GetStepCount() + g_Options.replayStepsPerFrame - 1) /
+					g_Options.replayStepsPerFrame;
+				if ((g_Options.frameLimit == 0) || (g_Options.frameLimit > replayFrames))
+				{
+					g_Options.frameLimit = std::max<uint64_t>(replayFrames, 1);
+				}
+			}
+		}
+		else
+		{
+			bStarted = g_InputRecorder->BeginRecording(
+				g_Options.recordInputFilename.c_str(),
+				(float)(1.0 / g_Options.updateRate));
+		}
+		if (bStarted == false)
+		{
+			return(EXIT_FAILURE);
+		}
+		g_ViewManager->SetInputRecorder(g_InputRecorder);
+	}
+	g_ViewManager->SetLateLatch(g_Options.bLateLatch);
+	g_ViewManager->SetViewCount(g_Options.viewCount);
+
 	// if GLEW fails initialization, then terminate the application
 	if (InitializeGLEW() == false)
 	{
@@ -82,35 +289,175 @@ int main(int argc, char* argv[])
 	g_ShaderManager->use();
 
 	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
+	g_SceneManager = new SceneManager(g_ShaderManager, g_JobSystem);
+	g_SceneManager->SetCompactVertices(g_Options.bCompactVertices);
+	g_SceneManager->SetSoftwareRenderer(g_Options.bSoftwareRenderer);
+	if (g_Options.lightmapFilename.empty() == false)
+	{
+		g_SceneManager->SetLightmap(
+			g_Options.lightmapFilename.c_str(),
+			g_Options.bBakeLightmap,
+			g_Options.lightmapSettings);
+	}
+	bool bScenePrepared = false;
+	if (g_Options.worldFilename.empty() == false)
+	{
+		bScenePrepared = g_SceneManager->PrepareWorld(g_Options.worldFilename.c_str());
+	}
+	else
+	{
+		bScenePrepared = g_SceneManager->PrepareScene(
+			g_Options.sceneFilename.empty() ? NULL : g_Options.sceneFilename.c_str());
+	}
+	if (bScenePrepared == false)
+	{
+		return(EXIT_FAILURE);
+	}
 
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
+	// count the work of every drawn frame, shown over the frame
+	// when its key is pressed and logged when requested
+	RenderCounters* pRenderCounters = g_SceneManager->GetRenderCounters();
+	g_ViewManager->SetRenderCounters(pRenderCounters);
+	if (g_Options.countersFilename.empty() == false)
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		if (pRenderCounters->OpenCsv(g_Options.countersFilename.c_str()) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
+	g_CounterOverlay = new CounterOverlay();
+	g_CounterOverlay->Initialize();
+	g_ShaderManager->use();
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// create the frame scheduler that paces the main loop
+	g_FrameScheduler = new FrameScheduler();
+	g_FrameScheduler->Initialize(
+		g_Window,
+		g_Options.syncMode,
+		g_Options.frameRateCap,
+		g_Options.updateRate);
+	g_FrameScheduler->SetReportInterval(g_Options.statsInterval);
+	if ((NULL != g_InputRecorder) && (g_InputRecorder->IsReplaying()))
+	{
+		g_FrameScheduler->SetSimulatedSteps(g_Options.replayStepsPerFrame);
+	}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+	// create the offscreen target when dynamic resolution is enabled,
+	// the software renderer draws at the window size
+	if ((g_Options.bDynamicResolution) && (!g_Options.bSoftwareRenderer))
+	{
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+		g_DynamicResolution = new DynamicResolution();
+		if (g_DynamicResolution->Initialize(
+			framebufferWidth,
+			framebufferHeight,
+			g_Options.minResolutionScale,
+			g_Options.maxResolutionScale,
+			g_Options.targetFrameMs,
+			g_Options.upscaleFilter) == false)
+		{
+			delete g_DynamicResolution;
+			g_DynamicResolution = NULL;
+		}
+	}
 
+	// start streaming the frames at the window size
+	if (g_Options.streamOutput.empty() == false)
+	{
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
 
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
+		g_FrameStreamer = new FrameStreamer();
+		if (g_FrameStreamer->Initialize(
+			g_Options.streamOutput.c_str(),
+			g_Options.streamFormat,
+			framebufferWidth,
+			framebufferHeight,
+			g_Options.streamFrameRate,
+			g_Options.bStreamSimd) == false)
+		{
+			return(EXIT_FAILURE);
+		}
+	}
 
-		// query the latest GLFW events
-		glfwPollEvents();
+	// run the main loop, with the GL submission either on this
+	// thread or on a render thread of its own, or render the
+	// poses of a batch
+	bool bBatchRendered = true;
+	if (g_Options.bAssertNoAlloc)
+	{
+		AllocationCounter::SetSteadyStateFrame((uint64_t)g_Options.allocationWarmupFrames + 1);
+	}
+	if (g_Options.farmThreadCount > 0)
+	{
+		bBatchRendered = RunFarm();
+	}
+	else if (g_Options.batchPoseFilename.empty() == false)
+	{
+		bBatchRendered = RunBatch();
+	}
+	else if (g_Options.bRenderThread)
+	{
+		RunRenderThreaded();
+	}
+	else
+	{
+		RunSingleThreaded();
+	}
+	bool bAllocationsClean = true;
+	if (g_Options.bAssertNoAlloc)
+	{
+		bAllocationsClean = AllocationCounter::CheckSteadyState();
+	}
+	// the latency of the input since the last report
+	g_ViewManager->PrintLatencyStats();
+
+	// the memory while the scene is still loaded
+	MemoryTracker::PrintStats();
+	if (g_Options.memoryReportFilename.empty() == false)
+	{
+		MemoryTracker::WriteJson(g_Options.memoryReportFilename.c_str());
+	}
+
+	if (g_Options.softwareImageFilename.empty() == false)
+	{
+		g_SceneManager->WriteSoftwareImage(g_Options.softwareImageFilename.c_str());
+	}
+
+	// write a recorded input log, or report how a replay went
+	if (NULL != g_InputRecorder)
+	{
+		g_InputRecorder->Finish(g_ViewManager->GetCameraState());
+		g_InputRecorder->PrintStats();
 	}
 
 	// clear the allocated manager objects from memory
+	if (NULL != g_FrameStreamer)
+	{
+		g_FrameStreamer->Destroy();
+		g_FrameStreamer->PrintStats();
+		delete g_FrameStreamer;
+		g_FrameStreamer = NULL;
+	}
+	if (NULL != g_DynamicResolution)
+	{
+		delete g_DynamicResolution;
+		g_DynamicResolution = NULL;
+	}
+	if (NULL != g_CounterOverlay)
+	{
+		delete g_CounterOverlay;
+		g_CounterOverlay = NULL;
+	}
+	if (NULL != g_FrameScheduler)
+	{
+		delete g_FrameScheduler;
+		g_FrameScheduler = NULL;
+	}
 	if (NULL != g_SceneManager)
 	{
 		delete g_SceneManager;
@@ -121,14 +468,438 @@ int main(int argc, char* argv[])
 		delete g_ViewManager;
 		g_ViewManager = NULL;
 	}
+	if (NULL != g_InputRecorder)
+	{
+		delete g_InputRecorder;
+		g_InputRecorder = NULL;
+	}
 	if (NULL != g_ShaderManager)
 	{
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_JobSystem)
+	{
+		delete g_JobSystem;
+		g_JobSystem = NULL;
+	}
+
+	// everything still tracked once the managers are gone was
+	// never freed
+	if (g_Options.bLeakReport)
+	{
+		MemoryTracker::ReportLeaks();
+	}
 
 	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
+	exit(((bBatchRendered) && (bAllocationsClean)) ? EXIT_SUCCESS : EXIT_FAILURE); 
+}
+
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the application options
+ *  from the command line arguments.
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* argument = argv[i];
+
+		// swap interval: off, on (vsync) or adaptive
+		if (strcmp(argument, "--vsync=off") == 0)
+		{
+			g_Options.syncMode = FrameScheduler::SYNC_OFF;
+		}
+		else if (strcmp(argument, "--vsync=on") == 0)
+		{
+			g_Options.syncMode = FrameScheduler::SYNC_VSYNC;
+		}
+		else if (strcmp(argument, "--vsync=adaptive") == 0)
+		{
+			g_Options.syncMode = FrameScheduler::SYNC_ADAPTIVE;
+		}
+		// frame rate cap applied by the frame limiter, 0 for none
+		else if (strncmp(argument, "--fps-cap=", 10) == 0)
+		{
+			g_Options.frameRateCap = atof(argument + 10);
+		}
+		// number of fixed update steps per second
+		else if (strncmp(argument, "--tick-rate=", 12) == 0)
+		{
+			g_Options.updateRate = atof(argument + 12);
+			if (g_Options.updateRate <= 0.0)
+			{
+				std::cerr << "ERROR: The tick rate must be greater than zero" << std::endl;
+				return(false);
+			}
+		}
+		// seconds between frame pacing reports, 0 for none
+		else if (strncmp(argument, "--stats=", 8) == 0)
+		{
+			g_Options.statsInterval = atof(argument + 8);
+		}
+		// render at a scale between MIN and MAX of the window size
+		else if (strncmp(argument, "--dynamic-res=", 14) == 0)
+		{
+			g_Options.bDynamicResolution = true;
+			if (sscanf(argument + 14, "%f,%f",
+				&g_Options.minResolutionScale,
+				&g_Options.maxResolutionScale) != 2)
+			{
+				std::cerr << "ERROR: Expected --dynamic-res=MIN,MAX" << std::endl;
+				return(false);
+			}
+		}
+		// GPU frame time held by the dynamic resolution controller
+		else if (strncmp(argument, "--target-ms=", 12) == 0)
+		{
+			g_Options.targetFrameMs = (float)atof(argument + 12);
+		}
+		// filter used to upscale the scene to the window
+		else if (strcmp(argument, "--upscale=bilinear") == 0)
+		{
+			g_Options.upscaleFilter = DynamicResolution::UPSCALE_BILINEAR;
+		}
+		else if (strcmp(argument, "--upscale=sharpen") == 0)
+		{
+			g_Options.upscaleFilter = DynamicResolution::UPSCALE_SHARPEN;
+		}
+		// number of job system workers, 0 for one per core
+		else if (strncmp(argument, "--workers=", 10) == 0)
+		{
+			g_Options.workerCount = atoi(argument + 10);
+		}
+		// submit to OpenGL from a render thread of its own
+		else if (strcmp(argument, "--render-thread") == 0)
+		{
+			g_Options.bRenderThread = true;
+		}
+		// latch the camera from the newest input right before drawing
+		else if (strcmp(argument, "--late-latch") == 0)
+		{
+			g_Options.bLateLatch = true;
+		}
+		// draw the perspective, orthographic and top-down views side
+		// by side in one pass
+		else if (strncmp(argument, "--multi-view=", 13) == 0)
+		{
+			g_Options.viewCount = atoi(argument + 13);
+			if ((g_Options.viewCount < 1) || (g_Options.viewCount > SceneView::MAX_VIEWS))
+			{
+				std::cerr << "ERROR: Expected --multi-view=N with 1 to " << SceneView::MAX_VIEWS << " views" << std::endl;
+				return(false);
+			}
+		}
+		// pack the basic shapes into 16 byte vertices
+		else if (strcmp(argument, "--compact-vertices") == 0)
+		{
+			g_Options.bCompactVertices = true;
+		}
+		// load the scene from a binary scene file
+		else if (strncmp(argument, "--scene=", 8) == 0)
+		{
+			g_Options.sceneFilename = argument + 8;
+		}
+		// stream the cells of a world file around the camera
+		else if (strncmp(argument, "--world=", 8) == 0)
+		{
+			g_Options.worldFilename = argument + 8;
+		}
+		// convert a text scene into a binary scene file and exit
+		else if (strncmp(argument, "--convert-scene=", 16) == 0)
+		{
+			const char* separator = strchr(argument + 16, ',');
+			if (NULL == separator)
+			{
+				std::cerr << "ERROR: Expected --convert-scene=TEXT,BINARY" << std::endl;
+				return(false);
+			}
+			g_Options.convertTextFilename.assign(argument + 16, separator);
+			g_Options.convertBinaryFilename = separator + 1;
+		}
+		// generate a street scene, and load it unless another scene is given
+		else if (strncmp(argument, "--generate-scene=", 17) == 0)
+		{
+			const char* separator = strchr(argument + 17, ',');
+			g_Options.generateObjectCount = atoi(argument + 17);
+			if ((NULL == separator) || (g_Options.generateObjectCount < 1))
+			{
+				std::cerr << "ERROR: Expected --generate-scene=OBJECTS,BINARY with at least one object" << std::endl;
+				return(false);
+			}
+			g_Options.generateFilename = separator + 1;
+		}
+		else if (strncmp(argument, "--generate-seed=", 16) == 0)
+		{
+			g_Options.generateSeed = (uint32_t)strtoul(argument + 16, NULL, 10);
+		}
+		// bake the lightmap of the static objects into a file, or
+		// light them from one baked before
+		else if (strncmp(argument, "--bake-lightmap=", 16) == 0)
+		{
+			g_Options.lightmapFilename = argument + 16;
+			g_Options.bBakeLightmap = true;
+		}
+		else if (strncmp(argument, "--lightmap=", 11) == 0)
+		{
+			g_Options.lightmapFilename = argument + 11;
+			g_Options.bBakeLightmap = false;
+		}
+		// lightmap texels per world unit
+		else if (strncmp(argument, "--lightmap-density=", 19) == 0)
+		{
+			g_Options.lightmapSettings.texelsPerUnit = (float)atof(argument + 19);
+			if (g_Options.lightmapSettings.texelsPerUnit <= 0.0f)
+			{
+				std::cerr << "ERROR: Expected --lightmap-density=N above zero" << std::endl;
+				return(false);
+			}
+		}
+		// trace shadow rays while the lightmap is baked
+		else if (strcmp(argument, "--lightmap-shadows") == 0)
+		{
+			g_Options.lightmapSettings.bOcclusion = true;
+		}
+		// draw the frames with OpenGL or on the CPU
+		else if (strcmp(argument, "--renderer=opengl") == 0)
+		{
+			g_Options.bSoftwareRenderer = false;
+		}
+		else if (strcmp(argument, "--renderer=software") == 0)
+		{
+			g_Options.bSoftwareRenderer = true;
+		}
+		// write the last software frame to a TGA file at exit
+		else if (strncmp(argument, "--software-image=", 17) == 0)
+		{
+			g_Options.softwareImageFilename = argument + 17;
+		}
+		// close the application after N frames
+		else if (strncmp(argument, "--frames=", 9) == 0)
+		{
+			g_Options.frameLimit = strtoull(argument + 9, NULL, 10);
+		}
+		// render the camera poses of a pose file into images
+		else if (strncmp(argument, "--batch=", 8) == 0)
+		{
+			g_Options.batchPoseFilename = argument + 8;
+		}
+		// prefix of the batch image files, followed by the pose index
+		else if (strncmp(argument, "--batch-output=", 15) == 0)
+		{
+			g_Options.batchOutputPrefix = argument + 15;
+		}
+		// render the batch on N threads with software rasterizers
+		else if (strncmp(argument, "--farm=", 7) == 0)
+		{
+			g_Options.farmThreadCount = atoi(argument + 7);
+			if (g_Options.farmThreadCount < 1)
+			{
+				std::cerr << "ERROR: Expected --farm=N with at least one thread" << std::endl;
+				return(false);
+			}
+		}
+		// render the batch with 1, 2, 4... up to the farm threads
+		else if (strcmp(argument, "--farm-scaling") == 0)
+		{
+			g_Options.bFarmScaling = true;
+		}
+		// stream the frames as raw video to a file, a named pipe or stdout
+		else if (strncmp(argument, "--stream=", 9) == 0)
+		{
+			g_Options.streamOutput = argument + 9;
+		}
+		else if (strcmp(argument, "--stream-format=rgb") == 0)
+		{
+			g_Options.streamFormat = FrameStreamer::STREAM_RGB24;
+		}
+		else if (strcmp(argument, "--stream-format=yuv420") == 0)
+		{
+			g_Options.streamFormat = FrameStreamer::STREAM_YUV420;
+		}
+		// fixed frame rate of the stream
+		else if (strncmp(argument, "--stream-fps=", 13) == 0)
+		{
+			g_Options.streamFrameRate = (float)atof(argument + 13);
+		}
+		// convert the stream frames without SSE2, for comparison
+		else if (strcmp(argument, "--stream-scalar") == 0)
+		{
+			g_Options.bStreamSimd = false;
+		}
+		// record the camera input into a log, or replay a log
+		else if (strncmp(argument, "--record-input=", 15) == 0)
+		{
+			g_Options.recordInputFilename = argument + 15;
+		}
+		else if (strncmp(argument, "--replay-input=", 15) == 0)
+		{
+			g_Options.replayInputFilename = argument + 15;
+		}
+		// update steps run by every replayed frame
+		else if (strncmp(argument, "--replay-steps=", 15) == 0)
+		{
+			g_Options.replayStepsPerFrame = atoi(argument + 15);
+			if (g_Options.replayStepsPerFrame < 1)
+			{
+				std::cerr << "ERROR: Expected --replay-steps=N with at least one step" << std::endl;
+				return(false);
+			}
+		}
+		// draw into a hidden window
+		else if (strcmp(argument, "--offscreen") == 0)
+		{
+			g_Options.bOffscreen = true;
+		}
+		// write the tracked memory to a JSON file at exit
+		else if (strncmp(argument, "--memory-report=", 16) == 0)
+		{
+			g_Options.memoryReportFilename = argument + 16;
+		}
+		// list the memory that is still tracked at shutdown
+		else if (strcmp(argument, "--leak-report") == 0)
+		{
+			g_Options.bLeakReport = true;
+		}
+		// write the render counters of every frame to a CSV file
+		else if (strncmp(argument, "--counters=", 11) == 0)
+		{
+			g_Options.countersFilename = argument + 11;
+		}
+		// fail the run when a frame allocates once it has warmed up
+		else if (strcmp(argument, "--assert-no-alloc") == 0)
+		{
+			g_Options.bAssertNoAlloc = true;
+		}
+		else if (strncmp(argument, "--assert-no-alloc=", 18) == 0)
+		{
+			g_Options.bAssertNoAlloc = true;
+			g_Options.allocationWarmupFrames = atoi(argument + 18);
+			if (g_Options.allocationWarmupFrames < 0)
+			{
+				std::cerr << "ERROR: Expected --assert-no-alloc=N with N warm-up frames" << std::endl;
+				return(false);
+			}
+		}
+		else
+		{
+			std::cerr << "ERROR: Unknown option " << argument << std::endl;
+			std::cerr << "Usage: " << argv[0]
+				<< " [--vsync=off|on|adaptive] [--fps-cap=N] [--tick-rate=N] [--stats=SECONDS]"
+				<< " [--dynamic-res=MIN,MAX] [--target-ms=N] [--upscale=bilinear|sharpen]"
+				<< " [--workers=N] [--render-thread] [--late-latch] [--multi-view=N] [--compact-vertices]"
+				<< " [--scene=FILE] [--world=FILE] [--convert-scene=TEXT,BINARY]"
+				<< " [--generate-scene=OBJECTS,BINARY] [--generate-seed=N]"
+				<< " [--bake-lightmap=FILE] [--lightmap=FILE] [--lightmap-density=N] [--lightmap-shadows]"
+				<< " [--renderer=opengl|software] [--software-image=FILE] [--frames=N]"
+				<< " [--batch=POSES] [--batch-output=PREFIX] [--farm=N] [--farm-scaling]"
+				<< " [--stream=FILE|PIPE|-] [--stream-format=rgb|yuv420] [--stream-fps=N] [--stream-scalar]"
+				<< " [--record-input=FILE] [--replay-input=FILE] [--replay-steps=N] [--offscreen]"
+				<< " [--memory-report=FILE] [--leak-report] [--counters=FILE] [--assert-no-alloc[=N]]"
+				<< std::endl;
+			return(false);
+		}
+	}
+
+	if (g_Options.generateFilename.empty() == false)
+	{
+		if (g_Options.worldFilename.empty() == false)
+		{
+			std::cerr << "ERROR: A generated scene is loaded on its own, not as a world" << std::endl;
+			return(false);
+		}
+		if (g_Options.sceneFilename.empty() == true)
+		{
+			g_Options.sceneFilename = g_Options.generateFilename;
+		}
+	}
+
+	if (g_Options.lightmapFilename.empty() == false)
+	{
+		if (g_Options.worldFilename.empty() == false)
+		{
+			std::cerr << "ERROR: A lightmap covers a single scene, not a streamed world" << std::endl;
+			return(false);
+		}
+		if ((g_Options.bSoftwareRenderer) || (g_Options.farmThreadCount > 0) || (g_Options.bFarmScaling))
+		{
+			std::cerr << "ERROR: Lightmaps are drawn with OpenGL, not the software renderer" << std::endl;
+			return(false);
+		}
+	}
+
+	// the farm threads draw with software rasterizers, which share
+	// the assets of the scene manager's rasterizer
+	if ((g_Options.farmThreadCount > 0) || (g_Options.bFarmScaling))
+	{
+		if (g_Options.batchPoseFilename.empty() == true)
+		{
+			std::cerr << "ERROR: --farm needs the poses of a --batch" << std::endl;
+			return(false);
+		}
+		g_Options.farmThreadCount = std::max(g_Options.farmThreadCount, 1);
+		g_Options.bSoftwareRenderer = true;
+	}
+
+	if (g_Options.bSoftwareRenderer)
+	{
+		if (g_Options.worldFilename.empty() == false)
+		{
+			std::cerr << "ERROR: The software renderer cannot draw a streamed world" << std::endl;
+			return(false);
+		}
+		// the rasterizer spreads its work from the main thread,
+		// the first worker of the job system
+		if (g_Options.bRenderThread)
+		{
+			std::cout << "INFO: The software renderer runs on the main thread, --render-thread is ignored" << std::endl;
+			g_Options.bRenderThread = false;
+		}
+		// the rasterizer draws the view the frame was recorded with
+		if (g_Options.bLateLatch)
+		{
+			std::cout << "INFO: The software renderer draws the recorded view, --late-latch is ignored" << std::endl;
+			g_Options.bLateLatch = false;
+		}
+		// the rasterizer draws a single view
+		if (g_Options.viewCount > 1)
+		{
+			std::cout << "INFO: The software renderer draws a single view, --multi-view is ignored" << std::endl;
+			g_Options.viewCount = 1;
+		}
+	}
+
+	if ((g_Options.recordInputFilename.empty() == false) &&
+		(g_Options.replayInputFilename.empty() == false))
+	{
+		std::cerr << "ERROR: Input cannot be recorded while it is replayed" << std::endl;
+		return(false);
+	}
+
+	// a batch draws offscreen at the size of its images, without
+	// the interactive loop
+	if (g_Options.batchPoseFilename.empty() == false)
+	{
+		if (g_Options.streamOutput.empty() == false)
+		{
+			std::cerr << "ERROR: A batch writes images, it cannot be streamed" << std::endl;
+			return(false);
+		}
+		if ((g_Options.recordInputFilename.empty() == false) ||
+			(g_Options.replayInputFilename.empty() == false))
+		{
+			std::cerr << "ERROR: A batch takes its cameras from poses, not from input" << std::endl;
+			return(false);
+		}
+		g_Options.bDynamicResolution = false;
+		g_Options.bRenderThread = false;
+		g_Options.bLateLatch = false;
+		g_Options.viewCount = 1;
+	}
+
+	return(true);
 }
 
 /***********************************************************
@@ -142,17 +913,19 @@ bool InitializeGLFW()
 	// --------------------------------------
 	glfwInit();
 
-#ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
+	// set the version of OpenGL and profile to use; the draw
+	// data is read from shader storage buffers streamed through
+	// persistently mapped buffers, which needs OpenGL 4.4, so
+	// macOS and its OpenGL 4.1 are not supported
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
+	// a batch and an offscreen run only need the OpenGL context
+	// of the window
+	if ((g_Options.batchPoseFilename.empty() == false) || (g_Options.bOffscreen))
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	// GLFW: end -------------------------------
 
 	return(true);
@@ -178,9 +951,393 @@ bool InitializeGLEW()
 	}
 	// GLEW: end -------------------------------
 
+	// the shaders are GLSL 4.30 and read shader storage buffers,
+	// and the draw data is streamed through buffer storage
+	if ((!GLEW_VERSION_4_4) && ((!GLEW_VERSION_4_3) || (!GLEW_ARB_buffer_storage)))
+	{
+		std::cerr << "ERROR: OpenGL 4.4, or 4.3 with GL_ARB_buffer_storage, is required, the driver reports "
+			<< glGetString(GL_VERSION) << std::endl;
+		return false;
+	}
+
 	// Displays a successful OpenGL initialization message
 	std::cout << "INFO: OpenGL Successfully Initialized\n";
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
+/***********************************************************
+ *	BuildFrameSnapshot()
+ *
+ *  This function is used to fill a frame snapshot with the
+ *  camera, the recorded draw list and the lights of the
+ *  current frame.  It does not call OpenGL, so it can run
+ *  while another thread owns the context.
+ ***********************************************************/
+void BuildFrameSnapshot(FRAME_SNAPSHOT& snapshot, uint64_t frameIndex)
+{
+	// convert from 3D object space to 2D view
+	g_ViewManager->UpdateSceneView(g_FrameScheduler->GetInterpolationAlpha());
+
+	snapshot.frameIndex = frameIndex;
+	snapshot.view = g_ViewManager->GetViewMatrix();
+	snapshot.projection = g_ViewManager->GetProjectionMatrix();
+	snapshot.viewPosition = g_ViewManager->GetViewPosition();
+	snapshot.cameraLatch = g_ViewManager->GetCameraLatch();
+	snapshot.viewCount = g_ViewManager->GetViewCount();
+	for (int i = 0; (snapshot.viewCount > 1) && (i < snapshot.viewCount); i++)
+	{
+		snapshot.views[i] = g_ViewManager->GetFrameView(i);
+	}
+	glfwGetFramebufferSize(g_Window, &snapshot.framebufferWidth, &snapshot.framebufferHeight);
+	snapshot.bPrintStats = g_bRenderStatsPending;
+	g_bRenderStatsPending = false;
+	snapshot.bShowCounters = g_ViewManager->GetShowCounters();
+
+	// record the 3D scene into render commands
+	g_SceneManager->RecordScene(snapshot);
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to draw a frame snapshot.  It must
+ *  be called on the thread that owns the OpenGL context.
+ ***********************************************************/
+void RenderFrame(const FRAME_SNAPSHOT& snapshot)
+{
+	// redirect the scene into the scaled offscreen target
+	if (NULL != g_DynamicResolution)
+	{
+		g_DynamicResolution->Resize(snapshot.framebufferWidth, snapshot.framebufferHeight);
+		g_DynamicResolution->BeginScene();
+
+		// the upscale pass leaves its own shader bound
+		g_ShaderManager->use();
+	}
+
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// pass the camera of the snapshot into the shaders, turned by
+	// the newest mouse input when it is late latched
+	g_ViewManager->LatchSceneView(snapshot);
+
+	// refresh the 3D scene
+	g_SceneManager->RenderScene(snapshot);
+	g_ViewManager->EndSceneView();
+
+	// upscale the rendered scene into the display window
+	if (NULL != g_DynamicResolution)
+	{
+		g_DynamicResolution->EndScene();
+		if (snapshot.bPrintStats)
+		{
+			g_DynamicResolution->PrintStats();
+		}
+	}
+
+	// read the finished frame back for the stream, before the swap
+	if (NULL != g_FrameStreamer)
+	{
+		g_FrameStreamer->Capture(snapshot.framebufferWidth, snapshot.framebufferHeight);
+		if (snapshot.bPrintStats)
+		{
+			g_FrameStreamer->PrintStats();
+		}
+	}
+
+	// the counts of the frame are complete, and the overlay is
+	// drawn after the capture so it stays out of the stream
+	RenderCounters* pRenderCounters = g_SceneManager->GetRenderCounters();
+	pRenderCounters->EndFrame(snapshot.frameIndex);
+	if (snapshot.bPrintStats)
+	{
+		pRenderCounters->PrintStats();
+	}
+	if ((snapshot.bShowCounters) && (NULL != g_CounterOverlay))
+	{
+		g_CounterOverlay->Draw(*pRenderCounters, snapshot.framebufferWidth, snapshot.framebufferHeight);
+		g_ShaderManager->use();
+	}
+}
+
+/***********************************************************
+ *	ReportFrameStats()
+ *
+ *  This function is used to print the frame statistics when
+ *  a report is due.  Statistics owned by the render side are
+ *  printed with the next frame that is drawn.
+ ***********************************************************/
+void ReportFrameStats()
+{
+	if (g_FrameScheduler->IsReportDue())
+	{
+		g_FrameScheduler->PrintFrameStats();
+		g_ViewManager->PrintLatencyStats();
+		g_SceneManager->PrintRenderStats();
+		MemoryTracker::PrintStats();
+		AllocationCounter::PrintStats();
+		g_bRenderStatsPending = true;
+		// this frame and the next, which prints the render side's
+		// statistics, may allocate
+		AllocationCounter::SkipFrames(2);
+	}
+}
+
+/***********************************************************
+ *	RunSingleThreaded()
+ *
+ *  This function is used to run the main loop with the update
+ *  and the OpenGL submission on the main thread.  With late
+ *  latching the events are polled again after the frame is
+ *  recorded, so the view is latched from the newest input.
+ ***********************************************************/
+void RunSingleThreaded()
+{
+	FRAME_SNAPSHOT snapshot;
+	uint64_t frameIndex = 0;
+
+	// loop will keep running until the application is closed 
+	// or until an error has occurred
+	while (!glfwWindowShouldClose(g_Window))
+	{
+		g_FrameScheduler->BeginFrame();
+
+		// advance the camera in fixed steps, independent of the frame rate
+		while (g_FrameScheduler->StepUpdate())
+		{
+			g_ViewManager->UpdateCamera(g_FrameScheduler->GetFixedTimestep());
+		}
+
+		frameIndex++;
+		BuildFrameSnapshot(snapshot, frameIndex);
+
+		// take in the input that arrived while the frame was
+		// recorded, so the view is latched from it
+		if (g_Options.bLateLatch)
+		{
+			glfwPollEvents();
+		}
+		RenderFrame(snapshot);
+
+		// hold the frame if it is ahead of the frame rate cap
+		g_FrameScheduler->WaitForFrameDeadline();
+
+		// Flips the the back buffer with the front buffer every frame.
+		glfwSwapBuffers(g_Window);
+		g_ViewManager->PresentSceneView();
+
+		// query the latest GLFW events
+		glfwPollEvents();
+
+		g_FrameScheduler->EndFrame();
+		ReportFrameStats();
+		AllocationCounter::EndFrame(frameIndex);
+
+		if ((g_Options.frameLimit > 0) && (frameIndex >= g_Options.frameLimit))
+		{
+			glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+		}
+	}
+}
+
+/***********************************************************
+ *	RunRenderThreaded()
+ *
+ *  This function is used to run the main loop with the OpenGL
+ *  submission moved to a render thread.  The main thread keeps
+ *  the window events, the camera update and the recording of
+ *  the draw list, and publishes a snapshot every frame.  While
+ *  the render thread draws one snapshot the main thread builds
+ *  the next, and it waits for the render thread to take the
+ *  previous one before publishing again, so it runs at most one
+ *  frame ahead.  Window events are still handled while waiting.
+ ***********************************************************/
+void RunRenderThreaded()
+{
+	g_FrameSnapshots = new TripleBuffer<FRAME_SNAPSHOT>();
+	uint64_t frameIndex = 0;
+
+	// hand the OpenGL context over to the render thread
+	glfwMakeContextCurrent(NULL);
+	g_bRenderThreadRunning = true;
+	std::thread renderThread(RenderThreadMain);
+
+	// loop will keep running until the application is closed 
+	// or until an error has occurred
+	while (!glfwWindowShouldClose(g_Window))
+	{
+		g_FrameScheduler->BeginFrame();
+
+		// advance the camera in fixed steps, independent of the frame rate
+		while (g_FrameScheduler->StepUpdate())
+		{
+			g_ViewManager->UpdateCamera(g_FrameScheduler->GetFixedTimestep());
+		}
+
+		// do not run more than one frame ahead of the render thread
+		while ((g_AcquiredFrameIndex.load() < frameIndex) &&
+			(!glfwWindowShouldClose(g_Window)))
+		{
+			glfwWaitEventsTimeout(0.005);
+		}
+
+		frameIndex++;
+		BuildFrameSnapshot(g_FrameSnapshots->GetWriteBuffer(), frameIndex);
+		{
+			std::lock_guard<std::mutex> lock(g_RenderMutex);
+			g_FrameSnapshots->Publish();
+		}
+		g_RenderCondition.notify_one();
+
+		// hold the frame if it is ahead of the frame rate cap
+		g_FrameScheduler->WaitForFrameDeadline();
+
+		// query the latest GLFW events
+		glfwPollEvents();
+
+		g_FrameScheduler->EndFrame();
+		ReportFrameStats();
+		AllocationCounter::EndFrame(frameIndex);
+
+		if ((g_Options.frameLimit > 0) && (frameIndex >= g_Options.frameLimit))
+		{
+			glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+		}
+	}
+
+	// stop the render thread and take the OpenGL context back
+	{
+		std::lock_guard<std::mutex> lock(g_RenderMutex);
+		g_bRenderThreadRunning = false;
+	}
+	g_RenderCondition.notify_one();
+	renderThread.join();
+	glfwMakeContextCurrent(g_Window);
+
+	delete g_FrameSnapshots;
+	g_FrameSnapshots = nullptr;
+}
+
+/***********************************************************
+ *	RenderThreadMain()
+ *
+ *  This function is the main function of the render thread.
+ *  It owns the OpenGL context, and draws and swaps every
+ *  snapshot published by the main thread.  It sleeps while no
+ *  new snapshot is available.  A late latched view takes in
+ *  the mouse input the main thread has polled up to the draw.
+ ***********************************************************/
+void RenderThreadMain()
+{
+	glfwMakeContextCurrent(g_Window);
+
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(g_RenderMutex);
+			g_RenderCondition.wait(lock, []
+			{
+				return((g_FrameSnapshots->HasNewData()) || (!g_bRenderThreadRunning));
+			});
+			if (!g_bRenderThreadRunning)
+			{
+				break;
+			}
+		}
+
+		g_FrameSnapshots->Acquire();
+		const FRAME_SNAPSHOT& snapshot = g_FrameSnapshots->GetReadBuffer();
+
+		// let the main thread start on the next snapshot
+		g_AcquiredFrameIndex = snapshot.frameIndex;
+		glfwPostEmptyEvent();
+
+		RenderFrame(snapshot);
+
+		// Flips the the back buffer with the front buffer every frame.
+		glfwSwapBuffers(g_Window);
+		g_ViewManager->PresentSceneView();
+	}
+
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *	RunBatch()
+ *
+ *  This function is used to render the camera poses of the
+ *  pose file into image files, instead of running the main
+ *  loop.  Every pose is recorded and drawn like a frame of
+ *  the main loop, into the offscreen target of the batch
+ *  renderer, which reads the images back and writes them on
+ *  the job system while the next poses are drawn.
+ ***********************************************************/
+bool RunBatch()
+{
+	BatchRenderer batchRenderer(g_JobSystem);
+	if ((batchRenderer.LoadPoses(g_Options.batchPoseFilename.c_str()) == false) ||
+		(batchRenderer.Initialize(g_Options.batchOutputPrefix.c_str()) == false))
+	{
+		return(false);
+	}
+
+	FRAME_SNAPSHOT snapshot;
+	for (int i = 0; i < batchRenderer.GetPoseCount(); i++)
+	{
+		batchRenderer.SetCamera(i, snapshot);
+		snapshot.frameIndex = (uint64_t)i + 1;
+		snapshot.bPrintStats = false;
+		g_SceneManager->RecordScene(snapshot);
+
+		batchRenderer.BeginImage(i);
+		RenderFrame(snapshot);
+		batchRenderer.EndImage();
+	}
+	batchRenderer.Finish();
+
+	batchRenderer.PrintStats();
+	g_SceneManager->PrintRenderStats();
+
+	return(batchRenderer.GetStats().imagesWritten == batchRenderer.GetPoseCount());
+}
+
+/***********************************************************
+ *	RunFarm()
+ *
+ *  This function is used to render the camera poses of the
+ *  pose file on the farm threads, instead of running the main
+ *  loop.  The window's OpenGL context has only loaded the
+ *  scene, the farm threads draw on the CPU.  With scaling the
+ *  batch is rendered with 1, 2, 4... threads up to the farm
+ *  thread count, to print the scaling efficiency of each.
+ ***********************************************************/
+bool RunFarm()
+{
+	BatchRenderer batchRenderer(NULL);
+	if (batchRenderer.LoadPoses(g_Options.batchPoseFilename.c_str()) == false)
+	{
+		return(false);
+	}
+
+	RenderFarm renderFarm(g_SceneManager, &batchRenderer);
+	bool bRendered = true;
+	int threadCount = g_Options.bFarmScaling ? 1 : g_Options.farmThreadCount;
+	while (threadCount <= g_Options.farmThreadCount)
+	{
+		bRendered = renderFarm.Run(threadCount, g_Options.batchOutputPrefix.c_str()) && bRendered;
+		if (threadCount == g_Options.farmThreadCount)
+		{
+			break;
+		}
+		threadCount = std::min(threadCount * 2, g_Options.farmThreadCount);
+	}
+
+	renderFarm.PrintStats();
+	return(bRendered);
+}
@@ -0,0 +1,49 @@
+///////////////////////////////////////////////////////////////////////////////
+// mappedfile.h
+// ============
+// map a file read-only into memory, so its contents can be used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+
+/***********************************************************
+ *  MappedFile
+ *
+ *  This class maps a whole file into the address space with
+ *  read-only access.  Nothing is read when the file is opened;
+ *  the OS pages the contents in as they are touched, and the
+ *  pages are shared with the file cache instead of copied.
+ ***********************************************************/
+class MappedFile
+{
+public:
+	// constructor
+	MappedFile();
+	// destructor
+	~MappedFile();
+
+private:
+	const unsigned char* m_pData;
+	size_t m_size;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#else
+	int m_fileDescriptor;
+#endif
+
+	// a mapping is owned by one object
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+public:
+	// map the file, closing any file mapped before
+	bool Open(const char* filename);
+	// unmap the file
+	void Close();
+
+	const unsigned char* GetData() const;
+	size_t GetSize() const;
+};
@@ -0,0 +1,566 @@
+///////////////////////////////////////////////////////////////////////////////
+// memorytracker.cpp
+// ============
+// account for the GPU and CPU memory of the renderer by category, with the
+// current and peak use of each and a report of what is never freed
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MemoryTracker.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// declaration of global variables
+namespace
+{
+	// kinds of allocation, so the names of different OpenGL objects
+	// and the CPU owners do not collide
+	enum AllocationKind {
+		KIND_TEXTURE,
+		KIND_RENDERBUFFER,
+		KIND_BUFFER,
+		KIND_HEAP
+	};
+
+	const char* g_KindNames[] = { "texture", "renderbuffer", "buffer", "heap" };
+
+	const char* g_CategoryNames[MemoryTracker::MEMORY_CATEGORY_COUNT] =
+	{
+		"gpuTextures",
+		"gpuGeometry",
+		"gpuRenderTargets",
+		"gpuBuffers",
+		"cpuScene",
+		"cpuGeometry",
+		"cpuTextures",
+		"cpuWorld",
+		"cpuRendering"
+	};
+
+	// the categories before this one are on the GPU
+	const int g_FirstCpuCategory = MemoryTracker::MEMORY_CPU_SCENE;
+
+	const double g_BytesPerMB = 1024.0 * 1024.0;
+
+	struct TRACKED_ALLOCATION
+	{
+		MemoryTracker::MemoryCategory category;
+		std::string label;
+		uint64_t bytes;
+	};
+
+	typedef std::pair<int, uintptr_t> ALLOCATION_KEY;
+
+	std::mutex g_MemoryMutex;
+	std::map<ALLOCATION_KEY, TRACKED_ALLOCATION> g_Allocations;
+	MemoryTracker::CATEGORY_STATS g_Categories[MemoryTracker::MEMORY_CATEGORY_COUNT];
+	// totals of the GPU and the CPU categories, the peak of the sum
+	// is not the sum of the peaks
+	uint64_t g_CurrentBytes[2] = { 0, 0 };
+	uint64_t g_PeakBytes[2] = { 0, 0 };
+
+	/***********************************************************
+	 *  GetTexelBytes()
+	 *
+	 *  bytes of one texel of an internal format, as the driver
+	 *  stores it; three component formats are padded to four
+	 ***********************************************************/
+	uint32_t GetTexelBytes(uint32_t internalFormat)
+	{
+		switch (internalFormat)
+		{
+		case GL_R8:
+			return(1);
+		case GL_RG8:
+		case GL_R16F:
+			return(2);
+		case GL_RGB8:
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RGB10_A2:
+		case GL_R11F_G11F_B10F:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return(4);
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_DEPTH32F_STENCIL8:
+			return(8);
+		case GL_RGBA32F:
+			return(16);
+		default:
+			return(4);
+		}
+	}
+
+	/***********************************************************
+	 *  SetAllocation()
+	 *
+	 *  record an allocation, replacing the one of the same key,
+	 *  with the tracker's lock held
+	 ***********************************************************/
+	void SetAllocation(
+		int kind,
+		uintptr_t id,
+		MemoryTracker::MemoryCategory category,
+		const char* label,
+		uint64_t bytes)
+	{
+		TRACKED_ALLOCATION& allocation = g_Allocations[ALLOCATION_KEY(kind, id)];
+		if (allocation.label.empty() == false)
+		{
+			int previousSide = (allocation.category < g_FirstCpuCategory) ? 0 : 1;
+			g_Categories[allocation.category].currentBytes -= allocation.bytes;
+			g_Categories[allocation.category].allocationCount--;
+			g_CurrentBytes[previousSide] -= allocation.bytes;
+		}
+
+		allocation.category = category;
+		allocation.label = (NULL != label) ? label : "unnamed";
+		allocation.bytes = bytes;
+
+		int side = (category < g_FirstCpuCategory) ? 0 : 1;
+		MemoryTracker::CATEGORY_STATS& stats = g_Categories[category];
+		stats.currentBytes += bytes;
+		stats.peakBytes = std::max(stats.peakBytes, stats.currentBytes);
+		stats.allocationCount++;
+		g_CurrentBytes[side] += bytes;
+		g_PeakBytes[side] = std::max(g_PeakBytes[side], g_CurrentBytes[side]);
+	}
+
+	/***********************************************************
+	 *  EraseAllocation()
+	 *
+	 *  forget an allocation, with the tracker's lock held
+	 ***********************************************************/
+	void EraseAllocation(std::map<ALLOCATION_KEY, TRACKED_ALLOCATION>::iterator it)
+	{
+		const TRACKED_ALLOCATION& allocation = it->second;
+		int side = (allocation.category < g_FirstCpuCategory) ? 0 : 1;
+		g_Categories[allocation.category].currentBytes -= allocation.bytes;
+		g_Categories[allocation.category].allocationCount--;
+		g_CurrentBytes[side] -= allocation.bytes;
+		g_Allocations.erase(it);
+	}
+
+	/***********************************************************
+	 *  TrackAllocation()
+	 *
+	 *  record an allocation, replacing the one of the same key
+	 ***********************************************************/
+	void TrackAllocation(
+		int kind,
+		uintptr_t id,
+		MemoryTracker::MemoryCategory category,
+		const char* label,
+		uint64_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(g_MemoryMutex);
+		SetAllocation(kind, id, category, label, bytes);
+	}
+
+	/***********************************************************
+	 *  ReleaseAllocation()
+	 *
+	 *  forget an allocation, names that are not tracked are
+	 *  ignored
+	 ***********************************************************/
+	void ReleaseAllocation(int kind, uintptr_t id)
+	{
+		std::lock_guard<std::mutex> lock(g_MemoryMutex);
+
+		std::map<ALLOCATION_KEY, TRACKED_ALLOCATION>::iterator it =
+			g_Allocations.find(ALLOCATION_KEY(kind, id));
+		if (it != g_Allocations.end())
+		{
+			EraseAllocation(it);
+		}
+	}
+}
+
+/***********************************************************
+ *  TrackTexture()
+ *
+ *  This method is used for recording the storage of a
+ *  texture, or of a 2D texture array with its layers.
+ ***********************************************************/
+void MemoryTracker::TrackTexture(
+	uint32_t textureID,
+	MemoryCategory category,
+	const char* label,
+	uint32_t internalFormat,
+	int width,
+	int height,
+	int layers,
+	int levels)
+{
+	if (0 == textureID)
+	{
+		return;
+	}
+
+	TrackAllocation(
+		KIND_TEXTURE,
+		textureID,
+		category,
+		label,
+		GetTextureBytes(internalFormat, width, height, layers, levels));
+}
+
+/***********************************************************
+ *  TrackRenderbuffer()
+ *
+ *  This method is used for recording the storage of a
+ *  render buffer.
+ ***********************************************************/
+void MemoryTracker::TrackRenderbuffer(
+	uint32_t renderbufferID,
+	MemoryCategory category,
+	const char* label,
+	uint32_t internalFormat,
+	int width,
+	int height)
+{
+	if (0 == renderbufferID)
+	{
+		return;
+	}
+
+	TrackAllocation(
+		KIND_RENDERBUFFER,
+		renderbufferID,
+		category,
+		label,
+		GetTextureBytes(internalFormat, width, height, 1, 1));
+}
+
+/***********************************************************
+ *  TrackBuffer()
+ *
+ *  This method is used for recording the storage of a
+ *  buffer object.
+ ***********************************************************/
+void MemoryTracker::TrackBuffer(
+	uint32_t bufferID,
+	MemoryCategory category,
+	const char* label,
+	size_t bytes)
+{
+	if (0 == bufferID)
+	{
+		return;
+	}
+
+	TrackAllocation(KIND_BUFFER, bufferID, category, label, bytes);
+}
+
+/***********************************************************
+ *  TrackHeap()
+ *
+ *  This method is used for setting the CPU memory held by an
+ *  object.  An object that holds nothing is released.
+ ***********************************************************/
+void MemoryTracker::TrackHeap(
+	const void* pOwner,
+	MemoryCategory category,
+	const char* label,
+	size_t bytes)
+{
+	if (NULL == pOwner)
+	{
+		return;
+	}
+	if (bytes == 0)
+	{
+		ReleaseHeap(pOwner);
+		return;
+	}
+
+	TrackAllocation(KIND_HEAP, (uintptr_t)pOwner, category, label, bytes);
+}
+
+/***********************************************************
+ *  AdjustHeap()
+ *
+ *  This method is used for changing the CPU memory held by
+ *  an object by a number of bytes.  The change is made under
+ *  the tracker's lock, so threads that change the memory of
+ *  one object at once cannot leave a stale size behind.
+ ***********************************************************/
+void MemoryTracker::AdjustHeap(
+	const void* pOwner,
+	MemoryCategory category,
+	const char* label,
+	int64_t bytes)
+{
+	if ((NULL == pOwner) || (bytes == 0))
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+
+	ALLOCATION_KEY key(KIND_HEAP, (uintptr_t)pOwner);
+	std::map<ALLOCATION_KEY, TRACKED_ALLOCATION>::iterator it = g_Allocations.find(key);
+	int64_t heldBytes = (it != g_Allocations.end()) ? (int64_t)it->second.bytes : 0;
+	int64_t newBytes = std::max<int64_t>(heldBytes + bytes, 0);
+	if (newBytes > 0)
+	{
+		SetAllocation(KIND_HEAP, key.second, category, label, (uint64_t)newBytes);
+	}
+	else if (it != g_Allocations.end())
+	{
+		EraseAllocation(it);
+	}
+}
+
+/***********************************************************
+ *  ReleaseTexture()
+ *
+ *  This method is used for forgetting a deleted texture.
+ ***********************************************************/
+void MemoryTracker::ReleaseTexture(uint32_t textureID)
+{
+	ReleaseAllocation(KIND_TEXTURE, textureID);
+}
+
+/***********************************************************
+ *  ReleaseRenderbuffer()
+ *
+ *  This method is used for forgetting a deleted render buffer.
+ ***********************************************************/
+void MemoryTracker::ReleaseRenderbuffer(uint32_t renderbufferID)
+{
+	ReleaseAllocation(KIND_RENDERBUFFER, renderbufferID);
+}
+
+/***********************************************************
+ *  ReleaseBuffer()
+ *
+ *  This method is used for forgetting a deleted buffer.
+ ***********************************************************/
+void MemoryTracker::ReleaseBuffer(uint32_t bufferID)
+{
+	ReleaseAllocation(KIND_BUFFER, bufferID);
+}
+
+/***********************************************************
+ *  ReleaseHeap()
+ *
+ *  This method is used for forgetting the CPU memory of an
+ *  object that has freed it.
+ ***********************************************************/
+void MemoryTracker::ReleaseHeap(const void* pOwner)
+{
+	ReleaseAllocation(KIND_HEAP, (uintptr_t)pOwner);
+}
+
+/***********************************************************
+ *  GetTextureBytes()
+ *
+ *  This method is used for calculating the bytes of a
+ *  texture's storage.  Each mip level halves the width and
+ *  height, down to one texel, while the layers of an array
+ *  stay the same.
+ ***********************************************************/
+uint64_t MemoryTracker::GetTextureBytes(
+	uint32_t internalFormat,
+	int width,
+	int height,
+	int layers,
+	int levels)
+{
+	uint64_t texels = 0;
+	for (int level = 0; level < std::max(levels, 1); level++)
+	{
+		uint64_t levelWidth = (uint64_t)std::max(width >> level, 1);
+		uint64_t levelHeight = (uint64_t)std::max(height >> level, 1);
+		texels += levelWidth * levelHeight;
+	}
+
+	return(texels * (uint64_t)std::max(layers, 1) * GetTexelBytes(internalFormat));
+}
+
+/***********************************************************
+ *  GetCategoryStats()
+ *
+ *  This method is used for getting the current and peak
+ *  memory of a category.
+ ***********************************************************/
+MemoryTracker::CATEGORY_STATS MemoryTracker::GetCategoryStats(MemoryCategory category)
+{
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+	return(g_Categories[category]);
+}
+
+/***********************************************************
+ *  GetCategoryName()
+ *
+ *  This method is used for getting the name a category is
+ *  reported with.
+ ***********************************************************/
+const char* MemoryTracker::GetCategoryName(MemoryCategory category)
+{
+	if ((category < 0) || (category >= MEMORY_CATEGORY_COUNT))
+	{
+		return("unknown");
+	}
+
+	return(g_CategoryNames[category]);
+}
+
+/***********************************************************
+ *  GetCurrentBytes()
+ *
+ *  This method is used for getting the memory of all the GPU
+ *  or all the CPU categories.
+ ***********************************************************/
+uint64_t MemoryTracker::GetCurrentBytes(bool bGpu)
+{
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+	return(g_CurrentBytes[bGpu ? 0 : 1]);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ *
+ *  This method is used for getting the most memory all the
+ *  GPU or all the CPU categories held at once.
+ ***********************************************************/
+uint64_t MemoryTracker::GetPeakBytes(bool bGpu)
+{
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+	return(g_PeakBytes[bGpu ? 0 : 1]);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the current memory of
+ *  every category, and the current and peak totals.
+ ***********************************************************/
+void MemoryTracker::PrintStats()
+{
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+
+	std::cout << std::fixed << std::setprecision(2);
+	for (int side = 0; side < 2; side++)
+	{
+		std::cout << "MEMORY: " << ((side == 0) ? "GPU " : "CPU ")
+			<< (g_CurrentBytes[side] / g_BytesPerMB) << " MB"
+			<< " (peak " << (g_PeakBytes[side] / g_BytesPerMB) << ")";
+
+		int first = (side == 0) ? 0 : g_FirstCpuCategory;
+		int last = (side == 0) ? g_FirstCpuCategory : MEMORY_CATEGORY_COUNT;
+		for (int i = first; i < last; i++)
+		{
+			std::cout << ", " << g_CategoryNames[i] << " " << (g_Categories[i].currentBytes / g_BytesPerMB);
+		}
+		std::cout << std::endl;
+	}
+	std::cout << std::defaultfloat;
+}
+
+/***********************************************************
+ *  WriteJson()
+ *
+ *  This method is used for writing the totals, the memory of
+ *  every category and every tracked allocation into a JSON
+ *  file.  Sizes are in bytes.
+ ***********************************************************/
+bool MemoryTracker::WriteJson(const char* filename)
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not write the memory report " << filename << std::endl;
+		return(false);
+	}
+
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+
+	file << "{" << std::endl;
+	file << "\t\"gpu\": { \"currentBytes\": " << g_CurrentBytes[0]
+		<< ", \"peakBytes\": " << g_PeakBytes[0] << " }," << std::endl;
+	file << "\t\"cpu\": { \"currentBytes\": " << g_CurrentBytes[1]
+		<< ", \"peakBytes\": " << g_PeakBytes[1] << " }," << std::endl;
+
+	file << "\t\"categories\": [" << std::endl;
+	for (int i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+	{
+		file << "\t\t{ \"name\": \"" << g_CategoryNames[i]
+			<< "\", \"currentBytes\": " << g_Categories[i].currentBytes
+			<< ", \"peakBytes\": " << g_Categories[i].peakBytes
+			<< ", \"allocations\": " << g_Categories[i].allocationCount << " }"
+			<< ((i + 1 < MEMORY_CATEGORY_COUNT) ? "," : "") << std::endl;
+	}
+	file << "\t]," << std::endl;
+
+	// labels are fixed strings of the code, they need no escaping
+	file << "\t\"allocations\": [" << std::endl;
+	size_t index = 0;
+	std::map<ALLOCATION_KEY, TRACKED_ALLOCATION>::const_iterator it;
+	for (it = g_Allocations.begin(); it != g_Allocations.end(); ++it, index++)
+	{
+		file << "\t\t{ \"category\": \"" << g_CategoryNames[it->second.category]
+			<< "\", \"kind\": \"" << g_KindNames[it->first.first] << "\"";
+		if (it->first.first != KIND_HEAP)
+		{
+			file << ", \"id\": " << it->first.second;
+		}
+		file << ", \"label\": \"" << it->second.label
+			<< "\", \"bytes\": " << it->second.bytes << " }"
+			<< ((index + 1 < g_Allocations.size()) ? "," : "") << std::endl;
+	}
+	file << "\t]" << std::endl << "}" << std::endl;
+
+	std::cout << "INFO: Wrote the memory report " << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ReportLeaks()
+ *
+ *  This method is used for listing the allocations that are
+ *  still tracked, at shutdown once everything that owns
+ *  memory has been destroyed.
+ ***********************************************************/
+int MemoryTracker::ReportLeaks()
+{
+	std::lock_guard<std::mutex> lock(g_MemoryMutex);
+
+	if (g_Allocations.empty() == true)
+	{
+		std::cout << "INFO: No tracked memory was left at shutdown" << std::endl;
+		return(0);
+	}
+
+	uint64_t leakedBytes = 0;
+	std::map<ALLOCATION_KEY, TRACKED_ALLOCATION>::const_iterator it;
+	for (it = g_Allocations.begin(); it != g_Allocations.end(); ++it)
+	{
+		std::cout << "ERROR: Leaked " << it->second.bytes << " bytes of " << g_CategoryNames[it->second.category]
+			<< ", " << g_KindNames[it->first.first];
+		if (it->first.first != KIND_HEAP)
+		{
+			std::cout << " " << it->first.second;
+		}
+		std::cout << " \"" << it->second.label << "\"" << std::endl;
+		leakedBytes += it->second.bytes;
+	}
+	std::cout << "ERROR: " << g_Allocations.size() << " allocations, "
+		<< leakedBytes << " bytes, were not freed at shutdown" << std::endl;
+
+	return((int)g_Allocations.size());
+}
@@ -0,0 +1,116 @@
+///////////////////////////////////////////////////////////////////////////////
+// memorytracker.h
+// ============
+// account for the GPU and CPU memory of the renderer by category, with the
+// current and peak use of each and a report of what is never freed
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  MemoryTracker
+ *
+ *  This class keeps a record of every tracked allocation, so
+ *  the memory of each category can be queried while the
+ *  application runs.  GPU textures and render buffers are
+ *  sized from their format, dimensions and mip chain when
+ *  they are allocated, and buffers from their size; they are
+ *  keyed by their OpenGL name and released when they are
+ *  deleted.  CPU memory is reported by the subsystems that
+ *  own it, keyed by the owning object, each time its size
+ *  changes.
+ *
+ *  Whatever is still tracked at shutdown was never freed, and
+ *  is listed by the leak report.  All methods can be called
+ *  from any thread.
+ ***********************************************************/
+class MemoryTracker
+{
+public:
+	enum MemoryCategory {
+		MEMORY_GPU_TEXTURES,
+		MEMORY_GPU_GEOMETRY,
+		MEMORY_GPU_RENDER_TARGETS,
+		MEMORY_GPU_BUFFERS,
+		MEMORY_CPU_SCENE,
+		MEMORY_CPU_GEOMETRY,
+		MEMORY_CPU_TEXTURES,
+		MEMORY_CPU_WORLD,
+		MEMORY_CPU_RENDERING,
+		MEMORY_CATEGORY_COUNT
+	};// where the memory of an allocation is and what it holds
+
+	struct CATEGORY_STATS
+	{
+		uint64_t currentBytes;
+		uint64_t peakBytes;
+		// allocations tracked right now
+		uint32_t allocationCount;
+	};
+
+	// record a texture with its storage, or its new storage when it
+	// is already tracked, sized from its format and mip levels
+	static void TrackTexture(
+		uint32_t textureID,
+		MemoryCategory category,
+		const char* label,
+		uint32_t internalFormat,
+		int width,
+		int height,
+		int layers,
+		int levels);
+	static void TrackRenderbuffer(
+		uint32_t renderbufferID,
+		MemoryCategory category,
+		const char* label,
+		uint32_t internalFormat,
+		int width,
+		int height);
+	static void TrackBuffer(
+		uint32_t bufferID,
+		MemoryCategory category,
+		const char* label,
+		size_t bytes);
+	// set the CPU memory an object holds, replacing what it held before
+	static void TrackHeap(
+		const void* pOwner,
+		MemoryCategory category,
+		const char* label,
+		size_t bytes);
+	// add to, or with a negative size take from, the CPU memory an
+	// object holds, for memory that several threads change
+	static void AdjustHeap(
+		const void* pOwner,
+		MemoryCategory category,
+		const char* label,
+		int64_t bytes);
+
+	// forget an allocation once it is freed
+	static void ReleaseTexture(uint32_t textureID);
+	static void ReleaseRenderbuffer(uint32_t renderbufferID);
+	static void ReleaseBuffer(uint32_t bufferID);
+	static void ReleaseHeap(const void* pOwner);
+
+	// bytes of a texture's storage, every level of every layer
+	static uint64_t GetTextureBytes(
+		uint32_t internalFormat,
+		int width,
+		int height,
+		int layers,
+		int levels);
+
+	static CATEGORY_STATS GetCategoryStats(MemoryCategory category);
+	static const char* GetCategoryName(MemoryCategory category);
+	// memory of all GPU or all CPU categories
+	static uint64_t GetCurrentBytes(bool bGpu);
+	static uint64_t GetPeakBytes(bool bGpu);
+
+	static void PrintStats();
+	// write the categories and the tracked allocations as JSON
+	static bool WriteJson(const char* filename);
+	// list the allocations still tracked, returns their count
+	static int ReportLeaks();
+};
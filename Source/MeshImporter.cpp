@@ -0,0 +1,1500 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.cpp
+// ============
+// import triangle meshes from OBJ and glTF files into the vertex layout of
+// the basic shapes, parsing large files in parallel on the job system
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshImporter.h"
+#include "JsonReader.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// smallest part of an OBJ file worth a job of its own
+	const size_t g_MinChunkBytes = 1 << 20;
+	// chunks per worker, so that chunks of uneven cost still balance
+	const int g_ChunksPerWorker = 4;
+	// deepest node hierarchy followed in a glTF scene
+	const int g_MaxNodeDepth = 64;
+
+	// GLB container, all values little-endian
+	const uint32_t g_GlbMagic = 0x46546C67;
+	const uint32_t g_GlbVersion = 2;
+	const uint32_t g_GlbJsonChunk = 0x4E4F534A;
+	const uint32_t g_GlbBinChunk = 0x004E4942;
+
+	// glTF accessor component types and the triangle list mode
+	const int g_GltfByte = 5120;
+	const int g_GltfUnsignedByte = 5121;
+	const int g_GltfShort = 5122;
+	const int g_GltfUnsignedShort = 5123;
+	const int g_GltfUnsignedInt = 5125;
+	const int g_GltfFloat = 5126;
+	const int g_GltfTriangles = 4;
+
+	// powers of ten a double holds exactly
+	const double g_PowersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	// one corner of an OBJ face as position, texture coordinate
+	// and normal index, -1 for none
+	struct OBJ_CORNER
+	{
+		int32_t index[3];
+		// bit set for every index counted back from the end of the
+		// chunk's own list, resolved once the chunk's base is known
+		uint32_t relativeMask;
+	};
+
+	// part of an OBJ file and everything parsed from it
+	struct OBJ_CHUNK
+	{
+		const char* pBegin;
+		const char* pEnd;
+		std::vector<float> positions;
+		std::vector<float> textureCoordinates;
+		std::vector<float> normals;
+		// three corners per triangle
+		std::vector<OBJ_CORNER> corners;
+		// number of positions, texture coordinates and normals
+		// in the chunks before this one
+		size_t base[3];
+		// start of the line that could not be parsed
+		const char* pError;
+		bool bBadIndex;
+	};
+
+	// a glTF buffer, either mapped on its own or inside the GLB
+	struct GLTF_BUFFER
+	{
+		const unsigned char* pData;
+		size_t size;
+	};
+
+	// checked view of the elements of a glTF accessor
+	struct GLTF_ACCESSOR
+	{
+		const unsigned char* pData;
+		size_t count;
+		size_t stride;
+		int componentType;
+		int componentCount;
+		bool bNormalized;
+	};
+
+	// one triangle primitive of a glTF mesh placed by a node
+	struct GLTF_PRIMITIVE
+	{
+		glm::mat4 transform;
+		GLTF_ACCESSOR positions;
+		GLTF_ACCESSOR normals;
+		GLTF_ACCESSOR textureCoordinates;
+		GLTF_ACCESSOR indices;
+		bool bNormals;
+		bool bTextureCoordinates;
+		bool bIndices;
+		size_t firstVertex;
+		size_t firstIndex;
+		size_t indexCount;
+		bool bBadIndex;
+	};
+
+	// parsed glTF document and the buffers it refers to
+	struct GLTF_DOCUMENT
+	{
+		JsonReader json;
+		std::vector<GLTF_BUFFER> buffers;
+		std::vector<MappedFile*> bufferFiles;
+		size_t fileBytes;
+
+		GLTF_DOCUMENT()
+		{
+			fileBytes = 0;
+		}
+
+		~GLTF_DOCUMENT()
+		{
+			for (size_t i = 0; i < bufferFiles.size(); i++)
+			{
+				delete bufferFiles[i];
+			}
+		}
+	};
+
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// run a job over [0, count), on the job system when there is one
+	template <typename FUNCTION>
+	void RunJobs(JobSystem* pJobSystem, int count, const FUNCTION& function)
+	{
+		if (NULL != pJobSystem)
+		{
+			pJobSystem->ParallelFor(count, 1, function);
+		}
+		else
+		{
+			function(0, count);
+		}
+	}
+
+	// mix the bits of a key so that nearby values spread out
+	uint32_t HashWords(const uint32_t* pWords, int count)
+	{
+		uint32_t hash = 2166136261u;
+		for (int i = 0; i < count; i++)
+		{
+			hash = (hash ^ pWords[i]) * 16777619u;
+			hash ^= hash >> 15;
+		}
+		hash *= 0x85EBCA6Bu;
+		hash ^= hash >> 13;
+		return(hash);
+	}
+
+	// open addressing table size, a power of two at least twice the keys
+	size_t HashTableSize(size_t keyCount)
+	{
+		size_t size = 16;
+		while (size < keyCount * 2)
+		{
+			size *= 2;
+		}
+		return(size);
+	}
+
+	bool IsLineEnd(char c)
+	{
+		return((c == '\n') || (c == '\r') || (c == '#'));
+	}
+
+	bool IsSpace(char c)
+	{
+		return((c == ' ') || (c == '\t'));
+	}
+
+	void SkipSpaces(const char*& pText, const char* pEnd)
+	{
+		while ((pText < pEnd) && IsSpace(*pText))
+		{
+			pText++;
+		}
+	}
+
+	// true when the eight bytes of a little-endian word are all digits
+	bool IsEightDigits(uint64_t word)
+	{
+		return(((word & 0xF0F0F0F0F0F0F0F0ull) |
+			(((word + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull);
+	}
+
+	// value of eight digits in a little-endian word, combined in
+	// pairs, then fours, then all eight with three multiplies
+	uint32_t ParseEightDigits(uint64_t word)
+	{
+		word -= 0x3030303030303030ull;
+		word = (word * 10) + (word >> 8);
+		word = (((word & 0x000000FF000000FFull) * 0x000F424000000064ull) +
+			(((word >> 16) & 0x000000FF000000FFull) * 0x0000271000000001ull)) >> 32;
+		return((uint32_t)word);
+	}
+
+	// read a word of eight bytes, the caller checks they are there
+	uint64_t ReadWord(const char* pText)
+	{
+		uint64_t word = 0;
+		memcpy(&word, pText, sizeof(word));
+		return(word);
+	}
+
+	// add a run of digits to the mantissa, eight at a time while
+	// they fit.  Digits past the nineteenth significant one do not
+	// fit and are counted as dropped.  Returns the digits read.
+	int ParseDigits(const char*& pText, const char* pEnd, uint64_t& mantissa, int& digitCount, int& droppedCount)
+	{
+		const char* pStart = pText;
+		while ((pEnd - pText >= 8) && (digitCount + 8 <= 19) && IsEightDigits(ReadWord(pText)))
+		{
+			mantissa = (mantissa * 100000000ull) + ParseEightDigits(ReadWord(pText));
+			digitCount += 8;
+			pText += 8;
+		}
+		while ((pText < pEnd) && (*pText >= '0') && (*pText <= '9'))
+		{
+			if (digitCount < 19)
+			{
+				mantissa = (mantissa * 10) + (uint64_t)(*pText - '0');
+				// leading zeros do not use up precision
+				if ((digitCount > 0) || (*pText != '0'))
+				{
+					digitCount++;
+				}
+			}
+			else
+			{
+				droppedCount++;
+			}
+			pText++;
+		}
+		return((int)(pText - pStart));
+	}
+
+	// parse an OBJ index, which is never zero
+	bool ParseIndex(const char*& pText, const char* pEnd, int64_t& value)
+	{
+		bool bNegative = false;
+		if ((pText < pEnd) && (*pText == '-'))
+		{
+			bNegative = true;
+			pText++;
+		}
+
+		int digitCount = 0;
+		value = 0;
+		while ((pText < pEnd) && (*pText >= '0') && (*pText <= '9'))
+		{
+			if (digitCount < 12)
+			{
+				value = (value * 10) + (*pText - '0');
+			}
+			digitCount++;
+			pText++;
+		}
+		if ((digitCount == 0) || (value == 0) || (value > INT32_MAX))
+		{
+			return(false);
+		}
+
+		if (bNegative)
+		{
+			value = -value;
+		}
+		return(true);
+	}
+
+	// parse the numbers after an OBJ keyword, values after the
+	// required ones may be left out and read as zero
+	bool ParseFloats(const char*& pText, const char* pEnd, int count, int requiredCount, std::vector<float>& values)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			SkipSpaces(pText, pEnd);
+			if ((i >= requiredCount) && ((pText >= pEnd) || IsLineEnd(*pText)))
+			{
+				values.push_back(0.0f);
+				continue;
+			}
+
+			float value = 0.0f;
+			if (MeshImporter::ParseFloat(pText, pEnd, value) == false)
+			{
+				return(false);
+			}
+			if ((pText < pEnd) && (IsSpace(*pText) == false) && (IsLineEnd(*pText) == false))
+			{
+				return(false);
+			}
+			values.push_back(value);
+		}
+		return(true);
+	}
+
+	// parse the corners of an OBJ face into a fan of triangles
+	bool ParseFace(const char*& pText, const char* pEnd, OBJ_CHUNK& chunk)
+	{
+		int64_t counts[3] =
+		{
+			(int64_t)(chunk.positions.size() / 3),
+			(int64_t)(chunk.textureCoordinates.size() / 2),
+			(int64_t)(chunk.normals.size() / 3)
+		};
+
+		OBJ_CORNER first;
+		OBJ_CORNER previous;
+		int cornerCount = 0;
+		while (true)
+		{
+			SkipSpaces(pText, pEnd);
+			if ((pText >= pEnd) || IsLineEnd(*pText))
+			{
+				break;
+			}
+
+			// v, v/vt, v//vn or v/vt/vn
+			OBJ_CORNER corner;
+			corner.index[0] = -1;
+			corner.index[1] = -1;
+			corner.index[2] = -1;
+			corner.relativeMask = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				if (k > 0)
+				{
+					if ((pText >= pEnd) || (*pText != '/'))
+					{
+						break;
+					}
+					pText++;
+					if ((pText < pEnd) && (*pText == '/'))
+					{
+						continue;
+					}
+				}
+
+				int64_t value = 0;
+				if (ParseIndex(pText, pEnd, value) == false)
+				{
+					return(false);
+				}
+				if (value > 0)
+				{
+					corner.index[k] = (int32_t)(value - 1);
+				}
+				else
+				{
+					// may be negative, pointing into an earlier chunk
+					corner.index[k] = (int32_t)(counts[k] + value);
+					corner.relativeMask |= 1u << k;
+				}
+			}
+			if ((pText < pEnd) && (IsSpace(*pText) == false) && (IsLineEnd(*pText) == false))
+			{
+				return(false);
+			}
+
+			if (cornerCount >= 2)
+			{
+				chunk.corners.push_back(first);
+				chunk.corners.push_back(previous);
+				chunk.corners.push_back(corner);
+			}
+			if (cornerCount == 0)
+			{
+				first = corner;
+			}
+			previous = corner;
+			cornerCount++;
+		}
+
+		return(cornerCount >= 3);
+	}
+
+	// parse the lines of one OBJ chunk, ignoring the records that
+	// do not add to the geometry
+	void ParseOBJChunk(OBJ_CHUNK& chunk)
+	{
+		const char* pText = chunk.pBegin;
+		const char* pEnd = chunk.pEnd;
+		while ((pText < pEnd) && (NULL == chunk.pError))
+		{
+			SkipSpaces(pText, pEnd);
+			const char* pLine = pText;
+			bool bParsed = true;
+
+			if ((pEnd - pText >= 2) && (pText[0] == 'v') && IsSpace(pText[1]))
+			{
+				pText += 2;
+				bParsed = ParseFloats(pText, pEnd, 3, 3, chunk.positions);
+			}
+			else if ((pEnd - pText >= 3) && (pText[0] == 'v') && (pText[1] == 't') && IsSpace(pText[2]))
+			{
+				pText += 3;
+				bParsed = ParseFloats(pText, pEnd, 2, 1, chunk.textureCoordinates);
+			}
+			else if ((pEnd - pText >= 3) && (pText[0] == 'v') && (pText[1] == 'n') && IsSpace(pText[2]))
+			{
+				pText += 3;
+				bParsed = ParseFloats(pText, pEnd, 3, 3, chunk.normals);
+			}
+			else if ((pEnd - pText >= 2) && (pText[0] == 'f') && IsSpace(pText[1]))
+			{
+				pText += 2;
+				bParsed = ParseFace(pText, pEnd, chunk);
+			}
+
+			if (bParsed == false)
+			{
+				chunk.pError = pLine;
+				break;
+			}
+
+			const char* pNewline = (const char*)memchr(pText, '\n', (size_t)(pEnd - pText));
+			pText = (NULL != pNewline) ? pNewline + 1 : pEnd;
+		}
+	}
+
+	// turn the indexes of a chunk's corners into indexes of the
+	// whole file, checking they point at something
+	void ResolveOBJChunk(OBJ_CHUNK& chunk, const size_t* totals)
+	{
+		for (size_t i = 0; i < chunk.corners.size(); i++)
+		{
+			OBJ_CORNER& corner = chunk.corners[i];
+			for (int k = 0; k < 3; k++)
+			{
+				int64_t index = corner.index[k];
+				if ((corner.relativeMask & (1u << k)) != 0)
+				{
+					index += (int64_t)chunk.base[k];
+				}
+				else if (index < 0)
+				{
+					continue;
+				}
+
+				if ((index < 0) || (index >= (int64_t)totals[k]))
+				{
+					chunk.bBadIndex = true;
+					return;
+				}
+				corner.index[k] = (int32_t)index;
+			}
+			if (corner.index[0] < 0)
+			{
+				chunk.bBadIndex = true;
+				return;
+			}
+			corner.relativeMask = 0;
+		}
+	}
+
+	// give the vertices with a zero normal the area weighted normal
+	// of the triangles around them
+	void GenerateNormals(SHAPE_VERTEX* pVertices, size_t vertexCount, const uint32_t* pIndices, size_t indexCount)
+	{
+		std::vector<char> missing(vertexCount, 0);
+		bool bMissing = false;
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			if ((pVertices[i].normal.x == 0.0f) && (pVertices[i].normal.y == 0.0f) && (pVertices[i].normal.z == 0.0f))
+			{
+				missing[i] = 1;
+				bMissing = true;
+			}
+		}
+		if (bMissing == false)
+		{
+			return;
+		}
+
+		for (size_t i = 0; i + 2 < indexCount; i += 3)
+		{
+			const glm::vec3& p0 = pVertices[pIndices[i]].position;
+			const glm::vec3& p1 = pVertices[pIndices[i + 1]].position;
+			const glm::vec3& p2 = pVertices[pIndices[i + 2]].position;
+			// the cross product is twice the area, which weights it
+			glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (missing[pIndices[i + corner]] != 0)
+				{
+					pVertices[pIndices[i + corner]].normal += faceNormal;
+				}
+			}
+		}
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			if (missing[i] != 0)
+			{
+				float length = glm::length(pVertices[i].normal);
+				pVertices[i].normal = (length > 0.0f) ? pVertices[i].normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+			}
+		}
+	}
+
+	// merge the vertices whose every value is the same
+	void WeldVertices(SHAPE_GEOMETRY& geometry)
+	{
+		std::vector<SHAPE_VERTEX> vertices;
+		vertices.reserve(geometry.vertices.size());
+		std::vector<uint32_t> remap(geometry.vertices.size());
+		std::vector<int32_t> table(HashTableSize(geometry.vertices.size()), -1);
+		size_t mask = table.size() - 1;
+
+		for (size_t i = 0; i < geometry.vertices.size(); i++)
+		{
+			const SHAPE_VERTEX& vertex = geometry.vertices[i];
+			uint32_t words[sizeof(SHAPE_VERTEX) / sizeof(uint32_t)];
+			memcpy(words, &vertex, sizeof(words));
+
+			size_t slot = HashWords(words, (int)(sizeof(words) / sizeof(words[0]))) & mask;
+			while ((table[slot] >= 0) && (memcmp(&vertices[table[slot]], &vertex, sizeof(vertex)) != 0))
+			{
+				slot = (slot + 1) & mask;
+			}
+			if (table[slot] < 0)
+			{
+				table[slot] = (int32_t)vertices.size();
+				vertices.push_back(vertex);
+			}
+			remap[i] = (uint32_t)table[slot];
+		}
+
+		for (size_t i = 0; i < geometry.indices.size(); i++)
+		{
+			geometry.indices[i] = remap[geometry.indices[i]];
+		}
+		geometry.vertices.swap(vertices);
+	}
+
+	// size in bytes of a glTF component type
+	size_t ComponentSize(int componentType)
+	{
+		switch (componentType)
+		{
+		case g_GltfByte:
+		case g_GltfUnsignedByte:
+			return(1);
+		case g_GltfShort:
+		case g_GltfUnsignedShort:
+			return(2);
+		case g_GltfUnsignedInt:
+		case g_GltfFloat:
+			return(4);
+		default:
+			return(0);
+		}
+	}
+
+	// number of components of a glTF accessor type
+	int ComponentCount(const JsonReader& json, int type)
+	{
+		if (json.StringEquals(type, "SCALAR"))
+		{
+			return(1);
+		}
+		if (json.StringEquals(type, "VEC2"))
+		{
+			return(2);
+		}
+		if (json.StringEquals(type, "VEC3"))
+		{
+			return(3);
+		}
+		if (json.StringEquals(type, "VEC4"))
+		{
+			return(4);
+		}
+		return(0);
+	}
+
+	// read a byte offset or count, which must be a whole number
+	// small enough to be exact in a double
+	bool GetSize(const JsonReader& json, int value, size_t defaultValue, size_t& size)
+	{
+		if (value < 0)
+		{
+			size = defaultValue;
+			return(true);
+		}
+
+		double number = json.GetNumber(value, -1.0);
+		if ((number < 0.0) || (number > 9007199254740992.0) || (floor(number) != number))
+		{
+			return(false);
+		}
+		size = (size_t)number;
+		return(true);
+	}
+
+	// look up an accessor and check that all of its elements lie
+	// inside its buffer view, and the view inside its buffer
+	bool ReadAccessor(const GLTF_DOCUMENT& document, int accessorIndex, GLTF_ACCESSOR& accessor)
+	{
+		const JsonReader& json = document.json;
+		int root = json.GetRoot();
+		int value = json.GetElement(json.FindMember(root, "accessors"), accessorIndex);
+		if ((value < 0) || (json.FindMember(value, "sparse") >= 0))
+		{
+			return(false);
+		}
+
+		int view = json.GetElement(json.FindMember(root, "bufferViews"), json.GetInt(json.FindMember(value, "bufferView"), -1));
+		int bufferIndex = json.GetInt(json.FindMember(view, "buffer"), -1);
+		if ((view < 0) || (bufferIndex < 0) || (bufferIndex >= (int)document.buffers.size()))
+		{
+			return(false);
+		}
+
+		accessor.componentType = json.GetInt(json.FindMember(value, "componentType"), 0);
+		accessor.componentCount = ComponentCount(json, json.FindMember(value, "type"));
+		accessor.bNormalized = (json.GetType(json.FindMember(value, "normalized")) == JsonReader::JSON_TRUE);
+		size_t elementSize = ComponentSize(accessor.componentType) * (size_t)accessor.componentCount;
+
+		size_t accessorOffset = 0;
+		size_t viewOffset = 0;
+		size_t viewLength = 0;
+		if ((elementSize == 0) ||
+			(GetSize(json, json.FindMember(value, "count"), 0, accessor.count) == false) ||
+			(GetSize(json, json.FindMember(value, "byteOffset"), 0, accessorOffset) == false) ||
+			(GetSize(json, json.FindMember(view, "byteOffset"), 0, viewOffset) == false) ||
+			(GetSize(json, json.FindMember(view, "byteLength"), 0, viewLength) == false) ||
+			(GetSize(json, json.FindMember(view, "byteStride"), elementSize, accessor.stride) == false))
+		{
+			return(false);
+		}
+
+		const GLTF_BUFFER& buffer = document.buffers[bufferIndex];
+		if ((accessor.stride < elementSize) ||
+			(viewOffset > buffer.size) || (viewLength > buffer.size - viewOffset) ||
+			(accessorOffset > viewLength))
+		{
+			return(false);
+		}
+		if (accessor.count > 0)
+		{
+			size_t available = viewLength - accessorOffset;
+			if ((elementSize > available) || (accessor.count - 1 > (available - elementSize) / accessor.stride))
+			{
+				return(false);
+			}
+		}
+
+		accessor.pData = buffer.pData + viewOffset + accessorOffset;
+		return(true);
+	}
+
+	// read one component of an element as a float
+	float ReadComponent(const GLTF_ACCESSOR& accessor, size_t element, int component)
+	{
+		size_t componentSize = ComponentSize(accessor.componentType);
+		const unsigned char* pValue = accessor.pData + (element * accessor.stride) + (component * componentSize);
+		switch (accessor.componentType)
+		{
+		case g_GltfFloat:
+		{
+			float value = 0.0f;
+			memcpy(&value, pValue, sizeof(value));
+			return(value);
+		}
+		case g_GltfUnsignedByte:
+			return(accessor.bNormalized ? *pValue / 255.0f : (float)*pValue);
+		case g_GltfUnsignedShort:
+		{
+			uint16_t value = 0;
+			memcpy(&value, pValue, sizeof(value));
+			return(accessor.bNormalized ? value / 65535.0f : (float)value);
+		}
+		case g_GltfByte:
+		{
+			float value = (float)(int8_t)*pValue;
+			return(accessor.bNormalized ? std::max(value / 127.0f, -1.0f) : value);
+		}
+		case g_GltfShort:
+		{
+			int16_t value = 0;
+			memcpy(&value, pValue, sizeof(value));
+			return(accessor.bNormalized ? std::max(value / 32767.0f, -1.0f) : (float)value);
+		}
+		default:
+			return(0.0f);
+		}
+	}
+
+	// read a three component float element, the common case
+	glm::vec3 ReadVec3(const GLTF_ACCESSOR& accessor, size_t element)
+	{
+		float values[3];
+		memcpy(values, accessor.pData + (element * accessor.stride), sizeof(values));
+		return(glm::vec3(values[0], values[1], values[2]));
+	}
+
+	// read one index of an index accessor
+	uint32_t ReadIndex(const GLTF_ACCESSOR& accessor, size_t element)
+	{
+		const unsigned char* pValue = accessor.pData + (element * accessor.stride);
+		if (accessor.componentType == g_GltfUnsignedByte)
+		{
+			return(*pValue);
+		}
+		if (accessor.componentType == g_GltfUnsignedShort)
+		{
+			uint16_t value = 0;
+			memcpy(&value, pValue, sizeof(value));
+			return(value);
+		}
+
+		uint32_t value = 0;
+		memcpy(&value, pValue, sizeof(value));
+		return(value);
+	}
+
+	// local transform of a glTF node, from its matrix or from its
+	// translation, rotation quaternion and scale
+	glm::mat4 GetNodeTransform(const JsonReader& json, int node)
+	{
+		glm::mat4 transform(1.0f);
+		int matrix = json.FindMember(node, "matrix");
+		if (json.GetCount(matrix) == 16)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				for (int row = 0; row < 4; row++)
+				{
+					transform[column][row] = (float)json.GetNumber(json.GetElement(matrix, (column * 4) + row), 0.0);
+				}
+			}
+			return(transform);
+		}
+
+		int translation = json.FindMember(node, "translation");
+		int rotation = json.FindMember(node, "rotation");
+		int scale = json.FindMember(node, "scale");
+		float t[3];
+		float s[3];
+		for (int i = 0; i < 3; i++)
+		{
+			t[i] = (float)json.GetNumber(json.GetElement(translation, i), 0.0);
+			s[i] = (float)json.GetNumber(json.GetElement(scale, i), 1.0);
+		}
+		float x = (float)json.GetNumber(json.GetElement(rotation, 0), 0.0);
+		float y = (float)json.GetNumber(json.GetElement(rotation, 1), 0.0);
+		float z = (float)json.GetNumber(json.GetElement(rotation, 2), 0.0);
+		float w = (float)json.GetNumber(json.GetElement(rotation, 3), 1.0);
+
+		// columns of the rotation matrix scaled by the node's scale
+		transform[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * s[0];
+		transform[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * s[1];
+		transform[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * s[2];
+		transform[3] = glm::vec4(t[0], t[1], t[2], 1.0f);
+		return(transform);
+	}
+
+	// add the triangle primitives of a node and its children
+	bool CollectPrimitives(
+		const GLTF_DOCUMENT& document,
+		int nodeIndex,
+		const glm::mat4& parentTransform,
+		int depth,
+		std::vector<GLTF_PRIMITIVE>& primitives)
+	{
+		const JsonReader& json = document.json;
+		int root = json.GetRoot();
+		int node = json.GetElement(json.FindMember(root, "nodes"), nodeIndex);
+		if ((node < 0) || (depth > g_MaxNodeDepth))
+		{
+			return(false);
+		}
+
+		glm::mat4 transform = parentTransform * GetNodeTransform(json, node);
+		int mesh = json.GetElement(json.FindMember(root, "meshes"), json.GetInt(json.FindMember(node, "mesh"), -1));
+		int meshPrimitives = json.FindMember(mesh, "primitives");
+		for (int i = 0; i < json.GetCount(meshPrimitives); i++)
+		{
+			int value = json.GetElement(meshPrimitives, i);
+			if (json.GetInt(json.FindMember(value, "mode"), g_GltfTriangles) != g_GltfTriangles)
+			{
+				continue;
+			}
+
+			GLTF_PRIMITIVE primitive = GLTF_PRIMITIVE();
+			primitive.transform = transform;
+			int attributes = json.FindMember(value, "attributes");
+			int positions = json.FindMember(attributes, "POSITION");
+			int normals = json.FindMember(attributes, "NORMAL");
+			int textureCoordinates = json.FindMember(attributes, "TEXCOORD_0");
+			int indices = json.FindMember(value, "indices");
+
+			if ((ReadAccessor(document, json.GetInt(positions, -1), primitive.positions) == false) ||
+				(primitive.positions.componentType != g_GltfFloat) || (primitive.positions.componentCount != 3))
+			{
+				return(false);
+			}
+			if (normals >= 0)
+			{
+				primitive.bNormals = true;
+				if ((ReadAccessor(document, json.GetInt(normals, -1), primitive.normals) == false) ||
+					(primitive.normals.componentType != g_GltfFloat) || (primitive.normals.componentCount != 3) ||
+					(primitive.normals.count != primitive.positions.count))
+				{
+					return(false);
+				}
+			}
+			if (textureCoordinates >= 0)
+			{
+				primitive.bTextureCoordinates = true;
+				if ((ReadAccessor(document, json.GetInt(textureCoordinates, -1), primitive.textureCoordinates) == false) ||
+					(primitive.textureCoordinates.componentCount != 2) ||
+					(primitive.textureCoordinates.count != primitive.positions.count))
+				{
+					return(false);
+				}
+			}
+			primitive.indexCount = primitive.positions.count;
+			if (indices >= 0)
+			{
+				primitive.bIndices = true;
+				int type = 0;
+				if (ReadAccessor(document, json.GetInt(indices, -1), primitive.indices) == true)
+				{
+					type = primitive.indices.componentType;
+				}
+				if (((type != g_GltfUnsignedByte) && (type != g_GltfUnsignedShort) && (type != g_GltfUnsignedInt)) ||
+					(primitive.indices.componentCount != 1))
+				{
+					return(false);
+				}
+				primitive.indexCount = primitive.indices.count;
+			}
+			// a trailing partial triangle is not drawn
+			primitive.indexCount -= primitive.indexCount % 3;
+			primitives.push_back(primitive);
+		}
+
+		int children = json.FindMember(node, "children");
+		for (int i = 0; i < json.GetCount(children); i++)
+		{
+			if (CollectPrimitives(document, json.GetInt(json.GetElement(children, i), -1), transform, depth + 1, primitives) == false)
+			{
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+
+	// convert one primitive into its range of the geometry
+	void ConvertPrimitive(GLTF_PRIMITIVE& primitive, SHAPE_GEOMETRY& geometry)
+	{
+		glm::mat3 linear = glm::mat3(primitive.transform);
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(linear));
+		bool bMirrored = glm::determinant(linear) < 0.0f;
+		size_t vertexCount = primitive.positions.count;
+		SHAPE_VERTEX* pVertices = &geometry.vertices[primitive.firstVertex];
+		uint32_t* pIndices = (primitive.indexCount > 0) ? &geometry.indices[primitive.firstIndex] : NULL;
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			SHAPE_VERTEX& vertex = pVertices[i];
+			vertex.position = glm::vec3(primitive.transform * glm::vec4(ReadVec3(primitive.positions, i), 1.0f));
+			vertex.normal = glm::vec3(0.0f);
+			if (primitive.bNormals)
+			{
+				glm::vec3 normal = normalMatrix * ReadVec3(primitive.normals, i);
+				float length = glm::length(normal);
+				vertex.normal = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+			}
+			vertex.textureCoordinate = glm::vec2(0.0f);
+			if (primitive.bTextureCoordinates)
+			{
+				// glTF puts the origin at the top left of the image
+				vertex.textureCoordinate = glm::vec2(
+					ReadComponent(primitive.textureCoordinates, i, 0),
+					1.0f - ReadComponent(primitive.textureCoordinates, i, 1));
+			}
+		}
+
+		for (size_t i = 0; i < primitive.indexCount; i += 3)
+		{
+			uint32_t corners[3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				corners[corner] = primitive.bIndices ? ReadIndex(primitive.indices, i + corner) : (uint32_t)(i + corner);
+				if (corners[corner] >= vertexCount)
+				{
+					primitive.bBadIndex = true;
+					return;
+				}
+			}
+			// a mirroring transform turns the triangles inside out
+			pIndices[i] = corners[0];
+			pIndices[i + 1] = bMirrored ? corners[2] : corners[1];
+			pIndices[i + 2] = bMirrored ? corners[1] : corners[2];
+		}
+
+		GenerateNormals(pVertices, vertexCount, pIndices, primitive.indexCount);
+		for (size_t i = 0; i < primitive.indexCount; i++)
+		{
+			pIndices[i] += (uint32_t)primitive.firstVertex;
+		}
+	}
+
+	// find the directory part of a path, with its separator
+	std::string GetDirectory(const char* filename)
+	{
+		std::string path(filename);
+		size_t separator = path.find_last_of("/\\");
+		return((separator == std::string::npos) ? std::string() : path.substr(0, separator + 1));
+	}
+
+	// split a GLB into its JSON and binary chunks, or take the
+	// whole file as JSON, then map the buffers it refers to
+	bool LoadGLTFDocument(const char* filename, const MappedFile& file, GLTF_DOCUMENT& document)
+	{
+		const unsigned char* pData = file.GetData();
+		size_t size = file.GetSize();
+		const char* pJson = (const char*)pData;
+		size_t jsonLength = size;
+		GLTF_BUFFER binChunk = { NULL, 0 };
+
+		uint32_t header[3] = { 0, 0, 0 };
+		if (size >= sizeof(header))
+		{
+			memcpy(header, pData, sizeof(header));
+		}
+		if (header[0] == g_GlbMagic)
+		{
+			uint32_t chunkHeader[2] = { 0, 0 };
+			if ((header[1] != g_GlbVersion) || (header[2] > size) || (header[2] < 20))
+			{
+				std::cout << "ERROR: Bad GLB header:" << filename << std::endl;
+				return(false);
+			}
+			size = header[2];
+
+			// chunks follow the header, each padded to four bytes
+			size_t offset = sizeof(header);
+			jsonLength = 0;
+			while (offset + sizeof(chunkHeader) <= size)
+			{
+				memcpy(chunkHeader, pData + offset, sizeof(chunkHeader));
+				offset += sizeof(chunkHeader);
+				if (chunkHeader[0] > size - offset)
+				{
+					std::cout << "ERROR: Bad GLB chunk:" << filename << std::endl;
+					return(false);
+				}
+				if ((chunkHeader[1] == g_GlbJsonChunk) && (jsonLength == 0))
+				{
+					pJson = (const char*)(pData + offset);
+					jsonLength = chunkHeader[0];
+				}
+				else if ((chunkHeader[1] == g_GlbBinChunk) && (NULL == binChunk.pData))
+				{
+					binChunk.pData = pData + offset;
+					binChunk.size = chunkHeader[0];
+				}
+				offset += (chunkHeader[0] + 3) & ~(size_t)3;
+			}
+		}
+
+		if (document.json.Parse(pJson, jsonLength) == false)
+		{
+			std::cout << "ERROR: Bad JSON at offset " << document.json.GetErrorOffset() << ":" << filename << std::endl;
+			return(false);
+		}
+
+		const JsonReader& json = document.json;
+		int buffers = json.FindMember(json.GetRoot(), "buffers");
+		std::string directory = GetDirectory(filename);
+		for (int i = 0; i < json.GetCount(buffers); i++)
+		{
+			int buffer = json.GetElement(buffers, i);
+			int uri = json.FindMember(buffer, "uri");
+			size_t byteLength = 0;
+			GetSize(json, json.FindMember(buffer, "byteLength"), 0, byteLength);
+
+			GLTF_BUFFER entry = { NULL, 0 };
+			if (uri < 0)
+			{
+				// the buffer without a URI is the GLB binary chunk
+				if ((i != 0) || (NULL == binChunk.pData) || (byteLength > binChunk.size))
+				{
+					std::cout << "ERROR: glTF buffer " << i << " has no data:" << filename << std::endl;
+					return(false);
+				}
+				entry = binChunk;
+			}
+			else
+			{
+				std::string bufferName = json.GetString(uri);
+				if (bufferName.compare(0, 5, "data:") == 0)
+				{
+					std::cout << "ERROR: glTF buffers embedded as data URIs are not supported:" << filename << std::endl;
+					return(false);
+				}
+
+				MappedFile* pBufferFile = new MappedFile();
+				document.bufferFiles.push_back(pBufferFile);
+				if ((pBufferFile->Open((directory + bufferName).c_str()) == false) || (byteLength > pBufferFile->GetSize()))
+				{
+					std::cout << "ERROR: Could not load glTF buffer " << bufferName << ":" << filename << std::endl;
+					return(false);
+				}
+				entry.pData = pBufferFile->GetData();
+				entry.size = pBufferFile->GetSize();
+				document.fileBytes += entry.size;
+			}
+			// accessors may only reach the declared length
+			entry.size = std::min(entry.size, byteLength);
+			document.buffers.push_back(entry);
+		}
+
+		return(true);
+	}
+
+	// compare the extension of a file name, ignoring case
+	bool HasExtension(const char* filename, const char* extension)
+	{
+		size_t length = strlen(filename);
+		size_t extensionLength = strlen(extension);
+		if (length < extensionLength)
+		{
+			return(false);
+		}
+
+		for (size_t i = 0; i < extensionLength; i++)
+		{
+			char c = filename[length - extensionLength + i];
+			if ((c >= 'A') && (c <= 'Z'))
+			{
+				c = (char)(c - 'A' + 'a');
+			}
+			if (c != extension[i])
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  ParseFloat()
+ *
+ *  This method is used for parsing a decimal number without
+ *  going through the C library.  Up to 19 significant digits
+ *  are gathered into an integer, eight at a time when they
+ *  are all digits, and a value whose digits and power of ten
+ *  are both exact in a double is scaled with one multiply or
+ *  divide, which rounds correctly.  Anything else, which is
+ *  rare in mesh files, is handed to strtod.
+ ***********************************************************/
+bool MeshImporter::ParseFloat(const char*& pText, const char* pEnd, float& value)
+{
+	const char* pStart = pText;
+	bool bNegative = false;
+	if ((pText < pEnd) && ((*pText == '-') || (*pText == '+')))
+	{
+		bNegative = (*pText == '-');
+		pText++;
+	}
+
+	uint64_t mantissa = 0;
+	int digitCount = 0;
+	int droppedCount = 0;
+	int integerDigits = ParseDigits(pText, pEnd, mantissa, digitCount, droppedCount);
+	// integer digits that were dropped still scale the value
+	int exponent = droppedCount;
+
+	int fractionDigits = 0;
+	if ((pText < pEnd) && (*pText == '.'))
+	{
+		pText++;
+		int droppedBefore = droppedCount;
+		fractionDigits = ParseDigits(pText, pEnd, mantissa, digitCount, droppedCount);
+		exponent -= fractionDigits - (droppedCount - droppedBefore);
+	}
+	if (integerDigits + fractionDigits == 0)
+	{
+		pText = pStart;
+		return(false);
+	}
+
+	if ((pText < pEnd) && ((*pText == 'e') || (*pText == 'E')))
+	{
+		const char* pExponent = pText;
+		pText++;
+		bool bNegativeExponent = false;
+		if ((pText < pEnd) && ((*pText == '-') || (*pText == '+')))
+		{
+			bNegativeExponent = (*pText == '-');
+			pText++;
+		}
+		int exponentValue = 0;
+		int exponentDigits = 0;
+		while ((pText < pEnd) && (*pText >= '0') && (*pText <= '9'))
+		{
+			if (exponentValue < 10000)
+			{
+				exponentValue = (exponentValue * 10) + (*pText - '0');
+			}
+			exponentDigits++;
+			pText++;
+		}
+		if (exponentDigits == 0)
+		{
+			// an e that starts no exponent is not part of the number
+			pText = pExponent;
+		}
+		else
+		{
+			exponent += bNegativeExponent ? -exponentValue : exponentValue;
+		}
+	}
+
+	double result = 0.0;
+	if ((droppedCount == 0) && (mantissa <= (1ull << 53)) && (exponent >= -22) && (exponent <= 22))
+	{
+		result = (double)mantissa;
+		result = (exponent < 0) ? result / g_PowersOfTen[-exponent] : result * g_PowersOfTen[exponent];
+		if (bNegative)
+		{
+			result = -result;
+		}
+	}
+	else
+	{
+		// strtod needs a terminated copy of the number
+		char buffer[128];
+		size_t length = (size_t)(pText - pStart);
+		if (length >= sizeof(buffer))
+		{
+			pText = pStart;
+			return(false);
+		}
+		memcpy(buffer, pStart, length);
+		buffer[length] = '\0';
+		result = strtod(buffer, NULL);
+	}
+
+	value = (float)result;
+	return(true);
+}
+
+/***********************************************************
+ *  ImportOBJ()
+ *
+ *  This method is used for importing an OBJ file.  The mapped
+ *  file is cut into chunks at line breaks, which are parsed
+ *  in parallel.  The face indexes of every chunk are then
+ *  resolved against the totals of the chunks before it, also
+ *  in parallel, and the vertices are built in file order with
+ *  a hash table merging the corners that repeat.
+ ***********************************************************/
+bool MeshImporter::ImportOBJ(
+	const char* filename,
+	SHAPE_GEOMETRY& geometry,
+	JobSystem* pJobSystem,
+	IMPORT_STATS* pStats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	geometry.vertices.clear();
+	geometry.indices.clear();
+
+	MappedFile file;
+	if (file.Open(filename) == false)
+	{
+		return(false);
+	}
+	const char* pData = (const char*)file.GetData();
+	const char* pEnd = pData + file.GetSize();
+
+	int workerCount = (NULL != pJobSystem) ? std::max(1, pJobSystem->GetWorkerCount()) : 1;
+	size_t chunkCount = std::min((size_t)(workerCount * g_ChunksPerWorker), file.GetSize() / g_MinChunkBytes);
+	chunkCount = std::max(chunkCount, (size_t)1);
+
+	std::vector<OBJ_CHUNK> chunks;
+	const char* pBegin = pData;
+	for (size_t i = 0; (i < chunkCount) && (pBegin < pEnd); i++)
+	{
+		const char* pChunkEnd = pEnd;
+		if (i + 1 < chunkCount)
+		{
+			pChunkEnd = std::max(pBegin, pData + ((file.GetSize() * (i + 1)) / chunkCount));
+			const char* pNewline = (const char*)memchr(pChunkEnd, '\n', (size_t)(pEnd - pChunkEnd));
+			pChunkEnd = (NULL != pNewline) ? pNewline + 1 : pEnd;
+		}
+
+		OBJ_CHUNK chunk = OBJ_CHUNK();
+		chunk.pBegin = pBegin;
+		chunk.pEnd = pChunkEnd;
+		chunk.pError = NULL;
+		chunk.bBadIndex = false;
+		chunks.push_back(chunk);
+		pBegin = pChunkEnd;
+	}
+
+	OBJ_CHUNK* pChunks = &chunks[0];
+	RunJobs(pJobSystem, (int)chunks.size(), [pChunks](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			ParseOBJChunk(pChunks[i]);
+		}
+	});
+
+	size_t totals[3] = { 0, 0, 0 };
+	size_t cornerCount = 0;
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (NULL != chunks[i].pError)
+		{
+			size_t line = 1 + std::count(pData, chunks[i].pError, '\n');
+			std::cout << "ERROR: " << filename << ":" << line << ": Bad OBJ record" << std::endl;
+			return(false);
+		}
+
+		chunks[i].base[0] = totals[0];
+		chunks[i].base[1] = totals[1];
+		chunks[i].base[2] = totals[2];
+		totals[0] += chunks[i].positions.size() / 3;
+		totals[1] += chunks[i].textureCoordinates.size() / 2;
+		totals[2] += chunks[i].normals.size() / 3;
+		cornerCount += chunks[i].corners.size();
+	}
+	if ((cornerCount == 0) || (cornerCount > INT32_MAX) || (totals[0] > INT32_MAX) || (totals[1] > INT32_MAX) || (totals[2] > INT32_MAX))
+	{
+		std::cout << "ERROR: OBJ file has no triangles or too many:" << filename << std::endl;
+		return(false);
+	}
+
+	// gather the values of every chunk after the ones before it
+	std::vector<float> positions(totals[0] * 3);
+	std::vector<float> textureCoordinates(totals[1] * 2);
+	std::vector<float> normals(totals[2] * 3);
+	const size_t* pTotals = totals;
+	float* pPositions = &positions[0];
+	float* pTextureCoordinates = textureCoordinates.empty() ? NULL : &textureCoordinates[0];
+	float* pNormals = normals.empty() ? NULL : &normals[0];
+	RunJobs(pJobSystem, (int)chunks.size(), [=](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			OBJ_CHUNK& chunk = pChunks[i];
+			std::copy(chunk.positions.begin(), chunk.positions.end(), pPositions + (chunk.base[0] * 3));
+			std::copy(chunk.textureCoordinates.begin(), chunk.textureCoordinates.end(), pTextureCoordinates + (chunk.base[1] * 2));
+			std::copy(chunk.normals.begin(), chunk.normals.end(), pNormals + (chunk.base[2] * 3));
+			ResolveOBJChunk(chunk, pTotals);
+		}
+	});
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		if (chunks[i].bBadIndex == true)
+		{
+			std::cout << "ERROR: OBJ face refers to a missing vertex:" << filename << std::endl;
+			return(false);
+		}
+	}
+	std::chrono::steady_clock::time_point parsed = std::chrono::steady_clock::now();
+
+	// one vertex for every distinct position, texture coordinate
+	// and normal triple
+	std::vector<int32_t> table(HashTableSize(cornerCount), -1);
+	std::vector<OBJ_CORNER> keys;
+	size_t mask = table.size() - 1;
+	geometry.indices.reserve(cornerCount);
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		for (size_t j = 0; j < chunks[i].corners.size(); j++)
+		{
+			const OBJ_CORNER& corner = chunks[i].corners[j];
+			size_t slot = HashWords((const uint32_t*)corner.index, 3) & mask;
+			while ((table[slot] >= 0) && (memcmp(keys[table[slot]].index, corner.index, sizeof(corner.index)) != 0))
+			{
+				slot = (slot + 1) & mask;
+			}
+
+			if (table[slot] < 0)
+			{
+				table[slot] = (int32_t)geometry.vertices.size();
+				keys.push_back(corner);
+
+				SHAPE_VERTEX vertex;
+				const float* pPosition = &positions[(size_t)corner.index[0] * 3];
+				vertex.position = glm::vec3(pPosition[0], pPosition[1], pPosition[2]);
+				vertex.normal = glm::vec3(0.0f);
+				vertex.textureCoordinate = glm::vec2(0.0f);
+				if (corner.index[1] >= 0)
+				{
+					const float* pTextureCoordinate = &textureCoordinates[(size_t)corner.index[1] * 2];
+					vertex.textureCoordinate = glm::vec2(pTextureCoordinate[0], pTextureCoordinate[1]);
+				}
+				if (corner.index[2] >= 0)
+				{
+					const float* pNormal = &normals[(size_t)corner.index[2] * 3];
+					vertex.normal = glm::vec3(pNormal[0], pNormal[1], pNormal[2]);
+				}
+				geometry.vertices.push_back(vertex);
+			}
+			geometry.indices.push_back((uint32_t)table[slot]);
+		}
+	}
+	GenerateNormals(&geometry.vertices[0], geometry.vertices.size(), &geometry.indices[0], geometry.indices.size());
+	std::chrono::steady_clock::time_point merged = std::chrono::steady_clock::now();
+
+	if (NULL != pStats)
+	{
+		pStats->fileBytes = file.GetSize();
+		pStats->vertexCount = (int)geometry.vertices.size();
+		pStats->triangleCount = (int)(geometry.indices.size() / 3);
+		pStats->parseMs = ElapsedMs(start, parsed);
+		pStats->mergeMs = ElapsedMs(parsed, merged);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ImportGLTF()
+ *
+ *  This method is used for importing the triangles of the
+ *  default scene of a glTF or GLB file.  The nodes are walked
+ *  first to find every primitive and its transform, which
+ *  gives each primitive its range of the output, and then the
+ *  primitives are converted in parallel.  Primitives without
+ *  indexes repeat their shared vertices, so identical
+ *  vertices are merged at the end.
+ ***********************************************************/
+bool MeshImporter::ImportGLTF(
+	const char* filename,
+	SHAPE_GEOMETRY& geometry,
+	JobSystem* pJobSystem,
+	IMPORT_STATS* pStats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	geometry.vertices.clear();
+	geometry.indices.clear();
+
+	MappedFile file;
+	GLTF_DOCUMENT document;
+	if ((file.Open(filename) == false) || (LoadGLTFDocument(filename, file, document) == false))
+	{
+		return(false);
+	}
+	document.fileBytes += file.GetSize();
+
+	// the nodes of the default scene, or every mesh as it is when
+	// the file has no scenes
+	const JsonReader& json = document.json;
+	int root = json.GetRoot();
+	std::vector<GLTF_PRIMITIVE> primitives;
+	bool bValid = true;
+	int scenes = json.FindMember(root, "scenes");
+	if (json.GetCount(scenes) > 0)
+	{
+		int scene = json.GetElement(scenes, json.GetInt(json.FindMember(root, "scene"), 0));
+		int nodes = json.FindMember(scene, "nodes");
+		for (int i = 0; (i < json.GetCount(nodes)) && (bValid == true); i++)
+		{
+			bValid = CollectPrimitives(document, json.GetInt(json.GetElement(nodes, i), -1), glm::mat4(1.0f), 0, primitives);
+		}
+	}
+	else
+	{
+		// without scenes, every node that is nobody's child is a root
+		int nodes = json.FindMember(root, "nodes");
+		std::vector<char> bChild(json.GetCount(nodes), 0);
+		for (int i = 0; i < json.GetCount(nodes); i++)
+		{
+			int children = json.FindMember(json.GetElement(nodes, i), "children");
+			for (int j = 0; j < json.GetCount(children); j++)
+			{
+				int child = json.GetInt(json.GetElement(children, j), -1);
+				if ((child >= 0) && (child < (int)bChild.size()))
+				{
+					bChild[child] = 1;
+				}
+			}
+		}
+		for (int i = 0; (i < (int)bChild.size()) && (bValid == true); i++)
+		{
+			if (bChild[i] == 0)
+			{
+				bValid = CollectPrimitives(document, i, glm::mat4(1.0f), 0, primitives);
+			}
+		}
+	}
+	if (bValid == false)
+	{
+		std::cout << "ERROR: glTF file has a bad node, mesh or accessor:" << filename << std::endl;
+		return(false);
+	}
+
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		primitives[i].firstVertex = vertexCount;
+		primitives[i].firstIndex = indexCount;
+		vertexCount += primitives[i].positions.count;
+		indexCount += primitives[i].indexCount;
+	}
+	if ((indexCount == 0) || (vertexCount > UINT32_MAX))
+	{
+		std::cout << "ERROR: glTF file has no triangles or too many:" << filename << std::endl;
+		return(false);
+	}
+
+	geometry.vertices.resize(vertexCount);
+	geometry.indices.resize(indexCount);
+	GLTF_PRIMITIVE* pPrimitives = &primitives[0];
+	SHAPE_GEOMETRY* pGeometry = &geometry;
+	RunJobs(pJobSystem, (int)primitives.size(), [pPrimitives, pGeometry](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			ConvertPrimitive(pPrimitives[i], *pGeometry);
+		}
+	});
+	for (size_t i = 0; i < primitives.size(); i++)
+	{
+		if (primitives[i].bBadIndex == true)
+		{
+			std::cout << "ERROR: glTF primitive refers to a missing vertex:" << filename << std::endl;
+			geometry.vertices.clear();
+			geometry.indices.clear();
+			return(false);
+		}
+	}
+	std::chrono::steady_clock::time_point parsed = std::chrono::steady_clock::now();
+
+	WeldVertices(geometry);
+	std::chrono::steady_clock::time_point merged = std::chrono::steady_clock::now();
+
+	if (NULL != pStats)
+	{
+		pStats->fileBytes = document.fileBytes;
+		pStats->vertexCount = (int)geometry.vertices.size();
+		pStats->triangleCount = (int)(geometry.indices.size() / 3);
+		pStats->parseMs = ElapsedMs(start, parsed);
+		pStats->mergeMs = ElapsedMs(parsed, merged);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  ImportMesh()
+ *
+ *  This method is used for importing a mesh file, choosing
+ *  the format by the file's extension.
+ ***********************************************************/
+bool MeshImporter::ImportMesh(
+	const char* filename,
+	SHAPE_GEOMETRY& geometry,
+	JobSystem* pJobSystem,
+	IMPORT_STATS* pStats)
+{
+	if (HasExtension(filename, ".obj"))
+	{
+		return(ImportOBJ(filename, geometry, pJobSystem, pStats));
+	}
+	if (HasExtension(filename, ".gltf") || HasExtension(filename, ".glb"))
+	{
+		return(ImportGLTF(filename, geometry, pJobSystem, pStats));
+	}
+
+	std::cout << "ERROR: Unknown mesh file type:" << filename << std::endl;
+	return(false);
+}
@@ -0,0 +1,75 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshimporter.h
+// ============
+// import triangle meshes from OBJ and glTF files into the vertex layout of
+// the basic shapes, parsing large files in parallel on the job system
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "JobSystem.h"
+#include "ShapeGeometry.h"
+
+#include <cstddef>
+
+/***********************************************************
+ *  MeshImporter
+ *
+ *  This class reads a mesh file into one SHAPE_GEOMETRY, so
+ *  an imported mesh is uploaded, batched and drawn like the
+ *  basic shapes.  Files are mapped into memory instead of
+ *  read.
+ *
+ *  OBJ files are cut into chunks at line breaks, and every
+ *  chunk is parsed by its own job.  Face indexes are resolved
+ *  once the number of positions, normals and texture
+ *  coordinates before each chunk is known, and the corners
+ *  that repeat the same position, texture coordinate and
+ *  normal are merged through a hash table.  Faces with more
+ *  than three corners are split into a fan of triangles.
+ *
+ *  glTF files are read as .gltf with .bin buffers next to
+ *  them, or as a single .glb.  The vertex data is read in
+ *  place from the buffer views, the node transforms of the
+ *  default scene are baked into the vertices, and every
+ *  primitive is converted by its own job.  Texture
+ *  coordinates are flipped to the bottom-left origin the
+ *  textures are loaded with.
+ *
+ *  Missing normals are computed from the triangles.
+ ***********************************************************/
+class MeshImporter
+{
+public:
+	struct IMPORT_STATS
+	{
+		// size of the mesh file and any buffers it loads
+		size_t fileBytes;
+		int vertexCount;
+		int triangleCount;
+		// time spent parsing the file and building the vertices
+		double parseMs;
+		double mergeMs;
+	};
+
+	// import an OBJ, glTF or GLB file, chosen by its extension
+	static bool ImportMesh(
+		const char* filename,
+		SHAPE_GEOMETRY& geometry,
+		JobSystem* pJobSystem,
+		IMPORT_STATS* pStats = NULL);
+
+	static bool ImportOBJ(
+		const char* filename,
+		SHAPE_GEOMETRY& geometry,
+		JobSystem* pJobSystem,
+		IMPORT_STATS* pStats = NULL);
+	static bool ImportGLTF(
+		const char* filename,
+		SHAPE_GEOMETRY& geometry,
+		JobSystem* pJobSystem,
+		IMPORT_STATS* pStats = NULL);
+
+	// parse a decimal number at pText, moving pText past it
+	static bool ParseFloat(const char*& pText, const char* pEnd, float& value);
+};
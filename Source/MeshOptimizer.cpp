@@ -0,0 +1,267 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.cpp
+// ============
+// reorder triangles for the post-transform vertex cache and vertices for
+// fetch locality, and measure how well a mesh uses the cache
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MeshOptimizer.h"
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// scoring constants from Forsyth's article
+	const float g_CacheDecayPower = 1.5f;
+	const float g_LastTriangleScore = 0.75f;
+	const float g_ValenceBoostScale = 2.0f;
+	const float g_ValenceBoostPower = 0.5f;
+
+	// score of a vertex from its position in the simulated cache
+	// and the number of its triangles that are not emitted yet
+	float VertexScore(int cachePosition, int remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+		{
+			// no triangle needs this vertex any more
+			return(-1.0f);
+		}
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// the vertices of the last triangle get a fixed score,
+				// so the next triangle does not simply reuse its edge
+				score = g_LastTriangleScore;
+			}
+			else
+			{
+				float scale = 1.0f / (MeshOptimizer::CACHE_SIZE - 3);
+				score = 1.0f - ((cachePosition - 3) * scale);
+				score = pow(score, g_CacheDecayPower);
+			}
+		}
+
+		// favor vertices with few triangles left, to finish them off
+		score += g_ValenceBoostScale * pow((float)remainingTriangles, -g_ValenceBoostPower);
+
+		return(score);
+	}
+}
+
+/***********************************************************
+ *  OptimizeVertexCache()
+ *
+ *  This method is used for reordering the triangles of an
+ *  index list.  After each emitted triangle only the vertices
+ *  in the simulated cache change score, so only their
+ *  triangles are rescored, which keeps the pass close to
+ *  linear in the triangle count.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	size_t triangleCount = indices.size() / 3;
+	if ((triangleCount == 0) || (vertexCount == 0))
+	{
+		return;
+	}
+
+	// triangles that use each vertex, as ranges of one flat list
+	std::vector<int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		remaining[indices[i]]++;
+	}
+	std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+	}
+	std::vector<uint32_t> vertexTriangles(triangleCount * 3);
+	std::vector<size_t> fillCount(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = indices[(t * 3) + corner];
+			vertexTriangles[firstTriangle[v] + fillCount[v]] = (uint32_t)t;
+			fillCount[v]++;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+	}
+
+	std::vector<bool> bEmitted(triangleCount, false);
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	std::vector<uint32_t> cache;
+	cache.reserve(CACHE_SIZE + 3);
+	size_t nextUnemitted = 0;
+	int bestTriangle = -1;
+
+	for (size_t emitted = 0; emitted < triangleCount; emitted++)
+	{
+		// when the cache offers nothing, start from the next triangle
+		// that has not been emitted yet
+		if (bestTriangle < 0)
+		{
+			while (bEmitted[nextUnemitted])
+			{
+				nextUnemitted++;
+			}
+			bestTriangle = (int)nextUnemitted;
+		}
+
+		bEmitted[bestTriangle] = true;
+		uint32_t triangleVertices[3];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			triangleVertices[corner] = indices[(bestTriangle * 3) + corner];
+			result.push_back(triangleVertices[corner]);
+			remaining[triangleVertices[corner]]--;
+		}
+
+		// move the triangle's vertices to the front of the cache
+		std::vector<uint32_t> newCache(triangleVertices, triangleVertices + 3);
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t v = cache[i];
+			if ((v != triangleVertices[0]) && (v != triangleVertices[1]) && (v != triangleVertices[2]))
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// rescore the vertices that are in, or just fell out of, the cache
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = (i < (size_t)CACHE_SIZE) ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+		if (newCache.size() > (size_t)CACHE_SIZE)
+		{
+			newCache.resize(CACHE_SIZE);
+		}
+		cache.swap(newCache);
+
+		// rescore the triangles of the cached vertices and pick the best
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			uint32_t v = cache[i];
+			for (size_t j = firstTriangle[v]; j < firstTriangle[v + 1]; j++)
+			{
+				uint32_t t = vertexTriangles[j];
+				if (bEmitted[t])
+				{
+					continue;
+				}
+
+				float score =
+					vertexScore[indices[(t * 3) + 0]] +
+					vertexScore[indices[(t * 3) + 1]] +
+					vertexScore[indices[(t * 3) + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = (int)t;
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+/***********************************************************
+ *  OptimizeVertexFetch()
+ *
+ *  This method is used for renumbering the vertices in the
+ *  order the index list first uses them, so the vertex fetch
+ *  reads the vertex buffer mostly front to back.  Vertices no
+ *  triangle uses are dropped.
+ ***********************************************************/
+void MeshOptimizer::OptimizeVertexFetch(SHAPE_GEOMETRY& geometry)
+{
+	const uint32_t unassigned = 0xFFFFFFFF;
+	std::vector<uint32_t> remap(geometry.vertices.size(), unassigned);
+	std::vector<SHAPE_VERTEX> vertices;
+	vertices.reserve(geometry.vertices.size());
+
+	for (size_t i = 0; i < geometry.indices.size(); i++)
+	{
+		uint32_t v = geometry.indices[i];
+		if (remap[v] == unassigned)
+		{
+			remap[v] = (uint32_t)vertices.size();
+			vertices.push_back(geometry.vertices[v]);
+		}
+		geometry.indices[i] = remap[v];
+	}
+
+	geometry.vertices.swap(vertices);
+}
+
+/***********************************************************
+ *  Optimize()
+ *
+ *  This method is used for reordering a mesh for the vertex
+ *  cache and then for the vertex fetch.
+ ***********************************************************/
+void MeshOptimizer::Optimize(SHAPE_GEOMETRY& geometry)
+{
+	OptimizeVertexCache(geometry.indices, geometry.vertices.size());
+	OptimizeVertexFetch(geometry);
+}
+
+/***********************************************************
+ *  ComputeACMR()
+ *
+ *  This method is used for measuring the average cache miss
+ *  ratio of an index list - the number of vertices that are
+ *  transformed per triangle with a FIFO cache.  It is 0.5 at
+ *  best for a large regular grid and 3 at worst.
+ ***********************************************************/
+float MeshOptimizer::ComputeACMR(
+	const std::vector<uint32_t>& indices,
+	size_t vertexCount,
+	int cacheSize)
+{
+	size_t triangleCount = indices.size() / 3;
+	if ((triangleCount == 0) || (cacheSize < 1))
+	{
+		return(0.0f);
+	}
+
+	// the time a vertex entered the cache, it is still cached while
+	// fewer than cacheSize other vertices have entered since then
+	std::vector<size_t> entryTime(vertexCount, 0);
+	std::vector<bool> bSeen(vertexCount, false);
+	size_t clock = 0;
+	size_t misses = 0;
+
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		uint32_t v = indices[i];
+		if ((bSeen[v] == false) || ((clock - entryTime[v]) >= (size_t)cacheSize))
+		{
+			bSeen[v] = true;
+			entryTime[v] = clock;
+			clock++;
+			misses++;
+		}
+	}
+
+	return((float)misses / triangleCount);
+}
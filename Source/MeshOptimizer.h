@@ -0,0 +1,46 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshoptimizer.h
+// ============
+// reorder triangles for the post-transform vertex cache and vertices for
+// fetch locality, and measure how well a mesh uses the cache
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShapeGeometry.h"
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  MeshOptimizer
+ *
+ *  This class holds the mesh reordering steps.  The triangle
+ *  order follows Tom Forsyth's linear-speed vertex cache
+ *  optimization: triangles are emitted greedily, picking the
+ *  one whose vertices score best for being in a simulated
+ *  cache and for having few triangles left to draw.  The
+ *  vertices are then renumbered in the order they are first
+ *  used, so the vertex fetches walk through memory.
+ ***********************************************************/
+class MeshOptimizer
+{
+public:
+	// size of the simulated cache the triangle order is tuned for
+	static const int CACHE_SIZE = 32;
+	// FIFO size of the cache model used for reporting ACMR
+	static const int ACMR_CACHE_SIZE = 16;
+
+	// reorder the triangles for the post-transform vertex cache
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	// renumber the vertices in the order the triangles use them
+	static void OptimizeVertexFetch(SHAPE_GEOMETRY& geometry);
+	// reorder the triangles, then the vertices
+	static void Optimize(SHAPE_GEOMETRY& geometry);
+
+	// average number of cache misses per triangle with a FIFO cache
+	static float ComputeACMR(
+		const std::vector<uint32_t>& indices,
+		size_t vertexCount,
+		int cacheSize = ACMR_CACHE_SIZE);
+};
@@ -0,0 +1,418 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.cpp
+// ============
+// upload the basic shapes and imported meshes with cache-optimized index
+// buffers, optionally in a compact vertex layout, and draw them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PrimitiveMeshes.h"
+#include "MeshOptimizer.h"
+#include "MemoryTracker.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const char* g_MeshNames[MESH_TYPE_COUNT] = { "plane", "box", "cylinder", "sphere" };
+}
+
+/***********************************************************
+ *  PrimitiveMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PrimitiveMeshes::PrimitiveMeshes()
+{
+	m_bCompactVertices = false;
+}
+
+/***********************************************************
+ *  ~PrimitiveMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PrimitiveMeshes::~PrimitiveMeshes()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  FloatToHalf()
+ *
+ *  This method is used for converting a float into a half
+ *  float, rounding to the nearest value.  Values too small
+ *  for a half become subnormals or zero, values too large
+ *  become infinity.
+ ***********************************************************/
+uint16_t PrimitiveMeshes::FloatToHalf(float value)
+{
+	uint32_t bits = 0;
+	memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xFF;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int exponent = (int)floatExponent - 127 + 15;
+
+	if (floatExponent == 0xFF)
+	{
+		// infinity stays infinity, NaN stays NaN
+		return((uint16_t)(sign | 0x7C00 | ((mantissa != 0) ? 0x200 : 0)));
+	}
+	if (exponent >= 31)
+	{
+		return((uint16_t)(sign | 0x7C00));
+	}
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+		{
+			return((uint16_t)sign);
+		}
+
+		// subnormal, the implicit leading one becomes explicit
+		mantissa |= 0x800000;
+		int shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		if (((mantissa >> (shift - 1)) & 1) != 0)
+		{
+			half++;
+		}
+		return((uint16_t)(sign | half));
+	}
+
+	// a rounding carry out of the mantissa correctly bumps the exponent
+	uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+	if ((mantissa & 0x1000) != 0)
+	{
+		half++;
+	}
+	return((uint16_t)half);
+}
+
+/***********************************************************
+ *  PackSnorm16()
+ *
+ *  This method is used for converting a value between -1 and
+ *  1 into a signed normalized 16-bit integer.
+ ***********************************************************/
+int16_t PrimitiveMeshes::PackSnorm16(float value)
+{
+	float clamped = glm::clamp(value, -1.0f, 1.0f);
+	return((int16_t)floor((clamped * 32767.0f) + 0.5f));
+}
+
+/***********************************************************
+ *  PackNormal()
+ *
+ *  This method is used for packing a unit normal into the
+ *  signed normalized GL_INT_2_10_10_10_REV format.
+ ***********************************************************/
+uint32_t PrimitiveMeshes::PackNormal(const glm::vec3& normal)
+{
+	uint32_t packed = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		float clamped = glm::clamp(normal[i], -1.0f, 1.0f);
+		int component = (int)floor((clamped * 511.0f) + 0.5f);
+		packed |= ((uint32_t)component & 0x3FF) << (i * 10);
+	}
+	return(packed);
+}
+
+/***********************************************************
+ *  CreateMesh()
+ *
+ *  This method is used for uploading one shape.  A shape that
+ *  does not fit in -1 to 1 keeps the full float layout, since
+ *  snorm16 positions cannot reach past that range.
+ ***********************************************************/
+bool PrimitiveMeshes::CreateMesh(const SHAPE_GEOMETRY& geometry, bool bCompact, GPU_MESH& mesh, MESH_STATS& stats)
+{
+	if ((geometry.vertices.empty() == true) || (geometry.indices.empty() == true))
+	{
+		return(false);
+	}
+
+	if (bCompact == true)
+	{
+		for (size_t i = 0; i < geometry.vertices.size(); i++)
+		{
+			glm::vec3 extent = glm::abs(geometry.vertices[i].position);
+			if ((extent.x > 1.0f) || (extent.y > 1.0f) || (extent.z > 1.0f))
+			{
+				bCompact = false;
+				break;
+			}
+		}
+	}
+
+	glGenVertexArrays(1, &mesh.vertexArrayID);
+	glBindVertexArray(mesh.vertexArrayID);
+	glGenBuffers(1, &mesh.vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.vertexBufferID);
+
+	if (bCompact == true)
+	{
+		std::vector<COMPACT_VERTEX> vertices(geometry.vertices.size());
+		for (size_t i = 0; i < geometry.vertices.size(); i++)
+		{
+			const SHAPE_VERTEX& source = geometry.vertices[i];
+			vertices[i].position[0] = PackSnorm16(source.position.x);
+			vertices[i].position[1] = PackSnorm16(source.position.y);
+			vertices[i].position[2] = PackSnorm16(source.position.z);
+			vertices[i].position[3] = 32767;
+			vertices[i].normal = PackNormal(source.normal);
+			vertices[i].textureCoordinate[0] = FloatToHalf(source.textureCoordinate.x);
+			vertices[i].textureCoordinate[1] = FloatToHalf(source.textureCoordinate.y);
+		}
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(COMPACT_VERTEX), &vertices[0], GL_STATIC_DRAW);
+		MemoryTracker::TrackBuffer(mesh.vertexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+			"mesh vertices", vertices.size() * sizeof(COMPACT_VERTEX));
+
+		GLsizei stride = sizeof(COMPACT_VERTEX);
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, position));
+		// packed formats always have four components, the shader ignores w
+		glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(COMPACT_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(COMPACT_VERTEX, textureCoordinate));
+		stats.bytesPerVertex = sizeof(COMPACT_VERTEX);
+	}
+	else
+	{
+		glBufferData(GL_ARRAY_BUFFER, geometry.vertices.size() * sizeof(SHAPE_VERTEX), &geometry.vertices[0], GL_STATIC_DRAW);
+		MemoryTracker::TrackBuffer(mesh.vertexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+			"mesh vertices", geometry.vertices.size() * sizeof(SHAPE_VERTEX));
+
+		GLsizei stride = sizeof(SHAPE_VERTEX);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SHAPE_VERTEX, position));
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SHAPE_VERTEX, normal));
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SHAPE_VERTEX, textureCoordinate));
+		stats.bytesPerVertex = sizeof(SHAPE_VERTEX);
+	}
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+
+	glGenBuffers(1, &mesh.indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBufferID);
+	if (geometry.vertices.size() <= 0xFFFF)
+	{
+		std::vector<uint16_t> indices(geometry.indices.begin(), geometry.indices.end());
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), &indices[0], GL_STATIC_DRAW);
+		MemoryTracker::TrackBuffer(mesh.indexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+			"mesh indices", indices.size() * sizeof(uint16_t));
+		mesh.indexType = GL_UNSIGNED_SHORT;
+		stats.bytesPerIndex = sizeof(uint16_t);
+	}
+	else
+	{
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, geometry.indices.size() * sizeof(uint32_t), &geometry.indices[0], GL_STATIC_DRAW);
+		MemoryTracker::TrackBuffer(mesh.indexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+			"mesh indices", geometry.indices.size() * sizeof(uint32_t));
+		mesh.indexType = GL_UNSIGNED_INT;
+		stats.bytesPerIndex = sizeof(uint32_t);
+	}
+	mesh.indexCount = (GLsizei)geometry.indices.size();
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(true);
+}
+
+/***********************************************************
+ *  RegisterMesh()
+ *
+ *  This method is used for reordering a mesh for the vertex
+ *  cache and vertex fetch, and uploading it.  The cache miss
+ *  ratio is measured before and after the reordering for the
+ *  statistics.  A mesh that cannot be created still takes its
+ *  mesh type, so the types stay in order, and is not drawn.
+ ***********************************************************/
+int PrimitiveMeshes::RegisterMesh(SHAPE_GEOMETRY& geometry, const char* name)
+{
+	MESH_STATS stats;
+	memset(&stats, 0, sizeof(stats));
+	GPU_MESH mesh;
+	memset(&mesh, 0, sizeof(mesh));
+
+	stats.acmrBefore = MeshOptimizer::ComputeACMR(geometry.indices, geometry.vertices.size());
+	MeshOptimizer::Optimize(geometry);
+	stats.acmrAfter = MeshOptimizer::ComputeACMR(geometry.indices, geometry.vertices.size());
+	stats.vertexCount = (int)geometry.vertices.size();
+	stats.triangleCount = (int)(geometry.indices.size() / 3);
+
+	int meshType = (int)m_meshes.size();
+	if (CreateMesh(geometry, m_bCompactVertices, mesh, stats) == false)
+	{
+		std::cout << "ERROR: Could not create the " << name << " mesh" << std::endl;
+		meshType = -1;
+	}
+
+	m_meshes.push_back(mesh);
+	m_stats.push_back(stats);
+	m_names.push_back(name);
+	return(meshType);
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for building every basic shape and
+ *  uploading it.  Any meshes added before are freed.
+ ***********************************************************/
+bool PrimitiveMeshes::Load(bool bCompactVertices)
+{
+	Destroy();
+	m_bCompactVertices = bCompactVertices;
+
+	bool bSuccess = true;
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		SHAPE_GEOMETRY geometry;
+		ShapeGeometry::BuildShape(i, geometry);
+		if (RegisterMesh(geometry, g_MeshNames[i]) < 0)
+		{
+			bSuccess = false;
+		}
+	}
+
+	return(bSuccess);
+}
+
+/***********************************************************
+ *  AddMesh()
+ *
+ *  This method is used for adding an imported mesh after the
+ *  basic shapes.  The geometry is left in the order it is
+ *  drawn in, so the static batches can share it.
+ ***********************************************************/
+int PrimitiveMeshes::AddMesh(SHAPE_GEOMETRY& geometry, const char* name)
+{
+	if ((int)m_meshes.size() < MESH_TYPE_COUNT)
+	{
+		std::cout << "ERROR: The basic shapes must be loaded before the " << name << " mesh" << std::endl;
+		return(-1);
+	}
+
+	return(RegisterMesh(geometry, name));
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the OpenGL buffers.
+ ***********************************************************/
+void PrimitiveMeshes::Destroy()
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		GPU_MESH& mesh = m_meshes[i];
+		if (0 != mesh.vertexArrayID)
+		{
+			glDeleteVertexArrays(1, &mesh.vertexArrayID);
+		}
+		if (0 != mesh.vertexBufferID)
+		{
+			glDeleteBuffers(1, &mesh.vertexBufferID);
+			MemoryTracker::ReleaseBuffer(mesh.vertexBufferID);
+		}
+		if (0 != mesh.indexBufferID)
+		{
+			glDeleteBuffers(1, &mesh.indexBufferID);
+			MemoryTracker::ReleaseBuffer(mesh.indexBufferID);
+		}
+	}
+	m_meshes.clear();
+	m_stats.clear();
+	m_names.clear();
+}
+
+/***********************************************************
+ *  DrawMesh()
+ *
+ *  This method is used for drawing one of the meshes.  With
+ *  several views the mesh is drawn as one instance per view.
+ ***********************************************************/
+void PrimitiveMeshes::DrawMesh(int meshType, int viewCount) const
+{
+	if ((meshType < 0) || (meshType >= (int)m_meshes.size()) || (0 == m_meshes[meshType].vertexArrayID))
+	{
+		return;
+	}
+
+	const GPU_MESH& mesh = m_meshes[meshType];
+	glBindVertexArray(mesh.vertexArrayID);
+	if (viewCount > 1)
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, mesh.indexCount, mesh.indexType, NULL, viewCount);
+	}
+	else
+	{
+		glDrawElements(GL_TRIANGLES, mesh.indexCount, mesh.indexType, NULL);
+	}
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the vertex cache miss
+ *  ratio and the vertex size of every mesh.
+ ***********************************************************/
+void PrimitiveMeshes::PrintStats() const
+{
+	for (size_t i = 0; i < m_meshes.size(); i++)
+	{
+		const MESH_STATS& stats = m_stats[i];
+		std::cout << "INFO: Mesh " << std::left << std::setw(8) << m_names[i] << std::right
+			<< std::setw(5) << stats.vertexCount << " vertices, "
+			<< std::setw(5) << stats.triangleCount << " triangles, ACMR "
+			<< std::fixed << std::setprecision(3) << stats.acmrBefore << " -> " << stats.acmrAfter
+			<< std::defaultfloat << ", " << stats.bytesPerVertex << " bytes per vertex, "
+			<< stats.bytesPerIndex << " bytes per index" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  GetMeshCount()
+ *
+ *  This method is used for getting the number of meshes,
+ *  basic and imported.
+ ***********************************************************/
+int PrimitiveMeshes::GetMeshCount() const
+{
+	return((int)m_meshes.size());
+}
+
+/***********************************************************
+ *  GetMeshName()
+ *
+ *  This method is used for getting the name a mesh was added
+ *  with, or an empty string for a mesh type that is unknown.
+ ***********************************************************/
+const char* PrimitiveMeshes::GetMeshName(int meshType) const
+{
+	if ((meshType < 0) || (meshType >= (int)m_names.size()))
+	{
+		return("");
+	}
+
+	return(m_names[meshType].c_str());
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the figures of one mesh.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_STATS& PrimitiveMeshes::GetStats(int meshType) const
+{
+	return(m_stats[meshType]);
+}
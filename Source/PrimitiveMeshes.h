@@ -0,0 +1,107 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.h
+// ============
+// upload the basic shapes and imported meshes with cache-optimized index
+// buffers, optionally in a compact vertex layout, and draw them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+#include "ShapeGeometry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  PrimitiveMeshes
+ *
+ *  This class draws the basic shapes from ShapeGeometry, so
+ *  they share their triangles with the static batches.  Every
+ *  shape is reordered for the post-transform vertex cache and
+ *  for vertex fetch before it is uploaded, and uses 16-bit
+ *  indices when it can.  The compact layout packs a vertex
+ *  into 16 bytes instead of 32: snorm16 positions, since the
+ *  shapes fit in -1 to 1, 2_10_10_10 normals and half-float
+ *  texture coordinates.  The attributes are normalized by
+ *  OpenGL, so the shaders read both layouts the same way.
+ *  Imported meshes are added after the basic shapes, and
+ *  their mesh types follow on from MESH_TYPE_COUNT.
+ ***********************************************************/
+class PrimitiveMeshes
+{
+public:
+	// constructor
+	PrimitiveMeshes();
+	// destructor
+	~PrimitiveMeshes();
+
+	// packed vertex layout, 16 bytes
+	struct COMPACT_VERTEX
+	{
+		// snorm16 x, y, z, the fourth value pads to 8 bytes
+		int16_t position[4];
+		// snorm 2_10_10_10 with x in the lowest bits
+		uint32_t normal;
+		// half-float u, v
+		uint16_t textureCoordinate[2];
+	};
+
+	struct MESH_STATS
+	{
+		int vertexCount;
+		int triangleCount;
+		// average cache misses per triangle, as built and as drawn
+		float acmrBefore;
+		float acmrAfter;
+		int bytesPerVertex;
+		int bytesPerIndex;
+	};
+
+private:
+	struct GPU_MESH
+	{
+		GLuint vertexArrayID;
+		GLuint vertexBufferID;
+		GLuint indexBufferID;
+		GLsizei indexCount;
+		GLenum indexType;
+	};
+
+	std::vector<GPU_MESH> m_meshes;
+	std::vector<MESH_STATS> m_stats;
+	std::vector<std::string> m_names;
+	bool m_bCompactVertices;
+
+	// upload one optimized shape in the requested layout
+	bool CreateMesh(const SHAPE_GEOMETRY& geometry, bool bCompact, GPU_MESH& mesh, MESH_STATS& stats);
+	// optimize, upload and register a mesh
+	int RegisterMesh(SHAPE_GEOMETRY& geometry, const char* name);
+
+public:
+	// build, optimize and upload every basic shape
+	bool Load(bool bCompactVertices);
+	// optimize and upload an imported mesh in place, and return
+	// its mesh type, or -1 when it cannot be created
+	int AddMesh(SHAPE_GEOMETRY& geometry, const char* name);
+	// free the OpenGL buffers
+	void Destroy();
+	// draw one of the meshes, once per view of the frame
+	void DrawMesh(int meshType, int viewCount = 1) const;
+	// print the cache and size figures of every mesh
+	void PrintStats() const;
+
+	int GetMeshCount() const;
+	// name a mesh was added with
+	const char* GetMeshName(int meshType) const;
+	const MESH_STATS& GetStats(int meshType) const;
+
+	// conversions used by the compact layout
+	static uint16_t FloatToHalf(float value);
+	static int16_t PackSnorm16(float value);
+	static uint32_t PackNormal(const glm::vec3& normal);
+};
@@ -0,0 +1,209 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercounters.cpp
+// ============
+// count the work of every drawn frame - draw calls, triangles, state changes
+// and uploads - with a rolling history and a CSV log
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderCounters.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// column names of the CSV log and of the statistics report
+	const char* g_CounterNames[RenderCounters::COUNTER_COUNT] = {
+		"drawCalls",
+		"triangles",
+		"textureBinds",
+		"materialSwitches",
+		"uniformUploads",
+		"bufferBytes",
+		"objectsCulled"
+	};
+}
+
+/***********************************************************
+ *  RenderCounters()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderCounters::RenderCounters()
+{
+	memset(m_current, 0, sizeof(m_current));
+	memset(m_reportTotals, 0, sizeof(m_reportTotals));
+	m_history.resize(HISTORY_LENGTH);
+	m_historyNext = 0;
+	m_historyCount = 0;
+	m_reportFrames = 0;
+}
+
+/***********************************************************
+ *  ~RenderCounters()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderCounters::~RenderCounters()
+{
+	CloseCsv();
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for finishing the counts of a frame.
+ *  They replace the oldest frame of the history, are added to
+ *  the totals of the report and are written to the CSV log,
+ *  and the counters start again from zero.
+ ***********************************************************/
+void RenderCounters::EndFrame(uint64_t frameIndex)
+{
+	FRAME_COUNTERS& frame = m_history[m_historyNext];
+	frame.frameIndex = frameIndex;
+	memcpy(frame.values, m_current, sizeof(m_current));
+	m_historyNext = (m_historyNext + 1) % HISTORY_LENGTH;
+	m_historyCount = std::min(m_historyCount + 1, (int)HISTORY_LENGTH);
+
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		m_reportTotals[i] += m_current[i];
+	}
+	m_reportFrames++;
+
+	if (m_csvFile.is_open())
+	{
+		m_csvFile << frameIndex;
+		for (int i = 0; i < COUNTER_COUNT; i++)
+		{
+			m_csvFile << ',' << m_current[i];
+		}
+		m_csvFile << '\n';
+	}
+
+	memset(m_current, 0, sizeof(m_current));
+}
+
+/***********************************************************
+ *  OpenCsv()
+ *
+ *  This method is used for starting the CSV log, with a
+ *  header line naming the columns.  Every frame that ends
+ *  afterwards adds a line with its index and counts.
+ ***********************************************************/
+bool RenderCounters::OpenCsv(const char* filename)
+{
+	CloseCsv();
+
+	m_csvFile.open(filename, std::ios::out | std::ios::trunc);
+	if (!m_csvFile)
+	{
+		std::cout << "ERROR: Could not open the counter log " << filename << std::endl;
+		return(false);
+	}
+
+	m_csvFile << "frame";
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		m_csvFile << ',' << g_CounterNames[i];
+	}
+	m_csvFile << '\n';
+
+	std::cout << "INFO: Writing the render counters of every frame to " << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  CloseCsv()
+ *
+ *  This method is used for finishing the CSV log.
+ ***********************************************************/
+void RenderCounters::CloseCsv()
+{
+	if (m_csvFile.is_open())
+	{
+		m_csvFile.close();
+	}
+}
+
+/***********************************************************
+ *  GetHistoryCount()
+ *
+ *  This method is used for getting the number of finished
+ *  frames in the history.
+ ***********************************************************/
+int RenderCounters::GetHistoryCount() const
+{
+	return(m_historyCount);
+}
+
+/***********************************************************
+ *  GetHistoryFrame()
+ *
+ *  This method is used for getting a finished frame of the
+ *  history, counting from the oldest.
+ ***********************************************************/
+const RenderCounters::FRAME_COUNTERS& RenderCounters::GetHistoryFrame(int index) const
+{
+	int oldest = (m_historyCount < HISTORY_LENGTH) ? 0 : m_historyNext;
+	return(m_history[(oldest + index) % HISTORY_LENGTH]);
+}
+
+/***********************************************************
+ *  GetHistoryMax()
+ *
+ *  This method is used for getting the largest count of a
+ *  counter over the frames of the history.
+ ***********************************************************/
+uint64_t RenderCounters::GetHistoryMax(Counter counter) const
+{
+	uint64_t maxValue = 0;
+	for (int i = 0; i < m_historyCount; i++)
+	{
+		maxValue = std::max(maxValue, m_history[i].values[counter]);
+	}
+	return(maxValue);
+}
+
+/***********************************************************
+ *  GetCounterName()
+ *
+ *  This method is used for getting the name of a counter, as
+ *  it is written to the CSV log.
+ ***********************************************************/
+const char* RenderCounters::GetCounterName(Counter counter)
+{
+	if ((counter < 0) || (counter >= COUNTER_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_CounterNames[counter]);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the average counts of a
+ *  frame since the last report, and restarting the totals.
+ ***********************************************************/
+void RenderCounters::PrintStats()
+{
+	if (m_reportFrames == 0)
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(1) << "COUNTERS: per frame";
+	for (int i = 0; i < COUNTER_COUNT; i++)
+	{
+		std::cout << ", " << g_CounterNames[i] << " " << ((double)m_reportTotals[i] / m_reportFrames);
+	}
+	std::cout << std::defaultfloat << std::endl;
+
+	memset(m_reportTotals, 0, sizeof(m_reportTotals));
+	m_reportFrames = 0;
+}
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendercounters.h
+// ============
+// count the work of every drawn frame - draw calls, triangles, state changes
+// and uploads - with a rolling history and a CSV log
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/***********************************************************
+ *  RenderCounters
+ *
+ *  This class holds the counters the draw path increments as
+ *  it submits a frame.  Adding to a counter is a single add
+ *  to an array, so it can stay in the draw path of every
+ *  frame.  When the frame ends its counts move into a ring of
+ *  the most recent frames, for the overlay and the averages
+ *  of the statistics report, and into the CSV log when one is
+ *  open.  The counters belong to the thread that draws the
+ *  frames.
+ ***********************************************************/
+class RenderCounters
+{
+public:
+	// constructor
+	RenderCounters();
+	// destructor
+	~RenderCounters();
+
+	enum Counter {
+		COUNTER_DRAW_CALLS,
+		COUNTER_TRIANGLES,
+		COUNTER_TEXTURE_BINDS,
+		COUNTER_MATERIAL_SWITCHES,
+		COUNTER_UNIFORM_UPLOADS,
+		COUNTER_BUFFER_BYTES,
+		COUNTER_OBJECTS_CULLED,
+		COUNTER_COUNT
+	};// what is counted for every frame
+
+	// frames kept in the rolling history
+	static const int HISTORY_LENGTH = 240;
+
+	struct FRAME_COUNTERS
+	{
+		uint64_t frameIndex;
+		uint64_t values[COUNTER_COUNT];
+	};
+
+private:
+	// counts of the frame being drawn
+	uint64_t m_current[COUNTER_COUNT];
+	// ring of the finished frames, oldest at m_historyNext once full
+	std::vector<FRAME_COUNTERS> m_history;
+	int m_historyNext;
+	int m_historyCount;
+	// frames and their totals since the last report
+	uint64_t m_reportTotals[COUNTER_COUNT];
+	uint64_t m_reportFrames;
+	// log every finished frame is written to
+	std::ofstream m_csvFile;
+
+public:
+	// add to a counter of the frame being drawn
+	void Add(Counter counter, uint64_t amount = 1)
+	{
+		m_current[counter] += amount;
+	}
+	// count a draw call and the triangles it draws
+	void AddDraw(uint64_t triangleCount)
+	{
+		m_current[COUNTER_DRAW_CALLS]++;
+		m_current[COUNTER_TRIANGLES] += triangleCount;
+	}
+
+	// move the counts into the history and start the next frame
+	void EndFrame(uint64_t frameIndex);
+
+	// write every finished frame into a CSV file
+	bool OpenCsv(const char* filename);
+	void CloseCsv();
+
+	// finished frames in the history, 0 being the oldest
+	int GetHistoryCount() const;
+	const FRAME_COUNTERS& GetHistoryFrame(int index) const;
+	// largest count of a counter in the history
+	uint64_t GetHistoryMax(Counter counter) const;
+	static const char* GetCounterName(Counter counter);
+
+	// print the average counts per frame since the last report
+	void PrintStats();
+};
@@ -0,0 +1,256 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderfarm.cpp
+// ============
+// render the camera poses of a batch on several threads at once, each with
+// a software rasterizer of its own, and measure how the throughput scales
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderFarm.h"
+#include "ImageWriter.h"
+#include "SceneManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+}
+
+/***********************************************************
+ *  RenderFarm()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderFarm::RenderFarm(const SceneManager* pSceneManager, const BatchRenderer* pBatchRenderer)
+{
+	m_pSceneManager = pSceneManager;
+	m_pBatchRenderer = pBatchRenderer;
+	m_nextPose = 0;
+}
+
+/***********************************************************
+ *  ~RenderFarm()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderFarm::~RenderFarm()
+{
+	Destroy();
+	m_pSceneManager = NULL;
+	m_pBatchRenderer = NULL;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method is used for rendering every pose of the batch
+ *  with a number of farm threads.  Threads are kept from one
+ *  run to the next, and only the missing ones are created,
+ *  so a run with more threads reuses the earlier buffers.
+ ***********************************************************/
+bool RenderFarm::Run(int threadCount, const char* outputPrefix)
+{
+	const SoftwareRasterizer* pSource = m_pSceneManager->GetSoftwareRasterizer();
+	if ((NULL == pSource) || (threadCount < 1))
+	{
+		std::cout << "ERROR: The render farm needs the software renderer and at least one thread" << std::endl;
+		return(false);
+	}
+
+	m_outputPrefix = outputPrefix;
+	while ((int)m_threads.size() < threadCount)
+	{
+		FARM_THREAD* pThread = new FARM_THREAD();
+		pThread->pFarm = this;
+		pThread->pRasterizer = new SoftwareRasterizer(NULL);
+		pThread->pRasterizer->ShareAssets(*pSource);
+		pThread->pRenderQueue = m_pSceneManager->CreateRenderQueue();
+		m_threads.push_back(pThread);
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	m_nextPose = 0;
+	for (int i = 0; i < threadCount; i++)
+	{
+		FARM_THREAD* pThread = m_threads[i];
+		pThread->imagesRendered = 0;
+		pThread->imagesWritten = 0;
+		pThread->renderMs = 0.0;
+		pThread->encodeMs = 0.0;
+		pThread->bytesWritten = 0;
+		pThread->thread = std::thread(ThreadMain, pThread);
+	}
+
+	FARM_STATS stats = {};
+	stats.threadCount = threadCount;
+	stats.minThreadImages = INT_MAX;
+	for (int i = 0; i < threadCount; i++)
+	{
+		FARM_THREAD* pThread = m_threads[i];
+		pThread->thread.join();
+
+		stats.imagesRendered += pThread->imagesRendered;
+		stats.imagesWritten += pThread->imagesWritten;
+		stats.renderMs += pThread->renderMs;
+		stats.encodeMs += pThread->encodeMs;
+		stats.bytesWritten += pThread->bytesWritten;
+		stats.minThreadImages = std::min(stats.minThreadImages, pThread->imagesRendered);
+		stats.maxThreadImages = std::max(stats.maxThreadImages, pThread->imagesRendered);
+	}
+	stats.totalSeconds = ElapsedMs(startTime, std::chrono::steady_clock::now()) / 1000.0;
+	stats.imagesPerSecond = (stats.totalSeconds > 0.0) ? (stats.imagesWritten / stats.totalSeconds) : 0.0;
+	m_runs.push_back(stats);
+
+	return(stats.imagesWritten == m_pBatchRenderer->GetPoseCount());
+}
+
+/***********************************************************
+ *  ThreadMain()
+ *
+ *  This method is used for drawing poses on a farm thread
+ *  until every pose is handed out.  A pose is recorded and
+ *  drawn like a frame of the batch renderer, then encoded and
+ *  written by the same thread.
+ ***********************************************************/
+void RenderFarm::ThreadMain(FARM_THREAD* pThread)
+{
+	RenderFarm* pFarm = pThread->pFarm;
+	int poseCount = pFarm->m_pBatchRenderer->GetPoseCount();
+
+	int pose = pFarm->m_nextPose.fetch_add(1);
+	while (pose < poseCount)
+	{
+		std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+		FRAME_SNAPSHOT& snapshot = pThread->snapshot;
+		pFarm->m_pBatchRenderer->SetCamera(pose, snapshot);
+		snapshot.frameIndex = (uint64_t)pose + 1;
+		snapshot.bPrintStats = false;
+		pFarm->m_pSceneManager->RecordView(*pThread->pRenderQueue, snapshot);
+		pFarm->m_pSceneManager->BuildRasterDraws(snapshot, pThread->draws);
+		pThread->pRasterizer->Render(
+			pThread->draws.empty() ? NULL : &pThread->draws[0],
+			(int)pThread->draws.size(),
+			snapshot);
+		pThread->imagesRendered++;
+
+		std::chrono::steady_clock::time_point renderedTime = std::chrono::steady_clock::now();
+
+		ImageWriter::EncodeTga(
+			(const unsigned char*)pThread->pRasterizer->GetColorBuffer(),
+			pThread->pRasterizer->GetWidth(),
+			pThread->pRasterizer->GetHeight(),
+			(size_t)pThread->pRasterizer->GetStride() * sizeof(uint32_t),
+			false,
+			true,
+			pThread->encoded);
+		if (ImageWriter::WriteFile(pFarm->GetImageFilename(pose).c_str(), pThread->encoded) == true)
+		{
+			pThread->imagesWritten++;
+			pThread->bytesWritten += pThread->encoded.size();
+		}
+
+		std::chrono::steady_clock::time_point writtenTime = std::chrono::steady_clock::now();
+		pThread->renderMs += ElapsedMs(startTime, renderedTime);
+		pThread->encodeMs += ElapsedMs(renderedTime, writtenTime);
+
+		pose = pFarm->m_nextPose.fetch_add(1);
+	}
+}
+
+/***********************************************************
+ *  GetImageFilename()
+ *
+ *  This method is used for getting the file name of the
+ *  image of a pose, named like those of the batch renderer.
+ ***********************************************************/
+std::string RenderFarm::GetImageFilename(int imageIndex) const
+{
+	char number[16];
+	snprintf(number, sizeof(number), "%05d", imageIndex);
+	return(m_outputPrefix + number + ".tga");
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the farm threads and their
+ *  rasterizers and render queues.
+ ***********************************************************/
+void RenderFarm::Destroy()
+{
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		FARM_THREAD* pThread = m_threads[i];
+		if (pThread->thread.joinable() == true)
+		{
+			pThread->thread.join();
+		}
+		delete pThread->pRasterizer;
+		delete pThread->pRenderQueue;
+		delete pThread;
+	}
+	m_threads.clear();
+}
+
+/***********************************************************
+ *  GetRuns()
+ *
+ *  This method is used for getting the statistics of every
+ *  run so far, in the order they ran.
+ ***********************************************************/
+const std::vector<RenderFarm::FARM_STATS>& RenderFarm::GetRuns() const
+{
+	return(m_runs);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the statistics of every
+ *  run to the console.  The scaling efficiency of a run is
+ *  its throughput over that of the first run on one thread
+ *  times its thread count.
+ ***********************************************************/
+void RenderFarm::PrintStats() const
+{
+	double singleImagesPerSecond = 0.0;
+	for (size_t i = 0; i < m_runs.size(); i++)
+	{
+		if (m_runs[i].threadCount == 1)
+		{
+			singleImagesPerSecond = m_runs[i].imagesPerSecond;
+			break;
+		}
+	}
+
+	for (size_t i = 0; i < m_runs.size(); i++)
+	{
+		const FARM_STATS& stats = m_runs[i];
+		std::cout << "FARM: " << stats.threadCount << " threads, "
+			<< stats.imagesWritten << " of " << stats.imagesRendered << " images"
+			<< " (" << m_pBatchRenderer->GetWidth() << "x" << m_pBatchRenderer->GetHeight() << ")"
+			<< " in " << stats.totalSeconds << " s"
+			<< ", " << stats.imagesPerSecond << " images/s";
+		if (singleImagesPerSecond > 0.0)
+		{
+			std::cout << ", " << (stats.imagesPerSecond / singleImagesPerSecond) << "x speedup"
+				<< ", efficiency " << (100.0 * stats.imagesPerSecond / (singleImagesPerSecond * stats.threadCount)) << "%";
+		}
+		std::cout << ", drawing " << stats.renderMs << " ms"
+			<< ", encoding " << stats.encodeMs << " ms"
+			<< ", " << stats.minThreadImages << "-" << stats.maxThreadImages << " images per thread"
+			<< ", " << (stats.bytesWritten / 1024) << " KB written"
+			<< std::endl;
+	}
+}
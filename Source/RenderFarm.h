@@ -0,0 +1,109 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderfarm.h
+// ============
+// render the camera poses of a batch on several threads at once, each with
+// a software rasterizer of its own, and measure how the throughput scales
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BatchRenderer.h"
+#include "FrameSnapshot.h"
+#include "SoftwareRasterizer.h"
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+#include <vector>
+
+class SceneManager;
+
+/***********************************************************
+ *  RenderFarm
+ *
+ *  This class renders the poses of a batch renderer with a
+ *  number of farm threads.  An OpenGL context can only be
+ *  current on one thread, so every farm thread draws with a
+ *  software rasterizer and records with a render queue of its
+ *  own.  The rasterizers share the shapes, materials and
+ *  texture mips of the scene manager's rasterizer, which are
+ *  not changed while the farm runs, so a thread only holds
+ *  its own color and depth buffers and draw lists.
+ *
+ *  The poses are handed out one at a time through an atomic
+ *  counter, so a thread that draws simple views takes more
+ *  of them.  Every image is encoded and written by the thread
+ *  that drew it.
+ *
+ *  Run() renders every pose with one thread count, and the
+ *  runs are kept so that the scaling efficiency of each run,
+ *  its throughput against that of a single thread times the
+ *  thread count, can be printed.
+ ***********************************************************/
+class RenderFarm
+{
+public:
+	// constructor
+	RenderFarm(const SceneManager* pSceneManager, const BatchRenderer* pBatchRenderer);
+	// destructor
+	~RenderFarm();
+
+	struct FARM_STATS
+	{
+		int threadCount;
+		int imagesRendered;
+		int imagesWritten;
+		double totalSeconds;
+		double imagesPerSecond;
+		// time the threads spent recording and drawing, and
+		// encoding and writing, added over the threads
+		double renderMs;
+		double encodeMs;
+		size_t bytesWritten;
+		// fewest and most images drawn by one thread
+		int minThreadImages;
+		int maxThreadImages;
+	};
+
+private:
+	// state of one farm thread
+	struct FARM_THREAD
+	{
+		RenderFarm* pFarm;
+		std::thread thread;
+		SoftwareRasterizer* pRasterizer;
+		RenderQueue* pRenderQueue;
+		FRAME_SNAPSHOT snapshot;
+		std::vector<SoftwareRasterizer::RASTER_DRAW> draws;
+		std::vector<unsigned char> encoded;
+		int imagesRendered;
+		int imagesWritten;
+		double renderMs;
+		double encodeMs;
+		size_t bytesWritten;
+	};
+
+	const SceneManager* m_pSceneManager;
+	const BatchRenderer* m_pBatchRenderer;
+	std::string m_outputPrefix;
+	std::vector<FARM_THREAD*> m_threads;
+	// index of the next pose to hand out
+	std::atomic<int> m_nextPose;
+	std::vector<FARM_STATS> m_runs;
+
+	// draw poses until every pose is handed out
+	static void ThreadMain(FARM_THREAD* pThread);
+	// file name of an image
+	std::string GetImageFilename(int imageIndex) const;
+
+public:
+	// render every pose with a number of threads, images are written
+	// to the prefix followed by the pose index
+	bool Run(int threadCount, const char* outputPrefix);
+	// free the farm threads
+	void Destroy();
+
+	const std::vector<FARM_STATS>& GetRuns() const;
+	void PrintStats() const;
+};
@@ -0,0 +1,648 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// record the scene objects into draw command packets on the job system -
+// transform composition, culling, detail selection and sort keys
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// declaration of global variables
+namespace
+{
+	// number of objects recorded by one job
+	const int g_RecordChunkSize = 256;
+	// by default skip objects whose projected radius is below this
+	// fraction of the viewport height
+	const float g_DefaultDetailThreshold = 0.0005f;
+	// starting size of the arena the sort entries come from, room
+	// for 4096 commands before it grows
+	const size_t g_SortArenaBytes = 4096 * 16;
+
+	// sort key layout, from the most to the least significant bits
+	const int g_KeyTextureShift = 56;
+	const int g_KeyMaterialShift = 48;
+	const int g_KeyMeshShift = 40;
+	const int g_KeyDepthShift = 24;
+	const uint64_t g_KeyObjectMask = (1ull << 24) - 1;
+
+	double ElapsedMs(
+		std::chrono::high_resolution_clock::time_point start,
+		std::chrono::high_resolution_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_cullViewCount = 0;
+	m_detailThreshold = g_DefaultDetailThreshold;
+	// the sort entries do not outlive the recording, so a single
+	// block serves every frame
+	m_pSortArena = new FrameArena(g_SortArenaBytes, 1);
+	memset(&m_stats, 0, sizeof(m_stats));
+
+	int bufferCount = 1;
+	if (NULL != m_pJobSystem)
+	{
+		bufferCount = std::max(1, m_pJobSystem->GetWorkerCount());
+	}
+	m_threadBuffers.resize(bufferCount);
+
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		m_meshBounds.push_back(GetMeshBounds(i));
+	}
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	m_pJobSystem = NULL;
+	if (NULL != m_pSortArena)
+	{
+		delete m_pSortArena;
+		m_pSortArena = NULL;
+	}
+}
+
+/***********************************************************
+ *  ComposeTransform()
+ *
+ *  This method is used for composing a model matrix from the
+ *  scale, rotation and position values.  The scale is applied
+ *  first, then the X, Y and Z rotations, then the position.
+ ***********************************************************/
+glm::mat4 RenderQueue::ComposeTransform(
+	const glm::vec3& scaleXYZ,
+	const glm::vec3& rotationDegrees,
+	const glm::vec3& positionXYZ)
+{
+	glm::mat4 scale = glm::scale(scaleXYZ);
+	glm::mat4 rotationX = glm::rotate(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	glm::mat4 rotationY = glm::rotate(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 rotationZ = glm::rotate(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
+	glm::mat4 translation = glm::translate(positionXYZ);
+
+	return(translation * rotationZ * rotationY * rotationX * scale);
+}
+
+/***********************************************************
+ *  ComposeWorldTransform()
+ *
+ *  This method is used for composing the world matrix of an
+ *  object, by walking up its chain of parents.  Each object
+ *  walks its own chain, so objects can be composed in any
+ *  order and on any thread.  A parent index that does not
+ *  point to an earlier object ends the chain.
+ ***********************************************************/
+glm::mat4 RenderQueue::ComposeWorldTransform(const SCENE_OBJECT* pObjects, int index)
+{
+	const SCENE_OBJECT& object = pObjects[index];
+	glm::mat4 world = ComposeTransform(object.scaleXYZ, object.rotationDegrees, object.positionXYZ);
+
+	int parent = object.parentIndex;
+	while ((parent >= 0) && (parent < index))
+	{
+		const SCENE_OBJECT& parentObject = pObjects[parent];
+		world = ComposeTransform(
+			parentObject.scaleXYZ,
+			parentObject.rotationDegrees,
+			parentObject.positionXYZ) * world;
+
+		index = parent;
+		parent = parentObject.parentIndex;
+	}
+
+	return(world);
+}
+
+/***********************************************************
+ *  ComposeNormalMatrix()
+ *
+ *  This method is used for composing the matrix that turns
+ *  the normals of an object into world space, the inverse
+ *  transpose of the model's upper 3x3.  It is built from the
+ *  cofactors, which are the inverse transpose scaled by the
+ *  determinant, so no division is needed and a flattened
+ *  model does not give infinities.  The shaders normalize
+ *  the normals, only the sign of the determinant is kept.
+ ***********************************************************/
+glm::mat3 RenderQueue::ComposeNormalMatrix(const glm::mat4& model)
+{
+	glm::vec3 column0 = glm::vec3(model[0]);
+	glm::vec3 column1 = glm::vec3(model[1]);
+	glm::vec3 column2 = glm::vec3(model[2]);
+
+	glm::vec3 cofactor0 = glm::cross(column1, column2);
+	float sign = (glm::dot(column0, cofactor0) < 0.0f) ? -1.0f : 1.0f;
+
+	glm::mat3 normalMatrix;
+	normalMatrix[0] = cofactor0 * sign;
+	normalMatrix[1] = glm::cross(column2, column0) * sign;
+	normalMatrix[2] = glm::cross(column0, column1) * sign;
+
+	return(normalMatrix);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the bounding sphere of a
+ *  basic mesh in its local space, as the center in xyz and
+ *  the radius in w.
+ ***********************************************************/
+glm::vec4 RenderQueue::GetMeshBounds(int meshType)
+{
+	switch (meshType)
+	{
+	case MESH_PLANE:
+		// spans -1 to 1 in x and z
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 1.4143f));
+	case MESH_BOX:
+		// unit cube centered on the origin
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 0.8661f));
+	case MESH_CYLINDER:
+		// unit radius, from 0 to 1 in y
+		return(glm::vec4(0.0f, 0.5f, 0.0f, 1.1181f));
+	default:
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+}
+
+/***********************************************************
+ *  SortEntryLess()
+ *
+ *  This method is used for ordering the sort entries by key.
+ ***********************************************************/
+bool RenderQueue::SortEntryLess(const SORT_ENTRY& left, const SORT_ENTRY& right)
+{
+	return(left.sortKey < right.sortKey);
+}
+
+/***********************************************************
+ *  ExtractFrustumPlanes()
+ *
+ *  This method is used for extracting the six view frustum
+ *  planes from the rows of the view projection matrix.  The
+ *  planes are normalized so that the distance of a point to
+ *  a plane can be compared against a sphere radius.
+ ***********************************************************/
+void RenderQueue::ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* pFrustumPlanes)
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(
+			viewProjection[0][i],
+			viewProjection[1][i],
+			viewProjection[2][i],
+			viewProjection[3][i]);
+	}
+
+	pFrustumPlanes[0] = rows[3] + rows[0];	// left
+	pFrustumPlanes[1] = rows[3] - rows[0];	// right
+	pFrustumPlanes[2] = rows[3] + rows[1];	// bottom
+	pFrustumPlanes[3] = rows[3] - rows[1];	// top
+	pFrustumPlanes[4] = rows[3] + rows[2];	// near
+	pFrustumPlanes[5] = rows[3] - rows[2];	// far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(pFrustumPlanes[i]));
+		if (length > 0.0f)
+		{
+			pFrustumPlanes[i] /= length;
+		}
+	}
+}
+
+/***********************************************************
+ *  RecordChunk()
+ *
+ *  This method is used for recording the objects in the range
+ *  [begin, end) into the passed in buffer.  Each object gets
+ *  its model matrix composed and its bounding sphere tested
+ *  against the frustum.  Objects that cover too little of the
+ *  screen to matter are skipped, and the rest get a sort key.
+ *  With several views an object is kept when it is large
+ *  enough in any view that sees it, and its depth is taken
+ *  from the first view.
+ *  The objects are numbered from indexBase, so the objects of
+ *  different lists keep apart in the keys.
+ ***********************************************************/
+void RenderQueue::RecordChunk(
+	const SCENE_OBJECT* pObjects,
+	int begin,
+	int end,
+	uint32_t indexBase,
+	THREAD_BUFFER& buffer)
+{
+	for (int i = begin; i < end; i++)
+	{
+		const SCENE_OBJECT& object = pObjects[i];
+
+		// static objects are drawn with their merged batch
+		if ((object.flags & SCENE_OBJECT_STATIC) != 0)
+		{
+			continue;
+		}
+
+		glm::mat4 model = ComposeWorldTransform(pObjects, i);
+
+		// bounding sphere in world space - the longest axis of the
+		// model matrix scales the radius, whatever the parents did
+		const glm::vec4& bounds = m_meshBounds[object.meshType];
+		glm::vec3 center = glm::vec3(model * glm::vec4(glm::vec3(bounds), 1.0f));
+		float axisScale = std::max(
+			glm::length(glm::vec3(model[0])),
+			std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+		float radius = bounds.w * axisScale;
+
+		bool bVisible = false;
+		bool bDetailed = false;
+		for (int view = 0; (view < m_cullViewCount) && (bDetailed == false); view++)
+		{
+			const CULL_VIEW& cullView = m_cullViews[view];
+			bool bInView = true;
+			for (int plane = 0; (plane < 6) && (bInView == true); plane++)
+			{
+				if (glm::dot(glm::vec3(cullView.frustumPlanes[plane]), center) + cullView.frustumPlanes[plane].w < -radius)
+				{
+					bInView = false;
+				}
+			}
+			if (bInView == false)
+			{
+				continue;
+			}
+			bVisible = true;
+
+			// projected radius as a fraction of the viewport height, an
+			// orthographic projection does not shrink with the distance
+			bDetailed = true;
+			float viewDistance = glm::length(center - cullView.cameraPosition);
+			if ((cullView.bOrthographic == true) || (viewDistance > radius))
+			{
+				float projectedRadius = radius * cullView.projectionScale;
+				if (cullView.bOrthographic == false)
+				{
+					projectedRadius /= viewDistance;
+				}
+				bDetailed = (projectedRadius >= m_detailThreshold);
+			}
+		}
+		if (bVisible == false)
+		{
+			buffer.frustumCulled++;
+			continue;
+		}
+		if (bDetailed == false)
+		{
+			buffer.detailCulled++;
+			continue;
+		}
+
+		float distance = glm::length(center - m_cullViews[0].cameraPosition);
+
+		// the upper bits of a positive float keep their ordering,
+		// which gives a coarse depth for front to back sorting
+		uint32_t distanceBits = 0;
+		memcpy(&distanceBits, &distance, sizeof(distanceBits));
+
+		RENDER_COMMAND command;
+		command.sortKey =
+			((uint64_t)((object.textureSlot + 1) & 0xFF) << g_KeyTextureShift) |
+			((uint64_t)((object.materialIndex + 1) & 0xFF) << g_KeyMaterialShift) |
+			((uint64_t)(object.meshType & 0xFF) << g_KeyMeshShift) |
+			((uint64_t)(distanceBits >> 16) << g_KeyDepthShift) |
+			((uint64_t)(indexBase + i) & g_KeyObjectMask);
+		command.model = model;
+		command.normalMatrix = ComposeNormalMatrix(model);
+		command.uvScale = object.uvScale;
+		command.meshType = object.meshType;
+		command.textureSlot = object.textureSlot;
+		command.materialIndex = object.materialIndex;
+		command.objectIndex = indexBase + (uint32_t)i;
+		buffer.commands.push_back(command);
+	}
+}
+
+/***********************************************************
+ *  RecordRanges()
+ *
+ *  This method is used for recording the objects in [begin,
+ *  end) of the passed in ranges, numbered as if the ranges
+ *  were one list.  A chunk that crosses the end of a range
+ *  carries on into the next.
+ ***********************************************************/
+void RenderQueue::RecordRanges(
+	const RECORD_RANGE* pRanges,
+	int rangeCount,
+	int begin,
+	int end,
+	THREAD_BUFFER& buffer)
+{
+	int rangeStart = 0;
+	for (int range = 0; (range < rangeCount) && (rangeStart < end); range++)
+	{
+		int rangeEnd = rangeStart + pRanges[range].objectCount;
+		int first = std::max(begin, rangeStart);
+		int last = std::min(end, rangeEnd);
+		if (first < last)
+		{
+			RecordChunk(
+				pRanges[range].pObjects,
+				first - rangeStart,
+				last - rangeStart,
+				(uint32_t)rangeStart,
+				buffer);
+		}
+		rangeStart = rangeEnd;
+	}
+}
+
+/***********************************************************
+ *  Record()
+ *
+ *  This method is used for recording the render commands of
+ *  the passed in objects.
+ ***********************************************************/
+void RenderQueue::Record(
+	const SCENE_OBJECT* pObjects,
+	int objectCount,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	RECORD_RANGE range;
+	range.pObjects = pObjects;
+	range.objectCount = objectCount;
+
+	Record(&range, 1, view, projection, cameraPosition);
+}
+
+/***********************************************************
+ *  Record()
+ *
+ *  This method is used for recording the render commands of
+ *  the objects of every passed in range.  The objects are
+ *  split into chunks recorded in parallel, every worker
+ *  appending to its own buffer so no locking is needed.  The
+ *  buffers are merged and sorted afterwards; the object index
+ *  in the low bits of the key makes the order independent of
+ *  which worker recorded which chunk.
+ ***********************************************************/
+void RenderQueue::Record(
+	const RECORD_RANGE* pRanges,
+	int rangeCount,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	RECORD_VIEW recordView;
+	recordView.view = view;
+	recordView.projection = projection;
+	recordView.cameraPosition = cameraPosition;
+
+	Record(pRanges, rangeCount, &recordView, 1);
+}
+
+/***********************************************************
+ *  Record()
+ *
+ *  This method is used for recording the render commands of
+ *  the objects of every passed in range for several views
+ *  that are drawn in the same pass.  Every object is recorded
+ *  once, whichever views it shows up in, so the cost of the
+ *  recording barely grows with the number of views.
+ ***********************************************************/
+void RenderQueue::Record(
+	const RECORD_RANGE* pRanges,
+	int rangeCount,
+	const RECORD_VIEW* pViews,
+	int viewCount)
+{
+	std::chrono::high_resolution_clock::time_point startTime =
+		std::chrono::high_resolution_clock::now();
+
+	m_cullViewCount = std::max(1, std::min(viewCount, (int)MAX_RECORD_VIEWS));
+	for (int i = 0; i < m_cullViewCount; i++)
+	{
+		const RECORD_VIEW& recordView = pViews[i];
+		CULL_VIEW& cullView = m_cullViews[i];
+		ExtractFrustumPlanes(recordView.projection * recordView.view, cullView.frustumPlanes);
+		// half of the projected height of one unit at distance one
+		cullView.projectionScale = 0.5f * recordView.projection[1][1];
+		cullView.bOrthographic = (recordView.projection[3][3] == 1.0f);
+		cullView.cameraPosition = recordView.cameraPosition;
+	}
+
+	for (size_t i = 0; i < m_threadBuffers.size(); i++)
+	{
+		m_threadBuffers[i].commands.clear();
+		m_threadBuffers[i].frustumCulled = 0;
+		m_threadBuffers[i].detailCulled = 0;
+	}
+
+	int objectCount = 0;
+	for (int i = 0; i < rangeCount; i++)
+	{
+		objectCount += pRanges[i].objectCount;
+	}
+
+	// chunks are only spread across the workers when the caller is
+	// one of them, since the buffers are indexed by worker
+	if ((NULL != m_pJobSystem) &&
+		(m_pJobSystem->GetCurrentWorkerIndex() >= 0) &&
+		(objectCount > g_RecordChunkSize))
+	{
+		auto recordChunk = [this, pRanges, rangeCount](int begin, int end)
+		{
+			int workerIndex = m_pJobSystem->GetCurrentWorkerIndex();
+			RecordRanges(pRanges, rangeCount, begin, end, m_threadBuffers[workerIndex]);
+		};
+		m_pJobSystem->ParallelFor(objectCount, g_RecordChunkSize, recordChunk);
+	}
+	else
+	{
+		RecordRanges(pRanges, rangeCount, 0, objectCount, m_threadBuffers[0]);
+	}
+
+	std::chrono::high_resolution_clock::time_point recordTime =
+		std::chrono::high_resolution_clock::now();
+
+	// gather the commands of all the buffers and sort them by key
+	size_t commandCount = 0;
+	for (size_t i = 0; i < m_threadBuffers.size(); i++)
+	{
+		commandCount += m_threadBuffers[i].commands.size();
+	}
+	m_pSortArena->BeginFrame();
+	SORT_ENTRY* pSortEntries = m_pSortArena->AllocateArray<SORT_ENTRY>(commandCount);
+
+	size_t entryCount = 0;
+	m_stats.objectsFrustumCulled = 0;
+	m_stats.objectsDetailCulled = 0;
+	for (size_t i = 0; i < m_threadBuffers.size(); i++)
+	{
+		const THREAD_BUFFER& buffer = m_threadBuffers[i];
+		for (size_t j = 0; j < buffer.commands.size(); j++)
+		{
+			SORT_ENTRY& entry = pSortEntries[entryCount++];
+			entry.sortKey = buffer.commands[j].sortKey;
+			entry.pCommand = &buffer.commands[j];
+		}
+		m_stats.objectsFrustumCulled += buffer.frustumCulled;
+		m_stats.objectsDetailCulled += buffer.detailCulled;
+	}
+	std::sort(pSortEntries, pSortEntries + entryCount, SortEntryLess);
+
+	m_commands.resize(entryCount);
+	for (size_t i = 0; i < entryCount; i++)
+	{
+		m_commands[i] = *pSortEntries[i].pCommand;
+	}
+
+	std::chrono::high_resolution_clock::time_point endTime =
+		std::chrono::high_resolution_clock::now();
+
+	m_stats.objectsRecorded = (int)m_commands.size();
+	m_stats.recordMs = ElapsedMs(startTime, recordTime);
+	m_stats.mergeMs = ElapsedMs(recordTime, endTime);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method is used for testing a world space box against
+ *  the frustums of the last recording, it is visible when any
+ *  of the views sees it.  For each plane only the corner
+ *  furthest along the plane normal needs testing.
+ ***********************************************************/
+bool RenderQueue::IsBoxVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const
+{
+	for (int view = 0; view < m_cullViewCount; view++)
+	{
+		bool bInView = true;
+		for (int plane = 0; (plane < 6) && (bInView == true); plane++)
+		{
+			const glm::vec4& frustumPlane = m_cullViews[view].frustumPlanes[plane];
+			glm::vec3 corner(
+				(frustumPlane.x > 0.0f) ? boundsMax.x : boundsMin.x,
+				(frustumPlane.y > 0.0f) ? boundsMax.y : boundsMin.y,
+				(frustumPlane.z > 0.0f) ? boundsMax.z : boundsMin.z);
+
+			if (glm::dot(glm::vec3(frustumPlane), corner) + frustumPlane.w < 0.0f)
+			{
+				bInView = false;
+			}
+		}
+		if (bInView == true)
+		{
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  SetMeshBounds()
+ *
+ *  This method is used for setting the bounding sphere of a
+ *  mesh type, which imported meshes need before the objects
+ *  using them are recorded.
+ ***********************************************************/
+void RenderQueue::SetMeshBounds(int meshType, const glm::vec4& bounds)
+{
+	if (meshType < 0)
+	{
+		return;
+	}
+
+	if (meshType >= (int)m_meshBounds.size())
+	{
+		m_meshBounds.resize(meshType + 1, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+	}
+	m_meshBounds[meshType] = bounds;
+}
+
+/***********************************************************
+ *  SetDetailThreshold()
+ *
+ *  This method is used for setting the projected radius, as
+ *  a fraction of the viewport height, below which objects are
+ *  not drawn.  Zero draws every object inside the frustum.
+ ***********************************************************/
+void RenderQueue::SetDetailThreshold(float threshold)
+{
+	m_detailThreshold = std::max(0.0f, threshold);
+}
+
+/***********************************************************
+ *  CopySettings()
+ *
+ *  This method is used for culling like another queue, with
+ *  its mesh bounds and detail threshold, so that queues on
+ *  different threads can record the same scene.
+ ***********************************************************/
+void RenderQueue::CopySettings(const RenderQueue& source)
+{
+	m_meshBounds = source.m_meshBounds;
+	m_detailThreshold = source.m_detailThreshold;
+}
+
+/***********************************************************
+ *  GetCommands()
+ *
+ *  This method is used for getting the sorted render commands
+ *  from the last recording.
+ ***********************************************************/
+const std::vector<RENDER_COMMAND>& RenderQueue::GetCommands() const
+{
+	return(m_commands);
+}
+
+/***********************************************************
+ *  TakeCommands()
+ *
+ *  This method is used for moving the sorted render commands
+ *  into the passed in list.  The lists are swapped, so the
+ *  previous contents of the passed in list become the buffer
+ *  of the next recording and no memory is reallocated.
+ ***********************************************************/
+void RenderQueue::TakeCommands(std::vector<RENDER_COMMAND>& commands)
+{
+	commands.swap(m_commands);
+	m_commands.clear();
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the statistics of the
+ *  last recording.
+ ***********************************************************/
+const RenderQueue::RECORD_STATS& RenderQueue::GetStats() const
+{
+	return(m_stats);
+}
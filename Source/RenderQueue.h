@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// record the scene objects into draw command packets on the job system -
+// transform composition, culling, detail selection and sort keys
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  RENDER_COMMAND
+ *
+ *  A GPU-agnostic packet holding everything needed to draw
+ *  one object.  Commands are sorted by their key, which
+ *  groups them by texture, material and mesh so that the
+ *  submitting thread changes as little state as possible.
+ ***********************************************************/
+struct RENDER_COMMAND
+{
+	uint64_t sortKey;
+	glm::mat4 model;
+	// turns the object's normals into world space
+	glm::mat3 normalMatrix;
+	glm::vec2 uvScale;
+	int meshType;
+	int textureSlot;
+	int materialIndex;
+	uint32_t objectIndex;
+};
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class turns the scene objects into render commands.
+ *  Static objects are skipped, they are drawn in batches.
+ *  The objects are split into chunks that the job system
+ *  records in parallel, each worker writing into its own
+ *  command buffer.  The buffers are then merged and sorted
+ *  for the GL thread to submit.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue(JobSystem* pJobSystem);
+	// destructor
+	~RenderQueue();
+
+	// a list of objects recorded together with the others, the
+	// objects of each range refer to their parents within it
+	struct RECORD_RANGE
+	{
+		const SCENE_OBJECT* pObjects;
+		int objectCount;
+	};
+
+	// a view the objects are culled against, the first view of a
+	// recording also gives the depth the commands are sorted by
+	struct RECORD_VIEW
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 cameraPosition;
+	};
+
+	// views a single recording can be culled against
+	static const int MAX_RECORD_VIEWS = 4;
+
+	struct RECORD_STATS
+	{
+		int objectsRecorded;
+		int objectsFrustumCulled;
+		int objectsDetailCulled;
+		double recordMs;
+		double mergeMs;
+	};
+
+private:
+	// per-worker command buffer, padded to keep the counters of
+	// different workers off the same cache line
+	struct THREAD_BUFFER
+	{
+		std::vector<RENDER_COMMAND> commands;
+		int frustumCulled;
+		int detailCulled;
+		char padding[64];
+	};
+
+	// entry of the array that is sorted when the buffers are merged
+	struct SORT_ENTRY
+	{
+		uint64_t sortKey;
+		const RENDER_COMMAND* pCommand;
+	};
+
+	// pointer to the job system that records the chunks
+	JobSystem* m_pJobSystem;
+	// command buffers written by the workers
+	std::vector<THREAD_BUFFER> m_threadBuffers;
+	// keys of the recorded commands, taken from the arena and
+	// only used while a recording merges its buffers
+	FrameArena* m_pSortArena;
+	// merged and sorted commands for submission
+	std::vector<RENDER_COMMAND> m_commands;
+	// statistics of the last recording
+	RECORD_STATS m_stats;
+
+	// view frustum planes and detail culling parameters of a view
+	struct CULL_VIEW
+	{
+		glm::vec4 frustumPlanes[6];
+		float projectionScale;
+		bool bOrthographic;
+		glm::vec3 cameraPosition;
+	};
+
+	// views of the last recording, an object is kept when any of
+	// them shows it
+	CULL_VIEW m_cullViews[MAX_RECORD_VIEWS];
+	int m_cullViewCount;
+	float m_detailThreshold;
+	// bounding sphere of every mesh type, the basic shapes first
+	std::vector<glm::vec4> m_meshBounds;
+
+	// record the objects in the range [begin, end) into a buffer,
+	// numbering them from indexBase
+	void RecordChunk(
+		const SCENE_OBJECT* pObjects,
+		int begin,
+		int end,
+		uint32_t indexBase,
+		THREAD_BUFFER& buffer);
+	// record the objects in [begin, end) of the ranges laid end to end
+	void RecordRanges(
+		const RECORD_RANGE* pRanges,
+		int rangeCount,
+		int begin,
+		int end,
+		THREAD_BUFFER& buffer);
+	// extract the frustum planes from a view projection matrix
+	static void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4* pFrustumPlanes);
+	// order the sort entries by key
+	static bool SortEntryLess(const SORT_ENTRY& left, const SORT_ENTRY& right);
+
+public:
+	// compose the model matrix from scale, rotation and position
+	static glm::mat4 ComposeTransform(
+		const glm::vec3& scaleXYZ,
+		const glm::vec3& rotationDegrees,
+		const glm::vec3& positionXYZ);
+	// compose the world matrix of an object through its parents
+	static glm::mat4 ComposeWorldTransform(const SCENE_OBJECT* pObjects, int index);
+	// matrix that turns normals like the model matrix turns surfaces
+	static glm::mat3 ComposeNormalMatrix(const glm::mat4& model);
+	// bounding sphere of a basic mesh in its local space
+	static glm::vec4 GetMeshBounds(int meshType);
+
+	// record and sort the commands for the passed in objects
+	void Record(
+		const SCENE_OBJECT* pObjects,
+		int objectCount,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// record and sort the commands for several lists of objects
+	void Record(
+		const RECORD_RANGE* pRanges,
+		int rangeCount,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// record and sort the commands for several lists of objects, as
+	// seen by several views at once
+	void Record(
+		const RECORD_RANGE* pRanges,
+		int rangeCount,
+		const RECORD_VIEW* pViews,
+		int viewCount);
+
+	// test a world space box against the frustums of the last recording
+	bool IsBoxVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) const;
+
+	// set the bounding sphere of an imported mesh type
+	void SetMeshBounds(int meshType, const glm::vec4& bounds);
+	// set the projected radius below which objects are skipped
+	void SetDetailThreshold(float threshold);
+	// take the mesh bounds and detail threshold of another queue
+	void CopySettings(const RenderQueue& source);
+
+	// sorted commands from the last recording
+	const std::vector<RENDER_COMMAND>& GetCommands() const;
+	// swap the sorted commands into the passed in list
+	void TakeCommands(std::vector<RENDER_COMMAND>& commands);
+	// statistics of the last recording
+	const RECORD_STATS& GetStats() const;
+};
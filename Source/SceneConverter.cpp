@@ -0,0 +1,567 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneconverter.cpp
+// ============
+// convert the human-editable text form of a scene into a binary scene file
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneConverter.h"
+#include "SceneFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	const char* g_MeshNames[MESH_TYPE_COUNT] = { "plane", "box", "cylinder", "sphere" };
+
+	// everything read from the text scene, in file form
+	struct SCENE_DATA : public SCENE_FILE_CONTENTS
+	{
+		// names used in the text, mapped to record indexes
+		std::unordered_map<std::string, int> textureTags;
+		std::unordered_map<std::string, int> materialTags;
+		std::unordered_map<std::string, int> meshTags;
+		std::unordered_map<std::string, int> objectNames;
+		std::unordered_map<std::string, int> batchGroups;
+	};
+
+	// one key=value pair of a record, a bare word has no value
+	struct PROPERTY
+	{
+		std::string key;
+		std::string value;
+	};
+
+	// read count comma separated floats
+	bool ParseFloats(const std::string& text, float* pValues, int count)
+	{
+		const char* pText = text.c_str();
+		for (int i = 0; i < count; i++)
+		{
+			char* pEnd = NULL;
+			pValues[i] = strtof(pText, &pEnd);
+			if (pEnd == pText)
+			{
+				return(false);
+			}
+
+			pText = pEnd;
+			if (i + 1 < count)
+			{
+				if (*pText != ',')
+				{
+					return(false);
+				}
+				pText++;
+			}
+		}
+
+		return(*pText == '\0');
+	}
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return((offset + SCENE_FILE_ALIGNMENT - 1) & ~(uint64_t)(SCENE_FILE_ALIGNMENT - 1));
+	}
+
+	// write a section at its offset, padding up to it with zeros
+	void WriteSection(std::ofstream& file, uint64_t& position, uint64_t offset, const void* pData, size_t size)
+	{
+		static const char padding[SCENE_FILE_ALIGNMENT] = { 0 };
+		file.write(padding, (std::streamsize)(offset - position));
+		if (size > 0)
+		{
+			file.write((const char*)pData, (std::streamsize)size);
+		}
+		position = offset + size;
+	}
+
+	/***********************************************************
+	 *  ParseRecord()
+	 *
+	 *  read the properties of one line into a scene record
+	 ***********************************************************/
+	bool ParseRecord(
+		SCENE_DATA& scene,
+		const std::string& keyword,
+		const std::string& name,
+		const std::vector<PROPERTY>& properties,
+		std::string& error)
+	{
+		if (keyword == "material")
+		{
+			SCENE_FILE_MATERIAL material;
+			memset(&material, 0, sizeof(material));
+			material.tagOffset = SceneConverter::AddString(scene, name);
+
+			for (size_t i = 0; i < properties.size(); i++)
+			{
+				const PROPERTY& property = properties[i];
+				bool bParsed = false;
+				if (property.key == "diffuse")
+				{
+					bParsed = ParseFloats(property.value, material.diffuseColor, 3);
+				}
+				else if (property.key == "specular")
+				{
+					bParsed = ParseFloats(property.value, material.specularColor, 3);
+				}
+				else if (property.key == "shininess")
+				{
+					bParsed = ParseFloats(property.value, &material.shininess, 1);
+				}
+				if (bParsed == false)
+				{
+					error = "bad material value " + property.key;
+					return(false);
+				}
+			}
+
+			scene.materialTags[name] = (int)scene.materials.size();
+			scene.materials.push_back(material);
+		}
+		else if ((keyword == "directional") || (keyword == "point") || (keyword == "spot"))
+		{
+			SCENE_FILE_LIGHT light;
+			memset(&light, 0, sizeof(light));
+			light.bActive = 1;
+			if (keyword == "directional")
+			{
+				light.type = SCENE_LIGHT_DIRECTIONAL;
+			}
+			else if (keyword == "point")
+			{
+				light.type = SCENE_LIGHT_POINT;
+			}
+			else
+			{
+				light.type = SCENE_LIGHT_SPOT;
+			}
+
+			for (size_t i = 0; i < properties.size(); i++)
+			{
+				const PROPERTY& property = properties[i];
+				bool bParsed = false;
+				float angle = 0.0f;
+				if ((property.key == "off") && (property.value.empty() == true))
+				{
+					light.bActive = 0;
+					bParsed = true;
+				}
+				else if (property.key == "position")
+				{
+					bParsed = ParseFloats(property.value, light.position, 3);
+				}
+				else if (property.key == "direction")
+				{
+					bParsed = ParseFloats(property.value, light.direction, 3);
+				}
+				else if (property.key == "ambient")
+				{
+					bParsed = ParseFloats(property.value, light.ambient, 3);
+				}
+				else if (property.key == "diffuse")
+				{
+					bParsed = ParseFloats(property.value, light.diffuse, 3);
+				}
+				else if (property.key == "specular")
+				{
+					bParsed = ParseFloats(property.value, light.specular, 3);
+				}
+				else if (property.key == "constant")
+				{
+					bParsed = ParseFloats(property.value, &light.constant, 1);
+				}
+				else if (property.key == "linear")
+				{
+					bParsed = ParseFloats(property.value, &light.linear, 1);
+				}
+				else if (property.key == "quadratic")
+				{
+					bParsed = ParseFloats(property.value, &light.quadratic, 1);
+				}
+				// the cone angles are stored as the cosines the shader compares
+				else if (property.key == "cutoff")
+				{
+					bParsed = ParseFloats(property.value, &angle, 1);
+					light.cutOff = cos(glm::radians(angle));
+				}
+				else if (property.key == "outer")
+				{
+					bParsed = ParseFloats(property.value, &angle, 1);
+					light.outerCutOff = cos(glm::radians(angle));
+				}
+				if (bParsed == false)
+				{
+					error = "bad light value " + property.key;
+					return(false);
+				}
+			}
+
+			scene.lights.push_back(light);
+		}
+		else if (keyword == "object")
+		{
+			SCENE_OBJECT object;
+			object.scaleXYZ = glm::vec3(1.0f);
+			object.rotationDegrees = glm::vec3(0.0f);
+			object.positionXYZ = glm::vec3(0.0f);
+			object.uvScale = glm::vec2(1.0f, 1.0f);
+			object.meshType = -1;
+			object.textureSlot = -1;
+			object.materialIndex = -1;
+			object.flags = 0;
+			object.batchGroup = -1;
+			object.parentIndex = -1;
+
+			for (size_t i = 0; i < properties.size(); i++)
+			{
+				const PROPERTY& property = properties[i];
+				bool bParsed = false;
+				if (property.key == "mesh")
+				{
+					for (int mesh = 0; mesh < MESH_TYPE_COUNT; mesh++)
+					{
+						if (property.value == g_MeshNames[mesh])
+						{
+							object.meshType = mesh;
+							bParsed = true;
+						}
+					}
+
+					// imported meshes follow the basic shapes
+					std::unordered_map<std::string, int>::const_iterator it = scene.meshTags.find(property.value);
+					if ((bParsed == false) && (it != scene.meshTags.end()))
+					{
+						object.meshType = MESH_TYPE_COUNT + it->second;
+						bParsed = true;
+					}
+				}
+				else if (property.key == "scale")
+				{
+					bParsed = ParseFloats(property.value, &object.scaleXYZ.x, 3);
+				}
+				else if (property.key == "rotation")
+				{
+					bParsed = ParseFloats(property.value, &object.rotationDegrees.x, 3);
+				}
+				else if (property.key == "position")
+				{
+					bParsed = ParseFloats(property.value, &object.positionXYZ.x, 3);
+				}
+				else if (property.key == "uv")
+				{
+					bParsed = ParseFloats(property.value, &object.uvScale.x, 2);
+				}
+				else if (property.key == "texture")
+				{
+					std::unordered_map<std::string, int>::const_iterator it = scene.textureTags.find(property.value);
+					if (it != scene.textureTags.end())
+					{
+						object.textureSlot = it->second;
+						bParsed = true;
+					}
+				}
+				else if (property.key == "material")
+				{
+					std::unordered_map<std::string, int>::const_iterator it = scene.materialTags.find(property.value);
+					if (it != scene.materialTags.end())
+					{
+						object.materialIndex = it->second;
+						bParsed = true;
+					}
+				}
+				else if (property.key == "parent")
+				{
+					std::unordered_map<std::string, int>::const_iterator it = scene.objectNames.find(property.value);
+					if (it != scene.objectNames.end())
+					{
+						object.parentIndex = it->second;
+						bParsed = true;
+					}
+				}
+				else if ((property.key == "static") && (property.value.empty() == false))
+				{
+					std::unordered_map<std::string, int>::const_iterator it = scene.batchGroups.find(property.value);
+					if (it == scene.batchGroups.end())
+					{
+						int group = (int)scene.batchGroups.size();
+						it = scene.batchGroups.insert(std::make_pair(property.value, group)).first;
+					}
+					object.batchGroup = it->second;
+					object.flags |= SCENE_OBJECT_STATIC;
+					bParsed = true;
+				}
+				if (bParsed == false)
+				{
+					error = "bad or unknown object value " + property.key + "=" + property.value;
+					return(false);
+				}
+			}
+
+			if (object.meshType < 0)
+			{
+				error = "object has no mesh";
+				return(false);
+			}
+
+			// unnamed objects cannot be parents
+			if (name != "-")
+			{
+				scene.objectNames[name] = (int)scene.objects.size();
+			}
+			scene.objects.push_back(object);
+		}
+		else
+		{
+			error = "unknown keyword " + keyword;
+			return(false);
+		}
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  ReadTextScene()
+	 *
+	 *  read a text scene line by line
+	 ***********************************************************/
+	bool ReadTextScene(const char* filename, SCENE_DATA& scene)
+	{
+		std::ifstream file(filename);
+		if (!file)
+		{
+			std::cout << "ERROR: Could not open scene text:" << filename << std::endl;
+			return(false);
+		}
+
+		// offset 0 is the empty string
+		scene.flags = SCENE_FILE_USE_LIGHTING;
+		SceneConverter::AddString(scene, "");
+
+		std::string line;
+		int lineNumber = 0;
+		std::vector<PROPERTY> properties;
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+			size_t comment = line.find('#');
+			if (comment != std::string::npos)
+			{
+				line.erase(comment);
+			}
+
+			std::istringstream tokens(line);
+			std::string keyword;
+			if (!(tokens >> keyword))
+			{
+				continue;
+			}
+
+			std::string error;
+			if (keyword == "lighting")
+			{
+				std::string value;
+				tokens >> value;
+				if (value == "on")
+				{
+					scene.flags |= SCENE_FILE_USE_LIGHTING;
+				}
+				else if (value == "off")
+				{
+					scene.flags &= ~SCENE_FILE_USE_LIGHTING;
+				}
+				else
+				{
+					error = "expected lighting on or off";
+				}
+			}
+			else if (keyword == "texture")
+			{
+				std::string tag;
+				std::string textureFilename;
+				if (!(tokens >> tag >> textureFilename))
+				{
+					error = "expected texture TAG FILENAME";
+				}
+				else
+				{
+					SCENE_FILE_TEXTURE texture;
+					texture.tagOffset = SceneConverter::AddString(scene, tag);
+					texture.filenameOffset = SceneConverter::AddString(scene, textureFilename);
+					scene.textureTags[tag] = (int)scene.textures.size();
+					scene.textures.push_back(texture);
+				}
+			}
+			else if (keyword == "mesh")
+			{
+				std::string tag;
+				std::string meshFilename;
+				if (!(tokens >> tag >> meshFilename))
+				{
+					error = "expected mesh TAG FILENAME";
+				}
+				else
+				{
+					SCENE_FILE_MESH mesh;
+					mesh.tagOffset = SceneConverter::AddString(scene, tag);
+					mesh.filenameOffset = SceneConverter::AddString(scene, meshFilename);
+					scene.meshTags[tag] = (int)scene.meshes.size();
+					scene.meshes.push_back(mesh);
+				}
+			}
+			else
+			{
+				// materials and objects are named, lights are not
+				std::string name;
+				bool bNamed = (keyword == "material") || (keyword == "object");
+				if ((bNamed == true) && !(tokens >> name))
+				{
+					error = "expected a name after " + keyword;
+				}
+				else
+				{
+					properties.clear();
+					std::string token;
+					while (tokens >> token)
+					{
+						PROPERTY property;
+						size_t equals = token.find('=');
+						property.key = token.substr(0, equals);
+						if (equals != std::string::npos)
+						{
+							property.value = token.substr(equals + 1);
+						}
+						properties.push_back(property);
+					}
+
+					ParseRecord(scene, keyword, name, properties, error);
+				}
+			}
+
+			if (error.empty() == false)
+			{
+				std::cout << "ERROR: " << filename << ":" << lineNumber << ": " << error << std::endl;
+				return(false);
+			}
+		}
+
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  ConvertTextScene()
+ *
+ *  This method is used for converting a text scene into a
+ *  binary scene file.
+ ***********************************************************/
+bool SceneConverter::ConvertTextScene(const char* textFilename, const char* binaryFilename)
+{
+	SCENE_DATA scene;
+	if (ReadTextScene(textFilename, scene) == false)
+	{
+		return(false);
+	}
+
+	if (WriteSceneFile(binaryFilename, scene) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "INFO: Converted " << textFilename << " into " << binaryFilename << ": "
+		<< scene.textures.size() << " textures, "
+		<< scene.materials.size() << " materials, "
+		<< scene.lights.size() << " lights, "
+		<< scene.meshes.size() << " meshes, "
+		<< scene.objects.size() << " objects" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  AddString()
+ *
+ *  This method is used for adding a string to the string
+ *  section and returning its offset.
+ ***********************************************************/
+uint32_t SceneConverter::AddString(SCENE_FILE_CONTENTS& contents, const std::string& text)
+{
+	uint32_t offset = (uint32_t)contents.strings.size();
+	contents.strings.append(text);
+	contents.strings.push_back('\0');
+	return(offset);
+}
+
+/***********************************************************
+ *  WriteSceneFile()
+ *
+ *  This method is used for writing scene records as a binary
+ *  scene file.  The sections are laid out one after another,
+ *  each aligned, and written with the header in front.
+ ***********************************************************/
+bool SceneConverter::WriteSceneFile(const char* filename, const SCENE_FILE_CONTENTS& scene)
+{
+	SCENE_FILE_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.magic = SCENE_FILE_MAGIC;
+	header.version = SCENE_FILE_VERSION;
+	header.flags = scene.flags;
+	header.headerSize = sizeof(SCENE_FILE_HEADER);
+
+	uint64_t offset = AlignOffset(sizeof(SCENE_FILE_HEADER));
+	SCENE_FILE_SECTION* sections[] = {
+		&header.textures, &header.materials, &header.lights, &header.meshes, &header.objects, &header.strings };
+	const void* sectionData[] = {
+		scene.textures.data(), scene.materials.data(), scene.lights.data(),
+		scene.meshes.data(), scene.objects.data(), scene.strings.data() };
+	size_t sectionCounts[] = {
+		scene.textures.size(), scene.materials.size(), scene.lights.size(),
+		scene.meshes.size(), scene.objects.size(), scene.strings.size() };
+	size_t sectionStrides[] = {
+		sizeof(SCENE_FILE_TEXTURE), sizeof(SCENE_FILE_MATERIAL), sizeof(SCENE_FILE_LIGHT),
+		sizeof(SCENE_FILE_MESH), sizeof(SCENE_OBJECT), 1 };
+	const int sectionCount = sizeof(sections) / sizeof(sections[0]);
+
+	for (int i = 0; i < sectionCount; i++)
+	{
+		sections[i]->offset = offset;
+		sections[i]->count = (uint32_t)sectionCounts[i];
+		sections[i]->stride = (uint32_t)sectionStrides[i];
+		offset = AlignOffset(offset + (sectionCounts[i] * sectionStrides[i]));
+	}
+	header.fileSize = header.strings.offset + scene.strings.size();
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not create scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	uint64_t position = 0;
+	WriteSection(file, position, 0, &header, sizeof(header));
+	for (int i = 0; i < sectionCount; i++)
+	{
+		WriteSection(file, position, sections[i]->offset, sectionData[i], sectionCounts[i] * sectionStrides[i]);
+	}
+
+	file.close();
+	if (!file)
+	{
+		std::cout << "ERROR: Could not write scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneconverter.h
+// ============
+// convert the human-editable text form of a scene into a binary scene file
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneFile.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SCENE_FILE_CONTENTS
+ *
+ *  The records of a binary scene file, gathered in memory
+ *  before they are written.  Records refer to the strings by
+ *  their offset in the string section.
+ ***********************************************************/
+struct SCENE_FILE_CONTENTS
+{
+	uint32_t flags;
+	std::vector<SCENE_FILE_TEXTURE> textures;
+	std::vector<SCENE_FILE_MATERIAL> materials;
+	std::vector<SCENE_FILE_LIGHT> lights;
+	std::vector<SCENE_FILE_MESH> meshes;
+	std::vector<SCENE_OBJECT> objects;
+	std::string strings;
+};
+
+/***********************************************************
+ *  SceneConverter
+ *
+ *  This class reads a scene written as text, one record per
+ *  line, and writes it as a binary scene file.  Lines start
+ *  with a keyword, and values are given as key=value with
+ *  vectors written as x,y,z.  Anything after # is a comment.
+ *
+ *  lighting on|off
+ *  texture TAG FILENAME
+ *  mesh TAG FILENAME
+ *  material TAG diffuse=R,G,B specular=R,G,B shininess=S
+ *  directional direction= ambient= diffuse= specular= [off]
+ *  point position= ambient= diffuse= specular=
+ *        constant= linear= quadratic= [off]
+ *  spot position= direction= ambient= diffuse= specular=
+ *       constant= linear= quadratic= cutoff=DEGREES
+ *       outer=DEGREES [off]
+ *  object NAME mesh=plane|box|cylinder|sphere|TAG scale= rotation=
+ *         position= uv=U,V texture=TAG material=TAG
+ *         parent=NAME static=GROUP
+ *
+ *  Meshes are OBJ, glTF or GLB files, imported when the
+ *  scene is loaded.  Object values left out get the identity
+ *  transform and no texture, material or parent.  A parent
+ *  is named before its children, and objects nothing refers
+ *  to may be named -.  Objects with the same static group
+ *  are merged into one static batch.
+ ***********************************************************/
+class SceneConverter
+{
+public:
+	// convert a text scene into a binary scene file
+	static bool ConvertTextScene(const char* textFilename, const char* binaryFilename);
+	// add a string to the string section and return its offset
+	static uint32_t AddString(SCENE_FILE_CONTENTS& contents, const std::string& text);
+	// write scene records as a binary scene file
+	static bool WriteSceneFile(const char* binaryFilename, const SCENE_FILE_CONTENTS& contents);
+};
@@ -0,0 +1,437 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// binary scene file - textures, materials, lights and objects laid out so the
+// file is mapped into memory and used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pHeader = NULL;
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  CheckSection()
+ *
+ *  This method is used for checking that a section is aligned,
+ *  lies inside the file and holds records of the size this
+ *  code expects.
+ ***********************************************************/
+bool SceneFile::CheckSection(const SCENE_FILE_SECTION& section, size_t stride, const char* name) const
+{
+	if (section.stride != stride)
+	{
+		std::cout << "ERROR: Scene file " << name << " records are " << section.stride
+			<< " bytes, expected " << stride << std::endl;
+		return(false);
+	}
+
+	uint64_t size = (uint64_t)section.count * section.stride;
+	if (((section.offset % SCENE_FILE_ALIGNMENT) != 0) ||
+		(section.offset > m_file.GetSize()) ||
+		(size > m_file.GetSize() - section.offset))
+	{
+		std::cout << "ERROR: Scene file " << name << " section is out of bounds" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CheckRecords()
+ *
+ *  This method is used for checking every reference between
+ *  the records, once when the file is opened, so a damaged or
+ *  hand-edited file cannot send the renderer out of bounds.
+ *  Parents must come before their children, which also rules
+ *  out cycles.
+ ***********************************************************/
+bool SceneFile::CheckRecords() const
+{
+	uint32_t stringSize = m_pHeader->strings.count;
+	if ((stringSize == 0) || (GetString(0)[stringSize - 1] != '\0'))
+	{
+		std::cout << "ERROR: Scene file strings are not terminated" << std::endl;
+		return(false);
+	}
+
+	const SCENE_FILE_TEXTURE* pTextures = GetTextures();
+	for (int i = 0; i < GetTextureCount(); i++)
+	{
+		if ((pTextures[i].tagOffset >= stringSize) || (pTextures[i].filenameOffset >= stringSize))
+		{
+			std::cout << "ERROR: Scene file texture " << i << " has a bad string offset" << std::endl;
+			return(false);
+		}
+	}
+
+	const SCENE_FILE_MATERIAL* pMaterials = GetMaterials();
+	for (int i = 0; i < GetMaterialCount(); i++)
+	{
+		if (pMaterials[i].tagOffset >= stringSize)
+		{
+			std::cout << "ERROR: Scene file material " << i << " has a bad string offset" << std::endl;
+			return(false);
+		}
+	}
+
+	const SCENE_FILE_MESH* pMeshes = GetMeshes();
+	for (int i = 0; i < GetMeshCount(); i++)
+	{
+		if ((pMeshes[i].tagOffset >= stringSize) || (pMeshes[i].filenameOffset >= stringSize))
+		{
+			std::cout << "ERROR: Scene file mesh " << i << " has a bad string offset" << std::endl;
+			return(false);
+		}
+	}
+
+	const SCENE_OBJECT* pObjects = GetObjects();
+	int meshTypeCount = MESH_TYPE_COUNT + GetMeshCount();
+	int textureCount = GetTextureCount();
+	int materialCount = GetMaterialCount();
+	for (int i = 0; i < GetObjectCount(); i++)
+	{
+		const SCENE_OBJECT& object = pObjects[i];
+		if ((object.meshType < 0) || (object.meshType >= meshTypeCount) ||
+			(object.textureSlot < -1) || (object.textureSlot >= textureCount) ||
+			(object.materialIndex < -1) || (object.materialIndex >= materialCount) ||
+			(object.parentIndex < -1) || (object.parentIndex >= i))
+		{
+			std::cout << "ERROR: Scene file object " << i << " has a bad index" << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a scene file and checking
+ *  its header, sections and records.
+ ***********************************************************/
+bool SceneFile::Open(const char* filename)
+{
+	Close();
+
+	if (m_file.Open(filename) == false)
+	{
+		return(false);
+	}
+
+	bool bValid = true;
+	const SCENE_FILE_HEADER* pHeader = (const SCENE_FILE_HEADER*)m_file.GetData();
+	if ((m_file.GetSize() < sizeof(SCENE_FILE_HEADER)) || (pHeader->magic != SCENE_FILE_MAGIC))
+	{
+		std::cout << "ERROR: Not a scene file:" << filename << std::endl;
+		bValid = false;
+	}
+	else if ((pHeader->version != SCENE_FILE_VERSION) || (pHeader->headerSize != sizeof(SCENE_FILE_HEADER)))
+	{
+		std::cout << "ERROR: Scene file version " << pHeader->version << " is not supported:" << filename << std::endl;
+		bValid = false;
+	}
+	else if (pHeader->fileSize != m_file.GetSize())
+	{
+		std::cout << "ERROR: Scene file is truncated:" << filename << std::endl;
+		bValid = false;
+	}
+	else
+	{
+		m_pHeader = pHeader;
+		bValid =
+			CheckSection(pHeader->textures, sizeof(SCENE_FILE_TEXTURE), "texture") &&
+			CheckSection(pHeader->materials, sizeof(SCENE_FILE_MATERIAL), "material") &&
+			CheckSection(pHeader->lights, sizeof(SCENE_FILE_LIGHT), "light") &&
+			CheckSection(pHeader->meshes, sizeof(SCENE_FILE_MESH), "mesh") &&
+			CheckSection(pHeader->objects, sizeof(SCENE_OBJECT), "object") &&
+			CheckSection(pHeader->strings, 1, "string") &&
+			CheckRecords();
+	}
+
+	if (bValid == false)
+	{
+		Close();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for unmapping the scene file.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	m_pHeader = NULL;
+	m_file.Close();
+}
+
+/***********************************************************
+ *  IsOpen()
+ *
+ *  This method is used for checking whether a scene file is
+ *  mapped.
+ ***********************************************************/
+bool SceneFile::IsOpen() const
+{
+	return(NULL != m_pHeader);
+}
+
+/***********************************************************
+ *  GetFlags()
+ *
+ *  This method is used for getting the scene file flags.
+ ***********************************************************/
+uint32_t SceneFile::GetFlags() const
+{
+	return(m_pHeader->flags);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures.
+ ***********************************************************/
+int SceneFile::GetTextureCount() const
+{
+	return((int)m_pHeader->textures.count);
+}
+
+/***********************************************************
+ *  GetTextures()
+ *
+ *  This method is used for getting the texture records.
+ ***********************************************************/
+const SCENE_FILE_TEXTURE* SceneFile::GetTextures() const
+{
+	return((const SCENE_FILE_TEXTURE*)(m_file.GetData() + m_pHeader->textures.offset));
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials.
+ ***********************************************************/
+int SceneFile::GetMaterialCount() const
+{
+	return((int)m_pHeader->materials.count);
+}
+
+/***********************************************************
+ *  GetMaterials()
+ *
+ *  This method is used for getting the material records.
+ ***********************************************************/
+const SCENE_FILE_MATERIAL* SceneFile::GetMaterials() const
+{
+	return((const SCENE_FILE_MATERIAL*)(m_file.GetData() + m_pHeader->materials.offset));
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights.
+ ***********************************************************/
+int SceneFile::GetLightCount() const
+{
+	return((int)m_pHeader->lights.count);
+}
+
+/***********************************************************
+ *  GetLights()
+ *
+ *  This method is used for getting the light records.
+ ***********************************************************/
+const SCENE_FILE_LIGHT* SceneFile::GetLights() const
+{
+	return((const SCENE_FILE_LIGHT*)(m_file.GetData() + m_pHeader->lights.offset));
+}
+
+/***********************************************************
+ *  GetMeshCount()
+ *
+ *  This method is used for getting the number of imported
+ *  meshes.
+ ***********************************************************/
+int SceneFile::GetMeshCount() const
+{
+	return((int)m_pHeader->meshes.count);
+}
+
+/***********************************************************
+ *  GetMeshes()
+ *
+ *  This method is used for getting the mesh records, in the
+ *  order of their mesh types.
+ ***********************************************************/
+const SCENE_FILE_MESH* SceneFile::GetMeshes() const
+{
+	return((const SCENE_FILE_MESH*)(m_file.GetData() + m_pHeader->meshes.offset));
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects.
+ ***********************************************************/
+int SceneFile::GetObjectCount() const
+{
+	return((int)m_pHeader->objects.count);
+}
+
+/***********************************************************
+ *  GetObjects()
+ *
+ *  This method is used for getting the scene objects, which
+ *  point straight into the mapped file.
+ ***********************************************************/
+const SCENE_OBJECT* SceneFile::GetObjects() const
+{
+	return((const SCENE_OBJECT*)(m_file.GetData() + m_pHeader->objects.offset));
+}
+
+/***********************************************************
+ *  GetString()
+ *
+ *  This method is used for getting the string at an offset
+ *  of the string section.
+ ***********************************************************/
+const char* SceneFile::GetString(uint32_t offset) const
+{
+	return((const char*)(m_file.GetData() + m_pHeader->strings.offset + offset));
+}
+
+/***********************************************************
+ *  GetLightState()
+ *
+ *  This method is used for converting the light records into
+ *  the light state passed to the shader.  The first spot light
+ *  and the last directional light are used, and the point
+ *  lights fill the shader's slots in order.
+ ***********************************************************/
+void SceneFile::GetLightState(LIGHT_STATE& lights) const
+{
+	lights = LIGHT_STATE();
+	lights.bUseLighting = (GetFlags() & SCENE_FILE_USE_LIGHTING) != 0;
+
+	int pointLightCount = 0;
+	int unusedLights = 0;
+	bool bSpotLight = false;
+	const SCENE_FILE_LIGHT* pLights = GetLights();
+	for (int i = 0; i < GetLightCount(); i++)
+	{
+		const SCENE_FILE_LIGHT& light = pLights[i];
+		glm::vec3 position(light.position[0], light.position[1], light.position[2]);
+		glm::vec3 direction(light.direction[0], light.direction[1], light.direction[2]);
+		glm::vec3 ambient(light.ambient[0], light.ambient[1], light.ambient[2]);
+		glm::vec3 diffuse(light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+		glm::vec3 specular(light.specular[0], light.specular[1], light.specular[2]);
+		bool bActive = (light.bActive != 0);
+
+		if (light.type == SCENE_LIGHT_DIRECTIONAL)
+		{
+			lights.directionalLight.direction = direction;
+			lights.directionalLight.ambient = ambient;
+			lights.directionalLight.diffuse = diffuse;
+			lights.directionalLight.specular = specular;
+			lights.directionalLight.bActive = bActive;
+		}
+		else if ((light.type == SCENE_LIGHT_POINT) && (pointLightCount < MAX_POINT_LIGHTS))
+		{
+			POINT_LIGHT& pointLight = lights.pointLights[pointLightCount];
+			pointLight.position = position;
+			pointLight.ambient = ambient;
+			pointLight.diffuse = diffuse;
+			pointLight.specular = specular;
+			pointLight.constant = light.constant;
+			pointLight.linear = light.linear;
+			pointLight.quadratic = light.quadratic;
+			pointLight.bActive = bActive;
+			pointLightCount++;
+		}
+		else if ((light.type == SCENE_LIGHT_SPOT) && (bSpotLight == false))
+		{
+			lights.spotLight.position = position;
+			lights.spotLight.direction = direction;
+			lights.spotLight.ambient = ambient;
+			lights.spotLight.diffuse = diffuse;
+			lights.spotLight.specular = specular;
+			lights.spotLight.constant = light.constant;
+			lights.spotLight.linear = light.linear;
+			lights.spotLight.quadratic = light.quadratic;
+			lights.spotLight.cutOff = light.cutOff;
+			lights.spotLight.outerCutOff = light.outerCutOff;
+			lights.spotLight.bActive = bActive;
+			bSpotLight = true;
+		}
+		else
+		{
+			unusedLights++;
+		}
+	}
+
+	// scenes lit by many lamps have thousands of these, so they are
+	// reported together
+	if (unusedLights > 0)
+	{
+		std::cout << "INFO: " << unusedLights << " scene file light(s) do not fit in the shader's light slots" << std::endl;
+	}
+}
+
+/***********************************************************
+ *  GetPointLights()
+ *
+ *  This method is used for converting every active point
+ *  light record, so the lights nearest the camera can be
+ *  picked for the shader's slots as the camera moves.
+ ***********************************************************/
+void SceneFile::GetPointLights(std::vector<POINT_LIGHT>& pointLights) const
+{
+	pointLights.clear();
+
+	const SCENE_FILE_LIGHT* pLights = GetLights();
+	for (int i = 0; i < GetLightCount(); i++)
+	{
+		const SCENE_FILE_LIGHT& light = pLights[i];
+		if ((light.type != SCENE_LIGHT_POINT) || (light.bActive == 0))
+		{
+			continue;
+		}
+
+		POINT_LIGHT pointLight;
+		pointLight.position = glm::vec3(light.position[0], light.position[1], light.position[2]);
+		pointLight.ambient = glm::vec3(light.ambient[0], light.ambient[1], light.ambient[2]);
+		pointLight.diffuse = glm::vec3(light.diffuse[0], light.diffuse[1], light.diffuse[2]);
+		pointLight.specular = glm::vec3(light.specular[0], light.specular[1], light.specular[2]);
+		pointLight.constant = light.constant;
+		pointLight.linear = light.linear;
+		pointLight.quadratic = light.quadratic;
+		pointLight.bActive = true;
+		pointLights.push_back(pointLight);
+	}
+}
@@ -0,0 +1,162 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// binary scene file - textures, materials, lights and objects laid out so the
+// file is mapped into memory and used in place
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+#include "FrameSnapshot.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// "SCNB" read as a little-endian 32-bit value
+const uint32_t SCENE_FILE_MAGIC = 0x424E4353;
+const uint32_t SCENE_FILE_VERSION = 2;
+// every section starts on this alignment
+const uint32_t SCENE_FILE_ALIGNMENT = 16;
+
+// flags of a scene file
+enum SCENE_FILE_FLAGS
+{
+	// the shaders light the scene, instead of drawing flat colors
+	SCENE_FILE_USE_LIGHTING = 1
+};
+
+enum SCENE_LIGHT_TYPE
+{
+	SCENE_LIGHT_DIRECTIONAL,
+	SCENE_LIGHT_POINT,
+	SCENE_LIGHT_SPOT
+};
+
+// a table of fixed-size records in the file
+struct SCENE_FILE_SECTION
+{
+	uint64_t offset;
+	uint32_t count;
+	// size of one record, checked against the reader's structures
+	uint32_t stride;
+};
+
+struct SCENE_FILE_HEADER
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t flags;
+	uint32_t headerSize;
+	uint64_t fileSize;
+	SCENE_FILE_SECTION textures;
+	SCENE_FILE_SECTION materials;
+	SCENE_FILE_SECTION lights;
+	// imported mesh files, given the mesh types after the basic shapes
+	SCENE_FILE_SECTION meshes;
+	// SCENE_OBJECT records, used as they are
+	SCENE_FILE_SECTION objects;
+	// zero terminated strings, records refer to them by offset
+	SCENE_FILE_SECTION strings;
+};
+
+struct SCENE_FILE_TEXTURE
+{
+	uint32_t tagOffset;
+	uint32_t filenameOffset;
+};
+
+struct SCENE_FILE_MESH
+{
+	uint32_t tagOffset;
+	uint32_t filenameOffset;
+};
+
+struct SCENE_FILE_MATERIAL
+{
+	float diffuseColor[3];
+	float specularColor[3];
+	float shininess;
+	uint32_t tagOffset;
+};
+
+struct SCENE_FILE_LIGHT
+{
+	uint32_t type;
+	uint32_t bActive;
+	float position[3];
+	float direction[3];
+	float ambient[3];
+	float diffuse[3];
+	float specular[3];
+	float constant;
+	float linear;
+	float quadratic;
+	// cosines of the spot light cone angles
+	float cutOff;
+	float outerCutOff;
+};
+
+// the objects are stored as SCENE_OBJECT records, so its layout is
+// part of the file format and must not change without a new version
+static_assert(sizeof(SCENE_OBJECT) == 68, "SCENE_OBJECT layout is part of the scene file format");
+static_assert(offsetof(SCENE_OBJECT, uvScale) == 36, "SCENE_OBJECT layout is part of the scene file format");
+static_assert(offsetof(SCENE_OBJECT, parentIndex) == 64, "SCENE_OBJECT layout is part of the scene file format");
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class maps a binary scene file and hands out its
+ *  records in place.  Opening a file checks the header and
+ *  the section bounds, and checks every object's indexes, so
+ *  the rest of the code can trust them; nothing is copied or
+ *  allocated per object.  Files are little-endian, as the
+ *  converter writes them.  The records stay valid until the
+ *  file is closed.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+private:
+	MappedFile m_file;
+	const SCENE_FILE_HEADER* m_pHeader;
+
+	// check that a section lies inside the file with the expected stride
+	bool CheckSection(const SCENE_FILE_SECTION& section, size_t stride, const char* name) const;
+	// check the string offsets and the object indexes
+	bool CheckRecords() const;
+
+public:
+	// map a scene file and check it, closing any file opened before
+	bool Open(const char* filename);
+	void Close();
+	bool IsOpen() const;
+
+	uint32_t GetFlags() const;
+
+	int GetTextureCount() const;
+	const SCENE_FILE_TEXTURE* GetTextures() const;
+	int GetMaterialCount() const;
+	const SCENE_FILE_MATERIAL* GetMaterials() const;
+	int GetLightCount() const;
+	const SCENE_FILE_LIGHT* GetLights() const;
+	int GetMeshCount() const;
+	const SCENE_FILE_MESH* GetMeshes() const;
+	int GetObjectCount() const;
+	const SCENE_OBJECT* GetObjects() const;
+
+	// string at an offset of the string section
+	const char* GetString(uint32_t offset) const;
+	// light sources of the file in the form they are passed to the shader
+	void GetLightState(LIGHT_STATE& lights) const;
+	// every active point light of the file, more than the shader has
+	// slots for when a scene is lit by many lamps
+	void GetPointLights(std::vector<POINT_LIGHT>& pointLights) const;
+};
@@ -0,0 +1,435 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.cpp
+// ============
+// generate street scenes of any size as binary scene files, for measuring
+// how the renderer scales with the number of objects and lights
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGenerator.h"
+#include "SceneConverter.h"
+#include "RenderQueue.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// declaration of global variables
+namespace
+{
+	// one part of a composition, placed as in DefineSceneObjects()
+	struct PROP_PART
+	{
+		int meshType;
+		float scale[3];
+		float rotation[3];
+		float position[3];
+		// texture slot and base material of the part
+		int texture;
+		int material;
+	};
+
+	// textures of the built-in scene, in slot order
+	enum TEXTURE_SLOT
+	{
+		TEXTURE_STREET,
+		TEXTURE_BLACKMAT,
+		TEXTURE_WALL,
+		TEXTURE_LAMP,
+		TEXTURE_WOOD,
+		TEXTURE_COUNT
+	};
+	const char* g_TextureFiles[TEXTURE_COUNT][2] = {
+		{ "street", "textures/street.jpg" },
+		{ "bmat", "textures/blackmat.jpg" },
+		{ "wall", "textures/wall.jpg" },
+		{ "lamp", "textures/lamp.jpg" },
+		{ "wood", "textures/wood.jpg" }
+	};
+
+	// materials of the built-in scene, each written in a few variants
+	enum BASE_MATERIAL
+	{
+		MATERIAL_LAMP,
+		MATERIAL_BRICK,
+		MATERIAL_GROUND,
+		MATERIAL_WOOD,
+		MATERIAL_COUNT
+	};
+	struct BASE_MATERIAL_VALUES
+	{
+		const char* tag;
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+	};
+	const BASE_MATERIAL_VALUES g_Materials[MATERIAL_COUNT] = {
+		{ "Lamp", { 0.1f, 0.1f, 0.1f }, { 0.8f, 0.8f, 0.8f }, 64.0f },
+		{ "Brick", { 0.5f, 0.2f, 0.1f }, { 0.2f, 0.2f, 0.2f }, 16.0f },
+		{ "Ground", { 0.1f, 0.1f, 0.1f }, { 0.1f, 0.1f, 0.1f }, 8.0f },
+		{ "Wood", { 0.55f, 0.27f, 0.07f }, { 0.2f, 0.2f, 0.2f }, 32.0f }
+	};
+	// variants of every material, the first keeps the base values
+	const int g_MaterialVariants = 4;
+	// largest change of a variant's colors and shininess
+	const float g_MaterialVariation = 0.2f;
+
+	// the street floor and the wall behind it
+	const PROP_PART g_FloorPart = { MESH_PLANE, { 10.0f, -1.0f, 8.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, -0.1f, 4.0f }, TEXTURE_STREET, MATERIAL_GROUND };
+	const PROP_PART g_WallPart = { MESH_PLANE, { 10.0f, 2.0f, 6.0f }, { 90.0f, 0.0f, 0.0f }, { 0.0f, 5.8f, -4.0f }, TEXTURE_WALL, MATERIAL_BRICK };
+
+	// the street lamp, without the segments of its arm
+	const PROP_PART g_LampParts[] = {
+		{ MESH_SPHERE, { -0.5f, 0.5f, 0.5f }, { 0.0f, 0.0f, 0.0f }, { -0.6f, 5.5f, 0.0f }, TEXTURE_LAMP, MATERIAL_LAMP },
+		{ MESH_CYLINDER, { 0.6f, 0.3f, 0.6f }, { 0.0f, 90.0f, 0.0f }, { -3.0f, 0.15f, 0.0f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_CYLINDER, { 0.2f, 6.0f, 0.2f }, { 0.0f, 90.0f, 0.0f }, { -3.0f, 0.15f, 0.0f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_CYLINDER, { 0.3f, 0.3f, 0.3f }, { 0.0f, 90.0f, 0.0f }, { -3.0f, 5.0f, 0.0f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_CYLINDER, { 0.3f, 0.3f, 0.3f }, { 0.0f, 90.0f, 0.0f }, { -0.6f, 6.0f, 0.0f }, TEXTURE_BLACKMAT, MATERIAL_LAMP }
+	};
+	const int g_LampPartCount = sizeof(g_LampParts) / sizeof(g_LampParts[0]);
+	// the half circle arm, one cylinder per segment
+	const int g_ArmSegments = 50;
+	const float g_ArmRadius = 1.2f;
+	const glm::vec3 g_ArmCenter = glm::vec3(-1.7f, 6.1f, 0.0f);
+	// the lamp is turned about its base, and lit from just below its
+	// head, outside the sphere so shadow rays can leave the light
+	const glm::vec3 g_LampPivot = glm::vec3(-3.0f, 0.0f, 0.0f);
+	const glm::vec3 g_LampLightPosition = glm::vec3(-0.6f, 4.9f, 0.0f);
+
+	// the bench
+	const PROP_PART g_BenchParts[] = {
+		{ MESH_BOX, { 5.0f, 0.1f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 2.0f, 1.2f, 1.0f }, TEXTURE_WOOD, MATERIAL_WOOD },
+		{ MESH_BOX, { 5.0f, 0.1f, 0.2f }, { 45.0f, 0.0f, 0.0f }, { 2.0f, 1.4f, 0.77f }, TEXTURE_WOOD, MATERIAL_WOOD },
+		{ MESH_BOX, { 5.0f, 0.1f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 2.0f, 1.2f, 1.3f }, TEXTURE_WOOD, MATERIAL_WOOD },
+		{ MESH_BOX, { 5.0f, 0.1f, 0.2f }, { 0.0f, 0.0f, 0.0f }, { 2.0f, 1.2f, 1.6f }, TEXTURE_WOOD, MATERIAL_WOOD },
+		{ MESH_BOX, { 5.0f, 0.1f, 0.2f }, { 45.0f, 0.0f, 0.0f }, { 2.0f, 1.1f, 1.9f }, TEXTURE_WOOD, MATERIAL_WOOD },
+		{ MESH_BOX, { 0.1f, 1.0f, 0.1f }, { 90.0f, 0.0f, 0.0f }, { -0.3f, 1.1f, 1.4f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 1.2f, 0.1f }, { 180.0f, 0.0f, 0.0f }, { -0.3f, 0.5f, 1.7f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 1.4f, 0.1f }, { 30.0f, 0.0f, 0.0f }, { -0.3f, 0.5f, 0.8f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 1.0f, 0.1f }, { 90.0f, 0.0f, 0.0f }, { 4.3f, 1.1f, 1.4f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 1.2f, 0.1f }, { 180.0f, 0.0f, 0.0f }, { 4.3f, 0.5f, 1.7f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 1.4f, 0.1f }, { 30.0f, 0.0f, 0.0f }, { 4.3f, 0.5f, 0.8f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 0.7f, 0.1f }, { -40.0f, 0.0f, 0.0f }, { -0.3f, 1.2f, 0.8f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 0.7f, 0.1f }, { -40.0f, 0.0f, 0.0f }, { 4.3f, 1.2f, 0.8f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 0.8f, 0.1f }, { 175.0f, 0.0f, 0.0f }, { -0.3f, 1.8f, 0.57f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 0.1f, 0.8f, 0.1f }, { 175.0f, 0.0f, 0.0f }, { 4.3f, 1.8f, 0.57f }, TEXTURE_BLACKMAT, MATERIAL_LAMP },
+		{ MESH_BOX, { 5.0f, 0.1f, 0.9f }, { 85.0f, 0.0f, 0.0f }, { 2.0f, 2.2f, 0.64f }, TEXTURE_WOOD, MATERIAL_WOOD }
+	};
+	const int g_BenchPartCount = sizeof(g_BenchParts) / sizeof(g_BenchParts[0]);
+	// the bench is turned about its middle
+	const glm::vec3 g_BenchPivot = glm::vec3(2.0f, 0.0f, 1.2f);
+
+	// objects of a whole tile
+	const int g_TileObjectCount = 2 + g_LampPartCount + (g_ArmSegments + 1) + g_BenchPartCount;
+	// distance between the tiles, the size of the floor
+	const float g_TileWidth = 20.0f;
+	const float g_TileDepth = 16.0f;
+
+	// how far the lamp and the bench are moved, turned and sized
+	const float g_MaxPropOffset = 1.5f;
+	const float g_MaxPropYaw = 20.0f;
+	const float g_MinPropScale = 0.9f;
+	const float g_MaxPropScale = 1.1f;
+
+	// the light of every lamp
+	const glm::vec3 g_LampAmbient = glm::vec3(0.05f, 0.05f, 0.04f);
+	const glm::vec3 g_LampDiffuse = glm::vec3(1.2f, 1.1f, 0.8f);
+	const glm::vec3 g_LampSpecular = glm::vec3(1.0f, 1.0f, 0.8f);
+	const float g_LampConstant = 1.0f;
+	const float g_LampLinear = 0.09f;
+	const float g_LampQuadratic = 0.032f;
+
+	/***********************************************************
+	 *  RandomUnit()
+	 *
+	 *  random value from 0 up to 1, taken from the top bits of
+	 *  the generator so the same seed gives the same scene with
+	 *  any standard library
+	 ***********************************************************/
+	float RandomUnit(std::mt19937& random)
+	{
+		return((float)(random() >> 8) * (1.0f / 16777216.0f));
+	}
+
+	// random value from low up to high
+	float RandomRange(std::mt19937& random, float low, float high)
+	{
+		return(low + ((high - low) * RandomUnit(random)));
+	}
+
+	/***********************************************************
+	 *  ExtractRotation()
+	 *
+	 *  rotation degrees about X, Y and Z of a rotation matrix,
+	 *  in the Z * Y * X order ComposeTransform() applies them.
+	 *  Z is found from the elements left once X is taken out,
+	 *  so it stays exact where Y turns by close to 90 degrees.
+	 ***********************************************************/
+	glm::vec3 ExtractRotation(const glm::mat4& rotation)
+	{
+		float angleX = atan2f(rotation[1][2], rotation[2][2]);
+		float cosY = sqrtf((rotation[0][0] * rotation[0][0]) + (rotation[0][1] * rotation[0][1]));
+		float angleY = atan2f(-rotation[0][2], cosY);
+
+		float sinX = sinf(angleX);
+		float cosX = cosf(angleX);
+		float angleZ = atan2f(
+			(sinX * rotation[2][0]) - (cosX * rotation[1][0]),
+			(cosX * rotation[1][1]) - (sinX * rotation[2][1]));
+
+		return(glm::vec3(glm::degrees(angleX), glm::degrees(angleY), glm::degrees(angleZ)));
+	}
+
+	// a composition placed in the scene
+	struct PROP_PLACEMENT
+	{
+		glm::vec3 pivot;
+		glm::vec3 position;
+		glm::mat4 yaw;
+		float scale;
+		int materialVariant;
+		int batchGroup;
+	};
+
+	/***********************************************************
+	 *  AddPart()
+	 *
+	 *  add a part of a composition to the scene, turned and
+	 *  sized about the composition's pivot, returns false once
+	 *  the scene has all its objects
+	 ***********************************************************/
+	bool AddPart(
+		SCENE_FILE_CONTENTS& scene,
+		size_t objectLimit,
+		const PROP_PART& part,
+		const PROP_PLACEMENT& placement)
+	{
+		if (scene.objects.size() >= objectLimit)
+		{
+			return(false);
+		}
+
+		glm::vec3 rotationDegrees(part.rotation[0], part.rotation[1], part.rotation[2]);
+		glm::vec3 local = glm::vec3(part.position[0], part.position[1], part.position[2]) - placement.pivot;
+		glm::mat4 rotation = placement.yaw * RenderQueue::ComposeTransform(glm::vec3(1.0f), rotationDegrees, glm::vec3(0.0f));
+
+		SCENE_OBJECT object;
+		object.scaleXYZ = glm::vec3(part.scale[0], part.scale[1], part.scale[2]) * placement.scale;
+		object.rotationDegrees = ExtractRotation(rotation);
+		object.positionXYZ = placement.position + glm::vec3(placement.yaw * glm::vec4(local * placement.scale, 1.0f));
+		object.uvScale = glm::vec2(1.0f, 1.0f);
+		object.meshType = part.meshType;
+		object.textureSlot = part.texture;
+		object.materialIndex = (part.material * g_MaterialVariants) + placement.materialVariant;
+		object.flags = (placement.batchGroup >= 0) ? SCENE_OBJECT_STATIC : 0;
+		object.batchGroup = placement.batchGroup;
+		object.parentIndex = -1;
+		scene.objects.push_back(object);
+
+		return(true);
+	}
+
+	/***********************************************************
+	 *  AddMaterials()
+	 *
+	 *  add every base material in its variants, with the colors
+	 *  and shininess of all but the first changed at random
+	 ***********************************************************/
+	void AddMaterials(SCENE_FILE_CONTENTS& scene, std::mt19937& random)
+	{
+		for (int base = 0; base < MATERIAL_COUNT; base++)
+		{
+			const BASE_MATERIAL_VALUES& values = g_Materials[base];
+			for (int variant = 0; variant < g_MaterialVariants; variant++)
+			{
+				float variation = (variant == 0) ? 0.0f : g_MaterialVariation;
+				SCENE_FILE_MATERIAL material;
+				memset(&material, 0, sizeof(material));
+				for (int i = 0; i < 3; i++)
+				{
+					material.diffuseColor[i] = values.diffuseColor[i] * (1.0f + RandomRange(random, -variation, variation));
+					material.specularColor[i] = values.specularColor[i] * (1.0f + RandomRange(random, -variation, variation));
+				}
+				material.shininess = values.shininess * (1.0f + RandomRange(random, -variation, variation));
+
+				std::string tag = values.tag;
+				if (variant > 0)
+				{
+					tag += "_" + std::to_string(variant);
+				}
+				material.tagOffset = SceneConverter::AddString(scene, tag);
+				scene.materials.push_back(material);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  GenerateStreetScene()
+ *
+ *  This method is used for generating a street scene with
+ *  the passed in number of objects and writing it as a
+ *  binary scene file.  The tiles are laid out in rows of a
+ *  square grid.  The floor and the wall of a tile are drawn
+ *  one by one, as in the built-in scene, and the lamp and
+ *  the bench are each merged into a static batch.
+ ***********************************************************/
+bool SceneGenerator::GenerateStreetScene(
+	const char* binaryFilename,
+	int objectCount,
+	uint32_t seed,
+	GENERATOR_STATS* pStats)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (objectCount < 1)
+	{
+		std::cout << "ERROR: A generated scene needs at least one object" << std::endl;
+		return(false);
+	}
+
+	std::mt19937 random(seed);
+	SCENE_FILE_CONTENTS scene;
+	scene.flags = SCENE_FILE_USE_LIGHTING;
+	// offset 0 is the empty string
+	SceneConverter::AddString(scene, "");
+
+	for (int i = 0; i < TEXTURE_COUNT; i++)
+	{
+		SCENE_FILE_TEXTURE texture;
+		texture.tagOffset = SceneConverter::AddString(scene, g_TextureFiles[i][0]);
+		texture.filenameOffset = SceneConverter::AddString(scene, g_TextureFiles[i][1]);
+		scene.textures.push_back(texture);
+	}
+	AddMaterials(scene, random);
+
+	// the sunlight of the built-in scene
+	SCENE_FILE_LIGHT sunlight;
+	memset(&sunlight, 0, sizeof(sunlight));
+	sunlight.type = SCENE_LIGHT_DIRECTIONAL;
+	sunlight.bActive = 1;
+	const float direction[3] = { -0.05f, -0.3f, -0.1f };
+	memcpy(sunlight.direction, direction, sizeof(direction));
+	sunlight.ambient[0] = sunlight.ambient[1] = sunlight.ambient[2] = 0.3f;
+	sunlight.diffuse[0] = sunlight.diffuse[1] = sunlight.diffuse[2] = 0.8f;
+	scene.lights.push_back(sunlight);
+
+	int tileCount = (objectCount + g_TileObjectCount - 1) / g_TileObjectCount;
+	int gridColumns = (int)ceil(sqrt((double)tileCount));
+	int gridRows = (tileCount + gridColumns - 1) / gridColumns;
+	size_t objectLimit = (size_t)objectCount;
+	scene.objects.reserve(objectLimit);
+
+	int batchGroups = 0;
+	const glm::vec3 yAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+	for (int tile = 0; tile < tileCount; tile++)
+	{
+		// the grid is centered on the origin, where the camera starts
+		glm::vec3 tileOrigin = glm::vec3(
+			((float)(tile % gridColumns) - (0.5f * (float)(gridColumns - 1))) * g_TileWidth,
+			0.0f,
+			-((float)(tile / gridColumns) - (0.5f * (float)(gridRows - 1))) * g_TileDepth);
+
+		PROP_PLACEMENT ground;
+		ground.pivot = glm::vec3(0.0f);
+		ground.position = tileOrigin;
+		ground.yaw = glm::mat4(1.0f);
+		ground.scale = 1.0f;
+		ground.materialVariant = (int)(random() % g_MaterialVariants);
+		ground.batchGroup = -1;
+		AddPart(scene, objectLimit, g_FloorPart, ground);
+		AddPart(scene, objectLimit, g_WallPart, ground);
+
+		PROP_PLACEMENT lamp;
+		lamp.pivot = g_LampPivot;
+		lamp.position = tileOrigin + g_LampPivot + glm::vec3(RandomRange(random, -g_MaxPropOffset, g_MaxPropOffset), 0.0f, 0.0f);
+		lamp.yaw = glm::rotate(glm::radians(RandomRange(random, -g_MaxPropYaw, g_MaxPropYaw)), yAxis);
+		lamp.scale = RandomRange(random, g_MinPropScale, g_MaxPropScale);
+		lamp.materialVariant = (int)(random() % g_MaterialVariants);
+		lamp.batchGroup = (scene.objects.size() < objectLimit) ? batchGroups++ : -1;
+
+		// a lamp is lit once its head is in the scene
+		bool bLampHead = AddPart(scene, objectLimit, g_LampParts[0], lamp);
+		for (int i = 1; i < g_LampPartCount; i++)
+		{
+			AddPart(scene, objectLimit, g_LampParts[i], lamp);
+		}
+		for (int i = 0; i <= g_ArmSegments; i++)
+		{
+			float angle = glm::radians(180.0f * ((float)i / g_ArmSegments));
+			PROP_PART segment = { MESH_CYLINDER, { 0.05f, 0.2f, 0.05f }, { 0.0f, glm::degrees(angle), 90.0f },
+				{ g_ArmCenter.x + (g_ArmRadius * cosf(angle)), g_ArmCenter.y + (g_ArmRadius * sinf(angle)), g_ArmCenter.z },
+				TEXTURE_BLACKMAT, MATERIAL_LAMP };
+			AddPart(scene, objectLimit, segment, lamp);
+		}
+
+		if (bLampHead == true)
+		{
+			glm::vec3 lightPosition = lamp.position +
+				glm::vec3(lamp.yaw * glm::vec4((g_LampLightPosition - g_LampPivot) * lamp.scale, 1.0f));
+			float brightness = RandomRange(random, 0.8f, 1.2f);
+
+			SCENE_FILE_LIGHT light;
+			memset(&light, 0, sizeof(light));
+			light.type = SCENE_LIGHT_POINT;
+			light.bActive = 1;
+			for (int i = 0; i < 3; i++)
+			{
+				light.position[i] = lightPosition[i];
+				light.ambient[i] = g_LampAmbient[i];
+				light.diffuse[i] = g_LampDiffuse[i] * brightness;
+				light.specular[i] = g_LampSpecular[i];
+			}
+			light.constant = g_LampConstant;
+			light.linear = g_LampLinear;
+			light.quadratic = g_LampQuadratic;
+			scene.lights.push_back(light);
+		}
+
+		PROP_PLACEMENT bench;
+		bench.pivot = g_BenchPivot;
+		bench.position = tileOrigin + g_BenchPivot + glm::vec3(RandomRange(random, -g_MaxPropOffset, g_MaxPropOffset), 0.0f, 0.0f);
+		bench.yaw = glm::rotate(glm::radians(RandomRange(random, -g_MaxPropYaw, g_MaxPropYaw)), yAxis);
+		bench.scale = RandomRange(random, g_MinPropScale, g_MaxPropScale);
+		bench.materialVariant = (int)(random() % g_MaterialVariants);
+		bench.batchGroup = (scene.objects.size() < objectLimit) ? batchGroups++ : -1;
+		for (int i = 0; i < g_BenchPartCount; i++)
+		{
+			AddPart(scene, objectLimit, g_BenchParts[i], bench);
+		}
+	}
+
+	if (SceneConverter::WriteSceneFile(binaryFilename, scene) == false)
+	{
+		return(false);
+	}
+
+	GENERATOR_STATS stats;
+	stats.objectCount = (int)scene.objects.size();
+	stats.tileCount = tileCount;
+	stats.gridColumns = gridColumns;
+	stats.gridRows = gridRows;
+	stats.lampLightCount = (int)scene.lights.size() - 1;
+	stats.materialCount = (int)scene.materials.size();
+	stats.staticGroupCount = batchGroups;
+	std::ifstream file(binaryFilename, std::ios::binary | std::ios::ate);
+	stats.fileBytes = file ? (uint64_t)file.tellg() : 0;
+	stats.generateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (NULL != pStats)
+	{
+		*pStats = stats;
+	}
+
+	std::cout << "INFO: Generated " << binaryFilename << ": " << stats.objectCount << " objects in "
+		<< stats.tileCount << " tiles (" << stats.gridColumns << " x " << stats.gridRows << "), "
+		<< stats.lampLightCount << " lamp lights, " << stats.materialCount << " materials, "
+		<< stats.staticGroupCount << " static groups, " << (stats.fileBytes / 1024) << " KB in "
+		<< stats.generateMs << " ms" << std::endl;
+
+	return(true);
+}
@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegenerator.h
+// ============
+// generate street scenes of any size as binary scene files, for measuring
+// how the renderer scales with the number of objects and lights
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/***********************************************************
+ *  SceneGenerator
+ *
+ *  This class writes a binary scene file of street tiles laid
+ *  out in a grid.  Every tile is a stretch of the built-in
+ *  scene - the street floor, the brick wall behind it, a
+ *  street lamp and a bench - with the lamp and the bench
+ *  moved, turned and sized at random and given random
+ *  variants of their materials.  Every lamp lights its tile
+ *  with a point light of its own.
+ *
+ *  The scene has exactly the number of objects asked for;
+ *  the last tile stops part way when the count runs out.  The
+ *  same count and seed always give the same file, so runs at
+ *  different sizes can be compared.
+ ***********************************************************/
+class SceneGenerator
+{
+public:
+	struct GENERATOR_STATS
+	{
+		int objectCount;
+		int tileCount;
+		int gridColumns;
+		int gridRows;
+		int lampLightCount;
+		int materialCount;
+		int staticGroupCount;
+		uint64_t fileBytes;
+		double generateMs;
+	};
+
+	// generate a street scene with the passed in number of objects
+	static bool GenerateStreetScene(
+		const char* binaryFilename,
+		int objectCount,
+		uint32_t seed,
+		GENERATOR_STATS* pStats = NULL);
+};
@@ -0,0 +1,32 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenelookup.h
+// ============
+// find the textures and materials of the scene by their tags
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+/***********************************************************
+ *  FindTagIndex()
+ *
+ *  This function is used for finding the first of a list of
+ *  records whose tag matches the passed in tag.  It returns
+ *  the index of the record, or -1 when no tag matches.  The
+ *  records only need a std::string member named tag, so the
+ *  scene manager and the benchmarks run the same lookup.
+ ***********************************************************/
+template<typename RECORD>
+int FindTagIndex(const RECORD* pRecords, int count, const std::string& tag)
+{
+	for (int index = 0; index < count; index++)
+	{
+		if (pRecords[index].tag.compare(tag) == 0)
+		{
+			return(index);
+		}
+	}
+
+	return(-1);
+}
@@ -8,6 +8,10 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "SceneManager.h"
+#include "MeshImporter.h"
+#include "WorldStreamer.h"
+#include "SceneLookup.h"
+#include "MemoryTracker.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -16,14 +20,34 @@
 
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
 // declaration of global variables
 namespace
 {
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
+	const char* g_TextureArrayName = "objectTextures";
+	const char* g_LightmapArrayName = "lightmapTextures";
+	// texture unit the lightmap pages are bound to
+	const int g_LightmapTextureUnit = 1;
+
+	// the texture array holds one layer per texture slot
+	const int g_MaxTextureLayers = 16;
+	// largest width and height of the texture array layers
+	const int g_MaxTextureLayerSize = 1024;
+
+	// shader storage bindings of the per-draw and material data
+	const GLuint g_DrawDataBinding = 0;
+	const GLuint g_MaterialDataBinding = 1;
+	// generic vertex attribute that carries the draw index
+	const GLuint g_DrawIndexAttribute = 3;
+	// draws the per-draw buffer holds before it has to grow
+	const size_t g_InitialDrawCapacity = 1024;
+	// distance the camera moves before the nearest point lights of
+	// a scene with more lights than shader slots are picked again
+	const float g_PointLightUpdateDistance = 2.0f;
 }
 
 /***********************************************************
@@ -31,10 +55,34 @@ namespace
  *
  *  The constructor for the class
  ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
+SceneManager::SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem)
 {
 	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
+	m_pJobSystem = pJobSystem;
+	m_basicMeshes = new PrimitiveMeshes();
+	m_bCompactVertices = false;
+	m_pRenderQueue = new RenderQueue(pJobSystem);
+	m_loadedTextures = 0;
+	m_lightState = LIGHT_STATE();
+	m_lightVersion = 0;
+	m_appliedLightVersion = 0;
+	m_pDrawBuffer = NULL;
+	m_materialBufferID = 0;
+	m_pStaticBatcher = new StaticBatcher();
+	m_bBakeLightmap = false;
+	m_lightmapTextureID = 0;
+	m_pLightmapShader = NULL;
+	m_currentBatchGroup = -1;
+	m_batchGroupCount = 0;
+	m_pSceneFile = new SceneFile();
+	m_pSceneObjects = NULL;
+	m_sceneObjectCount = 0;
+	m_pWorldStreamer = NULL;
+	m_worldBaseLights = LIGHT_STATE();
+	m_pointLightsPosition = glm::vec3(0.0f);
+	m_bPointLightsGathered = false;
+	m_pSoftwareRasterizer = NULL;
+	m_pRenderCounters = new RenderCounters();
 }
 
 /***********************************************************
@@ -45,97 +93,396 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 SceneManager::~SceneManager()
 {
 	m_pShaderManager = NULL;
+	m_pJobSystem = NULL;
+	// the texture array of a world belongs to its streamer
+	DestroyGLTextures();
+	// the streamer threads are stopped before the batcher whose
+	// shapes the cells share is deleted
+	delete m_pWorldStreamer;
+	m_pWorldStreamer = NULL;
+	for (size_t i = 0; i < m_cellDrawBuffers.size(); i++)
+	{
+		if (0 != m_cellDrawBuffers[i].bufferID)
+		{
+			glDeleteBuffers(1, &m_cellDrawBuffers[i].bufferID);
+			MemoryTracker::ReleaseBuffer(m_cellDrawBuffers[i].bufferID);
+		}
+	}
+	m_cellDrawBuffers.clear();
+	delete m_pSoftwareRasterizer;
+	m_pSoftwareRasterizer = NULL;
+	delete m_pRenderCounters;
+	m_pRenderCounters = NULL;
 	delete m_basicMeshes;
 	m_basicMeshes = NULL;
+	delete m_pRenderQueue;
+	m_pRenderQueue = NULL;
+	delete m_pDrawBuffer;
+	m_pDrawBuffer = NULL;
+	delete m_pStaticBatcher;
+	m_pStaticBatcher = NULL;
+	delete m_pLightmapShader;
+	m_pLightmapShader = NULL;
+	if (0 != m_lightmapTextureID)
+	{
+		glDeleteTextures(1, &m_lightmapTextureID);
+		MemoryTracker::ReleaseTexture(m_lightmapTextureID);
+		m_lightmapTextureID = 0;
+	}
+	m_pSceneObjects = NULL;
+	delete m_pSceneFile;
+	m_pSceneFile = NULL;
+	MemoryTracker::ReleaseHeap(this);
+	if (0 != m_materialBufferID)
+	{
+		glDeleteBuffers(1, &m_materialBufferID);
+		MemoryTracker::ReleaseBuffer(m_materialBufferID);
+		m_materialBufferID = 0;
+	}
 }
 
 /***********************************************************
- *  CreateGLTexture()
+ *  CreateGLTextures()
  *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
+ *  This method is used for loading the scene textures into
+ *  the layers of one texture array, so that objects with
+ *  different textures can be drawn together.  The image files
+ *  are decoded in parallel on the job system, since decoding
+ *  is the slow part.  The layers of an array share one size,
+ *  so every image is resampled to the size of the largest,
+ *  rounded up to a power of two.  Every image is registered
+ *  in the order it is passed in, so a texture slot is the
+ *  index of its image.  Images that fail to load get no
+ *  layer, and objects using them are drawn untextured.
  ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
+bool SceneManager::CreateGLTextures(TEXTURE_IMAGE* pImages, int count)
 {
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
 	// indicate to always flip images vertically when loaded
 	stbi_set_flip_vertically_on_load(true);
 
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
+	// try to parse the image data from the specified image files
+	auto decodeImages = [pImages](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			pImages[i].pixels = stbi_load(
+				pImages[i].filename,
+				&pImages[i].width,
+				&pImages[i].height,
+				&pImages[i].colorChannels,
+				0);
+		}
+	};
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->ParallelFor(count, 1, decodeImages);
+	}
+	else
+	{
+		decodeImages(0, count);
+	}
+
+	// keep the images that loaded in a format that is handled
+	bool bAllLoaded = true;
+	std::vector<int> layerImages;
+	int largestSize = 1;
+	for (int i = 0; i < count; i++)
+	{
+		TEXTURE_IMAGE& image = pImages[i];
+		if (NULL == image.pixels)
+		{
+			std::cout << "Could not load image:" << image.filename << std::endl;
+			bAllLoaded = false;
+			continue;
+		}
+
+		std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+		// if the image is in a format that is not handled
+		if ((image.colorChannels != 3) && (image.colorChannels != 4))
 		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
+			std::cout << "Not implemented to handle image with " << image.colorChannels << " channels" << std::endl;
+			stbi_image_free(image.pixels);
+			image.pixels = NULL;
+			bAllLoaded = false;
+			continue;
 		}
 
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
+		if (i >= g_MaxTextureLayers)
+		{
+			std::cout << "ERROR: No texture slot left for image:" << image.filename << std::endl;
+			stbi_image_free(image.pixels);
+			image.pixels = NULL;
+			bAllLoaded = false;
+			continue;
+		}
+
+		layerImages.push_back(i);
+		largestSize = std::max(largestSize, std::max(image.width, image.height));
+	}
 
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+	if (layerImages.empty() == true)
+	{
+		RegisterTextures(pImages, count, 0, layerImages);
+		return(false);
+	}
+
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	int layerSize = 1;
+	while ((layerSize < largestSize) &&
+		(layerSize < g_MaxTextureLayerSize) &&
+		(layerSize < maxTextureSize))
+	{
+		layerSize *= 2;
+	}
+
+	// resample every image into its RGBA layer, in parallel
+	int layerCount = (int)layerImages.size();
+	size_t layerBytes = (size_t)layerSize * layerSize * 4;
+	std::vector<unsigned char> layerData(layerBytes * layerCount);
+	auto resampleImages = [&](int begin, int end)
+	{
+		for (int layer = begin; layer < end; layer++)
+		{
+			TEXTURE_IMAGE& image = pImages[layerImages[layer]];
+			ResampleImage(image, &layerData[layer * layerBytes], layerSize);
 
-		// register the loaded texture and associate it with the special tag string
+			// free the image data from local memory
+			stbi_image_free(image.pixels);
+			image.pixels = NULL;
+		}
+	};
+	if (NULL != m_pJobSystem)
+	{
+		m_pJobSystem->ParallelFor(layerCount, 1, resampleImages);
+	}
+	else
+	{
+		resampleImages(0, layerCount);
+	}
+
+	int levelCount = 1;
+	while ((layerSize >> levelCount) > 0)
+	{
+		levelCount++;
+	}
+
+	GLuint textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, levelCount, GL_RGBA8, layerSize, layerSize, layerCount);
+	MemoryTracker::TrackTexture(textureID, MemoryTracker::MEMORY_GPU_TEXTURES, "scene texture array",
+		GL_RGBA8, layerSize, layerSize, layerCount, levelCount);
+	glTexSubImage3D(
+		GL_TEXTURE_2D_ARRAY, 0,
+		0, 0, 0,
+		layerSize, layerSize, layerCount,
+		GL_RGBA, GL_UNSIGNED_BYTE,
+		&layerData[0]);
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		m_pSoftwareRasterizer->SetTextures(&layerData[0], layerSize, layerCount);
+	}
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0); // Unbind the texture
+
+	// register the images and associate them with the special tag strings
+	RegisterTextures(pImages, count, textureID, layerImages);
+
+	std::cout << "INFO: Loaded " << layerCount << " textures into a " << layerSize << "x" << layerSize << " texture array" << std::endl;
+
+	return(bAllLoaded);
+}
+
+/***********************************************************
+ *  CreateWorldTextures()
+ *
+ *  This method is used for loading the textures of the base
+ *  scene of a world into the first layers of the texture
+ *  array the world streamer creates, which also holds the
+ *  layers of the streamed cells.  The images are registered
+ *  like CreateGLTextures() does, so the slots of the base
+ *  scene mean the same in both.
+ ***********************************************************/
+bool SceneManager::CreateWorldTextures(TEXTURE_IMAGE* pImages, int count)
+{
+	std::vector<std::string> filenames;
+	for (int i = 0; (i < count) && (i < g_MaxTextureLayers); i++)
+	{
+		filenames.push_back(pImages[i].filename);
+	}
+	if (count > g_MaxTextureLayers)
+	{
+		std::cout << "ERROR: No texture slot left for " << (count - g_MaxTextureLayers)
+			<< " images of the base scene" << std::endl;
+	}
+
+	std::vector<int> layerImages;
+	GLuint textureID = m_pWorldStreamer->CreateTextureArray(filenames, m_pJobSystem, layerImages);
+	RegisterTextures(pImages, count, textureID, layerImages);
+
+	return(layerImages.size() == filenames.size());
+}
+
+/***********************************************************
+ *  RegisterTextures()
+ *
+ *  This method is used for registering the passed in images
+ *  in order, with the texture array and the layer each image
+ *  was given, or -1 for images that got no layer.
+ ***********************************************************/
+void SceneManager::RegisterTextures(
+	const TEXTURE_IMAGE* pImages,
+	int count,
+	uint32_t textureID,
+	const std::vector<int>& layerImages)
+{
+	int firstSlot = m_loadedTextures;
+	for (int i = 0; (i < count) && (m_loadedTextures < g_MaxTextureLayers); i++)
+	{
 		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
+		m_textureIDs[m_loadedTextures].tag = pImages[i].tag;
+		m_textureIDs[m_loadedTextures].layer = -1;
 		m_loadedTextures++;
+	}
 
-		return true;
+	for (size_t layer = 0; layer < layerImages.size(); layer++)
+	{
+		int slot = firstSlot + layerImages[layer];
+		if (slot < m_loadedTextures)
+		{
+			m_textureIDs[slot].layer = (int)layer;
+		}
+	}
+}
+
+/***********************************************************
+ *  GetTextureLayer()
+ *
+ *  This method is used for getting the texture array layer of
+ *  a texture slot, or -1 when the slot has no layer.
+ ***********************************************************/
+int SceneManager::GetTextureLayer(int textureSlot) const
+{
+	// the slots after the base scene belong to the streamed cells
+	if ((NULL != m_pWorldStreamer) && (textureSlot >= m_loadedTextures))
+	{
+		return(m_pWorldStreamer->GetTextureLayer(textureSlot));
+	}
+	if ((textureSlot < 0) || (textureSlot >= m_loadedTextures))
+	{
+		return(-1);
+	}
+
+	return(m_textureIDs[textureSlot].layer);
+}
+
+/***********************************************************
+ *  SetDrawTransform()
+ *
+ *  This method is used for writing the model matrix of a
+ *  draw and the normal matrix composed for it on the CPU, so
+ *  the vertex shader does not invert a matrix per vertex.
+ ***********************************************************/
+void SceneManager::SetDrawTransform(DRAW_DATA& drawData, const glm::mat4& model, const glm::mat3& normalMatrix)
+{
+	drawData.model = model;
+	for (int i = 0; i < 3; i++)
+	{
+		drawData.normalMatrix[i] = glm::vec4(normalMatrix[i], 0.0f);
 	}
+}
 
-	std::cout << "Could not load image:" << filename << std::endl;
+/***********************************************************
+ *  ResampleImage()
+ *
+ *  This method is used for resampling a decoded image into a
+ *  square RGBA layer.  Each layer texel averages a grid of
+ *  bilinear samples that covers its footprint in the source
+ *  image, so shrinking an image does not skip source texels.
+ ***********************************************************/
+void SceneManager::ResampleImage(const TEXTURE_IMAGE& image, unsigned char* pLayer, int layerSize)
+{
+	float scaleX = (float)image.width / layerSize;
+	float scaleY = (float)image.height / layerSize;
+	int samplesX = std::max(1, (int)ceil(scaleX));
+	int samplesY = std::max(1, (int)ceil(scaleY));
+	int channels = image.colorChannels;
 
-	// Error loading the image
-	return false;
+	for (int y = 0; y < layerSize; y++)
+	{
+		for (int x = 0; x < layerSize; x++)
+		{
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+			for (int sy = 0; sy < samplesY; sy++)
+			{
+				for (int sx = 0; sx < samplesX; sx++)
+				{
+					// source position of the sample, in texel centers
+					float u = ((x + ((sx + 0.5f) / samplesX)) * scaleX) - 0.5f;
+					float v = ((y + ((sy + 0.5f) / samplesY)) * scaleY) - 0.5f;
+					u = std::min(std::max(u, 0.0f), (float)(image.width - 1));
+					v = std::min(std::max(v, 0.0f), (float)(image.height - 1));
+
+					int x0 = (int)u;
+					int y0 = (int)v;
+					int x1 = std::min(x0 + 1, image.width - 1);
+					int y1 = std::min(y0 + 1, image.height - 1);
+					float fx = u - x0;
+					float fy = v - y0;
+
+					const unsigned char* p00 = image.pixels + (((y0 * image.width) + x0) * channels);
+					const unsigned char* p10 = image.pixels + (((y0 * image.width) + x1) * channels);
+					const unsigned char* p01 = image.pixels + (((y1 * image.width) + x0) * channels);
+					const unsigned char* p11 = image.pixels + (((y1 * image.width) + x1) * channels);
+
+					for (int c = 0; c < channels; c++)
+					{
+						float top = p00[c] + ((p10[c] - p00[c]) * fx);
+						float bottom = p01[c] + ((p11[c] - p01[c]) * fx);
+						sum[c] += top + ((bottom - top) * fy);
+					}
+				}
+			}
+
+			float weight = 1.0f / (samplesX * samplesY);
+			unsigned char* pTexel = pLayer + (((y * layerSize) + x) * 4);
+			pTexel[0] = (unsigned char)((sum[0] * weight) + 0.5f);
+			pTexel[1] = (unsigned char)((sum[1] * weight) + 0.5f);
+			pTexel[2] = (unsigned char)((sum[2] * weight) + 0.5f);
+			pTexel[3] = (channels == 4) ? (unsigned char)((sum[3] * weight) + 0.5f) : 255;
+		}
+	}
 }
 
 /***********************************************************
  *  BindGLTextures()
  *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
+ *  This method is used for binding the texture array, which
+ *  holds every loaded texture, to the first texture unit.
  ***********************************************************/
 void SceneManager::BindGLTextures()
 {
-	for (int i = 0; i < m_loadedTextures; i++)
+	if (NULL != m_pWorldStreamer)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_pWorldStreamer->GetTextureArrayID());
+	}
+	else if ((m_loadedTextures > 0) && (0 != m_textureIDs[0].ID))
 	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureIDs[0].ID);
 	}
 }
 
@@ -143,13 +490,32 @@ void SceneManager::BindGLTextures()
  *  DestroyGLTextures()
  *
  *  This method is used for freeing the memory in all the
- *  used texture memory slots.
+ *  used texture memory slots.  The slots loaded together
+ *  share one texture array, which is deleted once, and the
+ *  array of a world is left to the world streamer.
  ***********************************************************/
 void SceneManager::DestroyGLTextures()
 {
+	if (NULL != m_pWorldStreamer)
+	{
+		return;
+	}
+
 	for (int i = 0; i < m_loadedTextures; i++)
 	{
-		glGenTextures(1, &m_textureIDs[i].ID);
+		GLuint textureID = m_textureIDs[i].ID;
+		if (0 != textureID)
+		{
+			glDeleteTextures(1, &textureID);
+			MemoryTracker::ReleaseTexture(textureID);
+			for (int j = i; j < m_loadedTextures; j++)
+			{
+				if (m_textureIDs[j].ID == textureID)
+				{
+					m_textureIDs[j].ID = 0;
+				}
+			}
+		}
 	}
 }
 
@@ -187,199 +553,675 @@ int SceneManager::FindTextureID(std::string tag)
  ***********************************************************/
 int SceneManager::FindTextureSlot(std::string tag)
 {
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
+	return(FindTagIndex(m_textureIDs, m_loadedTextures, tag));
+}
 
-	while ((index < m_loadedTextures) && (bFound == false))
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+{
+	int index = FindMaterialIndex(tag);
+	if (index < 0)
 	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
+		return(false);
+	}
+
+	material.diffuseColor = m_objectMaterials[index].diffuseColor;
+	material.specularColor = m_objectMaterials[index].specularColor;
+	material.shininess = m_objectMaterials[index].shininess;
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a previously
+ *  defined material that is associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(std::string tag)
+{
+	if (m_objectMaterials.empty() == true)
+	{
+		return(-1);
+	}
+
+	return(FindTagIndex(&m_objectMaterials[0], (int)m_objectMaterials.size(), tag));
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the 3D scene.
+ *  The texture and material tags are resolved to their slot
+ *  and index here, once, instead of every time it is drawn.
+ ***********************************************************/
+void SceneManager::AddSceneObject(
+	int meshType,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	std::string textureTag,
+	std::string materialTag)
+{
+	SCENE_OBJECT object;
+	object.scaleXYZ = scaleXYZ;
+	object.rotationDegrees = glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees);
+	object.positionXYZ = positionXYZ;
+	object.uvScale = glm::vec2(1.0f, 1.0f);
+	object.meshType = meshType;
+	object.textureSlot = FindTextureSlot(textureTag);
+	object.materialIndex = FindMaterialIndex(materialTag);
+	object.flags = 0;
+	object.batchGroup = m_currentBatchGroup;
+	object.parentIndex = -1;
+	if (m_currentBatchGroup >= 0)
+	{
+		object.flags |= SCENE_OBJECT_STATIC;
+	}
+
+	m_sceneObjects.push_back(object);
+}
+
+/***********************************************************
+ *  BeginStaticBatch()
+ *
+ *  This method is used for starting a group of objects that
+ *  never move.  The objects added until EndStaticBatch() is
+ *  called are merged and drawn together.
+ ***********************************************************/
+void SceneManager::BeginStaticBatch()
+{
+	m_currentBatchGroup = m_batchGroupCount;
+	m_batchGroupCount++;
+}
+
+/***********************************************************
+ *  EndStaticBatch()
+ *
+ *  This method is used for ending the current static group.
+ ***********************************************************/
+void SceneManager::EndStaticBatch()
+{
+	m_currentBatchGroup = -1;
+}
+
+/***********************************************************
+ *  BuildStaticBatches()
+ *
+ *  This method is used for merging the static objects into
+ *  their batches, and for preparing the draw data of the
+ *  static objects, which does not change from frame to frame.
+ *  The model matrix of a static object is the identity, since
+ *  its vertices are already in world space.  The software
+ *  renderer draws the meshes of the static objects instead,
+ *  with their world transforms.  A lightmap is baked or read
+ *  for the merged geometry before it is uploaded, since the
+ *  lightmap charts need vertices of their own.
+ ***********************************************************/
+void SceneManager::BuildStaticBatches()
+{
+	m_staticDrawData.clear();
+	m_staticRasterDraws.clear();
+	m_staticRasterFirst.clear();
+	if (m_sceneObjectCount == 0)
+	{
+		return;
+	}
+
+	m_pStaticBatcher->Build(m_pSceneObjects, m_sceneObjectCount);
+	if (m_lightmapFilename.empty() == false)
+	{
+		PrepareLightmap();
+	}
+	m_pStaticBatcher->CreateBuffers();
+
+	const std::vector<int>& staticObjects = m_pStaticBatcher->GetStaticObjects();
+	int materialCount = (int)m_objectMaterials.size();
+	for (size_t i = 0; i < staticObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_pSceneObjects[staticObjects[i]];
+
+		// the batches hold world space positions and normals
+		DRAW_DATA drawData;
+		SetDrawTransform(drawData, glm::mat4(1.0f), glm::mat3(1.0f));
+		drawData.uvScale = object.uvScale;
+		drawData.materialIndex = (object.materialIndex >= 0) ? object.materialIndex : materialCount;
+		drawData.textureSlot = GetTextureLayer(object.textureSlot);
+		m_staticDrawData.push_back(drawData);
+	}
+
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		// the static objects are ordered by batch, so the objects
+		// of a batch follow on from those of the one before
+		const std::vector<StaticBatcher::STATIC_BATCH>& batches = m_pStaticBatcher->GetBatches();
+		int firstObject = 0;
+		for (size_t i = 0; i < batches.size(); i++)
 		{
-			textureSlot = index;
-			bFound = true;
+			m_staticRasterFirst.push_back(firstObject);
+			firstObject += batches[i].objectCount;
+		}
+		m_staticRasterFirst.push_back(firstObject);
+
+		for (size_t i = 0; i < staticObjects.size(); i++)
+		{
+			const SCENE_OBJECT& object = m_pSceneObjects[staticObjects[i]];
+
+			SoftwareRasterizer::RASTER_DRAW draw;
+			draw.model = RenderQueue::ComposeWorldTransform(m_pSceneObjects, staticObjects[i]);
+			draw.normalMatrix = RenderQueue::ComposeNormalMatrix(draw.model);
+			draw.uvScale = object.uvScale;
+			draw.materialIndex = object.materialIndex;
+			draw.textureLayer = GetTextureLayer(object.textureSlot);
+			draw.meshType = object.meshType;
+			m_staticRasterDraws.push_back(draw);
 		}
-		else
-			index++;
 	}
+}
 
-	return(textureSlot);
+/***********************************************************
+ *  TrackSceneBytes()
+ *
+ *  This method is used for reporting the memory the scene
+ *  holds once it is prepared: its objects, materials, point
+ *  lights and the draw data of its static objects.  Meshes,
+ *  batches and textures are reported by their owners.
+ ***********************************************************/
+void SceneManager::TrackSceneBytes()
+{
+	size_t bytes =
+		(size_t)m_sceneObjectCount * sizeof(SCENE_OBJECT) +
+		m_objectMaterials.capacity() * sizeof(OBJECT_MATERIAL) +
+		m_scenePointLights.capacity() * sizeof(POINT_LIGHT) +
+		m_staticDrawData.capacity() * sizeof(DRAW_DATA) +
+		m_staticRasterDraws.capacity() * sizeof(SoftwareRasterizer::RASTER_DRAW);
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_SCENE, "scene objects", bytes);
 }
 
 /***********************************************************
- *  FindMaterial()
+ *  PrepareLightmap()
  *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
+ *  This method is used for baking the lightmap of the merged
+ *  static objects and writing it to the lightmap file, or for
+ *  reading the file baked before.  The surfaces are lit with
+ *  their normals in world space and the diffuse colors of
+ *  their materials, and every point light of a scene file is
+ *  baked, not only those nearest the camera.  The pages go in
+ *  a texture array, and the static batches are drawn by a
+ *  program of their own that adds the specular light to the
+ *  baked light.  The batches are lit every frame as before
+ *  when there is no lightmap to use.
  ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
+bool SceneManager::PrepareLightmap()
 {
-	if (m_objectMaterials.size() == 0)
+	if ((NULL == m_pShaderManager) || (NULL != m_pWorldStreamer) || (NULL != m_pSoftwareRasterizer))
 	{
+		std::cout << "INFO: Lightmaps are only drawn for a single scene with OpenGL, "
+			<< m_lightmapFilename << " is not used" << std::endl;
 		return(false);
 	}
 
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
+	const std::vector<StaticBatcher::BATCH_VERTEX>& batchVertices = m_pStaticBatcher->GetVertices();
+	std::vector<LightmapBaker::BAKE_VERTEX> vertices(batchVertices.size());
+	for (size_t i = 0; i < batchVertices.size(); i++)
+	{
+		vertices[i].position = batchVertices[i].position;
+		vertices[i].normal = batchVertices[i].normal;
+		vertices[i].surface = batchVertices[i].drawIndex;
+	}
+
+	LightmapBaker baker(m_pJobSystem);
+	if (baker.BuildCharts(vertices, m_pStaticBatcher->GetIndices(), m_lightmapSettings) == false)
+	{
+		return(false);
+	}
+
+	if (m_bBakeLightmap == true)
 	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
+		const std::vector<int>& staticObjects = m_pStaticBatcher->GetStaticObjects();
+		std::vector<LightmapBaker::BAKE_SURFACE> surfaces(staticObjects.size());
+		for (size_t i = 0; i < staticObjects.size(); i++)
 		{
-			bFound = true;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
+			const SCENE_OBJECT& object = m_pSceneObjects[staticObjects[i]];
+			glm::mat4 model = RenderQueue::ComposeWorldTransform(m_pSceneObjects, staticObjects[i]);
+			surfaces[i].normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+			// objects without a material reflect no diffuse light,
+			// like the zeroed material entry the shader reads
+			surfaces[i].diffuseColor = ((object.materialIndex >= 0) && (object.materialIndex < (int)m_objectMaterials.size())) ?
+				m_objectMaterials[object.materialIndex].diffuseColor : glm::vec3(0.0f);
 		}
-		else
+
+		if ((baker.Bake(surfaces, m_lightState, m_scenePointLights) == false) ||
+			(baker.WriteFile(m_lightmapFilename.c_str()) == false))
 		{
-			index++;
+			return(false);
 		}
+		baker.WritePreviews(m_lightmapFilename);
+		baker.PrintStats();
+		std::cout << "INFO: Baked lightmap " << m_lightmapFilename << std::endl;
+	}
+	else
+	{
+		if (baker.ReadFile(m_lightmapFilename.c_str()) == false)
+		{
+			return(false);
+		}
+		std::cout << "INFO: Loaded lightmap " << m_lightmapFilename << " with "
+			<< baker.GetPageCount() << " pages" << std::endl;
+	}
+
+	m_pStaticBatcher->SetLightmapCoordinates(baker.GetVertexSources(), baker.GetCoordinates(), baker.GetIndices());
+
+	glGenTextures(1, &m_lightmapTextureID);
+	glActiveTexture(GL_TEXTURE0 + g_LightmapTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_lightmapTextureID);
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY,
+		0,
+		GL_RGBA8,
+		baker.GetPageSize(),
+		baker.GetPageSize(),
+		baker.GetPageCount(),
+		0,
+		GL_RGBA,
+		GL_UNSIGNED_BYTE,
+		&baker.GetPages()[0]);
+	MemoryTracker::TrackTexture(m_lightmapTextureID, MemoryTracker::MEMORY_GPU_TEXTURES, "lightmap atlas",
+		GL_RGBA8, baker.GetPageSize(), baker.GetPageSize(), baker.GetPageCount(), 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glActiveTexture(GL_TEXTURE0);
+
+	m_pLightmapShader = new ShaderManager();
+	m_pLightmapShader->LoadShaders(
+		"shaders/lightmapVertexShader.glsl",
+		"shaders/lightmapFragmentShader.glsl");
+	m_pLightmapShader->use();
+	m_pLightmapShader->setSampler2DValue(g_TextureArrayName, 0);
+	m_pLightmapShader->setSampler2DValue(g_LightmapArrayName, g_LightmapTextureUnit);
+	LightUniforms::Pack(m_lightState, m_lightUniforms);
+	SetLightUniforms(m_pLightmapShader);
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->use();
 	}
 
 	return(true);
 }
 
 /***********************************************************
- *  SetTransformations()
+ *  DrawMesh()
  *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
+ *  This method is used for drawing one of the basic or
+ *  imported meshes.
  ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
-{
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationZ * rotationY * rotationX * scale;
+void SceneManager::DrawMesh(int meshType, int viewCount)
+{
+	m_basicMeshes->DrawMesh(meshType, viewCount);
+}
 
+/***********************************************************
+ *  CreateShaderBuffers()
+ *
+ *  This method is used for creating the buffers the shaders
+ *  read the per-draw and material data from, and for pointing
+ *  the texture array at its texture unit.
+ ***********************************************************/
+bool SceneManager::CreateShaderBuffers()
+{
+	// the per-draw data is streamed through a persistently
+	// mapped buffer with one region per frame in flight
+	m_pDrawBuffer = new StreamBuffer();
+	if (m_pDrawBuffer->Initialize(
+		GL_SHADER_STORAGE_BUFFER,
+		g_InitialDrawCapacity * sizeof(DRAW_DATA)) == false)
+	{
+		delete m_pDrawBuffer;
+		m_pDrawBuffer = NULL;
+		return(false);
+	}
+
+	// the materials do not change, so they are uploaded once
+	std::vector<MATERIAL_DATA> materials(m_objectMaterials.size() + 1);
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		materials[i].diffuseColor = glm::vec4(m_objectMaterials[i].diffuseColor, 0.0f);
+		materials[i].specularColorShininess = glm::vec4(
+			m_objectMaterials[i].specularColor,
+			m_objectMaterials[i].shininess);
+	}
+	glGenBuffers(1, &m_materialBufferID);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_materialBufferID);
+	glBufferData(
+		GL_SHADER_STORAGE_BUFFER,
+		materials.size() * sizeof(MATERIAL_DATA),
+		&materials[0],
+		GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	MemoryTracker::TrackBuffer(m_materialBufferID, MemoryTracker::MEMORY_GPU_BUFFERS, "materials",
+		materials.size() * sizeof(MATERIAL_DATA));
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_MaterialDataBinding, m_materialBufferID);
+
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		std::vector<SoftwareRasterizer::RASTER_MATERIAL> rasterMaterials(m_objectMaterials.size());
+		for (size_t i = 0; i < m_objectMaterials.size(); i++)
+		{
+			rasterMaterials[i].diffuseColor = m_objectMaterials[i].diffuseColor;
+			rasterMaterials[i].specularColor = m_objectMaterials[i].specularColor;
+			rasterMaterials[i].shininess = m_objectMaterials[i].shininess;
+		}
+		m_pSoftwareRasterizer->SetMaterials(rasterMaterials);
+	}
+
+	// the texture array is bound to the first texture unit
 	if (NULL != m_pShaderManager)
 	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+		m_pShaderManager->setSampler2DValue(g_TextureArrayName, 0);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SubmitRenderCommands()
+ *
+ *  This method is used for drawing the visible static batches
+ *  and the recorded render commands.  The per-draw data of the
+ *  whole frame is written straight into the mapped region of
+ *  the draw buffer: the static objects first, at the indexes
+ *  baked into the batch vertices, then the commands.  Each
+ *  command only sets its draw index, as a constant vertex
+ *  attribute the shader uses to find its data.  No uniforms
+ *  are set per draw.  Lightmapped static batches are drawn
+ *  with the lightmap program, which reads the same camera.
+ *  Every draw is instanced once per view of the frame, so
+ *  the views cost no more submission than a single one.
+ ***********************************************************/
+void SceneManager::SubmitRenderCommands(const FRAME_SNAPSHOT& snapshot)
+{
+	const std::vector<RENDER_COMMAND>& commands = snapshot.commands;
+	const std::vector<int>& staticBatches = snapshot.staticBatches;
+	int viewCount = snapshot.viewCount;
+
+	if (NULL == m_pDrawBuffer)
+	{
+		return;
+	}
+
+	size_t staticCount = m_staticDrawData.size();
+	size_t drawCount = staticCount + commands.size();
+	if (drawCount == 0)
+	{
+		return;
+	}
+
+	size_t dataSize = drawCount * sizeof(DRAW_DATA);
+	if (m_pDrawBuffer->Reserve(dataSize) == false)
+	{
+		return;
+	}
+
+	DRAW_DATA* pDrawData = (DRAW_DATA*)m_pDrawBuffer->BeginRegion();
+	if (NULL == pDrawData)
+	{
+		return;
+	}
+
+	if (staticCount > 0)
+	{
+		memcpy(pDrawData, &m_staticDrawData[0], staticCount * sizeof(DRAW_DATA));
+	}
+
+	int materialCount = (int)m_objectMaterials.size();
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const RENDER_COMMAND& command = commands[i];
+		DRAW_DATA& drawData = pDrawData[staticCount + i];
+
+		SetDrawTransform(drawData, command.model, command.normalMatrix);
+		drawData.uvScale = command.uvScale;
+		// objects without a material use the zeroed entry past the end
+		drawData.materialIndex = (command.materialIndex >= 0) ? command.materialIndex : materialCount;
+		drawData.textureSlot = GetTextureLayer(command.textureSlot);
+	}
+	m_pDrawBuffer->BindRange(g_DrawDataBinding, 0, dataSize);
+	m_pRenderCounters->Add(RenderCounters::COUNTER_BUFFER_BYTES, dataSize);
+
+	const std::vector<StaticBatcher::STATIC_BATCH>& batches = m_pStaticBatcher->GetBatches();
+	if ((NULL != m_pLightmapShader) && (staticBatches.empty() == false))
+	{
+		// the camera block is shared with the main shader
+		m_pLightmapShader->use();
+		for (size_t i = 0; i < staticBatches.size(); i++)
+		{
+			m_pStaticBatcher->DrawBatch(staticBatches[i], viewCount);
+			m_pRenderCounters->AddDraw(batches[staticBatches[i]].indexCount / 3 * viewCount);
+		}
+		m_pShaderManager->use();
+	}
+	else
+	{
+		for (size_t i = 0; i < staticBatches.size(); i++)
+		{
+			m_pStaticBatcher->DrawBatch(staticBatches[i], viewCount);
+			m_pRenderCounters->AddDraw(batches[staticBatches[i]].indexCount / 3 * viewCount);
+		}
+	}
+
+	// the materials are read from the material buffer, so a switch
+	// costs no state change, but it is counted in the draw order
+	int lastMaterial = -1;
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		glVertexAttribI1ui(g_DrawIndexAttribute, (GLuint)(staticCount + i));
+		DrawMesh(commands[i].meshType, viewCount);
+		m_pRenderCounters->AddDraw(m_basicMeshes->GetStats(commands[i].meshType).triangleCount * viewCount);
+		if ((i > 0) && (commands[i].materialIndex != lastMaterial))
+		{
+			m_pRenderCounters->Add(RenderCounters::COUNTER_MATERIAL_SWITCHES);
+		}
+		lastMaterial = commands[i].materialIndex;
+	}
+
+	m_pDrawBuffer->EndRegion();
+}
+
+/***********************************************************
+ *  SubmitCellBatches()
+ *
+ *  This method is used for drawing the visible static batches
+ *  of the streamed cells.  The draw data of a cell's static
+ *  objects does not change while the cell is loaded, so it
+ *  is kept in a buffer of the cell slot, built the first
+ *  time the cell is drawn, and bound in place of the frame's
+ *  draw data while the batches of the cell are drawn.
+ ***********************************************************/
+void SceneManager::SubmitCellBatches(const std::vector<CELL_BATCH>& cellBatches, int viewCount)
+{
+	if ((NULL == m_pWorldStreamer) || (cellBatches.empty() == true))
+	{
+		return;
+	}
+
+	if (m_cellDrawBuffers.empty() == true)
+	{
+		CELL_DRAW_BUFFER empty = { 0, 0 };
+		m_cellDrawBuffers.resize(m_pWorldStreamer->GetSlotCount(), empty);
+	}
+
+	int materialCount = (int)m_objectMaterials.size();
+	int boundSlot = -1;
+	for (size_t i = 0; i < cellBatches.size(); i++)
+	{
+		int slot = cellBatches[i].cellSlot;
+		const StaticBatcher* pBatcher = m_pWorldStreamer->GetCellBatcher(slot);
+		if (NULL == pBatcher)
+		{
+			continue;
+		}
+
+		CELL_DRAW_BUFFER& drawBuffer = m_cellDrawBuffers[slot];
+		uint32_t generation = m_pWorldStreamer->GetCellGeneration(slot);
+		if ((0 == drawBuffer.bufferID) || (drawBuffer.generation != generation))
+		{
+			const std::vector<SCENE_OBJECT>& objects = m_pWorldStreamer->GetCellObjects(slot);
+			const std::vector<int>& staticObjects = pBatcher->GetStaticObjects();
+			std::vector<DRAW_DATA> drawData(std::max<size_t>(1, staticObjects.size()));
+			for (size_t j = 0; j < staticObjects.size(); j++)
+			{
+				const SCENE_OBJECT& object = objects[staticObjects[j]];
+				SetDrawTransform(drawData[j], glm::mat4(1.0f), glm::mat3(1.0f));
+				drawData[j].uvScale = object.uvScale;
+				drawData[j].materialIndex = (object.materialIndex >= 0) ? object.materialIndex : materialCount;
+				drawData[j].textureSlot = GetTextureLayer(object.textureSlot);
+			}
+
+			if (0 == drawBuffer.bufferID)
+			{
+				glGenBuffers(1, &drawBuffer.bufferID);
+			}
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer.bufferID);
+			glBufferData(
+				GL_SHADER_STORAGE_BUFFER,
+				drawData.size() * sizeof(DRAW_DATA),
+				&drawData[0],
+				GL_STATIC_DRAW);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+			MemoryTracker::TrackBuffer(drawBuffer.bufferID, MemoryTracker::MEMORY_GPU_BUFFERS, "cell draw data",
+				drawData.size() * sizeof(DRAW_DATA));
+			m_pRenderCounters->Add(RenderCounters::COUNTER_BUFFER_BYTES, drawData.size() * sizeof(DRAW_DATA));
+			drawBuffer.generation = generation;
+		}
+
+		if (boundSlot != slot)
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_DrawDataBinding, drawBuffer.bufferID);
+			boundSlot = slot;
+		}
+		pBatcher->DrawBatch(cellBatches[i].batch, viewCount);
+		m_pRenderCounters->AddDraw(pBatcher->GetBatches()[cellBatches[i].batch].indexCount / 3 * viewCount);
 	}
 }
 
 /***********************************************************
- *  SetShaderColor()
+ *  ApplyLights()
  *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
+ *  This method is used for passing the light sources into
+ *  the shader, and into the lightmap program when there is
+ *  one, which keeps the lights for their specular light.
  ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
+void SceneManager::ApplyLights(const LIGHT_STATE& lights)
 {
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
 
-	if (NULL != m_pShaderManager)
+	// the lights are only uploaded when they change, so building
+	// the uniform names here stays off the per-frame path
+	LightUniforms::Pack(lights, m_lightUniforms);
+	SetLightUniforms(m_pShaderManager);
+	if (NULL != m_pLightmapShader)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
+		m_pLightmapShader->use();
+		SetLightUniforms(m_pLightmapShader);
+		m_pShaderManager->use();
 	}
 }
 
 /***********************************************************
- *  SetShaderTexture()
+ *  SetLightUniforms()
  *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
+ *  This method is used for setting the packed light uniforms
+ *  on a shader program, which has to be in use.
  ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
+void SceneManager::SetLightUniforms(ShaderManager* pShader)
 {
-	if (NULL != m_pShaderManager)
+	for (size_t i = 0; i < m_lightUniforms.size(); i++)
 	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
+		const LightUniforms::LIGHT_UNIFORM& uniform = m_lightUniforms[i];
+		switch (uniform.type)
+		{
+		case LightUniforms::UNIFORM_BOOL:
+			pShader->setBoolValue(uniform.name, uniform.value.x != 0.0f);
+			break;
+		case LightUniforms::UNIFORM_FLOAT:
+			pShader->setFloatValue(uniform.name, uniform.value.x);
+			break;
+		case LightUniforms::UNIFORM_VEC3:
+			pShader->setVec3Value(uniform.name, uniform.value);
+			break;
+		}
 	}
+	m_pRenderCounters->Add(RenderCounters::COUNTER_UNIFORM_UPLOADS, m_lightUniforms.size());
 }
 
 /***********************************************************
- *  SetTextureUVScale()
+ *  PrintRenderStats()
  *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
+ *  This method is used for printing the counts and timings
+ *  of the last render command recording.
  ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
+void SceneManager::PrintRenderStats()
 {
-	if (NULL != m_pShaderManager)
+	const RenderQueue::RECORD_STATS& stats = m_pRenderQueue->GetStats();
+
+	std::cout << "RENDER: objects " << m_sceneObjectCount
+		<< ", drawn " << stats.objectsRecorded
+		<< ", frustum culled " << stats.objectsFrustumCulled
+		<< ", detail culled " << stats.objectsDetailCulled
+		<< ", record " << stats.recordMs << " ms"
+		<< ", merge " << stats.mergeMs << " ms"
+		<< std::endl;
+
+	if (NULL != m_pWorldStreamer)
+	{
+		m_pWorldStreamer->PrintStats();
+	}
+	if (NULL != m_pSoftwareRasterizer)
 	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
+		m_pSoftwareRasterizer->PrintStats();
 	}
 }
 
 /***********************************************************
- *  SetShaderMaterial()
+ *  GetRenderCounters()
  *
- *  This method is used for passing the material values
- *  into the shader.
+ *  This method is used for getting the counters the draw
+ *  path adds the work of every frame to.  They are only used
+ *  on the thread that owns the OpenGL context.
  ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
+RenderCounters* SceneManager::GetRenderCounters()
 {
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
-	}
+	return(m_pRenderCounters);
 }
 
 void SceneManager::LoadSceneTextures() {
 	bool bReturn = false;
 
+	// the images are decoded together so the job system can
+	// spread the decoding across the cores
+	TEXTURE_IMAGE sceneTextures[] = {
+		{ "textures/street.jpg", "street", NULL, 0, 0, 0 },
+		{ "textures/blackmat.jpg", "bmat", NULL, 0, 0, 0 },
+		{ "textures/wall.jpg", "wall", NULL, 0, 0, 0 },
+		{ "textures/lamp.jpg", "lamp", NULL, 0, 0, 0 },
+		{ "textures/wood.jpg", "wood", NULL, 0, 0, 0 }
+	};
 
-
-	bReturn = CreateGLTexture(
-		"textures/street.jpg",
-		"street");
-	bReturn = CreateGLTexture(
-		"textures/blackmat.jpg",
-		"bmat");
-	bReturn = CreateGLTexture(
-		"textures/wall.jpg",
-		"wall");
-	bReturn = CreateGLTexture(
-		"textures/lamp.jpg",
-		"lamp");
-	bReturn = CreateGLTexture(
-		"textures/wood.jpg",
-		"wood");
+	bReturn = CreateGLTextures(
+		sceneTextures,
+		sizeof(sceneTextures) / sizeof(sceneTextures[0]));
 
 
 	// Bind all textures to texture slots
@@ -426,73 +1268,183 @@ void SceneManager::DefineObjectMaterials()
 
 void SceneManager::SetupSceneLights()
 {
+	LIGHT_STATE lights = LIGHT_STATE();
 
-	m_pShaderManager->setBoolValue(g_UseLightingName, true);
+	lights.bUseLighting = true;
 	// directional light to emulate sunlight coming into scene
-	m_pShaderManager->setVec3Value("directionalLight.direction", -0.05f, -0.3f, -0.1f);
-	m_pShaderManager->setVec3Value("directionalLight.ambient", 0.3f, 0.3f, 0.3f);  
-	m_pShaderManager->setVec3Value("directionalLight.diffuse", 0.8f, 0.8f, 0.8f); // Slightly stronger diffuse
-	m_pShaderManager->setVec3Value("directionalLight.specular", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setBoolValue("directionalLight.bActive", true);
+	lights.directionalLight.direction = glm::vec3(-0.05f, -0.3f, -0.1f);
+	lights.directionalLight.ambient = glm::vec3(0.3f, 0.3f, 0.3f);  
+	lights.directionalLight.diffuse = glm::vec3(0.8f, 0.8f, 0.8f); // Slightly stronger diffuse
+	lights.directionalLight.specular = glm::vec3(0.0f, 0.0f, 0.0f);
+	lights.directionalLight.bActive = true;
 
 	// point light 1
-	m_pShaderManager->setVec3Value("pointLights[0].position", -4.0f, 4.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[0].ambient", 0.3f, 0.3f, 0.2f); // Keep ambient moderate
-	m_pShaderManager->setVec3Value("pointLights[0].diffuse", 1.2f, 1.2f, 0.9f); // Slightly reduce diffuse
-	m_pShaderManager->setVec3Value("pointLights[0].specular", 1.0f, 1.0f, 0.8f); // Maintain specular highlights
-	m_pShaderManager->setFloatValue("pointLights[0].constant", 1.0f); // Base intensity
-	m_pShaderManager->setFloatValue("pointLights[0].linear", 0.05f);  // Smooth linear attenuation
-	m_pShaderManager->setFloatValue("pointLights[0].quadratic", 0.01f); // Gradual quadratic falloff
-	m_pShaderManager->setBoolValue("pointLights[0].bActive", true);
+	lights.pointLights[0].position = glm::vec3(-4.0f, 4.0f, 0.0f);
+	lights.pointLights[0].ambient = glm::vec3(0.3f, 0.3f, 0.2f); // Keep ambient moderate
+	lights.pointLights[0].diffuse = glm::vec3(1.2f, 1.2f, 0.9f); // Slightly reduce diffuse
+	lights.pointLights[0].specular = glm::vec3(1.0f, 1.0f, 0.8f); // Maintain specular highlights
+	lights.pointLights[0].constant = 1.0f; // Base intensity
+	lights.pointLights[0].linear = 0.05f;  // Smooth linear attenuation
+	lights.pointLights[0].quadratic = 0.01f; // Gradual quadratic falloff
+	lights.pointLights[0].bActive = true;
 	// point light 2
-	m_pShaderManager->setVec3Value("pointLights[1].position", 4.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[1].diffuse", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("pointLights[1].specular", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setBoolValue("pointLights[1].bActive", true);
+	lights.pointLights[1].position = glm::vec3(4.0f, 8.0f, 0.0f);
+	lights.pointLights[1].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	lights.pointLights[1].diffuse = glm::vec3(0.3f, 0.3f, 0.3f);
+	lights.pointLights[1].specular = glm::vec3(0.1f, 0.1f, 0.1f);
+	lights.pointLights[1].constant = 1.0f;
+	lights.pointLights[1].linear = 0.09f;
+	lights.pointLights[1].quadratic = 0.032f;
+	lights.pointLights[1].bActive = true;
 	// point light 3
-	m_pShaderManager->setVec3Value("pointLights[2].position", 3.8f, 5.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[2].diffuse", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("pointLights[2].specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[2].bActive", true);
+	lights.pointLights[2].position = glm::vec3(3.8f, 5.5f, 4.0f);
+	lights.pointLights[2].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	lights.pointLights[2].diffuse = glm::vec3(0.2f, 0.2f, 0.2f);
+	lights.pointLights[2].specular = glm::vec3(0.8f, 0.8f, 0.8f);
+	lights.pointLights[2].constant = 1.0f;
+	lights.pointLights[2].linear = 0.09f;
+	lights.pointLights[2].quadratic = 0.032f;
+	lights.pointLights[2].bActive = true;
 	// point light 4
-	m_pShaderManager->setVec3Value("pointLights[3].position", 3.8f, 3.5f, 4.0f);
-	m_pShaderManager->setVec3Value("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[3].diffuse", 0.2f, 0.2f, 0.2f);
-	m_pShaderManager->setVec3Value("pointLights[3].specular", 0.8f, 0.8f, 0.8f);
-	m_pShaderManager->setBoolValue("pointLights[3].bActive", true);
+	lights.pointLights[3].position = glm::vec3(3.8f, 3.5f, 4.0f);
+	lights.pointLights[3].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	lights.pointLights[3].diffuse = glm::vec3(0.2f, 0.2f, 0.2f);
+	lights.pointLights[3].specular = glm::vec3(0.8f, 0.8f, 0.8f);
+	lights.pointLights[3].constant = 1.0f;
+	lights.pointLights[3].linear = 0.09f;
+	lights.pointLights[3].quadratic = 0.032f;
+	lights.pointLights[3].bActive = true;
 	// point light 4
-	m_pShaderManager->setVec3Value("pointLights[4].position", -3.2f, 6.0f, -4.0f);
-	m_pShaderManager->setVec3Value("pointLights[4].ambient", 0.05f, 0.05f, 0.05f);
-	m_pShaderManager->setVec3Value("pointLights[4].diffuse", 0.9f, 0.9f, 0.9f);
-	m_pShaderManager->setVec3Value("pointLights[4].specular", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setBoolValue("pointLights[4].bActive", true);
+	lights.pointLights[4].position = glm::vec3(-3.2f, 6.0f, -4.0f);
+	lights.pointLights[4].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+	lights.pointLights[4].diffuse = glm::vec3(0.9f, 0.9f, 0.9f);
+	lights.pointLights[4].specular = glm::vec3(0.1f, 0.1f, 0.1f);
+	lights.pointLights[4].constant = 1.0f;
+	lights.pointLights[4].linear = 0.09f;
+	lights.pointLights[4].quadratic = 0.032f;
+	lights.pointLights[4].bActive = true;
 
 	//point light 5
-	m_pShaderManager->setVec3Value("pointLights[5].position", 1.5f, 2.0f, 0.0f);  // Position the light near the bench
-	m_pShaderManager->setVec3Value("pointLights[5].ambient", 0.2f, 0.15f, 0.1f);  // Warm ambient light for natural look
-	m_pShaderManager->setVec3Value("pointLights[5].diffuse", 0.8f, 0.6f, 0.3f);  // Softer warm diffuse light
-	m_pShaderManager->setVec3Value("pointLights[5].specular", 0.9f, 0.8f, 0.7f);  // Highlight to emphasize texture
-	m_pShaderManager->setFloatValue("pointLights[5].constant", 1.0f);             // Base intensity
-	m_pShaderManager->setFloatValue("pointLights[5].linear", 0.09f);             // Smooth linear attenuation
-	m_pShaderManager->setFloatValue("pointLights[5].quadratic", 0.032f);         // Gradual quadratic falloff
-	m_pShaderManager->setBoolValue("pointLights[5].bActive", true);              // Activate the light
+	lights.pointLights[5].position = glm::vec3(1.5f, 2.0f, 0.0f);  // Position the light near the bench
+	lights.pointLights[5].ambient = glm::vec3(0.2f, 0.15f, 0.1f);  // Warm ambient light for natural look
+	lights.pointLights[5].diffuse = glm::vec3(0.8f, 0.6f, 0.3f);  // Softer warm diffuse light
+	lights.pointLights[5].specular = glm::vec3(0.9f, 0.8f, 0.7f);  // Highlight to emphasize texture
+	lights.pointLights[5].constant = 1.0f;             // Base intensity
+	lights.pointLights[5].linear = 0.09f;             // Smooth linear attenuation
+	lights.pointLights[5].quadratic = 0.032f;         // Gradual quadratic falloff
+	lights.pointLights[5].bActive = true;              // Activate the light
+
+
+
+	lights.spotLight.position = glm::vec3(0.0f, 2.0f, 0.5f);   // Position near the lamp
+	lights.spotLight.direction = glm::vec3(0.0f, -1.0f, -0.5f); // Angle toward the wall
+	lights.spotLight.ambient = glm::vec3(0.4f, 0.4f, 0.4f);
+	lights.spotLight.diffuse = glm::vec3(0.3f, 0.3f, 0.3f);
+	lights.spotLight.specular = glm::vec3(0.7f, 0.7f, 0.7f);
+	lights.spotLight.constant = 1.0f;
+	lights.spotLight.linear = 0.09f;
+	lights.spotLight.quadratic = 0.032f;
+	lights.spotLight.cutOff = glm::cos(glm::radians(35.0f));  // Wider cone
+	lights.spotLight.outerCutOff = glm::cos(glm::radians(50.0f)); // Smoother edges
+	lights.spotLight.bActive = true;
+
+	SetLights(lights);
+}
+
+/***********************************************************
+ *  SetLights()
+ *
+ *  This method is used for keeping the light sources for the
+ *  frame snapshots, and for passing them into the shader now,
+ *  since the scene is prepared on the GL thread.
+ ***********************************************************/
+void SceneManager::SetLights(const LIGHT_STATE& lights)
+{
+	m_lightState = lights;
+	m_lightVersion++;
+	ApplyLights(m_lightState);
+	m_appliedLightVersion = m_lightVersion;
+}
+
+/***********************************************************
+ *  LoadSceneFile()
+ *
+ *  This method is used for mapping a binary scene file and
+ *  loading its textures, materials, lights and meshes.  The
+ *  objects are not copied; they are drawn straight from the
+ *  mapping.  The texture, material and mesh records are in
+ *  the order the object indexes refer to them.
+ ***********************************************************/
+bool SceneManager::LoadSceneFile(const char* filename)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	if (m_pSceneFile->Open(filename) == false)
+	{
+		return(false);
+	}
+
+	int textureCount = m_pSceneFile->GetTextureCount();
+	if (textureCount > 0)
+	{
+		const SCENE_FILE_TEXTURE* pTextures = m_pSceneFile->GetTextures();
+		std::vector<TEXTURE_IMAGE> images(textureCount);
+		for (int i = 0; i < textureCount; i++)
+		{
+			images[i].filename = m_pSceneFile->GetString(pTextures[i].filenameOffset);
+			images[i].tag = m_pSceneFile->GetString(pTextures[i].tagOffset);
+			images[i].pixels = NULL;
+		}
+		if (NULL != m_pWorldStreamer)
+		{
+			CreateWorldTextures(&images[0], textureCount);
+		}
+		else
+		{
+			CreateGLTextures(&images[0], textureCount);
+		}
+		BindGLTextures();
+	}
+
+	const SCENE_FILE_MATERIAL* pMaterials = m_pSceneFile->GetMaterials();
+	for (int i = 0; i < m_pSceneFile->GetMaterialCount(); i++)
+	{
+		const SCENE_FILE_MATERIAL& record = pMaterials[i];
+		OBJECT_MATERIAL material;
+		material.diffuseColor = glm::vec3(record.diffuseColor[0], record.diffuseColor[1], record.diffuseColor[2]);
+		material.specularColor = glm::vec3(record.specularColor[0], record.specularColor[1], record.specularColor[2]);
+		material.shininess = record.shininess;
+		material.tag = m_pSceneFile->GetString(record.tagOffset);
+		m_objectMaterials.push_back(material);
+	}
+
+	LIGHT_STATE lights;
+	m_pSceneFile->GetLightState(lights);
+	SetLights(lights);
+	// with more point lights than the shader takes, the nearest are
+	// picked as the camera moves
+	m_pSceneFile->GetPointLights(m_scenePointLights);
+	if (m_scenePointLights.size() <= (size_t)MAX_POINT_LIGHTS)
+	{
+		m_scenePointLights.clear();
+	}
+	m_bPointLightsGathered = false;
 
+	const SCENE_FILE_MESH* pMeshes = m_pSceneFile->GetMeshes();
+	for (int i = 0; i < m_pSceneFile->GetMeshCount(); i++)
+	{
+		LoadMeshFile(
+			m_pSceneFile->GetString(pMeshes[i].filenameOffset),
+			m_pSceneFile->GetString(pMeshes[i].tagOffset));
+	}
 
+	m_pSceneObjects = m_pSceneFile->GetObjects();
+	m_sceneObjectCount = m_pSceneFile->GetObjectCount();
 
-	m_pShaderManager->setVec3Value("spotLight.position", 0.0f, 2.0f, 0.5f);   // Position near the lamp
-	m_pShaderManager->setVec3Value("spotLight.direction", 0.0f, -1.0f, -0.5f); // Angle toward the wall
-	m_pShaderManager->setVec3Value("spotLight.ambient", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("spotLight.diffuse", 0.3f, 0.3f, 0.3f);
-	m_pShaderManager->setVec3Value("spotLight.specular", 0.7f, 0.7f, 0.7f);
-	m_pShaderManager->setFloatValue("spotLight.constant", 1.0f);
-	m_pShaderManager->setFloatValue("spotLight.linear", 0.09f);
-	m_pShaderManager->setFloatValue("spotLight.quadratic", 0.032f);
-	m_pShaderManager->setFloatValue("spotLight.cutOff", glm::cos(glm::radians(35.0f)));  // Wider cone
-	m_pShaderManager->setFloatValue("spotLight.outerCutOff", glm::cos(glm::radians(50.0f))); // Smoother edges
-	m_pShaderManager->setBoolValue("spotLight.bActive", true);
+	double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "INFO: Loaded scene file " << filename << " with " << m_sceneObjectCount
+		<< " objects in " << loadMs << " ms" << std::endl;
 
+	return(true);
 }
 
 /**************************************************************/
@@ -508,90 +1460,270 @@ void SceneManager::SetupSceneLights()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The scene comes from the passed in binary
+ *  scene file, or from the methods below when there is none
+ *  or it cannot be loaded.  Returns false when the buffers
+ *  the shaders read cannot be created.
  ***********************************************************/
-void SceneManager::PrepareScene()
+bool SceneManager::PrepareScene(const char* sceneFilename)
 {
-
-	// load the texture image files for the textures applied
-	// to objects in the 3D scene
-	LoadSceneTextures();
-	// define the materials that will be used for the objects
-	// in the 3D scene
-	DefineObjectMaterials();
-	// add and defile the light sources for the 3D scene
-	SetupSceneLights();
 	// only one instance of a particular mesh needs to be
 	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-	m_basicMeshes->LoadCylinderMesh();  // For lamp base, post, and decorative arm
-	m_basicMeshes->LoadSphereMesh();    // For lamp head
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadBoxMesh();
+	// in the rendered 3D scene, and imported meshes are added
+	// after the basic ones
+	m_basicMeshes->Load(m_bCompactVertices);
+
+	bool bSceneFile = false;
+	if (NULL != sceneFilename)
+	{
+		bSceneFile = LoadSceneFile(sceneFilename);
+		if (bSceneFile == false)
+		{
+			std::cout << "ERROR: Could not load scene file " << sceneFilename
+				<< ", using the built-in scene" << std::endl;
+		}
+	}
+
+	if (bSceneFile == false)
+	{
+		// load the texture image files for the textures applied
+		// to objects in the 3D scene
+		LoadSceneTextures();
+		// define the materials that will be used for the objects
+		// in the 3D scene
+		DefineObjectMaterials();
+		// add and defile the light sources for the 3D scene
+		SetupSceneLights();
+	}
+	m_basicMeshes->PrintStats();
+	// create the buffers the shaders read the draw data from
+	if (CreateShaderBuffers() == false)
+	{
+		std::cout << "ERROR: Could not create the shader buffers" << std::endl;
+		return(false);
+	}
+	if (bSceneFile == false)
+	{
+		// place the objects that make up the 3D scene
+		DefineSceneObjects();
+		m_pSceneObjects = m_sceneObjects.empty() ? NULL : &m_sceneObjects[0];
+		m_sceneObjectCount = (int)m_sceneObjects.size();
+	}
+	// merge the objects that never move into static batches
+	BuildStaticBatches();
+	TrackSceneBytes();
+
+	return(true);
 }
 
 /***********************************************************
- *  RenderScene()
+ *  PrepareWorld()
+ *
+ *  This method is used for preparing a world whose cells are
+ *  streamed in around the camera.  The base scene named by
+ *  the world file is loaded like any scene file, with its
+ *  textures in the first layers of the world texture array,
+ *  and its materials and meshes are handed to the streamer
+ *  for the cells to refer to by tag.  The built-in scene is
+ *  used when the world cannot be loaded.  Returns false when
+ *  the buffers the shaders read cannot be created.
+ ***********************************************************/
+bool SceneManager::PrepareWorld(const char* worldFilename)
+{
+	// the imported meshes of the base scene follow the basic ones
+	m_basicMeshes->Load(m_bCompactVertices);
+
+	m_pWorldStreamer = new WorldStreamer();
+	if ((m_pWorldStreamer->Open(worldFilename) == false) ||
+		(LoadSceneFile(m_pWorldStreamer->GetBaseFilename()) == false))
+	{
+		std::cout << "ERROR: Could not load world file " << worldFilename
+			<< ", using the built-in scene" << std::endl;
+		delete m_pWorldStreamer;
+		m_pWorldStreamer = NULL;
+		return(PrepareScene(NULL));
+	}
+
+	// the cells need the texture array even when the base scene
+	// has no textures of its own
+	if (0 == m_pWorldStreamer->GetTextureArrayID())
+	{
+		CreateWorldTextures(NULL, 0);
+		BindGLTextures();
+	}
+
+	m_basicMeshes->PrintStats();
+	if (CreateShaderBuffers() == false)
+	{
+		std::cout << "ERROR: Could not create the shader buffers" << std::endl;
+		return(false);
+	}
+	BuildStaticBatches();
+	TrackSceneBytes();
+	m_worldBaseLights = m_lightState;
+
+	std::vector<std::string> materialTags;
+	for (size_t i = 0; i < m_objectMaterials.size(); i++)
+	{
+		materialTags.push_back(m_objectMaterials[i].tag);
+	}
+	std::vector<std::string> meshTags;
+	for (int i = MESH_TYPE_COUNT; i < m_basicMeshes->GetMeshCount(); i++)
+	{
+		meshTags.push_back(m_basicMeshes->GetMeshName(i));
+	}
+	m_pWorldStreamer->Start(materialTags, meshTags, m_loadedTextures, m_pStaticBatcher);
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadMeshFile()
+ *
+ *  This method is used for importing an OBJ or glTF file on
+ *  the job system and registering it as the next mesh type
+ *  with the meshes, the static batcher and the render queue.
+ *  A file that cannot be imported still takes its mesh type,
+ *  so the types after it keep their numbers, and draws
+ *  nothing.
+ ***********************************************************/
+int SceneManager::LoadMeshFile(const char* filename, const char* tag)
+{
+	SHAPE_GEOMETRY geometry;
+	MeshImporter::IMPORT_STATS stats;
+	if (MeshImporter::ImportMesh(filename, geometry, m_pJobSystem, &stats) == true)
+	{
+		double totalMs = stats.parseMs + stats.mergeMs;
+		std::cout << "INFO: Imported mesh " << tag << " from " << filename << ": "
+			<< stats.vertexCount << " vertices, " << stats.triangleCount << " triangles in "
+			<< totalMs << " ms (" << ((stats.fileBytes / (1024.0 * 1024.0)) / (totalMs / 1000.0)) << " MB/s)" << std::endl;
+	}
+	else
+	{
+		geometry.vertices.clear();
+		geometry.indices.clear();
+	}
+
+	int meshType = m_basicMeshes->GetMeshCount();
+	m_basicMeshes->AddMesh(geometry, tag);
+	m_pStaticBatcher->AddShape(geometry);
+	m_pRenderQueue->SetMeshBounds(meshType, ShapeGeometry::ComputeBounds(geometry));
+
+	return(meshType);
+}
+
+/***********************************************************
+ *  SetCompactVertices()
+ *
+ *  This method is used for choosing whether the basic shapes
+ *  are uploaded in the 16 byte compact vertex layout.  It has
+ *  to be called before PrepareScene() loads the shapes.
+ ***********************************************************/
+void SceneManager::SetCompactVertices(bool bCompact)
+{
+	m_bCompactVertices = bCompact;
+}
+
+/***********************************************************
+ *  SetSoftwareRenderer()
+ *
+ *  This method is used for choosing whether the frames are
+ *  drawn on the CPU by the software rasterizer, which reads
+ *  the same textures, materials and shapes as the OpenGL
+ *  path.  It has to be called before PrepareScene() loads
+ *  them.
+ ***********************************************************/
+void SceneManager::SetSoftwareRenderer(bool bSoftware)
+{
+	delete m_pSoftwareRasterizer;
+	m_pSoftwareRasterizer = NULL;
+	if (bSoftware == true)
+	{
+		m_pSoftwareRasterizer = new SoftwareRasterizer(m_pJobSystem);
+		m_pSoftwareRasterizer->SetShapes(&m_pStaticBatcher->GetShapes());
+	}
+}
+
+/***********************************************************
+ *  SetLightmap()
+ *
+ *  This method is used for lighting the static objects from a
+ *  lightmap file instead of every frame.  The lightmap is
+ *  baked into the file first when bBake is set, otherwise the
+ *  file must hold a lightmap baked for the same scene and
+ *  settings.  It has to be called before PrepareScene().
+ ***********************************************************/
+void SceneManager::SetLightmap(const char* filename, bool bBake, const LightmapBaker::BAKE_SETTINGS& settings)
+{
+	m_lightmapFilename = (NULL != filename) ? filename : "";
+	m_bBakeLightmap = bBake;
+	m_lightmapSettings = settings;
+}
+
+/***********************************************************
+ *  WriteSoftwareImage()
+ *
+ *  This method is used for writing the last frame the
+ *  software rasterizer drew to a TGA file.
+ ***********************************************************/
+bool SceneManager::WriteSoftwareImage(const char* filename) const
+{
+	if (NULL == m_pSoftwareRasterizer)
+	{
+		return(false);
+	}
+
+	return(m_pSoftwareRasterizer->WriteImage(filename));
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
  *
- *  This method is used for rendering the 3D scene by
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for placing the basic 3D shapes that
+ *  make up the 3D scene.  The objects are only described
+ *  here; RenderScene() records and draws them every frame.
+ *  Every object names its own texture and material, so the
+ *  objects can be drawn in any order.
  ***********************************************************/
-void SceneManager::RenderScene() {
+void SceneManager::DefineSceneObjects() {
 	// Declare the variables for the transformations
 	glm::vec3 scaleXYZ;
 	glm::vec3 positionXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
+
+	m_sceneObjects.clear();
 
 	// Render Floor
 	scaleXYZ = glm::vec3(10.0f, -1.0f, 8.0f);  // Large plane for the floor
 	positionXYZ = glm::vec3(0.0f, -0.1f, 4.0f);
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("street");// Dark gray
-	SetShaderMaterial("Ground");
-	// Light gray floor
-	m_basicMeshes->DrawPlaneMesh();  // Render the floor
+	AddSceneObject(MESH_PLANE, scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ, "street", "Ground");
 	// Render Wall
 	scaleXYZ = glm::vec3(10.0f, 2.0f, 6.0f);  // Large wall scaled appropriately
 	positionXYZ = glm::vec3(0.0f, 5.8f, -4.0f);  // Position wall behind the lamp
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wall"); // Light brick-like color
-	SetShaderMaterial("Brick");
-	m_basicMeshes->DrawPlaneMesh();
+	AddSceneObject(MESH_PLANE, scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ, "wall", "Brick");
+	// the street lamp never moves, so its parts are merged
+	BeginStaticBatch();
 	// 3. Render Lamp Head (Sphere with Light Effect)
 	scaleXYZ = glm::vec3(-0.5f, 0.5f, 0.5f);  // Slightly smaller sphere
 	positionXYZ = glm::vec3(-0.6f, 5.5f, 0.0f);  // Hanging under the arm
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderMaterial("Lamp");
-	SetShaderTexture("lamp");
-	m_basicMeshes->DrawSphereMesh();
+	AddSceneObject(MESH_SPHERE, scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ, "lamp", "Lamp");
 	// 1. Render Lamp Base (Bottom Cylinder with Decorative Ring)
 	scaleXYZ = glm::vec3(0.6f, 0.3f, 0.6f);  // Larger base
 	positionXYZ = glm::vec3(-3.0f, 0.15f, 0.0f);  // Aligned with floor
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");// Dark gray
-	m_basicMeshes->DrawCylinderMesh();
+	AddSceneObject(MESH_CYLINDER, scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ, "bmat", "Lamp");
 
 	// 2. Render Lamp Post (Multiple Cylinders for Segments)
 	scaleXYZ = glm::vec3(0.2f, 6.0f, 0.2f);  // Tall post
 	positionXYZ = glm::vec3(-3.0f, 0.15f, 0.0f);  // Post position
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");
-	m_basicMeshes->DrawCylinderMesh();
+	AddSceneObject(MESH_CYLINDER, scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ, "bmat", "Lamp");
 
 	// Decorative section (ring at the top of the post)
 	scaleXYZ = glm::vec3(0.3f, 0.3f, 0.3f);
 	positionXYZ = glm::vec3(-3.0f, 5.0f, 0.0f);
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ);
-	SetShaderTexture("blackmat");
-	m_basicMeshes->DrawCylinderMesh();
+	AddSceneObject(MESH_CYLINDER, scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ, "bmat", "Lamp");
 	// 1. Render Lamp Holder ( Cylinder with Decorative Ring)
 	scaleXYZ = glm::vec3(0.3f, 0.3f, 0.3f);  // Larger base
 	positionXYZ = glm::vec3(-0.6f, 6.0f, 0.0f);  // Aligned with floor
-	SetTransformations(scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ);
-	SetShaderTexture("blackmat");  // Dark gray
-	m_basicMeshes->DrawCylinderMesh();
+	AddSceneObject(MESH_CYLINDER, scaleXYZ, 0.0f, 90.0f, 0.0f, positionXYZ, "bmat", "Lamp");
 
 
 	// Render Smooth Semi-Circle Decorative Arm
@@ -609,135 +1741,413 @@ void SceneManager::RenderScene() {
 			center.z
 		);
 		// Black decorative arm
-		SetShaderTexture("blackmat");
-		SetTransformations(scaleXYZ, 0.0f, glm::degrees(angle), 90.0f, positionXYZ);  // Smooth rotation
-		
-		m_basicMeshes->DrawCylinderMesh();  // Render each segment
+		AddSceneObject(MESH_CYLINDER, scaleXYZ, 0.0f, glm::degrees(angle), 90.0f, positionXYZ, "bmat", "Lamp");  // Smooth rotation
 	}
+	EndStaticBatch();
 
 
 
+	// the whole bench is drawn as one static batch
+	BeginStaticBatch();
 	// Render Bench Seat 
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.2f);  
 	positionXYZ = glm::vec3(2.0f, 1.2f, 1.0f);  
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");
-	m_basicMeshes->DrawBoxMesh();  // Part 1 seat
+	AddSceneObject(MESH_BOX, scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Part 1 seat
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.2f);  
 	positionXYZ = glm::vec3(2.0f, 1.4f, 0.77f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 45.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");
-	m_basicMeshes->DrawBoxMesh();  // Part 2 seat
+	AddSceneObject(MESH_BOX, scaleXYZ, 45.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Part 2 seat
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.2f);  
 	positionXYZ = glm::vec3(2.0f, 1.2f, 1.3f);  
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");// Part 3 seat
-	m_basicMeshes->DrawBoxMesh();  
+	AddSceneObject(MESH_BOX, scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Part 3 seat
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.2f);  
 	positionXYZ = glm::vec3(2.0f, 1.2f, 1.6f);  
-	SetTransformations(scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");// Part 4 seat
-	m_basicMeshes->DrawBoxMesh(); 
+	AddSceneObject(MESH_BOX, scaleXYZ, 0.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Part 4 seat
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.2f);  
 	positionXYZ = glm::vec3(2.0f, 1.1f, 1.9f);  
-	SetTransformations(scaleXYZ, 45.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");// Part 5 seat
-	m_basicMeshes->DrawBoxMesh(); 
+	AddSceneObject(MESH_BOX, scaleXYZ, 45.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Part 5 seat
 	// Render Bench Legs and Handlers
 	scaleXYZ = glm::vec3(0.1f, 1.0f, 0.1f);  
 	positionXYZ = glm::vec3(-0.3f, 1.1f, 1.4f);  
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp"); // Legs 2
-	m_basicMeshes->DrawBoxMesh();  // Legs support
+	AddSceneObject(MESH_BOX, scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs support
 	scaleXYZ = glm::vec3(0.1f, 1.2f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(-0.3f, 0.5f, 1.7f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 180.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Legs support
+	AddSceneObject(MESH_BOX, scaleXYZ, 180.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs support
 	scaleXYZ = glm::vec3(0.1f, 1.4f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(-0.3f, 0.5f, 0.8f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 30.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Legs 1
+	AddSceneObject(MESH_BOX, scaleXYZ, 30.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs 1
 	scaleXYZ = glm::vec3(0.1f, 1.0f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(4.3f, 1.1f, 1.4f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp"); // Legs 3
-	m_basicMeshes->DrawBoxMesh();  // Legs support
+	AddSceneObject(MESH_BOX, scaleXYZ, 90.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs support
 	scaleXYZ = glm::vec3(0.1f, 1.2f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(4.3f, 0.5f, 1.7f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 180.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Legs support
+	AddSceneObject(MESH_BOX, scaleXYZ, 180.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs support
 
 	scaleXYZ = glm::vec3(0.1f, 1.4f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(4.3f, 0.5f, 0.8f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 30.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Legs 4
+	AddSceneObject(MESH_BOX, scaleXYZ, 30.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Legs 4
 
 	// Render back seat and handlers
 	scaleXYZ = glm::vec3(0.1f, 0.7f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(-0.3f, 1.2f, 0.8f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, -40.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Upper Handler 
+	AddSceneObject(MESH_BOX, scaleXYZ, -40.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Upper Handler 
 	
 	scaleXYZ = glm::vec3(0.1f, 0.7f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(4.3f, 1.2f, 0.8f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, -40.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Upper Handler 
+	AddSceneObject(MESH_BOX, scaleXYZ, -40.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Upper Handler 
 
 	scaleXYZ = glm::vec3(0.1f, 0.8f, 0.1f);  // Wider and thicker seat
 	positionXYZ = glm::vec3(-0.3f, 1.8f, 0.57f);  // Repositioned above the floor
-	SetTransformations(scaleXYZ, 175.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Back Handler 
+	AddSceneObject(MESH_BOX, scaleXYZ, 175.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Back Handler 
 
 
 	scaleXYZ = glm::vec3(0.1f, 0.8f, 0.1f);  
 	positionXYZ = glm::vec3(4.3f, 1.8f, 0.57f); 
-	SetTransformations(scaleXYZ, 175.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("bmat");  // Black metallic texture
-	SetShaderMaterial("Lamp");
-	m_basicMeshes->DrawBoxMesh();  // Back Handler 
+	AddSceneObject(MESH_BOX, scaleXYZ, 175.0f, 0.0f, 0.0f, positionXYZ, "bmat", "Lamp");  // Back Handler 
 
 
 	scaleXYZ = glm::vec3(5.0f, 0.1f, 0.9f);  // Wider and thicker 
 	positionXYZ = glm::vec3(2.0f, 2.2f, 0.64f);  
-	SetTransformations(scaleXYZ, 85.0f, 0.0f, 0.0f, positionXYZ);
-	SetShaderTexture("wood");  // Brown wood texture
-	SetShaderMaterial("Wood");
-	m_basicMeshes->DrawBoxMesh();// Last upper part of seat
+	AddSceneObject(MESH_BOX, scaleXYZ, 85.0f, 0.0f, 0.0f, positionXYZ, "wood", "Wood");  // Last upper part of seat
+	EndStaticBatch();
+}
+
+/***********************************************************
+ *  RecordScene()
+ *
+ *  This method is used for recording the 3D scene into the
+ *  passed in frame snapshot, using the camera that is already
+ *  set in it.  The scene objects are recorded into render
+ *  commands on the job system, and the light state is copied
+ *  along so the snapshot holds everything needed to draw.
+ ***********************************************************/
+void SceneManager::RecordScene(FRAME_SNAPSHOT& snapshot)
+{
+	if (NULL == m_pWorldStreamer)
+	{
+		if ((m_scenePointLights.empty() == false) && (GatherPointLights(snapshot.viewPosition) == true))
+		{
+			m_lightVersion++;
+		}
+		RecordView(*m_pRenderQueue, snapshot);
+		return;
+	}
+
+	// the base scene and every drawn cell are recorded together,
+	// so their commands are sorted into one draw list
+	m_pWorldStreamer->Update(snapshot.viewPosition, snapshot.frameIndex);
+	const std::vector<int>& drawnSlots = m_pWorldStreamer->GetDrawnSlots();
+
+	m_recordRanges.clear();
+	RenderQueue::RECORD_RANGE range;
+	range.pObjects = m_pSceneObjects;
+	range.objectCount = m_sceneObjectCount;
+	m_recordRanges.push_back(range);
+	for (size_t i = 0; i < drawnSlots.size(); i++)
+	{
+		const std::vector<SCENE_OBJECT>& objects = m_pWorldStreamer->GetCellObjects(drawnSlots[i]);
+		if (objects.empty() == false)
+		{
+			range.pObjects = &objects[0];
+			range.objectCount = (int)objects.size();
+			m_recordRanges.push_back(range);
+		}
+	}
+
+	RecordRanges(*m_pRenderQueue, &m_recordRanges[0], (int)m_recordRanges.size(), snapshot);
+	m_pRenderQueue->TakeCommands(snapshot.commands);
+	CullStaticBatches(*m_pRenderQueue, snapshot);
+
+	snapshot.cellBatches.clear();
+	for (size_t i = 0; i < drawnSlots.size(); i++)
+	{
+		const StaticBatcher* pBatcher = m_pWorldStreamer->GetCellBatcher(drawnSlots[i]);
+		if (NULL == pBatcher)
+		{
+			continue;
+		}
+
+		const std::vector<StaticBatcher::STATIC_BATCH>& cellBatches = pBatcher->GetBatches();
+		for (size_t j = 0; j < cellBatches.size(); j++)
+		{
+			if (m_pRenderQueue->IsBoxVisible(cellBatches[j].boundsMin, cellBatches[j].boundsMax))
+			{
+				CELL_BATCH cellBatch;
+				cellBatch.cellSlot = drawnSlots[i];
+				cellBatch.batch = (int)j;
+				snapshot.cellBatches.push_back(cellBatch);
+			}
+			else
+			{
+				snapshot.objectsCulled += (uint32_t)cellBatches[j].objectCount;
+			}
+		}
+	}
+
+	// the nearest point lights of the base scene and the cells,
+	// uploaded by the render side once the version changes
+	if (m_pWorldStreamer->GatherLights(m_worldBaseLights, snapshot.viewPosition, m_lightState) == true)
+	{
+		m_lightVersion++;
+	}
+
+	snapshot.lights = m_lightState;
+	snapshot.lightVersion = m_lightVersion;
+}
+
+/***********************************************************
+ *  GatherPointLights()
+ *
+ *  This method is used for filling the point lights of the
+ *  light state with the scene file's point lights nearest the
+ *  camera, when the file has more than the shader takes.
+ *  They are only picked again once the camera has moved some
+ *  way, so the light state is not uploaded every frame.
+ *  Returns false when the lights were left as they were.
+ ***********************************************************/
+bool SceneManager::GatherPointLights(const glm::vec3& cameraPosition)
+{
+	if ((m_bPointLightsGathered == true) &&
+		(glm::length(cameraPosition - m_pointLightsPosition) < g_PointLightUpdateDistance))
+	{
+		return(false);
+	}
+	m_bPointLightsGathered = true;
+	m_pointLightsPosition = cameraPosition;
+
+	m_nearestPointLights.clear();
+	for (size_t i = 0; i < m_scenePointLights.size(); i++)
+	{
+		glm::vec3 offset = m_scenePointLights[i].position - cameraPosition;
+		m_nearestPointLights.push_back(std::make_pair(glm::dot(offset, offset), (int)i));
+	}
+
+	int lightCount = std::min((int)m_nearestPointLights.size(), MAX_POINT_LIGHTS);
+	std::partial_sort(
+		m_nearestPointLights.begin(),
+		m_nearestPointLights.begin() + lightCount,
+		m_nearestPointLights.end());
+
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		m_lightState.pointLights[i] = (i < lightCount) ?
+			m_scenePointLights[m_nearestPointLights[i].second] : POINT_LIGHT();
+	}
+
+	return(true);
+}
 
+/***********************************************************
+ *  RecordView()
+ *
+ *  This method is used for recording the scene objects into
+ *  a snapshot with the passed in queue.  It only reads the
+ *  scene, so threads with queues of their own can record
+ *  views of a single scene at once.  Streamed worlds are
+ *  recorded by RecordScene().
+ ***********************************************************/
+void SceneManager::RecordView(RenderQueue& queue, FRAME_SNAPSHOT& snapshot) const
+{
+	if (m_sceneObjectCount > 0)
+	{
+		RenderQueue::RECORD_RANGE range;
+		range.pObjects = m_pSceneObjects;
+		range.objectCount = m_sceneObjectCount;
+		RecordRanges(queue, &range, 1, snapshot);
+	}
 
+	// the snapshot's old command list is handed back to the queue
+	// so both keep their allocations from frame to frame
+	queue.TakeCommands(snapshot.commands);
+	CullStaticBatches(queue, snapshot);
+	snapshot.cellBatches.clear();
 
+	snapshot.lights = m_lightState;
+	snapshot.lightVersion = m_lightVersion;
+}
 
+/***********************************************************
+ *  RecordRanges()
+ *
+ *  This method is used for recording the objects of the
+ *  passed in ranges with a queue, culled against the camera
+ *  of the snapshot, or against all of its views when it is
+ *  drawn from several cameras at once.
+ ***********************************************************/
+void SceneManager::RecordRanges(
+	RenderQueue& queue,
+	const RenderQueue::RECORD_RANGE* pRanges,
+	int rangeCount,
+	const FRAME_SNAPSHOT& snapshot) const
+{
+	if (snapshot.viewCount <= 1)
+	{
+		queue.Record(pRanges, rangeCount, snapshot.view, snapshot.projection, snapshot.viewPosition);
+		return;
+	}
 
+	RenderQueue::RECORD_VIEW recordViews[SceneView::MAX_VIEWS];
+	for (int i = 0; i < snapshot.viewCount; i++)
+	{
+		recordViews[i].view = snapshot.views[i].view;
+		recordViews[i].projection = snapshot.views[i].projection;
+		recordViews[i].cameraPosition = snapshot.views[i].viewPosition;
+	}
+	queue.Record(pRanges, rangeCount, recordViews, snapshot.viewCount);
+}
 
+/***********************************************************
+ *  CullStaticBatches()
+ *
+ *  This method is used for culling the static batches as a
+ *  whole by their bounds, against the frustums of the last
+ *  recording of the passed in queue.
+ ***********************************************************/
+void SceneManager::CullStaticBatches(const RenderQueue& queue, FRAME_SNAPSHOT& snapshot) const
+{
+	const std::vector<StaticBatcher::STATIC_BATCH>& batches = m_pStaticBatcher->GetBatches();
+	const RenderQueue::RECORD_STATS& stats = queue.GetStats();
+	snapshot.objectsCulled = (uint32_t)(stats.objectsFrustumCulled + stats.objectsDetailCulled);
+	snapshot.staticBatches.clear();
+	for (size_t i = 0; i < batches.size(); i++)
+	{
+		if (queue.IsBoxVisible(batches[i].boundsMin, batches[i].boundsMax))
+		{
+			snapshot.staticBatches.push_back((int)i);
+		}
+		else
+		{
+			snapshot.objectsCulled += (uint32_t)batches[i].objectCount;
+		}
+	}
+}
 
+/***********************************************************
+ *  CreateRenderQueue()
+ *
+ *  This method is used for creating a queue that records the
+ *  scene like the scene manager's own, for a thread that
+ *  records views of its own.  The queue records on the
+ *  calling thread.
+ ***********************************************************/
+RenderQueue* SceneManager::CreateRenderQueue() const
+{
+	RenderQueue* pQueue = new RenderQueue(NULL);
+	pQueue->CopySettings(*m_pRenderQueue);
 
+	return(pQueue);
+}
 
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering a recorded frame of the
+ *  3D scene.  It must be called on the thread that owns the
+ *  OpenGL context.
+ ***********************************************************/
+void SceneManager::RenderScene(const FRAME_SNAPSHOT& snapshot)
+{
+	if (snapshot.lightVersion != m_appliedLightVersion)
+	{
+		ApplyLights(snapshot.lights);
+		m_appliedLightVersion = snapshot.lightVersion;
+	}
 
+	// upload the cells that finished decoding, within the budget
+	// of a frame, so they are drawn from the next recorded frame
+	if (NULL != m_pWorldStreamer)
+	{
+		m_pWorldStreamer->ProcessUploads(snapshot.frameIndex, snapshot.viewPosition);
+		// every uploaded layer binds the texture array
+		WorldStreamer::STREAM_STATS streamStats = m_pWorldStreamer->GetStats();
+		m_pRenderCounters->Add(RenderCounters::COUNTER_BUFFER_BYTES, streamStats.uploadBytes);
+		m_pRenderCounters->Add(RenderCounters::COUNTER_TEXTURE_BINDS, streamStats.uploadLayers);
+	}
+	m_pRenderCounters->Add(RenderCounters::COUNTER_OBJECTS_CULLED, snapshot.objectsCulled);
 
+	if (NULL != m_pSoftwareRasterizer)
+	{
+		RenderSoftware(snapshot);
+		return;
+	}
 
+	SubmitRenderCommands(snapshot);
+	SubmitCellBatches(snapshot.cellBatches, snapshot.viewCount);
+}
 
+/***********************************************************
+ *  RenderSoftware()
+ *
+ *  This method is used for drawing a recorded frame on the
+ *  CPU and for blitting it into the window.
+ ***********************************************************/
+void SceneManager::RenderSoftware(const FRAME_SNAPSHOT& snapshot)
+{
+	BuildRasterDraws(snapshot, m_rasterDraws);
+	m_pSoftwareRasterizer->Render(
+		m_rasterDraws.empty() ? NULL : &m_rasterDraws[0],
+		(int)m_rasterDraws.size(),
+		snapshot);
+	m_pSoftwareRasterizer->Present(snapshot.framebufferWidth, snapshot.framebufferHeight);
+
+	// a draw is a mesh drawn on the CPU, and the frame is uploaded
+	// into the present texture
+	for (size_t i = 0; i < m_rasterDraws.size(); i++)
+	{
+		m_pRenderCounters->AddDraw(m_basicMeshes->GetStats(m_rasterDraws[i].meshType).triangleCount);
+	}
+	m_pRenderCounters->Add(RenderCounters::COUNTER_TEXTURE_BINDS);
+	m_pRenderCounters->Add(RenderCounters::COUNTER_BUFFER_BYTES,
+		(uint64_t)m_pSoftwareRasterizer->GetWidth() * m_pSoftwareRasterizer->GetHeight() * 4);
+}
 
+/***********************************************************
+ *  BuildRasterDraws()
+ *
+ *  This method is used for listing the draws of a recorded
+ *  frame for the software rasterizer, the objects of the
+ *  visible static batches and then the render commands.
+ ***********************************************************/
+void SceneManager::BuildRasterDraws(
+	const FRAME_SNAPSHOT& snapshot,
+	std::vector<SoftwareRasterizer::RASTER_DRAW>& draws) const
+{
+	draws.clear();
+	for (size_t i = 0; i < snapshot.staticBatches.size(); i++)
+	{
+		int batch = snapshot.staticBatches[i];
+		if ((batch < 0) || (batch + 1 >= (int)m_staticRasterFirst.size()))
+		{
+			continue;
+		}
+		draws.insert(
+			draws.end(),
+			m_staticRasterDraws.begin() + m_staticRasterFirst[batch],
+			m_staticRasterDraws.begin() + m_staticRasterFirst[batch + 1]);
+	}
 
+	for (size_t i = 0; i < snapshot.commands.size(); i++)
+	{
+		const RENDER_COMMAND& command = snapshot.commands[i];
+
+		SoftwareRasterizer::RASTER_DRAW draw;
+		draw.model = command.model;
+		draw.normalMatrix = command.normalMatrix;
+		draw.uvScale = command.uvScale;
+		draw.materialIndex = command.materialIndex;
+		draw.textureLayer = GetTextureLayer(command.textureSlot);
+		draw.meshType = command.meshType;
+		draws.push_back(draw);
+	}
+}
 
+/***********************************************************
+ *  GetSoftwareRasterizer()
+ *
+ *  This method is used for getting the software rasterizer,
+ *  whose assets other rasterizers can share, or NULL when
+ *  OpenGL draws the frames.
+ ***********************************************************/
+const SoftwareRasterizer* SceneManager::GetSoftwareRasterizer() const
+{
+	return(m_pSoftwareRasterizer);
 }
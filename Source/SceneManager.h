@@ -10,11 +10,25 @@
 #pragma once
 
 #include "ShaderManager.h"
-#include "ShapeMeshes.h"
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "SceneObject.h"
+#include "FrameSnapshot.h"
+#include "StreamBuffer.h"
+#include "StaticBatcher.h"
+#include "PrimitiveMeshes.h"
+#include "SceneFile.h"
+#include "SoftwareRasterizer.h"
+#include "LightUniforms.h"
+#include "LightmapBaker.h"
+#include "RenderCounters.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
+class WorldStreamer;
+
 /***********************************************************
  *  SceneManager
  *
@@ -25,7 +39,7 @@ class SceneManager
 {
 public:
 	// constructor
-	SceneManager(ShaderManager *pShaderManager);
+	SceneManager(ShaderManager *pShaderManager, JobSystem* pJobSystem = NULL);
 	// destructor
 	~SceneManager();
 
@@ -33,6 +47,8 @@ public:
 	{
 		std::string tag;
 		uint32_t ID;
+		// layer in the texture array, -1 when the image did not load
+		int layer;
 	};
 
 	struct OBJECT_MATERIAL
@@ -43,20 +59,138 @@ public:
 		std::string tag;
 	};
 
+	struct TEXTURE_IMAGE
+	{
+		const char* filename;
+		std::string tag;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int colorChannels;
+	};
+
+	// resample a decoded image into a square RGBA texture array layer
+	static void ResampleImage(const TEXTURE_IMAGE& image, unsigned char* pLayer, int layerSize);
+
 private:
+	// per-draw data read by the shaders, laid out for std430
+	struct DRAW_DATA
+	{
+		glm::mat4 model;
+		// columns of the normal matrix, each padded to a vec4 as
+		// std430 lays out a mat3
+		glm::vec4 normalMatrix[3];
+		glm::vec2 uvScale;
+		int materialIndex;
+		int textureSlot;
+	};
+
+	// material data read by the shaders, laid out for std430
+	struct MATERIAL_DATA
+	{
+		glm::vec4 diffuseColor;
+		glm::vec4 specularColorShininess;
+	};
+
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
+	PrimitiveMeshes* m_basicMeshes;
+	// upload the basic shapes in the compact vertex layout
+	bool m_bCompactVertices;
+	// pointer to the job system for work spread across cores
+	JobSystem* m_pJobSystem;
 	// total number of loaded textures
 	int m_loadedTextures;
 	// loaded textures info
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// objects placed in the 3D scene by DefineSceneObjects()
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// mapped scene file, when the scene is loaded from one
+	SceneFile* m_pSceneFile;
+	// objects that are drawn, from the scene file or the list above
+	const SCENE_OBJECT* m_pSceneObjects;
+	int m_sceneObjectCount;
+	// records the scene objects into render commands
+	RenderQueue* m_pRenderQueue;
+	// light sources of the 3D scene, the version is raised on
+	// every change so the render side knows when to upload them
+	LIGHT_STATE m_lightState;
+	uint32_t m_lightVersion;
+	uint32_t m_appliedLightVersion;
+	// uniforms the light state was last packed into
+	std::vector<LightUniforms::LIGHT_UNIFORM> m_lightUniforms;
+	// point lights of a scene file with more of them than the shader
+	// takes, the nearest to the camera are put in the light state
+	std::vector<POINT_LIGHT> m_scenePointLights;
+	std::vector<std::pair<float, int> > m_nearestPointLights;
+	glm::vec3 m_pointLightsPosition;
+	bool m_bPointLightsGathered;
+	// streamed per-draw data
+	StreamBuffer* m_pDrawBuffer;
+	// material data, uploaded once
+	GLuint m_materialBufferID;
+	// merged geometry of the static objects
+	StaticBatcher* m_pStaticBatcher;
+	// draw data of the static objects, the same every frame
+	std::vector<DRAW_DATA> m_staticDrawData;
+	// lightmap of the static batches, baked or read from the file
+	// while the batches are built, and the program that draws
+	// the batches with it; NULL when they are lit per frame
+	std::string m_lightmapFilename;
+	bool m_bBakeLightmap;
+	LightmapBaker::BAKE_SETTINGS m_lightmapSettings;
+	GLuint m_lightmapTextureID;
+	ShaderManager* m_pLightmapShader;
+	// batch group given to added objects, -1 when they can move
+	int m_currentBatchGroup;
+	int m_batchGroupCount;
+
+	// per-draw data of the static batches of a streamed cell
+	struct CELL_DRAW_BUFFER
+	{
+		GLuint bufferID;
+		// generation of the cell slot the data was built for
+		uint32_t generation;
+	};
+
+	// streams the cells of a world around the camera, NULL when
+	// a single scene is drawn
+	WorldStreamer* m_pWorldStreamer;
+	// the base scene and the drawn cells, recorded together
+	std::vector<RenderQueue::RECORD_RANGE> m_recordRanges;
+	// lights of the base scene, before the cell lights are added
+	LIGHT_STATE m_worldBaseLights;
+	// one buffer per cell slot
+	std::vector<CELL_DRAW_BUFFER> m_cellDrawBuffers;
 
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
+	// draws the frames on the CPU, NULL when OpenGL draws them
+	SoftwareRasterizer* m_pSoftwareRasterizer;
+	// draws of the static objects, in the order of the static
+	// batches, and the first draw of every batch
+	std::vector<SoftwareRasterizer::RASTER_DRAW> m_staticRasterDraws;
+	std::vector<int> m_staticRasterFirst;
+	// draws of the frame being drawn on the CPU
+	std::vector<SoftwareRasterizer::RASTER_DRAW> m_rasterDraws;
+	// work of the drawn frames, counted as it is submitted
+	RenderCounters* m_pRenderCounters;
+
+	// decode texture images in parallel and load them into a texture array
+	bool CreateGLTextures(TEXTURE_IMAGE* pImages, int count);
+	// register loaded images in order with their texture array layers
+	void RegisterTextures(
+		const TEXTURE_IMAGE* pImages,
+		int count,
+		uint32_t textureID,
+		const std::vector<int>& layerImages);
+	// load the base scene images into the world texture array
+	bool CreateWorldTextures(TEXTURE_IMAGE* pImages, int count);
+	// texture array layer of a texture slot
+	int GetTextureLayer(int textureSlot) const;
+	// write the model and normal matrices of a draw
+	static void SetDrawTransform(DRAW_DATA& drawData, const glm::mat4& model, const glm::mat3& normalMatrix);
 	// bind loaded OpenGL textures to slots in memory
 	void BindGLTextures();
 	// free the loaded OpenGL textures
@@ -66,47 +200,104 @@ private:
 	int FindTextureSlot(std::string tag);
 	// find a defined material by tag
 	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
+	int FindMaterialIndex(std::string tag);
 
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
+	// add an object to the 3D scene
+	void AddSceneObject(
+		int meshType,
 		glm::vec3 scaleXYZ,
 		float XrotationDegrees,
 		float YrotationDegrees,
 		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
-
-	// set the texture data into the shader
-	void SetShaderTexture(
-		std::string textureTag);
-
-	// set the UV scale for the texture mapping
-	void SetTextureUVScale(
-		float u, float v);
-
-	// set the object material into the shader
-	void SetShaderMaterial(
+		glm::vec3 positionXYZ,
+		std::string textureTag,
 		std::string materialTag);
+	// group the objects added in between into one static batch
+	void BeginStaticBatch();
+	void EndStaticBatch();
+	// merge the static objects into their batches
+	void BuildStaticBatches();
+	// bake or read the lightmap of the merged static objects
+	bool PrepareLightmap();
+	// report the memory of the objects, materials and lights
+	void TrackSceneBytes();
+	// draw one of the basic or imported meshes, once per view
+	void DrawMesh(int meshType, int viewCount = 1);
+	// create the buffers the shaders read the draw data from
+	bool CreateShaderBuffers();
+	// draw the static batches and the recorded render commands
+	void SubmitRenderCommands(const FRAME_SNAPSHOT& snapshot);
+	// draw the visible static batches of the streamed cells
+	void SubmitCellBatches(const std::vector<CELL_BATCH>& cellBatches, int viewCount);
+	// draw the static batches and render commands on the CPU
+	void RenderSoftware(const FRAME_SNAPSHOT& snapshot);
+	// record the objects of the ranges against every view of a snapshot
+	void RecordRanges(
+		RenderQueue& queue,
+		const RenderQueue::RECORD_RANGE* pRanges,
+		int rangeCount,
+		const FRAME_SNAPSHOT& snapshot) const;
+	// cull the static batches against the last recorded frustum
+	void CullStaticBatches(const RenderQueue& queue, FRAME_SNAPSHOT& snapshot) const;
+	// pass the light sources into the shaders
+	void ApplyLights(const LIGHT_STATE& lights);
+	// set the packed light uniforms on one shader program
+	void SetLightUniforms(ShaderManager* pShader);
+	// keep new light sources and pass them into the shader
+	void SetLights(const LIGHT_STATE& lights);
+	// put the scene file's point lights nearest the camera in the
+	// light state, returns false when they have not changed
+	bool GatherPointLights(const glm::vec3& cameraPosition);
+	// load the textures, materials, lights and meshes of a scene file
+	bool LoadSceneFile(const char* filename);
 
 public:
 
 	// The following methods are for the students to 
 	// customize for their own 3D scene
-	void PrepareScene();
-	void RenderScene();
+	bool PrepareScene(const char* sceneFilename = NULL);
+	// prepare a world whose cells are streamed around the camera,
+	// from a world file that names its base scene and cells
+	bool PrepareWorld(const char* worldFilename);
+	// choose the vertex layout of the basic shapes, before PrepareScene()
+	void SetCompactVertices(bool bCompact);
+	// draw the frames on the CPU instead of with OpenGL, before
+	// PrepareScene()
+	void SetSoftwareRenderer(bool bSoftware);
+	// light the static objects from a lightmap file, baking it
+	// first when bBake is set, before PrepareScene()
+	void SetLightmap(const char* filename, bool bBake, const LightmapBaker::BAKE_SETTINGS& settings);
+	// write the last frame drawn on the CPU to a TGA file
+	bool WriteSoftwareImage(const char* filename) const;
+	// import a mesh file as the next mesh type and return the type,
+	// once the basic shapes are loaded
+	int LoadMeshFile(const char* filename, const char* tag);
+	// record the 3D scene into a frame snapshot
+	void RecordScene(FRAME_SNAPSHOT& snapshot);
+	// record the scene objects with a queue of the calling thread
+	void RecordView(RenderQueue& queue, FRAME_SNAPSHOT& snapshot) const;
+	// create a queue that records like the scene manager's own
+	RenderQueue* CreateRenderQueue() const;
+	// list the draws of a recorded frame for the software rasterizer
+	void BuildRasterDraws(
+		const FRAME_SNAPSHOT& snapshot,
+		std::vector<SoftwareRasterizer::RASTER_DRAW>& draws) const;
+	// software rasterizer, NULL when OpenGL draws the frames
+	const SoftwareRasterizer* GetSoftwareRasterizer() const;
+	// draw a recorded frame on the GL thread
+	void RenderScene(const FRAME_SNAPSHOT& snapshot);
 	//Load the texures into the scene 
 	void LoadSceneTextures();	
 	// define all the object materials before rendering
 	void DefineObjectMaterials();
 	// add and define the light sources before rendering
 	void SetupSceneLights();
+	// place the objects that make up the 3D scene
+	void DefineSceneObjects();
+	// print the counts and timings of the last recording
+	void PrintRenderStats();
+	// counters of the drawn frames, which belong to the GL thread
+	RenderCounters* GetRenderCounters();
 
 
 
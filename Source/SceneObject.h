@@ -0,0 +1,58 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneobject.h
+// ============
+// plain data description of the objects placed in the 3D scene
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+// basic shapes that scene objects are drawn with, imported meshes
+// take the mesh types from MESH_TYPE_COUNT on
+enum MESH_TYPE
+{
+	MESH_PLANE,
+	MESH_BOX,
+	MESH_CYLINDER,
+	MESH_SPHERE,
+	MESH_TYPE_COUNT
+};
+
+// flags of a scene object
+enum SCENE_OBJECT_FLAGS
+{
+	// the object never moves, so it is merged into a static batch
+	SCENE_OBJECT_STATIC = 1
+};
+
+/***********************************************************
+ *  SCENE_OBJECT
+ *
+ *  One object in the 3D scene.  The transform is kept in the
+ *  scale, rotation and position form the scene is written in,
+ *  and the model matrix is composed from it when the object
+ *  is recorded for drawing.  An object with a parent is
+ *  placed relative to it, and parents always come before
+ *  their children.  Static objects with the same batch group
+ *  are merged and drawn together.
+ *
+ *  The structure only holds 32-bit floats and integers, so
+ *  scene files store it as it is and use it in place.
+ ***********************************************************/
+struct SCENE_OBJECT
+{
+	glm::vec3 scaleXYZ;
+	glm::vec3 rotationDegrees;
+	glm::vec3 positionXYZ;
+	glm::vec2 uvScale;
+	int meshType;
+	int textureSlot;
+	int materialIndex;
+	uint32_t flags;
+	int batchGroup;
+	// index of the parent object, -1 for none
+	int parentIndex;
+};
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneview.cpp
+// ============
+// build the view and projection matrices of a frame from the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneView.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	// clip planes of the perspective projection
+	const float g_PerspectiveNear = 0.1f;
+	const float g_PerspectiveFar = 100.0f;
+
+	// the orthographic view is locked to a fixed camera that looks
+	// at the center of the scene
+	const glm::vec3 g_OrthographicPosition = glm::vec3(0.0f, 4.0f, 15.0f);
+	const glm::vec3 g_OrthographicTarget = glm::vec3(0.0f, 4.0f, 0.0f);
+	const glm::vec3 g_OrthographicUp = glm::vec3(0.0f, 2.0f, 0.0f);
+	// half the width of the orthographic view, before the aspect
+	// ratio, and its bottom, top and depth range
+	const float g_OrthographicScale = 10.0f;
+	const float g_OrthographicBottom = -3.5f;
+	const float g_OrthographicTop = g_OrthographicScale + 1.0f;
+	const float g_OrthographicNear = -10.0f;
+	const float g_OrthographicFar = 20.0f;
+
+	// the top-down views look straight down from above the scene, the
+	// fixed one at its center and the other one at the camera
+	const glm::vec3 g_TopDownCenter = glm::vec3(0.0f, 0.0f, 0.0f);
+	const float g_TopDownHeight = 30.0f;
+	const float g_TopDownNear = 0.1f;
+	const float g_TopDownFar = 60.0f;
+	// half the height of the fixed top-down view, and of the one
+	// following the camera
+	const float g_TopDownScale = 12.0f;
+	const float g_TopDownFollowScale = 6.0f;
+
+	// the camera turns around the world up axis, and does not pitch
+	// past looking straight up or down
+	const glm::vec3 g_WorldUp = glm::vec3(0.0f, 1.0f, 0.0f);
+	const float g_MaxPitch = 89.0f;
+}
+
+/***********************************************************
+ *  Compute()
+ *
+ *  This method is used for building the view and projection
+ *  of a frame.  The perspective view follows the camera, with
+ *  its position blended between the last two update steps.
+ *  The orthographic view is locked to a fixed camera, but the
+ *  view position is still the blended camera position.
+ ***********************************************************/
+void SceneView::Compute(
+	const CAMERA_VIEW& camera,
+	float interpolation,
+	glm::mat4& view,
+	glm::mat4& projection,
+	glm::vec3& viewPosition)
+{
+	viewPosition = glm::mix(camera.previousPosition, camera.position, interpolation);
+
+	if (camera.bOrthographic == false)
+	{
+		projection = glm::perspective(
+			glm::radians(camera.zoom),
+			camera.aspectRatio,
+			g_PerspectiveNear,
+			g_PerspectiveFar);
+		view = glm::lookAt(viewPosition, viewPosition + camera.front, camera.up);
+	}
+	else
+	{
+		view = glm::lookAt(g_OrthographicPosition, g_OrthographicTarget, g_OrthographicUp);
+		projection = glm::ortho(
+			-g_OrthographicScale * camera.aspectRatio,
+			g_OrthographicScale * camera.aspectRatio,
+			g_OrthographicBottom,
+			g_OrthographicTop,
+			g_OrthographicNear,
+			g_OrthographicFar);
+	}
+}
+
+/***********************************************************
+ *  ComputeViews()
+ *
+ *  This method is used for building the views of a frame that
+ *  shows the scene from several cameras at once.  Two views
+ *  sit side by side, more are laid out two by two, and every
+ *  projection is built for the shape of its own rectangle.
+ *  The first view is always the perspective camera, so the
+ *  views of a frame keep the camera's depth order.
+ ***********************************************************/
+void SceneView::ComputeViews(
+	const CAMERA_VIEW& camera,
+	float interpolation,
+	int viewCount,
+	FRAME_VIEW* pViews)
+{
+	viewCount = glm::clamp(viewCount, 1, (int)MAX_VIEWS);
+	int columns = (viewCount <= 2) ? viewCount : 2;
+	int rows = (viewCount + columns - 1) / columns;
+
+	CAMERA_VIEW rectCamera = camera;
+	rectCamera.aspectRatio = camera.aspectRatio * (float)rows / (float)columns;
+	glm::vec3 cameraPosition = glm::mix(camera.previousPosition, camera.position, interpolation);
+
+	for (int i = 0; i < viewCount; i++)
+	{
+		FRAME_VIEW& frameView = pViews[i];
+		int column = i % columns;
+		int row = i / columns;
+		frameView.rectScale = glm::vec2(1.0f / (float)columns, 1.0f / (float)rows);
+		frameView.rectCenter = glm::vec2(
+			-1.0f + (float)(2 * column + 1) * frameView.rectScale.x,
+			1.0f - (float)(2 * row + 1) * frameView.rectScale.y);
+
+		switch (i)
+		{
+		case 0:
+			// the camera itself
+			rectCamera.bOrthographic = false;
+			Compute(rectCamera, interpolation, frameView.view, frameView.projection, frameView.viewPosition);
+			break;
+		case 1:
+			// the locked orthographic camera
+			rectCamera.bOrthographic = true;
+			Compute(rectCamera, interpolation, frameView.view, frameView.projection, frameView.viewPosition);
+			frameView.viewPosition = g_OrthographicPosition;
+			break;
+		case 2:
+			// the whole scene from above
+			frameView.viewPosition = g_TopDownCenter + glm::vec3(0.0f, g_TopDownHeight, 0.0f);
+			frameView.view = glm::lookAt(frameView.viewPosition, g_TopDownCenter, glm::vec3(0.0f, 0.0f, -1.0f));
+			frameView.projection = glm::ortho(
+				-g_TopDownScale * rectCamera.aspectRatio,
+				g_TopDownScale * rectCamera.aspectRatio,
+				-g_TopDownScale,
+				g_TopDownScale,
+				g_TopDownNear,
+				g_TopDownFar);
+			break;
+		default:
+		{
+			// the ground around the camera from above, turned so the
+			// camera looks up the rectangle
+			glm::vec3 forward = glm::vec3(camera.front.x, 0.0f, camera.front.z);
+			forward = (glm::dot(forward, forward) > 1e-6f) ? glm::normalize(forward) : glm::vec3(0.0f, 0.0f, -1.0f);
+			frameView.viewPosition = cameraPosition + glm::vec3(0.0f, g_TopDownHeight, 0.0f);
+			frameView.view = glm::lookAt(frameView.viewPosition, cameraPosition, forward);
+			frameView.projection = glm::ortho(
+				-g_TopDownFollowScale * rectCamera.aspectRatio,
+				g_TopDownFollowScale * rectCamera.aspectRatio,
+				-g_TopDownFollowScale,
+				g_TopDownFollowScale,
+				g_TopDownNear,
+				g_TopDownFar);
+			break;
+		}
+		}
+	}
+}
+
+/***********************************************************
+ *  Turn()
+ *
+ *  This method is used for turning the camera by a mouse
+ *  movement, already scaled to degrees, from the passed in
+ *  angles.  It follows the camera's mouse handling, so a view
+ *  turned here matches the camera once the update step has
+ *  taken in the same movement.
+ ***********************************************************/
+void SceneView::Turn(
+	CAMERA_VIEW& camera,
+	float yaw,
+	float pitch,
+	const glm::vec2& degrees)
+{
+	yaw += degrees.x;
+	pitch = glm::clamp(pitch + degrees.y, -g_MaxPitch, g_MaxPitch);
+
+	glm::vec3 front;
+	front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
+	front.y = sin(glm::radians(pitch));
+	front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
+	camera.front = glm::normalize(front);
+
+	glm::vec3 right = glm::normalize(glm::cross(camera.front, g_WorldUp));
+	camera.up = glm::normalize(glm::cross(right, camera.front));
+}
@@ -0,0 +1,97 @@
+///////////////////////////////////////////////////////////////////////////////
+// sceneview.h
+// ============
+// build the view and projection matrices of a frame from the camera
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+/***********************************************************
+ *  SceneView
+ *
+ *  This class builds the view and projection of a frame from
+ *  the camera, as the view manager draws the scene.  It does
+ *  not use OpenGL or the window, so the math can be run and
+ *  measured on its own.
+ ***********************************************************/
+class SceneView
+{
+public:
+	struct CAMERA_VIEW
+	{
+		// camera positions of the last two fixed update steps
+		glm::vec3 previousPosition;
+		glm::vec3 position;
+		glm::vec3 front;
+		glm::vec3 up;
+		// vertical field of view in degrees
+		float zoom;
+		bool bOrthographic;
+		float aspectRatio;
+	};
+
+	// the camera of a recorded frame, kept with the frame so its view
+	// can be turned again by the mouse movement that arrives before
+	// the frame is drawn
+	struct CAMERA_LATCH
+	{
+		CAMERA_VIEW camera;
+		float interpolation;
+		// camera angles in degrees, and the degrees turned per unit
+		// of mouse movement
+		float yaw;
+		float pitch;
+		float mouseSensitivity;
+		// the last mouse event, and the sum of the mouse movement,
+		// that the camera had taken in when the frame was recorded
+		uint64_t inputSerial;
+		double mouseX;
+		double mouseY;
+		// turn the view by the newer mouse movement before drawing
+		bool bLateLatch;
+	};
+
+	// views of the review station, drawn side by side in one pass
+	static const int MAX_VIEWS = 4;
+
+	// one of the views drawn in the same pass
+	struct FRAME_VIEW
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPosition;
+		// where the view lands in the window, as the center and half
+		// size of its rectangle in normalized device coordinates
+		glm::vec2 rectCenter;
+		glm::vec2 rectScale;
+	};
+
+	// build the view and projection, with the camera position blended
+	// between the last two update steps
+	static void Compute(
+		const CAMERA_VIEW& camera,
+		float interpolation,
+		glm::mat4& view,
+		glm::mat4& projection,
+		glm::vec3& viewPosition);
+	// build the views of a multi-view frame, laid out on a grid over
+	// the window - the perspective camera, the locked orthographic
+	// camera, a top-down view of the whole scene and a top-down view
+	// that follows the camera
+	static void ComputeViews(
+		const CAMERA_VIEW& camera,
+		float interpolation,
+		int viewCount,
+		FRAME_VIEW* pViews);
+	// turn the camera by a mouse movement in degrees, the way the
+	// camera's own mouse handling does
+	static void Turn(
+		CAMERA_VIEW& camera,
+		float yaw,
+		float pitch,
+		const glm::vec2& degrees);
+};
@@ -0,0 +1,287 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.cpp
+// ============
+// build the vertex and index data of the basic shapes on the CPU, in the
+// same local space as the meshes drawn by ShapeMeshes
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShapeGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+// declaration of global variables
+namespace
+{
+	const float g_Pi = 3.14159265358979f;
+
+	SHAPE_VERTEX MakeVertex(glm::vec3 position, glm::vec3 normal, glm::vec2 textureCoordinate)
+	{
+		SHAPE_VERTEX vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.textureCoordinate = textureCoordinate;
+		return(vertex);
+	}
+}
+
+/***********************************************************
+ *  BuildShape()
+ *
+ *  This method is used for building the geometry of one of
+ *  the basic mesh types.
+ ***********************************************************/
+bool ShapeGeometry::BuildShape(int meshType, SHAPE_GEOMETRY& geometry)
+{
+	geometry.vertices.clear();
+	geometry.indices.clear();
+
+	switch (meshType)
+	{
+	case MESH_PLANE:
+		BuildPlane(geometry);
+		return(true);
+	case MESH_BOX:
+		BuildBox(geometry);
+		return(true);
+	case MESH_CYLINDER:
+		BuildCylinder(geometry);
+		return(true);
+	case MESH_SPHERE:
+		BuildSphere(geometry);
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  ComputeBounds()
+ *
+ *  This method is used for getting a bounding sphere around
+ *  the vertices, centered on their bounding box.  It is not
+ *  the smallest sphere, but close enough for culling.
+ ***********************************************************/
+glm::vec4 ShapeGeometry::ComputeBounds(const SHAPE_GEOMETRY& geometry)
+{
+	if (geometry.vertices.empty() == true)
+	{
+		return(glm::vec4(0.0f, 0.0f, 0.0f, 0.0f));
+	}
+
+	glm::vec3 boundsMin = geometry.vertices[0].position;
+	glm::vec3 boundsMax = geometry.vertices[0].position;
+	for (size_t i = 1; i < geometry.vertices.size(); i++)
+	{
+		boundsMin = glm::min(boundsMin, geometry.vertices[i].position);
+		boundsMax = glm::max(boundsMax, geometry.vertices[i].position);
+	}
+
+	glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = 0; i < geometry.vertices.size(); i++)
+	{
+		radius = std::max(radius, glm::length(geometry.vertices[i].position - center));
+	}
+
+	return(glm::vec4(center, radius));
+}
+
+/***********************************************************
+ *  AddQuad()
+ *
+ *  This method is used for adding a quad as two triangles.
+ ***********************************************************/
+void ShapeGeometry::AddQuad(
+	SHAPE_GEOMETRY& geometry,
+	const SHAPE_VERTEX& v0,
+	const SHAPE_VERTEX& v1,
+	const SHAPE_VERTEX& v2,
+	const SHAPE_VERTEX& v3)
+{
+	uint32_t base = (uint32_t)geometry.vertices.size();
+
+	geometry.vertices.push_back(v0);
+	geometry.vertices.push_back(v1);
+	geometry.vertices.push_back(v2);
+	geometry.vertices.push_back(v3);
+
+	geometry.indices.push_back(base + 0);
+	geometry.indices.push_back(base + 1);
+	geometry.indices.push_back(base + 2);
+	geometry.indices.push_back(base + 0);
+	geometry.indices.push_back(base + 2);
+	geometry.indices.push_back(base + 3);
+}
+
+/***********************************************************
+ *  BuildPlane()
+ *
+ *  This method is used for building a plane from -1 to 1 in
+ *  x and z, facing up the y axis.
+ ***********************************************************/
+void ShapeGeometry::BuildPlane(SHAPE_GEOMETRY& geometry)
+{
+	glm::vec3 up(0.0f, 1.0f, 0.0f);
+
+	AddQuad(geometry,
+		MakeVertex(glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f)),
+		MakeVertex(glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f)),
+		MakeVertex(glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f)),
+		MakeVertex(glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f)));
+}
+
+/***********************************************************
+ *  BuildBox()
+ *
+ *  This method is used for building a unit box centered on
+ *  the origin.  Every face has its own vertices so the faces
+ *  keep flat normals and the full texture.
+ ***********************************************************/
+void ShapeGeometry::BuildBox(SHAPE_GEOMETRY& geometry)
+{
+	// normal, and the right and up directions of each face
+	const glm::vec3 faces[6][3] =
+	{
+		{ glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+		{ glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) }
+	};
+
+	for (int i = 0; i < 6; i++)
+	{
+		glm::vec3 normal = faces[i][0];
+		glm::vec3 center = normal * 0.5f;
+		glm::vec3 right = faces[i][1] * 0.5f;
+		glm::vec3 up = faces[i][2] * 0.5f;
+
+		AddQuad(geometry,
+			MakeVertex(center - right - up, normal, glm::vec2(0.0f, 0.0f)),
+			MakeVertex(center + right - up, normal, glm::vec2(1.0f, 0.0f)),
+			MakeVertex(center + right + up, normal, glm::vec2(1.0f, 1.0f)),
+			MakeVertex(center - right + up, normal, glm::vec2(0.0f, 1.0f)));
+	}
+}
+
+/***********************************************************
+ *  BuildCylinder()
+ *
+ *  This method is used for building a cylinder of radius 1
+ *  from 0 to 1 in y, with its top and bottom caps.
+ ***********************************************************/
+void ShapeGeometry::BuildCylinder(SHAPE_GEOMETRY& geometry)
+{
+	// sides, with the seam vertices doubled for the texture wrap
+	uint32_t sideBase = (uint32_t)geometry.vertices.size();
+	for (int i = 0; i <= ROUND_SEGMENTS; i++)
+	{
+		float u = (float)i / ROUND_SEGMENTS;
+		float angle = u * 2.0f * g_Pi;
+		glm::vec3 normal(cos(angle), 0.0f, -sin(angle));
+
+		geometry.vertices.push_back(MakeVertex(normal, normal, glm::vec2(u, 0.0f)));
+		geometry.vertices.push_back(MakeVertex(normal + glm::vec3(0.0f, 1.0f, 0.0f), normal, glm::vec2(u, 1.0f)));
+	}
+	for (int i = 0; i < ROUND_SEGMENTS; i++)
+	{
+		uint32_t bottom0 = sideBase + (i * 2);
+		uint32_t top0 = bottom0 + 1;
+		uint32_t bottom1 = bottom0 + 2;
+		uint32_t top1 = bottom0 + 3;
+
+		geometry.indices.push_back(bottom0);
+		geometry.indices.push_back(bottom1);
+		geometry.indices.push_back(top1);
+		geometry.indices.push_back(bottom0);
+		geometry.indices.push_back(top1);
+		geometry.indices.push_back(top0);
+	}
+
+	// caps, as triangle fans around a center vertex
+	for (int cap = 0; cap < 2; cap++)
+	{
+		float y = (float)cap;
+		glm::vec3 normal(0.0f, (cap == 0) ? -1.0f : 1.0f, 0.0f);
+		uint32_t center = (uint32_t)geometry.vertices.size();
+
+		geometry.vertices.push_back(MakeVertex(glm::vec3(0.0f, y, 0.0f), normal, glm::vec2(0.5f, 0.5f)));
+		for (int i = 0; i <= ROUND_SEGMENTS; i++)
+		{
+			float angle = ((float)i / ROUND_SEGMENTS) * 2.0f * g_Pi;
+			float x = cos(angle);
+			float z = -sin(angle);
+			geometry.vertices.push_back(MakeVertex(
+				glm::vec3(x, y, z),
+				normal,
+				glm::vec2(0.5f + (0.5f * x), 0.5f - (0.5f * z))));
+		}
+		for (int i = 0; i < ROUND_SEGMENTS; i++)
+		{
+			uint32_t rim0 = center + 1 + i;
+			uint32_t rim1 = rim0 + 1;
+
+			geometry.indices.push_back(center);
+			if (cap == 0)
+			{
+				geometry.indices.push_back(rim1);
+				geometry.indices.push_back(rim0);
+			}
+			else
+			{
+				geometry.indices.push_back(rim0);
+				geometry.indices.push_back(rim1);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BuildSphere()
+ *
+ *  This method is used for building a sphere of radius 1 out
+ *  of rings from the south to the north pole.  The texture
+ *  wraps around once, with the seam vertices doubled.
+ ***********************************************************/
+void ShapeGeometry::BuildSphere(SHAPE_GEOMETRY& geometry)
+{
+	uint32_t base = (uint32_t)geometry.vertices.size();
+	int columns = ROUND_SEGMENTS + 1;
+
+	for (int ring = 0; ring <= SPHERE_RINGS; ring++)
+	{
+		float v = (float)ring / SPHERE_RINGS;
+		float polar = (v - 0.5f) * g_Pi;
+		float y = sin(polar);
+		float ringRadius = cos(polar);
+
+		for (int i = 0; i < columns; i++)
+		{
+			float u = (float)i / ROUND_SEGMENTS;
+			float angle = u * 2.0f * g_Pi;
+			glm::vec3 position(ringRadius * cos(angle), y, -ringRadius * sin(angle));
+
+			geometry.vertices.push_back(MakeVertex(position, position, glm::vec2(u, v)));
+		}
+	}
+
+	for (int ring = 0; ring < SPHERE_RINGS; ring++)
+	{
+		for (int i = 0; i < ROUND_SEGMENTS; i++)
+		{
+			uint32_t lower0 = base + (ring * columns) + i;
+			uint32_t lower1 = lower0 + 1;
+			uint32_t upper0 = lower0 + columns;
+			uint32_t upper1 = upper0 + 1;
+
+			geometry.indices.push_back(lower0);
+			geometry.indices.push_back(lower1);
+			geometry.indices.push_back(upper1);
+			geometry.indices.push_back(lower0);
+			geometry.indices.push_back(upper1);
+			geometry.indices.push_back(upper0);
+		}
+	}
+}
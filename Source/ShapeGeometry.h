@@ -0,0 +1,71 @@
+///////////////////////////////////////////////////////////////////////////////
+// shapegeometry.h
+// ============
+// build the vertex and index data of the basic shapes on the CPU, in the
+// same local space as the meshes drawn by ShapeMeshes
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// vertex layout of the basic shapes - position, normal, texture coordinate
+struct SHAPE_VERTEX
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 textureCoordinate;
+};
+
+struct SHAPE_GEOMETRY
+{
+	std::vector<SHAPE_VERTEX> vertices;
+	std::vector<uint32_t> indices;
+};
+
+/***********************************************************
+ *  ShapeGeometry
+ *
+ *  This class builds the triangles of the basic shapes.  The
+ *  shapes use the local space of the ShapeMeshes library:
+ *
+ *  plane     -1 to 1 in x and z, facing up
+ *  box       -0.5 to 0.5 on every axis
+ *  cylinder  radius 1, from 0 to 1 in y
+ *  sphere    radius 1, centered on the origin
+ *
+ *  Triangles are wound counter-clockwise seen from outside.
+ ***********************************************************/
+class ShapeGeometry
+{
+public:
+	// number of sides around the cylinder and the sphere
+	static const int ROUND_SEGMENTS = 36;
+	// number of rings from pole to pole of the sphere
+	static const int SPHERE_RINGS = 18;
+
+	// build the geometry of a mesh type, replacing the contents
+	static bool BuildShape(int meshType, SHAPE_GEOMETRY& geometry);
+
+	static void BuildPlane(SHAPE_GEOMETRY& geometry);
+	static void BuildBox(SHAPE_GEOMETRY& geometry);
+	static void BuildCylinder(SHAPE_GEOMETRY& geometry);
+	static void BuildSphere(SHAPE_GEOMETRY& geometry);
+
+	// bounding sphere of any geometry, center in xyz, radius in w
+	static glm::vec4 ComputeBounds(const SHAPE_GEOMETRY& geometry);
+
+private:
+	// add a quad of four vertices given counter-clockwise
+	static void AddQuad(
+		SHAPE_GEOMETRY& geometry,
+		const SHAPE_VERTEX& v0,
+		const SHAPE_VERTEX& v1,
+		const SHAPE_VERTEX& v2,
+		const SHAPE_VERTEX& v3);
+};
@@ -0,0 +1,1273 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.cpp
+// ============
+// draw the recorded frames on the CPU - tile-binned rasterization across all
+// cores, with the lighting of fragmentShader.glsl, for machines without a GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+#include "ImageWriter.h"
+#include "MemoryTracker.h"
+#include "LightUniforms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// the span functions use AVX2 and FMA on x86 processors that have them,
+// compiled for those instructions on their own so the rest of the
+// program still runs on processors without them
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define RASTER_SIMD 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define RASTER_TARGET_AVX2
+#else
+#define RASTER_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+// declaration of global variables
+namespace
+{
+	// draws moved into clip space and binned by one job
+	const int g_DrawsPerChunk = 32;
+	// chunks per worker, so uneven draws still spread evenly
+	const int g_ChunksPerWorker = 4;
+	// color of an untextured object, the objectColor default
+	const glm::vec4 g_ObjectColor = glm::vec4(1.0f);
+	// cleared color and depth, as set before the OpenGL path draws
+	const uint32_t g_ClearColor = 0xff000000;
+	const float g_ClearDepth = 1.0f;
+
+	// brightness left of a light at a distance, as the shaders
+	// attenuate it
+	float Attenuation(float constant, float linear, float quadratic, float distance)
+	{
+		float divisor = constant + (distance * (linear + (quadratic * distance)));
+		return((divisor > 0.0f) ? (1.0f / divisor) : 1.0f);
+	}
+
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// whether the processor and the operating system support the
+	// AVX2 and FMA instructions of the span functions
+	bool HasAvx2()
+	{
+#if defined(RASTER_SIMD) && defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return(false);
+		}
+		__cpuid(info, 1);
+		bool bFma = (info[2] & (1 << 12)) != 0;
+		bool bOsSave = (info[2] & (1 << 27)) != 0;
+		bool bAvx = (info[2] & (1 << 28)) != 0;
+		if ((bFma == false) || (bOsSave == false) || (bAvx == false) || ((_xgetbv(0) & 6) != 6))
+		{
+			return(false);
+		}
+		__cpuidex(info, 7, 0);
+		return((info[1] & (1 << 5)) != 0);
+#elif defined(RASTER_SIMD)
+		return(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"));
+#else
+		return(false);
+#endif
+	}
+
+	uint32_t PackColor(const glm::vec4& color)
+	{
+		uint32_t r = (uint32_t)((std::min(std::max(color.r, 0.0f), 1.0f) * 255.0f) + 0.5f);
+		uint32_t g = (uint32_t)((std::min(std::max(color.g, 0.0f), 1.0f) * 255.0f) + 0.5f);
+		uint32_t b = (uint32_t)((std::min(std::max(color.b, 0.0f), 1.0f) * 255.0f) + 0.5f);
+		uint32_t a = (uint32_t)((std::min(std::max(color.a, 0.0f), 1.0f) * 255.0f) + 0.5f);
+
+		return(r | (g << 8) | (b << 16) | (a << 24));
+	}
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(JobSystem* pJobSystem)
+{
+	m_pJobSystem = pJobSystem;
+	m_bSimd = HasAvx2();
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_stride = 0;
+	m_pShapes = NULL;
+	m_pDraws = NULL;
+	m_drawCount = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_lights = LIGHT_STATE();
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		m_pointLightRangesSquared[i] = 0.0f;
+	}
+	m_chunkCount = 0;
+	m_presentTextureID = 0;
+	m_presentFramebufferID = 0;
+	m_presentWidth = 0;
+	m_presentHeight = 0;
+	memset(&m_stats, 0, sizeof(m_stats));
+	m_stats.bSimd = m_bSimd;
+	m_statsSeconds = 0.0;
+	m_statsFrames = 0;
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	Destroy();
+	m_pJobSystem = NULL;
+	m_pShapes = NULL;
+	m_pDraws = NULL;
+	MemoryTracker::ReleaseHeap(this);
+	MemoryTracker::ReleaseHeap(&m_pTextures);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for sizing the color and depth buffers
+ *  to the frame.  The buffers are padded to whole tiles, so
+ *  a span never reads or writes past the end of a row.
+ ***********************************************************/
+void SoftwareRasterizer::Resize(int width, int height)
+{
+	width = std::max(width, 1);
+	height = std::max(height, 1);
+	if ((width == m_width) && (height == m_height))
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_stride = m_tilesX * TILE_SIZE;
+
+	size_t pixelCount = (size_t)m_stride * m_tilesY * TILE_SIZE;
+	m_colorBuffer.assign(pixelCount, g_ClearColor);
+	m_depthBuffer.assign(pixelCount, g_ClearDepth);
+	m_tileMs.assign(m_tilesX * m_tilesY, 0.0);
+	m_tilePixels.assign(m_tilesX * m_tilesY, 0);
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_RENDERING, "software frame buffers",
+		(m_colorBuffer.size() * sizeof(uint32_t)) + (m_depthBuffer.size() * sizeof(float)));
+
+	// the bins are sized for the new tile count when next used
+	for (size_t i = 0; i < m_chunks.size(); i++)
+	{
+		m_chunks[i].bins.clear();
+	}
+}
+
+/***********************************************************
+ *  SetShapes()
+ *
+ *  This method is used for setting the geometry drawn for
+ *  every mesh type.  The shapes are read while drawing, so
+ *  they must outlive the rasterizer.
+ ***********************************************************/
+void SoftwareRasterizer::SetShapes(const std::vector<SHAPE_GEOMETRY>* pShapes)
+{
+	m_pShapes = pShapes;
+}
+
+/***********************************************************
+ *  SetMaterials()
+ *
+ *  This method is used for setting the materials the draws
+ *  refer to by index.
+ ***********************************************************/
+void SoftwareRasterizer::SetMaterials(const std::vector<RASTER_MATERIAL>& materials)
+{
+	m_materials = materials;
+}
+
+/***********************************************************
+ *  SetTextures()
+ *
+ *  This method is used for copying the layers of the texture
+ *  array, and for building the mip chain of every layer with
+ *  a 2x2 box filter, as glGenerateMipmap does for the OpenGL
+ *  path.  The layers are square with a power of two size.
+ ***********************************************************/
+void SoftwareRasterizer::SetTextures(const unsigned char* pLayers, int layerSize, int layerCount)
+{
+	std::shared_ptr<RASTER_TEXTURES> pTextures = std::make_shared<RASTER_TEXTURES>();
+	RASTER_TEXTURES& textures = *pTextures;
+	textures.size = layerSize;
+	textures.layerCount = layerCount;
+	textures.levelOffsets.clear();
+	textures.levelSizes.clear();
+
+	size_t offset = 0;
+	for (int size = layerSize; size > 0; size /= 2)
+	{
+		textures.levelOffsets.push_back(offset);
+		textures.levelSizes.push_back(size);
+		offset += (size_t)size * size * 4;
+	}
+	textures.levelCount = (int)textures.levelSizes.size();
+	textures.layerBytes = offset;
+	textures.data.resize(textures.layerBytes * layerCount);
+
+	size_t baseBytes = (size_t)layerSize * layerSize * 4;
+	for (int layer = 0; layer < layerCount; layer++)
+	{
+		unsigned char* pLayer = &textures.data[layer * textures.layerBytes];
+		memcpy(pLayer, pLayers + (layer * baseBytes), baseBytes);
+
+		for (int level = 1; level < textures.levelCount; level++)
+		{
+			int size = textures.levelSizes[level];
+			int sourceSize = textures.levelSizes[level - 1];
+			const unsigned char* pSource = pLayer + textures.levelOffsets[level - 1];
+			unsigned char* pTarget = pLayer + textures.levelOffsets[level];
+			for (int y = 0; y < size; y++)
+			{
+				const unsigned char* pRow0 = pSource + ((size_t)(y * 2) * sourceSize * 4);
+				const unsigned char* pRow1 = pRow0 + ((size_t)sourceSize * 4);
+				for (int x = 0; x < size; x++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						int sum = pRow0[(x * 8) + c] + pRow0[(x * 8) + 4 + c] +
+							pRow1[(x * 8) + c] + pRow1[(x * 8) + 4 + c];
+						pTarget[(((size_t)y * size + x) * 4) + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+
+	m_pTextures = pTextures;
+	MemoryTracker::TrackHeap(&m_pTextures, MemoryTracker::MEMORY_CPU_TEXTURES, "software textures", textures.data.size());
+}
+
+/***********************************************************
+ *  ShareAssets()
+ *
+ *  This method is used for drawing with the shapes, materials
+ *  and textures of another rasterizer, so that rasterizers
+ *  drawing the same scene on different threads keep a single
+ *  copy of the texture layers.  The assets are not changed
+ *  once they are shared.
+ ***********************************************************/
+void SoftwareRasterizer::ShareAssets(const SoftwareRasterizer& source)
+{
+	m_pShapes = source.m_pShapes;
+	m_materials = source.m_materials;
+	m_pTextures = source.m_pTextures;
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method is used for drawing the passed in objects with
+ *  the camera and lights of a snapshot, into a frame the size
+ *  of the snapshot's framebuffer.  The draws are processed in
+ *  chunks and the tiles rasterized on the job system when it
+ *  is called from the job system's first worker, and on the
+ *  calling thread otherwise.
+ ***********************************************************/
+void SoftwareRasterizer::Render(const RASTER_DRAW* pDraws, int drawCount, const FRAME_SNAPSHOT& snapshot)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	Resize(snapshot.framebufferWidth, snapshot.framebufferHeight);
+	m_pDraws = pDraws;
+	m_drawCount = drawCount;
+	m_viewProjection = snapshot.projection * snapshot.view;
+	m_viewPosition = snapshot.viewPosition;
+	m_lights = snapshot.lights;
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		m_pointLightRangesSquared[i] = LightUniforms::GetPointLightRangeSquared(m_lights.pointLights[i]);
+	}
+
+	bool bParallel = (NULL != m_pJobSystem) && (m_pJobSystem->GetCurrentWorkerIndex() == 0);
+	int workerCount = bParallel ? m_pJobSystem->GetWorkerCount() : 1;
+	m_chunkCount = std::max(1, std::min(
+		(drawCount + g_DrawsPerChunk - 1) / g_DrawsPerChunk,
+		workerCount * g_ChunksPerWorker));
+	if ((int)m_chunks.size() < m_chunkCount)
+	{
+		m_chunks.resize(m_chunkCount);
+	}
+
+	auto processChunks = [this](int begin, int end)
+	{
+		for (int chunk = begin; chunk < end; chunk++)
+		{
+			int firstDraw = (int)(((int64_t)m_drawCount * chunk) / m_chunkCount);
+			int lastDraw = (int)(((int64_t)m_drawCount * (chunk + 1)) / m_chunkCount);
+			ProcessChunk(chunk, firstDraw, lastDraw);
+		}
+	};
+	int tileCount = m_tilesX * m_tilesY;
+	auto rasterizeTiles = [this](int begin, int end)
+	{
+		for (int tile = begin; tile < end; tile++)
+		{
+			RasterizeTile(tile);
+		}
+	};
+
+	if (bParallel == true)
+	{
+		m_pJobSystem->ParallelFor(m_chunkCount, 1, processChunks);
+	}
+	else
+	{
+		processChunks(0, m_chunkCount);
+	}
+	std::chrono::steady_clock::time_point binnedTime = std::chrono::steady_clock::now();
+
+	if (bParallel == true)
+	{
+		m_pJobSystem->ParallelFor(tileCount, 1, rasterizeTiles);
+	}
+	else
+	{
+		rasterizeTiles(0, tileCount);
+	}
+	std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+
+	m_stats.framesRendered++;
+	m_stats.trianglesSubmitted = 0;
+	m_stats.trianglesBinned = 0;
+	for (int i = 0; i < m_chunkCount; i++)
+	{
+		m_stats.trianglesSubmitted += m_chunks[i].trianglesSubmitted;
+		m_stats.trianglesBinned += (int)m_chunks[i].triangles.size();
+	}
+	m_stats.pixelsShaded = 0;
+	m_stats.averageTileMs = 0.0;
+	m_stats.maxTileMs = 0.0;
+	for (int i = 0; i < tileCount; i++)
+	{
+		m_stats.pixelsShaded += m_tilePixels[i];
+		m_stats.averageTileMs += m_tileMs[i];
+		if (m_tileMs[i] > m_stats.maxTileMs)
+		{
+			m_stats.maxTileMs = m_tileMs[i];
+			m_stats.slowestTileX = i % m_tilesX;
+			m_stats.slowestTileY = i / m_tilesX;
+		}
+	}
+	m_stats.averageTileMs /= std::max(tileCount, 1);
+	m_stats.geometryMs = ElapsedMs(startTime, binnedTime);
+	m_stats.rasterMs = ElapsedMs(binnedTime, endTime);
+	m_stats.frameMs = ElapsedMs(startTime, endTime);
+
+	m_statsFrames++;
+	m_statsSeconds += m_stats.frameMs / 1000.0;
+	m_stats.framesPerSecond = (m_statsSeconds > 0.0) ? (m_statsFrames / m_statsSeconds) : 0.0;
+}
+
+/***********************************************************
+ *  ProcessChunk()
+ *
+ *  This method is used for moving the vertices of a range of
+ *  draws into clip space, as vertexShader.glsl does, and for
+ *  setting up and binning their triangles.  Triangles that
+ *  are entirely outside one plane of the view volume are
+ *  dropped, and triangles that cross the near plane are
+ *  clipped.  Both windings are drawn, since the OpenGL path
+ *  does not cull back faces.
+ ***********************************************************/
+void SoftwareRasterizer::ProcessChunk(int chunkIndex, int firstDraw, int lastDraw)
+{
+	RASTER_CHUNK& chunk = m_chunks[chunkIndex];
+	int tileCount = m_tilesX * m_tilesY;
+	if ((int)chunk.bins.size() != tileCount)
+	{
+		chunk.bins.resize(tileCount);
+	}
+	for (int i = 0; i < tileCount; i++)
+	{
+		chunk.bins[i].clear();
+	}
+	chunk.triangles.clear();
+	chunk.trianglesSubmitted = 0;
+	if (NULL == m_pShapes)
+	{
+		return;
+	}
+
+	std::vector<CLIP_VERTEX> vertices;
+	for (int drawIndex = firstDraw; drawIndex < lastDraw; drawIndex++)
+	{
+		const RASTER_DRAW& draw = m_pDraws[drawIndex];
+		if ((draw.meshType < 0) || (draw.meshType >= (int)m_pShapes->size()))
+		{
+			continue;
+		}
+
+		const SHAPE_GEOMETRY& shape = (*m_pShapes)[draw.meshType];
+		glm::mat4 modelViewProjection = m_viewProjection * draw.model;
+		vertices.resize(shape.vertices.size());
+		for (size_t i = 0; i < shape.vertices.size(); i++)
+		{
+			const SHAPE_VERTEX& source = shape.vertices[i];
+			glm::vec4 position = glm::vec4(source.position, 1.0f);
+			vertices[i].position = modelViewProjection * position;
+			vertices[i].worldPosition = glm::vec3(draw.model * position);
+			vertices[i].normal = draw.normalMatrix * source.normal;
+			vertices[i].textureCoordinate = source.textureCoordinate * draw.uvScale;
+		}
+
+		for (size_t i = 0; i + 2 < shape.indices.size(); i += 3)
+		{
+			CLIP_VERTEX triangle[3] =
+			{
+				vertices[shape.indices[i]],
+				vertices[shape.indices[i + 1]],
+				vertices[shape.indices[i + 2]]
+			};
+			chunk.trianglesSubmitted++;
+
+			// drop triangles entirely outside one plane of the view volume
+			bool bOutside = false;
+			for (int axis = 0; (axis < 3) && (bOutside == false); axis++)
+			{
+				bOutside =
+					((triangle[0].position[axis] > triangle[0].position.w) &&
+					(triangle[1].position[axis] > triangle[1].position.w) &&
+					(triangle[2].position[axis] > triangle[2].position.w)) ||
+					((triangle[0].position[axis] < -triangle[0].position.w) &&
+					(triangle[1].position[axis] < -triangle[1].position.w) &&
+					(triangle[2].position[axis] < -triangle[2].position.w));
+			}
+			if (bOutside == true)
+			{
+				continue;
+			}
+
+			ClipTriangle(triangle, draw.materialIndex, draw.textureLayer, chunk);
+		}
+	}
+}
+
+/***********************************************************
+ *  ClipTriangle()
+ *
+ *  This method is used for clipping a triangle against the
+ *  near plane, where z = -w, before it is divided by w.  The
+ *  part in front of the plane has up to four corners and is
+ *  set up as a fan.  The other planes need no clipping: the
+ *  triangles are bounded by the screen when they are binned,
+ *  and by the depth test to the far plane.
+ ***********************************************************/
+void SoftwareRasterizer::ClipTriangle(
+	const CLIP_VERTEX* pVertices,
+	int materialIndex,
+	int textureLayer,
+	RASTER_CHUNK& chunk)
+{
+	float distances[3];
+	bool bClipped = false;
+	for (int i = 0; i < 3; i++)
+	{
+		distances[i] = pVertices[i].position.z + pVertices[i].position.w;
+		bClipped |= (distances[i] < 0.0f);
+	}
+	if (bClipped == false)
+	{
+		SetupTriangle(pVertices[0], pVertices[1], pVertices[2], materialIndex, textureLayer, chunk);
+		return;
+	}
+
+	CLIP_VERTEX clipped[4];
+	int clippedCount = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		int next = (i + 1) % 3;
+		if (distances[i] >= 0.0f)
+		{
+			clipped[clippedCount++] = pVertices[i];
+		}
+		if ((distances[i] >= 0.0f) != (distances[next] >= 0.0f))
+		{
+			float t = distances[i] / (distances[i] - distances[next]);
+			const CLIP_VERTEX& a = pVertices[i];
+			const CLIP_VERTEX& b = pVertices[next];
+			CLIP_VERTEX& vertex = clipped[clippedCount++];
+			vertex.position = a.position + ((b.position - a.position) * t);
+			vertex.worldPosition = a.worldPosition + ((b.worldPosition - a.worldPosition) * t);
+			vertex.normal = a.normal + ((b.normal - a.normal) * t);
+			vertex.textureCoordinate = a.textureCoordinate + ((b.textureCoordinate - a.textureCoordinate) * t);
+		}
+	}
+
+	for (int i = 1; i + 1 < clippedCount; i++)
+	{
+		SetupTriangle(clipped[0], clipped[i], clipped[i + 1], materialIndex, textureLayer, chunk);
+	}
+}
+
+/***********************************************************
+ *  SetupTriangle()
+ *
+ *  This method is used for moving a clipped triangle onto the
+ *  screen, and for turning it into the edge functions and
+ *  attribute planes the spans evaluate.  The attributes are
+ *  divided by w, and their planes interpolate linearly on the
+ *  screen, so dividing by the interpolated 1/w at a pixel
+ *  gives the perspective-correct value.  The triangle is
+ *  binned into every tile it may cover.
+ ***********************************************************/
+void SoftwareRasterizer::SetupTriangle(
+	const CLIP_VERTEX& v0,
+	const CLIP_VERTEX& v1,
+	const CLIP_VERTEX& v2,
+	int materialIndex,
+	int textureLayer,
+	RASTER_CHUNK& chunk)
+{
+	const CLIP_VERTEX* pVertices[3] = { &v0, &v1, &v2 };
+	float screenX[3];
+	float screenY[3];
+	float values[3][PLANE_COUNT];
+	for (int i = 0; i < 3; i++)
+	{
+		const CLIP_VERTEX& vertex = *pVertices[i];
+		float inverseW = 1.0f / vertex.position.w;
+		screenX[i] = ((vertex.position.x * inverseW * 0.5f) + 0.5f) * m_width;
+		screenY[i] = (0.5f - (vertex.position.y * inverseW * 0.5f)) * m_height;
+
+		values[i][PLANE_DEPTH] = (vertex.position.z * inverseW * 0.5f) + 0.5f;
+		values[i][PLANE_INVERSE_W] = inverseW;
+		values[i][PLANE_POSITION_X] = vertex.worldPosition.x * inverseW;
+		values[i][PLANE_POSITION_Y] = vertex.worldPosition.y * inverseW;
+		values[i][PLANE_POSITION_Z] = vertex.worldPosition.z * inverseW;
+		values[i][PLANE_NORMAL_X] = vertex.normal.x * inverseW;
+		values[i][PLANE_NORMAL_Y] = vertex.normal.y * inverseW;
+		values[i][PLANE_NORMAL_Z] = vertex.normal.z * inverseW;
+		values[i][PLANE_TEXTURE_U] = vertex.textureCoordinate.x * inverseW;
+		values[i][PLANE_TEXTURE_V] = vertex.textureCoordinate.y * inverseW;
+	}
+
+	float area = ((screenX[1] - screenX[0]) * (screenY[2] - screenY[0])) -
+		((screenX[2] - screenX[0]) * (screenY[1] - screenY[0]));
+	if (std::fabs(area) < 1.0e-8f)
+	{
+		return;
+	}
+
+	// order the corners so the edge functions are positive inside
+	int order[3] = { 0, 1, 2 };
+	if (area < 0.0f)
+	{
+		std::swap(order[1], order[2]);
+		area = -area;
+	}
+
+	RASTER_TRIANGLE triangle;
+	for (int edge = 0; edge < 3; edge++)
+	{
+		// the edge opposite corner edge, whose function is that
+		// corner's barycentric weight times the area
+		int a = order[(edge + 1) % 3];
+		int b = order[(edge + 2) % 3];
+		triangle.edgeA[edge] = screenY[a] - screenY[b];
+		triangle.edgeB[edge] = screenX[b] - screenX[a];
+		triangle.edgeC[edge] = (screenX[a] * screenY[b]) - (screenY[a] * screenX[b]);
+		triangle.bTopLeft[edge] = (triangle.edgeA[edge] > 0.0f) ||
+			((triangle.edgeA[edge] == 0.0f) && (triangle.edgeB[edge] > 0.0f));
+	}
+
+	float inverseArea = 1.0f / area;
+	for (int plane = 0; plane < PLANE_COUNT; plane++)
+	{
+		float a = 0.0f;
+		float b = 0.0f;
+		float c = 0.0f;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			float value = values[order[corner]][plane];
+			a += value * triangle.edgeA[corner];
+			b += value * triangle.edgeB[corner];
+			c += value * triangle.edgeC[corner];
+		}
+		triangle.planeA[plane] = a * inverseArea;
+		triangle.planeB[plane] = b * inverseArea;
+		triangle.planeC[plane] = c * inverseArea;
+	}
+
+	float minX = std::min(screenX[0], std::min(screenX[1], screenX[2]));
+	float maxX = std::max(screenX[0], std::max(screenX[1], screenX[2]));
+	float minY = std::min(screenY[0], std::min(screenY[1], screenY[2]));
+	float maxY = std::max(screenY[0], std::max(screenY[1], screenY[2]));
+	triangle.minX = std::max(0, (int)std::floor(minX));
+	triangle.maxX = std::min(m_width - 1, (int)std::ceil(maxX));
+	triangle.minY = std::max(0, (int)std::floor(minY));
+	triangle.maxY = std::min(m_height - 1, (int)std::ceil(maxY));
+	if ((triangle.minX > triangle.maxX) || (triangle.minY > triangle.maxY))
+	{
+		return;
+	}
+	triangle.materialIndex = materialIndex;
+	triangle.textureLayer = textureLayer;
+
+	uint32_t triangleIndex = (uint32_t)chunk.triangles.size();
+	bool bBinned = false;
+	for (int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+	{
+		for (int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+		{
+			// skip tiles that lie entirely outside one edge, tested
+			// at the tile corner furthest inside that edge
+			bool bOutside = false;
+			for (int edge = 0; (edge < 3) && (bOutside == false); edge++)
+			{
+				float x = (float)(tileX * TILE_SIZE) + ((triangle.edgeA[edge] > 0.0f) ? TILE_SIZE : 0.0f);
+				float y = (float)(tileY * TILE_SIZE) + ((triangle.edgeB[edge] > 0.0f) ? TILE_SIZE : 0.0f);
+				bOutside = ((triangle.edgeA[edge] * x) + (triangle.edgeB[edge] * y) + triangle.edgeC[edge]) < 0.0f;
+			}
+			if (bOutside == false)
+			{
+				chunk.bins[(tileY * m_tilesX) + tileX].push_back(triangleIndex);
+				bBinned = true;
+			}
+		}
+	}
+	if (bBinned == true)
+	{
+		chunk.triangles.push_back(triangle);
+	}
+}
+
+/***********************************************************
+ *  RasterizeTile()
+ *
+ *  This method is used for clearing a tile and drawing the
+ *  triangles binned into it, chunk by chunk in the order the
+ *  draws were submitted.
+ ***********************************************************/
+void SoftwareRasterizer::RasterizeTile(int tile)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	int tileX = tile % m_tilesX;
+	int tileY = tile / m_tilesX;
+
+	for (int y = 0; y < TILE_SIZE; y++)
+	{
+		size_t row = ((size_t)(tileY * TILE_SIZE) + y) * m_stride + (tileX * TILE_SIZE);
+		std::fill(&m_colorBuffer[row], &m_colorBuffer[row] + TILE_SIZE, g_ClearColor);
+		std::fill(&m_depthBuffer[row], &m_depthBuffer[row] + TILE_SIZE, g_ClearDepth);
+	}
+
+	uint64_t pixels = 0;
+	for (int chunk = 0; chunk < m_chunkCount; chunk++)
+	{
+		const std::vector<uint32_t>& bin = m_chunks[chunk].bins[tile];
+		const std::vector<RASTER_TRIANGLE>& triangles = m_chunks[chunk].triangles;
+		for (size_t i = 0; i < bin.size(); i++)
+		{
+			if (m_bSimd == true)
+			{
+				pixels += RasterizeTriangleSimd(triangles[bin[i]], tileX, tileY);
+			}
+			else
+			{
+				pixels += RasterizeTriangle(triangles[bin[i]], tileX, tileY);
+			}
+		}
+	}
+
+	m_tilePixels[tile] = pixels;
+	m_tileMs[tile] = ElapsedMs(startTime, std::chrono::steady_clock::now());
+}
+
+/***********************************************************
+ *  RasterizeTriangle()
+ *
+ *  This method is used for drawing the part of a triangle
+ *  inside a tile one pixel at a time, on processors without
+ *  AVX2.  It returns the number of pixels shaded.
+ ***********************************************************/
+uint64_t SoftwareRasterizer::RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY)
+{
+	int startX = std::max(triangle.minX, tileX * TILE_SIZE);
+	int endX = std::min(triangle.maxX, (tileX * TILE_SIZE) + TILE_SIZE - 1);
+	int startY = std::max(triangle.minY, tileY * TILE_SIZE);
+	int endY = std::min(triangle.maxY, (tileY * TILE_SIZE) + TILE_SIZE - 1);
+
+	uint64_t pixels = 0;
+	for (int y = startY; y <= endY; y++)
+	{
+		float pixelY = y + 0.5f;
+		size_t row = (size_t)y * m_stride;
+		float lod = 0.0f;
+		int lodSpan = -1;
+
+		for (int x = startX; x <= endX; x++)
+		{
+			float pixelX = x + 0.5f;
+			bool bInside = true;
+			for (int edge = 0; (edge < 3) && (bInside == true); edge++)
+			{
+				float value = (triangle.edgeA[edge] * pixelX) + (triangle.edgeB[edge] * pixelY) + triangle.edgeC[edge];
+				bInside = (value > 0.0f) || ((value == 0.0f) && (triangle.bTopLeft[edge] == true));
+			}
+			if (bInside == false)
+			{
+				continue;
+			}
+
+			float depth = (triangle.planeA[PLANE_DEPTH] * pixelX) + (triangle.planeB[PLANE_DEPTH] * pixelY) + triangle.planeC[PLANE_DEPTH];
+			if ((depth < 0.0f) || (depth > 1.0f) || (depth >= m_depthBuffer[row + x]))
+			{
+				continue;
+			}
+			m_depthBuffer[row + x] = depth;
+
+			// the mip level is chosen once per span, as the SIMD path does
+			if ((triangle.textureLayer >= 0) && (lodSpan != x / SPAN_WIDTH))
+			{
+				lod = ComputeLod(triangle, pixelX, pixelY);
+				lodSpan = x / SPAN_WIDTH;
+			}
+
+			float values[PLANE_COUNT];
+			float w = 1.0f / ((triangle.planeA[PLANE_INVERSE_W] * pixelX) +
+				(triangle.planeB[PLANE_INVERSE_W] * pixelY) + triangle.planeC[PLANE_INVERSE_W]);
+			for (int plane = PLANE_POSITION_X; plane < PLANE_COUNT; plane++)
+			{
+				values[plane] = ((triangle.planeA[plane] * pixelX) + (triangle.planeB[plane] * pixelY) + triangle.planeC[plane]) * w;
+			}
+			m_colorBuffer[row + x] = ShadeFragment(triangle, values, lod);
+			pixels++;
+		}
+	}
+
+	return(pixels);
+}
+
+/***********************************************************
+ *  RasterizeTriangleSimd()
+ *
+ *  This method is used for drawing the part of a triangle
+ *  inside a tile eight pixels at a time.  The edge functions,
+ *  the depth test and the attribute planes are evaluated for
+ *  a whole span with AVX2, and only the pixels that pass are
+ *  shaded.  It returns the number of pixels shaded.
+ ***********************************************************/
+#if defined(RASTER_SIMD)
+RASTER_TARGET_AVX2 uint64_t SoftwareRasterizer::RasterizeTriangleSimd(
+	const RASTER_TRIANGLE& triangle,
+	int tileX,
+	int tileY)
+{
+	int startX = std::max(triangle.minX, tileX * TILE_SIZE);
+	int endX = std::min(triangle.maxX, (tileX * TILE_SIZE) + TILE_SIZE - 1);
+	int startY = std::max(triangle.minY, tileY * TILE_SIZE);
+	int endY = std::min(triangle.maxY, (tileY * TILE_SIZE) + TILE_SIZE - 1);
+	// spans start on a multiple of the span width within the tile
+	int spanStartX = startX - (startX % SPAN_WIDTH);
+
+	const __m256 laneOffsets = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 firstColumn = _mm256_set1_ps((float)startX);
+	const __m256 lastColumn = _mm256_set1_ps((float)endX);
+
+	__m256 edgeA[3];
+	for (int edge = 0; edge < 3; edge++)
+	{
+		edgeA[edge] = _mm256_set1_ps(triangle.edgeA[edge]);
+	}
+
+	alignas(32) float planeValues[PLANE_COUNT][SPAN_WIDTH];
+	uint64_t pixels = 0;
+	for (int y = startY; y <= endY; y++)
+	{
+		float pixelY = y + 0.5f;
+		size_t row = (size_t)y * m_stride;
+
+		// the row terms of the edge functions and planes
+		__m256 edgeRow[3];
+		for (int edge = 0; edge < 3; edge++)
+		{
+			edgeRow[edge] = _mm256_set1_ps((triangle.edgeB[edge] * pixelY) + triangle.edgeC[edge]);
+		}
+		__m256 depthRow = _mm256_set1_ps((triangle.planeB[PLANE_DEPTH] * pixelY) + triangle.planeC[PLANE_DEPTH]);
+
+		for (int spanX = spanStartX; spanX <= endX; spanX += SPAN_WIDTH)
+		{
+			__m256 columns = _mm256_add_ps(_mm256_set1_ps((float)spanX), laneOffsets);
+			__m256 pixelX = _mm256_add_ps(columns, _mm256_set1_ps(0.5f));
+
+			__m256 mask = _mm256_and_ps(
+				_mm256_cmp_ps(columns, firstColumn, _CMP_GE_OQ),
+				_mm256_cmp_ps(columns, lastColumn, _CMP_LE_OQ));
+			for (int edge = 0; edge < 3; edge++)
+			{
+				__m256 value = _mm256_fmadd_ps(edgeA[edge], pixelX, edgeRow[edge]);
+				mask = _mm256_and_ps(mask, triangle.bTopLeft[edge] ?
+					_mm256_cmp_ps(value, zero, _CMP_GE_OQ) :
+					_mm256_cmp_ps(value, zero, _CMP_GT_OQ));
+			}
+			if (_mm256_movemask_ps(mask) == 0)
+			{
+				continue;
+			}
+
+			float* pDepth = &m_depthBuffer[row + spanX];
+			__m256 depth = _mm256_fmadd_ps(_mm256_set1_ps(triangle.planeA[PLANE_DEPTH]), pixelX, depthRow);
+			__m256 storedDepth = _mm256_loadu_ps(pDepth);
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(depth, storedDepth, _CMP_LT_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(depth, zero, _CMP_GE_OQ));
+			mask = _mm256_and_ps(mask, _mm256_cmp_ps(depth, one, _CMP_LE_OQ));
+			int lanes = _mm256_movemask_ps(mask);
+			if (lanes == 0)
+			{
+				continue;
+			}
+			_mm256_storeu_ps(pDepth, _mm256_blendv_ps(storedDepth, depth, mask));
+
+			// interpolate the attributes of the whole span and divide
+			// them by the interpolated 1/w
+			__m256 inverseW = _mm256_fmadd_ps(
+				_mm256_set1_ps(triangle.planeA[PLANE_INVERSE_W]),
+				pixelX,
+				_mm256_set1_ps((triangle.planeB[PLANE_INVERSE_W] * pixelY) + triangle.planeC[PLANE_INVERSE_W]));
+			__m256 w = _mm256_div_ps(one, inverseW);
+			for (int plane = PLANE_POSITION_X; plane < PLANE_COUNT; plane++)
+			{
+				__m256 value = _mm256_fmadd_ps(
+					_mm256_set1_ps(triangle.planeA[plane]),
+					pixelX,
+					_mm256_set1_ps((triangle.planeB[plane] * pixelY) + triangle.planeC[plane]));
+				_mm256_store_ps(planeValues[plane], _mm256_mul_ps(value, w));
+			}
+
+			float lod = 0.0f;
+			if (triangle.textureLayer >= 0)
+			{
+				int firstLane = 0;
+				while ((lanes & (1 << firstLane)) == 0)
+				{
+					firstLane++;
+				}
+				lod = ComputeLod(triangle, spanX + firstLane + 0.5f, pixelY);
+			}
+
+			uint32_t* pColor = &m_colorBuffer[row + spanX];
+			for (int lane = 0; lane < SPAN_WIDTH; lane++)
+			{
+				if ((lanes & (1 << lane)) == 0)
+				{
+					continue;
+				}
+
+				float values[PLANE_COUNT];
+				for (int plane = PLANE_POSITION_X; plane < PLANE_COUNT; plane++)
+				{
+					values[plane] = planeValues[plane][lane];
+				}
+				pColor[lane] = ShadeFragment(triangle, values, lod);
+				pixels++;
+			}
+		}
+	}
+
+	return(pixels);
+}
+#else
+uint64_t SoftwareRasterizer::RasterizeTriangleSimd(
+	const RASTER_TRIANGLE& triangle,
+	int tileX,
+	int tileY)
+{
+	return(RasterizeTriangle(triangle, tileX, tileY));
+}
+#endif
+
+/***********************************************************
+ *  ComputeLod()
+ *
+ *  This method is used for choosing the mip level at a pixel
+ *  from how far the texture coordinates move to the next
+ *  pixel along x and y, measured in texels of the largest
+ *  level.
+ ***********************************************************/
+float SoftwareRasterizer::ComputeLod(const RASTER_TRIANGLE& triangle, float x, float y) const
+{
+	float u[3];
+	float v[3];
+	const float offsetX[3] = { 0.0f, 1.0f, 0.0f };
+	const float offsetY[3] = { 0.0f, 0.0f, 1.0f };
+	for (int i = 0; i < 3; i++)
+	{
+		float px = x + offsetX[i];
+		float py = y + offsetY[i];
+		float w = 1.0f / ((triangle.planeA[PLANE_INVERSE_W] * px) + (triangle.planeB[PLANE_INVERSE_W] * py) + triangle.planeC[PLANE_INVERSE_W]);
+		u[i] = ((triangle.planeA[PLANE_TEXTURE_U] * px) + (triangle.planeB[PLANE_TEXTURE_U] * py) + triangle.planeC[PLANE_TEXTURE_U]) * w;
+		v[i] = ((triangle.planeA[PLANE_TEXTURE_V] * px) + (triangle.planeB[PLANE_TEXTURE_V] * py) + triangle.planeC[PLANE_TEXTURE_V]) * w;
+	}
+
+	float size = (NULL != m_pTextures) ? (float)m_pTextures->size : 0.0f;
+	float lengthX = std::sqrt(((u[1] - u[0]) * (u[1] - u[0])) + ((v[1] - v[0]) * (v[1] - v[0]))) * size;
+	float lengthY = std::sqrt(((u[2] - u[0]) * (u[2] - u[0])) + ((v[2] - v[0]) * (v[2] - v[0]))) * size;
+	float footprint = std::max(lengthX, lengthY);
+
+	return((footprint > 1.0f) ? std::log2(footprint) : 0.0f);
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method is used for sampling a texture layer at the
+ *  mip level nearest the passed in level of detail, with
+ *  bilinear filtering and repeat wrapping.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::SampleTexture(int layer, float u, float v, float lod) const
+{
+	if ((NULL == m_pTextures) || (m_pTextures->layerCount == 0))
+	{
+		return(g_ObjectColor);
+	}
+	const RASTER_TEXTURES& textures = *m_pTextures;
+
+	// out of range layers are clamped, as OpenGL does
+	layer = std::min(std::max(layer, 0), textures.layerCount - 1);
+	int level = std::min(std::max((int)(lod + 0.5f), 0), textures.levelCount - 1);
+	int size = textures.levelSizes[level];
+	const unsigned char* pTexels = &textures.data[(layer * textures.layerBytes) + textures.levelOffsets[level]];
+
+	float texelX = (u * size) - 0.5f;
+	float texelY = (v * size) - 0.5f;
+	float floorX = std::floor(texelX);
+	float floorY = std::floor(texelY);
+	float fractionX = texelX - floorX;
+	float fractionY = texelY - floorY;
+
+	// the sizes are powers of two, so repeating is a mask
+	int mask = size - 1;
+	int x0 = (int)floorX & mask;
+	int y0 = (int)floorY & mask;
+	int x1 = (x0 + 1) & mask;
+	int y1 = (y0 + 1) & mask;
+	const unsigned char* p00 = pTexels + (((size_t)y0 * size + x0) * 4);
+	const unsigned char* p10 = pTexels + (((size_t)y0 * size + x1) * 4);
+	const unsigned char* p01 = pTexels + (((size_t)y1 * size + x0) * 4);
+	const unsigned char* p11 = pTexels + (((size_t)y1 * size + x1) * 4);
+
+	float weight00 = (1.0f - fractionX) * (1.0f - fractionY);
+	float weight10 = fractionX * (1.0f - fractionY);
+	float weight01 = (1.0f - fractionX) * fractionY;
+	float weight11 = fractionX * fractionY;
+
+	glm::vec4 color;
+	for (int c = 0; c < 4; c++)
+	{
+		color[c] = ((p00[c] * weight00) + (p10[c] * weight10) + (p01[c] * weight01) + (p11[c] * weight11)) * (1.0f / 255.0f);
+	}
+
+	return(color);
+}
+
+/***********************************************************
+ *  ShadeFragment()
+ *
+ *  This method is used for lighting one pixel the way
+ *  fragmentShader.glsl does: directional, point and spot
+ *  Phong terms, with the texture color standing in for the
+ *  object color, and point light specular left untextured.
+ *  Point lights are attenuated and skipped past their range,
+ *  and the spot light outside its cone.
+ ***********************************************************/
+uint32_t SoftwareRasterizer::ShadeFragment(const RASTER_TRIANGLE& triangle, const float* pValues, float lod) const
+{
+	RASTER_MATERIAL material;
+	if ((triangle.materialIndex >= 0) && (triangle.materialIndex < (int)m_materials.size()))
+	{
+		material = m_materials[triangle.materialIndex];
+	}
+	else
+	{
+		// objects without a material use the zeroed entry
+		material.diffuseColor = glm::vec3(0.0f);
+		material.specularColor = glm::vec3(0.0f);
+		material.shininess = 0.0f;
+	}
+
+	bool bUseTexture = (triangle.textureLayer >= 0);
+	glm::vec4 baseColor = bUseTexture ?
+		SampleTexture(triangle.textureLayer, pValues[PLANE_TEXTURE_U], pValues[PLANE_TEXTURE_V], lod) :
+		g_ObjectColor;
+	glm::vec3 baseRgb = glm::vec3(baseColor);
+
+	if (m_lights.bUseLighting == false)
+	{
+		return(PackColor(baseColor));
+	}
+
+	glm::vec3 fragmentPosition = glm::vec3(pValues[PLANE_POSITION_X], pValues[PLANE_POSITION_Y], pValues[PLANE_POSITION_Z]);
+	glm::vec3 normal = glm::normalize(glm::vec3(pValues[PLANE_NORMAL_X], pValues[PLANE_NORMAL_Y], pValues[PLANE_NORMAL_Z]));
+	glm::vec3 viewDirection = glm::normalize(m_viewPosition - fragmentPosition);
+	glm::vec3 result = glm::vec3(0.0f);
+
+	const DIRECTIONAL_LIGHT& directional = m_lights.directionalLight;
+	if (directional.bActive == true)
+	{
+		glm::vec3 lightDirection = glm::normalize(-directional.direction);
+		float diffuse = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+		float specular = std::pow(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+		result += directional.ambient * baseRgb;
+		result += directional.diffuse * diffuse * material.diffuseColor * baseRgb;
+		result += directional.specular * specular * material.specularColor * baseRgb;
+	}
+
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		const POINT_LIGHT& light = m_lights.pointLights[i];
+		if (light.bActive == false)
+		{
+			continue;
+		}
+
+		glm::vec3 toLight = light.position - fragmentPosition;
+		float distanceSquared = glm::dot(toLight, toLight);
+		if ((distanceSquared > m_pointLightRangesSquared[i]) || (distanceSquared <= 0.0f))
+		{
+			continue;
+		}
+		float distance = std::sqrt(distanceSquared);
+		glm::vec3 lightDirection = toLight / distance;
+		float attenuation = Attenuation(light.constant, light.linear, light.quadratic, distance);
+		float diffuse = std::max(glm::dot(normal, lightDirection), 0.0f);
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+		float specular = std::pow(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+		result += light.ambient * attenuation * baseRgb;
+		result += light.diffuse * (diffuse * attenuation) * material.diffuseColor * baseRgb;
+		result += light.specular * (specular * attenuation) * material.specularColor;
+	}
+
+	const SPOT_LIGHT& spot = m_lights.spotLight;
+	if (spot.bActive == true)
+	{
+		glm::vec3 lightDirection = glm::normalize(spot.position - fragmentPosition);
+		float theta = glm::dot(lightDirection, glm::normalize(-spot.direction));
+		if (theta > spot.outerCutOff)
+		{
+			float diffuse = std::max(glm::dot(normal, lightDirection), 0.0f);
+			glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+			float specular = std::pow(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), material.shininess);
+			float distance = glm::length(spot.position - fragmentPosition);
+			float attenuation = Attenuation(spot.constant, spot.linear, spot.quadratic, distance);
+			float epsilon = spot.cutOff - spot.outerCutOff;
+			float intensity = std::min(std::max((theta - spot.outerCutOff) / epsilon, 0.0f), 1.0f);
+			glm::vec3 color = (spot.ambient * baseRgb) +
+				(spot.diffuse * diffuse * material.diffuseColor * baseRgb) +
+				(spot.specular * specular * material.specularColor * baseRgb);
+			result += color * (attenuation * intensity);
+		}
+	}
+
+	return(PackColor(glm::vec4(result, bUseTexture ? baseColor.a : g_ObjectColor.a)));
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used for showing the last frame in the
+ *  window.  The frame is copied into a texture and blitted
+ *  into the bound draw framebuffer, flipped, since the frame
+ *  is stored top row first.
+ ***********************************************************/
+void SoftwareRasterizer::Present(int framebufferWidth, int framebufferHeight)
+{
+	if (m_colorBuffer.empty() == true)
+	{
+		return;
+	}
+
+	if ((0 == m_presentTextureID) || (m_presentWidth != m_width) || (m_presentHeight != m_height))
+	{
+		Destroy();
+		m_presentWidth = m_width;
+		m_presentHeight = m_height;
+
+		glGenTextures(1, &m_presentTextureID);
+		glBindTexture(GL_TEXTURE_2D, m_presentTextureID);
+		glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, m_width, m_height);
+		MemoryTracker::TrackTexture(m_presentTextureID, MemoryTracker::MEMORY_GPU_RENDER_TARGETS,
+			"software present", GL_RGBA8, m_width, m_height, 1, 1);
+
+		glGenFramebuffers(1, &m_presentFramebufferID);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebufferID);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_presentTextureID, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_presentTextureID);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, m_stride);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, &m_colorBuffer[0]);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_presentFramebufferID);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		0, framebufferHeight, framebufferWidth, 0,
+		GL_COLOR_BUFFER_BIT,
+		GL_NEAREST);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used for writing the last frame to an
+ *  uncompressed 24-bit TGA file, stored top row first.
+ ***********************************************************/
+bool SoftwareRasterizer::WriteImage(const char* filename) const
+{
+	if ((m_colorBuffer.empty() == true) || (m_width > 0xffff) || (m_height > 0xffff))
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> image;
+	ImageWriter::EncodeTga(
+		(const unsigned char*)&m_colorBuffer[0],
+		m_width,
+		m_height,
+		(size_t)m_stride * sizeof(uint32_t),
+		false,
+		false,
+		image);
+	if (ImageWriter::WriteFile(filename, image) == false)
+	{
+		return(false);
+	}
+
+	std::cout << "INFO: Wrote " << m_width << "x" << m_height << " image " << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  GetColorBuffer()
+ *
+ *  This method is used for getting the pixels of the last
+ *  frame, RGBA8 with the top row first.
+ ***********************************************************/
+const uint32_t* SoftwareRasterizer::GetColorBuffer() const
+{
+	return(m_colorBuffer.empty() ? NULL : &m_colorBuffer[0]);
+}
+
+/***********************************************************
+ *  GetWidth()
+ *
+ *  This method is used for getting the width of the frame.
+ ***********************************************************/
+int SoftwareRasterizer::GetWidth() const
+{
+	return(m_width);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height of the frame.
+ ***********************************************************/
+int SoftwareRasterizer::GetHeight() const
+{
+	return(m_height);
+}
+
+/***********************************************************
+ *  GetStride()
+ *
+ *  This method is used for getting the number of pixels from
+ *  one row of the color buffer to the next.
+ ***********************************************************/
+int SoftwareRasterizer::GetStride() const
+{
+	return(m_stride);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the statistics of the
+ *  last frame.
+ ***********************************************************/
+const SoftwareRasterizer::RASTER_STATS& SoftwareRasterizer::GetStats() const
+{
+	return(m_stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the statistics of the
+ *  last frame, and the frames per second the rasterizer
+ *  sustained since the last print.
+ ***********************************************************/
+void SoftwareRasterizer::PrintStats()
+{
+	std::cout << "SOFTWARE: " << m_width << "x" << m_height
+		<< (m_stats.bSimd ? " AVX2" : " scalar")
+		<< ", " << m_stats.framesPerSecond << " fps"
+		<< ", frame " << m_stats.frameMs << " ms"
+		<< " (geometry " << m_stats.geometryMs << " ms, raster " << m_stats.rasterMs << " ms)"
+		<< ", triangles " << m_stats.trianglesBinned << " of " << m_stats.trianglesSubmitted
+		<< ", pixels " << m_stats.pixelsShaded
+		<< ", tiles " << (m_tilesX * m_tilesY) << " avg " << m_stats.averageTileMs << " ms"
+		<< " max " << m_stats.maxTileMs << " ms at " << m_stats.slowestTileX << "," << m_stats.slowestTileY
+		<< std::endl;
+
+	m_statsFrames = 0;
+	m_statsSeconds = 0.0;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the texture and the
+ *  framebuffer used to present the frames.
+ ***********************************************************/
+void SoftwareRasterizer::Destroy()
+{
+	if (0 != m_presentFramebufferID)
+	{
+		glDeleteFramebuffers(1, &m_presentFramebufferID);
+		m_presentFramebufferID = 0;
+	}
+	if (0 != m_presentTextureID)
+	{
+		glDeleteTextures(1, &m_presentTextureID);
+		MemoryTracker::ReleaseTexture(m_presentTextureID);
+		m_presentTextureID = 0;
+	}
+}
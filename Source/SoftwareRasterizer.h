@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// draw the recorded frames on the CPU - tile-binned rasterization across all
+// cores, with the lighting of fragmentShader.glsl, for machines without a GPU
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameSnapshot.h"
+#include "JobSystem.h"
+#include "ShapeGeometry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  This class draws a frame snapshot into a color buffer on
+ *  the CPU.  A frame goes through two passes on the job
+ *  system:
+ *
+ *  - the draws are split into chunks, and every chunk moves
+ *    its triangles into clip space, clips them against the
+ *    near plane, sets up their edge and attribute planes and
+ *    bins them into the screen tiles they touch
+ *  - every tile then rasterizes the triangles binned into it,
+ *    chunk by chunk, so they are drawn in submission order
+ *    and no two jobs write the same pixels
+ *
+ *  Spans of eight pixels are tested and interpolated at once,
+ *  with AVX2 when the processor has it.  Depth is tested
+ *  before shading, which matches OpenGL since the shader
+ *  neither discards nor writes depth.  Attributes are
+ *  interpolated perspective-correct and shaded like
+ *  fragmentShader.glsl, with textures sampled bilinearly from
+ *  the mip level that matches the texel footprint of a span.
+ *
+ *  The frame can be written to an image file, or presented
+ *  by blitting it into the window through a texture.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+	// constructor
+	SoftwareRasterizer(JobSystem* pJobSystem = NULL);
+	// destructor
+	~SoftwareRasterizer();
+
+	// one object to draw, in the form of the shader draw data
+	struct RASTER_DRAW
+	{
+		glm::mat4 model;
+		glm::mat3 normalMatrix;
+		glm::vec2 uvScale;
+		// -1 uses the zeroed material past the end
+		int materialIndex;
+		// texture array layer, -1 when untextured
+		int textureLayer;
+		int meshType;
+	};
+
+	struct RASTER_MATERIAL
+	{
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	struct RASTER_STATS
+	{
+		int framesRendered;
+		// triangles submitted, and those left after culling and clipping
+		int trianglesSubmitted;
+		int trianglesBinned;
+		// pixels that passed the depth test and were shaded
+		uint64_t pixelsShaded;
+		// time spent in the two passes of the last frame
+		double geometryMs;
+		double rasterMs;
+		double frameMs;
+		// tile times of the last frame
+		double averageTileMs;
+		double maxTileMs;
+		int slowestTileX;
+		int slowestTileY;
+		// frames per second since the stats were last printed
+		double framesPerSecond;
+		bool bSimd;
+	};
+
+	// width and height of a screen tile, a multiple of the span width
+	static const int TILE_SIZE = 64;
+	// pixels tested and interpolated together
+	static const int SPAN_WIDTH = 8;
+
+private:
+	// planes interpolated over a triangle: depth, 1/w, then the
+	// world position, normal and texture coordinate over w
+	enum RASTER_PLANE
+	{
+		PLANE_DEPTH,
+		PLANE_INVERSE_W,
+		PLANE_POSITION_X,
+		PLANE_POSITION_Y,
+		PLANE_POSITION_Z,
+		PLANE_NORMAL_X,
+		PLANE_NORMAL_Y,
+		PLANE_NORMAL_Z,
+		PLANE_TEXTURE_U,
+		PLANE_TEXTURE_V,
+		PLANE_COUNT
+	};
+
+	// a triangle set up for rasterization, in screen space with
+	// y down and pixel centers at +0.5
+	struct RASTER_TRIANGLE
+	{
+		// edge functions a * x + b * y + c, positive inside
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		// an edge owns the pixels exactly on it when it is a top
+		// or left edge, so shared edges are drawn once
+		bool bTopLeft[3];
+		// attribute planes a * x + b * y + c
+		float planeA[PLANE_COUNT];
+		float planeB[PLANE_COUNT];
+		float planeC[PLANE_COUNT];
+		// pixel bounds, inclusive
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		int materialIndex;
+		int textureLayer;
+	};
+
+	// vertex after the vertex stage, in clip space
+	struct CLIP_VERTEX
+	{
+		glm::vec4 position;
+		glm::vec3 worldPosition;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+	};
+
+	// triangles of a range of draws and the tiles they touch
+	struct RASTER_CHUNK
+	{
+		std::vector<RASTER_TRIANGLE> triangles;
+		// triangle indexes binned into every tile
+		std::vector<std::vector<uint32_t> > bins;
+		int trianglesSubmitted;
+	};
+
+	// texture array layers with their mip chains
+	struct RASTER_TEXTURES
+	{
+		int size;
+		int levelCount;
+		int layerCount;
+		size_t layerBytes;
+		// byte offset and size of every level within a layer
+		std::vector<size_t> levelOffsets;
+		std::vector<int> levelSizes;
+		std::vector<unsigned char> data;
+	};
+
+	JobSystem* m_pJobSystem;
+	bool m_bSimd;
+
+	// frame buffers, padded to whole tiles
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	int m_stride;
+	std::vector<uint32_t> m_colorBuffer;
+	std::vector<float> m_depthBuffer;
+
+	// scene data, shared with the OpenGL path
+	const std::vector<SHAPE_GEOMETRY>* m_pShapes;
+	std::vector<RASTER_MATERIAL> m_materials;
+	// shared by the rasterizers of a render farm
+	std::shared_ptr<const RASTER_TEXTURES> m_pTextures;
+
+	// state of the frame being drawn
+	const RASTER_DRAW* m_pDraws;
+	int m_drawCount;
+	glm::mat4 m_viewProjection;
+	glm::vec3 m_viewPosition;
+	LIGHT_STATE m_lights;
+	// squared ranges of the point lights, as the shaders get them
+	float m_pointLightRangesSquared[MAX_POINT_LIGHTS];
+	std::vector<RASTER_CHUNK> m_chunks;
+	int m_chunkCount;
+	std::vector<double> m_tileMs;
+	std::vector<uint64_t> m_tilePixels;
+
+	// presentation
+	GLuint m_presentTextureID;
+	GLuint m_presentFramebufferID;
+	int m_presentWidth;
+	int m_presentHeight;
+
+	RASTER_STATS m_stats;
+	double m_statsSeconds;
+	int m_statsFrames;
+
+	// transform, clip, set up and bin the draws of a chunk
+	void ProcessChunk(int chunk, int firstDraw, int lastDraw);
+	// clip a triangle against the near plane and set up the result
+	void ClipTriangle(const CLIP_VERTEX* pVertices, int materialIndex, int textureLayer, RASTER_CHUNK& chunk);
+	// set up the edges and planes of a clipped triangle and bin it
+	void SetupTriangle(
+		const CLIP_VERTEX& v0,
+		const CLIP_VERTEX& v1,
+		const CLIP_VERTEX& v2,
+		int materialIndex,
+		int textureLayer,
+		RASTER_CHUNK& chunk);
+	// clear a tile and draw the triangles binned into it
+	void RasterizeTile(int tile);
+	// draw the part of a triangle inside a tile, one span at a time
+	uint64_t RasterizeTriangle(const RASTER_TRIANGLE& triangle, int tileX, int tileY);
+	uint64_t RasterizeTriangleSimd(const RASTER_TRIANGLE& triangle, int tileX, int tileY);
+	// light one pixel like fragmentShader.glsl
+	uint32_t ShadeFragment(const RASTER_TRIANGLE& triangle, const float* pValues, float lod) const;
+	// mip level for the texel footprint at a pixel
+	float ComputeLod(const RASTER_TRIANGLE& triangle, float x, float y) const;
+	// sample a texture layer bilinearly from the nearest mip level
+	glm::vec4 SampleTexture(int layer, float u, float v, float lod) const;
+
+public:
+	// size the frame buffers, keeping them when the size is unchanged
+	void Resize(int width, int height);
+	// shapes drawn by mesh type, owned by the caller
+	void SetShapes(const std::vector<SHAPE_GEOMETRY>* pShapes);
+	// materials by index
+	void SetMaterials(const std::vector<RASTER_MATERIAL>& materials);
+	// copy square RGBA texture array layers and build their mip chains
+	void SetTextures(const unsigned char* pLayers, int layerSize, int layerCount);
+	// draw with the shapes, materials and textures of another
+	// rasterizer, without copying the textures
+	void ShareAssets(const SoftwareRasterizer& source);
+
+	// draw the objects with the camera and lights of a snapshot
+	void Render(const RASTER_DRAW* pDraws, int drawCount, const FRAME_SNAPSHOT& snapshot);
+	// blit the last frame into the bound draw framebuffer
+	void Present(int framebufferWidth, int framebufferHeight);
+	// write the last frame to an uncompressed TGA file
+	bool WriteImage(const char* filename) const;
+
+	const uint32_t* GetColorBuffer() const;
+	int GetWidth() const;
+	int GetHeight() const;
+	// row length of the color buffer, in pixels
+	int GetStride() const;
+
+	const RASTER_STATS& GetStats() const;
+	void PrintStats();
+	// free the presentation texture and framebuffer
+	void Destroy();
+};
@@ -0,0 +1,415 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.cpp
+// ============
+// bake the transforms of static scene objects into merged vertex and index
+// buffers, so a group of props that never moves is drawn with one call
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StaticBatcher.h"
+#include "RenderQueue.h"
+#include "MeshOptimizer.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+
+/***********************************************************
+ *  StaticBatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StaticBatcher::StaticBatcher(const StaticBatcher* pShapeSource)
+{
+	m_vertexArrayID = 0;
+	m_vertexBufferID = 0;
+	m_indexBufferID = 0;
+	m_lightmapBufferID = 0;
+
+	if (NULL != pShapeSource)
+	{
+		m_pShapes = pShapeSource->m_pShapes;
+		return;
+	}
+
+	m_pShapes = &m_shapes;
+	m_shapes.resize(MESH_TYPE_COUNT);
+	for (int i = 0; i < MESH_TYPE_COUNT; i++)
+	{
+		ShapeGeometry::BuildShape(i, m_shapes[i]);
+		// the merged copies keep the cache-friendly order of each shape
+		MeshOptimizer::Optimize(m_shapes[i]);
+	}
+	TrackShapeBytes();
+}
+
+/***********************************************************
+ *  ~StaticBatcher()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StaticBatcher::~StaticBatcher()
+{
+	Destroy();
+	MemoryTracker::ReleaseHeap(this);
+	MemoryTracker::ReleaseHeap(&m_shapes);
+}
+
+/***********************************************************
+ *  TrackShapeBytes()
+ *
+ *  This method is used for reporting the memory of the shape
+ *  geometry a batcher that owns its shapes keeps for merging.
+ ***********************************************************/
+void StaticBatcher::TrackShapeBytes()
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_shapes.size(); i++)
+	{
+		bytes += (m_shapes[i].vertices.capacity() * sizeof(SHAPE_VERTEX)) +
+			(m_shapes[i].indices.capacity() * sizeof(uint32_t));
+	}
+	MemoryTracker::TrackHeap(&m_shapes, MemoryTracker::MEMORY_CPU_GEOMETRY, "batch shapes", bytes);
+}
+
+/***********************************************************
+ *  AddShape()
+ *
+ *  This method is used for adding the geometry of an imported
+ *  mesh, already in the order it is drawn in, so its mesh
+ *  type matches the one the meshes were given.  It is called
+ *  on a batcher that owns its shapes, before any batcher that
+ *  shares them is built.
+ ***********************************************************/
+void StaticBatcher::AddShape(const SHAPE_GEOMETRY& geometry)
+{
+	m_shapes.push_back(geometry);
+	TrackShapeBytes();
+}
+
+/***********************************************************
+ *  AppendObject()
+ *
+ *  This method is used for adding the geometry of one object
+ *  to the merged buffers.  Positions are moved into world
+ *  space and normals are turned by the object's normal
+ *  matrix, so a batch is drawn with identity matrices.  A
+ *  mirroring transform turns the triangles inside out, so
+ *  their winding is reversed to keep them facing outward.
+ ***********************************************************/
+void StaticBatcher::AppendObject(const SCENE_OBJECT* pObjects, int index, uint32_t drawIndex, STATIC_BATCH& batch)
+{
+	const SCENE_OBJECT& object = pObjects[index];
+	const SHAPE_GEOMETRY& shape = (*m_pShapes)[object.meshType];
+	glm::mat4 model = RenderQueue::ComposeWorldTransform(pObjects, index);
+	glm::mat3 normalMatrix = RenderQueue::ComposeNormalMatrix(model);
+	uint32_t base = (uint32_t)m_vertices.size();
+
+	for (size_t i = 0; i < shape.vertices.size(); i++)
+	{
+		BATCH_VERTEX vertex;
+		vertex.position = glm::vec3(model * glm::vec4(shape.vertices[i].position, 1.0f));
+		glm::vec3 normal = normalMatrix * shape.vertices[i].normal;
+		float length = glm::length(normal);
+		vertex.normal = (length > 0.0f) ? (normal / length) : shape.vertices[i].normal;
+		vertex.textureCoordinate = shape.vertices[i].textureCoordinate;
+		vertex.drawIndex = drawIndex;
+		m_vertices.push_back(vertex);
+
+		batch.boundsMin = glm::min(batch.boundsMin, vertex.position);
+		batch.boundsMax = glm::max(batch.boundsMax, vertex.position);
+	}
+
+	bool bMirrored = glm::determinant(glm::mat3(model)) < 0.0f;
+	for (size_t i = 0; i + 2 < shape.indices.size(); i += 3)
+	{
+		m_indices.push_back(base + shape.indices[i]);
+		if (bMirrored)
+		{
+			m_indices.push_back(base + shape.indices[i + 2]);
+			m_indices.push_back(base + shape.indices[i + 1]);
+		}
+		else
+		{
+			m_indices.push_back(base + shape.indices[i + 1]);
+			m_indices.push_back(base + shape.indices[i + 2]);
+		}
+	}
+
+	batch.indexCount += (uint32_t)(shape.indices.size() - (shape.indices.size() % 3));
+	batch.objectCount++;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for merging the static objects.  The
+ *  objects of each batch group are baked into one batch, and
+ *  they get draw indexes in the order they are merged, which
+ *  GetStaticObjects() maps back to the scene objects.
+ ***********************************************************/
+void StaticBatcher::Build(const SCENE_OBJECT* pObjects, int objectCount)
+{
+	m_vertices.clear();
+	m_indices.clear();
+	m_lightmapCoordinates.clear();
+	m_batches.clear();
+	m_staticObjects.clear();
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		if ((pObjects[i].flags & SCENE_OBJECT_STATIC) != 0)
+		{
+			m_staticObjects.push_back(i);
+		}
+	}
+
+	// keep the objects of a group together, in scene order
+	std::stable_sort(m_staticObjects.begin(), m_staticObjects.end(),
+		[pObjects](int left, int right)
+		{
+			return(pObjects[left].batchGroup < pObjects[right].batchGroup);
+		});
+
+	for (size_t i = 0; i < m_staticObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = pObjects[m_staticObjects[i]];
+
+		if ((m_batches.empty() == true) || (m_batches.back().batchGroup != object.batchGroup))
+		{
+			STATIC_BATCH batch;
+			batch.batchGroup = object.batchGroup;
+			batch.objectCount = 0;
+			batch.firstIndex = (uint32_t)m_indices.size();
+			batch.indexCount = 0;
+			batch.boundsMin = glm::vec3(1.0e30f);
+			batch.boundsMax = glm::vec3(-1.0e30f);
+			m_batches.push_back(batch);
+		}
+
+		AppendObject(pObjects, m_staticObjects[i], (uint32_t)i, m_batches.back());
+	}
+
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_GEOMETRY, "static batch staging", GetGeometryBytes());
+
+	std::cout << "INFO: Merged " << m_staticObjects.size() << " static objects into "
+		<< m_batches.size() << " batches of " << m_vertices.size() << " vertices" << std::endl;
+}
+
+/***********************************************************
+ *  SetLightmapCoordinates()
+ *
+ *  This method is used for replacing the merged vertices with
+ *  the copies the lightmap charts are made of, each with its
+ *  lightmap coordinate.  The new indexes keep the order of
+ *  the triangles, so the index ranges of the batches do not
+ *  change.  It has to be called before CreateBuffers().
+ ***********************************************************/
+void StaticBatcher::SetLightmapCoordinates(
+	const std::vector<uint32_t>& vertexSources,
+	const std::vector<glm::vec3>& coordinates,
+	const std::vector<uint32_t>& indices)
+{
+	if ((vertexSources.size() != coordinates.size()) || (indices.size() != m_indices.size()))
+	{
+		return;
+	}
+
+	std::vector<BATCH_VERTEX> vertices(vertexSources.size());
+	for (size_t i = 0; i < vertexSources.size(); i++)
+	{
+		vertices[i] = m_vertices[vertexSources[i]];
+	}
+	m_vertices.swap(vertices);
+	m_indices = indices;
+	m_lightmapCoordinates = coordinates;
+	MemoryTracker::TrackHeap(this, MemoryTracker::MEMORY_CPU_GEOMETRY, "static batch staging", GetGeometryBytes());
+}
+
+/***********************************************************
+ *  CreateBuffers()
+ *
+ *  This method is used for uploading the merged geometry and
+ *  describing its vertex layout.  The draw index is an integer
+ *  attribute on the same location the shapes set as a constant.
+ *  The lightmap coordinates, when there are any, are read from
+ *  a second buffer.
+ ***********************************************************/
+bool StaticBatcher::CreateBuffers()
+{
+	if (m_vertices.empty() == true)
+	{
+		return(true);
+	}
+
+	glGenVertexArrays(1, &m_vertexArrayID);
+	glBindVertexArray(m_vertexArrayID);
+
+	glGenBuffers(1, &m_vertexBufferID);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBufferID);
+	glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(BATCH_VERTEX), &m_vertices[0], GL_STATIC_DRAW);
+	MemoryTracker::TrackBuffer(m_vertexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+		"static batch vertices", m_vertices.size() * sizeof(BATCH_VERTEX));
+
+	glGenBuffers(1, &m_indexBufferID);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBufferID);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(uint32_t), &m_indices[0], GL_STATIC_DRAW);
+	MemoryTracker::TrackBuffer(m_indexBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+		"static batch indices", m_indices.size() * sizeof(uint32_t));
+
+	GLsizei stride = sizeof(BATCH_VERTEX);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, position));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, normal));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(BATCH_VERTEX, textureCoordinate));
+	glEnableVertexAttribArray(2);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, stride, (void*)offsetof(BATCH_VERTEX, drawIndex));
+	glEnableVertexAttribArray(3);
+
+	if (m_lightmapCoordinates.empty() == false)
+	{
+		glGenBuffers(1, &m_lightmapBufferID);
+		glBindBuffer(GL_ARRAY_BUFFER, m_lightmapBufferID);
+		glBufferData(GL_ARRAY_BUFFER, m_lightmapCoordinates.size() * sizeof(glm::vec3), &m_lightmapCoordinates[0], GL_STATIC_DRAW);
+		MemoryTracker::TrackBuffer(m_lightmapBufferID, MemoryTracker::MEMORY_GPU_GEOMETRY,
+			"static batch lightmap coordinates", m_lightmapCoordinates.size() * sizeof(glm::vec3));
+		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		glEnableVertexAttribArray(4);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// the geometry now lives on the GPU
+	std::vector<BATCH_VERTEX>().swap(m_vertices);
+	std::vector<uint32_t>().swap(m_indices);
+	std::vector<glm::vec3>().swap(m_lightmapCoordinates);
+	MemoryTracker::ReleaseHeap(this);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the OpenGL buffers.
+ ***********************************************************/
+void StaticBatcher::Destroy()
+{
+	if (0 != m_vertexArrayID)
+	{
+		glDeleteVertexArrays(1, &m_vertexArrayID);
+		m_vertexArrayID = 0;
+	}
+	if (0 != m_vertexBufferID)
+	{
+		glDeleteBuffers(1, &m_vertexBufferID);
+		MemoryTracker::ReleaseBuffer(m_vertexBufferID);
+		m_vertexBufferID = 0;
+	}
+	if (0 != m_indexBufferID)
+	{
+		glDeleteBuffers(1, &m_indexBufferID);
+		MemoryTracker::ReleaseBuffer(m_indexBufferID);
+		m_indexBufferID = 0;
+	}
+	if (0 != m_lightmapBufferID)
+	{
+		glDeleteBuffers(1, &m_lightmapBufferID);
+		MemoryTracker::ReleaseBuffer(m_lightmapBufferID);
+		m_lightmapBufferID = 0;
+	}
+}
+
+/***********************************************************
+ *  DrawBatch()
+ *
+ *  This method is used for drawing one merged batch.  With
+ *  several views the batch is drawn as one instance per view.
+ ***********************************************************/
+void StaticBatcher::DrawBatch(int batch, int viewCount) const
+{
+	if ((0 == m_vertexArrayID) || (batch < 0) || (batch >= (int)m_batches.size()))
+	{
+		return;
+	}
+
+	glBindVertexArray(m_vertexArrayID);
+	const void* pFirstIndex = (void*)(m_batches[batch].firstIndex * sizeof(uint32_t));
+	if (viewCount > 1)
+	{
+		glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)m_batches[batch].indexCount, GL_UNSIGNED_INT, pFirstIndex, viewCount);
+	}
+	else
+	{
+		glDrawElements(GL_TRIANGLES, (GLsizei)m_batches[batch].indexCount, GL_UNSIGNED_INT, pFirstIndex);
+	}
+	glBindVertexArray(0);
+}
+
+/***********************************************************
+ *  GetBatches()
+ *
+ *  This method is used for getting the merged batches.
+ ***********************************************************/
+const std::vector<StaticBatcher::STATIC_BATCH>& StaticBatcher::GetBatches() const
+{
+	return(m_batches);
+}
+
+/***********************************************************
+ *  GetVertices()
+ *
+ *  This method is used for getting the merged vertices, in
+ *  world space, until they are uploaded.
+ ***********************************************************/
+const std::vector<StaticBatcher::BATCH_VERTEX>& StaticBatcher::GetVertices() const
+{
+	return(m_vertices);
+}
+
+/***********************************************************
+ *  GetIndices()
+ *
+ *  This method is used for getting the merged indexes, in the
+ *  order the batches draw them, until they are uploaded.
+ ***********************************************************/
+const std::vector<uint32_t>& StaticBatcher::GetIndices() const
+{
+	return(m_indices);
+}
+
+/***********************************************************
+ *  GetStaticObjects()
+ *
+ *  This method is used for getting the scene object index of
+ *  every static draw index.
+ ***********************************************************/
+const std::vector<int>& StaticBatcher::GetStaticObjects() const
+{
+	return(m_staticObjects);
+}
+
+/***********************************************************
+ *  GetGeometryBytes()
+ *
+ *  This method is used for getting the size of the merged
+ *  vertices and indices that are still to be uploaded.
+ ***********************************************************/
+size_t StaticBatcher::GetGeometryBytes() const
+{
+	return((m_vertices.size() * sizeof(BATCH_VERTEX)) + (m_indices.size() * sizeof(uint32_t)) +
+		(m_lightmapCoordinates.size() * sizeof(glm::vec3)));
+}
+
+/***********************************************************
+ *  GetShapes()
+ *
+ *  This method is used for getting the local space geometry
+ *  of every mesh type the batches are merged from.
+ ***********************************************************/
+const std::vector<SHAPE_GEOMETRY>& StaticBatcher::GetShapes() const
+{
+	return(*m_pShapes);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// staticbatcher.h
+// ============
+// bake the transforms of static scene objects into merged vertex and index
+// buffers, so a group of props that never moves is drawn with one call
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+#include "ShapeGeometry.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  StaticBatcher
+ *
+ *  This class merges the static scene objects of each batch
+ *  group into one range of a shared vertex and index buffer.
+ *  The vertices are transformed into world space when the
+ *  scene is loaded, and every vertex keeps the index of its
+ *  object's draw data so the shaders still find the texture,
+ *  material and UV scale of the object it came from.  The
+ *  world space bounds of each batch are kept for culling.
+ *  Batchers that are built often, like those of streamed
+ *  world cells, share the shapes of one source batcher.
+ *  Lightmapped geometry is unwelded before it is uploaded,
+ *  and its lightmap coordinates go in a buffer of their own,
+ *  so batches without a lightmap keep the smaller vertices.
+ ***********************************************************/
+class StaticBatcher
+{
+public:
+	// constructor, a batcher with a shape source uses its shapes
+	// instead of building its own
+	StaticBatcher(const StaticBatcher* pShapeSource = NULL);
+	// destructor
+	~StaticBatcher();
+
+	// vertex layout of the merged buffer
+	struct BATCH_VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 textureCoordinate;
+		uint32_t drawIndex;
+	};
+
+	struct STATIC_BATCH
+	{
+		int batchGroup;
+		int objectCount;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+	};
+
+private:
+	// local space geometry of every mesh type, the basic shapes first
+	std::vector<SHAPE_GEOMETRY> m_shapes;
+	// the shapes that are merged, these or those of the shape source
+	const std::vector<SHAPE_GEOMETRY>* m_pShapes;
+	// merged geometry, freed once it is uploaded
+	std::vector<BATCH_VERTEX> m_vertices;
+	std::vector<uint32_t> m_indices;
+	// lightmap coordinate and page of every vertex, empty when the
+	// batches are not lightmapped
+	std::vector<glm::vec3> m_lightmapCoordinates;
+	std::vector<STATIC_BATCH> m_batches;
+	// scene object index of every static draw index
+	std::vector<int> m_staticObjects;
+
+	GLuint m_vertexArrayID;
+	GLuint m_vertexBufferID;
+	GLuint m_indexBufferID;
+	GLuint m_lightmapBufferID;
+
+	// append one object, transformed, to the merged geometry
+	void AppendObject(const SCENE_OBJECT* pObjects, int index, uint32_t drawIndex, STATIC_BATCH& batch);
+	// report the memory of the shapes to the memory tracker
+	void TrackShapeBytes();
+
+public:
+	// add the geometry of an imported mesh as the next mesh type
+	void AddShape(const SHAPE_GEOMETRY& geometry);
+	// merge the static objects, grouped by their batch group
+	void Build(const SCENE_OBJECT* pObjects, int objectCount);
+	// replace the merged geometry with copies of its vertices that
+	// have lightmap coordinates, before it is uploaded
+	void SetLightmapCoordinates(
+		const std::vector<uint32_t>& vertexSources,
+		const std::vector<glm::vec3>& coordinates,
+		const std::vector<uint32_t>& indices);
+	// upload the merged geometry into OpenGL buffers
+	bool CreateBuffers();
+	// free the OpenGL buffers
+	void Destroy();
+
+	// draw one batch, once per view of the frame, the draw data must
+	// already be bound
+	void DrawBatch(int batch, int viewCount = 1) const;
+
+	const std::vector<STATIC_BATCH>& GetBatches() const;
+	// merged geometry, until CreateBuffers() uploads it
+	const std::vector<BATCH_VERTEX>& GetVertices() const;
+	const std::vector<uint32_t>& GetIndices() const;
+	const std::vector<int>& GetStaticObjects() const;
+	// size of the merged geometry that CreateBuffers() uploads
+	size_t GetGeometryBytes() const;
+	// geometry of every mesh type, the basic shapes first
+	const std::vector<SHAPE_GEOMETRY>& GetShapes() const;
+};
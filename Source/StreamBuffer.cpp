@@ -0,0 +1,283 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.cpp
+// ============
+// persistently mapped buffer for data that is written every frame, split
+// into regions that are guarded by fences while the GPU reads them
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StreamBuffer.h"
+#include "MemoryTracker.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// storage and mapping flags, the same flags are needed for both
+	const GLbitfield g_StreamBufferFlags =
+		GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	// time slice of a fence wait, in nanoseconds
+	const GLuint64 g_FenceWaitTimeout = 1000000;
+}
+
+/***********************************************************
+ *  StreamBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamBuffer::StreamBuffer()
+{
+	m_target = GL_SHADER_STORAGE_BUFFER;
+	m_bufferID = 0;
+	m_pMappedData = NULL;
+	m_regionSize = 0;
+	m_regionCount = 0;
+	m_currentRegion = 0;
+	for (int i = 0; i < MAX_REGIONS; i++)
+	{
+		m_fences[i] = NULL;
+	}
+}
+
+/***********************************************************
+ *  ~StreamBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer with one
+ *  region of regionSize bytes for every frame in flight.
+ ***********************************************************/
+bool StreamBuffer::Initialize(GLenum target, size_t regionSize, int regionCount)
+{
+	if ((regionCount < 1) || (regionCount > MAX_REGIONS))
+	{
+		std::cout << "ERROR: Stream buffer needs 1 to " << MAX_REGIONS << " regions" << std::endl;
+		return(false);
+	}
+
+	m_target = target;
+	m_regionCount = regionCount;
+	m_currentRegion = 0;
+
+	return(CreateStorage(regionSize));
+}
+
+/***********************************************************
+ *  CreateStorage()
+ *
+ *  This method is used for creating the immutable buffer
+ *  storage and mapping it for the lifetime of the buffer.
+ *  The region size is rounded up to the offset alignment of
+ *  the binding target, so every region can be bound.
+ ***********************************************************/
+bool StreamBuffer::CreateStorage(size_t regionSize)
+{
+	GLint alignment = 256;
+	if (m_target == GL_SHADER_STORAGE_BUFFER)
+	{
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	}
+	else if (m_target == GL_UNIFORM_BUFFER)
+	{
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	}
+	if (alignment < 1)
+	{
+		alignment = 256;
+	}
+	m_regionSize = ((regionSize + alignment - 1) / alignment) * alignment;
+	if (m_regionSize == 0)
+	{
+		m_regionSize = alignment;
+	}
+
+	GLsizeiptr totalSize = (GLsizeiptr)(m_regionSize * m_regionCount);
+
+	glGenBuffers(1, &m_bufferID);
+	glBindBuffer(m_target, m_bufferID);
+	glBufferStorage(m_target, totalSize, NULL, g_StreamBufferFlags);
+	MemoryTracker::TrackBuffer(m_bufferID, MemoryTracker::MEMORY_GPU_BUFFERS, "stream buffer", totalSize);
+	m_pMappedData = (unsigned char*)glMapBufferRange(m_target, 0, totalSize, g_StreamBufferFlags);
+	glBindBuffer(m_target, 0);
+
+	if (NULL == m_pMappedData)
+	{
+		std::cout << "ERROR: Could not map stream buffer of " << totalSize << " bytes" << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for unmapping and freeing the buffer.
+ *  The GPU is waited on first, since it may still be reading
+ *  from the regions.
+ ***********************************************************/
+void StreamBuffer::Destroy()
+{
+	for (int i = 0; i < MAX_REGIONS; i++)
+	{
+		WaitForRegion(i);
+	}
+
+	if (0 != m_bufferID)
+	{
+		if (NULL != m_pMappedData)
+		{
+			glBindBuffer(m_target, m_bufferID);
+			glUnmapBuffer(m_target);
+			glBindBuffer(m_target, 0);
+		}
+		glDeleteBuffers(1, &m_bufferID);
+		MemoryTracker::ReleaseBuffer(m_bufferID);
+	}
+
+	m_bufferID = 0;
+	m_pMappedData = NULL;
+	m_regionSize = 0;
+}
+
+/***********************************************************
+ *  Reserve()
+ *
+ *  This method is used for making sure every region holds at
+ *  least regionSize bytes.  Growing recreates the buffer, so
+ *  it is meant for the rare frames where the data outgrows
+ *  it, and the size is doubled to keep that rare.
+ ***********************************************************/
+bool StreamBuffer::Reserve(size_t regionSize)
+{
+	if (regionSize <= m_regionSize)
+	{
+		return(true);
+	}
+
+	size_t newSize = m_regionSize * 2;
+	if (newSize < regionSize)
+	{
+		newSize = regionSize;
+	}
+
+	int regionCount = m_regionCount;
+	Destroy();
+	m_regionCount = regionCount;
+	m_currentRegion = 0;
+
+	return(CreateStorage(newSize));
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for blocking until the GPU is done
+ *  with the draws that read a region, then freeing its fence.
+ ***********************************************************/
+void StreamBuffer::WaitForRegion(int region)
+{
+	if (NULL == m_fences[region])
+	{
+		return;
+	}
+
+	while (true)
+	{
+		GLenum result = glClientWaitSync(
+			m_fences[region],
+			GL_SYNC_FLUSH_COMMANDS_BIT,
+			g_FenceWaitTimeout);
+		if ((result == GL_ALREADY_SIGNALED) ||
+			(result == GL_CONDITION_SATISFIED) ||
+			(result == GL_WAIT_FAILED))
+		{
+			break;
+		}
+	}
+
+	glDeleteSync(m_fences[region]);
+	m_fences[region] = NULL;
+}
+
+/***********************************************************
+ *  BeginRegion()
+ *
+ *  This method is used for getting the mapped memory of the
+ *  current region.  With three regions the wait only blocks
+ *  when the CPU runs more than two frames ahead of the GPU.
+ ***********************************************************/
+void* StreamBuffer::BeginRegion()
+{
+	if (NULL == m_pMappedData)
+	{
+		return(NULL);
+	}
+
+	WaitForRegion(m_currentRegion);
+
+	return(m_pMappedData + (m_currentRegion * m_regionSize));
+}
+
+/***********************************************************
+ *  BindRange()
+ *
+ *  This method is used for binding a byte range of the current
+ *  region to an indexed binding point of the buffer target.
+ ***********************************************************/
+void StreamBuffer::BindRange(GLuint bindingIndex, size_t offset, size_t size)
+{
+	glBindBufferRange(
+		m_target,
+		bindingIndex,
+		m_bufferID,
+		(GLintptr)((m_currentRegion * m_regionSize) + offset),
+		(GLsizeiptr)size);
+}
+
+/***********************************************************
+ *  EndRegion()
+ *
+ *  This method is used for fencing the current region after
+ *  the draws that read it, and moving on to the next one.
+ ***********************************************************/
+void StreamBuffer::EndRegion()
+{
+	if (NULL == m_pMappedData)
+	{
+		return;
+	}
+
+	m_fences[m_currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_currentRegion = (m_currentRegion + 1) % m_regionCount;
+}
+
+/***********************************************************
+ *  GetBufferID()
+ *
+ *  This method is used for getting the OpenGL buffer name.
+ ***********************************************************/
+GLuint StreamBuffer::GetBufferID() const
+{
+	return(m_bufferID);
+}
+
+/***********************************************************
+ *  GetRegionSize()
+ *
+ *  This method is used for getting the size of one region
+ *  in bytes.
+ ***********************************************************/
+size_t StreamBuffer::GetRegionSize() const
+{
+	return(m_regionSize);
+}
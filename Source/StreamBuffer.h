@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.h
+// ============
+// persistently mapped buffer for data that is written every frame, split
+// into regions that are guarded by fences while the GPU reads them
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  StreamBuffer
+ *
+ *  This class owns a buffer created with glBufferStorage and
+ *  mapped once, persistently and coherently.  The buffer is
+ *  split into regions, one per frame in flight.  A frame
+ *  writes its data straight into the mapped memory of its
+ *  region, and a fence placed after its draws keeps the CPU
+ *  from overwriting the region until the GPU has read it.
+ ***********************************************************/
+class StreamBuffer
+{
+public:
+	// constructor
+	StreamBuffer();
+	// destructor
+	~StreamBuffer();
+
+	static const int MAX_REGIONS = 4;
+
+private:
+	GLenum m_target;
+	GLuint m_bufferID;
+	// start of the persistently mapped memory
+	unsigned char* m_pMappedData;
+	size_t m_regionSize;
+	int m_regionCount;
+	int m_currentRegion;
+	// fences placed after the draws that read each region
+	GLsync m_fences[MAX_REGIONS];
+
+	// create and map the buffer storage
+	bool CreateStorage(size_t regionSize);
+	// wait for the GPU to finish reading a region
+	void WaitForRegion(int region);
+
+public:
+	// create the buffer with room for regionSize bytes per frame
+	bool Initialize(GLenum target, size_t regionSize, int regionCount = 3);
+	// unmap and free the buffer
+	void Destroy();
+	// grow the regions to hold at least regionSize bytes
+	bool Reserve(size_t regionSize);
+
+	// wait for the next region to be free and get its mapped memory
+	void* BeginRegion();
+	// bind a byte range of the current region to an indexed binding
+	void BindRange(GLuint bindingIndex, size_t offset, size_t size);
+	// fence the current region once the draws reading it are issued
+	void EndRegion();
+
+	GLuint GetBufferID() const;
+	size_t GetRegionSize() const;
+};
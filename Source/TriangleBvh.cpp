@@ -0,0 +1,346 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.cpp
+// ============
+// bounding volume hierarchy over world space triangles, for tracing the
+// shadow rays of the lightmap baker
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TriangleBvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// triangles a node holds before it is split
+	const uint32_t g_MaxLeafTriangles = 4;
+	// bins the centroids are sorted into to price the splits
+	const int g_SplitBins = 16;
+	// cost of visiting a node against testing one triangle
+	const float g_NodeCost = 1.0f;
+	// depth below which the ranges are halved at their median, so
+	// the tree is never deeper than this plus the log of the count
+	const int g_MaxSplitDepth = 32;
+	// nodes a ray can have waiting to be visited, one per level
+	const int g_TraversalStackSize = 64;
+	// hits closer than this to the ray origin are ignored
+	const float g_MinHitDistance = 1.0e-5f;
+
+	// half the surface area of a box; a ray through a node passes
+	// through a child with a chance in proportion to it
+	float HalfArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+	{
+		glm::vec3 size = glm::max(boundsMax - boundsMin, glm::vec3(0.0f));
+		return((size.x * size.y) + (size.y * size.z) + (size.z * size.x));
+	}
+}
+
+/***********************************************************
+ *  TriangleBvh()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TriangleBvh::TriangleBvh()
+{
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the passed
+ *  in triangles, three indexes into the positions each.  The
+ *  triangles are copied in the order of the leaves, so the
+ *  triangles of a leaf are next to each other.
+ ***********************************************************/
+void TriangleBvh::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices)
+{
+	m_nodes.clear();
+	m_triangles.clear();
+
+	uint32_t triangleCount = (uint32_t)(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> order(triangleCount);
+	std::vector<glm::vec3> centroids(triangleCount);
+	std::vector<glm::vec3> boundsMin(triangleCount);
+	std::vector<glm::vec3> boundsMax(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		const glm::vec3& a = positions[indices[i * 3]];
+		const glm::vec3& b = positions[indices[i * 3 + 1]];
+		const glm::vec3& c = positions[indices[i * 3 + 2]];
+		order[i] = i;
+		boundsMin[i] = glm::min(a, glm::min(b, c));
+		boundsMax[i] = glm::max(a, glm::max(b, c));
+		centroids[i] = (a + b + c) / 3.0f;
+	}
+
+	m_nodes.reserve(2 * (triangleCount / g_MaxLeafTriangles + 1));
+	BuildNode(order, centroids, boundsMin, boundsMax, 0, triangleCount, 0);
+
+	m_triangles.resize(triangleCount);
+	for (uint32_t i = 0; i < triangleCount; i++)
+	{
+		uint32_t triangle = order[i];
+		const glm::vec3& a = positions[indices[triangle * 3]];
+		m_triangles[i].vertex0 = a;
+		m_triangles[i].edge1 = positions[indices[triangle * 3 + 1]] - a;
+		m_triangles[i].edge2 = positions[indices[triangle * 3 + 2]] - a;
+	}
+}
+
+/***********************************************************
+ *  BuildNode()
+ *
+ *  This method is used for adding the node of a range of the
+ *  ordered triangles, and the nodes below it.  The centroids
+ *  are sorted into bins along each axis, and the range is
+ *  split between the bins where the surface area heuristic
+ *  prices the two halves lowest.  A small range that no split
+ *  makes cheaper becomes a leaf.  Deep in the tree, and when
+ *  the centroids cannot be told apart, the range is halved
+ *  at its median instead, so a ray's stack of nodes to visit
+ *  stays within its bound.
+ ***********************************************************/
+void TriangleBvh::BuildNode(
+	std::vector<uint32_t>& order,
+	const std::vector<glm::vec3>& centroids,
+	const std::vector<glm::vec3>& boundsMin,
+	const std::vector<glm::vec3>& boundsMax,
+	uint32_t first,
+	uint32_t count,
+	int depth)
+{
+	size_t nodeIndex = m_nodes.size();
+	BVH_NODE node;
+	node.boundsMin = glm::vec3(1.0e30f);
+	node.boundsMax = glm::vec3(-1.0e30f);
+	glm::vec3 centroidMin = glm::vec3(1.0e30f);
+	glm::vec3 centroidMax = glm::vec3(-1.0e30f);
+	for (uint32_t i = first; i < first + count; i++)
+	{
+		node.boundsMin = glm::min(node.boundsMin, boundsMin[order[i]]);
+		node.boundsMax = glm::max(node.boundsMax, boundsMax[order[i]]);
+		centroidMin = glm::min(centroidMin, centroids[order[i]]);
+		centroidMax = glm::max(centroidMax, centroids[order[i]]);
+	}
+	node.offset = first;
+	node.triangleCount = count;
+
+	glm::vec3 extent = centroidMax - centroidMin;
+	float bestCost = 1.0e30f;
+	int bestAxis = -1;
+	int bestBin = 0;
+	for (int axis = 0; (axis < 3) && (depth < g_MaxSplitDepth); axis++)
+	{
+		if (extent[axis] <= 0.0f)
+		{
+			continue;
+		}
+
+		int binCounts[g_SplitBins] = {};
+		glm::vec3 binMin[g_SplitBins];
+		glm::vec3 binMax[g_SplitBins];
+		for (int b = 0; b < g_SplitBins; b++)
+		{
+			binMin[b] = glm::vec3(1.0e30f);
+			binMax[b] = glm::vec3(-1.0e30f);
+		}
+		float scale = g_SplitBins / extent[axis];
+		for (uint32_t i = first; i < first + count; i++)
+		{
+			uint32_t triangle = order[i];
+			int b = std::min(g_SplitBins - 1, (int)((centroids[triangle][axis] - centroidMin[axis]) * scale));
+			binCounts[b]++;
+			binMin[b] = glm::min(binMin[b], boundsMin[triangle]);
+			binMax[b] = glm::max(binMax[b], boundsMax[triangle]);
+		}
+
+		// sweep from the left, then price every split from the right
+		float leftArea[g_SplitBins];
+		int leftCount[g_SplitBins];
+		glm::vec3 sweepMin = glm::vec3(1.0e30f);
+		glm::vec3 sweepMax = glm::vec3(-1.0e30f);
+		int sweepCount = 0;
+		for (int b = 0; b < g_SplitBins - 1; b++)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCounts[b];
+			leftArea[b] = HalfArea(sweepMin, sweepMax);
+			leftCount[b] = sweepCount;
+		}
+		sweepMin = glm::vec3(1.0e30f);
+		sweepMax = glm::vec3(-1.0e30f);
+		sweepCount = 0;
+		for (int b = g_SplitBins - 1; b > 0; b--)
+		{
+			sweepMin = glm::min(sweepMin, binMin[b]);
+			sweepMax = glm::max(sweepMax, binMax[b]);
+			sweepCount += binCounts[b];
+			if ((sweepCount == 0) || (leftCount[b - 1] == 0))
+			{
+				continue;
+			}
+			float cost = (leftArea[b - 1] * leftCount[b - 1]) + (HalfArea(sweepMin, sweepMax) * sweepCount);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+
+	float nodeArea = HalfArea(node.boundsMin, node.boundsMax);
+	if ((count <= 1) ||
+		((count <= g_MaxLeafTriangles) && ((bestAxis < 0) || ((nodeArea * g_NodeCost) + bestCost >= nodeArea * count))))
+	{
+		m_nodes.push_back(node);
+		return;
+	}
+
+	node.offset = 0;
+	node.triangleCount = 0;
+	m_nodes.push_back(node);
+
+	uint32_t leftCount = count / 2;
+	if (bestAxis >= 0)
+	{
+		float scale = g_SplitBins / extent[bestAxis];
+		std::vector<uint32_t>::iterator middle = std::partition(
+			order.begin() + first,
+			order.begin() + first + count,
+			[&centroids, &centroidMin, bestAxis, bestBin, scale](uint32_t triangle)
+			{
+				int b = std::min(g_SplitBins - 1, (int)((centroids[triangle][bestAxis] - centroidMin[bestAxis]) * scale));
+				return(b < bestBin);
+			});
+		leftCount = (uint32_t)(middle - (order.begin() + first));
+	}
+	else
+	{
+		int axis = 0;
+		if (extent.y > extent.x)
+		{
+			axis = 1;
+		}
+		if (extent.z > extent[axis])
+		{
+			axis = 2;
+		}
+		std::nth_element(
+			order.begin() + first,
+			order.begin() + first + leftCount,
+			order.begin() + first + count,
+			[&centroids, axis](uint32_t left, uint32_t right)
+			{
+				return(centroids[left][axis] < centroids[right][axis]);
+			});
+	}
+
+	BuildNode(order, centroids, boundsMin, boundsMax, first, leftCount, depth + 1);
+	m_nodes[nodeIndex].offset = (uint32_t)m_nodes.size();
+	BuildNode(order, centroids, boundsMin, boundsMax, first + leftCount, count - leftCount, depth + 1);
+}
+
+/***********************************************************
+ *  IsOccluded()
+ *
+ *  This method is used for checking whether any triangle is
+ *  hit by the ray before the passed in distance.  The search
+ *  stops at the first hit, since a shadow ray only needs to
+ *  know that the light is blocked, not by what.
+ ***********************************************************/
+bool TriangleBvh::IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const
+{
+	if (m_nodes.empty() == true)
+	{
+		return(false);
+	}
+
+	glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+	uint32_t stack[g_TraversalStackSize];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--stackSize]];
+
+		// slab test of the node's box
+		glm::vec3 t0 = (node.boundsMin - origin) * inverseDirection;
+		glm::vec3 t1 = (node.boundsMax - origin) * inverseDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+		if (enter > exit)
+		{
+			continue;
+		}
+
+		if (node.triangleCount == 0)
+		{
+			stack[stackSize++] = (uint32_t)(&node - &m_nodes[0]) + 1;
+			stack[stackSize++] = node.offset;
+			continue;
+		}
+
+		for (uint32_t i = node.offset; i < node.offset + node.triangleCount; i++)
+		{
+			const BVH_TRIANGLE& triangle = m_triangles[i];
+			glm::vec3 p = glm::cross(direction, triangle.edge2);
+			float determinant = glm::dot(triangle.edge1, p);
+			if (std::fabs(determinant) < 1.0e-12f)
+			{
+				continue;
+			}
+
+			float inverseDeterminant = 1.0f / determinant;
+			glm::vec3 s = origin - triangle.vertex0;
+			float u = glm::dot(s, p) * inverseDeterminant;
+			if ((u < 0.0f) || (u > 1.0f))
+			{
+				continue;
+			}
+			glm::vec3 q = glm::cross(s, triangle.edge1);
+			float v = glm::dot(direction, q) * inverseDeterminant;
+			if ((v < 0.0f) || (u + v > 1.0f))
+			{
+				continue;
+			}
+
+			float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+			if ((t > g_MinHitDistance) && (t < maxDistance))
+			{
+				return(true);
+			}
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes.
+ ***********************************************************/
+size_t TriangleBvh::GetNodeCount() const
+{
+	return(m_nodes.size());
+}
+
+/***********************************************************
+ *  GetTriangleCount()
+ *
+ *  This method is used for getting the number of triangles.
+ ***********************************************************/
+size_t TriangleBvh::GetTriangleCount() const
+{
+	return(m_triangles.size());
+}
@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////
+// trianglebvh.h
+// ============
+// bounding volume hierarchy over world space triangles, for tracing the
+// shadow rays of the lightmap baker
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  TriangleBvh
+ *
+ *  This class sorts triangles into a binary tree of boxes, so
+ *  a ray only tests the triangles whose boxes it passes
+ *  through.  Each node splits its triangles where the surface
+ *  area heuristic expects rays to test the fewest of them.
+ *  The tree is only read once it is built, so rays can be
+ *  traced from many threads at once.
+ ***********************************************************/
+class TriangleBvh
+{
+public:
+	// constructor
+	TriangleBvh();
+
+private:
+	// an interior node's first child follows it, the second is at
+	// the node's offset; a leaf's triangles start at its offset
+	struct BVH_NODE
+	{
+		glm::vec3 boundsMin;
+		uint32_t offset;
+		glm::vec3 boundsMax;
+		// triangles of a leaf, zero for an interior node
+		uint32_t triangleCount;
+	};
+
+	// a triangle kept in the form the intersection test reads
+	struct BVH_TRIANGLE
+	{
+		glm::vec3 vertex0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+	};
+
+	std::vector<BVH_NODE> m_nodes;
+	std::vector<BVH_TRIANGLE> m_triangles;
+
+	// build the node of a range of the ordered triangles
+	void BuildNode(
+		std::vector<uint32_t>& order,
+		const std::vector<glm::vec3>& centroids,
+		const std::vector<glm::vec3>& boundsMin,
+		const std::vector<glm::vec3>& boundsMax,
+		uint32_t first,
+		uint32_t count,
+		int depth);
+
+public:
+	// build the tree over indexed triangles
+	void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+	// check whether a triangle lies on the ray before the distance
+	bool IsOccluded(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+	size_t GetNodeCount() const;
+	size_t GetTriangleCount() const;
+};
@@ -0,0 +1,90 @@
+///////////////////////////////////////////////////////////////////////////////
+// triplebuffer.h
+// ============
+// hand the latest value from one producer thread to one consumer thread
+// without either of them waiting on the other
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+
+/***********************************************************
+ *  TripleBuffer
+ *
+ *  This class holds three copies of a value.  The producer
+ *  fills the write copy and publishes it, which swaps it with
+ *  the middle copy.  The consumer acquires the middle copy by
+ *  swapping it with its read copy.  The swaps are a single
+ *  atomic exchange, so the producer can fill the next value
+ *  while the consumer still works on the previous one, and a
+ *  value that was never acquired is simply replaced by the
+ *  newer one.
+ ***********************************************************/
+template<typename T>
+class TripleBuffer
+{
+public:
+	// constructor
+	TripleBuffer()
+	{
+		m_writeIndex = 0;
+		m_middleState.store(1);
+		m_readIndex = 2;
+	}
+
+	// producer only - copy that is filled with the next value
+	T& GetWriteBuffer()
+	{
+		return(m_buffers[m_writeIndex]);
+	}
+
+	// producer only - make the write copy the latest value
+	void Publish()
+	{
+		int previous = m_middleState.exchange(
+			m_writeIndex | NEW_DATA_FLAG,
+			std::memory_order_acq_rel);
+		m_writeIndex = previous & INDEX_MASK;
+	}
+
+	// any thread - whether a value was published since the last acquire
+	bool HasNewData() const
+	{
+		return((m_middleState.load(std::memory_order_acquire) & NEW_DATA_FLAG) != 0);
+	}
+
+	// consumer only - take the latest value, returns false when
+	// nothing was published since the last acquire
+	bool Acquire()
+	{
+		if (HasNewData() == false)
+		{
+			return(false);
+		}
+
+		int previous = m_middleState.exchange(
+			m_readIndex,
+			std::memory_order_acq_rel);
+		m_readIndex = previous & INDEX_MASK;
+
+		return(true);
+	}
+
+	// consumer only - copy holding the last acquired value
+	T& GetReadBuffer()
+	{
+		return(m_buffers[m_readIndex]);
+	}
+
+private:
+	static const int INDEX_MASK = 3;
+	static const int NEW_DATA_FLAG = 4;
+
+	T m_buffers[3];
+	// index of the middle copy, with a flag set while it holds a
+	// value that the consumer has not acquired yet
+	std::atomic<int> m_middleState;
+	int m_writeIndex;
+	int m_readIndex;
+};
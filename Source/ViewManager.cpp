@@ -8,20 +8,54 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "ViewManager.h"
+#include "SceneView.h"
+#include "MemoryTracker.h"
 
 // GLM Math Header inclusions
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
 // declaration of the global variables and defines
 namespace
 {
 	// Variables for window width and height
 	const int WINDOW_WIDTH = 1000;
 	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
+	// uniform buffer binding of the shaders' camera block
+	const GLuint g_CameraBlockBinding = 0;
+	// a late latched view can turn after the frame was culled, so
+	// the frame is culled with a wider field of view, in degrees
+	const float g_LateLatchCullMargin = 10.0f;
+	// mouse events kept while waiting for the frame that shows them
+	const size_t g_MaxPendingEvents = 4096;
+
+	// a view of the shaders' camera block, in its std140 layout
+	struct CAMERA_VIEW_UNIFORMS
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;
+		// center and half size of the view's rectangle in normalized
+		// device coordinates
+		glm::vec4 viewRect;
+	};
+
+	// camera block of the shaders, in its std140 layout - only the
+	// views that are drawn are written
+	struct CAMERA_UNIFORMS
+	{
+		// the number of views, and 1 when the views are placed by
+		// remapping clip space instead of the viewport array
+		glm::ivec4 viewSettings;
+		CAMERA_VIEW_UNIFORMS views[SceneView::MAX_VIEWS];
+	};
 
 	// camera object used for viewing and interacting with
 	// the 3D scene
@@ -32,9 +66,29 @@ namespace
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
 
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
+	// the mouse events are counted and their movement summed, so the
+	// movement an update step or a latched view has not taken in yet
+	// is the difference to the sums it took in last.  The render
+	// thread reads them while the main thread polls the events.
+	std::mutex gInputMutex;
+	uint64_t gInputSerial = 0;
+	double gMouseTotalX = 0.0;
+	double gMouseTotalY = 0.0;
+	// the mouse input the update steps have applied to the camera
+	uint64_t gAppliedSerial = 0;
+	double gAppliedMouseX = 0.0;
+	double gAppliedMouseY = 0.0;
+	// arrival times of the mouse events that no swapped frame has
+	// shown yet, from the event after gPresentedSerial on, in a
+	// ring so a moving mouse does not allocate
+	std::chrono::steady_clock::time_point gEventTimes[g_MaxPendingEvents];
+	size_t gFirstEventTime = 0;
+	size_t gEventTimeCount = 0;
+	uint64_t gPresentedSerial = 0;
+
+	// camera position at the previous fixed update, used to
+	// interpolate the rendered view between update steps
+	glm::vec3 gPreviousCameraPosition = glm::vec3(0.0f);
 
 	// the following variable is false when orthographic projection
 	// is off and true when it is on
@@ -51,7 +105,28 @@ ViewManager::ViewManager(
 {
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
+	m_pInputRecorder = NULL;
+	m_pRenderCounters = NULL;
 	m_pWindow = NULL;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_viewPosition = glm::vec3(0.0f);
+	m_cameraLatch = SceneView::CAMERA_LATCH();
+	m_bLateLatch = false;
+	m_viewCount = 1;
+	m_cameraBufferID = 0;
+	m_bViewportArrays = false;
+	m_sceneViewport[0] = 0;
+	m_sceneViewport[1] = 0;
+	m_sceneViewport[2] = 0;
+	m_sceneViewport[3] = 0;
+	m_bSceneViewsActive = false;
+	m_shownInputSerial = 0;
+	m_latencyEventCount = 0;
+	m_totalLatencyMs = 0.0;
+	m_maxLatencyMs = 0.0;
+	m_bShowCounters = false;
+	m_bCounterKeyDown = false;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
@@ -59,6 +134,7 @@ ViewManager::ViewManager(
 	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
 	g_pCamera->Zoom = 80;
 	g_pCamera->MovementSpeed = 20;
+	gPreviousCameraPosition = g_pCamera->Position;
 }
 
 /***********************************************************
@@ -70,7 +146,15 @@ ViewManager::~ViewManager()
 {
 	// free up allocated memory
 	m_pShaderManager = NULL;
+	m_pInputRecorder = NULL;
+	m_pRenderCounters = NULL;
 	m_pWindow = NULL;
+	if (0 != m_cameraBufferID)
+	{
+		glDeleteBuffers(1, &m_cameraBufferID);
+		MemoryTracker::ReleaseBuffer(m_cameraBufferID);
+		m_cameraBufferID = 0;
+	}
 	if (NULL != g_pCamera)
 	{
 		delete g_pCamera;
@@ -121,6 +205,9 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
  *
  *  This method is automatically called from GLFW whenever
  *  the mouse is moved within the active GLFW display window.
+ *  The movement is applied by the next update step, so it
+ *  can be recorded and replayed with the step, and the time
+ *  the event arrived is kept for measuring its latency.
  ***********************************************************/
 void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
 {
@@ -142,18 +229,46 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	gLastX = xMousePos;
 	gLastY = yMousePos;
 
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
+	if ((xOffset == 0.0f) && (yOffset == 0.0f))
+	{
+		return;
+	}
+
+	// keep the offsets for the next update step
+	std::lock_guard<std::mutex> lock(gInputMutex);
+	gMouseTotalX += xOffset;
+	gMouseTotalY += yOffset;
+	gInputSerial++;
+	if (gEventTimeCount == g_MaxPendingEvents)
+	{
+		gFirstEventTime = (gFirstEventTime + 1) % g_MaxPendingEvents;
+		gEventTimeCount--;
+		gPresentedSerial++;
+	}
+	gEventTimes[(gFirstEventTime + gEventTimeCount) % g_MaxPendingEvents] = std::chrono::steady_clock::now();
+	gEventTimeCount++;
 }
 
 /***********************************************************
  *  ProcessKeyboardEvents()
  *
  *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
+ *  that may be waiting in the event queue.  The camera keys
+ *  that are held are returned in the passed in input, with
+ *  the mouse movement since the last step.
  ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
+void ViewManager::ProcessKeyboardEvents(InputRecorder::INPUT_STATE& input)
 {
+	input.keys = 0;
+	{
+		std::lock_guard<std::mutex> lock(gInputMutex);
+		input.mouseOffset = glm::vec2(
+			(float)(gMouseTotalX - gAppliedMouseX),
+			(float)(gMouseTotalY - gAppliedMouseY));
+		gAppliedSerial = gInputSerial;
+		gAppliedMouseX = gMouseTotalX;
+		gAppliedMouseY = gMouseTotalY;
+	}
 
 	// close the window if the escape key has been pressed
 	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -164,43 +279,135 @@ void ViewManager::ProcessKeyboardEvents()
 	// process camera zooming in and out
 	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_FORWARD;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_BACKWARD;
 	}
 
 	// process camera panning left and right
 	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_LEFT;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_RIGHT;
 	}
 	// process camera panning up and down
 	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_UP;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
 	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
+		input.keys |= InputRecorder::INPUT_KEY_DOWN;
 	}
 	// switch Camera to PERSPECTIVE 
 	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
 	{
-		m_currentProjectionMode = PERSPECTIVE; 
-
+		input.keys |= InputRecorder::INPUT_KEY_PERSPECTIVE;
 	}
 	// switch Camera to ORTHOGRAPHIC
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
+	{
+		input.keys |= InputRecorder::INPUT_KEY_ORTHOGRAPHIC;
+	}
+
+	// show or hide the counter overlay once per press, it does not
+	// change the camera so it is not part of the input
+	bool bCounterKeyDown = (glfwGetKey(m_pWindow, GLFW_KEY_F1) == GLFW_PRESS);
+	if ((bCounterKeyDown == true) && (m_bCounterKeyDown == false))
+	{
+		m_bShowCounters = !m_bShowCounters;
+	}
+	m_bCounterKeyDown = bCounterKeyDown;
+}
+
+/***********************************************************
+ *  ApplyInput()
+ *
+ *  This method is used for moving the camera by the input of
+ *  one update step, whether it was read from the keyboard and
+ *  mouse or replayed from a log.
+ ***********************************************************/
+void ViewManager::ApplyInput(const InputRecorder::INPUT_STATE& input, float deltaTime)
+{
+	if ((input.mouseOffset.x != 0.0f) || (input.mouseOffset.y != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(input.mouseOffset.x, input.mouseOffset.y);
+	}
+
+	if (input.keys & InputRecorder::INPUT_KEY_FORWARD)
+	{
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_BACKWARD)
+	{
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_LEFT)
+	{
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_RIGHT)
+	{
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_UP)
+	{
+		g_pCamera->ProcessKeyboard(UP, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_DOWN)
+	{
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime);
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_PERSPECTIVE)
+	{
+		m_currentProjectionMode = PERSPECTIVE;
+	}
+	if (input.keys & InputRecorder::INPUT_KEY_ORTHOGRAPHIC)
 	{
 		m_currentProjectionMode = ORTHOGRAPHIC;
+	}
+}
+
+/***********************************************************
+ *  UpdateCamera()
+ *
+ *  This method is called once per fixed update step to move
+ *  the camera by the passed in step length.  A replay takes
+ *  the input of the step from the log instead of the keyboard
+ *  and mouse, and closes the window after its last step.
+ ***********************************************************/
+void ViewManager::UpdateCamera(float deltaTime)
+{
+	// Process keyboard events (optional)
+	InputRecorder::INPUT_STATE input;
+	ProcessKeyboardEvents(input);
 
+	if ((NULL != m_pInputRecorder) && (m_pInputRecorder->IsReplaying()))
+	{
+		InputRecorder::CAMERA_STATE camera = GetCameraState();
+		bool bReplayed = m_pInputRecorder->ReplayStep(camera, input);
+		SetCameraState(camera);
+		if (bReplayed == false)
+		{
+			gPreviousCameraPosition = g_pCamera->Position;
+			glfwSetWindowShouldClose(m_pWindow, true);
+			return;
+		}
+	}
+	else if (NULL != m_pInputRecorder)
+	{
+		m_pInputRecorder->RecordStep(GetCameraState(), input);
 	}
+
+	// remember where this step started for view interpolation
+	gPreviousCameraPosition = g_pCamera->Position;
+
+	ApplyInput(input, deltaTime);
 }
 
 /***********************************************************
@@ -208,63 +415,431 @@ void ViewManager::ProcessKeyboardEvents()
  *
  *  This method is used for preparing the 3D scene by loading
  *  the shapes, textures in memory to support the 3D scene 
- *  rendering
+ *  rendering.  The interpolation factor blends the camera
+ *  position between the last two fixed update steps.
  ***********************************************************/
-void ViewManager::PrepareSceneView()
+void ViewManager::PrepareSceneView(float interpolation)
 {
-	glm::mat4 view;
-	glm::mat4 projection;
+	UpdateSceneView(interpolation);
+	UploadSceneView(m_viewMatrix, m_projectionMatrix, m_viewPosition);
+}
+
+/***********************************************************
+ *  UpdateSceneView()
+ *
+ *  This method is used for calculating the view and projection
+ *  of the current frame without passing them into the shader,
+ *  so it can run on a thread that does not own the OpenGL
+ *  context.  The results are read with the getters below.
+ *  With late latching the frame is culled with a wider field
+ *  of view, since its view can still turn before it is drawn.
+ *  With several views the first one is the perspective camera,
+ *  whatever the projection mode.
+ ***********************************************************/
+void ViewManager::UpdateSceneView(float interpolation)
+{
+	SceneView::CAMERA_VIEW camera;
+	camera.previousPosition = gPreviousCameraPosition;
+	camera.position = g_pCamera->Position;
+	camera.front = g_pCamera->Front;
+	camera.up = g_pCamera->Up;
+	camera.zoom = g_pCamera->Zoom;
+	camera.bOrthographic = (m_currentProjectionMode == ORTHOGRAPHIC);
+	camera.aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+
+	m_cameraLatch.camera = camera;
+	m_cameraLatch.interpolation = interpolation;
+	m_cameraLatch.yaw = g_pCamera->Yaw;
+	m_cameraLatch.pitch = g_pCamera->Pitch;
+	m_cameraLatch.mouseSensitivity = g_pCamera->MouseSensitivity;
+	{
+		std::lock_guard<std::mutex> lock(gInputMutex);
+		m_cameraLatch.inputSerial = gAppliedSerial;
+		m_cameraLatch.mouseX = gAppliedMouseX;
+		m_cameraLatch.mouseY = gAppliedMouseY;
+	}
+	// a replay takes its camera from the log, not the mouse
+	m_cameraLatch.bLateLatch = (m_bLateLatch == true) &&
+		((NULL == m_pInputRecorder) || (m_pInputRecorder->IsReplaying() == false));
 
-	// Per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
+	if (m_cameraLatch.bLateLatch == true)
+	{
+		camera.zoom += g_LateLatchCullMargin;
+	}
 
-	// Process keyboard events (optional)
-	ProcessKeyboardEvents();
+	// keep the view state for the culling of the scene objects
+	if (m_viewCount > 1)
+	{
+		SceneView::ComputeViews(camera, interpolation, m_viewCount, m_frameViews);
+		m_viewMatrix = m_frameViews[0].view;
+		m_projectionMatrix = m_frameViews[0].projection;
+		m_viewPosition = m_frameViews[0].viewPosition;
+		return;
+	}
+
+	SceneView::Compute(camera, interpolation, m_viewMatrix, m_projectionMatrix, m_viewPosition);
+}
+
+/***********************************************************
+ *  UploadSceneView()
+ *
+ *  This method is used for passing the view and projection
+ *  into the shaders.  They are written into the uniform
+ *  buffer of the camera block, which every shader program
+ *  reads, so the camera is written once right before the
+ *  draws.  It must be called on the thread that owns the
+ *  OpenGL context.
+ ***********************************************************/
+void ViewManager::UploadSceneView(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& cameraPosition)
+{
+	SceneView::FRAME_VIEW frameView;
+	frameView.view = view;
+	frameView.projection = projection;
+	frameView.viewPosition = cameraPosition;
+	frameView.rectCenter = glm::vec2(0.0f);
+	frameView.rectScale = glm::vec2(1.0f);
+
+	UploadSceneViews(&frameView, 1);
+}
+
+/***********************************************************
+ *  UploadSceneViews()
+ *
+ *  This method is used for passing the views of a frame into
+ *  the shaders.  Every draw of the frame is instanced once
+ *  per view and the vertex shader takes the view of its
+ *  instance, so the scene is submitted once for all of them.
+ *  The vertex shader sends each instance to the viewport of
+ *  its view when the driver lets it pick the viewport, and
+ *  otherwise squeezes clip space into the view's rectangle
+ *  and clips the triangles to it with clip distances.  It
+ *  must be called on the thread that owns the OpenGL context.
+ ***********************************************************/
+void ViewManager::UploadSceneViews(const SceneView::FRAME_VIEW* pViews, int viewCount)
+{
+	// if the shader manager object is valid
+	if (NULL == m_pShaderManager)
+	{
+		return;
+	}
 
-	if (m_currentProjectionMode == PERSPECTIVE)
+	if (0 == m_cameraBufferID)
 	{
-		// Perspective projection (unchanged)
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom),
-			(float)WINDOW_WIDTH / (float)WINDOW_HEIGHT,
-			0.1f, 100.0f);
+		glGenBuffers(1, &m_cameraBufferID);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_cameraBufferID);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(CAMERA_UNIFORMS), NULL, GL_DYNAMIC_DRAW);
+		MemoryTracker::TrackBuffer(m_cameraBufferID, MemoryTracker::MEMORY_GPU_BUFFERS,
+			"camera uniforms", sizeof(CAMERA_UNIFORMS));
+		glBindBufferBase(GL_UNIFORM_BUFFER, g_CameraBlockBinding, m_cameraBufferID);
+
+		m_bViewportArrays = (GLEW_ARB_shader_viewport_layer_array == GL_TRUE);
+		if (m_viewCount > 1)
+		{
+			std::cout << "INFO: Drawing " << m_viewCount << " views in one pass, placed "
+				<< ((m_bViewportArrays == true) ? "with the viewport array" : "by remapping clip space")
+				<< std::endl;
+		}
+	}
+
+	viewCount = std::max(1, std::min(viewCount, (int)SceneView::MAX_VIEWS));
+
+	CAMERA_UNIFORMS uniforms;
+	uniforms.viewSettings = glm::ivec4(viewCount, (m_bViewportArrays == true) ? 0 : 1, 0, 0);
+	for (int i = 0; i < viewCount; i++)
+	{
+		uniforms.views[i].view = pViews[i].view;
+		uniforms.views[i].projection = pViews[i].projection;
+		uniforms.views[i].viewPosition = glm::vec4(pViews[i].viewPosition, 1.0f);
+		uniforms.views[i].viewRect = glm::vec4(
+			pViews[i].rectCenter.x, pViews[i].rectCenter.y,
+			pViews[i].rectScale.x, pViews[i].rectScale.y);
+	}
+	GLsizeiptr uploadSize = sizeof(uniforms.viewSettings) + viewCount * sizeof(CAMERA_VIEW_UNIFORMS);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_cameraBufferID);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, uploadSize, &uniforms);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-		// Use dynamic camera view for perspective mode
-		view = g_pCamera->GetViewMatrix();
+	if (NULL != m_pRenderCounters)
+	{
+		m_pRenderCounters->Add(RenderCounters::COUNTER_UNIFORM_UPLOADS);
+		m_pRenderCounters->Add(RenderCounters::COUNTER_BUFFER_BYTES, uploadSize);
 	}
-	else if (m_currentProjectionMode == ORTHOGRAPHIC)
+
+	if (viewCount <= 1)
 	{
-		// **Lock the camera to a fixed position and look at the center of the scene**
-		glm::vec3 cameraPosition = glm::vec3(0.0f, 4.0f, 15.0f); 
-		glm::vec3 targetPosition = glm::vec3(0.0f, 4.0f, 0.0f);    // Look directly at the origin (or center of the objects)
-		glm::vec3 upVector = glm::vec3(0.0f, 2.0f, 0.0f);          // Y-axis up direction
+		return;
+	}
 
-		view = glm::lookAt(cameraPosition, targetPosition, upVector);
+	// lay the views out over the viewport the scene is drawn into,
+	// which may be smaller than the window with dynamic resolution
+	EndSceneView();
+	glGetIntegerv(GL_VIEWPORT, m_sceneViewport);
+	if (m_bViewportArrays == true)
+	{
+		for (int i = 0; i < viewCount; i++)
+		{
+			glm::vec2 rectMin = (pViews[i].rectCenter - pViews[i].rectScale + glm::vec2(1.0f)) * 0.5f;
+			glViewportIndexedf(
+				(GLuint)i,
+				(float)m_sceneViewport[0] + rectMin.x * (float)m_sceneViewport[2],
+				(float)m_sceneViewport[1] + rectMin.y * (float)m_sceneViewport[3],
+				pViews[i].rectScale.x * (float)m_sceneViewport[2],
+				pViews[i].rectScale.y * (float)m_sceneViewport[3]);
+		}
+	}
+	else
+	{
+		// the four edges of the view's rectangle
+		for (int i = 0; i < 4; i++)
+		{
+			glEnable(GL_CLIP_DISTANCE0 + i);
+		}
+	}
+	m_bSceneViewsActive = true;
+}
 
-		// **Orthographic projection**
-		float orthoScale = 10.0f; // You can adjust this to frame your scene
-		float aspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
-		float left = -orthoScale * aspectRatio;
-		float right = orthoScale * aspectRatio;
-		float bottom = -3.5f; // Center the objects vertically in the viewport
-		float top = orthoScale + 1.0f;
-		float nearPlane = -10.0f;   // Allows depth visibility in the negative Z-axis
-		float farPlane =20.0f;     // Depth visibility in the positive Z-axis
+/***********************************************************
+ *  EndSceneView()
+ *
+ *  This method is used for undoing the layout of the views
+ *  of a frame once its scene is drawn, so the passes that
+ *  follow draw over the whole viewport again.
+ ***********************************************************/
+void ViewManager::EndSceneView()
+{
+	if (m_bSceneViewsActive == false)
+	{
+		return;
+	}
 
-		projection = glm::ortho(left, right, bottom, top, nearPlane, farPlane);
+	if (m_bViewportArrays == true)
+	{
+		// setting the viewport sets every viewport of the array
+		glViewport(m_sceneViewport[0], m_sceneViewport[1], m_sceneViewport[2], m_sceneViewport[3]);
 	}
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
+	else
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			glDisable(GL_CLIP_DISTANCE0 + i);
+		}
+	}
+	m_bSceneViewsActive = false;
+}
+
+/***********************************************************
+ *  LatchSceneView()
+ *
+ *  This method is used for passing the view of a snapshot
+ *  into the shaders, right before its draws are submitted.
+ *  With late latching the camera of the snapshot is turned
+ *  by the mouse movement that arrived after the snapshot was
+ *  recorded, without applying it to the camera, so the next
+ *  update step still takes it in, and records it, as usual.
+ *  The views of a multi-view frame are all built again from
+ *  the turned camera.  It must be called on the thread that
+ *  owns the OpenGL context.
+ ***********************************************************/
+void ViewManager::LatchSceneView(const FRAME_SNAPSHOT& snapshot)
+{
+	const SceneView::CAMERA_LATCH& latch = snapshot.cameraLatch;
+	if (latch.bLateLatch == false)
+	{
+		if (snapshot.viewCount > 1)
+		{
+			UploadSceneViews(snapshot.views, snapshot.viewCount);
+		}
+		else
+		{
+			UploadSceneView(snapshot.view, snapshot.projection, snapshot.viewPosition);
+		}
+		m_shownInputSerial = std::max(m_shownInputSerial, latch.inputSerial);
+		return;
+	}
+
+	uint64_t inputSerial = 0;
+	glm::vec2 mouseOffset;
+	{
+		std::lock_guard<std::mutex> lock(gInputMutex);
+		inputSerial = gInputSerial;
+		mouseOffset = glm::vec2(
+			(float)(gMouseTotalX - latch.mouseX),
+			(float)(gMouseTotalY - latch.mouseY));
+	}
+
+	SceneView::CAMERA_VIEW camera = latch.camera;
+	if ((mouseOffset.x != 0.0f) || (mouseOffset.y != 0.0f))
+	{
+		SceneView::Turn(camera, latch.yaw, latch.pitch, mouseOffset * latch.mouseSensitivity);
+	}
+
+	if (snapshot.viewCount > 1)
+	{
+		SceneView::FRAME_VIEW frameViews[SceneView::MAX_VIEWS];
+		SceneView::ComputeViews(camera, latch.interpolation, snapshot.viewCount, frameViews);
+		UploadSceneViews(frameViews, snapshot.viewCount);
+		m_shownInputSerial = std::max(m_shownInputSerial, inputSerial);
+		return;
+	}
+
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 viewPosition;
+	SceneView::Compute(camera, latch.interpolation, view, projection, viewPosition);
+	UploadSceneView(view, projection, viewPosition);
+	m_shownInputSerial = std::max(m_shownInputSerial, inputSerial);
+}
+
+/***********************************************************
+ *  PresentSceneView()
+ *
+ *  This method is used for measuring the latency of the
+ *  mouse events the last latched view has taken in, once
+ *  its frame has been swapped.  An event is timed from when
+ *  the window events delivered it to the swap of the first
+ *  frame that shows it.  It must be called right after the
+ *  swap, on the thread that swapped.
+ ***********************************************************/
+void ViewManager::PresentSceneView()
+{
+	std::chrono::steady_clock::time_point swapTime = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(gInputMutex);
+	while ((gPresentedSerial < m_shownInputSerial) && (gEventTimeCount > 0))
+	{
+		double latencyMs = std::chrono::duration<double, std::milli>(
+			swapTime - gEventTimes[gFirstEventTime]).count();
+		gFirstEventTime = (gFirstEventTime + 1) % g_MaxPendingEvents;
+		gEventTimeCount--;
+		gPresentedSerial++;
+
+		m_latencyEventCount++;
+		m_totalLatencyMs += latencyMs;
+		m_maxLatencyMs = std::max(m_maxLatencyMs, latencyMs);
+	}
+}
+
+/***********************************************************
+ *  PrintLatencyStats()
+ *
+ *  This method is used for printing the input latency of the
+ *  mouse events shown since the last report, and restarting
+ *  the report.  Nothing is printed without mouse input.
+ ***********************************************************/
+void ViewManager::PrintLatencyStats()
+{
+	std::lock_guard<std::mutex> lock(gInputMutex);
+	if (m_latencyEventCount == 0)
 	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
+		return;
 	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "LATENCY: input to swap avg " << (m_totalLatencyMs / (double)m_latencyEventCount) << " ms"
+		<< ", max " << m_maxLatencyMs
+		<< ", events " << m_latencyEventCount
+		<< ", late latch " << (m_bLateLatch ? "on" : "off")
+		<< std::defaultfloat << std::endl;
+
+	m_latencyEventCount = 0;
+	m_totalLatencyMs = 0.0;
+	m_maxLatencyMs = 0.0;
+}
+/***********************************************************
+ *  GetViewMatrix()
+ *
+ *  This method is used for getting the view matrix set by
+ *  the last call to PrepareSceneView().
+ ***********************************************************/
+glm::mat4 ViewManager::GetViewMatrix() const
+{
+	return(m_viewMatrix);
+}
+
+/***********************************************************
+ *  GetProjectionMatrix()
+ *
+ *  This method is used for getting the projection matrix set
+ *  by the last call to PrepareSceneView().
+ ***********************************************************/
+glm::mat4 ViewManager::GetProjectionMatrix() const
+{
+	return(m_projectionMatrix);
+}
+
+/***********************************************************
+ *  GetViewPosition()
+ *
+ *  This method is used for getting the camera position set
+ *  by the last call to PrepareSceneView().
+ ***********************************************************/
+glm::vec3 ViewManager::GetViewPosition() const
+{
+	return(m_viewPosition);
+}
+
+/***********************************************************
+ *  GetCameraLatch()
+ *
+ *  This method is used for getting the camera set by the last
+ *  call to UpdateSceneView(), for latching it again before
+ *  the frame is drawn.
+ ***********************************************************/
+SceneView::CAMERA_LATCH ViewManager::GetCameraLatch() const
+{
+	return(m_cameraLatch);
+}
+
+/***********************************************************
+ *  GetViewCount()
+ *
+ *  This method is used for getting the number of views of
+ *  the last prepared scene view.
+ ***********************************************************/
+int ViewManager::GetViewCount() const
+{
+	return(m_viewCount);
+}
+
+/***********************************************************
+ *  GetFrameView()
+ *
+ *  This method is used for getting one of the views of the
+ *  last prepared scene view, when it has more than one.
+ ***********************************************************/
+const SceneView::FRAME_VIEW& ViewManager::GetFrameView(int index) const
+{
+	return(m_frameViews[index]);
+}
+
+/***********************************************************
+ *  SetViewCount()
+ *
+ *  This method is used for setting how many views the scene
+ *  is drawn from, side by side in one pass - the perspective
+ *  camera, the orthographic camera and two top-down views.
+ ***********************************************************/
+void ViewManager::SetViewCount(int viewCount)
+{
+	m_viewCount = std::max(1, std::min(viewCount, (int)SceneView::MAX_VIEWS));
+}
+
+/***********************************************************
+ *  SetLateLatch()
+ *
+ *  This method is used for setting whether the view of every
+ *  frame is turned by the newest mouse input right before the
+ *  frame is drawn.
+ ***********************************************************/
+void ViewManager::SetLateLatch(bool bLateLatch)
+{
+	m_bLateLatch = bLateLatch;
 }
+
 // Projection mode setter 
 void ViewManager::SetProjectionMode(ProjectionMode mode)
 {
@@ -273,3 +848,76 @@ void ViewManager::SetProjectionMode(ProjectionMode mode)
 
 
 }
+
+/***********************************************************
+ *  SetInputRecorder()
+ *
+ *  This method is used for setting the recorder that the
+ *  camera input of every update step is recorded into or
+ *  replayed from.
+ ***********************************************************/
+void ViewManager::SetInputRecorder(InputRecorder* pInputRecorder)
+{
+	m_pInputRecorder = pInputRecorder;
+}
+
+/***********************************************************
+ *  SetRenderCounters()
+ *
+ *  This method is used for setting the counters that the
+ *  camera uploads of the drawn frames are counted in.
+ ***********************************************************/
+void ViewManager::SetRenderCounters(RenderCounters* pRenderCounters)
+{
+	m_pRenderCounters = pRenderCounters;
+}
+
+/***********************************************************
+ *  GetShowCounters()
+ *
+ *  This method is used for getting whether the counter
+ *  overlay has been switched on with its key.
+ ***********************************************************/
+bool ViewManager::GetShowCounters() const
+{
+	return(m_bShowCounters);
+}
+
+/***********************************************************
+ *  GetCameraState()
+ *
+ *  This method is used for getting the state of the camera
+ *  and the projection mode.
+ ***********************************************************/
+InputRecorder::CAMERA_STATE ViewManager::GetCameraState() const
+{
+	InputRecorder::CAMERA_STATE camera;
+	camera.position = g_pCamera->Position;
+	camera.front = g_pCamera->Front;
+	camera.up = g_pCamera->Up;
+	camera.right = g_pCamera->Right;
+	camera.yaw = g_pCamera->Yaw;
+	camera.pitch = g_pCamera->Pitch;
+	camera.zoom = g_pCamera->Zoom;
+	camera.projectionMode = (int)m_currentProjectionMode;
+
+	return(camera);
+}
+
+/***********************************************************
+ *  SetCameraState()
+ *
+ *  This method is used for setting the state of the camera
+ *  and the projection mode.
+ ***********************************************************/
+void ViewManager::SetCameraState(const InputRecorder::CAMERA_STATE& camera)
+{
+	g_pCamera->Position = camera.position;
+	g_pCamera->Front = camera.front;
+	g_pCamera->Up = camera.up;
+	g_pCamera->Right = camera.right;
+	g_pCamera->Yaw = camera.yaw;
+	g_pCamera->Pitch = camera.pitch;
+	g_pCamera->Zoom = camera.zoom;
+	m_currentProjectionMode = (ProjectionMode)camera.projectionMode;
+}
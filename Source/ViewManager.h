@@ -10,8 +10,14 @@
 #pragma once
 
 #include "ShaderManager.h"
+#include "InputRecorder.h"
+#include "FrameSnapshot.h"
+#include "SceneView.h"
+#include "RenderCounters.h"
 #include "camera.h"
 
+#include <cstdint>
+
 // GLFW library
 #include "GLFW/glfw3.h" 
 
@@ -37,18 +43,112 @@ private:
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// pointer to the recorder of the camera input, NULL when the
+	// input is neither recorded nor replayed
+	InputRecorder* m_pInputRecorder;
+	// pointer to the counters of the drawn frames, NULL when the
+	// uploads are not counted
+	RenderCounters* m_pRenderCounters;
 
 	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
+	void ProcessKeyboardEvents(InputRecorder::INPUT_STATE& input);
+	// move the camera by the input of one update step
+	void ApplyInput(const InputRecorder::INPUT_STATE& input, float deltaTime);
 
 	ProjectionMode m_currentProjectionMode = PERSPECTIVE;
 
+	// view state from the last prepared scene view
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	glm::vec3 m_viewPosition;
+	// camera of the last prepared scene view, for latching it again
+	SceneView::CAMERA_LATCH m_cameraLatch;
+	// turn the drawn view by the mouse input that arrives after
+	// the frame was recorded
+	bool m_bLateLatch;
+
+	// views drawn side by side in one pass, and the views of the
+	// last prepared scene view when there is more than one
+	int m_viewCount;
+	SceneView::FRAME_VIEW m_frameViews[SceneView::MAX_VIEWS];
+
+	// uniform buffer the camera of the drawn frame is written into
+	GLuint m_cameraBufferID;
+	// the views are placed with the viewport array when the vertex
+	// shader can pick the viewport, otherwise by remapping clip space
+	bool m_bViewportArrays;
+	// viewport the views of the drawn frame were laid out in, and
+	// whether their state has to be undone after the scene
+	GLint m_sceneViewport[4];
+	bool m_bSceneViewsActive;
+	// last mouse event the drawn frame has taken in
+	uint64_t m_shownInputSerial;
+
+	// time from a mouse event to the swap of the first frame that
+	// shows it, since the last report
+	uint64_t m_latencyEventCount;
+	double m_totalLatencyMs;
+	double m_maxLatencyMs;
+
+	// show the counter overlay, toggled by a key press
+	bool m_bShowCounters;
+	bool m_bCounterKeyDown;
+
 public:
 	// create the initial OpenGL display window
 	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
 	
+	// advance the camera by one fixed update step
+	void UpdateCamera(float deltaTime);
+
 	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
+	void PrepareSceneView(float interpolation = 1.0f);
+	// calculate the view of the current frame without touching the shader
+	void UpdateSceneView(float interpolation = 1.0f);
+	// pass a calculated view into the shader on the GL thread
+	void UploadSceneView(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& cameraPosition);
+	// pass several views drawn in one pass into the shader, and lay
+	// them out over the current viewport
+	void UploadSceneViews(const SceneView::FRAME_VIEW* pViews, int viewCount);
+	// undo the viewport layout of the views once the scene is drawn
+	void EndSceneView();
+
+	// view state from the last prepared scene view
+	glm::mat4 GetViewMatrix() const;
+	glm::mat4 GetProjectionMatrix() const;
+	glm::vec3 GetViewPosition() const;
+	SceneView::CAMERA_LATCH GetCameraLatch() const;
+	// views of the last prepared scene view, the first one matching
+	// the view state above
+	int GetViewCount() const;
+	const SceneView::FRAME_VIEW& GetFrameView(int index) const;
+
+	// draw the scene from several cameras side by side, 1 for the
+	// camera alone
+	void SetViewCount(int viewCount);
+
+	// turn the view of every frame by the newest mouse input just
+	// before it is drawn
+	void SetLateLatch(bool bLateLatch);
+	// pass the view of a snapshot into the shader on the GL thread,
+	// latched again from the newest mouse input when enabled
+	void LatchSceneView(const FRAME_SNAPSHOT& snapshot);
+	// measure the latency of the input shown by a swapped frame
+	void PresentSceneView();
+	void PrintLatencyStats();
 
 	void SetProjectionMode(ProjectionMode mode);
+
+	// record the camera input into, or replay it from, a recorder
+	void SetInputRecorder(InputRecorder* pInputRecorder);
+	// count the uploads of the drawn frames into the counters
+	void SetRenderCounters(RenderCounters* pRenderCounters);
+	// whether the counter overlay is shown
+	bool GetShowCounters() const;
+	// state of the camera, as the input recorder logs it
+	InputRecorder::CAMERA_STATE GetCameraState() const;
+	void SetCameraState(const InputRecorder::CAMERA_STATE& camera);
 };
\ No newline at end of file
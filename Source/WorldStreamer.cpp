@@ -0,0 +1,1479 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.cpp
+// ============
+// divide a large world into grid cells and stream the cells around the camera
+// in and out - an I/O thread, a decode pool and a GPU upload budget per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#include "WorldStreamer.h"
+#include "SceneManager.h"
+#include "MemoryTracker.h"
+
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// declaration of global variables
+namespace
+{
+	// settings used when the world file does not give them
+	const float g_DefaultCellSize = 64.0f;
+	const int g_DefaultMaxCells = 16;
+	const int g_DefaultTexturesPerCell = 8;
+	const int g_DefaultTextureSize = 512;
+	const size_t g_DefaultUploadBudget = 4 * 1024 * 1024;
+	const int g_DefaultDecodeThreads = 2;
+
+	// cells that are read and decoded at the same time, so the
+	// nearest cells are not queued behind ones further away
+	const int g_MaxLoadsInFlight = 4;
+	// fraction of a cell the camera moves before the nearest
+	// point lights are picked again
+	const float g_LightUpdateFraction = 0.25f;
+
+	double ElapsedMs(
+		std::chrono::steady_clock::time_point start,
+		std::chrono::steady_clock::time_point end)
+	{
+		return(std::chrono::duration<double, std::milli>(end - start).count());
+	}
+
+	// average 2x2 texels of each level into the next, the levels
+	// follow each other in memory
+	void BuildMipChain(unsigned char* pLayer, int size)
+	{
+		unsigned char* pSource = pLayer;
+		while (size > 1)
+		{
+			int half = size / 2;
+			unsigned char* pTarget = pSource + ((size_t)size * size * 4);
+			for (int y = 0; y < half; y++)
+			{
+				const unsigned char* pRow0 = pSource + ((size_t)(y * 2) * size * 4);
+				const unsigned char* pRow1 = pRow0 + ((size_t)size * 4);
+				unsigned char* pOut = pTarget + ((size_t)y * half * 4);
+				for (int x = 0; x < half; x++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						int sum = pRow0[(x * 8) + c] + pRow0[(x * 8) + 4 + c] +
+							pRow1[(x * 8) + c] + pRow1[(x * 8) + 4 + c];
+						pOut[(x * 4) + c] = (unsigned char)((sum + 2) / 4);
+					}
+				}
+			}
+			pSource = pTarget;
+			size = half;
+		}
+	}
+}
+
+/***********************************************************
+ *  WorldStreamer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WorldStreamer::WorldStreamer()
+{
+	m_settings.cellSize = g_DefaultCellSize;
+	m_settings.loadRadius = g_DefaultCellSize * 1.5f;
+	m_settings.unloadRadius = g_DefaultCellSize * 2.0f;
+	m_settings.maxCells = g_DefaultMaxCells;
+	m_settings.texturesPerCell = g_DefaultTexturesPerCell;
+	m_settings.textureSize = g_DefaultTextureSize;
+	m_settings.uploadBudget = g_DefaultUploadBudget;
+	m_settings.decodeThreads = g_DefaultDecodeThreads;
+
+	m_textureArrayID = 0;
+	m_levelCount = 1;
+	m_layerBytes = 0;
+	m_baseLayerCount = 0;
+	m_firstCellSlot = 0;
+	m_pShapeSource = NULL;
+	m_bRunning = false;
+	m_residencyVersion = 1;
+	m_lightsVersion = 0;
+	m_lightsPosition = glm::vec3(0.0f);
+	m_stagingBytes = 0;
+	m_geometryBytes = 0;
+	m_totalLoadMs = 0.0;
+	memset(&m_stats, 0, sizeof(m_stats));
+}
+
+/***********************************************************
+ *  ~WorldStreamer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WorldStreamer::~WorldStreamer()
+{
+	Stop();
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		ReleaseSlot(*m_slots[i]);
+		delete m_slots[i];
+	}
+	m_slots.clear();
+
+	if (0 != m_textureArrayID)
+	{
+		glDeleteTextures(1, &m_textureArrayID);
+		MemoryTracker::ReleaseTexture(m_textureArrayID);
+		m_textureArrayID = 0;
+	}
+	MemoryTracker::ReleaseHeap(this);
+	m_pShapeSource = NULL;
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for reading a world file.  Every line
+ *  holds a keyword and its values, and # starts a comment:
+ *
+ *    cell_size SIZE           size of a grid cell
+ *    load_radius RADIUS       load the cells closer than this
+ *    unload_radius RADIUS     unload the cells further than this
+ *    max_cells COUNT          cells loaded at once
+ *    cell_textures COUNT      texture layers of every cell
+ *    texture_size SIZE        width and height of the layers
+ *    upload_kb SIZE           GPU uploads per frame
+ *    decode_threads COUNT     threads decoding the cells
+ *    base FILENAME            scene file shared by all cells
+ *    cell X Z FILENAME        scene file of the cell at X, Z
+ *
+ *  Cell X, Z covers X * SIZE to (X + 1) * SIZE along the x axis
+ *  and the same along the z axis.  The cell files are binary
+ *  scene files with their objects in world space.
+ ***********************************************************/
+bool WorldStreamer::Open(const char* filename)
+{
+	std::ifstream file(filename);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not open world file:" << filename << std::endl;
+		return(false);
+	}
+
+	m_cells.clear();
+	m_cellLookup.clear();
+	m_baseFilename.clear();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+		{
+			line.erase(comment);
+		}
+
+		std::istringstream tokens(line);
+		std::string keyword;
+		if (!(tokens >> keyword))
+		{
+			continue;
+		}
+
+		std::string error;
+		if (keyword == "cell_size")
+		{
+			if (!(tokens >> m_settings.cellSize) || (m_settings.cellSize <= 0.0f))
+			{
+				error = "expected a cell size above zero";
+			}
+		}
+		else if (keyword == "load_radius")
+		{
+			if (!(tokens >> m_settings.loadRadius) || (m_settings.loadRadius < 0.0f))
+			{
+				error = "expected a load radius";
+			}
+		}
+		else if (keyword == "unload_radius")
+		{
+			if (!(tokens >> m_settings.unloadRadius) || (m_settings.unloadRadius < 0.0f))
+			{
+				error = "expected an unload radius";
+			}
+		}
+		else if (keyword == "max_cells")
+		{
+			if (!(tokens >> m_settings.maxCells) || (m_settings.maxCells < 1))
+			{
+				error = "expected at least one cell";
+			}
+		}
+		else if (keyword == "cell_textures")
+		{
+			if (!(tokens >> m_settings.texturesPerCell) || (m_settings.texturesPerCell < 0))
+			{
+				error = "expected a texture count";
+			}
+		}
+		else if (keyword == "texture_size")
+		{
+			if (!(tokens >> m_settings.textureSize) || (m_settings.textureSize < 1))
+			{
+				error = "expected a texture size";
+			}
+		}
+		else if (keyword == "upload_kb")
+		{
+			int kilobytes = 0;
+			if (!(tokens >> kilobytes) || (kilobytes < 1))
+			{
+				error = "expected an upload size in KB";
+			}
+			m_settings.uploadBudget = (size_t)kilobytes * 1024;
+		}
+		else if (keyword == "decode_threads")
+		{
+			if (!(tokens >> m_settings.decodeThreads) || (m_settings.decodeThreads < 1))
+			{
+				error = "expected at least one decode thread";
+			}
+		}
+		else if (keyword == "base")
+		{
+			if (!(tokens >> m_baseFilename))
+			{
+				error = "expected base FILENAME";
+			}
+		}
+		else if (keyword == "cell")
+		{
+			WORLD_CELL cell;
+			if (!(tokens >> cell.x >> cell.z >> cell.filename))
+			{
+				error = "expected cell X Z FILENAME";
+			}
+			else if (m_cellLookup.count(GetCellKey(cell.x, cell.z)) > 0)
+			{
+				error = "cell listed twice";
+			}
+			else
+			{
+				cell.slot = -1;
+				cell.bFailed = false;
+				m_cellLookup[GetCellKey(cell.x, cell.z)] = (int)m_cells.size();
+				m_cells.push_back(cell);
+			}
+		}
+		else
+		{
+			error = "unknown keyword " + keyword;
+		}
+
+		if (error.empty() == false)
+		{
+			std::cout << "ERROR: " << filename << ":" << lineNumber << ": " << error << std::endl;
+			return(false);
+		}
+	}
+
+	if (m_baseFilename.empty() == true)
+	{
+		std::cout << "ERROR: World file " << filename << " names no base scene" << std::endl;
+		return(false);
+	}
+
+	// the cells are unloaded further out than they are loaded
+	m_settings.unloadRadius = std::max(m_settings.unloadRadius, m_settings.loadRadius);
+
+	// the layers of the texture array are powers of two
+	int textureSize = 1;
+	while (textureSize < m_settings.textureSize)
+	{
+		textureSize *= 2;
+	}
+	m_settings.textureSize = textureSize;
+
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		ReleaseSlot(*m_slots[i]);
+		delete m_slots[i];
+	}
+	m_slots.resize(m_settings.maxCells);
+	for (int i = 0; i < m_settings.maxCells; i++)
+	{
+		m_slots[i] = new CELL_SLOT();
+		m_slots[i]->state = CELL_EMPTY;
+		m_slots[i]->cell = -1;
+		m_slots[i]->generation = 0;
+		m_slots[i]->retireFrame = 0;
+		m_slots[i]->textureCount = 0;
+		m_slots[i]->uploadedTextures = 0;
+		m_slots[i]->pendingTasks = 0;
+		m_slots[i]->pBatcher = NULL;
+		m_slots[i]->geometryBytes = 0;
+		m_slots[i]->bLoadFailed = false;
+	}
+	m_bSlotDrawn.assign(m_settings.maxCells, 0);
+
+	std::cout << "INFO: Opened world file " << filename << " with " << m_cells.size()
+		<< " cells of " << m_settings.cellSize << " units" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetBaseFilename()
+ *
+ *  This method is used for getting the base scene file named
+ *  by the world file.
+ ***********************************************************/
+const char* WorldStreamer::GetBaseFilename() const
+{
+	return(m_baseFilename.c_str());
+}
+
+/***********************************************************
+ *  CreateTextureArray()
+ *
+ *  This method is used for creating the texture array of the
+ *  world.  The passed in base textures are decoded on the job
+ *  system and take the first layers, in order; the images
+ *  that load are listed in layerImages.  The layers of the
+ *  cell slots follow.  The array holds full mip chains, built
+ *  on the CPU when a texture is decoded, since regenerating
+ *  them on the GPU would touch every layer of the array.
+ ***********************************************************/
+GLuint WorldStreamer::CreateTextureArray(
+	const std::vector<std::string>& filenames,
+	JobSystem* pJobSystem,
+	std::vector<int>& layerImages)
+{
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	while ((maxTextureSize > 0) && (m_settings.textureSize > maxTextureSize))
+	{
+		m_settings.textureSize /= 2;
+	}
+
+	m_levelCount = 1;
+	m_layerBytes = 0;
+	for (int size = m_settings.textureSize; size > 0; size /= 2)
+	{
+		m_layerBytes += (size_t)size * size * 4;
+		if (size > 1)
+		{
+			m_levelCount++;
+		}
+	}
+
+	// indicate to always flip images vertically when loaded, set
+	// here since the flag is shared by the decoding threads
+	stbi_set_flip_vertically_on_load(true);
+
+	int baseCount = (int)filenames.size();
+	std::vector<unsigned char> baseData(baseCount * m_layerBytes);
+	std::vector<char> baseLoaded(baseCount, 0);
+	auto decodeImages = [&](int begin, int end)
+	{
+		std::vector<unsigned char> fileData;
+		for (int i = begin; i < end; i++)
+		{
+			if (ReadFile(filenames[i].c_str(), fileData) == true)
+			{
+				baseLoaded[i] = DecodeLayer(&fileData[0], fileData.size(), &baseData[i * m_layerBytes]) ? 1 : 0;
+			}
+		}
+	};
+	if (NULL != pJobSystem)
+	{
+		pJobSystem->ParallelFor(baseCount, 1, decodeImages);
+	}
+	else
+	{
+		decodeImages(0, baseCount);
+	}
+
+	layerImages.clear();
+	for (int i = 0; i < baseCount; i++)
+	{
+		if (baseLoaded[i] != 0)
+		{
+			layerImages.push_back(i);
+		}
+		else
+		{
+			std::cout << "Could not load image:" << filenames[i] << std::endl;
+		}
+	}
+	m_baseLayerCount = (int)layerImages.size();
+
+	GLint maxLayers = 0;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+	int cellLayers = m_settings.maxCells * m_settings.texturesPerCell;
+	if ((maxLayers > 0) && (m_baseLayerCount + cellLayers > maxLayers))
+	{
+		m_settings.texturesPerCell = std::max(0, (maxLayers - m_baseLayerCount) / m_settings.maxCells);
+		cellLayers = m_settings.maxCells * m_settings.texturesPerCell;
+		std::cout << "ERROR: Texture arrays hold " << maxLayers << " layers, cells get "
+			<< m_settings.texturesPerCell << " textures each" << std::endl;
+	}
+	int layerCount = std::max(1, m_baseLayerCount + cellLayers);
+
+	glGenTextures(1, &m_textureArrayID);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+	glTexStorage3D(
+		GL_TEXTURE_2D_ARRAY,
+		m_levelCount,
+		GL_RGBA8,
+		m_settings.textureSize,
+		m_settings.textureSize,
+		layerCount);
+	MemoryTracker::TrackTexture(m_textureArrayID, MemoryTracker::MEMORY_GPU_TEXTURES, "world texture array",
+		GL_RGBA8, m_settings.textureSize, m_settings.textureSize, layerCount, m_levelCount);
+
+	// set the texture wrapping and filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	for (int layer = 0; layer < m_baseLayerCount; layer++)
+	{
+		UploadLayer(layer, &baseData[layerImages[layer] * m_layerBytes]);
+	}
+
+	m_stats.gpuBytes = layerCount * m_layerBytes;
+	std::cout << "INFO: Created a " << m_settings.textureSize << "x" << m_settings.textureSize
+		<< " world texture array with " << m_baseLayerCount << " base and " << cellLayers
+		<< " cell layers, " << (m_stats.gpuBytes / (1024 * 1024)) << " MB" << std::endl;
+
+	return(m_textureArrayID);
+}
+
+/***********************************************************
+ *  Start()
+ *
+ *  This method is used for starting the I/O thread and the
+ *  decode pool.  Cells refer to the materials and imported
+ *  meshes of the base scene by their tags, which are passed
+ *  in here in the order of their indexes.  The texture slots
+ *  of the cells follow on from firstTextureSlot, and their
+ *  static batches share the shapes of the shape source.
+ ***********************************************************/
+bool WorldStreamer::Start(
+	const std::vector<std::string>& materialTags,
+	const std::vector<std::string>& meshTags,
+	int firstTextureSlot,
+	const StaticBatcher* pShapeSource)
+{
+	if ((m_bRunning == true) || (m_slots.empty() == true) || (0 == m_textureArrayID))
+	{
+		return(false);
+	}
+
+	m_materialIndexes.clear();
+	for (size_t i = 0; i < materialTags.size(); i++)
+	{
+		m_materialIndexes[materialTags[i]] = (int)i;
+	}
+	m_meshTypes.clear();
+	for (size_t i = 0; i < meshTags.size(); i++)
+	{
+		m_meshTypes[meshTags[i]] = MESH_TYPE_COUNT + (int)i;
+	}
+	m_firstCellSlot = firstTextureSlot;
+	m_pShapeSource = pShapeSource;
+
+	m_bRunning = true;
+	m_ioThread = std::thread(&WorldStreamer::IOThreadMain, this);
+	for (int i = 0; i < m_settings.decodeThreads; i++)
+	{
+		m_decodeThreads.push_back(std::thread(&WorldStreamer::DecodeThreadMain, this));
+	}
+
+	std::cout << "INFO: Streaming " << m_settings.maxCells << " cells within "
+		<< m_settings.loadRadius << " units, " << m_settings.decodeThreads << " decode threads, "
+		<< (m_settings.uploadBudget / 1024) << " KB uploaded per frame" << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Stop()
+ *
+ *  This method is used for stopping the threads.  Cells that
+ *  are still loading are left as they are and freed with the
+ *  streamer.
+ ***********************************************************/
+void WorldStreamer::Stop()
+{
+	{
+		std::lock_guard<std::mutex> ioLock(m_ioMutex);
+		std::lock_guard<std::mutex> decodeLock(m_decodeMutex);
+		m_bRunning = false;
+	}
+	m_ioCondition.notify_all();
+	m_decodeCondition.notify_all();
+
+	if (m_ioThread.joinable())
+	{
+		m_ioThread.join();
+	}
+	for (size_t i = 0; i < m_decodeThreads.size(); i++)
+	{
+		m_decodeThreads[i].join();
+	}
+	m_decodeThreads.clear();
+	m_ioQueue.clear();
+	m_decodeQueue.clear();
+}
+
+/***********************************************************
+ *  IOThreadMain()
+ *
+ *  This method is the main function of the I/O thread.  It
+ *  reads the requested cells in the order they were asked
+ *  for, and sleeps while there are none.
+ ***********************************************************/
+void WorldStreamer::IOThreadMain()
+{
+	while (true)
+	{
+		int slot = -1;
+		{
+			std::unique_lock<std::mutex> lock(m_ioMutex);
+			m_ioCondition.wait(lock, [this]
+			{
+				return((m_ioQueue.empty() == false) || (m_bRunning == false));
+			});
+			if (m_bRunning == false)
+			{
+				return;
+			}
+			slot = m_ioQueue.front();
+			m_ioQueue.pop_front();
+		}
+
+		ReadCell(slot);
+	}
+}
+
+/***********************************************************
+ *  DecodeThreadMain()
+ *
+ *  This method is the main function of the decode threads.
+ ***********************************************************/
+void WorldStreamer::DecodeThreadMain()
+{
+	while (true)
+	{
+		DECODE_TASK task;
+		{
+			std::unique_lock<std::mutex> lock(m_decodeMutex);
+			m_decodeCondition.wait(lock, [this]
+			{
+				return((m_decodeQueue.empty() == false) || (m_bRunning == false));
+			});
+			if (m_bRunning == false)
+			{
+				return;
+			}
+			task = m_decodeQueue.front();
+			m_decodeQueue.pop_front();
+		}
+
+		if (task.index < 0)
+		{
+			BuildCell(task.slot);
+		}
+		else
+		{
+			DecodeTexture(task.slot, task.index);
+		}
+		FinishTask(task.slot);
+	}
+}
+
+/***********************************************************
+ *  ReadCell()
+ *
+ *  This method is used for mapping the file of a requested
+ *  cell and reading its image files, on the I/O thread.  The
+ *  scene file is checked when it is opened, which also pages
+ *  it in.  The decoding of every image, and the building of
+ *  the objects, are then queued for the decode pool.
+ ***********************************************************/
+void WorldStreamer::ReadCell(int slotIndex)
+{
+	CELL_SLOT& slot = *m_slots[slotIndex];
+	const WORLD_CELL& cell = m_cells[slot.cell];
+
+	slot.bLoadFailed = (slot.file.Open(cell.filename.c_str()) == false);
+	if (slot.bLoadFailed == true)
+	{
+		std::cout << "ERROR: Could not load world cell " << cell.x << "," << cell.z << std::endl;
+		slot.textureCount = 0;
+		QueueDecodeTasks(slotIndex, 1);
+		return;
+	}
+
+	int textureCount = slot.file.GetTextureCount();
+	if (textureCount > m_settings.texturesPerCell)
+	{
+		std::cout << "ERROR: World cell " << cell.x << "," << cell.z << " has " << textureCount
+			<< " textures, only " << m_settings.texturesPerCell << " are loaded" << std::endl;
+		textureCount = m_settings.texturesPerCell;
+	}
+
+	slot.textureCount = textureCount;
+	slot.imageFiles.resize(textureCount);
+	slot.layerLoaded.assign(textureCount, 0);
+	slot.layerData.resize(textureCount * m_layerBytes);
+	size_t readBytes = slot.layerData.size();
+
+	const SCENE_FILE_TEXTURE* pTextures = slot.file.GetTextures();
+	for (int i = 0; i < textureCount; i++)
+	{
+		ReadFile(slot.file.GetString(pTextures[i].filenameOffset), slot.imageFiles[i]);
+		readBytes += slot.imageFiles[i].size();
+	}
+	m_stagingBytes += readBytes;
+	MemoryTracker::AdjustHeap(this, MemoryTracker::MEMORY_CPU_WORLD, "world staging", (int64_t)readBytes);
+
+	QueueDecodeTasks(slotIndex, textureCount + 1);
+}
+
+/***********************************************************
+ *  QueueDecodeTasks()
+ *
+ *  This method is used for queueing the building of a cell's
+ *  objects, and the decoding of its first taskCount - 1
+ *  images, for the decode pool.
+ ***********************************************************/
+void WorldStreamer::QueueDecodeTasks(int slot, int taskCount)
+{
+	m_slots[slot]->pendingTasks = taskCount;
+	{
+		std::lock_guard<std::mutex> lock(m_decodeMutex);
+		for (int i = 0; i < taskCount; i++)
+		{
+			DECODE_TASK task;
+			task.slot = slot;
+			task.index = i - 1;
+			m_decodeQueue.push_back(task);
+		}
+	}
+	m_decodeCondition.notify_all();
+}
+
+/***********************************************************
+ *  DecodeTexture()
+ *
+ *  This method is used for decoding one image of a cell into
+ *  its layer, and freeing the image file.
+ ***********************************************************/
+void WorldStreamer::DecodeTexture(int slotIndex, int index)
+{
+	CELL_SLOT& slot = *m_slots[slotIndex];
+	std::vector<unsigned char>& fileData = slot.imageFiles[index];
+
+	if (fileData.empty() == false)
+	{
+		slot.layerLoaded[index] = DecodeLayer(
+			&fileData[0],
+			fileData.size(),
+			&slot.layerData[index * m_layerBytes]) ? 1 : 0;
+	}
+	if (slot.layerLoaded[index] == 0)
+	{
+		const SCENE_FILE_TEXTURE& texture = slot.file.GetTextures()[index];
+		std::cout << "Could not load image:" << slot.file.GetString(texture.filenameOffset) << std::endl;
+	}
+
+	m_stagingBytes -= fileData.size();
+	MemoryTracker::AdjustHeap(this, MemoryTracker::MEMORY_CPU_WORLD, "world staging", -(int64_t)fileData.size());
+	std::vector<unsigned char>().swap(fileData);
+}
+
+/***********************************************************
+ *  BuildCell()
+ *
+ *  This method is used for copying the objects of a cell with
+ *  their indexes resolved against the world: materials and
+ *  imported meshes by their tags in the base scene, textures
+ *  to the layers of the slot.  Objects with a mesh the base
+ *  scene does not have are left out, with their children.
+ *  The static objects are merged into the cell's batches and
+ *  the point lights of the cell are kept.
+ ***********************************************************/
+void WorldStreamer::BuildCell(int slotIndex)
+{
+	CELL_SLOT& slot = *m_slots[slotIndex];
+	const SceneFile& file = slot.file;
+	const WORLD_CELL& cell = m_cells[slot.cell];
+	if (file.IsOpen() == false)
+	{
+		return;
+	}
+
+	std::vector<int> materialIndexes(file.GetMaterialCount(), -1);
+	const SCENE_FILE_MATERIAL* pMaterials = file.GetMaterials();
+	for (int i = 0; i < file.GetMaterialCount(); i++)
+	{
+		std::unordered_map<std::string, int>::const_iterator found =
+			m_materialIndexes.find(file.GetString(pMaterials[i].tagOffset));
+		if (found != m_materialIndexes.end())
+		{
+			materialIndexes[i] = found->second;
+		}
+		else
+		{
+			std::cout << "ERROR: World cell " << cell.x << "," << cell.z << " uses material "
+				<< file.GetString(pMaterials[i].tagOffset) << ", which the base scene does not define" << std::endl;
+		}
+	}
+
+	std::vector<int> meshTypes(file.GetMeshCount(), -1);
+	const SCENE_FILE_MESH* pMeshes = file.GetMeshes();
+	for (int i = 0; i < file.GetMeshCount(); i++)
+	{
+		std::unordered_map<std::string, int>::const_iterator found =
+			m_meshTypes.find(file.GetString(pMeshes[i].tagOffset));
+		if (found != m_meshTypes.end())
+		{
+			meshTypes[i] = found->second;
+		}
+		else
+		{
+			std::cout << "ERROR: World cell " << cell.x << "," << cell.z << " uses mesh "
+				<< file.GetString(pMeshes[i].tagOffset) << ", which the base scene does not load" << std::endl;
+		}
+	}
+
+	int firstSlot = m_firstCellSlot + (slotIndex * m_settings.texturesPerCell);
+	const SCENE_OBJECT* pObjects = file.GetObjects();
+	int objectCount = file.GetObjectCount();
+	std::vector<int> objectIndexes(objectCount, -1);
+	bool bHasStatic = false;
+
+	slot.objects.clear();
+	slot.objects.reserve(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		SCENE_OBJECT object = pObjects[i];
+		if (object.meshType >= MESH_TYPE_COUNT)
+		{
+			object.meshType = meshTypes[object.meshType - MESH_TYPE_COUNT];
+		}
+		if (object.parentIndex >= 0)
+		{
+			object.parentIndex = objectIndexes[object.parentIndex];
+			if (object.parentIndex < 0)
+			{
+				continue;
+			}
+		}
+		if (object.meshType < 0)
+		{
+			continue;
+		}
+
+		object.textureSlot = ((object.textureSlot >= 0) && (object.textureSlot < slot.textureCount)) ?
+			firstSlot + object.textureSlot : -1;
+		object.materialIndex = (object.materialIndex >= 0) ? materialIndexes[object.materialIndex] : -1;
+		bHasStatic |= ((object.flags & SCENE_OBJECT_STATIC) != 0);
+
+		objectIndexes[i] = (int)slot.objects.size();
+		slot.objects.push_back(object);
+	}
+
+	slot.pointLights.clear();
+	const SCENE_FILE_LIGHT* pLights = file.GetLights();
+	for (int i = 0; i < file.GetLightCount(); i++)
+	{
+		const SCENE_FILE_LIGHT& record = pLights[i];
+		if ((record.type != SCENE_LIGHT_POINT) || (record.bActive == 0))
+		{
+			continue;
+		}
+
+		POINT_LIGHT light;
+		light.position = glm::vec3(record.position[0], record.position[1], record.position[2]);
+		light.ambient = glm::vec3(record.ambient[0], record.ambient[1], record.ambient[2]);
+		light.diffuse = glm::vec3(record.diffuse[0], record.diffuse[1], record.diffuse[2]);
+		light.specular = glm::vec3(record.specular[0], record.specular[1], record.specular[2]);
+		light.constant = record.constant;
+		light.linear = record.linear;
+		light.quadratic = record.quadratic;
+		light.bActive = true;
+		slot.pointLights.push_back(light);
+	}
+
+	if ((bHasStatic == true) && (NULL != m_pShapeSource))
+	{
+		slot.pBatcher = new StaticBatcher(m_pShapeSource);
+		slot.pBatcher->Build(&slot.objects[0], (int)slot.objects.size());
+		m_stagingBytes += slot.pBatcher->GetGeometryBytes();
+	}
+}
+
+/***********************************************************
+ *  FinishTask()
+ *
+ *  This method is used for counting down the decode tasks of
+ *  a cell.  The thread that finishes the last one closes the
+ *  cell file, points the objects whose image did not decode
+ *  at no texture, and hands the cell to the GL thread.
+ ***********************************************************/
+void WorldStreamer::FinishTask(int slotIndex)
+{
+	CELL_SLOT& slot = *m_slots[slotIndex];
+	if (slot.pendingTasks.fetch_sub(1) != 1)
+	{
+		return;
+	}
+
+	int firstSlot = m_firstCellSlot + (slotIndex * m_settings.texturesPerCell);
+	for (size_t i = 0; i < slot.objects.size(); i++)
+	{
+		int texture = slot.objects[i].textureSlot - firstSlot;
+		if ((slot.objects[i].textureSlot >= 0) && (slot.layerLoaded[texture] == 0))
+		{
+			slot.objects[i].textureSlot = -1;
+		}
+	}
+
+	slot.imageFiles.clear();
+	slot.file.Close();
+	slot.state.store(CELL_READY, std::memory_order_release);
+}
+
+/***********************************************************
+ *  DecodeLayer()
+ *
+ *  This method is used for decoding an image file into a
+ *  square RGBA layer of the texture array size, followed by
+ *  its mip chain.
+ ***********************************************************/
+bool WorldStreamer::DecodeLayer(const unsigned char* pFileData, size_t fileSize, unsigned char* pLayer) const
+{
+	SceneManager::TEXTURE_IMAGE image;
+	image.filename = NULL;
+	image.pixels = stbi_load_from_memory(
+		pFileData,
+		(int)fileSize,
+		&image.width,
+		&image.height,
+		&image.colorChannels,
+		4);
+	if (NULL == image.pixels)
+	{
+		return(false);
+	}
+
+	// the image was expanded to four channels as it was decoded
+	image.colorChannels = 4;
+	SceneManager::ResampleImage(image, pLayer, m_settings.textureSize);
+	stbi_image_free(image.pixels);
+
+	BuildMipChain(pLayer, m_settings.textureSize);
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method is used for reading a whole file into memory.
+ ***********************************************************/
+bool WorldStreamer::ReadFile(const char* filename, std::vector<unsigned char>& data)
+{
+	data.clear();
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		return(false);
+	}
+
+	std::streamoff size = file.tellg();
+	if (size <= 0)
+	{
+		return(false);
+	}
+
+	data.resize((size_t)size);
+	file.seekg(0);
+	file.read((char*)&data[0], size);
+	if (!file)
+	{
+		data.clear();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetCellKey()
+ *
+ *  This method is used for combining the grid coordinates of
+ *  a cell into the key of the cell lookup.
+ ***********************************************************/
+int64_t WorldStreamer::GetCellKey(int x, int z)
+{
+	return((int64_t)(((uint64_t)(uint32_t)x << 32) | (uint32_t)z));
+}
+
+/***********************************************************
+ *  GetCellDistance()
+ *
+ *  This method is used for getting the distance on the x/z
+ *  plane from a point to the nearest edge of a cell, which
+ *  is zero inside the cell.
+ ***********************************************************/
+float WorldStreamer::GetCellDistance(const WORLD_CELL& cell, const glm::vec3& position) const
+{
+	float minX = cell.x * m_settings.cellSize;
+	float minZ = cell.z * m_settings.cellSize;
+	float dx = std::max(0.0f, std::max(minX - position.x, position.x - (minX + m_settings.cellSize)));
+	float dz = std::max(0.0f, std::max(minZ - position.z, position.z - (minZ + m_settings.cellSize)));
+
+	return(sqrtf((dx * dx) + (dz * dz)));
+}
+
+/***********************************************************
+ *  RequestCell()
+ *
+ *  This method is used for starting to load a cell into a
+ *  free slot, on the update thread.  It returns false when
+ *  every slot is in use.
+ ***********************************************************/
+bool WorldStreamer::RequestCell(int cellIndex)
+{
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		CELL_SLOT& slot = *m_slots[i];
+		if (slot.state.load(std::memory_order_acquire) != CELL_EMPTY)
+		{
+			continue;
+		}
+
+		slot.cell = cellIndex;
+		slot.generation++;
+		slot.textureCount = 0;
+		slot.uploadedTextures = 0;
+		slot.bLoadFailed = false;
+		slot.requestTime = std::chrono::steady_clock::now();
+		slot.state.store(CELL_LOADING, std::memory_order_release);
+		m_cells[cellIndex].slot = (int)i;
+
+		{
+			std::lock_guard<std::mutex> lock(m_ioMutex);
+			m_ioQueue.push_back((int)i);
+		}
+		m_ioCondition.notify_one();
+
+		return(true);
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  RetireSlot()
+ *
+ *  This method is used for taking a resident cell out of the
+ *  frames recorded from frameIndex on.  The GL thread frees
+ *  it once it draws that frame.
+ ***********************************************************/
+void WorldStreamer::RetireSlot(int slotIndex, uint64_t frameIndex)
+{
+	CELL_SLOT& slot = *m_slots[slotIndex];
+	m_cells[slot.cell].slot = -1;
+	m_bSlotDrawn[slotIndex] = 0;
+	m_residencyVersion++;
+
+	slot.retireFrame = frameIndex;
+	slot.state.store(CELL_RETIRED, std::memory_order_release);
+
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.cellsUnloaded++;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for deciding which cells are loaded,
+ *  on the update thread before a frame is recorded.  Cells
+ *  the GL thread has finished are drawn from this frame on,
+ *  and drawn cells past the unload radius are retired.  The
+ *  cells within the load radius that are not loaded yet are
+ *  requested nearest first.  When every slot is in use, the
+ *  furthest drawn cell outside the load radius is retired to
+ *  make room, if it is further away than the wanted cell.
+ ***********************************************************/
+void WorldStreamer::Update(const glm::vec3& cameraPosition, uint64_t frameIndex)
+{
+	int loadingCount = 0;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		CELL_SLOT& slot = *m_slots[i];
+		int state = slot.state.load(std::memory_order_acquire);
+		if ((state == CELL_LOADING) || (state == CELL_READY))
+		{
+			loadingCount++;
+			continue;
+		}
+		if (state != CELL_RESIDENT)
+		{
+			continue;
+		}
+
+		// a cell that could not be read frees its slot at once, and
+		// is not requested again
+		if (slot.bLoadFailed == true)
+		{
+			m_cells[slot.cell].bFailed = true;
+			RetireSlot((int)i, frameIndex);
+			continue;
+		}
+		if (m_bSlotDrawn[i] == 0)
+		{
+			m_bSlotDrawn[i] = 1;
+			m_residencyVersion++;
+		}
+		if (GetCellDistance(m_cells[slot.cell], cameraPosition) > m_settings.unloadRadius)
+		{
+			RetireSlot((int)i, frameIndex);
+		}
+	}
+
+	// the cells within the load radius that are not loaded yet
+	m_candidates.clear();
+	int cellX = (int)floorf(cameraPosition.x / m_settings.cellSize);
+	int cellZ = (int)floorf(cameraPosition.z / m_settings.cellSize);
+	int cellRadius = (int)ceilf(m_settings.loadRadius / m_settings.cellSize);
+	for (int x = cellX - cellRadius; x <= cellX + cellRadius; x++)
+	{
+		for (int z = cellZ - cellRadius; z <= cellZ + cellRadius; z++)
+		{
+			std::unordered_map<int64_t, int>::const_iterator found = m_cellLookup.find(GetCellKey(x, z));
+			if (found == m_cellLookup.end())
+			{
+				continue;
+			}
+
+			const WORLD_CELL& cell = m_cells[found->second];
+			float distance = GetCellDistance(cell, cameraPosition);
+			if ((cell.slot < 0) && (cell.bFailed == false) && (distance <= m_settings.loadRadius))
+			{
+				m_candidates.push_back(std::make_pair(distance, found->second));
+			}
+		}
+	}
+	std::sort(m_candidates.begin(), m_candidates.end());
+
+	for (size_t i = 0; (i < m_candidates.size()) && (loadingCount < g_MaxLoadsInFlight); i++)
+	{
+		if (RequestCell(m_candidates[i].second) == true)
+		{
+			loadingCount++;
+			continue;
+		}
+
+		// no slot is free, so make room for the wanted cell
+		int furthestSlot = -1;
+		float furthestDistance = std::max(m_settings.loadRadius, m_candidates[i].first);
+		for (size_t slot = 0; slot < m_slots.size(); slot++)
+		{
+			if (m_bSlotDrawn[slot] == 0)
+			{
+				continue;
+			}
+
+			float distance = GetCellDistance(m_cells[m_slots[slot]->cell], cameraPosition);
+			if (distance > furthestDistance)
+			{
+				furthestDistance = distance;
+				furthestSlot = (int)slot;
+			}
+		}
+		if (furthestSlot >= 0)
+		{
+			RetireSlot(furthestSlot, frameIndex);
+		}
+		break;
+	}
+
+	m_drawnSlots.clear();
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		if (m_bSlotDrawn[i] != 0)
+		{
+			m_drawnSlots.push_back((int)i);
+		}
+	}
+}
+
+/***********************************************************
+ *  GatherLights()
+ *
+ *  This method is used for filling the light state from the
+ *  base scene lights and the point lights of the drawn cells.
+ *  The shader takes a few point lights, so the ones nearest
+ *  the camera are used.  They are only picked again once the
+ *  drawn cells change or the camera has moved some way, so
+ *  the light state does not change, and is not uploaded
+ *  again, every frame.
+ ***********************************************************/
+bool WorldStreamer::GatherLights(
+	const LIGHT_STATE& baseLights,
+	const glm::vec3& cameraPosition,
+	LIGHT_STATE& lights)
+{
+	if ((m_lightsVersion == m_residencyVersion) &&
+		(glm::length(cameraPosition - m_lightsPosition) < m_settings.cellSize * g_LightUpdateFraction))
+	{
+		return(false);
+	}
+	m_lightsVersion = m_residencyVersion;
+	m_lightsPosition = cameraPosition;
+
+	std::vector<std::pair<float, const POINT_LIGHT*> >& pointLights = m_gatheredLights;
+	pointLights.clear();
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		const POINT_LIGHT& light = baseLights.pointLights[i];
+		if (light.bActive == true)
+		{
+			glm::vec3 offset = light.position - cameraPosition;
+			pointLights.push_back(std::make_pair(glm::dot(offset, offset), &light));
+		}
+	}
+	for (size_t i = 0; i < m_drawnSlots.size(); i++)
+	{
+		const std::vector<POINT_LIGHT>& cellLights = m_slots[m_drawnSlots[i]]->pointLights;
+		for (size_t j = 0; j < cellLights.size(); j++)
+		{
+			glm::vec3 offset = cellLights[j].position - cameraPosition;
+			pointLights.push_back(std::make_pair(glm::dot(offset, offset), &cellLights[j]));
+		}
+	}
+
+	int lightCount = std::min((int)pointLights.size(), MAX_POINT_LIGHTS);
+	std::partial_sort(
+		pointLights.begin(),
+		pointLights.begin() + lightCount,
+		pointLights.end(),
+		[](const std::pair<float, const POINT_LIGHT*>& left, const std::pair<float, const POINT_LIGHT*>& right)
+		{
+			return(left.first < right.first);
+		});
+
+	LIGHT_STATE gathered = baseLights;
+	for (int i = 0; i < MAX_POINT_LIGHTS; i++)
+	{
+		gathered.pointLights[i] = (i < lightCount) ? *pointLights[i].second : POINT_LIGHT();
+	}
+	lights = gathered;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetDrawnSlots()
+ *
+ *  This method is used for getting the slots whose cells are
+ *  drawn in the frame being recorded.
+ ***********************************************************/
+const std::vector<int>& WorldStreamer::GetDrawnSlots() const
+{
+	return(m_drawnSlots);
+}
+
+/***********************************************************
+ *  ProcessUploads()
+ *
+ *  This method is used for freeing the retired cells that no
+ *  frame draws any more, and for uploading the decoded cells
+ *  on the GL thread.  The cells nearest the camera go first.
+ *  Texture layers and static batches are uploaded one at a
+ *  time until the frame's budget is spent, and a cell that
+ *  does not finish carries on in the next frame.  At least
+ *  one upload is made every frame, so a layer larger than
+ *  the budget still gets through.
+ ***********************************************************/
+void WorldStreamer::ProcessUploads(uint64_t frameIndex, const glm::vec3& cameraPosition)
+{
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	m_uploadOrder.clear();
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		CELL_SLOT& slot = *m_slots[i];
+		int state = slot.state.load(std::memory_order_acquire);
+		if ((state == CELL_RETIRED) && (slot.retireFrame <= frameIndex))
+		{
+			ReleaseSlot(slot);
+			slot.state.store(CELL_EMPTY, std::memory_order_release);
+		}
+		else if (state == CELL_READY)
+		{
+			m_uploadOrder.push_back(std::make_pair(GetCellDistance(m_cells[slot.cell], cameraPosition), (int)i));
+		}
+	}
+	std::sort(m_uploadOrder.begin(), m_uploadOrder.end());
+
+	size_t uploadBytes = 0;
+	int uploadLayers = 0;
+	bool bBudgetLeft = true;
+	for (size_t i = 0; (i < m_uploadOrder.size()) && (bBudgetLeft == true); i++)
+	{
+		int slotIndex = m_uploadOrder[i].second;
+		CELL_SLOT& slot = *m_slots[slotIndex];
+
+		while ((slot.uploadedTextures < slot.textureCount) && (bBudgetLeft == true))
+		{
+			int texture = slot.uploadedTextures;
+			if (slot.layerLoaded[texture] != 0)
+			{
+				if ((uploadBytes > 0) && (uploadBytes + m_layerBytes > m_settings.uploadBudget))
+				{
+					bBudgetLeft = false;
+					break;
+				}
+
+				int layer = m_baseLayerCount + (slotIndex * m_settings.texturesPerCell) + texture;
+				UploadLayer(layer, &slot.layerData[texture * m_layerBytes]);
+				uploadBytes += m_layerBytes;
+				uploadLayers++;
+			}
+			slot.uploadedTextures++;
+		}
+		if (bBudgetLeft == false)
+		{
+			break;
+		}
+
+		if ((NULL != slot.pBatcher) && (slot.pBatcher->GetGeometryBytes() > 0))
+		{
+			size_t geometryBytes = slot.pBatcher->GetGeometryBytes();
+			if ((uploadBytes > 0) && (uploadBytes + geometryBytes > m_settings.uploadBudget))
+			{
+				bBudgetLeft = false;
+				break;
+			}
+
+			slot.pBatcher->CreateBuffers();
+			uploadBytes += geometryBytes;
+			m_stagingBytes -= geometryBytes;
+			m_geometryBytes += geometryBytes;
+			slot.geometryBytes = geometryBytes;
+		}
+
+		// the cell is on the GPU, so its decoded layers are freed
+		m_stagingBytes -= slot.layerData.size();
+		MemoryTracker::AdjustHeap(this, MemoryTracker::MEMORY_CPU_WORLD, "world staging", -(int64_t)slot.layerData.size());
+		std::vector<unsigned char>().swap(slot.layerData);
+		slot.state.store(CELL_RESIDENT, std::memory_order_release);
+
+		double loadMs = ElapsedMs(slot.requestTime, std::chrono::steady_clock::now());
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		m_stats.cellsLoaded++;
+		m_totalLoadMs += loadMs;
+		m_stats.averageLoadMs = m_totalLoadMs / m_stats.cellsLoaded;
+		m_stats.maxLoadMs = std::max(m_stats.maxLoadMs, loadMs);
+	}
+
+	double uploadMs = ElapsedMs(startTime, std::chrono::steady_clock::now());
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_stats.uploadBytes = uploadBytes;
+	m_stats.uploadLayers = uploadLayers;
+	m_stats.uploadMs = uploadMs;
+	m_stats.maxUploadMs = std::max(m_stats.maxUploadMs, uploadMs);
+}
+
+/***********************************************************
+ *  UploadLayer()
+ *
+ *  This method is used for uploading a decoded layer and its
+ *  mip chain into a layer of the texture array.
+ ***********************************************************/
+void WorldStreamer::UploadLayer(int layer, const unsigned char* pData)
+{
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArrayID);
+
+	int size = m_settings.textureSize;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		glTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY, level,
+			0, 0, layer,
+			size, size, 1,
+			GL_RGBA, GL_UNSIGNED_BYTE,
+			pData);
+		pData += (size_t)size * size * 4;
+		size = std::max(1, size / 2);
+	}
+}
+
+/***********************************************************
+ *  ReleaseSlot()
+ *
+ *  This method is used for freeing the objects, batches and
+ *  decoded data of a slot.  The memory is handed back rather
+ *  than kept for the next cell, so an idle slot costs nothing.
+ ***********************************************************/
+void WorldStreamer::ReleaseSlot(CELL_SLOT& slot)
+{
+	if (NULL != slot.pBatcher)
+	{
+		delete slot.pBatcher;
+		slot.pBatcher = NULL;
+	}
+	m_geometryBytes -= slot.geometryBytes;
+	slot.geometryBytes = 0;
+
+	std::vector<SCENE_OBJECT>().swap(slot.objects);
+	std::vector<POINT_LIGHT>().swap(slot.pointLights);
+	m_stagingBytes -= slot.layerData.size();
+	MemoryTracker::AdjustHeap(this, MemoryTracker::MEMORY_CPU_WORLD, "world staging", -(int64_t)slot.layerData.size());
+	std::vector<unsigned char>().swap(slot.layerData);
+	slot.imageFiles.clear();
+	slot.layerLoaded.clear();
+	slot.file.Close();
+	slot.textureCount = 0;
+	slot.uploadedTextures = 0;
+}
+
+/***********************************************************
+ *  GetCellObjects()
+ *
+ *  This method is used for getting the objects of the cell
+ *  loaded in a slot.
+ ***********************************************************/
+const std::vector<SCENE_OBJECT>& WorldStreamer::GetCellObjects(int slot) const
+{
+	return(m_slots[slot]->objects);
+}
+
+/***********************************************************
+ *  GetCellBatcher()
+ *
+ *  This method is used for getting the static batches of the
+ *  cell loaded in a slot, or NULL when it has none.
+ ***********************************************************/
+const StaticBatcher* WorldStreamer::GetCellBatcher(int slot) const
+{
+	return(m_slots[slot]->pBatcher);
+}
+
+/***********************************************************
+ *  GetCellGeneration()
+ *
+ *  This method is used for getting the number of loads of a
+ *  slot, which changes whenever it holds another cell.
+ ***********************************************************/
+uint32_t WorldStreamer::GetCellGeneration(int slot) const
+{
+	return(m_slots[slot]->generation);
+}
+
+/***********************************************************
+ *  GetSlotCount()
+ *
+ *  This method is used for getting the number of cell slots.
+ ***********************************************************/
+int WorldStreamer::GetSlotCount() const
+{
+	return((int)m_slots.size());
+}
+
+/***********************************************************
+ *  GetTextureLayer()
+ *
+ *  This method is used for getting the texture array layer
+ *  of a cell texture slot, or -1 for a slot that does not
+ *  belong to the cells.
+ ***********************************************************/
+int WorldStreamer::GetTextureLayer(int textureSlot) const
+{
+	int cellTexture = textureSlot - m_firstCellSlot;
+	if ((cellTexture < 0) || (cellTexture >= m_settings.maxCells * m_settings.texturesPerCell))
+	{
+		return(-1);
+	}
+
+	return(m_baseLayerCount + cellTexture);
+}
+
+/***********************************************************
+ *  GetTextureArrayID()
+ *
+ *  This method is used for getting the OpenGL name of the
+ *  world texture array.
+ ***********************************************************/
+GLuint WorldStreamer::GetTextureArrayID() const
+{
+	return(m_textureArrayID);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the streaming statistics.
+ ***********************************************************/
+WorldStreamer::STREAM_STATS WorldStreamer::GetStats() const
+{
+	STREAM_STATS stats;
+	{
+		std::lock_guard<std::mutex> lock(m_statsMutex);
+		stats = m_stats;
+	}
+
+	stats.residentCells = 0;
+	stats.loadingCells = 0;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		int state = m_slots[i]->state.load(std::memory_order_acquire);
+		if (state == CELL_RESIDENT)
+		{
+			stats.residentCells++;
+		}
+		else if ((state == CELL_LOADING) || (state == CELL_READY))
+		{
+			stats.loadingCells++;
+		}
+	}
+	stats.cpuBytes = m_stagingBytes;
+	stats.gpuBytes += m_geometryBytes;
+
+	return(stats);
+}
+
+/***********************************************************
+ *  PrintStats()
+ *
+ *  This method is used for printing the streaming statistics.
+ ***********************************************************/
+void WorldStreamer::PrintStats() const
+{
+	STREAM_STATS stats = GetStats();
+
+	std::cout << "WORLD: cells resident " << stats.residentCells
+		<< ", loading " << stats.loadingCells
+		<< ", loaded " << stats.cellsLoaded
+		<< ", unloaded " << stats.cellsUnloaded
+		<< ", load " << stats.averageLoadMs << " ms (max " << stats.maxLoadMs << " ms)"
+		<< ", upload " << (stats.uploadBytes / 1024) << " KB in " << stats.uploadMs << " ms"
+		<< " (max " << stats.maxUploadMs << " ms)"
+		<< ", staging " << (stats.cpuBytes / (1024 * 1024)) << " MB"
+		<< ", GPU " << (stats.gpuBytes / (1024 * 1024)) << " MB"
+		<< std::endl;
+}
@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+// worldstreamer.h
+// ============
+// divide a large world into grid cells and stream the cells around the camera
+// in and out - an I/O thread, a decode pool and a GPU upload budget per frame
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneObject.h"
+#include "SceneFile.h"
+#include "StaticBatcher.h"
+#include "FrameSnapshot.h"
+#include "JobSystem.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  WorldStreamer
+ *
+ *  This class keeps the cells of a world loaded around the
+ *  camera.  A world file lists a base scene, which holds the
+ *  materials, meshes and lights shared by the whole world,
+ *  and one binary scene file per grid cell on the x/z plane
+ *  with the objects, textures and point lights of that cell.
+ *
+ *  Cells are loaded into a fixed number of slots, and every
+ *  slot owns a fixed range of texture array layers, so the
+ *  memory in use stays bounded however large the world is.
+ *  A load goes through three stages:
+ *
+ *  - the I/O thread maps the cell file and reads its image
+ *    files into memory
+ *  - the decode pool decodes the images into layers with
+ *    their mip chains, and resolves the objects against the
+ *    base scene and merges their static batches
+ *  - the GL thread uploads the layers and batches, a few at
+ *    a time, so that a frame never uploads more than its
+ *    budget
+ *
+ *  The update thread decides which cells are wanted and
+ *  reads the objects of the cells that are resident.  A cell
+ *  that moves out of range is retired, and its slot is freed
+ *  on the GL thread once no frame in flight still draws it.
+ *  Cells are unloaded further out than they are loaded, so a
+ *  camera moving along a cell border does not reload them.
+ ***********************************************************/
+class WorldStreamer
+{
+public:
+	// constructor
+	WorldStreamer();
+	// destructor
+	~WorldStreamer();
+
+	struct WORLD_SETTINGS
+	{
+		// size of a grid cell in world units
+		float cellSize;
+		// cells closer than this to the camera are loaded, cells
+		// further than the unload radius are unloaded
+		float loadRadius;
+		float unloadRadius;
+		// cells loaded at once, which bounds the memory in use
+		int maxCells;
+		// texture array layers owned by every cell
+		int texturesPerCell;
+		// width and height of a texture layer
+		int textureSize;
+		// bytes uploaded to the GPU per frame
+		size_t uploadBudget;
+		// threads that decode the loaded cells
+		int decodeThreads;
+	};
+
+	struct STREAM_STATS
+	{
+		int residentCells;
+		int loadingCells;
+		int cellsLoaded;
+		int cellsUnloaded;
+		// time from requesting a cell to drawing it
+		double averageLoadMs;
+		double maxLoadMs;
+		// uploads of the last frame, and the longest of any frame
+		size_t uploadBytes;
+		int uploadLayers;
+		double uploadMs;
+		double maxUploadMs;
+		// memory held by the cell slots
+		size_t cpuBytes;
+		size_t gpuBytes;
+	};
+
+private:
+	enum CELL_STATE
+	{
+		// the slot holds no cell
+		CELL_EMPTY,
+		// read by the I/O thread and decoded by the decode pool
+		CELL_LOADING,
+		// decoded, waiting for the GL thread to upload it
+		CELL_READY,
+		// uploaded and drawn
+		CELL_RESIDENT,
+		// no longer drawn, freed once no frame in flight draws it
+		CELL_RETIRED
+	};
+
+	struct WORLD_CELL
+	{
+		int x;
+		int z;
+		std::string filename;
+		// slot the cell is loaded in, -1 when it is not
+		int slot;
+		// a cell that failed to load is not tried again
+		bool bFailed;
+	};
+
+	struct CELL_SLOT
+	{
+		std::atomic<int> state;
+		int cell;
+		// raised on every load, so caches of the render side
+		// notice that the slot holds another cell
+		uint32_t generation;
+		// frame from which on the retired cell is not drawn
+		uint64_t retireFrame;
+		// the mapped cell file, open while the cell is loading
+		SceneFile file;
+		// image files read by the I/O thread
+		std::vector<std::vector<unsigned char> > imageFiles;
+		// decoded layers with their mip chains, freed once uploaded
+		std::vector<unsigned char> layerData;
+		std::vector<char> layerLoaded;
+		int textureCount;
+		int uploadedTextures;
+		// decode tasks of the cell that are still to finish
+		std::atomic<int> pendingTasks;
+		// objects with their indexes resolved against the world
+		std::vector<SCENE_OBJECT> objects;
+		StaticBatcher* pBatcher;
+		// merged geometry of the batcher, counted once uploaded
+		size_t geometryBytes;
+		std::vector<POINT_LIGHT> pointLights;
+		std::chrono::steady_clock::time_point requestTime;
+		// the cell file could not be opened
+		bool bLoadFailed;
+	};
+
+	// a texture, or with index -1 the objects, of a loading cell
+	struct DECODE_TASK
+	{
+		int slot;
+		int index;
+	};
+
+	WORLD_SETTINGS m_settings;
+	std::string m_baseFilename;
+	std::vector<WORLD_CELL> m_cells;
+	// cell index by grid coordinates
+	std::unordered_map<int64_t, int> m_cellLookup;
+	std::vector<CELL_SLOT*> m_slots;
+
+	// texture array shared by the base scene and the cells
+	GLuint m_textureArrayID;
+	int m_levelCount;
+	size_t m_layerBytes;
+	int m_baseLayerCount;
+	// texture slot of the first cell layer, after the base slots
+	int m_firstCellSlot;
+
+	// base scene records the cells are resolved against
+	std::unordered_map<std::string, int> m_materialIndexes;
+	std::unordered_map<std::string, int> m_meshTypes;
+	const StaticBatcher* m_pShapeSource;
+
+	// threads and their queues
+	std::thread m_ioThread;
+	std::vector<std::thread> m_decodeThreads;
+	std::deque<int> m_ioQueue;
+	std::deque<DECODE_TASK> m_decodeQueue;
+	std::mutex m_ioMutex;
+	std::mutex m_decodeMutex;
+	std::condition_variable m_ioCondition;
+	std::condition_variable m_decodeCondition;
+	std::atomic<bool> m_bRunning;
+
+	// update thread state
+	std::vector<int> m_drawnSlots;
+	std::vector<char> m_bSlotDrawn;
+	std::vector<std::pair<float, int> > m_candidates;
+	std::vector<std::pair<float, const POINT_LIGHT*> > m_gatheredLights;
+	uint32_t m_residencyVersion;
+	uint32_t m_lightsVersion;
+	glm::vec3 m_lightsPosition;
+
+	// GL thread state
+	std::vector<std::pair<float, int> > m_uploadOrder;
+
+	// read and decoded data waiting for upload, and uploaded batches
+	std::atomic<size_t> m_stagingBytes;
+	std::atomic<size_t> m_geometryBytes;
+
+	STREAM_STATS m_stats;
+	double m_totalLoadMs;
+	mutable std::mutex m_statsMutex;
+
+	// main functions of the threads
+	void IOThreadMain();
+	void DecodeThreadMain();
+	// read the cell file and its images, then queue the decoding
+	void ReadCell(int slot);
+	// decode one image of a cell into its layer
+	void DecodeTexture(int slot, int index);
+	// resolve the objects, lights and static batches of a cell
+	void BuildCell(int slot);
+	// hand a cell to the GL thread once its last task is done
+	void FinishTask(int slot);
+	// queue decode tasks for the decode pool
+	void QueueDecodeTasks(int slot, int taskCount);
+
+	// upload one decoded layer with its mip chain
+	void UploadLayer(int layer, const unsigned char* pData);
+	// free the cell and GPU data of a slot
+	void ReleaseSlot(CELL_SLOT& slot);
+	// distance on the x/z plane from a point to a cell
+	float GetCellDistance(const WORLD_CELL& cell, const glm::vec3& position) const;
+	// start loading a cell into a free slot, false when none is free
+	bool RequestCell(int cell);
+	// retire the cell of a resident slot
+	void RetireSlot(int slot, uint64_t frameIndex);
+
+	// decode an image file into a square layer with its mip chain
+	bool DecodeLayer(const unsigned char* pFileData, size_t fileSize, unsigned char* pLayer) const;
+	// read a whole file into memory
+	static bool ReadFile(const char* filename, std::vector<unsigned char>& data);
+	// key of a cell in the lookup
+	static int64_t GetCellKey(int x, int z);
+
+public:
+	// read the world file with its settings and cells
+	bool Open(const char* filename);
+	// base scene file of the world
+	const char* GetBaseFilename() const;
+
+	// create the texture array, with the passed in base textures
+	// in the first layers, and return its OpenGL name
+	GLuint CreateTextureArray(
+		const std::vector<std::string>& filenames,
+		JobSystem* pJobSystem,
+		std::vector<int>& layerImages);
+	// start the threads, once the base scene is loaded
+	bool Start(
+		const std::vector<std::string>& materialTags,
+		const std::vector<std::string>& meshTags,
+		int firstTextureSlot,
+		const StaticBatcher* pShapeSource);
+	// stop and join the threads
+	void Stop();
+
+	// update thread - request and retire cells around the camera
+	void Update(const glm::vec3& cameraPosition, uint64_t frameIndex);
+	// update thread - pick the nearest point lights, returns false
+	// when the lights have not changed since the last call
+	bool GatherLights(
+		const LIGHT_STATE& baseLights,
+		const glm::vec3& cameraPosition,
+		LIGHT_STATE& lights);
+	// update thread - slots whose cells are drawn this frame
+	const std::vector<int>& GetDrawnSlots() const;
+
+	// GL thread - free retired cells and upload decoded ones
+	void ProcessUploads(uint64_t frameIndex, const glm::vec3& cameraPosition);
+
+	// cell data of a drawn slot
+	const std::vector<SCENE_OBJECT>& GetCellObjects(int slot) const;
+	const StaticBatcher* GetCellBatcher(int slot) const;
+	uint32_t GetCellGeneration(int slot) const;
+	int GetSlotCount() const;
+
+	// texture array layer of a cell texture slot, or -1
+	int GetTextureLayer(int textureSlot) const;
+	GLuint GetTextureArrayID() const;
+
+	STREAM_STATS GetStats() const;
+	void PrintStats() const;
+};
@@ -1,15 +1,11 @@
-#version 330 core
+#version 430 core
 out vec4 fragmentColor;
 
 in vec3 fragmentPosition;
 in vec3 fragmentVertexNormal;
 in vec2 fragmentTextureCoordinate;
-
-struct Material {
-    vec3 diffuseColor;
-    vec3 specularColor;
-    float shininess;
-}; 
+flat in uint fragmentDrawIndex;
+flat in int fragmentViewIndex;
 
 struct DirectionalLight {
     vec3 direction;
@@ -28,6 +24,13 @@ struct PointLight {
     vec3 diffuse;
     vec3 specular;
 
+    float constant;
+    float linear;
+    float quadratic;
+    // square of the distance past which the light is too dim to
+    // change a pixel, worked out on the CPU
+    float rangeSquared;
+
     bool bActive;
 };
 
@@ -48,181 +51,180 @@ struct SpotLight {
     bool bActive;
 };
 
-#define TOTAL_POINT_LIGHTS 5
+// MAX_POINT_LIGHTS of FrameSnapshot.h
+#define TOTAL_POINT_LIGHTS 6
+
+// per-draw data, written by the CPU into a persistently mapped buffer
+struct DrawData {
+    mat4 model;
+    // inverse transpose of the model, composed on the CPU
+    mat3 normalMatrix;
+    vec2 uvScale;
+    int materialIndex;
+    int textureSlot;
+};
+
+// materials, uploaded once; shininess is kept in the specular w
+struct MaterialData {
+    vec4 diffuseColor;
+    vec4 specularColorShininess;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+layout (std430, binding = 1) readonly buffer MaterialDataBuffer {
+    MaterialData materials[];
+};
+
+// a view of the frame, drawn into its own rectangle of the window
+struct CameraView {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+    // center and half size of the view's rectangle in normalized
+    // device coordinates
+    vec4 viewRect;
+};
+
+// cameras of the frame, written by the CPU right before the draws;
+// every draw is instanced once per view
+layout (std140, binding = 0) uniform CameraBlock {
+    // x the number of views, y 1 when the views are placed by
+    // remapping clip space instead of the viewport array
+    ivec4 viewSettings;
+    CameraView views[4];
+};
 
-uniform bool bUseTexture=false;
 uniform bool bUseLighting=false;
 uniform vec4 objectColor = vec4(1.0f);
-uniform vec3 viewPosition;
 uniform DirectionalLight directionalLight;
 uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
 uniform SpotLight spotLight;
-uniform Material material;
-uniform sampler2D objectTexture;
-uniform vec2 UVscale = vec2(1.0f, 1.0f);
-
-// the scaled texture coordinate to use in calculations
-vec2 fragmentTextureCoordinateScaled = fragmentTextureCoordinate * UVscale;
+// every texture is a layer of one array, so draws of mixed textures
+// can be merged
+uniform sampler2DArray objectTextures;
+
+// per-fragment cost with the directional light, six point lights and
+// the spot light active, counted from the source in scalar operations
+// (a vec3 multiply is 3, normalize is 9, pow is 3):
+//
+//                        before            after
+//   texture fetches      19 (1 unlit)      1 (1 unlit)
+//   directional light    ~65 ALU           ~45 ALU
+//   point light          ~63 ALU           ~55 ALU, ~9 out of range
+//   spot light           ~120 ALU          ~78 ALU, ~31 outside the cone
+//   whole fragment       ~584 ALU          ~486 ALU, ~210 with every
+//                                          point light out of range
+//
+// the texture is read once, the lights only sum how much light falls on
+// the fragment, and the base and material colors scale the sums once
+
+// brightness left of a light at a distance, lights without attenuation
+// terms keep their full brightness
+float Attenuation(float constant, float linear, float quadratic, float distance)
+{
+    float divisor = constant + distance * (linear + quadratic * distance);
+    return (divisor > 0.0) ? (1.0 / divisor) : 1.0;
+}
 
-// function prototypes
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+// Phong specular term of a light
+float Specular(vec3 lightDir, vec3 normal, vec3 viewDir, float shininess)
+{
+    vec3 reflectDir = reflect(-lightDir, normal);
+    return pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+}
 
 void main()
 {   
-    if(bUseLighting == true)
-    {
-        vec3 phongResult = vec3(0.0f);
-        // properties
-        vec3 norm = normalize(fragmentVertexNormal);
-        vec3 viewDir = normalize(viewPosition - fragmentPosition);
-    
-        // == =====================================================
-        // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-        // For each phase, a calculate function is defined that calculates the corresponding color
-        // per light source. In the main() function we take all the calculated colors and sum them 
-        // up for this fragment's final color.
-        // == =====================================================
-        // phase 1: directional lighting
-        if(directionalLight.bActive == true)
-        {
-            phongResult += CalcDirectionalLight(directionalLight, norm, viewDir);
-        }
-        // phase 2: point lights
-        for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
-        {
-	    if(pointLights[i].bActive == true)
-            {
-                phongResult += CalcPointLight(pointLights[i], norm, fragmentPosition, viewDir);   
-            }
-        } 
-        // phase 3: spot light
-        if(spotLight.bActive == true)
-        {
-            phongResult += CalcSpotLight(spotLight, norm, fragmentPosition, viewDir);    
-        }
-    
-        if(bUseTexture == true)
-        {
-            fragmentColor = vec4(phongResult, (texture(objectTexture, fragmentTextureCoordinateScaled)).a);
-        }
-        else
-        {
-            fragmentColor = vec4(phongResult, objectColor.a);
-        }
-    }
-    else
-    {
-        if(bUseTexture == true)
-        {
-            fragmentColor = texture(objectTexture, fragmentTextureCoordinateScaled);
-        }
-        else
-        {
-            fragmentColor = objectColor;
-        }
-    }
-}
+    // look up the draw data of the object this fragment belongs to
+    int textureSlot = draws[fragmentDrawIndex].textureSlot;
 
-// calculates the color when using a directional light.
-vec3 CalcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir)
-{
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDirection = normalize(-light.direction);
-    // diffuse shading
-    float diff = max(dot(normal, lightDirection), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDirection, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // combine results
-    if(bUseTexture == true)
+    // the texture is read once and shared by every light
+    vec4 baseColor = objectColor;
+    if(textureSlot >= 0)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
+        baseColor = texture(objectTextures, vec3(fragmentTextureCoordinate, textureSlot));
     }
-    else
+
+    if(bUseLighting == false)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
+        fragmentColor = baseColor;
+        return;
     }
-    
-    return (ambient + diffuse + specular);
-}
 
-// calculates the color when using a point light.
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
+    MaterialData materialData = materials[draws[fragmentDrawIndex].materialIndex];
+    float shininess = materialData.specularColorShininess.w;
+    vec3 norm = normalize(fragmentVertexNormal);
+    vec3 viewDir = normalize(views[fragmentViewIndex].viewPosition.xyz - fragmentPosition);
+
+    // light falling on the fragment; the specular light of point lights
+    // is not tinted by the texture
     vec3 ambient = vec3(0.0f);
     vec3 diffuse = vec3(0.0f);
-    vec3 specular= vec3(0.0f);
+    vec3 texturedSpecular = vec3(0.0f);
+    vec3 plainSpecular = vec3(0.0f);
 
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    // Calculate specular component
-    float specularComponent = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-   
-    // combine results
-    if(bUseTexture == true)
-    {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * specularComponent * material.specularColor;
-    }
-    else
+    // phase 1: directional lighting
+    if(directionalLight.bActive == true)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * specularComponent * material.specularColor;
+        vec3 lightDir = normalize(-directionalLight.direction);
+        ambient += directionalLight.ambient;
+        diffuse += directionalLight.diffuse * max(dot(norm, lightDir), 0.0);
+        texturedSpecular += directionalLight.specular * Specular(lightDir, norm, viewDir, shininess);
     }
-    
-    return (ambient + diffuse + specular);
-}
 
-// calculates the color when using a spot light.
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-    vec3 ambient = vec3(0.0f);
-    vec3 diffuse = vec3(0.0f);
-    vec3 specular = vec3(0.0f);
-
-    vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction)); 
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    if(bUseTexture == true)
+    // phase 2: point lights, skipped past their range
+    for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
     {
-        ambient = light.ambient * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
-        specular = light.specular * spec * material.specularColor * vec3(texture(objectTexture, fragmentTextureCoordinateScaled));
+        if(pointLights[i].bActive == false)
+        {
+            continue;
+        }
+        vec3 toLight = pointLights[i].position - fragmentPosition;
+        float distanceSquared = dot(toLight, toLight);
+        if((distanceSquared > pointLights[i].rangeSquared) || (distanceSquared <= 0.0))
+        {
+            continue;
+        }
+        float inverseDistance = inversesqrt(distanceSquared);
+        vec3 lightDir = toLight * inverseDistance;
+        float attenuation = Attenuation(
+            pointLights[i].constant,
+            pointLights[i].linear,
+            pointLights[i].quadratic,
+            distanceSquared * inverseDistance);
+
+        ambient += pointLights[i].ambient * attenuation;
+        diffuse += pointLights[i].diffuse * (max(dot(norm, lightDir), 0.0) * attenuation);
+        plainSpecular += pointLights[i].specular * (Specular(lightDir, norm, viewDir, shininess) * attenuation);
     }
-    else
+
+    // phase 3: spot light, skipped outside its cone
+    if(spotLight.bActive == true)
     {
-        ambient = light.ambient * vec3(objectColor);
-        diffuse = light.diffuse * diff * material.diffuseColor * vec3(objectColor);
-        specular = light.specular * spec * material.specularColor * vec3(objectColor);
+        vec3 toLight = spotLight.position - fragmentPosition;
+        float distanceSquared = dot(toLight, toLight);
+        float inverseDistance = inversesqrt(distanceSquared);
+        vec3 lightDir = toLight * inverseDistance;
+        float theta = dot(lightDir, normalize(-spotLight.direction));
+        if(theta > spotLight.outerCutOff)
+        {
+            float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+            float scale = intensity * Attenuation(
+                spotLight.constant,
+                spotLight.linear,
+                spotLight.quadratic,
+                distanceSquared * inverseDistance);
+
+            ambient += spotLight.ambient * scale;
+            diffuse += spotLight.diffuse * (max(dot(norm, lightDir), 0.0) * scale);
+            texturedSpecular += spotLight.specular * (Specular(lightDir, norm, viewDir, shininess) * scale);
+        }
     }
-    
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
+
+    vec3 specularColor = materialData.specularColorShininess.rgb;
+    vec3 litColor = baseColor.rgb * (ambient + (materialData.diffuseColor.rgb * diffuse) + (specularColor * texturedSpecular));
+    fragmentColor = vec4(litColor + (specularColor * plainSpecular), baseColor.a);
 }
@@ -0,0 +1,187 @@
+#version 430 core
+out vec4 fragmentColor;
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+in vec3 fragmentLightmapCoordinate;
+flat in uint fragmentDrawIndex;
+flat in int fragmentViewIndex;
+
+// the ambient and diffuse light of the static geometry is baked into
+// the lightmap, only the specular light is computed here
+
+struct DirectionalLight {
+    vec3 direction;
+    vec3 specular;
+    bool bActive;
+};
+
+struct PointLight {
+    vec3 position;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+    // square of the distance past which the light is too dim to
+    // change a pixel, worked out on the CPU
+    float rangeSquared;
+
+    bool bActive;
+};
+
+struct SpotLight {
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3 specular;
+    bool bActive;
+};
+
+// MAX_POINT_LIGHTS of FrameSnapshot.h
+#define TOTAL_POINT_LIGHTS 6
+
+// per-draw data, written by the CPU into a persistently mapped buffer
+struct DrawData {
+    mat4 model;
+    // inverse transpose of the model, composed on the CPU
+    mat3 normalMatrix;
+    vec2 uvScale;
+    int materialIndex;
+    int textureSlot;
+};
+
+// materials, uploaded once; shininess is kept in the specular w
+struct MaterialData {
+    vec4 diffuseColor;
+    vec4 specularColorShininess;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+layout (std430, binding = 1) readonly buffer MaterialDataBuffer {
+    MaterialData materials[];
+};
+
+// a view of the frame, drawn into its own rectangle of the window
+struct CameraView {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+    // center and half size of the view's rectangle in normalized
+    // device coordinates
+    vec4 viewRect;
+};
+
+// cameras of the frame, written by the CPU right before the draws;
+// every draw is instanced once per view
+layout (std140, binding = 0) uniform CameraBlock {
+    // x the number of views, y 1 when the views are placed by
+    // remapping clip space instead of the viewport array
+    ivec4 viewSettings;
+    CameraView views[4];
+};
+
+uniform bool bUseLighting=false;
+uniform vec4 objectColor = vec4(1.0f);
+uniform DirectionalLight directionalLight;
+uniform PointLight pointLights[TOTAL_POINT_LIGHTS];
+uniform SpotLight spotLight;
+uniform sampler2DArray objectTextures;
+// RGBM pages of the baked light
+uniform sampler2DArray lightmapTextures;
+// brightest light an RGBM texel holds
+const float RGBM_RANGE = 8.0f;
+
+// brightness left of a light at a distance, lights without attenuation
+// terms keep their full brightness
+float Attenuation(float constant, float linear, float quadratic, float distance)
+{
+    float divisor = constant + distance * (linear + quadratic * distance);
+    return (divisor > 0.0) ? (1.0 / divisor) : 1.0;
+}
+
+void main()
+{
+    MaterialData materialData = materials[draws[fragmentDrawIndex].materialIndex];
+    vec3 specularColor = materialData.specularColorShininess.rgb;
+    float shininess = materialData.specularColorShininess.w;
+    int textureSlot = draws[fragmentDrawIndex].textureSlot;
+
+    // the texture is read once and shared by every term
+    vec4 baseColor = objectColor;
+    if(textureSlot >= 0)
+    {
+        baseColor = texture(objectTextures, vec3(fragmentTextureCoordinate, textureSlot));
+    }
+
+    if(bUseLighting == false)
+    {
+        fragmentColor = baseColor;
+        return;
+    }
+
+    vec4 rgbm = texture(lightmapTextures, fragmentLightmapCoordinate);
+    vec3 bakedLight = rgbm.rgb * (rgbm.a * RGBM_RANGE);
+
+    vec3 norm = normalize(fragmentVertexNormal);
+    vec3 viewDir = normalize(views[fragmentViewIndex].viewPosition.xyz - fragmentPosition);
+
+    // the forward shader tints the specular light of the directional
+    // and spot lights with the texture, but not that of point lights
+    vec3 texturedSpecular = vec3(0.0f);
+    vec3 plainSpecular = vec3(0.0f);
+    if(directionalLight.bActive == true)
+    {
+        vec3 reflectDir = reflect(normalize(directionalLight.direction), norm);
+        texturedSpecular += directionalLight.specular * pow(max(dot(viewDir, reflectDir), 0.0), shininess);
+    }
+    for(int i = 0; i < TOTAL_POINT_LIGHTS; i++)
+    {
+        if(pointLights[i].bActive == false)
+        {
+            continue;
+        }
+        vec3 toLight = pointLights[i].position - fragmentPosition;
+        float distanceSquared = dot(toLight, toLight);
+        if((distanceSquared > pointLights[i].rangeSquared) || (distanceSquared <= 0.0))
+        {
+            continue;
+        }
+        float inverseDistance = inversesqrt(distanceSquared);
+        vec3 reflectDir = reflect(-(toLight * inverseDistance), norm);
+        float attenuation = Attenuation(
+            pointLights[i].constant,
+            pointLights[i].linear,
+            pointLights[i].quadratic,
+            distanceSquared * inverseDistance);
+        plainSpecular += pointLights[i].specular * (pow(max(dot(viewDir, reflectDir), 0.0), shininess) * attenuation);
+    }
+    if(spotLight.bActive == true)
+    {
+        vec3 toLight = spotLight.position - fragmentPosition;
+        float distanceSquared = dot(toLight, toLight);
+        float inverseDistance = inversesqrt(distanceSquared);
+        vec3 lightDir = toLight * inverseDistance;
+        float theta = dot(lightDir, normalize(-spotLight.direction));
+        if(theta > spotLight.outerCutOff)
+        {
+            vec3 reflectDir = reflect(-lightDir, norm);
+            float attenuation = Attenuation(spotLight.constant, spotLight.linear, spotLight.quadratic, distanceSquared * inverseDistance);
+            float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+            texturedSpecular += spotLight.specular * (pow(max(dot(viewDir, reflectDir), 0.0), shininess) * attenuation * intensity);
+        }
+    }
+
+    vec3 specular = specularColor * (texturedSpecular * baseColor.rgb + plainSpecular);
+    fragmentColor = vec4(bakedLight * baseColor.rgb + specular, baseColor.a);
+}
@@ -0,0 +1,84 @@
+#version 430 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+// index of the draw, baked into the vertices of the static batches
+layout (location = 3) in uint inDrawIndex;
+// lightmap texture coordinate, and the page in z
+layout (location = 4) in vec3 inLightmapCoordinate;
+
+// per-draw data, written by the CPU into a persistently mapped buffer
+struct DrawData {
+    mat4 model;
+    // inverse transpose of the model, composed on the CPU
+    mat3 normalMatrix;
+    vec2 uvScale;
+    int materialIndex;
+    int textureSlot;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+    DrawData draws[];
+};
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+out vec3 fragmentLightmapCoordinate;
+flat out uint fragmentDrawIndex;
+flat out int fragmentViewIndex;
+
+// a view of the frame, drawn into its own rectangle of the window
+struct CameraView {
+    mat4 view;
+    mat4 projection;
+    vec4 viewPosition;
+    // center and half size of the view's rectangle in normalized
+    // device coordinates
+    vec4 viewRect;
+};
+
+// cameras of the frame, written by the CPU right before the draws;
+// every draw is instanced once per view
+layout (std140, binding = 0) uniform CameraBlock {
+    // x the number of views, y 1 when the views are placed by
+    // remapping clip space instead of the viewport array
+    ivec4 viewSettings;
+    CameraView views[4];
+};
+
+// send the vertex to the rectangle of its view - through the viewport
+// array when the vertex shader can pick the viewport, otherwise by
+// squeezing clip space into the rectangle and clipping to its edges
+vec4 PlaceInView(vec4 clipPosition, int viewIndex)
+{
+   gl_ClipDistance[0] = clipPosition.w + clipPosition.x;
+   gl_ClipDistance[1] = clipPosition.w - clipPosition.x;
+   gl_ClipDistance[2] = clipPosition.w + clipPosition.y;
+   gl_ClipDistance[3] = clipPosition.w - clipPosition.y;
+#ifdef GL_ARB_shader_viewport_layer_array
+   gl_ViewportIndex = (viewSettings.y == 0) ? viewIndex : 0;
+#endif
+   if (viewSettings.y != 0)
+   {
+      vec4 viewRect = views[viewIndex].viewRect;
+      clipPosition.xy = clipPosition.xy * viewRect.zw + viewRect.xy * clipPosition.w;
+   }
+   return clipPosition;
+}
+
+void main()
+{
+   // the instances of a draw are its views
+   int viewIndex = gl_InstanceID;
+   mat4 model = draws[inDrawIndex].model;
+
+   fragmentPosition = vec3(model * vec4(inVertexPosition, 1.0));
+   gl_Position = PlaceInView(views[viewIndex].projection * views[viewIndex].view * vec4(fragmentPosition, 1.0f), viewIndex);
+   fragmentVertexNormal = draws[inDrawIndex].normalMatrix * inVertexNormal;
+   fragmentTextureCoordinate = inTextureCoordinate * draws[inDrawIndex].uvScale;
+   fragmentLightmapCoordinate = inLightmapCoordinate;
+   fragmentDrawIndex = inDrawIndex;
+   fragmentViewIndex = viewIndex;
+}
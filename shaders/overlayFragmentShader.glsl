@@ -0,0 +1,96 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec2 panelCoordinate;
+
+const int COUNTER_COUNT = 7;
+const int HISTORY_LENGTH = 240;
+// digits 0 to 9 in a 3x5 font, the rows from the top, three bits
+// each with the leftmost pixel in the highest bit
+const int DIGIT_GLYPHS[10] = int[10](31599, 11415, 29671, 29647, 23497, 31183, 31215, 29257, 31727, 31695);
+const int DIGIT_COUNT = 9;
+const float DIGIT_SCALE = 2.0f;
+
+// a row per counter, the frames of the history scaled to the
+// largest count of the counter, the newest at the right
+uniform sampler2D historyTexture;
+uniform int historyCount;
+// count of each counter in the newest frame
+uniform float latestValues[COUNTER_COUNT];
+// size of the panel and of its graphs, in pixels
+uniform vec2 panelSize;
+uniform float graphWidth;
+
+// color of each counter, in the order of the counters
+const vec3 COUNTER_COLORS[COUNTER_COUNT] = vec3[COUNTER_COUNT](
+   vec3(0.95f, 0.35f, 0.30f),   // draw calls
+   vec3(0.95f, 0.70f, 0.25f),   // triangles
+   vec3(0.85f, 0.90f, 0.30f),   // texture binds
+   vec3(0.40f, 0.85f, 0.40f),   // material switches
+   vec3(0.30f, 0.80f, 0.90f),   // uniform uploads
+   vec3(0.45f, 0.55f, 0.95f),   // buffer bytes
+   vec3(0.80f, 0.45f, 0.90f));  // culled objects
+
+// check whether a pixel of the latest count is lit
+bool IsDigitPixel(float value, vec2 position)
+{
+   // cells of four pixels, a column of spacing after the glyph
+   ivec2 cell = ivec2(floor(position / DIGIT_SCALE));
+   int digit = DIGIT_COUNT - 1 - (cell.x / 4);
+   int column = cell.x % 4;
+   int row = 4 - cell.y;
+   if ((digit < 0) || (column > 2) || (row < 0) || (row > 4))
+   {
+      return false;
+   }
+
+   // the leading zeros are left out, and the power is rounded so
+   // that it is exact
+   float power = floor(pow(10.0f, float(digit)) + 0.5f);
+   if ((digit > 0) && (value < power))
+   {
+      return false;
+   }
+   int glyph = DIGIT_GLYPHS[int(mod(floor(value / power), 10.0f))];
+   return ((glyph >> (14 - (row * 3 + column))) & 1) != 0;
+}
+
+void main()
+{
+   vec2 pixel = panelCoordinate * panelSize;
+   float rowHeight = panelSize.y / float(COUNTER_COUNT);
+   // the first counter is the top row
+   int counter = COUNTER_COUNT - 1 - int(pixel.y / rowHeight);
+   counter = clamp(counter, 0, COUNTER_COUNT - 1);
+   float rowY = mod(pixel.y, rowHeight);
+   vec3 color = COUNTER_COLORS[counter];
+
+   fragmentColor = vec4(0.0f, 0.0f, 0.0f, 0.6f);
+   if (rowY < 1.0f)
+   {
+      // a line between the rows
+      fragmentColor = vec4(0.3f, 0.3f, 0.3f, 0.8f);
+   }
+   else if (pixel.x < graphWidth)
+   {
+      int column = int(pixel.x / graphWidth * float(HISTORY_LENGTH));
+      if (column >= HISTORY_LENGTH - historyCount)
+      {
+         float value = texelFetch(historyTexture, ivec2(column, counter), 0).r;
+         if ((rowY - 1.0f) < value * (rowHeight - 3.0f))
+         {
+            fragmentColor = vec4(color, 0.85f);
+         }
+      }
+   }
+   else
+   {
+      // the digits are centered in the height of the row
+      vec2 digitPosition = vec2(pixel.x - graphWidth - 4.0f, rowY - (rowHeight - 5.0f * DIGIT_SCALE) * 0.5f);
+      if ((digitPosition.x >= 0.0f) && (digitPosition.y >= 0.0f) &&
+         (IsDigitPixel(latestValues[counter], digitPosition) == true))
+      {
+         fragmentColor = vec4(color, 1.0f);
+      }
+   }
+}
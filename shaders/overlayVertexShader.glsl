@@ -0,0 +1,11 @@
+#version 330 core
+out vec2 panelCoordinate;
+
+void main()
+{
+   // a single triangle covers the viewport of the panel, generated
+   // from the vertex index so no vertex buffer is needed
+   vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   panelCoordinate = position;
+   gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+out vec4 fragmentColor;
+
+in vec2 fragmentTextureCoordinate;
+
+uniform sampler2D sourceTexture;
+// size of one texel of the offscreen target
+uniform vec2 texelSize;
+// portion of the offscreen target that holds this frame
+uniform vec2 sourceScale = vec2(1.0f, 1.0f);
+uniform bool bSharpen = false;
+uniform float sharpness = 0.5f;
+
+void main()
+{
+    // keep the taps inside the rendered area so that stale pixels
+    // from a larger previous frame never bleed in at the edges
+    vec2 maxCoordinate = sourceScale - texelSize * 0.5f;
+    vec2 coordinate = min(fragmentTextureCoordinate, maxCoordinate);
+    vec3 center = texture(sourceTexture, coordinate).rgb;
+
+    if(bSharpen == true)
+    {
+        // unsharp mask over the four direct neighbours, with the
+        // result clamped to the neighbourhood to avoid ringing
+        vec3 north = texture(sourceTexture, min(coordinate + vec2(0.0f, texelSize.y), maxCoordinate)).rgb;
+        vec3 south = texture(sourceTexture, max(coordinate - vec2(0.0f, texelSize.y), texelSize * 0.5f)).rgb;
+        vec3 east = texture(sourceTexture, min(coordinate + vec2(texelSize.x, 0.0f), maxCoordinate)).rgb;
+        vec3 west = texture(sourceTexture, max(coordinate - vec2(texelSize.x, 0.0f), texelSize * 0.5f)).rgb;
+
+        vec3 neighbourMin = min(min(north, south), min(east, west));
+        vec3 neighbourMax = max(max(north, south), max(east, west));
+        vec3 blurred = (north + south + east + west) * 0.25f;
+
+        center = clamp(center + (center - blurred) * sharpness,
+            min(neighbourMin, center), max(neighbourMax, center));
+    }
+
+    fragmentColor = vec4(center, 1.0f);
+}
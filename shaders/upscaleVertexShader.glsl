@@ -0,0 +1,14 @@
+#version 330 core
+out vec2 fragmentTextureCoordinate;
+
+// portion of the offscreen target that holds this frame
+uniform vec2 sourceScale = vec2(1.0f, 1.0f);
+
+void main()
+{
+   // a single triangle covers the whole window, generated
+   // from the vertex index so no vertex buffer is needed
+   vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+   fragmentTextureCoordinate = position * sourceScale;
+   gl_Position = vec4(position * 2.0f - 1.0f, 0.0f, 1.0f);
+}